@@ -0,0 +1,100 @@
+#include <cstring>
+#include "crc32c.h"
+
+// The crc32 instruction is only used on 64 bit x86, where it takes eight
+// bytes at a time. The compiler need not target SSE4.2 for this; we ask the
+// processor at run time.
+#if defined(__GNUC__) && defined(__x86_64__)
+# define TUVOK_CRC32C_SSE42
+# define TUVOK_CRC32C_TARGET __attribute__((target("sse4.2")))
+# include <nmmintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+# define TUVOK_CRC32C_SSE42
+# define TUVOK_CRC32C_TARGET
+# include <intrin.h>
+# include <nmmintrin.h>
+#endif
+
+namespace {
+  struct Tables {
+    Tables() {
+      const uint32_t dwPoly = 0x82F63B78; // reflected 0x1EDC6F41
+      for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t r = i;
+        for (int b = 0; b < 8; ++b) r = (r & 1) ? (r >> 1) ^ dwPoly : r >> 1;
+        t[0][i] = r;
+      }
+      for (uint32_t i = 0; i < 256; ++i)
+        for (int k = 1; k < 8; ++k)
+          t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xFF];
+    }
+    uint32_t t[8][256];
+  };
+
+  const Tables& GetTables() {
+    static const Tables tables;
+    return tables;
+  }
+
+#ifdef TUVOK_CRC32C_SSE42
+  bool HasSSE42() {
+# ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+# else
+    return __builtin_cpu_supports("sse4.2") != 0;
+# endif
+  }
+
+  TUVOK_CRC32C_TARGET
+  uint32_t ChunkSSE42(uint32_t crc, const unsigned char* p, size_t n) {
+    uint64_t c = ~crc;
+    for (; n > 0 && (reinterpret_cast<size_t>(p) & 7) != 0; --n)
+      c = _mm_crc32_u8(uint32_t(c), *p++);
+    for (; n >= 8; n -= 8, p += 8) {
+      uint64_t v;
+      std::memcpy(&v, p, 8);
+      c = _mm_crc32_u64(c, v);
+    }
+    for (; n > 0; --n) c = _mm_crc32_u8(uint32_t(c), *p++);
+    return ~uint32_t(c);
+  }
+#endif
+}
+
+uint32_t CRC32C::chunkSoftware(uint32_t crc, const unsigned char* p,
+                               size_t n) {
+  const uint32_t (&t)[8][256] = GetTables().t;
+  crc = ~crc;
+  for (; n >= 8; n -= 8, p += 8) {
+    // assembled byte by byte so that big endian machines agree
+    const uint32_t lo = crc ^ (uint32_t(p[0])       | uint32_t(p[1]) << 8 |
+                               uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24);
+    const uint32_t hi = uint32_t(p[4])       | uint32_t(p[5]) << 8 |
+                        uint32_t(p[6]) << 16 | uint32_t(p[7]) << 24;
+    crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^
+          t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+          t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+  }
+  for (; n > 0; --n) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+  return ~crc;
+}
+
+uint32_t CRC32C::chunk(uint32_t crc, const unsigned char* message,
+                       size_t stLength) {
+#ifdef TUVOK_CRC32C_SSE42
+  if (hardware()) return ChunkSSE42(crc, message, stLength);
+#endif
+  return chunkSoftware(crc, message, stLength);
+}
+
+bool CRC32C::hardware() {
+#ifdef TUVOK_CRC32C_SSE42
+  static const bool bHardware = HasSSE42();
+  return bHardware;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include "../StdDefines.h"
+
+/*
+ * CRC-32C (Castagnoli polynomial, as in iSCSI and ext4). Uses the SSE4.2
+ * crc32 instruction when the processor has it and slicing-by-8 tables
+ * otherwise; both give the same result.
+ */
+class CRC32C {
+public:
+  static uint32_t get(const unsigned char* message, size_t stLength) {
+    return chunk(0, message, stLength);
+  }
+
+  /// continues the checksum 'crc' of the preceding bytes; 0 starts a new one
+  static uint32_t chunk(uint32_t crc, const unsigned char* message,
+                        size_t stLength);
+
+  /// table driven version, only public for testing
+  static uint32_t chunkSoftware(uint32_t crc, const unsigned char* message,
+                                size_t stLength);
+
+  /// whether chunk runs on the crc32 instruction
+  static bool hardware();
+};
+
+#endif // CRC32C_H
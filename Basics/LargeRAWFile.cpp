@@ -1,13 +1,31 @@
 #include <memory>
 #include <sstream>
 #include <algorithm> // for std::max, std::min
+#include <cerrno>
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+#endif
 #include "LargeRAWFile.h"
 #include "nonstd.h"
 
 using namespace std;
 
+#ifdef _WIN32
+// Handles opened for overlapped I/O do not keep a file pointer, so reads
+// through them leave the one of the original handle alone.
+static HANDLE OpenOverlapped(HANDLE hFile) {
+  if (hFile == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
+  return ReOpenFile(hFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                    FILE_FLAG_OVERLAPPED);
+}
+#endif
+
 LargeRAWFile::LargeRAWFile(const std::string& strFilename, uint64_t iHeaderSize):
   m_StreamFile(NULL),
+#ifdef _WIN32
+  m_PositionalFile(INVALID_HANDLE_VALUE),
+#endif
   m_strFilename(strFilename),
   m_bIsOpen(false),
   m_bWritable(false),
@@ -16,6 +34,9 @@ LargeRAWFile::LargeRAWFile(const std::string& strFilename, uint64_t iHeaderSize)
 }
 
 LargeRAWFile::LargeRAWFile(const std::wstring& wstrFilename, uint64_t iHeaderSize):
+#ifdef _WIN32
+  m_PositionalFile(INVALID_HANDLE_VALUE),
+#endif
   m_bIsOpen(false),
   m_bWritable(false),
   m_iHeaderSize(iHeaderSize)
@@ -26,6 +47,9 @@ LargeRAWFile::LargeRAWFile(const std::wstring& wstrFilename, uint64_t iHeaderSiz
 
 LargeRAWFile::LargeRAWFile(const LargeRAWFile &other) :
   m_StreamFile(NULL),
+#ifdef _WIN32
+  m_PositionalFile(INVALID_HANDLE_VALUE),
+#endif
   m_strFilename(other.m_strFilename),
   m_bIsOpen(other.m_bIsOpen),
   m_bWritable(other.m_bWritable),
@@ -45,6 +69,7 @@ bool LargeRAWFile::Open(bool bReadWrite) {
                                           : GENERIC_READ,
                              FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
     m_bIsOpen = m_StreamFile != INVALID_HANDLE_VALUE;
+    m_PositionalFile = OpenOverlapped(m_StreamFile);
   #else
     m_StreamFile = fopen(m_strFilename.c_str(), (bReadWrite) ? "r+b" : "rb");
     if(m_StreamFile == NULL) {
@@ -65,9 +90,10 @@ bool LargeRAWFile::Open(bool bReadWrite) {
 bool LargeRAWFile::Create(uint64_t iInitialSize) {
 #ifdef _WIN32
   m_StreamFile = CreateFileA(m_strFilename.c_str(),
-                             GENERIC_READ | GENERIC_WRITE, 0, NULL,
-                             CREATE_ALWAYS, 0, NULL);
+                             GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                             NULL, CREATE_ALWAYS, 0, NULL);
   m_bIsOpen = m_StreamFile != INVALID_HANDLE_VALUE;
+  m_PositionalFile = OpenOverlapped(m_StreamFile);
 #else
   m_StreamFile = fopen(m_strFilename.c_str(), "w+b");
   m_bIsOpen = m_StreamFile != NULL;
@@ -87,9 +113,10 @@ bool LargeRAWFile::Create(uint64_t iInitialSize) {
 bool LargeRAWFile::Append() {
 #ifdef _WIN32
   m_StreamFile = CreateFileA(m_strFilename.c_str(),
-                             GENERIC_READ | GENERIC_WRITE, 0, NULL,
-                             OPEN_ALWAYS, 0, NULL);
+                             GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                             NULL, OPEN_ALWAYS, 0, NULL);
   m_bIsOpen = m_StreamFile != INVALID_HANDLE_VALUE;
+  m_PositionalFile = OpenOverlapped(m_StreamFile);
 #else
   m_StreamFile = fopen(m_strFilename.c_str(), "a+b");
   m_bIsOpen = m_StreamFile != NULL;
@@ -107,6 +134,10 @@ void LargeRAWFile::Close() {
   if (m_bIsOpen) {
 #ifdef _WIN32
     CloseHandle(m_StreamFile);
+    if (m_PositionalFile != INVALID_HANDLE_VALUE) {
+      CloseHandle(m_PositionalFile);
+      m_PositionalFile = INVALID_HANDLE_VALUE;
+    }
 #else
     fclose(m_StreamFile);
 #endif
@@ -190,6 +221,55 @@ size_t LargeRAWFile::ReadRAW(unsigned char* pData, uint64_t iCount) {
   #endif
 }
 
+size_t LargeRAWFile::ReadRAWAt(unsigned char* pData, uint64_t iCount,
+                               uint64_t iPos) const {
+  uint64_t iTotalRead = 0;
+  uint64_t iOffset = iPos+m_iHeaderSize;
+  #ifdef _WIN32
+  // m_PositionalFile is an overlapped handle: ReadFile may complete
+  // asynchronously, and each call brings its own event so that concurrent
+  // callers wait for their own read only.
+  HANDLE hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  while (iCount > 0 && hEvent != NULL) {
+    DWORD dwChunk = DWORD(std::min<uint64_t>(iCount,
+                                    std::numeric_limits<DWORD>::max()));
+    OVERLAPPED ov = {0};
+    ov.Offset = DWORD(iOffset & 0xFFFFFFFF);
+    ov.OffsetHigh = DWORD(iOffset >> 32);
+    ov.hEvent = hEvent;
+    DWORD dwReadBytes = 0;
+    if (!ReadFile(m_PositionalFile, pData, dwChunk, NULL, &ov) &&
+        GetLastError() != ERROR_IO_PENDING) {
+      break;
+    }
+    if (!GetOverlappedResult(m_PositionalFile, &ov, &dwReadBytes, TRUE) ||
+        dwReadBytes == 0) {
+      break;
+    }
+    iCount -= dwReadBytes;
+    iTotalRead += dwReadBytes;
+    iOffset += dwReadBytes;
+    pData += dwReadBytes;
+  }
+  if (hEvent != NULL) CloseHandle(hEvent);
+  #else
+  // pread bypasses the stdio buffer, so anything we wrote must hit the file
+  // before we can read it back.
+  if (m_bWritable) fflush(m_StreamFile);
+  const int fd = fileno(m_StreamFile);
+  while (iCount > 0) {
+    ssize_t iRead = pread(fd, pData, size_t(iCount), off_t(iOffset));
+    if (iRead < 0 && errno == EINTR) continue;
+    if (iRead <= 0) break;
+    iCount -= uint64_t(iRead);
+    iTotalRead += uint64_t(iRead);
+    iOffset += uint64_t(iRead);
+    pData += iRead;
+  }
+  #endif
+  return size_t(iTotalRead);
+}
+
 size_t LargeRAWFile::WriteRAW(const unsigned char* pData, uint64_t iCount) {
   #ifdef _WIN32
   uint64_t iTotalWritten = 0;
@@ -255,9 +335,25 @@ bool LargeRAWFile::Truncate(uint64_t iPos) {
   #endif
 }
 
-// no-op, but I want to leave the argument names in the header so it's nicer to
-// implement it here.
-void LargeRAWFile::Hint(IOHint, uint64_t, uint64_t) const { }
+// Only POSIX has an equivalent; elsewhere this stays a no-op.
+void LargeRAWFile::Hint(IOHint hint, uint64_t offset, uint64_t length) const {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+  if(!m_bIsOpen || length == 0) { return; }
+  int advice = POSIX_FADV_NORMAL;
+  switch(hint) {
+    case NORMAL:     advice = POSIX_FADV_NORMAL; break;
+    case SEQUENTIAL: advice = POSIX_FADV_SEQUENTIAL; break;
+    case NOREUSE:    advice = POSIX_FADV_NOREUSE; break;
+    case WILLNEED:   advice = POSIX_FADV_WILLNEED; break;
+    case DONTNEED:   advice = POSIX_FADV_DONTNEED; break;
+  }
+  // purely advisory; if the kernel does not care, neither do we.
+  posix_fadvise(fileno(m_StreamFile), off_t(offset+m_iHeaderSize),
+                off_t(length), advice);
+#else
+  (void)hint; (void)offset; (void)length;
+#endif
+}
 
 bool LargeRAWFile::Copy(const std::string& strSource,
                         const std::string& strTarget, uint64_t iSourceHeaderSkip,
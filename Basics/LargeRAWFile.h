@@ -60,6 +60,14 @@ public:
   virtual void SeekPos(uint64_t iPos);
   virtual size_t ReadRAW(unsigned char* pData, uint64_t iCount);
   virtual size_t WriteRAW(const unsigned char* pData, uint64_t iCount);
+  /// Positional read: reads 'iCount' bytes starting at 'iPos' without using
+  /// or modifying the file pointer, so that several threads can read from the
+  /// same file concurrently, also while another one uses SeekPos/ReadRAW.
+  /// On Windows this goes through a second handle opened for overlapped
+  /// I/O, which has no file pointer.  Buffered writes are flushed first, but
+  /// writing while other threads read is not supported.
+  virtual size_t ReadRAWAt(unsigned char* pData, uint64_t iCount,
+                           uint64_t iPos) const;
   virtual bool CopyRAW(uint64_t iCount, uint64_t iSourcePos, uint64_t iTargetPos,
                        unsigned char* pBuffer, uint64_t iBufferSize);
 
@@ -153,6 +161,10 @@ public:
                       std::wstring* wstrMessage=NULL);
 protected:
   FILETYPE      m_StreamFile;
+#ifdef _WIN32
+  /// overlapped twin of m_StreamFile, only used by ReadRAWAt
+  HANDLE        m_PositionalFile;
+#endif
   std::string   m_strFilename;
   bool          m_bIsOpen;
   bool          m_bWritable;
@@ -36,18 +36,29 @@
 //!    Copyright (C) 2008 SCI Institute
 
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <iomanip>
 #include "MC.h"
 
 
+namespace {
+  // grows geometrically, so that appending layer after layer stays linear
+  int GrowCapacity(int iCapacity, int iNeeded) {
+    return (iNeeded <= iCapacity) ? iCapacity
+                                  : std::max(iNeeded, std::max(64, 2*iCapacity));
+  }
+}
+
 Isosurface::Isosurface() :
   vfVertices(NULL),
   vfNormals(NULL),
   viTriangles(NULL),
   iVertices(0),
-  iTriangles(0)
+  iTriangles(0),
+  m_iMaxVertices(0),
+  m_iMaxTriangles(0)
 {}
 
 Isosurface::Isosurface(int iMaxVertices, int iMaxTris) :
@@ -55,7 +66,9 @@ Isosurface::Isosurface(int iMaxVertices, int iMaxTris) :
   vfNormals(new VECTOR3<float>[iMaxVertices]),
   viTriangles(new VECTOR3<int>[iMaxTris]),
   iVertices(0),
-  iTriangles(0)
+  iTriangles(0),
+  m_iMaxVertices(iMaxVertices),
+  m_iMaxTriangles(iMaxTris)
 {}
 
 Isosurface::~Isosurface() {
@@ -64,45 +77,56 @@ Isosurface::~Isosurface() {
   delete [] viTriangles;
 }
 
+void Isosurface::Reserve(int iMaxVertices, int iMaxTris) {
+  if (iMaxVertices > m_iMaxVertices) {
+    VECTOR3<float>* temp_Vertices = new VECTOR3<float>[iMaxVertices];
+    VECTOR3<float>* temp_Normals  = new VECTOR3<float>[iMaxVertices];
+    if (iVertices > 0) {
+      std::copy(vfVertices, vfVertices+iVertices, temp_Vertices);
+      std::copy(vfNormals, vfNormals+iVertices, temp_Normals);
+    }
+    delete [] vfVertices;
+    delete [] vfNormals;
+    vfVertices = temp_Vertices;
+    vfNormals  = temp_Normals;
+    m_iMaxVertices = iMaxVertices;
+  }
+  if (iMaxTris > m_iMaxTriangles) {
+    VECTOR3<int>* temp_Triangles = new VECTOR3<int>[iMaxTris];
+    if (iTriangles > 0) {
+      std::copy(viTriangles, viTriangles+iTriangles, temp_Triangles);
+    }
+    delete [] viTriangles;
+    viTriangles = temp_Triangles;
+    m_iMaxTriangles = iMaxTris;
+  }
+}
+
 int Isosurface::AddTriangle(int a, int b, int c) {
+  if (iTriangles == m_iMaxTriangles)
+    Reserve(m_iMaxVertices, GrowCapacity(m_iMaxTriangles, iTriangles+1));
   viTriangles[iTriangles++] = VECTOR3<int>(a,b,c);
   return iTriangles-1;
 }
 
 int Isosurface::AddVertex(VECTOR3<float> v, VECTOR3<float> n) {
+  if (iVertices == m_iMaxVertices)
+    Reserve(GrowCapacity(m_iMaxVertices, iVertices+1), m_iMaxTriangles);
   vfVertices[iVertices] = v;
   vfNormals[iVertices++] = n;
   return iVertices-1;
 }
 
 void Isosurface::AppendData(const Isosurface* other) {
-  // if verts in other, expand the storage this surface
-  if (other->iVertices > 0) {
-
-    // create new mem
-    VECTOR3<float>*  temp_Vertices  = new VECTOR3<float>[iVertices  + other->iVertices];
-    VECTOR3<float>*  temp_Normals   = new VECTOR3<float>[iVertices  + other->iVertices];
-    VECTOR3<int>*  temp_Triangles = new VECTOR3<int>[iTriangles + other->iTriangles];
-
-    // copy "old" data
-    memcpy(temp_Vertices, vfVertices, sizeof(VECTOR3<float>)*iVertices);
-    memcpy(temp_Normals, vfNormals, sizeof(VECTOR3<float>)*iVertices);
-    memcpy(temp_Triangles, viTriangles, sizeof(VECTOR3<int>)*iTriangles);
+  Reserve(GrowCapacity(m_iMaxVertices, iVertices + other->iVertices),
+          GrowCapacity(m_iMaxTriangles, iTriangles + other->iTriangles));
 
-    // append new data
-    memcpy(temp_Vertices+iVertices, other->vfVertices, sizeof(VECTOR3<float>)*other->iVertices);
-    memcpy(temp_Normals+iVertices, other->vfNormals, sizeof(VECTOR3<float>)*other->iVertices);
-    memcpy(temp_Triangles+iTriangles, other->viTriangles, sizeof(VECTOR3<int>)*other->iTriangles);
-
-    // delete "old" data
-    delete [] vfVertices;
-    delete [] vfNormals;
-    delete [] viTriangles;
-
-    // rename
-    vfVertices  = temp_Vertices;
-    vfNormals   = temp_Normals;
-    viTriangles = temp_Triangles;
+  if (other->iVertices > 0) {
+    std::copy(other->vfVertices, other->vfVertices+other->iVertices, vfVertices+iVertices);
+    std::copy(other->vfNormals, other->vfNormals+other->iVertices, vfNormals+iVertices);
+  }
+  if (other->iTriangles > 0) {
+    std::copy(other->viTriangles, other->viTriangles+other->iTriangles, viTriangles+iTriangles);
   }
 
   // update this list's counters
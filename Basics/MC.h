@@ -38,25 +38,48 @@
 
 #pragma once
 
+#include <vector>
 #include "Vectors.h"
 
 #define EPSILON 0.000001f
 #define DATA_INDEX(I, J, K, IDIM, JDIM) ((I) + ((IDIM) * (J)) + ((IDIM * JDIM) * (K)))
-#define EDGE_INDEX(E, I, J, IDIM) ((E) + (12 * (I)) + ((12 * (IDIM)) * (J)))
 #define NO_EDGE -1
 
+// scratch data for the layer of cells between two voxel planes; it is
+// owned by the MarchingCubes object and only grows, so marching a volume
+// does not allocate once the first layer is set up
 template <class T=float> class LayerTempData {
 public:
     T*    pTBotData;
     T*    pTTopData;
-    int*    piEdges;  // tag indexing into vertex list
-
-  LayerTempData<T>(INTVECTOR3 vVolSize, T* pTVolume);
-    virtual ~LayerTempData();
+    // tags indexing into the vertex list, one slot per voxel of a plane:
+    // x and y edges of the bottom and top plane are stored at their lower
+    // end, z edges between the planes at their bottom end.  Every edge has
+    // exactly one slot, so cells and layers share them without copying.
+    int*  piBotXEdges;
+    int*  piBotYEdges;
+    int*  piTopXEdges;
+    int*  piTopYEdges;
+    int*  piZEdges;
+    // case table index of the cells of the current row, see ClassifyRow
+    unsigned char* pCellIndex;
+
+    LayerTempData<T>();
+    virtual ~LayerTempData() {}
+    void Init(INTVECTOR3 vVolSize, T* pTVolume, T TIsoValue);
     void NextIteration();
+    void ClassifyRow(int j, int iFirst, int iEnd);
 
 private:
     INTVECTOR3 m_vVolSize;
+    T          m_TIsoValue;
+    // (value < isovalue) for every voxel of the bottom and top plane
+    unsigned char* m_pBotInside;
+    unsigned char* m_pTopInside;
+    std::vector<int>           m_vEdgeStorage;
+    std::vector<unsigned char> m_vCaseStorage;
+
+    void Classify(const T* pTData, unsigned char* pInside) const;
 };
 
 class Isosurface {
@@ -71,10 +94,20 @@ public:
     Isosurface(int iMaxVertices, int iMaxTris);
     virtual ~Isosurface();
 
+    // the storage grows as needed; Clear keeps it for the next use
+    void Reserve(int iMaxVertices, int iMaxTris);
+    void Clear() {iVertices = 0; iTriangles = 0;}
     int AddTriangle(int a, int b, int c);
     int AddVertex(FLOATVECTOR3 v, FLOATVECTOR3 n);
     void AppendData(const Isosurface* other);
     void Transform(const FLOATMATRIX4& matrix);
+
+private:
+    int             m_iMaxVertices;
+    int             m_iMaxTriangles;
+
+    Isosurface(const Isosurface&);
+    Isosurface& operator=(const Isosurface&);
 };
 
 
@@ -86,6 +119,11 @@ public:
     virtual ~MarchingCubes<T>(void);
 
     virtual void SetVolume(int iSizeX, int iSizeY, int iSizeZ, T* pTVolume);
+    // restricts Process to the cells [vFirstCell, vEndCell), cell (i,j,k)
+    // spans the voxels (i,j,k) to (i+1,j+1,k+1); SetVolume resets this to
+    // all cells of the volume
+    void SetCellRange(const INTVECTOR3& vFirstCell,
+                      const INTVECTOR3& vEndCell);
     virtual void Process(T TIsoValue);
 
 protected:
@@ -94,9 +132,15 @@ protected:
 
     INTVECTOR3    m_vVolSize;
     INTVECTOR3    m_vOffset;
+    INTVECTOR3    m_vFirstCell;
+    INTVECTOR3    m_vEndCell;
     T*            m_pTVolume;
     T             m_TIsoValue;
 
+    // reused by every Process call
+    LayerTempData<T> m_LayerData;
+    Isosurface       m_SliceIsosurface;
+
     virtual void MarchLayer(LayerTempData<T> *layer, int iLayer);
     virtual int MakeVertex(int whichEdge, int i, int j, int k, Isosurface* sliceIso);
     virtual FLOATVECTOR3 InterpolateNormal(T fValueAtPos, INTVECTOR3 vPosition);
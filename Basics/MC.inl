@@ -37,6 +37,7 @@
 //!    Copyright (C) 2008 SCI Institute
 
 
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 
@@ -376,6 +377,8 @@ template <class T> int MarchingCubes<T>::ms_triTable[256][16] =
 template <class T> MarchingCubes<T>::MarchingCubes(void)
 {
   m_vVolSize    = INTVECTOR3(0,0,0);
+  m_vFirstCell  = INTVECTOR3(0,0,0);
+  m_vEndCell    = INTVECTOR3(0,0,0);
   m_pTVolume    = NULL;
   m_Isosurface  = NULL;
 }
@@ -390,6 +393,14 @@ template <class T> void MarchingCubes<T>::SetVolume(int iSizeX, int iSizeY, int
   m_pTVolume  = pTVolume;
   m_vVolSize  = INTVECTOR3(iSizeX, iSizeY, iSizeZ);
   m_TIsoValue = 0;
+  m_vFirstCell = INTVECTOR3(0,0,0);
+  m_vEndCell   = m_vVolSize-1;
+}
+
+template <class T> void MarchingCubes<T>::SetCellRange(const INTVECTOR3& vFirstCell, const INTVECTOR3& vEndCell)
+{
+  m_vFirstCell = vFirstCell;
+  m_vEndCell   = vEndCell;
 }
 
 template <class T> void MarchingCubes<T>::Process(T TIsoValue)
@@ -397,171 +408,83 @@ template <class T> void MarchingCubes<T>::Process(T TIsoValue)
   // store isovalue
   m_TIsoValue = TIsoValue;
 
-  // init isosurface data
-  delete m_Isosurface;
-  m_Isosurface = new Isosurface();
+  // init isosurface data, keeping the storage of earlier calls
+  if (m_Isosurface == NULL)
+    m_Isosurface = new Isosurface();
+  else
+    m_Isosurface->Clear();
 
-  // if the volume is empty we are done
-  if (m_vVolSize.volume() == 0) return;
+  // if the volume (or the cell range) is empty we are done
+  if (m_vVolSize.volume() == 0 ||
+      m_vFirstCell.x >= m_vEndCell.x ||
+      m_vFirstCell.y >= m_vEndCell.y ||
+      m_vFirstCell.z >= m_vEndCell.z) return;
 
-  // create a new layer - dataset
-  LayerTempData<T>* layerData = new LayerTempData<T>(m_vVolSize,m_pTVolume);
+  // set up the layer data
+  m_LayerData.Init(m_vVolSize,
+    m_pTVolume+DATA_INDEX(0, 0, m_vFirstCell.z, m_vVolSize.x, m_vVolSize.y),
+    m_TIsoValue);
 
   // march the first layer
-  MarchLayer(layerData, 0);
+  MarchLayer(&m_LayerData, m_vFirstCell.z);
 
   // now do the remaining layers
-  for (int iZ = 1; iZ < m_vVolSize.z - 1; iZ++) {
+  for (int iZ = m_vFirstCell.z+1; iZ < m_vEndCell.z; iZ++) {
     // prepare the temp data to be used in the next layer
-    layerData->NextIteration();
+    m_LayerData.NextIteration();
     // march the next layer
-    MarchLayer(layerData, iZ);
+    MarchLayer(&m_LayerData, iZ);
   }
-
-  // delete the layer dataset
-  delete layerData;
 }
 
 
 template <class T> void MarchingCubes<T>::MarchLayer(LayerTempData<T> *layer, int iLayer) {
   int cellVerts[12];  // the 12 possible vertices in a cell
-  for (int i = 0; i < 12; i++) cellVerts[i] = NO_EDGE;
-
-  // local part of the isosurface with at most 12 vertices and at most 5 triangles per cell
-  Isosurface* sliceIsosurface = new Isosurface((m_vVolSize.x-1) * (m_vVolSize.y-1) * 12, (m_vVolSize.x-1) * (m_vVolSize.y-1) * 5);
-
-  // march all cells in the layer
-  for(int i = 0; i < m_vVolSize.x-1; i++) {
-    for(int j = 0; j < m_vVolSize.y-1; j++) {
-
-      // fetch data from the volume
-      T fVolumeValues[8];
-      fVolumeValues[0] = (layer->pTBotData[(j+1)  * m_vVolSize.x + i]);
-      fVolumeValues[1] = (layer->pTBotData[(j+1)  * m_vVolSize.x + i+1]);
-      fVolumeValues[2] = (layer->pTBotData[j      * m_vVolSize.x + i+1]);
-      fVolumeValues[3] = (layer->pTBotData[j      * m_vVolSize.x + i]);
-      fVolumeValues[4] = (layer->pTTopData[(j+1)  * m_vVolSize.x + i]);
-      fVolumeValues[5] = (layer->pTTopData[(j+1)  * m_vVolSize.x + i+1]);
-      fVolumeValues[6] = (layer->pTTopData[j      * m_vVolSize.x + i+1]);
-      fVolumeValues[7] = (layer->pTTopData[j      * m_vVolSize.x + i]);
-
-      // compute the index for the table lookup
-      int cellIndex = 1*int(fVolumeValues[0] < m_TIsoValue)+
-                      2*int(fVolumeValues[1] < m_TIsoValue)+
-                      4*int(fVolumeValues[2] < m_TIsoValue)+
-                      8*int(fVolumeValues[3] < m_TIsoValue)+
-                     16*int(fVolumeValues[4] < m_TIsoValue)+
-                     32*int(fVolumeValues[5] < m_TIsoValue)+
-                     64*int(fVolumeValues[6] < m_TIsoValue)+
-                    128*int(fVolumeValues[7] < m_TIsoValue);
-
-      // get the coordinates for the vertices, compute the triangulation and interpolate the normals
-      if (ms_edgeTable[cellIndex] &    1) {
-        if (layer->piEdges[EDGE_INDEX(0, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[0]  = m_Isosurface->iVertices + MakeVertex(0, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[0] = layer->piEdges[EDGE_INDEX(0, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    2) {
-        if (layer->piEdges[EDGE_INDEX(1, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[1]  = m_Isosurface->iVertices+MakeVertex(1, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[1] = layer->piEdges[EDGE_INDEX(1, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    4) {
-        if (layer->piEdges[EDGE_INDEX(2, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[2]  = m_Isosurface->iVertices +MakeVertex(2, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[2] = layer->piEdges[EDGE_INDEX(2, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    8) {
-        if (layer->piEdges[EDGE_INDEX(3, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[3]  = m_Isosurface->iVertices+MakeVertex(3, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[3] = layer->piEdges[EDGE_INDEX(3, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    16) {
-        if (layer->piEdges[EDGE_INDEX(4, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[4]  = m_Isosurface->iVertices+MakeVertex(4, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[4] = layer->piEdges[EDGE_INDEX(4, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    32) {
-        if (layer->piEdges[EDGE_INDEX(5, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[5]  = m_Isosurface->iVertices+MakeVertex(5, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[5] = layer->piEdges[EDGE_INDEX(5, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    64) {
-        if (layer->piEdges[EDGE_INDEX(6, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[6]  = m_Isosurface->iVertices +MakeVertex(6, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[6] = layer->piEdges[EDGE_INDEX(6, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    128) {
-        if (layer->piEdges[EDGE_INDEX(7, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[7]  = m_Isosurface->iVertices +MakeVertex(7, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[7] = layer->piEdges[EDGE_INDEX(7, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    256) {
-        if (layer->piEdges[EDGE_INDEX(8, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[8]  = m_Isosurface->iVertices +MakeVertex(8, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[8] = layer->piEdges[EDGE_INDEX(8, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    512) {
-        if (layer->piEdges[EDGE_INDEX(9, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[9]  = m_Isosurface->iVertices +MakeVertex(9, i, j, iLayer, sliceIsosurface);
-        } else {
-        cellVerts[9] = layer->piEdges[EDGE_INDEX(9, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    1024) {
-        if (layer->piEdges[EDGE_INDEX(10, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[10]  = m_Isosurface->iVertices +MakeVertex(10, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[10] = layer->piEdges[EDGE_INDEX(10, i, j, m_vVolSize.x-1)];
-        }
-      }
-      if (ms_edgeTable[cellIndex] &    2048) {
-        if (layer->piEdges[EDGE_INDEX(11, i, j, m_vVolSize.x-1)] == NO_EDGE) {
-          cellVerts[11]  = m_Isosurface->iVertices +MakeVertex(11, i, j, iLayer, sliceIsosurface);
-        } else {
-          cellVerts[11] = layer->piEdges[EDGE_INDEX(11, i, j, m_vVolSize.x-1)];
-        }
-      }
-
-      // put the cellVerts tags into this cell's layer->edges table
+  int* pEdges[12];    // the slots of these vertices in the layer data
+
+  // local part of the isosurface
+  Isosurface* sliceIsosurface = &m_SliceIsosurface;
+  sliceIsosurface->Clear();
+
+  const int iSizeX = m_vVolSize.x;
+
+  // march all cells in the layer, row by row
+  for(int j = m_vFirstCell.y; j < m_vEndCell.y; j++) {
+    layer->ClassifyRow(j, m_vFirstCell.x, m_vEndCell.x);
+
+    for(int i = m_vFirstCell.x; i < m_vEndCell.x; i++) {
+      const int cellIndex = layer->pCellIndex[i];
+      const int cellEdges = ms_edgeTable[cellIndex];
+
+      // most cells are entirely inside or outside
+      if (cellEdges == 0) continue;
+
+      const int iFront = j*iSizeX + i;
+      const int iBack  = iFront + iSizeX;
+      pEdges[ 0] = layer->piBotXEdges + iBack;
+      pEdges[ 1] = layer->piBotYEdges + iFront+1;
+      pEdges[ 2] = layer->piBotXEdges + iFront;
+      pEdges[ 3] = layer->piBotYEdges + iFront;
+      pEdges[ 4] = layer->piTopXEdges + iBack;
+      pEdges[ 5] = layer->piTopYEdges + iFront+1;
+      pEdges[ 6] = layer->piTopXEdges + iFront;
+      pEdges[ 7] = layer->piTopYEdges + iFront;
+      pEdges[ 8] = layer->piZEdges + iBack;
+      pEdges[ 9] = layer->piZEdges + iBack+1;
+      pEdges[10] = layer->piZEdges + iFront+1;
+      pEdges[11] = layer->piZEdges + iFront;
+
+      // get the coordinates for the vertices, compute the triangulation and
+      // interpolate the normals; vertices already created by a neighboring
+      // cell are reused
       for (int iEdge = 0; iEdge < 12; iEdge++) {
-          if (cellVerts[iEdge] != NO_EDGE) {
-            layer->piEdges[EDGE_INDEX(iEdge, i, j, m_vVolSize.x-1)] = cellVerts[iEdge];
+        if (cellEdges & (1 << iEdge)) {
+          if (*pEdges[iEdge] == NO_EDGE) {
+            *pEdges[iEdge] = m_Isosurface->iVertices +
+                             MakeVertex(iEdge, i, j, iLayer, sliceIsosurface);
           }
-      }
-
-      // now propagate the vertex/normal tags to the adjacent cells to
-      // the right and behind in this layer.
-      if (i < m_vVolSize.x - 2) { // we should propagate to the right
-        layer->piEdges[EDGE_INDEX( 3, i+1, j, m_vVolSize.x-1)] = cellVerts[1];
-        layer->piEdges[EDGE_INDEX( 7, i+1, j, m_vVolSize.x-1)] = cellVerts[5];
-        layer->piEdges[EDGE_INDEX( 8, i+1, j, m_vVolSize.x-1)] = cellVerts[9];
-        layer->piEdges[EDGE_INDEX(11, i+1, j, m_vVolSize.x-1)] = cellVerts[10];
-      }
-
-      if (j < m_vVolSize.y - 2) { // we should propagate to the rear
-        layer->piEdges[EDGE_INDEX( 2, i, j+1, m_vVolSize.x-1)] = cellVerts[0];
-        layer->piEdges[EDGE_INDEX( 6, i, j+1, m_vVolSize.x-1)] = cellVerts[4];
-        layer->piEdges[EDGE_INDEX(11, i, j+1, m_vVolSize.x-1)] = cellVerts[8];
-        layer->piEdges[EDGE_INDEX(10, i, j+1, m_vVolSize.x-1)] = cellVerts[9];
+          cellVerts[iEdge] = *pEdges[iEdge];
+        }
       }
 
       // store the vertex indices in the triangle data structure
@@ -577,8 +500,6 @@ template <class T> void MarchingCubes<T>::MarchLayer(LayerTempData<T> *layer, in
 
   // add this layer's triangles to the global list
   m_Isosurface->AppendData(sliceIsosurface);
-
-  delete sliceIsosurface;
 }
 
 template <class T> int MarchingCubes<T>::MakeVertex(int iEdgeIndex, int i, int j, int k, Isosurface* sliceIso) {
@@ -685,35 +606,94 @@ template <class T> FLOATVECTOR3 MarchingCubes<T>::InterpolateNormal(T fValueAtPo
 
 
 
-template <class T> LayerTempData<T>::LayerTempData(VECTOR3<int> vVolSize, T* pTVolume) {
-  m_vVolSize = vVolSize;
+template <class T> LayerTempData<T>::LayerTempData() :
+  pTBotData(NULL),
+  pTTopData(NULL),
+  piBotXEdges(NULL),
+  piBotYEdges(NULL),
+  piTopXEdges(NULL),
+  piTopYEdges(NULL),
+  piZEdges(NULL),
+  pCellIndex(NULL),
+  m_vVolSize(0,0,0),
+  m_TIsoValue(0),
+  m_pBotInside(NULL),
+  m_pTopInside(NULL)
+{
+}
 
-  pTBotData  = pTVolume;
-  pTTopData  = pTVolume+DATA_INDEX(0, 0, 1, vVolSize.x, vVolSize.y);
-  piEdges    = new int[(vVolSize.x-1) * (vVolSize.y-1) * 12];  // allocate storage to hold the indexing tags for edges in the layer
+template <class T> void LayerTempData<T>::Init(INTVECTOR3 vVolSize, T* pTVolume, T TIsoValue) {
+  m_vVolSize  = vVolSize;
+  m_TIsoValue = TIsoValue;
 
-  for (int i = 0; i < (vVolSize.x-1) * (vVolSize.y-1) * 12; i++)  piEdges[i] = NO_EDGE;  // init edge list
-}
+  const size_t iPlaneSize = size_t(vVolSize.x) * size_t(vVolSize.y);
+
+  // five planes of edge tags and two planes of voxel classes plus a row of
+  // cell cases; the storage is only reallocated if it is too small
+  if (m_vEdgeStorage.size() < 5*iPlaneSize)
+    m_vEdgeStorage.resize(5*iPlaneSize);
+  if (m_vCaseStorage.size() < 2*iPlaneSize+size_t(vVolSize.x))
+    m_vCaseStorage.resize(2*iPlaneSize+size_t(vVolSize.x));
+
+  piBotXEdges = &m_vEdgeStorage[0];
+  piBotYEdges = piBotXEdges + iPlaneSize;
+  piTopXEdges = piBotYEdges + iPlaneSize;
+  piTopYEdges = piTopXEdges + iPlaneSize;
+  piZEdges    = piTopYEdges + iPlaneSize;
+  std::fill(piBotXEdges, piBotXEdges + 5*iPlaneSize, NO_EDGE);
 
-template <class T> LayerTempData<T>::~LayerTempData() {
-  delete [] piEdges;
+  m_pBotInside = &m_vCaseStorage[0];
+  m_pTopInside = m_pBotInside + iPlaneSize;
+  pCellIndex   = m_pTopInside + iPlaneSize;
+
+  pTBotData  = pTVolume;
+  pTTopData  = pTVolume+DATA_INDEX(0, 0, 1, vVolSize.x, vVolSize.y);
+  Classify(pTBotData, m_pBotInside);
+  Classify(pTTopData, m_pTopInside);
 }
 
 template <class T> void LayerTempData<T>::NextIteration() {
+  const size_t iPlaneSize = size_t(m_vVolSize.x) * size_t(m_vVolSize.y);
+
   // update the layer for this iteration
   pTBotData = pTTopData;
   // now topData points to next layer of scalar data
   pTTopData += DATA_INDEX(0, 0, 1, m_vVolSize.x, m_vVolSize.y);
-  // percolate the last layer's top edges to this layer's bottom edges
-  for (int iY = 0; iY < m_vVolSize.y-1; iY++) {
-    for (int iX = 0; iX < m_vVolSize.x-1; iX++) {
-      for (int iEdges = 0; iEdges < 4; iEdges++) {
-        piEdges[EDGE_INDEX(iEdges, iX, iY, m_vVolSize.x-1)] =  piEdges[EDGE_INDEX(iEdges+4, iX, iY, m_vVolSize.x-1)];
-      }
-      // reinitialize all of the remaining edges
-      for (int iEdges = 4; iEdges < 12; iEdges++) {
-        piEdges[EDGE_INDEX(iEdges, iX, iY, m_vVolSize.x-1)] = NO_EDGE;
-      }
-    }
+
+  // last layer's top plane becomes this layer's bottom plane, both its
+  // edges and its classification
+  std::swap(piBotXEdges, piTopXEdges);
+  std::swap(piBotYEdges, piTopYEdges);
+  std::fill(piTopXEdges, piTopXEdges + iPlaneSize, NO_EDGE);
+  std::fill(piTopYEdges, piTopYEdges + iPlaneSize, NO_EDGE);
+  std::fill(piZEdges, piZEdges + iPlaneSize, NO_EDGE);
+
+  std::swap(m_pBotInside, m_pTopInside);
+  Classify(pTTopData, m_pTopInside);
+}
+
+template <class T> void LayerTempData<T>::Classify(const T* pTData, unsigned char* pInside) const {
+  // a simple loop over a whole plane, which compilers vectorize
+  const size_t iPlaneSize = size_t(m_vVolSize.x) * size_t(m_vVolSize.y);
+  const T TIsoValue = m_TIsoValue;
+  for (size_t i = 0; i < iPlaneSize; i++) {
+    pInside[i] = static_cast<unsigned char>(pTData[i] < TIsoValue);
+  }
+}
+
+template <class T> void LayerTempData<T>::ClassifyRow(int j, int iFirst, int iEnd) {
+  // combine the classes of the eight corners into the case table index;
+  // corners are numbered as in the table at the top of this file
+  const unsigned char* pBotFront = m_pBotInside + size_t(j)*m_vVolSize.x;
+  const unsigned char* pBotBack  = pBotFront + m_vVolSize.x;
+  const unsigned char* pTopFront = m_pTopInside + size_t(j)*m_vVolSize.x;
+  const unsigned char* pTopBack  = pTopFront + m_vVolSize.x;
+  unsigned char* pIndex = pCellIndex;
+  for (int i = iFirst; i < iEnd; i++) {
+    pIndex[i] = static_cast<unsigned char>(
+                    pBotBack[i]          | (pBotBack[i+1]  << 1) |
+                   (pBotFront[i+1] << 2) | (pBotFront[i]   << 3) |
+                   (pTopBack[i]    << 4) | (pTopBack[i+1]  << 5) |
+                   (pTopFront[i+1] << 6) | (pTopFront[i]   << 7));
   }
 }
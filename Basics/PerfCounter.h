@@ -20,6 +20,9 @@ enum PerfCounter {
         PERF_DY_GET_BRICK,       // overall operation of GetBrick call for dynamic bricked datasets (milliseconds)
           PERF_DY_CACHE_LOOKUPS, // cache look ups (counter)
           PERF_DY_CACHE_LOOKUP,  // looking up/copying from cache (milliseconds)
+          PERF_DY_CACHE_HITS,    // cache look ups which found the brick (counter)
+          PERF_DY_CACHE_MISSES,  // cache look ups which did not (counter)
+          PERF_DY_CACHE_EVICTS,  // bricks evicted from the cache (counter)
           PERF_DY_RESERVE_BRICK, // aquire brick memory
           PERF_DY_LOAD_BRICK,    // load (GetBrick) brick from the underlying dataset (milliseconds)
           PERF_DY_CACHE_ADDS,    // cache adds (counter)
@@ -36,6 +39,7 @@ enum PerfCounter {
   PERF_EO_BRICKS,        // number of bricks read/processed (counter)
   PERF_EO_DISK_READ,     // reading bricks from disk (milliseconds)
   PERF_EO_DECOMPRESSION, // decompressing brick data (milliseconds)
+  PERF_EO_PREFETCH_HITS, // bricks served from the read-ahead queue (counter)
 
   PERF_MM_PRECOMPUTE,    // computing min/max for new bricks (milliseconds)
   PERF_SOMETHING,        // ad hoc, always changing (milliseconds)
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include "PerfStats.h"
+
+namespace tuvok
+{
+  // histogram layout, see PerfStat
+  static const unsigned SUB_BITS = 3;
+  static const uint64_t SUB_BINS = 1 << SUB_BITS;
+  static const size_t BINS = size_t((64 - SUB_BITS + 1) * SUB_BINS);
+
+  static size_t Bin(double value) {
+    const double scaled = value * 1000.0;
+    if(!(scaled >= 1.0)) { return 0; } // also catches NaN
+    if(scaled >= 18446744073709551615.0) { return BINS-1; }
+    const uint64_t u = uint64_t(scaled);
+    if(u < SUB_BINS) { return size_t(u); }
+    int e;
+    std::frexp(double(u), &e);
+    --e; // floor(log2(u)), unless the conversion rounded up
+    if(e > 63 || (u >> e) == 0) { --e; }
+    const uint64_t sub = (u >> (e - SUB_BITS)) & (SUB_BINS-1);
+    return size_t((e - SUB_BITS + 1) * SUB_BINS + sub);
+  }
+
+  // lower bound and width of a bin, in thousandths
+  static void BinRange(size_t bin, double& low, double& width) {
+    if(bin < SUB_BINS) {
+      low = double(bin);
+      width = 1.0;
+      return;
+    }
+    const unsigned shift = unsigned(bin / SUB_BINS) - 1;
+    width = std::ldexp(1.0, int(shift));
+    low = double(SUB_BINS + bin % SUB_BINS) * width;
+  }
+
+  PerfStat::PerfStat() : count(0), sum(0.0), max(0.0), bins(BINS, 0) {}
+
+  double PerfStat::Quantile(double q) const {
+    if(count == 0) { return 0.0; }
+    const uint64_t rank = std::max<uint64_t>(1,
+      uint64_t(std::ceil(std::min(std::max(q, 0.0), 1.0) * double(count))));
+    uint64_t seen = 0;
+    for(size_t b=0; b < bins.size(); ++b) {
+      seen += bins[b];
+      if(seen >= rank) {
+        double low, width;
+        BinRange(b, low, width);
+        return std::min((low + width/2.0) / 1000.0, max);
+      }
+    }
+    return max;
+  }
+
+  PerfSnapshot PerfSnapshot::Since(const PerfSnapshot& earlier) const {
+    PerfSnapshot d;
+    for(size_t c=0; c < PERF_END; ++c) {
+      const PerfStat& now = stats[c];
+      const PerfStat& then = earlier.stats[c];
+      PerfStat& s = d.stats[c];
+      s.count = now.count - then.count;
+      s.sum = now.sum - then.sum;
+      for(size_t b=0; b < BINS; ++b) {
+        s.bins[b] = now.bins[b] - then.bins[b];
+        if(s.bins[b] != 0) {
+          double low, width;
+          BinRange(b, low, width);
+          s.max = std::min((low + width) / 1000.0, now.max);
+        }
+      }
+    }
+    return d;
+  }
+
+  std::string PerfSnapshot::Report() const {
+    std::ostringstream report;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-40s %10s %14s %12s %12s %12s %12s\n",
+                  "counter", "records", "sum", "mean", "p50", "p99", "max");
+    report << line;
+    for(size_t c=0; c < PERF_END; ++c) {
+      const PerfStat& s = stats[c];
+      if(s.count == 0) { continue; }
+      const PerfCounter pc = PerfCounter(c);
+      std::string name;
+      for(PerfCounter p = PerfCounterParent(pc); p != PERF_END;
+          p = PerfCounterParent(p)) {
+        name += "  ";
+      }
+      name += PerfCounterName(pc);
+      const std::string unit = PerfCounterUnit(pc);
+      if(!unit.empty()) { name += " (" + unit + ")"; }
+      std::snprintf(line, sizeof(line),
+                    "%-40s %10llu %14.3f %12.4f %12.4f %12.4f %12.4f\n",
+                    name.c_str(), static_cast<unsigned long long>(s.count),
+                    s.sum, s.Mean(), s.Quantile(0.5), s.Quantile(0.99),
+                    s.max);
+      report << line;
+    }
+    return report.str();
+  }
+
+  /// One thread's share of the counters.  Only the owning thread writes, so
+  /// plain loads and stores suffice; they are atomic merely so that
+  /// snapshots may read concurrently.
+  struct PerfStats::Slot {
+    struct Counter {
+      std::atomic<uint64_t> count;
+      std::atomic<double> sum;
+      std::atomic<double> max;
+      std::atomic<uint64_t> bins[BINS];
+    };
+    Slot() {
+      for(size_t c=0; c < PERF_END; ++c) {
+        counters[c].count.store(0, std::memory_order_relaxed);
+        counters[c].sum.store(0.0, std::memory_order_relaxed);
+        counters[c].max.store(0.0, std::memory_order_relaxed);
+        for(size_t b=0; b < BINS; ++b) {
+          counters[c].bins[b].store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+    Counter counters[PERF_END];
+  };
+
+  /// Gives the slot of an ending thread back.
+  struct SlotHandle {
+    SlotHandle() : slot(NULL) {}
+    ~SlotHandle() { if(slot) { PerfStats::Instance().ReleaseSlot(slot); } }
+    PerfStats::Slot* slot;
+  };
+
+  PerfStats& PerfStats::Instance() {
+    // never destroyed: threads may still record while statics go away
+    static PerfStats* stats = new PerfStats();
+    return *stats;
+  }
+
+  PerfStats::Slot* PerfStats::AcquireSlot() {
+    SCOPEDLOCK(m_Guard);
+    if(!m_vFree.empty()) {
+      Slot* s = m_vFree.back();
+      m_vFree.pop_back();
+      return s;
+    }
+    m_vSlots.push_back(new Slot());
+    return m_vSlots.back();
+  }
+
+  void PerfStats::ReleaseSlot(Slot* s) {
+    SCOPEDLOCK(m_Guard);
+    m_vFree.push_back(s);
+  }
+
+  void PerfStats::Record(enum PerfCounter pc, double value) {
+    assert(pc < PERF_END);
+    static thread_local SlotHandle handle;
+    if(!handle.slot) { handle.slot = AcquireSlot(); }
+
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    Slot::Counter& c = handle.slot->counters[pc];
+    c.count.store(c.count.load(relaxed) + 1, relaxed);
+    c.sum.store(c.sum.load(relaxed) + value, relaxed);
+    if(value > c.max.load(relaxed)) { c.max.store(value, relaxed); }
+    std::atomic<uint64_t>& bin = c.bins[Bin(value)];
+    bin.store(bin.load(relaxed) + 1, relaxed);
+  }
+
+  double PerfStats::Sum(enum PerfCounter pc) const {
+    assert(pc < PERF_END);
+    SCOPEDLOCK(m_Guard);
+    double sum = 0.0;
+    for(auto s = m_vSlots.cbegin(); s != m_vSlots.cend(); ++s) {
+      sum += (*s)->counters[pc].sum.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  PerfSnapshot PerfStats::Snapshot() const {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    PerfSnapshot snap;
+    SCOPEDLOCK(m_Guard);
+    for(auto s = m_vSlots.cbegin(); s != m_vSlots.cend(); ++s) {
+      for(size_t c=0; c < PERF_END; ++c) {
+        const Slot::Counter& from = (*s)->counters[c];
+        PerfStat& to = snap.stats[c];
+        to.count += from.count.load(relaxed);
+        to.sum += from.sum.load(relaxed);
+        to.max = std::max(to.max, from.max.load(relaxed));
+        for(size_t b=0; b < BINS; ++b) {
+          to.bins[b] += from.bins[b].load(relaxed);
+        }
+      }
+    }
+    return snap;
+  }
+
+  namespace {
+    struct CounterInfo {
+      const char* name;
+      PerfCounter parent;
+      const char* unit;
+    };
+#define TUVOK_PERF(pc, parent, unit) { #pc, parent, unit }
+    // must list every counter, in the order of the enum
+    const CounterInfo counterInfo[] = {
+      TUVOK_PERF(PERF_SUBFRAMES, PERF_END, ""),
+      TUVOK_PERF(PERF_RENDER, PERF_END, "ms"),
+      TUVOK_PERF(PERF_RAYCAST, PERF_RENDER, "ms"),
+      TUVOK_PERF(PERF_READ_HTABLE, PERF_RENDER, "ms"),
+      TUVOK_PERF(PERF_CONDENSE_HTABLE, PERF_RENDER, "ms"),
+      TUVOK_PERF(PERF_SORT_HTABLE, PERF_RENDER, "ms"),
+      TUVOK_PERF(PERF_UPLOAD_BRICKS, PERF_RENDER, "ms"),
+      TUVOK_PERF(PERF_POOL_SORT, PERF_UPLOAD_BRICKS, "ms"),
+      TUVOK_PERF(PERF_POOL_UPLOADED_MEM, PERF_UPLOAD_BRICKS, "bytes"),
+      TUVOK_PERF(PERF_POOL_GET_BRICK, PERF_UPLOAD_BRICKS, "ms"),
+      TUVOK_PERF(PERF_DY_GET_BRICK, PERF_POOL_GET_BRICK, "ms"),
+      TUVOK_PERF(PERF_DY_CACHE_LOOKUPS, PERF_DY_GET_BRICK, ""),
+      TUVOK_PERF(PERF_DY_CACHE_LOOKUP, PERF_DY_GET_BRICK, "ms"),
+      TUVOK_PERF(PERF_DY_CACHE_HITS, PERF_DY_GET_BRICK, ""),
+      TUVOK_PERF(PERF_DY_CACHE_MISSES, PERF_DY_GET_BRICK, ""),
+      TUVOK_PERF(PERF_DY_CACHE_EVICTS, PERF_DY_GET_BRICK, ""),
+      TUVOK_PERF(PERF_DY_RESERVE_BRICK, PERF_DY_GET_BRICK, "ms"),
+      TUVOK_PERF(PERF_DY_LOAD_BRICK, PERF_DY_GET_BRICK, "ms"),
+      TUVOK_PERF(PERF_DY_CACHE_ADDS, PERF_DY_GET_BRICK, ""),
+      TUVOK_PERF(PERF_DY_CACHE_ADD, PERF_DY_GET_BRICK, "ms"),
+      TUVOK_PERF(PERF_DY_BRICK_COPIED, PERF_DY_GET_BRICK, ""),
+      TUVOK_PERF(PERF_DY_BRICK_COPY, PERF_DY_GET_BRICK, "ms"),
+      TUVOK_PERF(PERF_POOL_UPLOAD_BRICK, PERF_UPLOAD_BRICKS, "ms"),
+      TUVOK_PERF(PERF_POOL_UPLOAD_TEXEL, PERF_POOL_UPLOAD_BRICK, "ms"),
+      TUVOK_PERF(PERF_POOL_UPLOAD_METADATA, PERF_UPLOAD_BRICKS, "ms"),
+      // these sit below either PERF_DY_LOAD_BRICK or PERF_POOL_GET_BRICK,
+      // depending on the dataset, so they stay at the top
+      TUVOK_PERF(PERF_EO_BRICKS, PERF_END, ""),
+      TUVOK_PERF(PERF_EO_DISK_READ, PERF_END, "ms"),
+      TUVOK_PERF(PERF_EO_DECOMPRESSION, PERF_END, "ms"),
+      TUVOK_PERF(PERF_EO_PREFETCH_HITS, PERF_END, ""),
+      TUVOK_PERF(PERF_MM_PRECOMPUTE, PERF_END, "ms"),
+      TUVOK_PERF(PERF_SOMETHING, PERF_END, "ms"),
+    };
+#undef TUVOK_PERF
+    static_assert(sizeof(counterInfo)/sizeof(counterInfo[0]) == PERF_END,
+                  "every PerfCounter needs an entry in counterInfo");
+  }
+
+  const char* PerfCounterName(enum PerfCounter pc) {
+    assert(pc < PERF_END);
+    return counterInfo[pc].name;
+  }
+  enum PerfCounter PerfCounterParent(enum PerfCounter pc) {
+    assert(pc < PERF_END);
+    return counterInfo[pc].parent;
+  }
+  const char* PerfCounterUnit(enum PerfCounter pc) {
+    assert(pc < PERF_END);
+    return counterInfo[pc].unit;
+  }
+}
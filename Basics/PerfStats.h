@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef TUVOK_PERFSTATS_H
+#define TUVOK_PERFSTATS_H
+
+#include "StdDefines.h"
+#include <string>
+#include <vector>
+#include "PerfCounter.h"
+#include "Threads.h"
+
+namespace tuvok
+{
+  /// Everything recorded for one PerfCounter: the number of records, their
+  /// sum and a histogram of the values.  The histogram works in thousandths
+  /// of the counter's unit (microseconds for timers); it is exact below 8
+  /// and has eight bins per power of two above, so quantiles are off by at
+  /// most 1/16 of their value.
+  struct PerfStat {
+    PerfStat();
+
+    /// @returns the value below which a fraction 'q' of the records lie
+    double Quantile(double q) const;
+    double Mean() const { return count ? sum / double(count) : 0.0; }
+
+    uint64_t count;
+    double sum;
+    double max;
+    std::vector<uint64_t> bins;
+  };
+
+  /// The state of all counters at one point in time.
+  struct PerfSnapshot {
+    /// @returns what was recorded between 'earlier' and this snapshot.  The
+    /// maximum is estimated from the histogram.
+    PerfSnapshot Since(const PerfSnapshot& earlier) const;
+
+    /// @returns a table of all counters which saw records, indented along
+    /// the counter hierarchy
+    std::string Report() const;
+
+    PerfStat stats[PERF_END];
+  };
+
+  /// Process wide store behind IncrementPerfCounter and StackTimer.
+  ///
+  /// Every thread records into a slot of its own, without locks or atomic
+  /// read-modify-write operations.  Slots are handed to the next new thread
+  /// when their thread ends, so their contents are never lost.  Reading
+  /// sums up all slots and leaves them alone, so any number of consumers
+  /// may watch the counters.
+  class PerfStats {
+  public:
+    static PerfStats& Instance();
+
+    /// Adds one record of 'value' to counter 'pc'.
+    void Record(enum PerfCounter pc, double value);
+
+    /// @returns the sum of all records of 'pc' so far
+    double Sum(enum PerfCounter pc) const;
+    PerfSnapshot Snapshot() const;
+
+  private:
+    struct Slot;
+    friend struct SlotHandle;
+
+    PerfStats() {}
+    Slot* AcquireSlot();
+    void ReleaseSlot(Slot*);
+
+    mutable CriticalSection m_Guard;
+    std::vector<Slot*> m_vSlots;
+    std::vector<Slot*> m_vFree;
+  };
+
+  /// @returns the enumerator's name, e.g. "PERF_EO_DISK_READ"
+  const char* PerfCounterName(enum PerfCounter pc);
+  /// @returns the counter 'pc' is nested in, as sketched by the indentation
+  /// in PerfCounter.h, or PERF_END for top level counters
+  enum PerfCounter PerfCounterParent(enum PerfCounter pc);
+  /// @returns "ms", "bytes" or "" for plain counts
+  const char* PerfCounterUnit(enum PerfCounter pc);
+}
+
+#endif // TUVOK_PERFSTATS_H
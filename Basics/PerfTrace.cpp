@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "PerfTrace.h"
+#include "PerfStats.h"
+#include "Threads.h"
+
+namespace tuvok
+{
+  std::atomic<bool> PerfTrace::s_bEnabled(false);
+
+  struct PerfTrace::Buffer {
+    explicit Buffer(size_t n) : events(n), written(0), first(0) {}
+    std::vector<Event> events;
+    std::atomic<uint64_t> written; ///< events ever added, by the owner
+    std::atomic<uint64_t> first;   ///< first event of the current trace
+  };
+
+  struct PerfTrace::Registry {
+    Registry() : capacity(1 << 16) {}
+    CriticalSection guard;
+    std::vector<Buffer*> all;
+    std::vector<Buffer*> free;
+    size_t capacity;
+  };
+
+  /// The calling thread's buffer, given back when the thread ends.
+  struct TraceHandle {
+    TraceHandle() : buffer(NULL) {
+      static std::atomic<uint32_t> next(1);
+      tid = next.fetch_add(1, std::memory_order_relaxed);
+    }
+    ~TraceHandle() { if(buffer) { PerfTrace::ReleaseBuffer(buffer); } }
+    PerfTrace::Buffer* buffer;
+    uint32_t tid;
+  };
+
+  static double Now() {
+    typedef std::chrono::steady_clock clock;
+    static const clock::time_point origin = clock::now();
+    return std::chrono::duration<double, std::micro>(clock::now() -
+                                                     origin).count();
+  }
+
+  PerfTrace::Registry& PerfTrace::GetRegistry() {
+    // never destroyed: threads may still trace while statics go away
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  PerfTrace::Buffer* PerfTrace::AcquireBuffer() {
+    Registry& r = GetRegistry();
+    SCOPEDLOCK(r.guard);
+    if(!r.free.empty()) {
+      Buffer* b = r.free.back();
+      r.free.pop_back();
+      return b;
+    }
+    r.all.push_back(new Buffer(r.capacity));
+    return r.all.back();
+  }
+
+  void PerfTrace::ReleaseBuffer(Buffer* b) {
+    Registry& r = GetRegistry();
+    SCOPEDLOCK(r.guard);
+    r.free.push_back(b);
+  }
+
+  void PerfTrace::Enable(size_t eventsPerThread) {
+    Registry& r = GetRegistry();
+    SCOPEDLOCK(r.guard);
+    r.capacity = std::max<size_t>(eventsPerThread, 2);
+    for(auto b = r.all.begin(); b != r.all.end(); ++b) {
+      (*b)->first.store((*b)->written.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    }
+    s_bEnabled.store(true, std::memory_order_relaxed);
+  }
+
+  void PerfTrace::Disable() {
+    s_bEnabled.store(false, std::memory_order_relaxed);
+  }
+
+  void PerfTrace::Add(enum PerfCounter pc, char phase, int64_t arg) {
+    static thread_local TraceHandle handle;
+    if(!handle.buffer) { handle.buffer = AcquireBuffer(); }
+
+    Buffer& b = *handle.buffer;
+    const uint64_t w = b.written.load(std::memory_order_relaxed);
+    Event& e = b.events[size_t(w % b.events.size())];
+    e.ts = Now();
+    e.arg = arg;
+    e.tid = handle.tid;
+    e.counter = uint16_t(pc);
+    e.phase = phase;
+    b.written.store(w+1, std::memory_order_release);
+  }
+
+  void PerfTrace::Begin(enum PerfCounter pc, int64_t arg) {
+    Add(pc, 'B', arg);
+  }
+  void PerfTrace::End(enum PerfCounter pc) {
+    Add(pc, 'E', -1);
+  }
+
+  bool PerfTrace::WriteChromeTrace(const std::string& filename) {
+    Disable();
+    std::ofstream json(filename.c_str(), std::ios::out | std::ios::trunc);
+    if(!json) { return false; }
+
+    json << "{\"traceEvents\":[\n";
+    bool firstEvent = true;
+    char line[256];
+    Registry& r = GetRegistry();
+    SCOPEDLOCK(r.guard);
+    for(auto buf = r.all.cbegin(); buf != r.all.cend(); ++buf) {
+      const Buffer& b = **buf;
+      // Scopes which were open when tracing stopped still add their end
+      // events; leave the oldest few slots alone so they cannot overwrite
+      // what we are reading.
+      const uint64_t size = b.events.size();
+      const uint64_t margin = std::min<uint64_t>(64, size/2);
+      const uint64_t w = b.written.load(std::memory_order_acquire);
+      const uint64_t from = std::max(b.first.load(std::memory_order_relaxed),
+                                     w > size-margin ? w-(size-margin) : 0);
+      for(uint64_t i=from; i < w; ++i) {
+        const Event& e = b.events[size_t(i % size)];
+        const int n = std::snprintf(line, sizeof(line),
+          "%s{\"name\":\"%s\",\"cat\":\"tuvok\",\"ph\":\"%c\",\"ts\":%.3f,"
+          "\"pid\":0,\"tid\":%u", firstEvent ? "" : ",\n",
+          PerfCounterName(PerfCounter(e.counter)), e.phase, e.ts,
+          static_cast<unsigned>(e.tid));
+        if(e.arg >= 0) {
+          std::snprintf(line+n, sizeof(line)-n, ",\"args\":{\"arg\":%lld}",
+                        static_cast<long long>(e.arg));
+        }
+        json << line << "}";
+        firstEvent = false;
+      }
+    }
+    json << "\n]}\n";
+    return bool(json);
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef TUVOK_PERFTRACE_H
+#define TUVOK_PERFTRACE_H
+
+#include "StdDefines.h"
+#include <atomic>
+#include <string>
+#include "PerfCounter.h"
+
+namespace tuvok
+{
+  /// Optional timeline of StackTimer scopes.
+  ///
+  /// While enabled, every StackTimer adds a begin and an end event, with
+  /// the thread and an optional argument such as a brick index, to a ring
+  /// buffer of the calling thread; the oldest events are overwritten once
+  /// a buffer is full.  WriteChromeTrace dumps the buffers in the Chrome
+  /// trace-event format, for chrome://tracing or Perfetto.  While disabled
+  /// a scope costs a single relaxed load.
+  class PerfTrace {
+  public:
+    /// Starts recording, dropping whatever was recorded before.
+    /// @param eventsPerThread size of each thread's ring buffer; buffers
+    ///        which already exist keep their size
+    static void Enable(size_t eventsPerThread = 1 << 16);
+    static void Disable();
+    static bool Enabled() {
+      return s_bEnabled.load(std::memory_order_relaxed);
+    }
+
+    /// Adds a begin/end event for counter 'pc' of the calling thread.
+    /// 'arg' is shown with the event unless it is negative.
+    ///@{
+    static void Begin(enum PerfCounter pc, int64_t arg = -1);
+    static void End(enum PerfCounter pc);
+    ///@}
+
+    /// Disables tracing and writes all events as JSON to 'filename'.
+    /// @returns false if the file could not be written
+    static bool WriteChromeTrace(const std::string& filename);
+
+  private:
+    struct Event {
+      double ts;       ///< microseconds since the first event of the process
+      int64_t arg;
+      uint32_t tid;
+      uint16_t counter;
+      char phase;      ///< 'B' or 'E'
+    };
+    struct Buffer;
+    struct Registry;
+    friend struct TraceHandle;
+
+    static void Add(enum PerfCounter pc, char phase, int64_t arg);
+    static Registry& GetRegistry();
+    static Buffer* AcquireBuffer();
+    static void ReleaseBuffer(Buffer*);
+
+    static std::atomic<bool> s_bEnabled;
+  };
+}
+
+#endif // TUVOK_PERFTRACE_H
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <limits>
+#include <new>
+#include "PrefetchQueue.h"
+#include "nonstd.h"
+
+namespace tuvok
+{
+  // upper bound for a single coalesced read
+  static const uint64_t MAX_RUN_BYTES = 8<<20;
+
+  PrefetchQueue::PrefetchQueue(LargeRAWFile_ptr file, uint64_t stagingBytes,
+                               uint32_t threads, uint64_t maxGap) :
+    m_pFile(file),
+    m_iStagingBytes(stagingBytes),
+    m_iMaxGap(maxGap),
+    m_iReservedBytes(0),
+    m_iSerial(0),
+    m_bRunning(true)
+  {
+    threads = std::max<uint32_t>(threads, 1);
+    for(uint32_t i=0; i < threads; ++i) {
+      std::shared_ptr<LambdaThread> worker(new LambdaThread(
+        [this](bool const&, LambdaThread::Interface&) { this->Worker(); }
+      ));
+      m_Workers.push_back(worker);
+      worker->StartThread();
+    }
+  }
+
+  PrefetchQueue::~PrefetchQueue() {
+    {
+      SCOPEDLOCK(m_Guard);
+      m_bRunning = false;
+      m_Runs.clear();
+      m_WorkAvailable.WakeAll();
+      m_ReadFinished.WakeAll();
+    }
+    for(auto w = m_Workers.begin(); w != m_Workers.end(); ++w) {
+      (*w)->JoinThread();
+    }
+  }
+
+  static bool by_offset(const PrefetchQueue::Range& a,
+                        const PrefetchQueue::Range& b) {
+    return a.offset < b.offset;
+  }
+
+  void PrefetchQueue::Prefetch(std::vector<Range> ranges) {
+    std::sort(ranges.begin(), ranges.end(), by_offset);
+
+    std::vector<Run> runs;
+    {
+      SCOPEDLOCK(m_Guard);
+      if(!m_bRunning) { return; }
+      for(auto r = ranges.cbegin(); r != ranges.cend(); ++r) {
+        if(r->length == 0 || r->length > m_iStagingBytes ||
+           m_Entries.find(r->offset) != m_Entries.end()) {
+          continue;
+        }
+        if(m_iReservedBytes + r->length > m_iStagingBytes) {
+          Evict(r->length);
+          // everything else is in flight; what does not fit is not
+          // prefetched at all.
+          if(m_iReservedBytes + r->length > m_iStagingBytes) { break; }
+        }
+
+        Entry e;
+        e.length = r->length;
+        e.serial = m_iSerial++;
+        e.state = QUEUED;
+        m_Entries.insert(std::make_pair(r->offset, e));
+        m_iReservedBytes += r->length;
+
+        const uint64_t end = r->offset + r->length;
+        if(!runs.empty() &&
+           r->offset <= runs.back().offset + runs.back().length + m_iMaxGap &&
+           std::max(end, runs.back().offset + runs.back().length) -
+             runs.back().offset <= MAX_RUN_BYTES) {
+          Run& run = runs.back();
+          run.length = std::max(end, run.offset + run.length) - run.offset;
+          run.members.push_back(*r);
+        } else {
+          Run run;
+          run.offset = r->offset;
+          run.length = r->length;
+          run.members.push_back(*r);
+          runs.push_back(run);
+        }
+      }
+      for(auto run = runs.cbegin(); run != runs.cend(); ++run) {
+        m_Runs.push_back(*run);
+        m_WorkAvailable.WakeOne();
+      }
+    }
+
+    for(auto run = runs.cbegin(); run != runs.cend(); ++run) {
+      m_pFile->Hint(LargeRAWFile::WILLNEED, run->offset, run->length);
+    }
+  }
+
+  std::shared_ptr<const uint8_t> PrefetchQueue::Take(uint64_t offset,
+                                                     uint64_t length) {
+    SCOPEDLOCK(m_Guard);
+    auto e = m_Entries.find(offset);
+    while(e != m_Entries.end() && e->second.state == READING) {
+      m_ReadFinished.Wait(m_Guard);
+      e = m_Entries.find(offset);
+    }
+    if(e == m_Entries.end() || e->second.length != length) {
+      return std::shared_ptr<const uint8_t>();
+    }
+
+    // a QUEUED entry is cancelled here: the worker skips it, and the caller
+    // is better off reading it directly than waiting behind the queue.
+    std::shared_ptr<const uint8_t> data = e->second.data;
+    m_iReservedBytes -= e->second.length;
+    m_Entries.erase(e);
+    return data;
+  }
+
+  void PrefetchQueue::Clear() {
+    SCOPEDLOCK(m_Guard);
+    m_Runs.clear();
+    m_Entries.clear();
+    m_iReservedBytes = 0;
+    m_ReadFinished.WakeAll();
+  }
+
+  uint64_t PrefetchQueue::GetReservedBytes() const {
+    SCOPEDLOCK(m_Guard);
+    return m_iReservedBytes;
+  }
+
+  uint64_t PrefetchQueue::GetStagedBytes() const {
+    SCOPEDLOCK(m_Guard);
+    uint64_t bytes = 0;
+    for(auto e = m_Entries.cbegin(); e != m_Entries.cend(); ++e) {
+      if(e->second.state == READY) { bytes += e->second.length; }
+    }
+    return bytes;
+  }
+
+  // drops the oldest staged data until 'bytes' more fit.  Needs m_Guard.
+  void PrefetchQueue::Evict(uint64_t bytes) {
+    while(m_iReservedBytes + bytes > m_iStagingBytes) {
+      auto oldest = m_Entries.end();
+      for(auto e = m_Entries.begin(); e != m_Entries.end(); ++e) {
+        if(e->second.state == READY &&
+           (oldest == m_Entries.end() ||
+            e->second.serial < oldest->second.serial)) {
+          oldest = e;
+        }
+      }
+      if(oldest == m_Entries.end()) { return; }
+      m_iReservedBytes -= oldest->second.length;
+      m_Entries.erase(oldest);
+    }
+  }
+
+  void PrefetchQueue::Worker() {
+    for(;;) {
+      Run run;
+      std::vector<uint64_t> serials;
+      {
+        SCOPEDLOCK(m_Guard);
+        while(m_bRunning && m_Runs.empty()) {
+          m_WorkAvailable.Wait(m_Guard);
+        }
+        if(!m_bRunning) { return; }
+        run = m_Runs.front();
+        m_Runs.pop_front();
+
+        // members may have been taken or cleared since they were queued;
+        // shrink the read to whatever is still wanted.
+        std::vector<Range> members;
+        uint64_t begin = std::numeric_limits<uint64_t>::max();
+        uint64_t end = 0;
+        for(auto m = run.members.cbegin(); m != run.members.cend(); ++m) {
+          auto e = m_Entries.find(m->offset);
+          if(e == m_Entries.end() || e->second.state != QUEUED ||
+             e->second.length != m->length) {
+            continue;
+          }
+          e->second.state = READING;
+          members.push_back(*m);
+          serials.push_back(e->second.serial);
+          begin = std::min(begin, m->offset);
+          end = std::max(end, m->offset + m->length);
+        }
+        if(members.empty()) { continue; }
+        run.members = members;
+        run.offset = begin;
+        run.length = end - begin;
+      }
+
+      std::shared_ptr<uint8_t> buffer;
+      bool ok = false;
+      try {
+        buffer.reset(new uint8_t[size_t(run.length)],
+                     nonstd::DeleteArray<uint8_t>());
+        ok = m_pFile->ReadRAWAt(buffer.get(), run.length, run.offset) ==
+             run.length;
+      } catch(const std::bad_alloc&) {
+        ok = false;
+      }
+
+      SCOPEDLOCK(m_Guard);
+      for(size_t i=0; i < run.members.size(); ++i) {
+        const Range& m = run.members[i];
+        auto e = m_Entries.find(m.offset);
+        // cleared, and possibly queued again, while we were reading
+        if(e == m_Entries.end() || e->second.serial != serials[i]) {
+          continue;
+        }
+        if(ok) {
+          // aliases the run's buffer, which lives until all members are gone
+          e->second.data = std::shared_ptr<const uint8_t>(
+            buffer, buffer.get() + (m.offset - run.offset)
+          );
+          e->second.state = READY;
+        } else {
+          m_iReservedBytes -= e->second.length;
+          m_Entries.erase(e);
+        }
+      }
+      m_ReadFinished.WakeAll();
+    }
+  }
+}
+
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2012 Interactive Visualization and Data Analysis Group.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifndef TUVOK_PREFETCHQUEUE_H
+#define TUVOK_PREFETCHQUEUE_H
+
+#include "StdDefines.h"
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include "LargeRAWFile.h"
+#include "Threads.h"
+
+namespace tuvok
+{
+  /// Asynchronous read-ahead for a LargeRAWFile.
+  ///
+  /// Callers announce byte ranges they are going to read soon.  Ranges which
+  /// are close together in the file are coalesced into one larger read; a
+  /// few worker threads issue those reads with positional I/O and park the
+  /// data in a bounded staging area until Take() claims it.  Prefetching is
+  /// purely advisory: whatever does not fit into the staging area is dropped
+  /// and will simply be read synchronously by whoever needs it.
+  class PrefetchQueue {
+  public:
+    struct Range {
+      uint64_t offset;
+      uint64_t length;
+    };
+
+    /// @param file the file to read from; must stay open while we exist
+    /// @param stagingBytes upper bound for queued + staged data
+    /// @param threads number of concurrent reads
+    /// @param maxGap ranges this close together are read with one request
+    PrefetchQueue(LargeRAWFile_ptr file, uint64_t stagingBytes=64<<20,
+                  uint32_t threads=2, uint64_t maxGap=64<<10);
+    ~PrefetchQueue();
+
+    /// Queues the given ranges for reading.  Ranges already queued or
+    /// staged are ignored.
+    void Prefetch(std::vector<Range> ranges);
+
+    /// Claims the data for exactly the given range.  Waits if the range is
+    /// being read right now.
+    /// @returns an empty pointer if the range was not prefetched (or was
+    ///          dropped); the caller should read it itself then.
+    std::shared_ptr<const uint8_t> Take(uint64_t offset, uint64_t length);
+
+    /// Drops everything that is queued or staged.
+    void Clear();
+
+    /// @returns the number of bytes currently queued or staged.
+    uint64_t GetReservedBytes() const;
+    /// @returns the number of bytes which are read and wait for Take().
+    uint64_t GetStagedBytes() const;
+
+  private:
+    enum State { QUEUED, READING, READY };
+    struct Entry {
+      uint64_t length;
+      uint64_t serial; ///< age, for eviction
+      State state;
+      std::shared_ptr<const uint8_t> data;
+    };
+    struct Run {
+      uint64_t offset;
+      uint64_t length;
+      std::vector<Range> members;
+    };
+
+    void Worker();
+    void Evict(uint64_t bytes);
+
+    LargeRAWFile_ptr m_pFile;
+    const uint64_t m_iStagingBytes;
+    const uint64_t m_iMaxGap;
+
+    mutable CriticalSection m_Guard;
+    WaitCondition m_WorkAvailable;
+    WaitCondition m_ReadFinished;
+    std::deque<Run> m_Runs;
+    std::map<uint64_t, Entry> m_Entries; ///< keyed by offset
+    uint64_t m_iReservedBytes;
+    uint64_t m_iSerial;
+    bool m_bRunning;
+    std::vector<std::shared_ptr<LambdaThread>> m_Workers;
+
+    PrefetchQueue(PrefetchQueue const&);
+    PrefetchQueue& operator=(PrefetchQueue const&);
+  };
+}
+
+#endif // TUVOK_PREFETCHQUEUE_H
+
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2012 Interactive Visualization and Data Analysis Group.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -141,14 +141,20 @@ namespace tuvok
 			m_hThread = CreateThread(NULL, 0, StaticStartFunc, m_pStartData, NULL, 0);
 			if (m_hThread) return true;
 #else
-			m_bJoinable = false;
+			// joinable before the thread runs: a short thread may be done, and
+			// have cleared the flag again, before pthread_create returns
+			m_JoinMutex.Lock();
+			m_bJoinable = true;
+			m_JoinMutex.Unlock();
 			if (pthread_create(&m_hThread, NULL, StaticStartFunc, (void*)m_pStartData) == 0)
 			{
         m_bInitialized = true;
-				m_bJoinable = true;
 				pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 				return true;
 			}
+			m_JoinMutex.Lock();
+			m_bJoinable = false;
+			m_JoinMutex.Unlock();
 #endif
 		}
 		delete m_pStartData;
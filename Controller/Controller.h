@@ -66,21 +66,32 @@ namespace Controller {
   };
 }}
 
-#define T_ERROR(...)                                              \
-  do {                                                            \
-    tuvok::Controller::Debug::Out().Error(_func_, __VA_ARGS__);   \
-  } while(0)
-#define WARNING(...)                                              \
+// Disabled channels cost a branch; enabled ones are rate limited per call
+// site (see DebugRateLimit), except for errors.
+#define TUVOK_LOG(show, channel, fun, ...)                        \
   do {                                                            \
-    tuvok::Controller::Debug::Out().Warning(_func_, __VA_ARGS__); \
+    AbstrDebugOut& tuvokOut = tuvok::Controller::Debug::Out();    \
+    if(tuvokOut.show()) {                                         \
+      static DebugRateLimit tuvokLimit;                           \
+      if(tuvokLimit.Allow(tuvokOut, AbstrDebugOut::channel,       \
+                          _func_)) {                              \
+        tuvokOut.fun(_func_, __VA_ARGS__);                        \
+      }                                                           \
+    }                                                             \
   } while(0)
-#define MESSAGE(...)                                              \
-  do {                                                            \
-    tuvok::Controller::Debug::Out().Message(_func_, __VA_ARGS__); \
-  } while(0)
-#define OTHER(...)                                                \
+
+#define T_ERROR(...)                                              \
   do {                                                            \
-    tuvok::Controller::Debug::Out().Other(_func_, __VA_ARGS__);   \
+    AbstrDebugOut& tuvokOut = tuvok::Controller::Debug::Out();    \
+    if(tuvokOut.ShowErrors()) {                                   \
+      tuvokOut.Error(_func_, __VA_ARGS__);                        \
+    }                                                             \
   } while(0)
+#define WARNING(...) \
+  TUVOK_LOG(ShowWarnings, CHANNEL_WARNING, Warning, __VA_ARGS__)
+#define MESSAGE(...) \
+  TUVOK_LOG(ShowMessages, CHANNEL_MESSAGE, Message, __VA_ARGS__)
+#define OTHER(...) \
+  TUVOK_LOG(ShowOther, CHANNEL_OTHER, Other, __VA_ARGS__)
 
 #endif // TUVOK_CONTROLLER_H
@@ -38,6 +38,7 @@
 #include <sstream>
 #include <functional>
 #include "MasterController.h"
+#include "../Basics/PerfTrace.h"
 #include "../Basics/SystemInfo.h"
 #include "../Basics/SysTools.h"
 #include "../IO/IOManager.h"
@@ -87,7 +88,7 @@ MasterController::MasterController() :
   LuaScript()->cexec("provenance.enable", false);
 
   RState.BStrategy = RendererState::BS_SkipTwoLevels;
-  std::fill(m_Perf, m_Perf+PERF_END, 0.0);
+  std::fill(m_PerfQueried, m_PerfQueried+PERF_END, 0.0);
 }
 
 
@@ -304,14 +305,21 @@ unsigned MasterController::GetHTSize() const {
 
 double MasterController::PerfQuery(enum PerfCounter pc) {
   assert(pc < PERF_END);
-  double tmp = m_Perf[pc];
-  m_Perf[pc] = 0.0;
-  return tmp;
+  SCOPEDLOCK(m_PerfGuard);
+  const double sum = PerfStats::Instance().Sum(pc);
+  const double delta = sum - m_PerfQueried[pc];
+  m_PerfQueried[pc] = sum;
+  return delta;
 }
 void MasterController::IncrementPerfCounter(enum PerfCounter pc,
                                             double amount) {
-  assert(pc < PERF_END);
-  m_Perf[pc] += amount;
+  PerfStats::Instance().Record(pc, amount);
+}
+PerfSnapshot MasterController::PerfStatistics() const {
+  return PerfStats::Instance().Snapshot();
+}
+std::string MasterController::PerfReport() const {
+  return PerfStats::Instance().Snapshot().Report();
 }
 
 void MasterController::SetMaxGPUMem(uint64_t megs) {
@@ -343,34 +351,21 @@ void register_unsigned(lua_State* lua, const char* name, unsigned value) {
 
 void register_perf_enum(std::shared_ptr<LuaScripting>& ss) {
   lua_State* lua = ss->getLuaState();
-  register_unsigned(lua, "PERF_SUBFRAMES", PERF_SUBFRAMES);
-  register_unsigned(lua, "PERF_RENDER", PERF_RENDER);
-  register_unsigned(lua, "PERF_RAYCAST", PERF_RAYCAST);
-  register_unsigned(lua, "PERF_READ_HTABLE", PERF_READ_HTABLE);
-  register_unsigned(lua, "PERF_CONDENSE_HTABLE", PERF_CONDENSE_HTABLE);
-  register_unsigned(lua, "PERF_SORT_HTABLE", PERF_SORT_HTABLE);
-  register_unsigned(lua, "PERF_UPLOAD_BRICKS", PERF_UPLOAD_BRICKS);
-  register_unsigned(lua, "PERF_POOL_SORT", PERF_POOL_SORT);
-  register_unsigned(lua, "PERF_POOL_UPLOADED_MEM", PERF_POOL_UPLOADED_MEM);
-  register_unsigned(lua, "PERF_POOL_GET_BRICK", PERF_POOL_GET_BRICK);
-  register_unsigned(lua, "PERF_DY_GET_BRICK", PERF_DY_GET_BRICK);
-  register_unsigned(lua, "PERF_DY_CACHE_LOOKUPS", PERF_DY_CACHE_LOOKUPS);
-  register_unsigned(lua, "PERF_DY_CACHE_LOOKUP", PERF_DY_CACHE_LOOKUP);
-  register_unsigned(lua, "PERF_DY_RESERVE_BRICK", PERF_DY_RESERVE_BRICK);
-  register_unsigned(lua, "PERF_DY_LOAD_BRICK", PERF_DY_LOAD_BRICK);
-  register_unsigned(lua, "PERF_DY_CACHE_ADDS", PERF_DY_CACHE_ADDS);
-  register_unsigned(lua, "PERF_DY_CACHE_ADD", PERF_DY_CACHE_ADD);
-  register_unsigned(lua, "PERF_DY_BRICK_COPIED", PERF_DY_BRICK_COPIED);
-  register_unsigned(lua, "PERF_DY_BRICK_COPY", PERF_DY_BRICK_COPY);
-  register_unsigned(lua, "PERF_POOL_UPLOAD_BRICK", PERF_POOL_UPLOAD_BRICK);
-  register_unsigned(lua, "PERF_POOL_UPLOAD_TEXEL", PERF_POOL_UPLOAD_TEXEL);
-  register_unsigned(lua, "PERF_POOL_UPLOAD_METADATA", PERF_POOL_UPLOAD_METADATA);
-  register_unsigned(lua, "PERF_EO_BRICKS", PERF_EO_BRICKS);
-  register_unsigned(lua, "PERF_EO_DISK_READ", PERF_EO_DISK_READ);
-  register_unsigned(lua, "PERF_EO_DECOMPRESSION", PERF_EO_DECOMPRESSION);
-
-  register_unsigned(lua, "PERF_MM_PRECOMPUTE", PERF_MM_PRECOMPUTE);
-  register_unsigned(lua, "PERF_SOMETHING", PERF_SOMETHING);
+  for(unsigned pc=0; pc < PERF_END; ++pc) {
+    register_unsigned(lua, PerfCounterName(PerfCounter(pc)), pc);
+  }
+}
+
+namespace {
+  void perf_trace(bool enable) {
+    if(enable) { PerfTrace::Enable(); } else { PerfTrace::Disable(); }
+  }
+  bool perf_trace_write(const std::string& filename) {
+    return PerfTrace::WriteChromeTrace(filename);
+  }
+  void log_rate_limit(unsigned int perSecond) {
+    DebugRateLimit::SetMaxPerSecond(perSecond);
+  }
 }
 
 void MasterController::RegisterLuaCommands() {
@@ -502,6 +497,19 @@ void MasterController::RegisterLuaCommands() {
     &MasterController::PerfQuery, "tuvok.perf",
     "queries performance information.  meaning is query-specific.", false
   );
+  m_pMemReg->registerFunction(this,
+    &MasterController::PerfReport, "tuvok.perfReport",
+    "table of all performance counters with their p50/p99/max.", false
+  );
+  ss->registerFunction(&perf_trace, "tuvok.perfTrace",
+                       "starts (true) or stops (false) recording a timeline "
+                       "of all timed scopes.", false);
+  ss->registerFunction(&perf_trace_write, "tuvok.perfTraceWrite",
+                       "stops tracing and writes the timeline to the given "
+                       "file, in Chrome's trace-event JSON format.", false);
+  ss->registerFunction(&log_rate_limit, "tuvok.state.logRateLimit",
+                       "how many messages a single place in the code may log "
+                       "per second; 0 means no limit.  default: 50", false);
   ss->registerFunction(&SysTools::basename, "basename",
                        "basename for the given filename", false);
   ss->registerFunction(&SysTools::dirname, "dirname",
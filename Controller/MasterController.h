@@ -38,6 +38,8 @@
 #include <vector>
 
 #include "Basics/PerfCounter.h"
+#include "Basics/PerfStats.h"
+#include "Basics/Threads.h"
 #include "Basics/Vectors.h"
 #include "../DebugOut/MultiplexOut.h"
 #include "../DebugOut/ConsoleOut.h"
@@ -181,9 +183,14 @@ public:
   ///@}
 
   /// Performance query interface.  Each id is a separate performance metric.
-  /// @warning Querying a metric resets it!
+  /// @returns the sum recorded since the last PerfQuery of this metric; use
+  /// PerfStatistics to watch the counters without disturbing others.
   double PerfQuery(enum PerfCounter);
   void IncrementPerfCounter(enum PerfCounter, double amount);
+  /// @returns all counters, with their latency distributions
+  PerfSnapshot PerfStatistics() const;
+  /// @returns a table of all counters, see PerfSnapshot::Report
+  std::string PerfReport() const;
 
 private:
   /// Initializer; add all our builtin commands.
@@ -229,8 +236,9 @@ private:
   // The active renderer should point into a member of the renderer list.
   AbstrRenderer*   m_pActiveRenderer;
 
-  /// for PerfCounter tracking.
-  double m_Perf[PERF_END];
+  /// what PerfQuery reported last, for each counter
+  double m_PerfQueried[PERF_END];
+  CriticalSection m_PerfGuard;
 };
 
 }
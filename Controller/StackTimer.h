@@ -2,6 +2,8 @@
 #define TUVOK_STACK_TIMER_H
 
 #include "Basics/PerfCounter.h"
+#include "Basics/PerfStats.h"
+#include "Basics/PerfTrace.h"
 #include "Basics/Timer.h"
 #include "Controller.h"
 
@@ -15,14 +17,22 @@ namespace tuvok {
 ///     StackTimer task_identifier(PERF_DISK_READ);
 ///     this->Function();
 ///   }
+/// Each scope is one record of the counter, so its latency distribution is
+/// available from PerfStats.  While PerfTrace is enabled, the scope also
+/// shows up on the timeline, labelled with 'arg' (e.g. a brick index) if
+/// that is not negative.
 struct StackTimer {
-  StackTimer(enum PerfCounter pc) : counter(pc) {
+  StackTimer(enum PerfCounter pc, int64_t arg = -1) :
+    counter(pc), traced(PerfTrace::Enabled()) {
+    if(traced) { PerfTrace::Begin(pc, arg); }
     timer.Start();
   }
   ~StackTimer() {
-    Controller::Instance().IncrementPerfCounter(counter, timer.Elapsed());
+    PerfStats::Instance().Record(counter, timer.Elapsed());
+    if(traced) { PerfTrace::End(counter); }
   }
   enum PerfCounter counter;
+  bool traced;
   Timer timer;
 };
 
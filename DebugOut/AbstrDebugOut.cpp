@@ -34,9 +34,11 @@
   \date    January 2009
 */
 
+#include <chrono>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <vector>
 #include "AbstrDebugOut.h"
 
 const char *AbstrDebugOut::ChannelToString(enum DebugChannel c) const
@@ -65,70 +67,60 @@ bool AbstrDebugOut::Enabled(enum DebugChannel channel) const
   return true;
 }
 
+void AbstrDebugOut::Print(enum DebugChannel channel, const char* source,
+                          const char* format, va_list args)
+{
+  // most messages are short; only long ones pay for a heap buffer
+  char buff[1024];
+  va_list retry;
+  va_copy(retry, args);
+  const int len = vsnprintf(buff, sizeof(buff), format, args);
+  if(len < 0) {
+    va_end(retry);
+    return;
+  }
+  if(size_t(len) < sizeof(buff)) {
+    this->printf(channel, source, buff);
+  } else {
+    std::vector<char> big(size_t(len)+1);
+    vsnprintf(&big[0], big.size(), format, retry);
+    this->printf(channel, source, &big[0]);
+  }
+  va_end(retry);
+}
+
 void AbstrDebugOut::Other(const char *source, const char* format, ...)
 {
   if (!m_bShowOther) return;
-  char buff[16384];
-
   va_list args;
   va_start(args, format);
-#ifdef DETECTED_OS_WINDOWS
-  _vsnprintf_s(buff, 16384, sizeof(buff), format, args);
-#else
-  vsnprintf(buff, sizeof(buff), format, args);
-#endif
+  Print(CHANNEL_OTHER, source, format, args);
   va_end(args);
-
-  this->printf(CHANNEL_OTHER, source, buff);
 }
 
 void AbstrDebugOut::Message(const char* source, const char* format, ...)
 {
   if (!m_bShowMessages) return;
-  char buff[16384];
-
   va_list args;
   va_start(args, format);
-#ifdef DETECTED_OS_WINDOWS
-  _vsnprintf_s(buff, 16384, sizeof(buff), format, args);
-#else
-  vsnprintf(buff, sizeof(buff), format, args);
-#endif
+  Print(CHANNEL_MESSAGE, source, format, args);
   va_end(args);
-
-  this->printf(CHANNEL_MESSAGE, source, buff);
 }
 void AbstrDebugOut::Warning(const char* source, const char* format, ...)
 {
   if (!m_bShowWarnings) return;
-  char buff[16384];
-
   va_list args;
   va_start(args, format);
-#ifdef DETECTED_OS_WINDOWS
-  _vsnprintf_s(buff, 16384, sizeof(buff), format, args);
-#else
-  vsnprintf(buff, sizeof(buff), format, args);
-#endif
+  Print(CHANNEL_WARNING, source, format, args);
   va_end(args);
-
-  this->printf(CHANNEL_WARNING, source, buff);
 }
 void AbstrDebugOut::Error(const char* source, const char* format, ...)
 {
   if (!m_bShowErrors) return;
-  char buff[16384];
-
   va_list args;
   va_start(args, format);
-#ifdef DETECTED_OS_WINDOWS
-  _vsnprintf_s(buff, 16384, sizeof(buff), format, args);
-#else
-  vsnprintf(buff, sizeof(buff), format, args);
-#endif
+  Print(CHANNEL_ERROR, source, format, args);
   va_end(args);
-
-  this->printf(CHANNEL_ERROR, source, buff);
 }
 
 void AbstrDebugOut::PrintErrorList() {
@@ -214,3 +206,40 @@ void AbstrDebugOut::ReplaceSpecialChars(char* buff, size_t iSize) const {
   std::memcpy(buff, s.c_str(), iLength);
   buff[iLength] = 0;
 }
+
+std::atomic<uint32_t> DebugRateLimit::s_iMaxPerSecond(50);
+
+bool DebugRateLimit::Allow(AbstrDebugOut& out,
+                           enum AbstrDebugOut::DebugChannel channel,
+                           const char* source)
+{
+  const std::memory_order relaxed = std::memory_order_relaxed;
+  const uint32_t iMax = s_iMaxPerSecond.load(relaxed);
+  if(iMax == 0) { return true; }
+
+  // +1: zero marks a call site which never logged
+  using namespace std::chrono;
+  const uint64_t now = uint64_t(duration_cast<seconds>(
+    steady_clock::now().time_since_epoch()).count()) + 1;
+  uint64_t window = m_iWindow.load(relaxed);
+  if(window != now && m_iWindow.compare_exchange_strong(window, now, relaxed)) {
+    m_iCount.store(0, relaxed);
+    const uint32_t iLost = m_iSuppressed.exchange(0, relaxed);
+    if(iLost > 0) {
+      char note[64];
+      snprintf(note, sizeof(note), "(%u similar messages suppressed)", iLost);
+      out.printf(channel, source, note);
+    }
+  }
+  if(m_iCount.fetch_add(1, relaxed) < iMax) { return true; }
+  m_iSuppressed.fetch_add(1, relaxed);
+  return false;
+}
+
+void DebugRateLimit::SetMaxPerSecond(uint32_t iMax) {
+  s_iMaxPerSecond.store(iMax, std::memory_order_relaxed);
+}
+
+uint32_t DebugRateLimit::GetMaxPerSecond() {
+  return s_iMaxPerSecond.load(std::memory_order_relaxed);
+}
@@ -43,6 +43,7 @@
 
 #include "../StdTuvokDefines.h"
 #include <array>
+#include <atomic>
 #include <cstdarg>
 #include <deque>
 #include <string>
@@ -128,6 +129,35 @@ protected:
     std::array<std::deque<std::string>, CHANNEL_FINAL> m_strLists;
 
     void ReplaceSpecialChars(char* buff, size_t iSize) const;
+    /// formats the message and hands it to printf
+    void Print(enum DebugChannel, const char* source, const char* format,
+               va_list args);
+};
+
+/// Limits how often a single call site may log.
+///
+/// The logging macros keep one of these per call site.  Beyond the
+/// configured number of messages per second, further messages from that
+/// site are dropped; the next message which gets through is preceded by a
+/// note of how many were lost.
+class DebugRateLimit {
+  public:
+    DebugRateLimit() : m_iWindow(0), m_iCount(0), m_iSuppressed(0) {}
+
+    /// @returns true if the call site may log (to 'out', on 'channel') now.
+    bool Allow(AbstrDebugOut& out, enum AbstrDebugOut::DebugChannel channel,
+               const char* source);
+
+    /// Messages per second and call site; 0 disables limiting.
+    static void SetMaxPerSecond(uint32_t iMax);
+    static uint32_t GetMaxPerSecond();
+
+  private:
+    std::atomic<uint64_t> m_iWindow; ///< second the current count is for
+    std::atomic<uint32_t> m_iCount;
+    std::atomic<uint32_t> m_iSuppressed;
+
+    static std::atomic<uint32_t> s_iMaxPerSecond;
 };
 
 #endif // TUVOK_ABSTRDEBUGOUT_H
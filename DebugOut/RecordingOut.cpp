@@ -0,0 +1,31 @@
+#include "RecordingOut.h"
+
+RecordingOut::RecordingOut(const AbstrDebugOut& target) {
+  bool bShowErrors, bShowWarnings, bShowMessages, bShowOther;
+  target.GetOutput(bShowErrors, bShowWarnings, bShowMessages, bShowOther);
+  SetOutput(bShowErrors, bShowWarnings, bShowMessages, bShowOther);
+}
+
+void RecordingOut::printf(enum DebugChannel channel, const char* source,
+                          const char* msg)
+{
+  Entry e;
+  e.channel = channel;
+  e.source = source;
+  e.msg = msg;
+  m_vEntries.push_back(e);
+}
+
+// only used to print the error/warning/message lists; those are not kept
+void RecordingOut::printf(const char*) const {}
+
+void RecordingOut::Replay(AbstrDebugOut& target)
+{
+  for(size_t i=0; i < m_vEntries.size(); ++i) {
+    const Entry& e = m_vEntries[i];
+    if(target.Enabled(e.channel)) {
+      target.printf(e.channel, e.source.c_str(), e.msg.c_str());
+    }
+  }
+  m_vEntries.clear();
+}
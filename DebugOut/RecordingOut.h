@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef TUVOK_RECORDINGOUT_H
+#define TUVOK_RECORDINGOUT_H
+
+#include <string>
+#include <vector>
+#include "AbstrDebugOut.h"
+
+/// Keeps everything it is given, to be passed on later by Replay.  Lets
+/// worker threads produce log output which the thread that owns the real
+/// debug output reports afterwards, in a deterministic order.
+class RecordingOut : public AbstrDebugOut {
+  public:
+    /// Takes over which channels 'target' shows, so that nothing is
+    /// formatted only to be thrown away.
+    explicit RecordingOut(const AbstrDebugOut& target);
+
+    virtual void printf(enum DebugChannel, const char* source,
+                        const char* msg);
+    virtual void printf(const char *s) const;
+
+    /// Sends everything recorded so far to 'target' and forgets it.
+    void Replay(AbstrDebugOut& target);
+    bool empty() const { return m_vEntries.empty(); }
+
+  private:
+    struct Entry {
+      enum DebugChannel channel;
+      std::string source;
+      std::string msg;
+    };
+    std::vector<Entry> m_vEntries;
+};
+#endif // TUVOK_RECORDINGOUT_H
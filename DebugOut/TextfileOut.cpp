@@ -34,84 +34,165 @@
   \date    August 2008
 */
 
-#include <fstream>
-#include <stdarg.h>
+#include <cstdio>
 #ifdef WIN32
   #include <windows.h>
 #endif
 #include "TextfileOut.h"
-#include <ctime>
 
 using namespace std;
+using namespace tuvok;
+
+// beyond this many unwritten messages, new ones are dropped
+static const uint64_t MAX_PENDING = 1 << 16;
 
 TextfileOut::TextfileOut(std::string strFilename) :
-  m_strFilename(strFilename)
+  m_strFilename(strFilename),
+  m_Stream(strFilename.c_str(), ios_base::app),
+  m_pPending(NULL),
+  m_iQueued(0),
+  m_iDropped(0),
+  m_iWritten(0),
+  m_iFlushed(0),
+  m_bWriterIdle(false),
+  m_bRunning(true)
 {
+  m_pWriter.reset(new LambdaThread(
+    [this](bool const&, LambdaThread::Interface&) { this->Writer(); }
+  ));
+  m_pWriter->StartThread();
   this->Message(_func_, "Starting up");
 }
 
 TextfileOut::~TextfileOut() {
   this->Message(_func_, "Shutting down\n");
+  {
+    SCOPEDLOCK(m_Guard);
+    m_bRunning = false;
+    m_WorkAvailable.WakeOne();
+  }
+  m_pWriter->JoinThread();
 }
 
 void TextfileOut::printf(enum DebugChannel channel, const char* source,
                          const char* buff)
 {
-  time_t epoch_time;
-  time(&epoch_time);
+  Record* r = new Record;
+  time(&r->time);
+  r->channel = channel;
+  r->source = source;
+  r->msg = buff;
+  Push(r);
+}
 
-#undef ADDR_NOW
-#ifdef DETECTED_OS_WINDOWS
-  struct tm now;
-  localtime_s(&now, &epoch_time);
-#define ADDR_NOW (&now)
-#else
-  struct tm* now;
-  now = localtime(&epoch_time);
-#define ADDR_NOW (now)
-#endif
-  char datetime[64];
+void TextfileOut::printf(const char *s) const
+{
+  Record* r = new Record;
+  time(&r->time);
+  r->channel = CHANNEL_NONE;
+  r->msg = s;
+  Push(r);
+}
 
-  ofstream fs;
-  fs.open(m_strFilename.c_str(), ios_base::app);
-  if (fs.fail()) return;
+void TextfileOut::Push(Record* r) const
+{
+  const uint64_t queued = m_iQueued.load(memory_order_relaxed);
+  if(queued - m_iWritten.load(memory_order_relaxed) >= MAX_PENDING) {
+    m_iDropped.fetch_add(1, memory_order_relaxed);
+    delete r;
+    return;
+  }
+  m_iQueued.fetch_add(1, memory_order_relaxed);
+
+  r->next = m_pPending.load(memory_order_relaxed);
+  while(!m_pPending.compare_exchange_weak(r->next, r)) {}
+  // The writer publishes that it is going to sleep before it looks at the
+  // list a last time, so either it sees our record or we see it idle.
+  if(m_bWriterIdle.load()) {
+    SCOPEDLOCK(m_Guard);
+    m_WorkAvailable.WakeOne();
+  }
+}
 
-  if(strftime(datetime, 64, "(%d.%m.%Y %H:%M:%S)", ADDR_NOW) > 0) {
-    fs << datetime << " ";
+void TextfileOut::Flush() const
+{
+  // dropped messages never made it into m_iQueued, so they must not count
+  const uint64_t target = m_iQueued.load();
+  SCOPEDLOCK(m_Guard);
+  while(m_iFlushed < target && m_bRunning) {
+    m_WorkAvailable.WakeOne();
+    m_Drained.Wait(m_Guard, 100);
   }
-  fs << ChannelToString(channel) << " (" << source << ") " << buff << std::endl;
+}
 
-  fs.flush();
-  fs.close();
+void TextfileOut::Writer()
+{
+  uint64_t iDroppedReported = 0;
+  for(;;) {
+    Record* batch = m_pPending.exchange(NULL, memory_order_acquire);
+    if(batch == NULL) {
+      SCOPEDLOCK(m_Guard);
+      m_Stream.flush();
+      m_iFlushed = m_iWritten.load();
+      m_Drained.WakeAll();
+      if(!m_bRunning) { break; }
+      m_bWriterIdle.store(true);
+      if(m_pPending.load() == NULL) { m_WorkAvailable.Wait(m_Guard, 100); }
+      m_bWriterIdle.store(false);
+      continue;
+    }
+
+    // the list is newest first
+    Record* prev = NULL;
+    while(batch) {
+      Record* next = batch->next;
+      batch->next = prev;
+      prev = batch;
+      batch = next;
+    }
+    const uint64_t iDropped = m_iDropped.load(memory_order_relaxed);
+    if(iDropped != iDroppedReported) {
+      Record note;
+      time(&note.time);
+      note.channel = CHANNEL_WARNING;
+      note.source = _func_;
+      char msg[64];
+      snprintf(msg, sizeof(msg), "log writer fell behind, dropped %llu "
+               "messages", static_cast<unsigned long long>(iDropped -
+                                                          iDroppedReported));
+      note.msg = msg;
+      Write(note);
+      iDroppedReported = iDropped;
+    }
+    for(Record* r = prev; r != NULL; ) {
+      Write(*r);
+      Record* next = r->next;
+      delete r;
+      r = next;
+      m_iWritten.fetch_add(1, memory_order_relaxed);
+    }
+  }
 }
 
-void TextfileOut::printf(const char *s) const
+void TextfileOut::Write(const Record& r)
 {
-  time_t epoch_time;
-  time(&epoch_time);
+  if (!m_Stream) return;
 
-#undef ADDR_NOW
-#ifdef DETECTED_OS_WINDOWS
   struct tm now;
-  localtime_s(&now, &epoch_time);
-#define ADDR_NOW (&now)
+#ifdef DETECTED_OS_WINDOWS
+  localtime_s(&now, &r.time);
 #else
-  struct tm* now;
-  now = localtime(&epoch_time);
-#define ADDR_NOW (now)
+  localtime_r(&r.time, &now);
 #endif
   char datetime[64];
 
-  ofstream fs;
-  fs.open(m_strFilename.c_str(), ios_base::app);
-  if (fs.fail()) return;
-
-  if(strftime(datetime, 64, "(%d.%m.%Y %H:%M:%S)", ADDR_NOW) > 0) {
-    fs << datetime << " " << s << std::endl;
+  if(strftime(datetime, 64, "(%d.%m.%Y %H:%M:%S)", &now) > 0) {
+    m_Stream << datetime << " ";
+  }
+  if(r.channel == CHANNEL_NONE) {
+    m_Stream << r.msg << "\n";
   } else {
-    fs << s << std::endl;
+    m_Stream << ChannelToString(r.channel) << " (" << r.source << ") "
+             << r.msg << "\n";
   }
-
-  fs.flush();
-  fs.close();
 }
@@ -41,9 +41,20 @@
 #ifndef TUVOK_TEXTFILEOUT_H
 #define TUVOK_TEXTFILEOUT_H
 
+#include <atomic>
+#include <ctime>
+#include <fstream>
+#include <memory>
 #include <string>
 #include "AbstrDebugOut.h"
-
+#include "Basics/Threads.h"
+
+/// Appends messages to a log file.
+///
+/// Logging threads only push their message onto a lock-free list; a single
+/// writer thread drains that list into a file which stays open, and
+/// flushes it whenever it runs out of work.  Should the writer fall far
+/// behind, new messages are dropped (and counted) instead of piling up.
 class TextfileOut : public AbstrDebugOut {
   public:
     TextfileOut(std::string strFilename="logfile.txt");
@@ -52,16 +63,44 @@ class TextfileOut : public AbstrDebugOut {
                         const char* msg);
     virtual void printf(const char *s) const;
 
+    /// Waits until everything logged so far is written to the file.
+    void Flush() const;
+    /// Number of messages dropped because the writer fell behind.
+    uint64_t GetDroppedCount() const { return m_iDropped.load(); }
+
     const std::string& GetFileName() const {return m_strFilename;}
 
   private:
     TextfileOut(const TextfileOut &); ///< unimplemented.
 
+    struct Record {
+      Record* next;
+      time_t time;
+      enum DebugChannel channel; ///< CHANNEL_NONE: plain printf(s)
+      std::string source;
+      std::string msg;
+    };
+
+    void Push(Record* r) const;
+    void Writer();
+    void Write(const Record& r);
+
   private:
     std::string m_strFilename;
-
-    /// same as printf above but does regard m_bShowOther
-    void _printf(const char* format, ...) const;
+    std::ofstream m_Stream; ///< only touched by the writer thread
+
+    mutable std::atomic<Record*> m_pPending; ///< newest first
+    mutable std::atomic<uint64_t> m_iQueued;
+    mutable std::atomic<uint64_t> m_iDropped;
+    std::atomic<uint64_t> m_iWritten;
+    uint64_t m_iFlushed; ///< m_iWritten as of the last flush, m_Guard
+    std::atomic<bool> m_bWriterIdle;
+
+    mutable tuvok::CriticalSection m_Guard;
+    mutable tuvok::WaitCondition m_WorkAvailable;
+    mutable tuvok::WaitCondition m_Drained;
+    bool m_bRunning;
+    std::unique_ptr<tuvok::LambdaThread> m_pWriter;
 };
 
 #endif // TUVOK_TEXTFILEOUT_H
@@ -36,6 +36,7 @@
 #include <cctype>
 #include <vector>
 #include "AbstrGeoConverter.h"
+#include "Mesh.h"
 #include "SysTools.h"
 
 using namespace tuvok;
@@ -50,6 +51,52 @@ bool AbstrGeoConverter::ConvertToNative(const Mesh&,
   return false;
 }
 
+namespace {
+  /// collects all chunks and hands the complete mesh to ConvertToNative
+  class BufferedMeshWriter : public MeshWriter {
+  public:
+    BufferedMeshWriter(AbstrGeoConverter* conv, const std::string& strTarget,
+                       const std::string& strName,
+                       const FLOATVECTOR4& vColor) :
+      m_conv(conv), m_strTarget(strTarget), m_strName(strName),
+      m_vColor(vColor) {}
+
+    virtual bool AddChunk(const VertVec& vertices, const VertVec& normals,
+                          const IndexVec& triangles) {
+      m_vertices.insert(m_vertices.end(), vertices.begin(), vertices.end());
+      m_normals.insert(m_normals.end(), normals.begin(), normals.end());
+      m_indices.insert(m_indices.end(), triangles.begin(), triangles.end());
+      return true;
+    }
+
+    virtual bool Close() {
+      Mesh m(m_vertices, m_normals, TexCoordVec(), ColorVec(), m_indices,
+             m_indices, IndexVec(), IndexVec(), false, false, m_strName,
+             Mesh::MT_TRIANGLES);
+      m.SetDefaultColor(m_vColor);
+      return m_conv->ConvertToNative(m, m_strTarget);
+    }
+
+  private:
+    AbstrGeoConverter* m_conv;
+    std::string m_strTarget;
+    std::string m_strName;
+    FLOATVECTOR4 m_vColor;
+    VertVec m_vertices;
+    NormVec m_normals;
+    IndexVec m_indices;
+  };
+}
+
+std::shared_ptr<MeshWriter>
+AbstrGeoConverter::CreateMeshWriter(const std::string& strTargetFilename,
+                                    const std::string& strName,
+                                    const FLOATVECTOR4& vDefaultColor) {
+  return std::shared_ptr<MeshWriter>(
+    new BufferedMeshWriter(this, strTargetFilename, strName, vDefaultColor)
+  );
+}
+
 bool AbstrGeoConverter::CanRead(const std::string& fn) const
 {
   return SupportedExtension(SysTools::ToUpperCase(SysTools::GetExt(fn)));
@@ -49,6 +49,19 @@ typedef std::vector<FLOATVECTOR3> VertVec;
 typedef std::vector<uint32_t> IndexVec;
 class Mesh;
 
+/// Writes a triangle mesh piece by piece, so that meshes which do not fit
+/// into memory can be exported.  Triangle indices are global, i.e. they
+/// count the vertices of all chunks written so far, and may refer to
+/// vertices of earlier chunks.
+class MeshWriter {
+public:
+  virtual ~MeshWriter() {}
+  virtual bool AddChunk(const VertVec& vertices, const VertVec& normals,
+                        const IndexVec& triangles) = 0;
+  /// finishes the file; the writer must not be used afterwards
+  virtual bool Close() = 0;
+};
+
 class AbstrGeoConverter {
 public:
   virtual ~AbstrGeoConverter() {}
@@ -60,6 +73,14 @@ public:
   virtual bool ConvertToNative(const Mesh& m,
                                const std::string& strTargetFilename);
 
+  /// Starts a streaming export.  Converters which cannot write their
+  /// format incrementally get a writer which collects all chunks and calls
+  /// ConvertToNative on Close.
+  virtual std::shared_ptr<MeshWriter> CreateMeshWriter(
+    const std::string& strTargetFilename, const std::string& strName,
+    const FLOATVECTOR4& vDefaultColor
+  );
+
   /// @param filename the file in question
   /// @return SupportedExtension() for the file's extension
   virtual bool CanRead(const std::string& fn) const;
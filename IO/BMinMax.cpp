@@ -1,12 +1,23 @@
 #include <algorithm>
+#include <limits>
 #include "BMinMax.h"
 #include "Basics/MinMaxBlock.h"
 #include "BrickedDataset.h"
 #include "Controller/Controller.h"
+#include "DynamicBrickingDS.h"
 
 namespace {
   template<typename T> tuvok::MinMaxBlock mm(const tuvok::BrickKey& bk,
                                              const tuvok::BrickedDataset& ds) {
+    // rebricked data can give us a view into its cache: no need to copy the
+    // brick just to look at it.
+    const tuvok::DynamicBrickingDS* dyn =
+      dynamic_cast<const tuvok::DynamicBrickingDS*>(&ds);
+    tuvok::BrickView<T> view;
+    if(dyn && dyn->GetBrickView(bk, view)) {
+      return tuvok::minmax_view(view);
+    }
+
     std::vector<T> data(ds.GetMaxBrickSize().volume());
     ds.GetBrick(bk, data);
     auto mmax = std::minmax_element(data.begin(), data.end());
@@ -1,14 +1,30 @@
 #ifndef TUVOK_BMINMAX_H
 #define TUVOK_BMINMAX_H
 
+#include <algorithm>
+#include <limits>
 #include "Basics/MinMaxBlock.h"
 #include "Brick.h"
+#include "BrickView.h"
 
 namespace tuvok {
 class BrickedDataset;
 
 MinMaxBlock minmax_brick(const BrickKey& bk, const BrickedDataset& ds);
 
+/// scalar min/max of the voxels a view covers.  Gradients are left unknown.
+template<typename T> MinMaxBlock minmax_view(const BrickView<T>& view) {
+  T lo = std::numeric_limits<T>::max();
+  T hi = std::numeric_limits<T>::lowest();
+  view.for_each_scanline([&lo, &hi](const T* b, const T* e) {
+    if(b == e) { return; }
+    auto mmax = std::minmax_element(b, e);
+    lo = std::min(lo, *mmax.first);
+    hi = std::max(hi, *mmax.second);
+  });
+  return MinMaxBlock(lo, hi, DBL_MAX, -FLT_MAX);
+}
+
 }
 
 #endif
@@ -1,10 +1,13 @@
-#include <algorithm>
-#include <ctime>
+#include <atomic>
+#include <cassert>
 #include <functional>
-#include <map>
+#include <limits>
+#include <list>
 #include <memory>
+#include <unordered_map>
 #include "BrickCache.h"
-#include "Controller/StackTimer.h"
+#include "Basics/Threads.h"
+#include "Controller/Controller.h"
 
 namespace tuvok {
 
@@ -76,22 +79,32 @@ struct TypeErase {
   {}
 };
 
-struct BrickInfo {
+// One cached brick.  'stamp' is a global, monotonically increasing access
+// counter; it lets remove() compare recency across shards.
+struct CacheEntry {
   BrickKey key;
-  uint64_t access_time;
-  BrickInfo(const BrickKey& k, time_t t) : key(k),
-                                           access_time(uint64_t(t)) {}
+  TypeErase data;
+  size_t bytes;
+  uint64_t stamp;
+  CacheEntry(const BrickKey& k, TypeErase&& d, size_t b, uint64_t s) :
+    key(k), data(std::move(d)), bytes(b), stamp(s) {}
 };
 
-struct CacheLRU {
-  typedef std::pair<BrickInfo, TypeErase> CacheElem;
-  bool operator()(const CacheElem& a, const CacheElem& b) const {
-    return a.first.access_time > b.first.access_time;
-  }
+// The cache is split into independently-locked shards so that several loader
+// threads can hit it at once.  Within a shard, entries live in an LRU list
+// (front is most recently used) and are indexed by a hash table that points
+// into that list.  Touching an entry splices it to the front and evicting
+// pops from the back, so both are O(1).
+struct CacheShard {
+  typedef std::list<CacheEntry> LRUList;
+  typedef std::unordered_map<BrickKey, LRUList::iterator, BKeyHash> Index;
+  mutable CriticalSection guard; ///< also taken by const probes
+  LRUList lru;
+  Index index;
 };
 
 struct BrickCache::bcinfo {
-    bcinfo(): bytes(0) {}
+    bcinfo(): bytes(0), clock(0) {}
     // this is wordy but they all just forward to a real implementation below.
     const void* lookup(const BrickKey& k, uint8_t) {
       return this->typed_lookup<uint8_t>(k);
@@ -123,114 +136,222 @@ struct BrickCache::bcinfo {
       return this->typed_lookup<float>(k);
     }
 
+    std::shared_ptr<const void> pin(const BrickKey& k, uint8_t) {
+      return this->typed_pin<uint8_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, uint16_t) {
+      return this->typed_pin<uint16_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, uint32_t) {
+      return this->typed_pin<uint32_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, uint64_t) {
+      return this->typed_pin<uint64_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, int8_t) {
+      return this->typed_pin<int8_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, int16_t) {
+      return this->typed_pin<int16_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, int32_t) {
+      return this->typed_pin<int32_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, int64_t) {
+      return this->typed_pin<int64_t>(k);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k, float) {
+      return this->typed_pin<float>(k);
+    }
+
     // the erasure means we can just do the insert with the thing we already
     // have: it'll make a shared_ptr out of it and insert it into the
     // container.
     ///@{
     const void* add(const BrickKey& k, std::vector<uint8_t>& data) {
-      return this->typed_add<uint8_t>(k, data);
+      return this->typed_add<uint8_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<uint16_t>& data) {
-      return this->typed_add<uint16_t>(k, data);
+      return this->typed_add<uint16_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<uint32_t>& data) {
-      return this->typed_add<uint32_t>(k, data);
+      return this->typed_add<uint32_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<uint64_t>& data) {
-      return this->typed_add<uint64_t>(k, data);
+      return this->typed_add<uint64_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<int8_t>& data) {
-      return this->typed_add<int8_t>(k, data);
+      return this->typed_add<int8_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<int16_t>& data) {
-      return this->typed_add<int16_t>(k, data);
+      return this->typed_add<int16_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<int32_t>& data) {
-      return this->typed_add<int32_t>(k, data);
+      return this->typed_add<int32_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<int64_t>& data) {
-      return this->typed_add<int64_t>(k, data);
+      return this->typed_add<int64_t>(k, data).get();
     }
     const void* add(const BrickKey& k, std::vector<float>& data) {
+      return this->typed_add<float>(k, data).get();
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<uint8_t>& data) {
+      return this->typed_add<uint8_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<uint16_t>& data) {
+      return this->typed_add<uint16_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<uint32_t>& data) {
+      return this->typed_add<uint32_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<uint64_t>& data) {
+      return this->typed_add<uint64_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<int8_t>& data) {
+      return this->typed_add<int8_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<int16_t>& data) {
+      return this->typed_add<int16_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<int32_t>& data) {
+      return this->typed_add<int32_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<int64_t>& data) {
+      return this->typed_add<int64_t>(k, data);
+    }
+    std::shared_ptr<const void> pin(const BrickKey& k,
+                                    std::vector<float>& data) {
       return this->typed_add<float>(k, data);
     }
     ///@}
+
+    bool contains(const BrickKey& k) const {
+      const CacheShard& sh = this->shards[BKeyHash()(k) % NSHARDS];
+      SCOPEDLOCK(sh.guard);
+      return sh.index.find(k) != sh.index.end();
+    }
+
+    // evicts the globally least-recently-used entry.  We only need to look at
+    // the tail of each shard, so this is O(shards), independent of how many
+    // bricks are cached.
     void remove() {
-      if(!cache.empty()) {
-        // libstdc++ complains it's not a heap otherwise.. somehow.  bug?
-        std::make_heap(this->cache.begin(), this->cache.end(), CacheLRU());
-        const CacheElem& entry = this->cache.front();
-        TypeErase::GenericType& gt = *(entry.second.gt);
-        assert((entry.second.width * gt.elems()) <= this->bytes);
-        this->bytes -= entry.second.width * gt.elems();
-
-        std::pop_heap(this->cache.begin(), this->cache.end(), CacheLRU());
-        this->cache.pop_back();
+      for(;;) {
+        size_t victim = NSHARDS;
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        for(size_t s=0; s < NSHARDS; ++s) {
+          SCOPEDLOCK(this->shards[s].guard);
+          if(!this->shards[s].lru.empty() &&
+             this->shards[s].lru.back().stamp < oldest) {
+            oldest = this->shards[s].lru.back().stamp;
+            victim = s;
+          }
+        }
+        if(victim == NSHARDS) { return; } // cache is empty.
+
+        CacheShard& shard = this->shards[victim];
+        SCOPEDLOCK(shard.guard);
+        // another thread might have emptied this shard since we looked.
+        if(shard.lru.empty()) { continue; }
+        const CacheEntry& entry = shard.lru.back();
+        assert(entry.bytes <= this->bytes);
+        this->bytes -= entry.bytes;
+        shard.index.erase(entry.key);
+        shard.lru.pop_back();
+        Controller::Instance().IncrementPerfCounter(PERF_DY_CACHE_EVICTS, 1.0);
+        return;
       }
-      assert(this->size() == this->bytes);
     }
     void clear() {
-      this->cache.clear();
-      this->bytes = 0;
+      for(size_t s=0; s < NSHARDS; ++s) {
+        SCOPEDLOCK(this->shards[s].guard);
+        const CacheShard::LRUList& lru = this->shards[s].lru;
+        for(auto e=lru.cbegin(); e != lru.cend(); ++e) {
+          this->bytes -= e->bytes;
+        }
+        this->shards[s].lru.clear();
+        this->shards[s].index.clear();
+      }
     }
     size_t size() const { return this->bytes; }
 
   private:
     template<typename T> const void* typed_lookup(const BrickKey& k);
-    template<typename T> const void* typed_add(const BrickKey&,
-                                               std::vector<T>&);
+    template<typename T> std::shared_ptr<const void>
+      typed_pin(const BrickKey& k);
+    template<typename T> std::shared_ptr<const void>
+      typed_add(const BrickKey&, std::vector<T>&);
 
-  private:
-    typedef std::pair<BrickInfo, TypeErase> CacheElem;
-    std::vector<CacheElem> cache;
-    size_t bytes; ///< how much memory we're currently using for data.
-};
+    CacheShard& shard(const BrickKey& k) {
+      return this->shards[BKeyHash()(k) % NSHARDS];
+    }
 
-struct KeyMatches {
-  bool operator()(const BrickKey& key,
-                  const std::pair<BrickInfo,TypeErase>& a) const {
-    return key == a.first.key;
-  }
+  private:
+    static const size_t NSHARDS = 16;
+    CacheShard shards[NSHARDS];
+    std::atomic<size_t> bytes; ///< how much memory we're using for data.
+    std::atomic<uint64_t> clock; ///< source of access stamps.
 };
 
-// if the key doesn't exist, you get an empty vector.
+// if the key doesn't exist, you get NULL.
 template<typename T>
 const void* BrickCache::bcinfo::typed_lookup(const BrickKey& k) {
-  using namespace std::placeholders;
-  KeyMatches km;
-  auto func = std::bind(&KeyMatches::operator(), km, k, _1);
-
-  // gcc can't seem to deduce this with 'auto'.
-  typedef std::vector<CacheElem> maptype;
-  maptype::iterator i = std::find_if(this->cache.begin(), this->cache.end(),
-                                     func);
-  if(i == this->cache.end()) { return NULL; }
-
-  i->first.access_time = time(NULL);
-  TypeErase::GenericType& gt = *(i->second.gt);
-  assert(this->size() == this->bytes);
-  return dynamic_cast<TypeErase::TypeEraser<std::vector<T>>&>(gt).get().data();
+  // the cache still holds its own reference, so the pointer outlives the
+  // shared_ptr we get here.
+  return this->typed_pin<T>(k).get();
 }
 
 template<typename T>
-const void* BrickCache::bcinfo::typed_add(const BrickKey& k,
-                                          std::vector<T>& data) {
+std::shared_ptr<const void> BrickCache::bcinfo::typed_pin(const BrickKey& k) {
+  CacheShard& sh = this->shard(k);
+  SCOPEDLOCK(sh.guard);
+  CacheShard::Index::iterator i = sh.index.find(k);
+  if(i == sh.index.end()) {
+    Controller::Instance().IncrementPerfCounter(PERF_DY_CACHE_MISSES, 1.0);
+    return std::shared_ptr<const void>();
+  }
+  Controller::Instance().IncrementPerfCounter(PERF_DY_CACHE_HITS, 1.0);
+
+  // touch: move it to the front of the LRU list.  splice doesn't invalidate
+  // the iterator we hold in the index.
+  sh.lru.splice(sh.lru.begin(), sh.lru, i->second);
+  i->second->stamp = ++this->clock;
+  const std::shared_ptr<TypeErase::GenericType>& gt = i->second->data.gt;
+  const T* data =
+    dynamic_cast<TypeErase::TypeEraser<std::vector<T>>&>(*gt).get().data();
+  // aliasing constructor: shares ownership with the erased vector, but
+  // points at its contents.
+  return std::shared_ptr<const void>(gt, data);
+}
+
+template<typename T> std::shared_ptr<const void>
+BrickCache::bcinfo::typed_add(const BrickKey& k, std::vector<T>& data) {
+  const size_t nbytes = sizeof(T) * data.size();
+  CacheShard& sh = this->shard(k);
+  SCOPEDLOCK(sh.guard);
   // maybe the case of a general cache allows duplicate insert, but for our uses
-  // there should never be a duplicate entry.
-#ifndef NDEBUG
-  KeyMatches km;
-  using namespace std::placeholders;
-  auto func = std::bind(&KeyMatches::operator(), km, k, _1);
-  assert(std::find_if(this->cache.begin(), this->cache.end(), func) ==
-         this->cache.end());
-#endif
-  this->bytes += sizeof(T) * data.size();
-  this->cache.push_back(std::make_pair(BrickInfo(k, time(NULL)),
-                        std::move(data)));
-
-  assert(this->size() == this->bytes);
-  TypeErase::GenericType& gt = *this->cache.back().second.gt;
-  return dynamic_cast<TypeErase::TypeEraser<std::vector<T>>&>(gt).get().data();
+  // there should never be a duplicate entry.  With several loaders it can
+  // still happen that two threads miss on the same key and both read it;
+  // the second one just gets the copy which is already in there.
+  CacheShard::Index::iterator existing = sh.index.find(k);
+  if(existing == sh.index.end()) {
+    sh.lru.push_front(CacheEntry(k, TypeErase(std::move(data)), nbytes,
+                                 ++this->clock));
+    existing = sh.index.insert(std::make_pair(k, sh.lru.begin())).first;
+    this->bytes += nbytes;
+  }
+
+  const std::shared_ptr<TypeErase::GenericType>& gt = existing->second->data.gt;
+  const T* rv =
+    dynamic_cast<TypeErase::TypeEraser<std::vector<T>>&>(*gt).get().data();
+  return std::shared_ptr<const void>(gt, rv);
 }
 
 BrickCache::BrickCache() : ci(new BrickCache::bcinfo) {}
@@ -266,6 +387,78 @@ const void* BrickCache::lookup(const BrickKey& k, float value) {
   return this->ci->lookup(k, value);
 }
 
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, uint8_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, uint16_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, uint32_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, uint64_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, int8_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, int16_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, int32_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, int64_t value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, float value) {
+  return this->ci->pin(k, value);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<uint8_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<uint16_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<uint32_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<uint64_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<int8_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<int16_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<int32_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<int64_t>& data) {
+  return this->ci->pin(k, data);
+}
+std::shared_ptr<const void>
+BrickCache::pin(const BrickKey& k, std::vector<float>& data) {
+  return this->ci->pin(k, data);
+}
 
 const void* BrickCache::add(const BrickKey& k,
                             std::vector<uint8_t>& data) {
@@ -304,6 +497,10 @@ const void* BrickCache::add(const BrickKey& k,
   return this->ci->add(k, data);
 }
 
+bool BrickCache::contains(const BrickKey& k) const {
+  return this->ci->contains(k);
+}
+
 void BrickCache::remove() { this->ci->remove(); }
 void BrickCache::clear() { return this->ci->clear(); }
 size_t BrickCache::size() const { return this->ci->size(); }
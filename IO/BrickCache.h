@@ -7,11 +7,14 @@
 
 namespace tuvok {
 
-// Implements a simple brick cache: associates a chunk of data with the given
-// brick key.
-// Lookup of a nonexistent key results in an empty vector: there is no way to
-// tell whether a key doesn't exist, or whether the data it stores is actually
-// empty.
+// Implements a brick cache: associates a chunk of data with the given brick
+// key.  Entries are hashed by key into a fixed number of shards, each with its
+// own lock and LRU list, so lookup, add and remove are all O(1) and several
+// threads can use one cache at the same time.
+// Lookup of a nonexistent key results in NULL.
+// @note The raw pointers from lookup/add stay valid until the entry is
+// evicted; callers sharing a cache between threads should use 'pin', which
+// keeps the data alive for as long as the caller holds on to it.
 class BrickCache {
   public:
     BrickCache();
@@ -31,6 +34,39 @@ class BrickCache {
     const void* lookup(const BrickKey&, float);
     ///@}
 
+    /// whether the key is cached.  Unlike lookup this is not counted as a
+    /// cache hit or miss and does not make the entry more recent, so it
+    /// suits probes which are not going to use the data.
+    bool contains(const BrickKey&) const;
+
+    /// like lookup, but the returned pointer holds a reference on the data:
+    /// it stays valid even if the entry gets evicted while it is in use.
+    /// Evicted-but-pinned data no longer counts towards size().
+    ///@{
+    std::shared_ptr<const void> pin(const BrickKey&, uint8_t);
+    std::shared_ptr<const void> pin(const BrickKey&, uint16_t);
+    std::shared_ptr<const void> pin(const BrickKey&, uint32_t);
+    std::shared_ptr<const void> pin(const BrickKey&, uint64_t);
+    std::shared_ptr<const void> pin(const BrickKey&, int8_t);
+    std::shared_ptr<const void> pin(const BrickKey&, int16_t);
+    std::shared_ptr<const void> pin(const BrickKey&, int32_t);
+    std::shared_ptr<const void> pin(const BrickKey&, int64_t);
+    std::shared_ptr<const void> pin(const BrickKey&, float);
+    ///@}
+    /// ... and the same for adding: the data is moved into the cache and the
+    /// return value pins it.
+    ///@{
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<uint8_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<uint16_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<uint32_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<uint64_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<int8_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<int16_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<int32_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<int64_t>&);
+    std::shared_ptr<const void> pin(const BrickKey&, std::vector<float>&);
+    ///@}
+
     /// These return their argument for ease of use.
     ///@{
     const void* add(const BrickKey&, std::vector<uint8_t>&);
@@ -44,7 +80,7 @@ class BrickCache {
     const void* add(const BrickKey&, std::vector<float>&);
     ///@}
 
-    /// removes the most appropriate element.
+    /// removes the least recently used element.
     void remove();
 
     /// @returns cache size currently in use (in bytes)
@@ -0,0 +1,104 @@
+#ifndef TUVOK_BRICK_VIEW_H
+#define TUVOK_BRICK_VIEW_H
+
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace tuvok {
+
+/// A read-only, strided window onto brick data which lives somewhere else
+/// (usually inside a BrickCache).  The view holds a reference on the
+/// underlying memory, so the data stays valid for as long as the view does,
+/// even if the cache evicts the brick in the meantime.
+///
+/// Voxel (x,y,z), component c, is found at
+///   base[((z*pitch[1] + y)*pitch[0] + x)*components + c]
+/// i.e. 'pitch' is given in voxels (row length) and rows (slice height); this
+/// maps directly onto GL_UNPACK_ROW_LENGTH / GL_UNPACK_IMAGE_HEIGHT.
+template<typename T> struct BrickView {
+  std::shared_ptr<const void> owner; ///< keeps 'base' alive.
+  const T* base;
+  std::array<size_t,3> extents; ///< voxels in the view, per dimension
+  std::array<size_t,2> pitch;   ///< row length (voxels), slice height (rows)
+  size_t components;
+
+  BrickView() : base(NULL), components(1) {
+    extents[0] = extents[1] = extents[2] = 0;
+    pitch[0] = pitch[1] = 0;
+  }
+
+  bool valid() const { return base != NULL; }
+  size_t voxels() const { return extents[0] * extents[1] * extents[2]; }
+
+  /// @returns true if the view is a dense block, i.e. it can be handed to
+  /// code which expects a plain array of voxels() * components elements.
+  bool contiguous() const {
+    return (pitch[0] == extents[0] || (extents[1] == 1 && extents[2] == 1)) &&
+           (pitch[1] == extents[1] || extents[2] == 1);
+  }
+
+  /// @returns the start of the given scanline.  Each scanline is
+  /// extents[0]*components elements long.
+  const T* scanline(size_t y, size_t z) const {
+    assert(y < extents[1] && z < extents[2]);
+    return base + ((z*pitch[1] + y)*pitch[0])*components;
+  }
+
+  /// Calls func(const T* begin, const T* end) for every scanline.  This is
+  /// the way to process a view without caring whether it is contiguous.
+  template<typename Fqn> void for_each_scanline(Fqn func) const {
+    const size_t width = extents[0] * components;
+    if(this->contiguous()) {
+      func(this->base, this->base + width*extents[1]*extents[2]);
+      return;
+    }
+    for(size_t z=0; z < extents[2]; ++z) {
+      for(size_t y=0; y < extents[1]; ++y) {
+        const T* line = this->scanline(y, z);
+        func(line, line + width);
+      }
+    }
+  }
+
+  /// Densely copies the view into 'dest' (which is resized to fit).  For
+  /// consumers which cannot deal with strides.
+  void copy(std::vector<T>& dest) const {
+    dest.resize(this->voxels() * components);
+    T* out = dest.data();
+    this->for_each_scanline([&out](const T* b, const T* e) {
+      out = std::copy(b, e, out);
+    });
+  }
+};
+
+}
+#endif // TUVOK_BRICK_VIEW_H
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2014 IVDA Group
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
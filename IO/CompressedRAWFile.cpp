@@ -0,0 +1,680 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <vector>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+#include "3rdParty/bzip2/bzlib.h"
+#include "3rdParty/zlib/zlib.h"
+#include "CompressedRAWFile.h"
+
+namespace tuvok {
+
+class CompressedRAWFile::Decoder {
+public:
+  Decoder(const LargeRAWFile& file) : m_File(file), m_bFailed(false) {}
+  virtual ~Decoder() {}
+
+  /// Checks the stream's header and prepares decompression.
+  virtual bool Init() = 0;
+  /// Copies up to iCount bytes of output, starting at offset iPos.
+  virtual size_t Read(unsigned char* pData, uint64_t iCount,
+                      uint64_t iPos) = 0;
+  /// @returns the size of the output, decompressing all of it if necessary
+  virtual uint64_t Size() = 0;
+  virtual size_t RestartPoints() const = 0;
+  bool Failed() const { return m_bFailed; }
+
+protected:
+  /// Reads compressed data; positional, so it is safe from any thread.
+  size_t Input(unsigned char* pData, size_t iCount, uint64_t iPos) const {
+    return m_File.LargeRAWFile::ReadRAWAt(pData, iCount, iPos);
+  }
+
+  const LargeRAWFile& m_File;
+  bool                m_bFailed;
+};
+
+namespace {
+  const size_t iInputSize = 1024*1024;
+  /// how far the window is filled beyond a read, so that small reads do not
+  /// go to the decoder one by one
+  const size_t iReadAhead = 1024*1024;
+
+  // ---------------------------------------------------------------- gzip
+
+  /// deflate refers back at most this far
+  const size_t iWindow = 32768;
+  /// Output is produced into a ring buffer, so that the history needed for
+  /// a restart point is at hand when we pass one.
+  const size_t iRing = 8*iWindow;
+
+  class GZipDecoder : public CompressedRAWFile::Decoder {
+  public:
+    GZipDecoder(const LargeRAWFile& file, uint64_t iSpan) :
+      CompressedRAWFile::Decoder(file),
+      m_iSpan(std::max<uint64_t>(iSpan, iWindow)),
+      m_bInit(false), m_iStart(0), m_iIn(0), m_iOut(0), m_bEnd(false),
+      m_iSize(0), m_bSizeKnown(false), m_iCRC(crc32(0L, Z_NULL, 0)),
+      m_iChecked(0), m_vIn(iInputSize), m_vRing(iRing)
+    {
+      memset(&m_Stream, 0, sizeof(m_Stream));
+    }
+    virtual ~GZipDecoder() {
+      if(m_bInit) { inflateEnd(&m_Stream); }
+    }
+
+    virtual bool Init() {
+      if(!SkipHeader()) { return false; }
+      m_Stream.zalloc = Z_NULL;
+      m_Stream.zfree = Z_NULL;
+      m_Stream.opaque = Z_NULL;
+      m_Stream.avail_in = 0;
+      m_Stream.next_in = Z_NULL;
+      // the gzip header is already skipped, the rest is a raw deflate stream
+      if(inflateInit2(&m_Stream, -MAX_WBITS) != Z_OK) { return false; }
+      m_bInit = true;
+      return Restart(NULL);
+    }
+
+    virtual size_t Read(unsigned char* pData, uint64_t iCount,
+                        uint64_t iPos) {
+      if(m_bSizeKnown && iPos >= m_iSize) { return 0; }
+
+      // continue from where we are if that is at least as close as the best
+      // restart point
+      const Point* pBest = Closest(iPos);
+      const uint64_t iBest = pBest ? pBest->iOut : 0;
+      if(m_iOut > iPos || m_iOut < iBest) {
+        if(!Restart(pBest)) { return 0; }
+      }
+      return Inflate(pData, iPos, iCount);
+    }
+
+    virtual uint64_t Size() {
+      if(!m_bSizeKnown) {
+        const Point* pLast = m_vPoints.empty() ? NULL : &m_vPoints.back();
+        if(pLast && m_iOut < pLast->iOut && !Restart(pLast)) { return 0; }
+        Inflate(NULL, m_iOut, std::numeric_limits<uint64_t>::max() - m_iOut);
+      }
+      return m_iSize;
+    }
+
+    virtual size_t RestartPoints() const { return m_vPoints.size(); }
+
+  private:
+    struct Point {
+      uint64_t iOut;  ///< output offset of the restart point
+      uint64_t iIn;   ///< first compressed byte which is not fully consumed
+      int iBits;      ///< bits of the previous byte which are still needed
+      std::vector<unsigned char> vWindow;
+    };
+
+    /// Skips the gzip header, leaving m_iStart at the deflate stream.
+    bool SkipHeader() {
+      unsigned char h[10];
+      if(Input(h, 10, 0) != 10 || h[0] != 0x1f || h[1] != 0x8b ||
+         h[2] != Z_DEFLATED) {
+        return false;
+      }
+      const unsigned char flags = h[3];
+      m_iStart = 10;
+      if(flags & 0x04) { // extra field
+        unsigned char len[2];
+        if(Input(len, 2, m_iStart) != 2) { return false; }
+        m_iStart += 2 + (len[0] | (len[1] << 8));
+      }
+      // file name and comment are zero terminated
+      for(unsigned char f = 0x08; f <= 0x10; f <<= 1) {
+        if(!(flags & f)) { continue; }
+        unsigned char buf[256];
+        const unsigned char* end = NULL;
+        while(end == NULL) {
+          const size_t n = Input(buf, sizeof(buf), m_iStart);
+          if(n == 0) { return false; }
+          end = static_cast<const unsigned char*>(memchr(buf, 0, n));
+          m_iStart += end ? (end - buf) + 1 : n;
+        }
+      }
+      if(flags & 0x02) { m_iStart += 2; } // header CRC
+      return true;
+    }
+
+    /// @returns the last restart point at or before iPos, NULL if that is
+    ///          the start of the stream.
+    const Point* Closest(uint64_t iPos) const {
+      size_t lo = 0, hi = m_vPoints.size();
+      while(lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if(m_vPoints[mid].iOut <= iPos) { lo = mid+1; } else { hi = mid; }
+      }
+      return lo ? &m_vPoints[lo-1] : NULL;
+    }
+
+    bool Restart(const Point* p) {
+      inflateReset(&m_Stream);
+      m_Stream.avail_in = 0;
+      m_Stream.next_in = Z_NULL;
+      m_bEnd = false;
+      if(p == NULL) {
+        m_iIn = m_iStart;
+        m_iOut = 0;
+        return true;
+      }
+      m_iIn = p->iIn;
+      m_iOut = p->iOut;
+      if(p->iBits) {
+        unsigned char c;
+        if(Input(&c, 1, p->iIn-1) != 1) { return Fail(); }
+        inflatePrime(&m_Stream, p->iBits, c >> (8 - p->iBits));
+      }
+      inflateSetDictionary(&m_Stream, &p->vWindow[0], uInt(iWindow));
+      // the next restart point's history may reach back into this one's
+      for(size_t i=0; i < iWindow; ++i) {
+        m_vRing[size_t((p->iOut - iWindow + i) % iRing)] = p->vWindow[i];
+      }
+      return true;
+    }
+
+    void AddPoint() {
+      Point p;
+      p.iOut = m_iOut;
+      p.iIn = m_iIn - m_Stream.avail_in;
+      p.iBits = m_Stream.data_type & 7;
+      p.vWindow.resize(iWindow);
+      for(size_t i=0; i < iWindow; ++i) {
+        p.vWindow[i] = m_vRing[size_t((m_iOut - iWindow + i) % iRing)];
+      }
+      m_vPoints.push_back(p);
+    }
+
+    /// Compares the CRC32 and size stored behind the deflate stream against
+    /// the output.  The CRC can only be checked if all of the output went
+    /// through it.
+    bool CheckTrailer() {
+      unsigned char t[8];
+      if(Input(t, 8, m_iIn - m_Stream.avail_in) != 8) { return false; }
+      const uint32_t iCRC = uint32_t(t[0]) | uint32_t(t[1]) << 8 |
+                            uint32_t(t[2]) << 16 | uint32_t(t[3]) << 24;
+      const uint32_t iSize = uint32_t(t[4]) | uint32_t(t[5]) << 8 |
+                             uint32_t(t[6]) << 16 | uint32_t(t[7]) << 24;
+      if(iSize != uint32_t(m_iOut)) { return false; }
+      return m_iChecked != m_iOut || iCRC == uint32_t(m_iCRC);
+    }
+
+    bool Fail() {
+      m_bFailed = true;
+      m_bEnd = true;
+      m_iSize = m_iOut;
+      m_bSizeKnown = true;
+      return false;
+    }
+
+    /// Decompresses until the output reaches iPos+iCount, copying what lies
+    /// in [iPos, iPos+iCount) to pData (if given).  The output must not have
+    /// passed iPos yet.
+    size_t Inflate(unsigned char* pData, uint64_t iPos, uint64_t iCount) {
+      const uint64_t iEnd = iPos + iCount;
+      // Past the last block only the trailer is left.  Take it along, so
+      // that reading everything once is enough to get it checked.
+      while(!m_bEnd && (m_iOut < iEnd ||
+                        (m_Stream.data_type & (128|64)) == (128|64))) {
+        if(m_Stream.avail_in == 0) {
+          const size_t n = Input(&m_vIn[0], m_vIn.size(), m_iIn);
+          if(n == 0) { Fail(); break; } // truncated
+          m_iIn += n;
+          m_Stream.next_in = &m_vIn[0];
+          m_Stream.avail_in = uInt(n);
+        }
+        const size_t o = size_t(m_iOut % iRing);
+        m_Stream.next_out = &m_vRing[o];
+        m_Stream.avail_out = uInt(iRing - o);
+        // stop at block boundaries, the only places we can restart from
+        const int ret = inflate(&m_Stream, Z_BLOCK);
+        const size_t n = (iRing - o) - m_Stream.avail_out;
+        // the CRC covers the output front to back; it picks up again when
+        // a restart from further ahead left a gap that is filled later
+        if(m_iOut <= m_iChecked && m_iChecked < m_iOut + n) {
+          const size_t skip = size_t(m_iChecked - m_iOut);
+          m_iCRC = crc32(m_iCRC, &m_vRing[o + skip], uInt(n - skip));
+          m_iChecked = m_iOut + n;
+        }
+        if(pData) {
+          const uint64_t b = std::max(m_iOut, iPos);
+          const uint64_t e = std::min(m_iOut + n, iEnd);
+          if(b < e) {
+            memcpy(pData + (b - iPos), &m_vRing[o + size_t(b - m_iOut)],
+                   size_t(e - b));
+          }
+        }
+        m_iOut += n;
+
+        if(ret == Z_STREAM_END) {
+          if(!CheckTrailer()) { Fail(); break; }
+          m_bEnd = true;
+          m_iSize = m_iOut;
+          m_bSizeKnown = true;
+          break;
+        }
+        if(ret != Z_OK && !(ret == Z_BUF_ERROR && m_Stream.avail_in == 0)) {
+          Fail();
+          break;
+        }
+        const uint64_t iLast = m_vPoints.empty() ? 0 : m_vPoints.back().iOut;
+        if((m_Stream.data_type & 128) && !(m_Stream.data_type & 64) &&
+           m_iOut >= iLast + m_iSpan) {
+          AddPoint();
+        }
+      }
+      return m_iOut > iPos ? size_t(std::min(m_iOut, iEnd) - iPos) : 0;
+    }
+
+    const uint64_t m_iSpan;
+    z_stream m_Stream;
+    bool     m_bInit;
+    uint64_t m_iStart;  ///< where the deflate stream starts
+    uint64_t m_iIn;     ///< compressed offset of the next input chunk
+    uint64_t m_iOut;    ///< output offset of the next byte inflate produces
+    bool     m_bEnd;    ///< inflate reached the end of the stream (or died)
+    uint64_t m_iSize;
+    bool     m_bSizeKnown;
+    uLong    m_iCRC;      ///< CRC32 of the output up to m_iChecked
+    uint64_t m_iChecked;
+    std::vector<unsigned char> m_vIn;
+    std::vector<unsigned char> m_vRing;
+    std::vector<Point> m_vPoints;
+  };
+
+  // --------------------------------------------------------------- bzip2
+
+  const uint64_t iBlockMagic = 0x314159265359ULL; // BCD pi
+  const uint64_t iEndMagic   = 0x177245385090ULL; // BCD sqrt(pi)
+  const uint64_t iMagicMask  = 0xFFFFFFFFFFFFULL;
+
+  /// Collects a bit stream, most significant bit first.
+  class BitWriter {
+  public:
+    BitWriter() : m_iAcc(0), m_iBits(0) {}
+    void Put(uint64_t v, unsigned n) {
+      while(n > 0) {
+        --n;
+        m_iAcc = (m_iAcc << 1) | ((v >> n) & 1);
+        if(++m_iBits == 8) {
+          m_vData.push_back(m_iAcc);
+          m_iAcc = 0;
+          m_iBits = 0;
+        }
+      }
+    }
+    /// Appends bits [iFirst, iFirst+iCount) of 'pData'.
+    void Copy(const unsigned char* pData, uint64_t iFirst, uint64_t iCount) {
+      const unsigned s = unsigned(iFirst % 8);
+      const unsigned char* p = pData + iFirst/8;
+      if(m_iBits == 0) {
+        // whole bytes at once
+        for(; iCount >= 8; iCount -= 8, ++p) {
+          m_vData.push_back(s ? (unsigned char)((p[0] << s) | (p[1] >> (8-s)))
+                              : p[0]);
+        }
+      }
+      for(uint64_t i=0; i < iCount; ++i) {
+        const uint64_t bit = s + i;
+        Put(p[bit/8] >> (7 - bit%8), 1);
+      }
+    }
+    std::vector<unsigned char>& Finish() {
+      if(m_iBits) { Put(0, 8 - m_iBits); }
+      return m_vData;
+    }
+  private:
+    std::vector<unsigned char> m_vData;
+    unsigned char m_iAcc;
+    unsigned m_iBits;
+  };
+
+  class BZip2Decoder : public CompressedRAWFile::Decoder {
+  public:
+    BZip2Decoder(const LargeRAWFile& file) :
+      CompressedRAWFile::Decoder(file), m_vOut(1, 0), m_iBatch(1)
+    {
+#ifdef _OPENMP
+      m_iBatch = size_t(std::max(1, omp_get_max_threads()));
+#endif
+    }
+
+    virtual bool Init() {
+      unsigned char h[4];
+      if(Input(h, 4, 0) != 4 || h[0] != 'B' || h[1] != 'Z' || h[2] != 'h' ||
+         h[3] < '1' || h[3] > '9') {
+        return false;
+      }
+      return FindBlocks();
+    }
+
+    virtual size_t Read(unsigned char* pData, uint64_t iCount,
+                        uint64_t iPos) {
+      size_t iDone = 0;
+      while(iDone < iCount) {
+        const uint64_t iAt = iPos + iDone;
+        // learn where blocks start until one covers iAt
+        while(Known() < m_vBegin.size() && m_vOut.back() <= iAt) {
+          Decode(Known());
+        }
+        if(m_vOut.back() <= iAt) { break; } // past the end
+        const size_t i = size_t(std::upper_bound(m_vOut.begin(), m_vOut.end(),
+                                                 iAt) - m_vOut.begin()) - 1;
+        const std::vector<unsigned char>* pBlock = Cached(i);
+        if(pBlock == NULL) {
+          Decode(i);
+          if((pBlock = Cached(i)) == NULL) { break; }
+        }
+        const size_t iOffset = size_t(iAt - m_vOut[i]);
+        const size_t n = size_t(std::min<uint64_t>(iCount - iDone,
+                                                   pBlock->size() - iOffset));
+        memcpy(pData + iDone, &(*pBlock)[iOffset], n);
+        iDone += n;
+      }
+      return iDone;
+    }
+
+    virtual uint64_t Size() {
+      while(Known() < m_vBegin.size()) { Decode(Known()); }
+      return m_vOut.back();
+    }
+
+    virtual size_t RestartPoints() const { return m_vBegin.size(); }
+
+  private:
+    typedef std::pair<size_t, std::vector<unsigned char> > Block;
+
+    /// number of blocks whose output offsets are known
+    size_t Known() const { return m_vOut.size()-1; }
+
+    /// Finds every block by its magic number.  Blocks are not byte aligned
+    /// and their headers do not give their length, so each one ends where the
+    /// next one (or the end of the stream) starts.  Concatenated streams
+    /// (as written by parallel compressors) come out right as well: the
+    /// stream headers lie between an end and the next block.
+    bool FindBlocks() {
+      std::vector<unsigned char> buf(iInputSize);
+      std::vector<uint64_t> vBounds;
+      uint64_t iReg = 0;
+      uint64_t iBit = 0;
+      size_t n;
+      while((n = Input(&buf[0], buf.size(), iBit/8)) > 0) {
+        for(size_t k=0; k < n; ++k) {
+          iReg = (iReg << 8) | buf[k];
+          iBit += 8;
+          if(iBit < 48) { continue; }
+          for(int s=7; s >= 0; --s) {
+            const uint64_t v = (iReg >> s) & iMagicMask;
+            if(v == iBlockMagic) {
+              vBounds.push_back(iBit - s - 48);
+              m_vBegin.push_back(iBit - s - 48);
+            } else if(v == iEndMagic) {
+              vBounds.push_back(iBit - s - 48);
+            }
+          }
+        }
+      }
+      if(m_vBegin.empty()) { return false; }
+      // without a final end marker the last block runs to the end of file
+      vBounds.push_back(iBit);
+      m_vEnd.resize(m_vBegin.size());
+      size_t b = 0;
+      for(size_t i=0; i < m_vBegin.size(); ++i) {
+        while(vBounds[b] <= m_vBegin[i]) { ++b; }
+        m_vEnd[i] = vBounds[b];
+      }
+      return true;
+    }
+
+    /// Decompresses block i on its own, by wrapping it into a stream of its
+    /// own.  Safe to call from several threads.
+    bool DecodeBlock(size_t i, std::vector<unsigned char>& vData) const {
+      const uint64_t iBegin = m_vBegin[i], iEnd = m_vEnd[i];
+      // magic, CRC and at least some data
+      if(iEnd - iBegin < 48+32+8) { return false; }
+      std::vector<unsigned char> in(size_t((iEnd+7)/8 - iBegin/8) + 1, 0);
+      if(Input(&in[0], in.size()-1, iBegin/8) != in.size()-1) { return false; }
+
+      const uint64_t iFirst = iBegin % 8;
+      uint32_t iCRC = 0;
+      for(uint64_t b = iFirst+48; b < iFirst+80; ++b) {
+        iCRC = (iCRC << 1) | ((in[size_t(b/8)] >> (7 - b%8)) & 1);
+      }
+
+      BitWriter stream;
+      // the largest block size, so that any block fits
+      stream.Put('B', 8); stream.Put('Z', 8); stream.Put('h', 8);
+      stream.Put('9', 8);
+      stream.Copy(&in[0], iFirst, iEnd - iBegin);
+      // with a single block, the stream's CRC is the block's CRC
+      stream.Put(iEndMagic, 48);
+      stream.Put(iCRC, 32);
+      std::vector<unsigned char>& vStream = stream.Finish();
+
+      bz_stream bz;
+      memset(&bz, 0, sizeof(bz));
+      if(BZ2_bzDecompressInit(&bz, 0, 0) != BZ_OK) { return false; }
+      bz.next_in = reinterpret_cast<char*>(&vStream[0]);
+      bz.avail_in = unsigned(vStream.size());
+      vData.resize(1024*1024);
+      size_t n = 0;
+      int ret;
+      for(;;) {
+        if(n == vData.size()) { vData.resize(2*n); }
+        bz.next_out = reinterpret_cast<char*>(&vData[n]);
+        bz.avail_out = unsigned(vData.size() - n);
+        ret = BZ2_bzDecompress(&bz);
+        n = vData.size() - bz.avail_out;
+        if(ret != BZ_OK) { break; }
+        if(bz.avail_in == 0 && bz.avail_out != 0) { break; } // truncated
+      }
+      BZ2_bzDecompressEnd(&bz);
+      vData.resize(n);
+      return ret == BZ_STREAM_END && n > 0;
+    }
+
+    /// Decompresses a batch of blocks starting at iFirst, in parallel, and
+    /// puts them in the cache.
+    void Decode(size_t iFirst) {
+      const size_t iCount = std::min(m_iBatch, m_vBegin.size() - iFirst);
+      std::vector<std::vector<unsigned char> > vData(iCount);
+      std::vector<char> vOK(iCount);
+#pragma omp parallel for schedule(dynamic)
+      for(int j=0; j < int(iCount); ++j) {
+        vOK[j] = DecodeBlock(iFirst+j, vData[j]);
+      }
+
+      for(size_t j=0; j < iCount; ++j) {
+        const size_t i = iFirst+j;
+        bool bMerged = false;
+        // the magic number can appear inside compressed data by chance,
+        // which cuts a block in two; glue the pieces back together
+        while(!vOK[j] && i+1 < m_vBegin.size() &&
+              m_vEnd[i] == m_vBegin[i+1]) {
+          m_vEnd[i] = m_vEnd[i+1];
+          m_vBegin.erase(m_vBegin.begin() + (i+1));
+          m_vEnd.erase(m_vEnd.begin() + (i+1));
+          vOK[j] = DecodeBlock(i, vData[j]);
+          bMerged = true;
+        }
+        if(!vOK[j]) {
+          // nothing after the damage is reachable
+          m_bFailed = true;
+          m_vBegin.resize(i);
+          m_vEnd.resize(i);
+          if(Known() > i) { m_vOut.resize(i+1); }
+          return;
+        }
+        if(i == Known()) { m_vOut.push_back(m_vOut.back() + vData[j].size()); }
+        Store(i, vData[j]);
+        // the rest of the batch was cut differently
+        if(bMerged) { return; }
+      }
+    }
+
+    const std::vector<unsigned char>* Cached(size_t i) {
+      for(std::list<Block>::iterator b = m_Cache.begin(); b != m_Cache.end();
+          ++b) {
+        if(b->first == i) {
+          m_Cache.splice(m_Cache.begin(), m_Cache, b);
+          return &m_Cache.front().second;
+        }
+      }
+      return NULL;
+    }
+
+    void Store(size_t i, std::vector<unsigned char>& vData) {
+      for(std::list<Block>::iterator b = m_Cache.begin(); b != m_Cache.end();
+          ++b) {
+        if(b->first == i) { m_Cache.erase(b); break; }
+      }
+      m_Cache.push_front(Block(i, std::vector<unsigned char>()));
+      m_Cache.front().second.swap(vData);
+      // room for the batch being read and the one read ahead
+      while(m_Cache.size() > 2*m_iBatch) { m_Cache.pop_back(); }
+    }
+
+    std::vector<uint64_t> m_vBegin; ///< first bit of every block
+    std::vector<uint64_t> m_vEnd;   ///< bit after every block
+    std::vector<uint64_t> m_vOut;   ///< output offsets of the known blocks
+    size_t                m_iBatch;
+    std::list<Block>      m_Cache;  ///< most recently used first
+  };
+}
+
+CompressedRAWFile::CompressedRAWFile(const std::string& strFilename,
+                                     Encoding eEncoding, uint64_t iHeaderSize,
+                                     uint64_t iSize, uint64_t iSpan) :
+  LargeRAWFile(strFilename, iHeaderSize),
+  m_eEncoding(eEncoding),
+  m_iSize(iSize),
+  m_iSpan(iSpan),
+  m_iPos(0),
+  m_iWindowBegin(0),
+  m_iWindowEnd(0)
+{
+}
+
+CompressedRAWFile::~CompressedRAWFile() {
+  Close();
+}
+
+bool CompressedRAWFile::Open(bool bReadWrite) {
+  if(bReadWrite || m_eEncoding == ENC_RAW) { return false; }
+  if(!LargeRAWFile::Open(false)) { return false; }
+
+  SCOPEDLOCK(m_Guard);
+  if(m_eEncoding == ENC_GZIP) {
+    m_pDecoder.reset(new GZipDecoder(*this, m_iSpan));
+  } else {
+    m_pDecoder.reset(new BZip2Decoder(*this));
+  }
+  m_iPos = 0;
+  m_iWindowBegin = m_iWindowEnd = 0;
+  if(!m_pDecoder->Init()) {
+    m_pDecoder.reset();
+    LargeRAWFile::Close();
+    return false;
+  }
+  return true;
+}
+
+void CompressedRAWFile::Close() {
+  {
+    SCOPEDLOCK(m_Guard);
+    m_pDecoder.reset();
+  }
+  LargeRAWFile::Close();
+}
+
+uint64_t CompressedRAWFile::GetCurrentSize() {
+  if(m_iSize) { return m_iSize; }
+  SCOPEDLOCK(m_Guard);
+  return m_pDecoder ? m_pDecoder->Size() : 0;
+}
+
+void CompressedRAWFile::SeekStart() {
+  m_iPos = 0;
+}
+
+uint64_t CompressedRAWFile::SeekEnd() {
+  m_iPos = GetCurrentSize();
+  return m_iPos;
+}
+
+uint64_t CompressedRAWFile::GetPos() {
+  return m_iPos;
+}
+
+void CompressedRAWFile::SeekPos(uint64_t iPos) {
+  m_iPos = iPos;
+}
+
+size_t CompressedRAWFile::ReadRAW(unsigned char* pData, uint64_t iCount) {
+  const size_t n = ReadRAWAt(pData, iCount, m_iPos);
+  m_iPos += n;
+  return n;
+}
+
+size_t CompressedRAWFile::ReadRAWAt(unsigned char* pData, uint64_t iCount,
+                                    uint64_t iPos) const {
+  SCOPEDLOCK(m_Guard);
+  if(!m_pDecoder) { return 0; }
+  if(m_vWindow.empty()) { return m_pDecoder->Read(pData, iCount, iPos); }
+
+  const uint64_t iRing = m_vWindow.size();
+  // a small gap ahead is streamed through, so the window stays in one piece
+  if(iPos < m_iWindowBegin || iPos > m_iWindowEnd + iRing) {
+    m_iWindowBegin = m_iWindowEnd = iPos;
+  }
+  size_t iDone = 0;
+  while(iDone < iCount) {
+    const uint64_t iAt = iPos + iDone;
+    if(iAt < m_iWindowEnd) {
+      const size_t o = size_t(iAt % iRing);
+      const size_t n = size_t(std::min(std::min(m_iWindowEnd - iAt, iRing - o),
+                                       iCount - iDone));
+      memcpy(pData + iDone, &m_vWindow[o], n);
+      iDone += n;
+      continue;
+    }
+    // stream on, overwriting the oldest output
+    const size_t o = size_t(m_iWindowEnd % iRing);
+    const uint64_t iWant = std::max<uint64_t>(iAt + (iCount - iDone) -
+                                              m_iWindowEnd, iReadAhead);
+    const size_t n = m_pDecoder->Read(&m_vWindow[o],
+                                      std::min(iWant, iRing - o),
+                                      m_iWindowEnd);
+    if(n == 0) { break; } // end of data
+    m_iWindowEnd += n;
+    if(m_iWindowEnd - m_iWindowBegin > iRing) {
+      m_iWindowBegin = m_iWindowEnd - iRing;
+    }
+  }
+  return iDone;
+}
+
+void CompressedRAWFile::SetWindow(uint64_t iBytes) {
+  SCOPEDLOCK(m_Guard);
+  std::vector<unsigned char>(iBytes ? size_t(iBytes) + iReadAhead : 0).swap(
+    m_vWindow
+  );
+  m_iWindowBegin = m_iWindowEnd = 0;
+}
+
+size_t CompressedRAWFile::GetRestartPoints() const {
+  SCOPEDLOCK(m_Guard);
+  return m_pDecoder ? m_pDecoder->RestartPoints() : 0;
+}
+
+bool CompressedRAWFile::Failed() const {
+  SCOPEDLOCK(m_Guard);
+  return m_pDecoder && m_pDecoder->Failed();
+}
+
+}
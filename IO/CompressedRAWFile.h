@@ -0,0 +1,105 @@
+#ifndef TUVOK_COMPRESSED_RAW_FILE_H
+#define TUVOK_COMPRESSED_RAW_FILE_H
+
+#include "StdTuvokDefines.h"
+#include <memory>
+#include <vector>
+#include "Basics/LargeRAWFile.h"
+#include "Basics/Threads.h"
+
+namespace tuvok {
+
+/// Reads a gzip or bzip2 compressed file as if it were the uncompressed RAW
+/// file, so that converters can work on compressed data without extracting
+/// it to a temporary file first.
+///
+/// Reading front to back simply streams through the decompressor.  For
+/// reading out of order, restart points are recorded on the way: for gzip
+/// at the first deflate block boundary after every 'iSpan' bytes of output,
+/// along with the 32k of history needed to resume there; for bzip2 every
+/// block is a restart point.  bzip2 blocks do not depend on each other, so
+/// they are decompressed in parallel, a batch at a time.
+///
+/// Readers which sweep the data, but go back a bit every now and then, can
+/// keep the most recent output in memory (see SetWindow); going back inside
+/// that window then costs no decompression at all.
+///
+/// The file is read only.  All reads share one decompressor and are
+/// serialized, so ReadRAWAt may be called from several threads, but those
+/// threads will not read in parallel.
+class CompressedRAWFile : public LargeRAWFile {
+public:
+  enum Encoding {
+    ENC_RAW,    ///< not compressed; open those as plain LargeRAWFiles
+    ENC_GZIP,
+    ENC_BZIP2
+  };
+
+  /// @param iHeaderSize bytes to skip before the compressed stream starts
+  /// @param iSize uncompressed size, if known.  Otherwise GetCurrentSize
+  ///        has to decompress everything to find out.
+  /// @param iSpan output bytes between two gzip restart points
+  CompressedRAWFile(const std::string& strFilename, Encoding eEncoding,
+                    uint64_t iHeaderSize=0, uint64_t iSize=0,
+                    uint64_t iSpan=8*1024*1024);
+  virtual ~CompressedRAWFile();
+
+  virtual bool Open(bool bReadWrite=false);
+  virtual void Close();
+
+  virtual bool Create(uint64_t) { return false; }
+  virtual bool Append() { return false; }
+  virtual bool Truncate() { return false; }
+  virtual bool Truncate(uint64_t) { return false; }
+
+  /// @returns the uncompressed size
+  virtual uint64_t GetCurrentSize();
+
+  virtual void SeekStart();
+  virtual uint64_t SeekEnd();
+  virtual uint64_t GetPos();
+  virtual void SeekPos(uint64_t iPos);
+
+  virtual size_t ReadRAW(unsigned char* pData, uint64_t iCount);
+  virtual size_t WriteRAW(const unsigned char*, uint64_t) { return 0; }
+  virtual size_t ReadRAWAt(unsigned char* pData, uint64_t iCount,
+                           uint64_t iPos) const;
+  virtual bool CopyRAW(uint64_t, uint64_t, uint64_t, unsigned char*,
+                       uint64_t) { return false; }
+  /// The compressed data is always read front to back; hints about the
+  /// uncompressed data do not apply to it.
+  virtual void Hint(IOHint, uint64_t, uint64_t) const {}
+
+  /// Keeps (at least) the last iBytes of output before the furthest read in
+  /// memory; 0 turns the window off.  A read outside the window moves it.
+  void SetWindow(uint64_t iBytes);
+
+  /// @returns the number of places decompression can restart from, as far
+  ///          as they are known yet.
+  size_t GetRestartPoints() const;
+  /// @returns true if the stream turned out to be corrupt, truncated, or,
+  ///          for gzip, did not match the CRC32 and size in its trailer.  All
+  ///          data up to the damage can still be read.
+  bool Failed() const;
+
+  /// the format specific part; defined in the .cpp
+  class Decoder;
+
+private:
+  CompressedRAWFile(const CompressedRAWFile&);
+  CompressedRAWFile& operator=(const CompressedRAWFile&);
+
+  Encoding                 m_eEncoding;
+  uint64_t                 m_iSize;
+  uint64_t                 m_iSpan;
+  uint64_t                 m_iPos;
+  std::unique_ptr<Decoder> m_pDecoder;
+  mutable CriticalSection  m_Guard;
+  /// ring buffer of the output in [m_iWindowBegin, m_iWindowEnd)
+  mutable std::vector<unsigned char> m_vWindow;
+  mutable uint64_t         m_iWindowBegin;
+  mutable uint64_t         m_iWindowEnd;
+};
+
+}
+#endif
@@ -43,6 +43,7 @@
 
 #include <Controller/Controller.h>
 #include <Basics/SysTools.h>
+#include <DebugOut/RecordingOut.h>
 
 #ifdef DEBUG_DICOM
   #define DICOM_DBG(...) Console::printf(__VA_ARGS__)
@@ -111,13 +112,21 @@ void DICOMParser::GetDirInfo(string  strDirectory) {
   vector<string> files = SysTools::GetDirContents(strDirectory);
   vector<DICOMFileInfo> fileInfos;
 
-  // query directory for DICOM files
+  // query directory for DICOM files.  The headers are parsed concurrently;
+  // what each parse logs is reported afterwards, file by file.
+  AbstrDebugOut& debugOut = tuvok::Controller::Debug::Out();
+  vector<DICOMFileInfo> infos(files.size());
+  vector<char> bIsDICOM(files.size(), 0);
+  vector<RecordingOut> logs(files.size(), RecordingOut(debugOut));
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0;i<int64_t(files.size());i++) {
+    logs[i].Message(_func_, "Looking for DICOM data in file %s",
+                    files[i].c_str());
+    bIsDICOM[i] = GetDICOMFileInfo(files[i], infos[i], logs[i]);
+  }
   for (size_t i = 0;i<files.size();i++) {
-    MESSAGE("Looking for DICOM data in file %s", files[i].c_str());
-    DICOMFileInfo info;
-    if (GetDICOMFileInfo(files[i], info)) {
-      fileInfos.push_back(info);
-    }
+    logs[i].Replay(debugOut);
+    if (bIsDICOM[i]) fileInfos.push_back(infos[i]);
   }
 
   // sort results into stacks
@@ -336,6 +345,12 @@ void DICOMParser::SkipUnusedElement(ifstream& fileDICOM, string& value, const ui
 
 bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
                                    DICOMFileInfo& info) {
+  return GetDICOMFileInfo(strFilename, info,
+                          tuvok::Controller::Debug::Out());
+}
+
+bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
+                                   DICOMFileInfo& info, AbstrDebugOut& out) {
   DICOM_DBG("Processing file %s\n",strFilename.c_str());
 
   LARGE_STAT_BUFFER stat_buf;
@@ -350,12 +365,13 @@ bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
 
   // check for basic properties
   if (!SysTools::GetFileStats(strFilename, stat_buf)) {// file must exist
-    MESSAGE("File '%s' can't be a DICOM -- doesn't exist.",
-            strFilename.c_str());
+    out.Message(_func_, "File '%s' can't be a DICOM -- doesn't exist.",
+                strFilename.c_str());
     return false;
   }
   if (stat_buf.st_size < 128+4) { // file has minimum length ?
-    MESSAGE("File '%s' can't be a DICOM -- too short.", strFilename.c_str());
+    out.Message(_func_, "File '%s' can't be a DICOM -- too short.",
+                strFilename.c_str());
     return false;
   }
 
@@ -375,7 +391,8 @@ bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
   char DICM[4];
   fileDICOM.read(DICM,4);
   if (DICM[0] != 'D' || DICM[1] != 'I' || DICM[2] != 'C' || DICM[3] != 'M') {
-    MESSAGE("File '%s' does not contain DICM meta header.", strFilename.c_str());
+    out.Message(_func_, "File '%s' does not contain DICM meta header.",
+                strFilename.c_str());
 
     // DICOM supports files without the meta header, 
     // in that case you have to guess the parameters
@@ -389,7 +406,8 @@ bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
                         iElemLength, bImplicit, bNeedsEndianConversion);
 
     if (iGroupID != 0x08) {
-      MESSAGE("File '%s' is not a DICM file.", strFilename.c_str());
+      out.Message(_func_, "File '%s' is not a DICM file.",
+                  strFilename.c_str());
       return false;
     }
 
@@ -411,7 +429,7 @@ bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
       switch (iElementID) {
         case 0x0 : {  // File Meta Elements Group Len
               if (iElemLength != 4) {
-                MESSAGE("Metaheader length field is invalid.");
+                out.Message(_func_, "Metaheader length field is invalid.");
                 return false;
               }
               int iMetaHeaderLength;
@@ -458,9 +476,9 @@ bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
                 info.m_bIsBigEndian = false;
                 DICOM_DBG("DICOM file is JPEG Explicit VR Big Endian\n");
               } else {
-                WARNING("Unknown DICOM type '%s' -- not a DICOM? "
-                        "Might just be something we haven't seen: please "
-                        "send a debug log.", value.c_str());
+                out.Warning(_func_, "Unknown DICOM type '%s' -- not a "
+                            "DICOM? Might just be something we haven't "
+                            "seen: please send a debug log.", value.c_str());
                 return false; // unsupported file format
               }
               fileDICOM.seekg(iMetaHeaderEnd, std::ios_base::beg);
@@ -798,12 +816,13 @@ bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
         // and fake an offset -- we're screwed at that point anyway.
         size_t offset = static_cast<size_t>(fileDICOM.tellg());
         if(static_cast<int>(fileDICOM.tellg()) == -1) {
-          T_ERROR("JPEG offset unknown; DICOM parsing failed.  "
-                  "Assuming offset 0.  Please send a debug log.");
+          out.Error(_func_, "JPEG offset unknown; DICOM parsing failed.  "
+                    "Assuming offset 0.  Please send a debug log.");
           offset = 4;  // make sure it won't underflow in the next line.
         }
         offset -= 4;
-        MESSAGE("JPEG is at offset: %u", static_cast<uint32_t>(offset));
+        out.Message(_func_, "JPEG is at offset: %u",
+                    static_cast<uint32_t>(offset));
         info.SetOffsetToData(static_cast<uint32_t>(offset));
       } else {
         if (iPixelDataSize != iDataSizeInFile) {
@@ -875,8 +894,9 @@ bool DICOMParser::GetDICOMFileInfo(const string& strFilename,
     if (!bOK) {
       // ok everthing failed than let's just use the data we have so far,
       // and let's hope that the file ends with the data
-      WARNING("Trouble parsing DICOM file; assuming data starts at %u",
-              static_cast<unsigned int>(iFileLength - size_t(iPixelDataSize)));
+      out.Warning(_func_, "Trouble parsing DICOM file; assuming data starts "
+                  "at %u", static_cast<unsigned int>(iFileLength -
+                                                     size_t(iPixelDataSize)));
       info.SetOffsetToData(uint32_t(iFileLength - size_t(iPixelDataSize)));
     }
   }
@@ -54,6 +54,8 @@
 #include "../../Basics/Vectors.h"
 #include "../../Basics/EndianConvert.h"
 
+class AbstrDebugOut;
+
 class SimpleDICOMFileInfo : public SimpleFileInfo {
 public:
   SimpleDICOMFileInfo();
@@ -163,6 +165,9 @@ public:
   virtual void GetDirInfo(std::wstring wstrDirectory);
 
   static bool GetDICOMFileInfo(const std::string& fileName, DICOMFileInfo& info);
+  /// As above, but logs to 'out' instead of the debug output.
+  static bool GetDICOMFileInfo(const std::string& fileName, DICOMFileInfo& info,
+                               AbstrDebugOut& out);
 protected:
   static void ReadSizedElement(std::ifstream& fileDICOM, std::string& value, 
                                 const uint32_t iElemLength);
@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include "DataMerger.h"
+#include "Basics/LargeRAWFile.h"
+#include "Basics/SysTools.h"
+#include "Basics/Threads.h"
+#include "DebugOut/AbstrDebugOut.h"
+
+// SSE2 is part of every x86-64 target; elsewhere the kernels go one
+// element at a time.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define TUVOK_MERGE_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace tuvok {
+
+namespace {
+  // ------------------------------------------------------ scalar kernels
+
+  template<class T> T Saturate(double v) {
+    const double lo = double(std::numeric_limits<T>::lowest());
+    const double hi = double(std::numeric_limits<T>::max());
+    if(v < lo) { return std::numeric_limits<T>::lowest(); }
+    // 'hi' is rounded up for 64 bit integers, so it must not be cast back
+    if(v >= hi) { return std::numeric_limits<T>::max(); }
+    return T(v);
+  }
+
+  template<class T>
+  void ScaleBiasScalar(T* p, size_t count, double fScale, double fBias) {
+    for(size_t i=0; i < count; ++i) {
+      p[i] = Saturate<T>(fScale*(double(p[i]) + fBias));
+    }
+  }
+
+  template<class T> T Add(T a, T b, std::true_type /* integer */) {
+    if(std::numeric_limits<T>::is_signed) {
+      if(b > 0 && a > std::numeric_limits<T>::max() - b) {
+        return std::numeric_limits<T>::max();
+      }
+      if(b < 0 && a < std::numeric_limits<T>::lowest() - b) {
+        return std::numeric_limits<T>::lowest();
+      }
+      return T(a + b);
+    }
+    const T s = T(a + b);
+    return s < a ? std::numeric_limits<T>::max() : s;
+  }
+  template<class T> T Add(T a, T b, std::false_type /* floating point */) {
+    return a + b;
+  }
+
+  template<class T>
+  void CombineScalar(T* pTarget, const T* pSource, size_t count,
+                     bool bUseMaxMode) {
+    typedef std::integral_constant<bool, std::numeric_limits<T>::is_integer>
+      integer;
+    if(bUseMaxMode) {
+      for(size_t i=0; i < count; ++i) {
+        pTarget[i] = std::max(pTarget[i], pSource[i]);
+      }
+    } else {
+      for(size_t i=0; i < count; ++i) {
+        pTarget[i] = Add(pTarget[i], pSource[i], integer());
+      }
+    }
+  }
+
+  // Without SSE2, or for types it has no saturating arithmetic for, these
+  // are all there is.
+  template<class T>
+  void ScaleBias(T* p, size_t count, double fScale, double fBias) {
+    ScaleBiasScalar(p, count, fScale, fBias);
+  }
+  template<class T>
+  void Combine(T* pTarget, const T* pSource, size_t count, bool bUseMaxMode) {
+    CombineScalar(pTarget, pSource, count, bUseMaxMode);
+  }
+
+#ifdef TUVOK_MERGE_SSE2
+  // -------------------------------------------------------- SSE2 kernels
+
+  // Scale and bias run in double precision, in the same order as the scalar
+  // code, so both give identical results.  Operands of min/max are ordered
+  // such that a NaN passes through like it does in Saturate.
+
+  struct ScaleBiasSSE {
+    ScaleBiasSSE(double fScale, double fBias, double fLow, double fHigh) :
+      s(_mm_set1_pd(fScale)), b(_mm_set1_pd(fBias)),
+      lo(_mm_set1_pd(fLow)), hi(_mm_set1_pd(fHigh)) {}
+
+    __m128d operator()(__m128d v) const {
+      return _mm_min_pd(hi, _mm_max_pd(lo, _mm_mul_pd(s, _mm_add_pd(v, b))));
+    }
+    // four int32 lanes; the results are rounded toward zero
+    __m128i Int4(__m128i v) const {
+      const __m128i a = _mm_cvttpd_epi32((*this)(_mm_cvtepi32_pd(v)));
+      const __m128i c = _mm_cvttpd_epi32(
+        (*this)(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v))));
+      return _mm_unpacklo_epi64(a, c);
+    }
+    // eight int16 lanes whose results fit int16 again
+    __m128i Short8(__m128i v) const {
+      const __m128i lo32 = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      const __m128i hi32 = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      return _mm_packs_epi32(Int4(lo32), Int4(hi32));
+    }
+
+    __m128d s, b, lo, hi;
+  };
+
+  template<class T> ScaleBiasSSE MakeScaleBias(double fScale, double fBias) {
+    return ScaleBiasSSE(fScale, fBias,
+                        double(std::numeric_limits<T>::lowest()),
+                        double(std::numeric_limits<T>::max()));
+  }
+
+  void ScaleBias(int8_t* p, size_t count, double fScale, double fBias) {
+    const ScaleBiasSSE sb = MakeScaleBias<int8_t>(fScale, fBias);
+    size_t i = 0;
+    for(; i+16 <= count; i += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i*>(p+i));
+      const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+      const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p+i),
+                       _mm_packs_epi16(sb.Short8(lo), sb.Short8(hi)));
+    }
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  void ScaleBias(uint8_t* p, size_t count, double fScale, double fBias) {
+    const ScaleBiasSSE sb = MakeScaleBias<uint8_t>(fScale, fBias);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i+16 <= count; i += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i*>(p+i));
+      const __m128i lo = _mm_unpacklo_epi8(v, zero);
+      const __m128i hi = _mm_unpackhi_epi8(v, zero);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p+i),
+                       _mm_packus_epi16(sb.Short8(lo), sb.Short8(hi)));
+    }
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  void ScaleBias(int16_t* p, size_t count, double fScale, double fBias) {
+    const ScaleBiasSSE sb = MakeScaleBias<int16_t>(fScale, fBias);
+    size_t i = 0;
+    for(; i+8 <= count; i += 8) {
+      __m128i* q = reinterpret_cast<__m128i*>(p+i);
+      _mm_storeu_si128(q, sb.Short8(_mm_loadu_si128(q)));
+    }
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  void ScaleBias(uint16_t* p, size_t count, double fScale, double fBias) {
+    const ScaleBiasSSE sb = MakeScaleBias<uint16_t>(fScale, fBias);
+    const __m128i zero = _mm_setzero_si128();
+    // SSE2 can only pack with signed saturation; shift the range
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16(-32768);
+    size_t i = 0;
+    for(; i+8 <= count; i += 8) {
+      __m128i* q = reinterpret_cast<__m128i*>(p+i);
+      const __m128i v = _mm_loadu_si128(q);
+      const __m128i lo = _mm_sub_epi32(sb.Int4(_mm_unpacklo_epi16(v, zero)),
+                                       bias32);
+      const __m128i hi = _mm_sub_epi32(sb.Int4(_mm_unpackhi_epi16(v, zero)),
+                                       bias32);
+      _mm_storeu_si128(q, _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16));
+    }
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  void ScaleBias(float* p, size_t count, double fScale, double fBias) {
+    const ScaleBiasSSE sb = MakeScaleBias<float>(fScale, fBias);
+    size_t i = 0;
+    for(; i+4 <= count; i += 4) {
+      const __m128 v = _mm_loadu_ps(p+i);
+      const __m128 lo = _mm_cvtpd_ps(sb(_mm_cvtps_pd(v)));
+      const __m128 hi = _mm_cvtpd_ps(sb(_mm_cvtps_pd(_mm_movehl_ps(v, v))));
+      _mm_storeu_ps(p+i, _mm_movelh_ps(lo, hi));
+    }
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  void ScaleBias(double* p, size_t count, double fScale, double fBias) {
+    const ScaleBiasSSE sb = MakeScaleBias<double>(fScale, fBias);
+    size_t i = 0;
+    for(; i+2 <= count; i += 2) {
+      _mm_storeu_pd(p+i, sb(_mm_loadu_pd(p+i)));
+    }
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  // The combining kernels differ in their two instructions only.
+  template<class T, class Max, class Add>
+  void CombineSSE(T* pTarget, const T* pSource, size_t count,
+                  bool bUseMaxMode, Max max, Add add) {
+    const size_t iLanes = 16 / sizeof(T);
+    size_t i = 0;
+    if(bUseMaxMode) {
+      for(; i+iLanes <= count; i += iLanes) {
+        __m128i* t = reinterpret_cast<__m128i*>(pTarget+i);
+        const __m128i* s = reinterpret_cast<const __m128i*>(pSource+i);
+        _mm_storeu_si128(t, max(_mm_loadu_si128(t), _mm_loadu_si128(s)));
+      }
+    } else {
+      for(; i+iLanes <= count; i += iLanes) {
+        __m128i* t = reinterpret_cast<__m128i*>(pTarget+i);
+        const __m128i* s = reinterpret_cast<const __m128i*>(pSource+i);
+        _mm_storeu_si128(t, add(_mm_loadu_si128(t), _mm_loadu_si128(s)));
+      }
+    }
+    CombineScalar(pTarget+i, pSource+i, count-i, bUseMaxMode);
+  }
+
+  __m128i MaxI8(__m128i a, __m128i b) {
+    const __m128i gt = _mm_cmpgt_epi8(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+  }
+  __m128i MaxU8(__m128i a, __m128i b) { return _mm_max_epu8(a, b); }
+  __m128i MaxI16(__m128i a, __m128i b) { return _mm_max_epi16(a, b); }
+  __m128i MaxU16(__m128i a, __m128i b) {
+    return _mm_adds_epu16(_mm_subs_epu16(a, b), b);
+  }
+  __m128i AddI8(__m128i a, __m128i b) { return _mm_adds_epi8(a, b); }
+  __m128i AddU8(__m128i a, __m128i b) { return _mm_adds_epu8(a, b); }
+  __m128i AddI16(__m128i a, __m128i b) { return _mm_adds_epi16(a, b); }
+  __m128i AddU16(__m128i a, __m128i b) { return _mm_adds_epu16(a, b); }
+
+  void Combine(int8_t* t, const int8_t* s, size_t n, bool bMax) {
+    CombineSSE(t, s, n, bMax, MaxI8, AddI8);
+  }
+  void Combine(uint8_t* t, const uint8_t* s, size_t n, bool bMax) {
+    CombineSSE(t, s, n, bMax, MaxU8, AddU8);
+  }
+  void Combine(int16_t* t, const int16_t* s, size_t n, bool bMax) {
+    CombineSSE(t, s, n, bMax, MaxI16, AddI16);
+  }
+  void Combine(uint16_t* t, const uint16_t* s, size_t n, bool bMax) {
+    CombineSSE(t, s, n, bMax, MaxU16, AddU16);
+  }
+
+  void Combine(float* pTarget, const float* pSource, size_t count,
+               bool bUseMaxMode) {
+    size_t i = 0;
+    for(; i+4 <= count; i += 4) {
+      const __m128 t = _mm_loadu_ps(pTarget+i);
+      const __m128 s = _mm_loadu_ps(pSource+i);
+      // std::max(t, s) keeps t unless t < s
+      _mm_storeu_ps(pTarget+i, bUseMaxMode ? _mm_max_ps(s, t)
+                                           : _mm_add_ps(t, s));
+    }
+    CombineScalar(pTarget+i, pSource+i, count-i, bUseMaxMode);
+  }
+  void Combine(double* pTarget, const double* pSource, size_t count,
+               bool bUseMaxMode) {
+    size_t i = 0;
+    for(; i+2 <= count; i += 2) {
+      const __m128d t = _mm_loadu_pd(pTarget+i);
+      const __m128d s = _mm_loadu_pd(pSource+i);
+      _mm_storeu_pd(pTarget+i, bUseMaxMode ? _mm_max_pd(s, t)
+                                           : _mm_add_pd(t, s));
+    }
+    CombineScalar(pTarget+i, pSource+i, count-i, bUseMaxMode);
+  }
+#endif
+
+  /// The fixed width type with T's representation, which picks the kernel;
+  /// 'char' and 'short' would not find the int8_t/int16_t overloads.
+  template<class T, bool bInteger = std::numeric_limits<T>::is_integer,
+           size_t iSize = sizeof(T)>
+  struct Lanes { typedef T type; };
+  template<class T> struct Lanes<T, true, 1> {
+    typedef typename std::conditional<std::numeric_limits<T>::is_signed,
+                                      int8_t, uint8_t>::type type;
+  };
+  template<class T> struct Lanes<T, true, 2> {
+    typedef typename std::conditional<std::numeric_limits<T>::is_signed,
+                                      int16_t, uint16_t>::type type;
+  };
+
+  /// Maps and combines one chunk of all inputs into the first one, a tile
+  /// at a time so that the data stays in cache.
+  template<class T>
+  void CombineChunk(std::vector<std::vector<T>>& vInputs, size_t iCount,
+                    const std::vector<MergeDataset>& vFiles,
+                    bool bUseMaxMode) {
+    const size_t iTile = 16384 / sizeof(T);
+    const int64_t iTiles = int64_t((iCount + iTile - 1) / iTile);
+#pragma omp parallel for schedule(static)
+    for(int64_t t = 0; t < iTiles; ++t) {
+      const size_t iFirst = size_t(t) * iTile;
+      const size_t n = std::min(iTile, iCount - iFirst);
+      T* pTarget = &vInputs[0][iFirst];
+      MergeScaleBias(pTarget, n, vFiles[0].fScale, vFiles[0].fBias);
+      for(size_t i = 1; i < vInputs.size(); ++i) {
+        T* pSource = &vInputs[i][iFirst];
+        MergeScaleBias(pSource, n, vFiles[i].fScale, vFiles[i].fBias);
+        MergeCombine(pTarget, pSource, n, bUseMaxMode);
+      }
+    }
+  }
+}
+
+template <class T>
+void MergeScaleBias(T* pData, size_t count, double fScale, double fBias) {
+  // by far the most common case, and exact even where doubles are not
+  if(fScale == 1.0 && fBias == 0.0) { return; }
+  typedef typename Lanes<T>::type L;
+  ScaleBias(reinterpret_cast<L*>(pData), count, fScale, fBias);
+}
+
+template <class T>
+void MergeCombine(T* pTarget, const T* pSource, size_t count,
+                  bool bUseMaxMode) {
+  typedef typename Lanes<T>::type L;
+  Combine(reinterpret_cast<L*>(pTarget), reinterpret_cast<const L*>(pSource),
+          count, bUseMaxMode);
+}
+
+template <class T>
+DataMerger<T>::DataMerger(const std::vector<MergeDataset>& strFiles,
+                          const std::string& strTarget, uint64_t iElemCount,
+                          AbstrDebugOut& dbg, bool bUseMaxMode) :
+  bIsOK(false)
+{
+  const size_t iInputs = strFiles.size();
+  if(iInputs == 0) { return; }
+
+  std::vector<std::shared_ptr<LargeRAWFile>> vSources(iInputs);
+  for(size_t i = 0; i < iInputs; ++i) {
+    vSources[i].reset(new LargeRAWFile(strFiles[i].strFilename,
+                                       strFiles[i].iHeaderSkip));
+    if(!vSources[i]->Open(false)) {
+      dbg.Error(_func_, "Could not open '%s'!",
+                strFiles[i].strFilename.c_str());
+      return;
+    }
+    vSources[i]->Hint(LargeRAWFile::SEQUENTIAL, 0, iElemCount*sizeof(T));
+  }
+
+  LargeRAWFile target(strTarget);
+  if(!target.Create()) {
+    dbg.Error(_func_, "Could not open '%s'", strTarget.c_str());
+    return;
+  }
+
+  dbg.Message(_func_, "Merging %u files into %s ...",
+              static_cast<unsigned>(iInputs),
+              SysTools::GetFilename(strTarget).c_str());
+
+  // One set of buffers is combined and written while the other is read.
+  const uint64_t iChunk = std::max<uint64_t>(1, std::min<uint64_t>(
+    iElemCount, BLOCK_COPY_SIZE / (2*iInputs) / sizeof(T)));
+  std::vector<std::vector<T>> vBuffers[2];
+  std::vector<size_t> vRead[2];
+  for(size_t b = 0; b < 2; ++b) {
+    vBuffers[b].assign(iInputs, std::vector<T>(size_t(iChunk)));
+    vRead[b].assign(iInputs, 0);
+  }
+  auto read = [&vSources, &vBuffers, &vRead](size_t iBuffer, size_t iCount) {
+    for(size_t i = 0; i < vSources.size(); ++i) {
+      vRead[iBuffer][i] = vSources[i]->ReadRAW(
+        reinterpret_cast<unsigned char*>(&vBuffers[iBuffer][i][0]),
+        iCount*sizeof(T));
+    }
+  };
+
+  bool bOK = true;
+  std::unique_ptr<LambdaThread> reader;
+  read(0, size_t(std::min(iChunk, iElemCount)));
+  for(uint64_t iFirst = 0, k = 0; iFirst < iElemCount && bOK;
+      iFirst += iChunk, ++k) {
+    const size_t iBuffer = size_t(k % 2);
+    const size_t iCount = size_t(std::min(iChunk, iElemCount - iFirst));
+    if(reader) { reader->JoinThread(); }
+    for(size_t i = 0; i < iInputs; ++i) {
+      if(vRead[iBuffer][i] != iCount*sizeof(T)) {
+        dbg.Error(_func_, "'%s' ended before we expected.",
+                  strFiles[i].strFilename.c_str());
+        bOK = false;
+        break;
+      }
+    }
+    if(!bOK) { break; }
+
+    const uint64_t iNext = iFirst + iCount;
+    if(iNext < iElemCount) {
+      const size_t iNextCount = size_t(std::min(iChunk, iElemCount - iNext));
+      reader.reset(new LambdaThread(
+        [&read, iBuffer, iNextCount](bool const&, LambdaThread::Interface&) {
+          read(1 - iBuffer, iNextCount);
+        }
+      ));
+      reader->StartThread();
+    } else {
+      reader.reset();
+    }
+
+    CombineChunk(vBuffers[iBuffer], iCount, strFiles, bUseMaxMode);
+    if(target.WriteRAW(
+         reinterpret_cast<unsigned char*>(&vBuffers[iBuffer][0][0]),
+         iCount*sizeof(T)) != iCount*sizeof(T)) {
+      dbg.Error(_func_, "Could not write to '%s'", strTarget.c_str());
+      bOK = false;
+    }
+    dbg.Message(_func_, "Merging ...\n%u%%",
+                static_cast<unsigned>((100*iNext) / iElemCount));
+  }
+  if(reader) { reader->JoinThread(); }
+  target.Close();
+
+  if(!bOK) {
+    remove(strTarget.c_str());
+    return;
+  }
+  bIsOK = true;
+}
+
+#define TUVOK_MERGE_INSTANTIATE(T)                                       \
+  template class DataMerger<T>;                                          \
+  template void MergeScaleBias<T>(T*, size_t, double, double);           \
+  template void MergeCombine<T>(T*, const T*, size_t, bool);
+
+TUVOK_MERGE_INSTANTIATE(char)
+TUVOK_MERGE_INSTANTIATE(unsigned char)
+TUVOK_MERGE_INSTANTIATE(short)
+TUVOK_MERGE_INSTANTIATE(unsigned short)
+TUVOK_MERGE_INSTANTIATE(int)
+TUVOK_MERGE_INSTANTIATE(unsigned int)
+TUVOK_MERGE_INSTANTIATE(int64_t)
+TUVOK_MERGE_INSTANTIATE(uint64_t)
+TUVOK_MERGE_INSTANTIATE(float)
+TUVOK_MERGE_INSTANTIATE(double)
+
+#undef TUVOK_MERGE_INSTANTIATE
+}
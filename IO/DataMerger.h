@@ -0,0 +1,67 @@
+#ifndef TUVOK_DATA_MERGER_H
+#define TUVOK_DATA_MERGER_H
+
+#include "StdTuvokDefines.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class AbstrDebugOut;
+
+namespace tuvok {
+
+/// One of the volumes DataMerger combines.  Its voxels v enter the merge as
+/// fScale*(v + fBias), clamped to the range of the data type.
+class MergeDataset {
+public:
+  MergeDataset(std::string _strFilename="", uint64_t _iHeaderSkip=0, bool _bDelete=false,
+               double _fScale=1.0, double _fBias=0.0) :
+    strFilename(_strFilename),
+    iHeaderSkip(_iHeaderSkip),
+    bDelete(_bDelete),
+    fScale(_fScale),
+    fBias(_fBias)
+  {}
+
+  std::string strFilename;
+  uint64_t iHeaderSkip;
+  bool bDelete;
+  double fScale;
+  double fBias;
+};
+
+/// Combines RAW volumes of the same size and type voxel by voxel into
+/// 'strTarget', either by their maximum or by their sum, saturating at the
+/// limits of T.  All inputs are streamed at once, in large chunks which a
+/// separate thread reads ahead while the previous chunk is combined, so the
+/// target is written exactly once.
+template <class T> class DataMerger {
+public:
+  DataMerger(const std::vector<MergeDataset>& strFiles,
+             const std::string& strTarget, uint64_t iElemCount,
+             AbstrDebugOut& dbg, bool bUseMaxMode);
+
+  bool IsOK() const {return bIsOK;}
+
+private:
+  bool bIsOK;
+};
+
+/// The kernels behind DataMerger.
+///@{
+
+/// Replaces each of the 'count' elements v by fScale*(v + fBias), clamped to
+/// the range of T and rounded toward zero.
+template <class T>
+void MergeScaleBias(T* pData, size_t count, double fScale, double fBias);
+
+/// Replaces each of the 'count' elements of 'pTarget' by its maximum with,
+/// or its sum with, the corresponding element of 'pSource'.  Sums saturate
+/// at the limits of integer types.
+template <class T>
+void MergeCombine(T* pTarget, const T* pSource, size_t count,
+                  bool bUseMaxMode);
+
+///@}
+}
+#endif
@@ -31,12 +31,28 @@
            SCI Institute
            University of Utah
 */
+#include <algorithm>
 #include "Dataset.h"
 #include "Basics/MathTools.h"
 #include "Basics/Mesh.h"
 
 namespace tuvok {
 
+namespace {
+  template<typename T>
+  bool ReadBricks(const Dataset& ds, const std::vector<BrickKey>& keys,
+                  std::vector<std::vector<T>>& data) {
+    data.resize(keys.size());
+    std::vector<char> ok(keys.size(), 0);
+    const int n = static_cast<int>(keys.size());
+#pragma omp parallel for schedule(dynamic) if(n > 1 && ds.ConcurrentGetBrick())
+    for(int i=0; i < n; ++i) {
+      ok[i] = ds.GetBrick(keys[i], data[i]);
+    }
+    return std::find(ok.begin(), ok.end(), 0) == ok.end();
+  }
+}
+
 Dataset::Dataset():
   m_UserScale(1.0,1.0,1.0),
   m_DomainScale(1.0, 1.0, 1.0)
@@ -61,6 +77,46 @@ DOUBLEVECTOR3 Dataset::GetRescaleFactors() const {
   return m_UserScale;
 }
 
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<uint8_t>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<int8_t>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<uint16_t>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<int16_t>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<uint32_t>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<int32_t>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<float>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
+bool Dataset::GetBricks(const std::vector<BrickKey>& keys,
+                        std::vector<std::vector<double>>& data) const {
+  return ReadBricks(*this, keys, data);
+}
+
 std::pair<FLOATVECTOR3, FLOATVECTOR3>
 Dataset::GetTextCoords(BrickTable::const_iterator brick,
                        bool bUseOnlyPowerOfTwo) const {
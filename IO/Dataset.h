@@ -99,6 +99,33 @@ public:
   virtual bool GetBrick(const BrickKey&, std::vector<float>&) const=0;
   virtual bool GetBrick(const BrickKey&, std::vector<double>&) const=0;
   ///@}
+  /// Reads several bricks at once; one output vector per key.  The default
+  /// calls GetBrick for each key, concurrently if ConcurrentGetBrick().
+  /// @return false if any of the bricks could not be read.
+  ///@{
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<uint8_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<int8_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<uint16_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<int16_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<uint32_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<int32_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<float>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<double>>&) const;
+  ///@}
+  /// Announces bricks which will be requested via GetBrick soon, so that
+  /// their data can be read in the background.  Advisory only; the default
+  /// does nothing.
+  virtual void Prefetch(const std::vector<BrickKey>&) const { }
+  /// Whether GetBrick may be called from several threads at once.
+  virtual bool ConcurrentGetBrick() const { return false; }
   virtual BrickTable::const_iterator BricksBegin() const = 0;
   virtual BrickTable::const_iterator BricksEnd() const = 0;
   /// @return the number of bricks in a given LoD + timestep.
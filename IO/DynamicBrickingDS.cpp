@@ -5,19 +5,21 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
-#include <fstream>
-#include <sstream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <typeinfo>
 #include <unordered_map>
 #include "Basics/SysTools.h"
 #include "BMinMax.h"
 #include "Controller/Controller.h"
 #include "Controller/StackTimer.h"
 #include "BrickCache.h"
+#include "BrickView.h"
 #include "DynamicBrickingDS.h"
 #include "FileBackedDataset.h"
 #include "IOManager.h"
+#include "MinMaxIndex.h"
 #include "uvfDataset.h"
 
 // This file deals with some tricky indexing.  The convention here is that a
@@ -33,11 +35,19 @@ typedef std::array<size_t,3> BrickSize;
 
 namespace tuvok {
 
-struct GBPrelim {
-  const BrickKey skey;
-  const BrickSize tgt_bs;
-  const BrickSize src_bs;
+// One source brick's share of a target brick: the box of 'extent' voxels at
+// 'src_offset' in source brick 'skey' ends up at 'tgt_offset' in the target.
+struct SourcePiece {
+  BrickKey skey;
+  BrickSize src_bs;
   VoxelIndex src_offset;
+  VoxelIndex tgt_offset;
+  BrickSize extent;
+};
+
+struct GBPrelim {
+  BrickSize tgt_bs;
+  std::vector<SourcePiece> pieces; ///< exactly one, unless rebricking upward
 };
 
 struct DynamicBrickingDS::dbinfo {
@@ -52,29 +62,46 @@ struct DynamicBrickingDS::dbinfo {
          BrickSize bs, size_t bytes, enum MinMaxMode mm) :
     ds(d), brickSize(bs), cacheBytes(bytes), mmMode(mm) {}
 
-  // early, non-type-specific parts of GetBrick.
-  GBPrelim BrickSetup(const BrickKey&, const DynamicBrickingDS& tgt) const;
+  // early, non-type-specific parts of GetBrick: which parts of which source
+  // bricks make up the given target brick.
+  GBPrelim BrickSetup(const BrickKey&) const;
+
+  // gives the source brick from the cache, reading it if need be.
+  template<typename T> std::shared_ptr<const void> Source(const BrickKey& skey);
+  // the parts of Source: the cache lookup, the read, and handing the data
+  // read over to the cache.
+  template<typename T> std::shared_ptr<const void> Cached(const BrickKey&);
+  template<typename T> bool Load(const BrickKey&, std::vector<T>&) const;
+  template<typename T> std::shared_ptr<const void> Keep(const BrickKey&,
+                                                        std::vector<T>&);
+  // asks the source to read ahead those source bricks which are not cached.
+  template<typename T> void Prefetch(std::vector<BrickKey> skeys);
 
   // reads the brick + handles caching
   template<typename T> bool Brick(const DynamicBrickingDS& ds,
                                   const BrickKey& key,
                                   std::vector<T>& data);
+  // like Brick, but just gives a view of the (cached) source data.  Only
+  // possible for bricks which come from a single source brick.
+  template<typename T> bool View(const DynamicBrickingDS& ds,
+                                 const BrickKey& key,
+                                 BrickView<T>& view);
 
-  // given the brick key in the dynamic DS, return the corresponding BrickKey
-  // in the source data.
-  BrickKey SourceBrickKey(const BrickKey&) const;
+  // given the brick key in the dynamic DS, return the corresponding
+  // BrickKeys in the source data.
+  std::vector<BrickKey> SourceBrickKeys(const BrickKey&) const;
 
   BrickLayout TargetBrickLayout(size_t lod, size_t ts) const;
 
-  /// since ComputeMinMaxes is soooo absurdly slow, we try to cache the
-  /// results.  These load/save all our min/maxes to a stream.
-  ///@{
-  void LoadMinMax(std::istream&);
-  void SaveMinMax(std::ostream&) const;
-  ///@}
-
-  /// run through all of the bricks and compute min/max info.
-  void ComputeMinMaxes(BrickedDataset&);
+  /// run through all of the bricks and compute min/max info.  Results are
+  /// kept in a MinMaxIndex next to the source data, so only bricks which are
+  /// not in the index yet are computed.
+  void ComputeMinMaxes(const DynamicBrickingDS&);
+  /// computes the min/max of the given target bricks and records them in
+  /// 'minmax' and, if there is one, the index.
+  template<typename T> void ComputeMinMaxes(const DynamicBrickingDS&,
+                                            const std::vector<BrickKey>& todo,
+                                            MinMaxIndex* index);
 
   // sets the cache size (bytes)
   void SetCacheSize(size_t bytes);
@@ -88,11 +115,6 @@ struct DynamicBrickingDS::dbinfo {
 
   /// @returns the size of the brick, minus any ghost voxels.
   BrickSize BrickSansGhost() const;
-
-  template<typename T, typename Iter>
-  bool CopyBrick(std::vector<T>& dest, Iter src, size_t components,
-                 const BrickSize tgt_bs, const BrickSize src_bs,
-                 VoxelIndex src_offset);
 };
 
 static BrickSize SourceMaxBrickSize(const BrickedDataset&);
@@ -170,7 +192,7 @@ size_t DynamicBrickingDS::GetCacheSize() const {
 void DynamicBrickingDS::Clear() {
   di->ds->Clear();
   while(this->di->cache.size() > 0) { this->di->cache.remove(); }
-  BrickedDataset::Clear();
+  LinearIndexDataset::Clear();
   this->Rebrick();
 }
 
@@ -241,96 +263,42 @@ static const BrickLayout GenericBrickLayout(
   return blayout;
 }
 
-// identifies the number of bricks we have in the target dataset for
-// each brick in the source dataset. that is, how many bricks we're
-// stuffing into one brick.
-// this fits in integer numbers because we enforce that rebricking subdivides
-// the original volume/bricks nicely.
-static std::array<unsigned,3> TargetBricksPerSource(BrickSize src,
-                                                    BrickSize tgt) {
-  std::array<unsigned,3> rv = {{
-    static_cast<unsigned>(src[0] / tgt[0]),
-    static_cast<unsigned>(src[1] / tgt[1]),
-    static_cast<unsigned>(src[2] / tgt[2])
-  }};
-  assert(rv[0] > 0);
-  assert(rv[1] > 0);
-  assert(rv[2] > 0);
-  return rv;
-}
-
-// with a brick identifier from the target dataset, find the 3D brick index in
-// the source dataset.
-// basic idea:
-//   1. how many voxels do we have in this LOD?  how big are our bricks?
-//   2. values in (1) should divide evenly; this lets us convert VOXEL indices
-//      to BRICK indices.
-//   3. we know how our 3D bricks are layed out via (2); use that to convert
-//      our 1D-brick-index into a 3D-brick-index
-//   4. identify how many bricks we have in the target data set for each brick
-//      in the source dataset.
-//   5. divide the computed index (3) by our ratio (4).  lop off any remainder.
-static BrickIndex SourceBrickIndex(const BrickKey& k,
-                                   const BrickedDataset& ds,
-                                   const BrickSize bsize)
-{
-  // See the comment Rebrick: we shouldn't have more LODs than the source data.
-  assert(std::get<1>(k) < ds.GetLODLevelCount());
-  const size_t lod = std::min(std::get<1>(k),
-                              static_cast<size_t>(ds.GetLODLevelCount()));
-  const size_t timestep = std::get<0>(k);
-  // identify how many voxels we've got
-  const VoxelLayout voxels = {{
-    ds.GetDomainSize(lod, timestep)[0],
-    ds.GetDomainSize(lod, timestep)[1],
-    ds.GetDomainSize(lod, timestep)[2]
-  }};
-  // now we know how many voxels we've got.  we can use that to convert the 1D
-  // index we have back into the 3D index.
-  const size_t idx1d = std::get<2>(k);
-  BrickIndex idx = to3d(layout(voxels, BrickSansGhost(bsize)), idx1d);
-
-  const BrickSize tgt_bs = BrickSansGhost(bsize);
-  const BrickSize src_bs = SourceMaxBrickSize(ds);
-  const std::array<unsigned,3> bricks_per_src =
-    TargetBricksPerSource(src_bs, tgt_bs);
-  BrickIndex rv = {{
-    idx[0] / bricks_per_src[0],
-    idx[1] / bricks_per_src[1],
-    idx[2] / bricks_per_src[2]
-  }};
-  return rv;
-}
+// One dimension of the mapping from a target brick to the source bricks it
+// is made of: 'extent' voxels starting at 'src_offset' in source brick
+// 'brick' land at 'tgt_offset' in the target brick.
+struct Span {
+  unsigned brick;
+  uint64_t src_offset;
+  uint64_t tgt_offset;
+  uint64_t extent;
+};
 
-static VoxelIndex OffsetIntoSource(const BrickedDataset& src,
-                                   const BrickKey& tgtkey,
-                                   const BrickSize bsize /* target */)
-{
-  // See the comment Rebrick: we shouldn't have more LODs than the source data.
-  assert(std::get<1>(tgtkey) < src.GetLODLevelCount());
-  const size_t lod = std::min(std::get<1>(tgtkey),
-                              static_cast<size_t>(src.GetLODLevelCount()));
-  const size_t timestep = std::get<0>(tgtkey);
-  // identify how many voxels we've got
-  const VoxelLayout voxels = {{
-    src.GetDomainSize(lod, timestep)[0],
-    src.GetDomainSize(lod, timestep)[1],
-    src.GetDomainSize(lod, timestep)[2]
-  }};
-  // now we know how many voxels we've got.  we can use that to convert the 1D
-  // index we have back into the 3D index.
-  const size_t idx1d = std::get<2>(tgtkey);
-  BrickIndex idx = to3d(layout(voxels, BrickSansGhost(bsize)), idx1d);
-
-  const BrickSize tgt_bs = BrickSansGhost(bsize);
-  const BrickSize src_bs = SourceMaxBrickSize(src);
-  const std::array<unsigned,3> bricks_per_src =
-    TargetBricksPerSource(src_bs, tgt_bs);
-  VoxelIndex rv = {{
-    (idx[0] % bricks_per_src[0]) * tgt_bs[0],
-    (idx[1] % bricks_per_src[1]) * tgt_bs[1],
-    (idx[2] % bricks_per_src[2]) * tgt_bs[2]
-  }};
+// Computes the spans, along one dimension, for target brick 't'.  Rebricking
+// enforces that target and source brick sizes (sans ghost) nest: if the
+// target is smaller, a target brick sits inside a single source brick; if it
+// is larger, it is stitched together from several source bricks.  Each
+// source brick contributes its interior; the first one also contributes the
+// leading ghost voxels, the last one the trailing ghost voxels.
+// @param tgt the target brick size, sans ghost
+// @param src the source brick size, sans ghost
+// @param voxels the number of voxels in this dimension of the LOD
+// @param h ghost voxels on either side of a brick
+static std::vector<Span> SourceSpans(unsigned t, size_t tgt, size_t src,
+                                     uint64_t voxels, unsigned h) {
+  // positions are shifted by 'h', so that ghost voxels don't go negative.
+  const uint64_t g0 = uint64_t(t) * tgt;
+  const uint64_t g1 = std::min(g0 + tgt, voxels);
+  assert(g0 < g1);
+  const unsigned first = static_cast<unsigned>(g0 / src);
+  const unsigned last = static_cast<unsigned>((g1-1) / src);
+
+  std::vector<Span> rv;
+  for(unsigned i=first; i <= last; ++i) {
+    const uint64_t begin = i == first ? g0 : uint64_t(i)*src + h;
+    const uint64_t end = i == last ? g1 + 2*h : uint64_t(i+1)*src + h;
+    const Span sp = { i, begin - uint64_t(i)*src, begin - g0, end - begin };
+    rv.push_back(sp);
+  }
   return rv;
 }
 
@@ -433,17 +401,6 @@ static BrickSize ComputedTargetBrickSize(BrickIndex idx, VoxelLayout voxels,
   return rv;
 }
 
-// gives the size of the given brick from the target DS
-static BrickSize TargetBrickSize(const Dataset& tgt, const BrickKey& k) {
-  const BrickedDataset& b = dynamic_cast<const BrickedDataset&>(tgt);
-  UINTVECTOR3 sz = b.GetBrickMetadata(k).n_voxels;
-  BrickSize tmp = {{
-    static_cast<size_t>(sz[0]),
-    static_cast<size_t>(sz[1]),
-    static_cast<size_t>(sz[2]),
-  }};
-  return tmp;
-}
 // gives the size of the given brick from the source DS
 static BrickSize SourceBrickSize(const BrickedDataset& src, const BrickKey& k) {
   const BrickedDataset& b = dynamic_cast<const BrickedDataset&>(src);
@@ -456,27 +413,17 @@ static BrickSize SourceBrickSize(const BrickedDataset& src, const BrickKey& k) {
   return tmp;
 }
 
-// given the brick key in the dynamic DS, return the corresponding BrickKey
+// given the brick key in the dynamic DS, return the corresponding BrickKeys
 // in the source data.
-BrickKey DynamicBrickingDS::dbinfo::SourceBrickKey(const BrickKey& k) const {
-  const size_t lod = std::get<1>(k);
-  const BrickIndex src_bidx = SourceBrickIndex(k, *this->ds, this->brickSize);
-  BrickKey skey = SourceKey(src_bidx, lod, *(this->ds));
-#ifndef NDEBUG
-  // brick key should make sense.
-  std::shared_ptr<BrickedDataset> bds =
-    std::dynamic_pointer_cast<BrickedDataset>(this->ds);
-  assert(std::get<0>(skey) < bds->GetNumberOfTimesteps());
-  assert(std::get<2>(skey) < bds->GetTotalBrickCount());
-#endif
-  MESSAGE("keymap query: <%u,%u,%u> -> <%u,%u,%u>",
-          static_cast<unsigned>(std::get<0>(k)),
-          static_cast<unsigned>(std::get<1>(k)),
-          static_cast<unsigned>(std::get<2>(k)),
-          static_cast<unsigned>(std::get<0>(skey)),
-          static_cast<unsigned>(std::get<1>(skey)),
-          static_cast<unsigned>(std::get<2>(skey)));
-  return skey;
+std::vector<BrickKey>
+DynamicBrickingDS::dbinfo::SourceBrickKeys(const BrickKey& k) const {
+  const GBPrelim pre = this->BrickSetup(k);
+  std::vector<BrickKey> rv;
+  rv.reserve(pre.pieces.size());
+  for(auto p=pre.pieces.cbegin(); p != pre.pieces.cend(); ++p) {
+    rv.push_back(p->skey);
+  }
+  return rv;
 }
 
 BrickLayout
@@ -490,242 +437,403 @@ DynamicBrickingDS::dbinfo::TargetBrickLayout(size_t lod, size_t ts) const {
   return tgt_blayout;
 }
 
-// This is the type-dependent part of ::GetBrick.  Basically, the copying of
-// the source data into the target brick.
-template<typename T, typename Iter>
-bool DynamicBrickingDS::dbinfo::CopyBrick(
-  std::vector<T>& dest, const Iter srcdata, size_t components,
-  const BrickSize tgt_bs, const BrickSize src_bs,
-  VoxelIndex src_offset
-) {
-  assert(tgt_bs[0] <= src_bs[0] && "target can't be larger than source");
-  assert(tgt_bs[1] <= src_bs[1] && "target can't be larger than source");
-  assert(tgt_bs[2] <= src_bs[2] && "target can't be larger than source");
-
-  // make sure the vector is big enough.
-  //assert(dest.size() >= (tgt_bs[0]*tgt_bs[1]*tgt_bs[2])); // be sure!
-  dest.resize(tgt_bs[0]*tgt_bs[1]*tgt_bs[2]*components);
-
-  const VoxelIndex orig_offset = src_offset;
-
-  // our copy size/scanline size is the width of our target brick.
-  const size_t scanline = tgt_bs[0] * components;
-
-  for(uint64_t z=0; z < tgt_bs[2]; ++z) {
-    for(uint64_t y=0; y < tgt_bs[1]; ++y) {
-      const uint64_t x = 0;
-      const uint64_t tgt_offset = (z*tgt_bs[0]*tgt_bs[1] + y*tgt_bs[0] + x) *
-                                   components;
-
-      const uint64_t src_o = (src_offset[2]*src_bs[0]*src_bs[1] +
-                              src_offset[1]*src_bs[0] + src_offset[0]) *
-                              components;
-#if 0
-      // memcpy-based: works fast even in debug.
-      std::copy(srcdata.data()+src_o, srcdata.data()+src_o+scanline,
-                dest.data()+tgt_offset);
-#else
-      // iterators: gives nice error messages in debug.
-      std::copy(srcdata+src_o, srcdata+src_o+scanline,
-                dest.begin()+tgt_offset);
-#endif
-      src_offset[1]++; // should follow 'y' increment.
+// early, non-type-specific parts of GetBrick.
+// If the target bricks are smaller than the source bricks, a target brick
+// fits nicely inside a single source brick and we get one piece.  If they are
+// larger, the target brick is stitched together from a block of source
+// bricks, one piece per source brick.
+GBPrelim DynamicBrickingDS::dbinfo::BrickSetup(const BrickKey& k) const {
+  // See the comment Rebrick: we shouldn't have more LODs than the source data.
+  assert(std::get<1>(k) < this->ds->GetLODLevelCount());
+  const size_t lod = std::get<1>(k);
+  const size_t timestep = std::get<0>(k);
+  const VoxelLayout voxels = {{
+    this->ds->GetDomainSize(lod, timestep)[0],
+    this->ds->GetDomainSize(lod, timestep)[1],
+    this->ds->GetDomainSize(lod, timestep)[2]
+  }};
+  const BrickSize tgt = this->BrickSansGhost();
+  const BrickSize src = SourceMaxBrickSize(*this->ds);
+  const unsigned h = ghost(*this->ds) / 2;
+  const BrickIndex idx = to3d(layout(voxels, tgt), std::get<2>(k));
+
+  GBPrelim rv;
+  rv.tgt_bs = ComputedTargetBrickSize(idx, voxels, this->brickSize);
+  std::array<std::vector<Span>,3> spans;
+  for(size_t d=0; d < 3; ++d) {
+    spans[d] = SourceSpans(idx[d], tgt[d], src[d], voxels[d], h);
+  }
+  rv.pieces.reserve(spans[0].size() * spans[1].size() * spans[2].size());
+  for(auto z=spans[2].cbegin(); z != spans[2].cend(); ++z) {
+    for(auto y=spans[1].cbegin(); y != spans[1].cend(); ++y) {
+      for(auto x=spans[0].cbegin(); x != spans[0].cend(); ++x) {
+        const BrickIndex sidx = {{ x->brick, y->brick, z->brick }};
+        const BrickKey skey = SourceKey(sidx, lod, *this->ds);
+        SourcePiece p = {
+          skey, SourceBrickSize(*this->ds, skey),
+          {{ x->src_offset, y->src_offset, z->src_offset }},
+          {{ x->tgt_offset, y->tgt_offset, z->tgt_offset }},
+          {{ size_t(x->extent), size_t(y->extent), size_t(z->extent) }}
+        };
+        for(size_t d=0; d < 3; ++d) {
+          assert(p.src_offset[d] + p.extent[d] <= p.src_bs[d] &&
+                 "piece must lie within its source brick");
+          assert(p.tgt_offset[d] + p.extent[d] <= rv.tgt_bs[d] &&
+                 "piece must lie within the target brick");
+        }
+        rv.pieces.push_back(p);
+      }
     }
-    src_offset[1] = orig_offset[1];
-    src_offset[2]++; // .. and increment z
   }
-  return true;
-}
-
-// early, non-type-specific parts of GetBrick.
-// Note that because of how we do the re-bricking, we know that all the target
-// bricks will fit nicely inside a (single) source brick.  This is important,
-// becuase otherwise we'd have to read a bunch of bricks from the source, and
-// copy pieces from all of them.
-GBPrelim
-DynamicBrickingDS::dbinfo::BrickSetup(const BrickKey& k,
-                                      const DynamicBrickingDS& tgt) const {
-  assert(tgt.bricks.find(k) != tgt.bricks.end());
-
-  const BrickKey skey = this->SourceBrickKey(k);
-  const BrickSize tgt_bs = TargetBrickSize(tgt, k);
-  const BrickSize src_bs = SourceBrickSize(*this->ds, skey);
-
-  assert(tgt_bs[0] <= src_bs[0] && "target can't be larger than source");
-  assert(tgt_bs[1] <= src_bs[1] && "target can't be larger than source");
-  assert(tgt_bs[2] <= src_bs[2] && "target can't be larger than source");
-
-  // Unless this (target) brick sits at the bottom corner of the source brick,
-  // we'll need to start reading from the source brick at an offset.  What is
-  // that offset?
-  VoxelIndex src_offset = OffsetIntoSource(*this->ds, k, this->brickSize);
-  GBPrelim rv = { skey, tgt_bs, src_bs, src_offset };
   return rv;
 }
 
-// Looks for the brick in the cache; if so, uses it.  Otherwise, grab the brick
+// the part of a (cached) source brick which a piece covers.
 template<typename T>
-bool DynamicBrickingDS::dbinfo::Brick(const DynamicBrickingDS& ds,
-                                      const BrickKey& key,
-                                      std::vector<T>& data) {
-  StackTimer gbrick(PERF_DY_GET_BRICK);
-  GBPrelim pre = this->BrickSetup(key, ds);
+static BrickView<T> PieceView(const SourcePiece& p,
+                              const std::shared_ptr<const void>& src,
+                              size_t components) {
+  const VoxelIndex& o = p.src_offset;
+  BrickView<T> view;
+  view.owner = src;
+  view.base = static_cast<const T*>(src.get()) +
+              ((o[2]*p.src_bs[1] + o[1])*p.src_bs[0] + o[0]) * components;
+  view.extents = p.extent;
+  view.pitch[0] = p.src_bs[0];
+  view.pitch[1] = p.src_bs[1];
+  view.components = components;
+  return view;
+}
+
+// Looks for the source brick in the cache; if it's not there, read it and add
+// it.
+template<typename T>
+std::shared_ptr<const void>
+DynamicBrickingDS::dbinfo::Source(const BrickKey& skey) {
+  std::shared_ptr<const void> src = this->Cached<T>(skey);
+  if(src) { return src; }
+  // nope?  oh well.  read it.
+  std::vector<T> srcdata;
+  if(!this->Load<T>(skey, srcdata)) { return std::shared_ptr<const void>(); }
+  return this->Keep<T>(skey, srcdata);
+}
 
-  const void* lookup;
+template<typename T>
+std::shared_ptr<const void>
+DynamicBrickingDS::dbinfo::Cached(const BrickKey& skey) {
+  tuvok::Controller::Instance().IncrementPerfCounter(PERF_DY_CACHE_LOOKUPS, 1.0);
+  std::shared_ptr<const void> src;
   {
-    tuvok::Controller::Instance().IncrementPerfCounter(PERF_DY_CACHE_LOOKUPS, 1.0);
     StackTimer cc(PERF_DY_CACHE_LOOKUP);
-    lookup = this->cache.lookup(pre.skey, T(42));
+    src = this->cache.pin(skey, T(42));
   }
-  // first: check the cache and see if we can get the data easy.
-  if(NULL != lookup) {
+  if(src) {
     MESSAGE("found <%u,%u,%u> in the cache!",
-            static_cast<unsigned>(std::get<0>(pre.skey)),
-            static_cast<unsigned>(std::get<1>(pre.skey)),
-            static_cast<unsigned>(std::get<2>(pre.skey)));
-    tuvok::Controller::Instance().IncrementPerfCounter(PERF_DY_BRICK_COPIED, 1.0);
-    StackTimer copies(PERF_DY_BRICK_COPY);
-    const T* srcdata = static_cast<const T*>(lookup);
-    const size_t components = this->ds->GetComponentCount();
-    return this->CopyBrick<T>(data, srcdata, components, pre.tgt_bs, pre.src_bs,
-                              pre.src_offset);
+            static_cast<unsigned>(std::get<0>(skey)),
+            static_cast<unsigned>(std::get<1>(skey)),
+            static_cast<unsigned>(std::get<2>(skey)));
   }
-  // nope?  oh well.  read it.
-  std::vector<T> srcdata;
+  return src;
+}
+
+template<typename T>
+bool DynamicBrickingDS::dbinfo::Load(const BrickKey& skey,
+                                     std::vector<T>& srcdata) const {
   {
     StackTimer loadBrick(PERF_DY_RESERVE_BRICK);
-    srcdata.resize(this->ds->GetBrickVoxelCounts(pre.skey).volume());
-  }
-  {
-    StackTimer loadBrick(PERF_DY_LOAD_BRICK);
-    if(!this->ds->GetBrick(pre.skey, srcdata)) { return false; }
+    srcdata.resize(this->ds->GetBrickVoxelCounts(skey).volume());
   }
+  StackTimer loadBrick(PERF_DY_LOAD_BRICK, int64_t(std::get<2>(skey)));
+  return this->ds->GetBrick(skey, srcdata);
+}
 
-  // add it to the cache.
-  const T* sdata = static_cast<const T*>(srcdata.data());
+// Eviction and insertion are two steps, so two threads doing this at once
+// could evict each other's bricks; only the thread asking for a brick does.
+template<typename T>
+std::shared_ptr<const void>
+DynamicBrickingDS::dbinfo::Keep(const BrickKey& skey,
+                                std::vector<T>& srcdata) {
   if(this->cacheBytes > 0) {
+    // add it to the cache.
     tuvok::Controller::Instance().IncrementPerfCounter(PERF_DY_CACHE_ADDS, 1.0);
     StackTimer cc(PERF_DY_CACHE_ADD);
     // is the cache full?  find room.
     while(!this->FitsInCache(srcdata.size() * sizeof(T))) {
       this->cache.remove();
     }
-    sdata = static_cast<const T*>(this->cache.add(pre.skey, srcdata));
+    return this->cache.pin(skey, srcdata);
   }
+  // no cache: the caller becomes the owner of the data.
+  std::shared_ptr<std::vector<T>> owned =
+    std::make_shared<std::vector<T>>(std::move(srcdata));
+  return std::shared_ptr<const void>(owned, owned->data());
+}
+
+// Cached bricks are filtered out first: their data would only sit in the
+// source's staging area until something else pushes them out.  The probe
+// must not count as a cache hit or miss, nobody is going to use the data.
+template<typename T>
+void DynamicBrickingDS::dbinfo::Prefetch(std::vector<BrickKey> skeys) {
+  std::sort(skeys.begin(), skeys.end());
+  skeys.erase(std::unique(skeys.begin(), skeys.end()), skeys.end());
+  if(this->cacheBytes > 0) {
+    skeys.erase(std::remove_if(skeys.begin(), skeys.end(),
+      [this](const BrickKey& k) { return this->cache.contains(k); }
+    ), skeys.end());
+  }
+  if(!skeys.empty()) { this->ds->Prefetch(skeys); }
+}
+
+// 'view' ends up pointing at the part of the source brick which makes up the
+// target brick, without copying anything.
+template<typename T>
+bool DynamicBrickingDS::dbinfo::View(const DynamicBrickingDS& ds,
+                                     const BrickKey& key,
+                                     BrickView<T>& view) {
+  assert(ds.bricks.find(key) != ds.bricks.end());
+  const GBPrelim pre = this->BrickSetup(key);
+  // a brick stitched together from several sources has no single view.
+  if(pre.pieces.size() != 1) { return false; }
+
+  std::shared_ptr<const void> src = this->Source<T>(pre.pieces[0].skey);
+  if(!src) { return false; }
+  // the target brick sits entirely inside this source brick; the view just
+  // starts at an offset and inherits the source brick's pitch.
+  view = PieceView<T>(pre.pieces[0], src, this->ds->GetComponentCount());
+  return true;
+}
+
+// This is the type-dependent part of ::GetBrick.  Basically, the copying of
+// the source data into the target brick.
+template<typename T>
+bool DynamicBrickingDS::dbinfo::Brick(const DynamicBrickingDS& ds,
+                                      const BrickKey& key,
+                                      std::vector<T>& data) {
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(key)));
+  assert(ds.bricks.find(key) != ds.bricks.end());
+  const GBPrelim pre = this->BrickSetup(key);
   const size_t components = this->ds->GetComponentCount();
+
+  // gather all the source bricks first.  Each one we read goes through the
+  // cache, so neighbouring target bricks will find it there.
+  if(pre.pieces.size() > 1) {
+    std::vector<BrickKey> skeys;
+    for(auto p=pre.pieces.cbegin(); p != pre.pieces.cend(); ++p) {
+      skeys.push_back(p->skey);
+    }
+    this->Prefetch<T>(skeys);
+  }
+  // The pieces come from different source bricks.  The cache is consulted
+  // and filled on this thread; the missing source bricks are read in one
+  // batch, which the source may serve concurrently.
+  std::vector<std::shared_ptr<const void>> src(pre.pieces.size());
+  std::vector<size_t> missing;
+  std::vector<BrickKey> keys;
+  for(size_t i=0; i < src.size(); ++i) {
+    src[i] = this->Cached<T>(pre.pieces[i].skey);
+    if(!src[i]) {
+      missing.push_back(i);
+      keys.push_back(pre.pieces[i].skey);
+    }
+  }
+  if(!keys.empty()) {
+    std::vector<std::vector<T>> loaded;
+    {
+      StackTimer loadBrick(PERF_DY_LOAD_BRICK);
+      if(!this->ds->GetBricks(keys, loaded)) { return false; }
+    }
+    for(size_t i=0; i < missing.size(); ++i) {
+      src[missing[i]] = this->Keep<T>(keys[i], loaded[i]);
+    }
+  }
+
   tuvok::Controller::Instance().IncrementPerfCounter(PERF_DY_BRICK_COPIED, 1.0);
   StackTimer copies(PERF_DY_BRICK_COPY);
-  return this->CopyBrick<T>(data, sdata, components, pre.tgt_bs, pre.src_bs,
-                            pre.src_offset);
+  if(pre.pieces.size() == 1) {
+    PieceView<T>(pre.pieces[0], src[0], components).copy(data);
+    return true;
+  }
+
+  // the pieces cover disjoint parts of the target, so they can be copied
+  // independently.
+  const BrickSize& tbs = pre.tgt_bs;
+  data.resize(tbs[0] * tbs[1] * tbs[2] * components);
+  const int n = static_cast<int>(pre.pieces.size());
+#pragma omp parallel for if(n > 8)
+  for(int i=0; i < n; ++i) {
+    const SourcePiece& p = pre.pieces[i];
+    const BrickView<T> view = PieceView<T>(p, src[i], components);
+    const VoxelIndex& o = p.tgt_offset;
+    for(size_t z=0; z < p.extent[2]; ++z) {
+      for(size_t y=0; y < p.extent[1]; ++y) {
+        const T* line = view.scanline(y, z);
+        std::copy(line, line + p.extent[0]*components,
+                  data.begin() + (((o[2]+z)*tbs[1] + o[1]+y)*tbs[0] + o[0]) *
+                                 components);
+      }
+    }
+  }
+  return true;
 }
 
-/// we can cache the precomputed brick min/maxes in a file, and then
-/// just read those. this can be a big win, since the calculation is
-/// veeeery slow.
-/// @return the file we would save for this case.
-static std::string precomputed_filename(const BrickedDataset& ds,
-                                        const BrickSize bsize)
-{
+/// run through all of the bricks and compute min/max info.
+void DynamicBrickingDS::dbinfo::ComputeMinMaxes(const DynamicBrickingDS& ds) {
+  // first, pick up whatever an earlier run already computed.
+  std::unique_ptr<MinMaxIndex> index;
   try {
-    std::ostringstream fname;
-    const FileBackedDataset& fbds = dynamic_cast<const FileBackedDataset&>(ds);
-    fname << "." << bsize[0] << "x" << bsize[1] << "x" << bsize[2] << "-"
-          << SysTools::GetFilename(fbds.Filename()) << ".cached";
-    return fname.str();
+    index.reset(new MinMaxIndex(ds.Filename(), this->brickSize));
+    const size_t loaded = index->Load(this->minmax);
+    if(loaded > 0) {
+      MESSAGE("Reloaded %u brick min/maxes from '%s'.",
+              static_cast<unsigned>(loaded), index->Filename().c_str());
+    }
   } catch(const std::bad_cast&) {
     WARNING("Data doesn't come from a file.  We can't save minmaxes.");
   }
-  return "";
-}
-
-void DynamicBrickingDS::dbinfo::LoadMinMax(std::istream& is) {
-  if(!is) { T_ERROR("could not open min/max cache!"); return; }
-
-  uint64_t n_elems;
-  is.read(reinterpret_cast<char*>(&n_elems), sizeof(uint64_t));
-
-  for(uint64_t i=0; i < n_elems; ++i) {
-    uint64_t timestep, lod, brick;
-    is.read(reinterpret_cast<char*>(&timestep), sizeof(uint64_t));
-    is.read(reinterpret_cast<char*>(&lod), sizeof(uint64_t));
-    is.read(reinterpret_cast<char*>(&brick), sizeof(uint64_t));
-    const BrickKey key(timestep, lod, brick);
-    MinMaxBlock mm;
-    is.read(reinterpret_cast<char*>(&mm.minScalar), sizeof(double));
-    is.read(reinterpret_cast<char*>(&mm.maxScalar), sizeof(double));
-    if(!is) {
-      T_ERROR("read failed?  cache is broken.  ignoring it.");
-      this->minmax.clear();
-      return;
+
+  std::vector<BrickKey> todo;
+  for(auto b=ds.BricksBegin(); b != ds.BricksEnd(); ++b) {
+    if(this->minmax.find(b->first) == this->minmax.end()) {
+      todo.push_back(b->first);
     }
-    this->minmax.insert(std::make_pair(key, mm));
   }
-}
-
-void DynamicBrickingDS::dbinfo::SaveMinMax(std::ostream& os) const {
-  if(!os) { T_ERROR("could not create min/max cache."); return; }
-
-  const uint64_t n_elems = this->minmax.size();
-  MESSAGE("Saving %llu brick min/maxes", n_elems);
-  os.write(reinterpret_cast<const char*>(&n_elems), sizeof(uint64_t));
-
-  for(auto b=this->minmax.cbegin(); b != this->minmax.cend(); ++b) {
-    uint64_t timestep, lod, brick;
-    timestep = std::get<0>(b->first);
-    lod = std::get<1>(b->first);
-    brick = std::get<2>(b->first);
-    os.write(reinterpret_cast<const char*>(&timestep), sizeof(uint64_t));
-    os.write(reinterpret_cast<const char*>(&lod), sizeof(uint64_t));
-    os.write(reinterpret_cast<const char*>(&brick), sizeof(uint64_t));
-    MinMaxBlock mm = b->second;
-    os.write(reinterpret_cast<const char*>(&mm.minScalar), sizeof(double));
-    os.write(reinterpret_cast<const char*>(&mm.maxScalar), sizeof(double));
+  if(todo.empty()) { return; }
+
+  StackTimer precompute(PERF_MM_PRECOMPUTE);
+  const unsigned size = this->ds->GetBitWidth() / 8;
+  const bool sign = this->ds->GetIsSigned();
+  const bool fp = this->ds->GetIsFloat();
+  if(!sign && !fp && size == 1) {
+    this->ComputeMinMaxes<uint8_t>(ds, todo, index.get());
+  } else if(!sign && !fp && size == 2) {
+    this->ComputeMinMaxes<uint16_t>(ds, todo, index.get());
+  } else if(!sign && !fp && size == 4) {
+    this->ComputeMinMaxes<uint32_t>(ds, todo, index.get());
+  } else if(sign && !fp && size == 1) {
+    this->ComputeMinMaxes<int8_t>(ds, todo, index.get());
+  } else if(sign && !fp && size == 2) {
+    this->ComputeMinMaxes<int16_t>(ds, todo, index.get());
+  } else if(sign && !fp && size == 4) {
+    this->ComputeMinMaxes<int32_t>(ds, todo, index.get());
+  } else if(sign && fp && size == 4) {
+    this->ComputeMinMaxes<float>(ds, todo, index.get());
+  } else {
+    T_ERROR("unsupported type.");
+    assert(false);
   }
 }
 
-/// run through all of the bricks and compute min/max info.
-void DynamicBrickingDS::dbinfo::ComputeMinMaxes(BrickedDataset& ds) {
-  // first, check if we have this cached.
-  const std::string fname = precomputed_filename(ds, this->brickSize);
-  if(SysTools::FileExists(fname)) {
-    MESSAGE("Brick min/maxes are precomputed.  Reloading from file...");
-    std::ifstream mmfile(fname, std::ios::binary);
-    this->LoadMinMax(mmfile);
-    mmfile.close();
-    return;
+// Work is split into pieces (one per target brick and source brick it reads
+// from) and grouped by source brick, so every source brick is read once.
+// Source bricks are read here, on the calling thread, in batches of about the
+// cache size; the pieces of a batch are then reduced in parallel.  Target
+// bricks are committed to the index as soon as all their pieces are done.
+template<typename T>
+void DynamicBrickingDS::dbinfo::ComputeMinMaxes(
+  const DynamicBrickingDS&, const std::vector<BrickKey>& todo,
+  MinMaxIndex* index
+) {
+  struct Work { size_t target; SourcePiece piece; };
+  std::vector<Work> work;
+  std::vector<unsigned> remaining(todo.size());
+  for(size_t t=0; t < todo.size(); ++t) {
+    const GBPrelim pre = this->BrickSetup(todo[t]);
+    remaining[t] = static_cast<unsigned>(pre.pieces.size());
+    for(auto p=pre.pieces.cbegin(); p != pre.pieces.cend(); ++p) {
+      const Work w = { t, *p };
+      work.push_back(w);
+    }
   }
-
-  {
-    StackTimer precompute(PERF_MM_PRECOMPUTE);
-    unsigned i=0;
-    const unsigned len = static_cast<unsigned>(
-      std::distance(ds.BricksBegin(), ds.BricksEnd())
-    );
-    for(auto b=ds.BricksBegin(); b != ds.BricksEnd(); ++b, ++i) {
-      MESSAGE("precomputing brick %u of %u", i, len);
-      MinMaxBlock mm = minmax_brick(b->first, ds);
-      this->minmax.insert(std::make_pair(b->first, mm));
-
-      // we do want to cache to save decompression time
-      while (this->cache.size() > this->cacheBytes) { this->cache.remove(); }
-
-      // minmax_brick added something to our cache; we don't want to cache
-      // here, though, only when the brick is /actually/ used.
-      //this->cache.clear();
+  std::stable_sort(work.begin(), work.end(), [](const Work& a, const Work& b) {
+    return a.piece.skey < b.piece.skey;
+  });
+  // the order in which we will read the source bricks; we keep the source
+  // reading ahead a window of these.
+  std::vector<BrickKey> order;
+  for(auto w=work.cbegin(); w != work.cend(); ++w) {
+    if(order.empty() || order.back() != w->piece.skey) {
+      order.push_back(w->piece.skey);
     }
   }
-  // remove all cached bricks
-  while(this->cache.size() > 0) { this->cache.remove(); }
-
-  // try to cache that data to a file, now.
-  std::ofstream mmcache(fname, std::ios::binary);
-  if(!mmcache) {
-    WARNING("could not open min/max cache file (%s); ignoring cache.",
-            fname.c_str());
-    return;
+  static const size_t window = 32;
+  size_t read = 0; // source bricks read so far
+  size_t ahead = 0; // source bricks announced so far
+
+  const size_t components = this->ds->GetComponentCount();
+  std::vector<MinMaxBlock> acc(todo.size());
+  std::vector<std::vector<T>> sources;
+  std::vector<size_t> source_of; // per piece in the batch
+  std::vector<MinMaxBlock> piece_mm;
+  MinMaxIndex::Records results;
+  size_t done = 0;
+  for(size_t i=0; i < work.size(); ) {
+    // read source bricks until the batch is full.
+    const size_t first = i;
+    source_of.clear();
+    sources.clear();
+    size_t batchBytes = 0;
+    do {
+      const BrickKey& skey = work[i].piece.skey;
+      if(read + window/2 >= ahead && ahead < order.size()) {
+        const size_t end = std::min(order.size(), read + window);
+        this->ds->Prefetch(std::vector<BrickKey>(order.begin()+ahead,
+                                                 order.begin()+end));
+        ahead = end;
+      }
+      ++read;
+      sources.push_back(std::vector<T>());
+      sources.back().resize(this->ds->GetBrickVoxelCounts(skey).volume() *
+                            components);
+      {
+        StackTimer loadBrick(PERF_DY_LOAD_BRICK,
+                             int64_t(std::get<2>(skey)));
+        if(!this->ds->GetBrick(skey, sources.back())) {
+          T_ERROR("Could not read source brick <%u,%u,%u>; min/max "
+                  "precompute aborted.",
+                  static_cast<unsigned>(std::get<0>(skey)),
+                  static_cast<unsigned>(std::get<1>(skey)),
+                  static_cast<unsigned>(std::get<2>(skey)));
+          return;
+        }
+      }
+      batchBytes += sources.back().size() * sizeof(T);
+      for(; i < work.size() && work[i].piece.skey == skey; ++i) {
+        source_of.push_back(sources.size()-1);
+      }
+    } while(i < work.size() && batchBytes < this->cacheBytes);
+
+    piece_mm.resize(i - first);
+    const int n = static_cast<int>(piece_mm.size());
+#pragma omp parallel for schedule(dynamic)
+    for(int j=0; j < n; ++j) {
+      const SourcePiece& p = work[first+j].piece;
+      const VoxelIndex& o = p.src_offset;
+      BrickView<T> view;
+      view.base = sources[source_of[j]].data() +
+                  ((o[2]*p.src_bs[1] + o[1])*p.src_bs[0] + o[0]) * components;
+      view.extents = p.extent;
+      view.pitch[0] = p.src_bs[0];
+      view.pitch[1] = p.src_bs[1];
+      view.components = components;
+      piece_mm[j] = minmax_view(view);
+    }
+
+    results.clear();
+    for(size_t j=0; j < piece_mm.size(); ++j) {
+      const size_t t = work[first+j].target;
+      acc[t].Merge(piece_mm[j]);
+      if(--remaining[t] == 0) {
+        results.push_back(std::make_pair(todo[t], acc[t]));
+      }
+    }
+    this->minmax.insert(results.begin(), results.end());
+    if(index && !index->Append(results)) {
+      index = NULL; // keep computing, just don't try to save anymore.
+    }
+    done += results.size();
+    MESSAGE("precomputed %u of %u brick min/maxes",
+            static_cast<unsigned>(done), static_cast<unsigned>(todo.size()));
   }
-  this->SaveMinMax(mmcache);
-  mmcache.close();
 }
 
 void DynamicBrickingDS::dbinfo::SetCacheSize(size_t bytes) {
@@ -790,6 +898,88 @@ bool DynamicBrickingDS::GetBrick(const BrickKey&,
   return false;
 }
 
+void DynamicBrickingDS::Prefetch(const std::vector<BrickKey>& keys) const
+{
+  std::vector<BrickKey> skeys;
+  for(auto k=keys.cbegin(); k != keys.cend(); ++k) {
+    const std::vector<BrickKey> s = this->di->SourceBrickKeys(*k);
+    skeys.insert(skeys.end(), s.begin(), s.end());
+  }
+  const unsigned size = this->di->ds->GetBitWidth() / 8;
+  const bool sign = this->di->ds->GetIsSigned();
+  const bool fp = this->di->ds->GetIsFloat();
+  if(!sign && !fp && size == 1) {
+    this->di->Prefetch<uint8_t>(skeys);
+  } else if(!sign && !fp && size == 2) {
+    this->di->Prefetch<uint16_t>(skeys);
+  } else if(!sign && !fp && size == 4) {
+    this->di->Prefetch<uint32_t>(skeys);
+  } else if(sign && !fp && size == 1) {
+    this->di->Prefetch<int8_t>(skeys);
+  } else if(sign && !fp && size == 2) {
+    this->di->Prefetch<int16_t>(skeys);
+  } else if(sign && !fp && size == 4) {
+    this->di->Prefetch<int32_t>(skeys);
+  } else if(sign && fp && size == 4) {
+    this->di->Prefetch<float>(skeys);
+  }
+}
+
+bool DynamicBrickingDS::ConcurrentGetBrick() const
+{
+  return this->di->ds->ConcurrentGetBrick();
+}
+
+bool DynamicBrickingDS::GetBrickView(const BrickKey& k,
+                                     BrickView<uint8_t>& view) const
+{
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(k)));
+  return this->di->View<uint8_t>(*this, k, view);
+}
+bool DynamicBrickingDS::GetBrickView(const BrickKey& k,
+                                     BrickView<int8_t>& view) const
+{
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(k)));
+  return this->di->View<int8_t>(*this, k, view);
+}
+bool DynamicBrickingDS::GetBrickView(const BrickKey& k,
+                                     BrickView<uint16_t>& view) const
+{
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(k)));
+  return this->di->View<uint16_t>(*this, k, view);
+}
+bool DynamicBrickingDS::GetBrickView(const BrickKey& k,
+                                     BrickView<int16_t>& view) const
+{
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(k)));
+  return this->di->View<int16_t>(*this, k, view);
+}
+bool DynamicBrickingDS::GetBrickView(const BrickKey& k,
+                                     BrickView<uint32_t>& view) const
+{
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(k)));
+  return this->di->View<uint32_t>(*this, k, view);
+}
+bool DynamicBrickingDS::GetBrickView(const BrickKey& k,
+                                     BrickView<int32_t>& view) const
+{
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(k)));
+  return this->di->View<int32_t>(*this, k, view);
+}
+bool DynamicBrickingDS::GetBrickView(const BrickKey& k,
+                                     BrickView<float>& view) const
+{
+  StackTimer gbrick(PERF_DY_GET_BRICK, int64_t(std::get<2>(k)));
+  return this->di->View<float>(*this, k, view);
+}
+// no support for double with dynamic bricking.  Unlike GetBrick, this is not
+// an error: callers are expected to fall back to GetBrick if there's no view.
+bool DynamicBrickingDS::GetBrickView(const BrickKey&,
+                                     BrickView<double>&) const
+{
+  return false;
+}
+
 void DynamicBrickingDS::SetRescaleFactors(const DOUBLEVECTOR3& scale) {
   this->di->ds->SetRescaleFactors(scale);
 }
@@ -837,33 +1027,49 @@ std::pair<double,double> DynamicBrickingDS::GetRange() const {
 /// Acceleration queries.
 /// Right now, they just forward to the larger data set.  We might consider
 /// recomputing this metadata, to get better performance at the expense of
-/// memory.
+/// memory.  A brick made of several source bricks contains data if any of
+/// them does.
 ///@{
 bool DynamicBrickingDS::ContainsData(const BrickKey& bk, double isoval) const {
   assert(this->bricks.find(bk) != this->bricks.end());
-  BrickKey skey = this->di->SourceBrickKey(bk);
-  return di->ds->ContainsData(skey, isoval);
+  const std::vector<BrickKey> skeys = this->di->SourceBrickKeys(bk);
+  for(auto s=skeys.cbegin(); s != skeys.cend(); ++s) {
+    if(di->ds->ContainsData(*s, isoval)) { return true; }
+  }
+  return false;
 }
 bool DynamicBrickingDS::ContainsData(const BrickKey& bk, double fmin,
                                      double fmax) const {
   assert(this->bricks.find(bk) != this->bricks.end());
-  BrickKey skey = this->di->SourceBrickKey(bk);
-  return di->ds->ContainsData(skey, fmin, fmax);
+  const std::vector<BrickKey> skeys = this->di->SourceBrickKeys(bk);
+  for(auto s=skeys.cbegin(); s != skeys.cend(); ++s) {
+    if(di->ds->ContainsData(*s, fmin, fmax)) { return true; }
+  }
+  return false;
 }
 bool DynamicBrickingDS::ContainsData(const BrickKey& bk,
                                      double fmin, double fmax,
                                      double fminGradient,
                                      double fmaxGradient) const {
   assert(this->bricks.find(bk) != this->bricks.end());
-  BrickKey skey = this->di->SourceBrickKey(bk);
-  return di->ds->ContainsData(skey, fmin,fmax, fminGradient, fmaxGradient);
+  const std::vector<BrickKey> skeys = this->di->SourceBrickKeys(bk);
+  for(auto s=skeys.cbegin(); s != skeys.cend(); ++s) {
+    if(di->ds->ContainsData(*s, fmin,fmax, fminGradient, fmaxGradient)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 MinMaxBlock DynamicBrickingDS::MaxMinForKey(const BrickKey& bk) const {
   switch(this->di->mmMode) {
     case MM_SOURCE: {
-      BrickKey skey = this->di->SourceBrickKey(bk);
-      return di->ds->MaxMinForKey(skey);
+      const std::vector<BrickKey> skeys = this->di->SourceBrickKeys(bk);
+      MinMaxBlock mm;
+      for(auto s=skeys.cbegin(); s != skeys.cend(); ++s) {
+        mm.Merge(di->ds->MaxMinForKey(*s));
+      }
+      return mm;
     } break;
     case MM_DYNAMIC: return minmax_brick(bk, *this); break;
     case MM_PRECOMPUTE: {
@@ -873,6 +1079,34 @@ MinMaxBlock DynamicBrickingDS::MaxMinForKey(const BrickKey& bk) const {
   }
   return MinMaxBlock();
 }
+
+// with source min/maxes we merge straight from the source's table, instead
+// of asking the source for every piece of every brick.
+std::shared_ptr<MinMaxTable>
+DynamicBrickingDS::BuildMinMaxTable(size_t timestep) const {
+  if(this->di->mmMode != MM_SOURCE) {
+    return LinearIndexDataset::BuildMinMaxTable(timestep);
+  }
+  const std::shared_ptr<const MinMaxTable> src =
+    this->di->ds->GetMinMaxTable(timestep);
+  std::shared_ptr<MinMaxTable> table(
+    new MinMaxTable(this->GetBrickLayouts(timestep))
+  );
+  size_t i = 0;
+  for(size_t lod=0; lod < this->GetLODLevelCount(); ++lod) {
+    const size_t bricks = this->GetBrickLayout(lod, timestep).volume();
+    for(size_t b=0; b < bricks; ++b) {
+      const std::vector<BrickKey> skeys =
+        this->di->SourceBrickKeys(BrickKey(timestep, lod, b));
+      MinMaxBlock mm;
+      for(auto s=skeys.cbegin(); s != skeys.cend(); ++s) {
+        mm.Merge(src->Get(this->di->ds->MinMaxTableIndex(*s)));
+      }
+      table->Set(i++, mm);
+    }
+  }
+  return table;
+}
 ///@}
 
 bool DynamicBrickingDS::Export(uint64_t lod, const std::string& to,
@@ -970,6 +1204,12 @@ static bool integer_multiple(unsigned a, unsigned b) {
   return false;
 }
 
+// target bricks must either subdivide source bricks or be made of whole
+// source bricks.
+static bool nests(unsigned tgt, unsigned src) {
+  return integer_multiple(tgt, src) || integer_multiple(src, tgt);
+}
+
 // what are the low/high points of our data set?  Interestingly, we don't have
 // a way to query this from the Dataset itself.  So we find a LOD which is just
 // one brick, and then see how big that brick is.
@@ -1009,15 +1249,21 @@ void DynamicBrickingDS::dbinfo::VerifyBrick(
     // if we "Re"brick to the same size bricks, then all
     // the bricks we create should also exist in the source
     // dataset.
-    assert(brk.first == this->SourceBrickKey(brk.first));
+    assert(this->SourceBrickKeys(brk.first).size() == 1);
+    assert(brk.first == this->SourceBrickKeys(brk.first)[0]);
   }
 #ifndef NDEBUG
-  const BrickKey& srckey = this->SourceBrickKey(brk.first);
+  // the pieces we read from must make up exactly the brick we're creating.
+  const GBPrelim pre = this->BrickSetup(brk.first);
+  uint64_t covered = 0;
+  for(auto p=pre.pieces.cbegin(); p != pre.pieces.cend(); ++p) {
+    covered += uint64_t(p->extent[0]) * p->extent[1] * p->extent[2];
+  }
 #endif
-  // brick we're creating can't be larger than the brick it reads from.
-  assert(brk.second.n_voxels[0] <= SourceBrickSize(*this->ds, srckey)[0]);
-  assert(brk.second.n_voxels[1] <= SourceBrickSize(*this->ds, srckey)[1]);
-  assert(brk.second.n_voxels[2] <= SourceBrickSize(*this->ds, srckey)[2]);
+  assert(brk.second.n_voxels[0] == pre.tgt_bs[0]);
+  assert(brk.second.n_voxels[1] == pre.tgt_bs[1]);
+  assert(brk.second.n_voxels[2] == pre.tgt_bs[2]);
+  assert(covered == brk.second.n_voxels.volume());
 
   std::array<std::array<float,3>,2> extents = DatasetExtents(this->ds);
   const FLOATVECTOR3 fullexts(
@@ -1091,23 +1337,23 @@ void DynamicBrickingDS::Rebrick() {
   // first make sure this makes sense.
   const BrickSize src_bs = SourceMaxBrickSize(*this->di->ds);
 
-  if(!integer_multiple(this->di->brickSize[0]-ghost(*this), src_bs[0])) {
-    throw std::runtime_error("x dimension is not an integer multiple of "
-                             "original brick size.");
+  if(!nests(this->di->brickSize[0]-ghost(*this), src_bs[0])) {
+    throw std::runtime_error("x dimension neither divides nor is an integer "
+                             "multiple of the original brick size.");
   }
-  if(!integer_multiple(this->di->brickSize[1]-ghost(*this), src_bs[1])) {
-    throw std::runtime_error("y dimension is not an integer multiple of "
-                             "original brick size.");
+  if(!nests(this->di->brickSize[1]-ghost(*this), src_bs[1])) {
+    throw std::runtime_error("y dimension neither divides nor is an integer "
+                             "multiple of the original brick size.");
   }
-  if(!integer_multiple(this->di->brickSize[2]-ghost(*this), src_bs[2])) {
-    throw std::runtime_error("z dimension is not an integer multiple of "
-                             "original brick size.");
+  if(!nests(this->di->brickSize[2]-ghost(*this), src_bs[2])) {
+    throw std::runtime_error("z dimension neither divides nor is an integer "
+                             "multiple of the original brick size.");
   }
   assert(this->di->brickSize[0] > 0);
   assert(this->di->brickSize[1] > 0);
   assert(this->di->brickSize[2] > 0);
 
-  BrickedDataset::Clear();
+  LinearIndexDataset::Clear();
   const VoxelLayout nvoxels = {{ // does not include ghost voxels.
     di->ds->GetDomainSize(0,0)[0],
     di->ds->GetDomainSize(0,0)[1],
@@ -1176,6 +1422,7 @@ void DynamicBrickingDS::Rebrick() {
 
   if(this->di->mmMode == MM_PRECOMPUTE) {
     this->di->ComputeMinMaxes(*this);
+    this->InvalidateMinMaxTables();
   }
 }
 
@@ -4,6 +4,7 @@
 #include <array>
 #include <memory>
 #include <vector>
+#include "BrickView.h"
 #include "LinearIndexDataset.h"
 #include "FileBackedDataset.h"
 
@@ -11,6 +12,9 @@ namespace tuvok {
 
 /// A dataset which will dynamically break up another data set into the
 /// user-given brick sizes.  This is constructed purely in memory!
+/// Sans overlap, the new bricks must either divide the source bricks or be
+/// an integer multiple of them; in the latter case every brick is stitched
+/// together from several source bricks.
 /// @note The brick size you give this data set *includes* the brick overlap!
 class DynamicBrickingDS : public LinearIndexDataset, public FileBackedDataset {
 public:
@@ -18,7 +22,8 @@ public:
   /// MM_SOURCE: use the min/max from the source dataset.  this is likely to
   /// have a greater range the actual data, but might still be okay.
   /// MM_PRECOMPUTE: precompute all the new bricks' min/max info when this
-  /// object is created.  Induces huge delays.
+  /// object is created.  The results are saved in an index next to the
+  /// source file (see MinMaxIndex), so only the first open is slow.
   /// MM_DYNAMIC: compute the exact min/max dynamically when the brick is
   /// requested.
   enum MinMaxMode { MM_SOURCE=0, MM_PRECOMPUTE, MM_DYNAMIC };
@@ -55,6 +60,26 @@ public:
   virtual bool GetBrick(const BrickKey&, std::vector<float>&) const;
   virtual bool GetBrick(const BrickKey&, std::vector<double>&) const;
   ///@}
+  /// Forwards to the source dataset, for the source bricks which make up
+  /// the given bricks and are not cached already.
+  virtual void Prefetch(const std::vector<BrickKey>&) const;
+  /// as safe as the source dataset's GetBrick: the cache is thread safe.
+  virtual bool ConcurrentGetBrick() const;
+
+  /// Zero-copy data access: the view points straight into the cached source
+  /// brick, so rows and slices are generally strided.  The view keeps the
+  /// data alive until it goes away, regardless of what the cache does.
+  /// Bricks stitched together from several source bricks have no view.
+  ///@{
+  bool GetBrickView(const BrickKey&, BrickView<uint8_t>&) const;
+  bool GetBrickView(const BrickKey&, BrickView<int8_t>&) const;
+  bool GetBrickView(const BrickKey&, BrickView<uint16_t>&) const;
+  bool GetBrickView(const BrickKey&, BrickView<int16_t>&) const;
+  bool GetBrickView(const BrickKey&, BrickView<uint32_t>&) const;
+  bool GetBrickView(const BrickKey&, BrickView<int32_t>&) const;
+  bool GetBrickView(const BrickKey&, BrickView<float>&) const;
+  bool GetBrickView(const BrickKey&, BrickView<double>&) const;
+  ///@}
 
   /// User rescaling factors.
   ///@{
@@ -114,6 +139,10 @@ public:
   virtual std::list<std::string> Extensions() const;
   ///@}
 
+protected:
+  virtual std::shared_ptr<MinMaxTable>
+    BuildMinMaxTable(size_t timestep) const;
+
 private:
   // rebricks the data according to the current brick size parameters.
   void Rebrick();
@@ -37,13 +37,19 @@
 #include "StdTuvokDefines.h"
 #include <algorithm>
 #include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <float.h>
 #include <iterator>
 #include <set>
 #include <sstream>
 #include <map>
+#include <unordered_map>
 #include <memory>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 #include "3rdParty/jpeglib/jconfig.h"
 
 #include "IOManager.h"
@@ -51,19 +57,24 @@
 #include "Basics/MC.h"
 #include "Basics/SysTools.h"
 #include "Basics/SystemInfo.h"
+#include "Basics/Threads.h"
 #include "Controller/Controller.h"
 #include "DSFactory.h"
+#include "DataMerger.h"
 #include "DynamicBrickingDS.h"
 #include "exception/UnmergeableDatasets.h"
 #include "expressions/parser.h"
+#include "expressions/program.h"
 #include "expressions/syntax.h"
 #include "expressions/treenode.h"
 #include "IO/DICOM/DICOMParser.h"
 #include "IO/Images/ImageParser.h"
 #include "IO/Images/StackExporter.h"
 #include "Quantize.h"
+#include "SliceConversion.h"
 #include "TuvokJPEG.h"
 #include "TransferFunction1D.h"
+#include "TypeConversion.h"
 #include "TuvokSizes.h"
 #include "uvfDataset.h"
 #include "UVF/UVF.h"
@@ -152,6 +163,11 @@ IOManager::IOManager() :
   m_iCompression(1), // default zlib compression
   m_iCompressionLevel(1), // default compression level best speed
   m_iLayout(0), // default scanline layout
+#ifdef _OPENMP
+  m_iEvaluationThreads(uint32_t(std::max(1, omp_get_max_threads()))),
+#else
+  m_iEvaluationThreads(1),
+#endif
   m_LoadDS(nullptr)
 {
   m_vpGeoConverters.push_back(new GeomViewConverter());
@@ -295,6 +311,82 @@ IOManager::ScanDirectory(string strDirectory) const {
   #pragma warning(disable:4996)
 #endif
 
+namespace {
+  /// Fills every slice of a stack with 'convert(j, data)' and appends them to
+  /// 'fs' in stack order.  The slices of a batch are converted by the thread
+  /// pool while the previous batch is written out, one batch per thread in
+  /// flight at most.  'convert' runs concurrently for different slices and
+  /// must not log; only the calling thread does.
+  template<typename Convert>
+  bool WriteSlices(const FileStackInfo& stack, ofstream& fs,
+                   const string& strFilename, Convert convert) {
+    const size_t iSlices = stack.m_Elements.size();
+#ifdef _OPENMP
+    const size_t iBatch = 2 * size_t(std::max(1, omp_get_max_threads()));
+#else
+    const size_t iBatch = 2;
+#endif
+    vector<vector<char>> vSlots[2];
+    vector<char> vConverted[2];
+    for (size_t i = 0; i < 2; ++i) {
+      vSlots[i].resize(iBatch);
+      vConverted[i].resize(iBatch);
+    }
+
+    bool bWriteOK = true;
+    std::unique_ptr<LambdaThread> writer;
+    for (size_t iFirst = 0; iFirst < iSlices; iFirst += iBatch) {
+      const size_t iBuffer = (iFirst / iBatch) % 2;
+      vector<vector<char>>& slots = vSlots[iBuffer];
+      vector<char>& converted = vConverted[iBuffer];
+      const size_t n = std::min(iBatch, iSlices - iFirst);
+
+      // the writer of two batches ago, the last user of these buffers, was
+      // joined before the previous batch was handed to its own writer
+#pragma omp parallel for schedule(dynamic)
+      for (int64_t i = 0; i < int64_t(n); ++i) {
+        converted[i] = convert(iFirst + size_t(i), slots[i]);
+      }
+
+      if (writer) writer->JoinThread();
+      for (size_t i = 0; i < n; ++i) {
+        if (!converted[i]) {
+          T_ERROR("Could not read slice %u from '%s'.",
+                  static_cast<unsigned>(iFirst + i),
+                  stack.m_Elements[iFirst + i]->m_strFileName.c_str());
+          return false;
+        }
+      }
+      if (!bWriteOK) {
+        T_ERROR("Could not write to temp file %s", strFilename.c_str());
+        return false;
+      }
+      MESSAGE("Creating intermediate file %s\n%u%%", strFilename.c_str(),
+              static_cast<unsigned>((100*iFirst)/iSlices));
+
+      writer.reset(new LambdaThread(
+        [&fs, &vSlots, iBuffer, n, &bWriteOK](bool const&,
+                                              LambdaThread::Interface&) {
+          const vector<vector<char>>& slots = vSlots[iBuffer];
+          for (size_t i = 0; i < n && bWriteOK; ++i) {
+            if (!slots[i].empty()) {
+              fs.write(&slots[i][0], slots[i].size());
+              bWriteOK = !fs.fail();
+            }
+          }
+        }
+      ));
+      writer->StartThread();
+    }
+    if (writer) writer->JoinThread();
+    if (!bWriteOK) {
+      T_ERROR("Could not write to temp file %s", strFilename.c_str());
+      return false;
+    }
+    return true;
+  }
+}
+
 bool IOManager::ConvertDataset(FileStackInfo* pStack,
                                const string& strTargetFilename,
                                const string& strTempDir,
@@ -335,142 +427,85 @@ bool IOManager::ConvertDataset(FileStackInfo* pStack,
       return false;
     }
 
-    vector<char> vData;
-    for (size_t j=0; j < pDICOMStack->m_Elements.size(); j++) {
-
-      SimpleDICOMFileInfo* pDICOMFileInfo = dynamic_cast<SimpleDICOMFileInfo*>(pDICOMStack->m_Elements[j]);
+    // The data of a JPEG-encoded DICOM is replaced by the decoded JPEG.
+    if (pDICOMStack->m_bIsJPEGEncoded) {
+      MESSAGE("Decoding JPEG-compressed slices ...");
+      pDICOMStack->m_iAllocated = BITS_IN_JSAMPLE;
+    }
+    const unsigned iAllocated = pDICOMStack->m_iAllocated;
+    const bool bSigned = pDICOMStack->m_bSigned;
+    const bool bSwap = pDICOMStack->m_bIsBigEndian !=
+                       EndianConvert::IsBigEndian() && iAllocated > 8;
+    if (bSwap) MESSAGE("Converting Endianess ...");
+    // We pretend 3 component data is 4 component data to simplify processing
+    // later.
+    /// @todo FIXME: this code assumes 3 component data is always 3*char
+    const bool bExpandRGB = pDICOMStack->m_iComponentCount == 3;
 
-      if (!pDICOMFileInfo) continue;
+    for (size_t j=0; j < pDICOMStack->m_Elements.size(); j++) {
+      const SimpleDICOMFileInfo* pDICOMFileInfo =
+        dynamic_cast<SimpleDICOMFileInfo*>(pDICOMStack->m_Elements[j]);
+      // TODO: implement proper DICOM Windowing
+      if (pDICOMFileInfo && pDICOMFileInfo->m_fWindowWidth > 0) {
+        WARNING("DICOM Windowing parameters found!");
+        break;
+      }
+    }
 
-      uint32_t iDataSize = pDICOMStack->m_Elements[j]->GetDataSize();
-      vData.resize(iDataSize);
+    const bool bWritten = WriteSlices(*pDICOMStack, fs, strTempMergeFilename,
+                                      [&](size_t j, vector<char>& vData) {
+      SimpleFileInfo* pFileInfo = pDICOMStack->m_Elements[j];
+      const SimpleDICOMFileInfo* pDICOMFileInfo =
+        dynamic_cast<SimpleDICOMFileInfo*>(pFileInfo);
+      if (!pDICOMFileInfo) {
+        vData.clear();
+        return true;
+      }
 
+      const uint32_t iDataSize = pFileInfo->GetDataSize();
+      vData.resize(bExpandRGB ? (iDataSize / 3) * 4 : iDataSize);
       if (pDICOMStack->m_bIsJPEGEncoded) {
-        MESSAGE("JPEG is %d bytes, offset %d", iDataSize,
-                pDICOMFileInfo->GetOffsetToData());
-        tuvok::JPEG jpg(pDICOMStack->m_Elements[j]->m_strFileName,
+        tuvok::JPEG jpg(pFileInfo->m_strFileName,
                         pDICOMFileInfo->GetOffsetToData());
-        if(!jpg.valid()) {
-          T_ERROR("'%s' reports an embedded JPEG, but the JPEG is invalid.",
-                  pDICOMStack->m_Elements[j]->m_strFileName.c_str());
-          return false;
-        }
-        MESSAGE("jpg is: %u bytes (%ux%u, %u components)", uint32_t(jpg.size()),
-                uint32_t(jpg.width()), uint32_t(jpg.height()),
-                uint32_t(jpg.components()));
-
+        if (!jpg.valid()) return false;
         const char *jpeg_data = jpg.data();
-        copy(jpeg_data, jpeg_data + jpg.size(), &vData[0]);
-        pDICOMStack->m_iAllocated = BITS_IN_JSAMPLE;
-      } else {
-        pDICOMStack->m_Elements[j]->GetData(vData);
-        MESSAGE("Creating intermediate file %s\n%u%%",
-                strTempMergeFilename.c_str(),
-                static_cast<unsigned>((100*j)/pDICOMStack->m_Elements.size()));
+        copy(jpeg_data, jpeg_data + std::min<size_t>(jpg.size(), iDataSize),
+             &vData[0]);
+      } else if (!pFileInfo->GetData(vData, iDataSize, 0)) {
+        return false;
       }
 
-      if (pDICOMStack->m_bIsBigEndian != EndianConvert::IsBigEndian()) {
-        MESSAGE("Converting Endianess ...");
-        switch (pDICOMStack->m_iAllocated) {
-          case  8 : break;
-          case 16 : {
-                short *pData = reinterpret_cast<short*>(&vData[0]);
-                for (uint32_t k = 0;k<iDataSize/2;k++)
-                  pData[k] = EndianConvert::Swap<short>(pData[k]);
-                } break;
-          case 32 : {
-                int *pData = reinterpret_cast<int*>(&vData[0]);
-                for (uint32_t k = 0;k<iDataSize/4;k++)
-                  pData[k] = EndianConvert::Swap<int>(pData[k]);
-                } break;
-        }
-      }
+      const size_t iCount = iDataSize / (iAllocated / 8);
+      if (bSwap) tuvok::SwapEndianness(&vData[0], iCount, iAllocated);
 
       // HACK: For now we set bias to 0 for unsigned file as we've
       // encountered a number of DICOM files files where the bias
       // parameter would create negative values and so far I don't know
       // how to interpret this correctly
-      if (!pDICOMStack->m_bSigned) pDICOMFileInfo->m_fBias = 0.0f;
-
-      if (pDICOMFileInfo->m_fScale != 1.0f || pDICOMFileInfo->m_fBias != 0.0f) {
-        MESSAGE("Applying Scale and Bias  ...");
-        if (pDICOMStack->m_bSigned) {
-          switch (pDICOMStack->m_iAllocated) {
-            case  8 :{
-                  char *pData = reinterpret_cast<char*>(&vData[0]);
-                  for (uint32_t k = 0;k<iDataSize/2;k++){
-                    float sbValue = pData[k] * pDICOMFileInfo->m_fScale + pDICOMFileInfo->m_fBias;
-                    pData[k] = (char)(sbValue);
-                  }} break;
-            case 16 : {
-                  short *pData = reinterpret_cast<short*>(&vData[0]);
-                  for (uint32_t k = 0;k<iDataSize/2;k++){
-                    float sbValue = pData[k] * pDICOMFileInfo->m_fScale + pDICOMFileInfo->m_fBias;
-                    pData[k] = (short)(sbValue);
-                  }} break;
-            case 32 : {
-                  int *pData = reinterpret_cast<int*>(&vData[0]);
-                  for (uint32_t k = 0;k<iDataSize/4;k++){
-                    float sbValue = pData[k] * pDICOMFileInfo->m_fScale + pDICOMFileInfo->m_fBias;
-                    pData[k] = (int)(sbValue);
-                  }} break;
-          }
-        } else {
-          switch (pDICOMStack->m_iAllocated) {
-            case  8 :{
-                  unsigned char *pData = reinterpret_cast<unsigned char*>(&vData[0]);
-                  for (uint32_t k = 0;k<iDataSize/2;k++){
-                    float sbValue = pData[k] * pDICOMFileInfo->m_fScale + pDICOMFileInfo->m_fBias;
-                    pData[k] = (unsigned char)(sbValue);
-                  }} break;
-            case 16 : {
-                  unsigned short *pData = reinterpret_cast<unsigned short*>(&vData[0]);
-                  for (uint32_t k = 0;k<iDataSize/2;k++){
-                    float sbValue = pData[k] * pDICOMFileInfo->m_fScale + pDICOMFileInfo->m_fBias;
-                    pData[k] = (unsigned short)(sbValue);
-                  }} break;
-            case 32 : {
-                  unsigned int *pData = reinterpret_cast<unsigned int*>(&vData[0]);
-                  for (uint32_t k = 0;k<iDataSize/4;k++) {
-                    float sbValue = pData[k] * pDICOMFileInfo->m_fScale + pDICOMFileInfo->m_fBias;
-                    pData[k] = (unsigned int)(sbValue);
-                  }} break;
-          }
-        }
-      }
- 
-      // TODO: implement proper DICOM Windowing
-      if (pDICOMFileInfo->m_fWindowWidth > 0) {
-        WARNING("DICOM Windowing parameters found!");
+      const float fScale = pDICOMFileInfo->m_fScale;
+      const float fBias = bSigned ? pDICOMFileInfo->m_fBias : 0.0f;
+      if (fScale != 1.0f || fBias != 0.0f) {
+        tuvok::ScaleBias(&vData[0], iCount, iAllocated, bSigned,
+                         fScale, fBias);
       }
 
-      // Create temporary file with the DICOM (image) data.  We pretend 3
-      // component data is 4 component data to simplify processing later.
-      /// @todo FIXME: this code assumes 3 component data is always 3*char
-      if (pDICOMStack->m_iComponentCount == 3) {
-        uint32_t iRGBADataSize = (iDataSize / 3) * 4;
-
-        // Later we'll tell RAWConverter that this dataset has
-        // m_iComponentCount components.  Since we're upping the number of
-        // components here, we update the component count too.
-        pDICOMStack->m_iComponentCount = 4;
-        // Do note that the number of components in the data and the number of
-        // components in our in-memory copy of the data now differ.
-
-        unsigned char *pRGBAData = new unsigned char[iRGBADataSize];
-        for (uint32_t k = 0;k<iDataSize/3;k++) {
-          pRGBAData[k*4+0] = vData[k*3+0];
-          pRGBAData[k*4+1] = vData[k*3+1];
-          pRGBAData[k*4+2] = vData[k*3+2];
-          pRGBAData[k*4+3] = 255;
-        }
-        fs.write((char*)pRGBAData, iRGBADataSize);
-        delete[] pRGBAData;
-      } else {
-        fs.write(&vData[0], iDataSize);
+      if (bExpandRGB) {
+        tuvok::ExpandRGBToRGBA(reinterpret_cast<unsigned char*>(&vData[0]),
+                               iDataSize / 3);
       }
+      return true;
+    });
+    if (!bWritten) {
+      fs.close();
+      remove(strTempMergeFilename.c_str());
+      return false;
     }
 
+    // Later we'll tell RAWConverter that this dataset has
+    // m_iComponentCount components.  Since we upped the number of
+    // components above, we update the component count too.
+    if (bExpandRGB) pDICOMStack->m_iComponentCount = 4;
+
     fs.close();
     MESSAGE("    done creating intermediate file %s", strTempMergeFilename.c_str());
 
@@ -486,8 +521,7 @@ bool IOManager::ConvertDataset(FileStackInfo* pStack,
                                       strTempDir, 0, pDICOMStack->m_iAllocated,
                                       pDICOMStack->m_iComponentCount,
                                       timesteps,
-                                      pDICOMStack->m_bIsBigEndian !=
-                                      EndianConvert::IsBigEndian(),
+                                      false, // already in native byte order
                                       pDICOMStack->m_bSigned,
                                       false, iSize, pDICOMStack->m_fvfAspect,
                                       "DICOM stack",
@@ -530,14 +564,14 @@ bool IOManager::ConvertDataset(FileStackInfo* pStack,
       return false;
     }
 
-    vector<char> vData;
-    for (size_t j = 0;j<pStack->m_Elements.size();j++) {
-      pStack->m_Elements[j]->GetData(vData);
-
-      fs.write(&vData[0], vData.size());
-      MESSAGE("Creating intermediate file %s\n%u%%",
-              strTempMergeFilename.c_str(),
-              static_cast<unsigned>((100*j)/pStack->m_Elements.size()));
+    const bool bWritten = WriteSlices(*pStack, fs, strTempMergeFilename,
+                                      [&](size_t j, vector<char>& vData) {
+      return pStack->m_Elements[j]->GetData(vData);
+    });
+    if (!bWritten) {
+      fs.close();
+      remove(strTempMergeFilename.c_str());
+      return false;
     }
 
     fs.close();
@@ -591,156 +625,6 @@ bool IOManager::ConvertDataset(FileStackInfo* pStack,
   #pragma warning(default:4996)
 #endif
 
-class MergeDataset {
-public:
-  MergeDataset(std::string _strFilename="", uint64_t _iHeaderSkip=0, bool _bDelete=false,
-               double _fScale=1.0, double _fBias=0.0) :
-    strFilename(_strFilename),
-    iHeaderSkip(_iHeaderSkip),
-    bDelete(_bDelete),
-    fScale(_fScale),
-    fBias(_fBias)
-  {}
-
-  std::string strFilename;
-  uint64_t iHeaderSkip;
-  bool bDelete;
-  double fScale;
-  double fBias;
-};
-
-template <class T> class DataMerger {
-public:
-  DataMerger(const std::vector<MergeDataset>& strFiles,
-             const std::string& strTarget, uint64_t iElemCount,
-             tuvok::MasterController* pMasterController,
-             bool bUseMaxMode) :
-    bIsOK(false)
-  {
-    AbstrDebugOut& dbg = *(pMasterController->DebugOut());
-    dbg.Message(_func_,"Copying first file %s ...",
-                SysTools::GetFilename(strFiles[0].strFilename).c_str());
-    if (!LargeRAWFile::Copy(strFiles[0].strFilename, strTarget,
-                            strFiles[0].iHeaderSkip)) {
-      dbg.Error("Could not copy '%s' to '%s'", strFiles[0].strFilename.c_str(),
-                strTarget.c_str());
-      bIsOK = false;
-      return;
-    }
-
-    dbg.Message(_func_,"Merging ...");
-    LargeRAWFile target(strTarget);
-    target.Open(true);
-
-    if (!target.IsOpen()) {
-      dbg.Error("Could not open '%s'", strTarget.c_str());
-      remove(strTarget.c_str());
-      bIsOK = false;
-      return;
-    }
-
-    uint64_t iCopySize = std::min(iElemCount,BLOCK_COPY_SIZE/2)/sizeof(T);
-    T* pTargetBuffer = new T[size_t(iCopySize)];
-    T* pSourceBuffer = new T[size_t(iCopySize)];
-    for (size_t i = 1;i<strFiles.size();i++) {
-      dbg.Message(_func_,"Merging with file %s ...",
-                  SysTools::GetFilename(strFiles[i].strFilename).c_str());
-      LargeRAWFile source(strFiles[i].strFilename, strFiles[i].iHeaderSkip);
-      source.Open(false);
-      if (!source.IsOpen()) {
-        dbg.Error(_func_, "Could not open '%s'!",
-                  strFiles[i].strFilename.c_str());
-        delete [] pTargetBuffer;
-        delete [] pSourceBuffer;
-        target.Close();
-        remove(strTarget.c_str());
-        bIsOK = false;
-        return;
-      }
-
-      uint64_t iReadSize=0;
-      do {
-         source.ReadRAW((unsigned char*)pSourceBuffer, iCopySize*sizeof(T));
-         iCopySize = target.ReadRAW((unsigned char*)pTargetBuffer,
-                                    iCopySize*sizeof(T))/sizeof(T);
-
-         if (bUseMaxMode) {
-           if (i == 1) {
-             for (uint64_t j = 0;j<iCopySize;j++) {
-               pTargetBuffer[j] = std::max<T>(
-                 T(std::min<double>(
-                   strFiles[0].fScale*(pTargetBuffer[j] + strFiles[0].fBias),
-                   static_cast<double>(std::numeric_limits<T>::max())
-                 )),
-                 T(std::min<double>(
-                   strFiles[i].fScale*(pSourceBuffer[j] + strFiles[i].fBias),
-                   static_cast<double>(std::numeric_limits<T>::max()))
-                 )
-               );
-             }
-           } else {
-             for (uint64_t j = 0;j<iCopySize;j++) {
-               pTargetBuffer[j] = std::max<T>(
-                 pTargetBuffer[j],
-                 T(std::min<double>(strFiles[i].fScale*(pSourceBuffer[j] +
-                                                        strFiles[i].fBias),
-                                    static_cast<double>(std::numeric_limits<T>::max())))
-               );
-             }
-           }
-         } else {
-           if (i == 1) {
-             for (uint64_t j = 0;j<iCopySize;j++) {
-               T a = T(std::min<double>(
-                 strFiles[0].fScale*(pTargetBuffer[j] + strFiles[0].fBias),
-                 static_cast<double>(std::numeric_limits<T>::max())
-               ));
-               T b = T(std::min<double>(
-                 strFiles[i].fScale*(pSourceBuffer[j] + strFiles[i].fBias),
-                 static_cast<double>(std::numeric_limits<T>::max())
-               ));
-               T val = a + b;
-
-               if (val < a || val < b) // overflow
-                 pTargetBuffer[j] = std::numeric_limits<T>::max();
-               else
-                 pTargetBuffer[j] = val;
-             }
-           } else {
-             for (uint64_t j = 0;j<iCopySize;j++) {
-               T b = T(std::min<double>(
-                 strFiles[i].fScale*(pSourceBuffer[j] + strFiles[i].fBias),
-                 static_cast<double>(std::numeric_limits<T>::max())
-               ));
-               T val = pTargetBuffer[j] + b;
-
-               if (val < pTargetBuffer[j] || val < b) // overflow
-                 pTargetBuffer[j] = std::numeric_limits<T>::max();
-               else
-                 pTargetBuffer[j] = val;
-             }
-           }
-         }
-         target.SeekPos(iReadSize*sizeof(T));
-         target.WriteRAW((unsigned char*)pTargetBuffer, iCopySize*sizeof(T));
-         iReadSize += iCopySize;
-      } while (iReadSize < iElemCount);
-      source.Close();
-    }
-
-    delete [] pTargetBuffer;
-    delete [] pSourceBuffer;
-    target.Close();
-
-    bIsOK = true;
-  }
-
-  bool IsOK() const {return bIsOK;}
-
-private:
-  bool bIsOK;
-};
-
 bool IOManager::MergeDatasets(const vector <string>& strFilenames,
                               const vector <double>& vScales,
                               const vector<double>& vBiases,
@@ -918,21 +802,21 @@ bool IOManager::MergeDatasets(const vector <string>& strFilenames,
   string strMergedFile = strTempDir + "merged.raw";
 
   bool bIsMerged = false;
-  MasterController *MCtlr = &(Controller::Instance());
+  AbstrDebugOut& dbg = Controller::Debug::Out();
   if (bSignedG) {
     if (bIsFloatG) {
       assert(iComponentSizeG >= 32);
       switch (iComponentSizeG) {
         case 32 : {
           DataMerger<float> d(vIntermediateFiles, strMergedFile,
-                              vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                              vVolumeSizeG.volume()*iComponentCountG, dbg,
                               bUseMaxMode);
           bIsMerged = d.IsOK();
           break;
         }
         case 64 : {
           DataMerger<double> d(vIntermediateFiles, strMergedFile,
-                               vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                               vVolumeSizeG.volume()*iComponentCountG, dbg,
                                bUseMaxMode);
           bIsMerged = d.IsOK();
           break;
@@ -942,28 +826,28 @@ bool IOManager::MergeDatasets(const vector <string>& strFilenames,
       switch (iComponentSizeG) {
         case 8  : {
           DataMerger<char> d(vIntermediateFiles, strMergedFile,
-                             vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                             vVolumeSizeG.volume()*iComponentCountG, dbg,
                              bUseMaxMode);
           bIsMerged = d.IsOK();
           break;
         }
         case 16 : {
           DataMerger<short> d(vIntermediateFiles, strMergedFile,
-                              vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                              vVolumeSizeG.volume()*iComponentCountG, dbg,
                               bUseMaxMode);
           bIsMerged = d.IsOK();
           break;
         }
         case 32 : {
           DataMerger<int> d(vIntermediateFiles, strMergedFile,
-                            vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                            vVolumeSizeG.volume()*iComponentCountG, dbg,
                             bUseMaxMode);
           bIsMerged = d.IsOK();
           break;
         }
         case 64 : {
           DataMerger<int64_t> d(vIntermediateFiles, strMergedFile,
-                                vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                                vVolumeSizeG.volume()*iComponentCountG, dbg,
                                 bUseMaxMode);
           bIsMerged = d.IsOK();
           break;
@@ -979,28 +863,28 @@ bool IOManager::MergeDatasets(const vector <string>& strFilenames,
     switch (iComponentSizeG) {
       case 8  : {
         DataMerger<unsigned char> d(vIntermediateFiles, strMergedFile,
-                                    vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                                    vVolumeSizeG.volume()*iComponentCountG, dbg,
                                     bUseMaxMode);
         bIsMerged = d.IsOK();
         break;
       }
       case 16 : {
         DataMerger<unsigned short> d(vIntermediateFiles, strMergedFile,
-                                     vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                                     vVolumeSizeG.volume()*iComponentCountG, dbg,
                                      bUseMaxMode);
         bIsMerged = d.IsOK();
         break;
       }
       case 32 : {
         DataMerger<unsigned int> d(vIntermediateFiles, strMergedFile,
-                                   vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                                   vVolumeSizeG.volume()*iComponentCountG, dbg,
                                    bUseMaxMode);
         bIsMerged = d.IsOK();
         break;
       }
       case 64 : {
         DataMerger<uint64_t> d(vIntermediateFiles, strMergedFile,
-                               vVolumeSizeG.volume()*iComponentCountG, MCtlr,
+                               vVolumeSizeG.volume()*iComponentCountG, dbg,
                                bUseMaxMode);
         bIsMerged = d.IsOK();
         break;
@@ -1330,26 +1214,6 @@ void IOManager::AddReader(shared_ptr<FileBackedDataset> ds) {
   m_dsFactory->AddReader(ds);
 }
 
-class MCData {
-public:
-  MCData(const std::string& strTargetFile) :
-    m_strTargetFile(strTargetFile)
-  {}
-
-  virtual ~MCData() {}
-  virtual bool PerformMC(void* pData, const UINTVECTOR3& vBrickSize, const UINT64VECTOR3& vBrickOffset) = 0;
-
-protected:
-  std::string m_strTargetFile;
-};
-
-bool MCBrick(void* pData, const UINT64VECTOR3& vBrickSize, 
-             const UINT64VECTOR3& vBrickOffset, void* pUserContext) {
-    MCData* pMCData = (MCData*)pUserContext;
-    return pMCData->PerformMC(pData, UINTVECTOR3(vBrickSize), vBrickOffset);
-}
-
-
 bool IOManager::ExtractImageStack(const tuvok::UVFDataset* pSourceData,
                                   const TransferFunction1D* pTrans,
                                   uint64_t iLODlevel, 
@@ -1404,97 +1268,275 @@ bool IOManager::ExtractImageStack(const tuvok::UVFDataset* pSourceData,
   return bTargetCreated;
 }
 
-template <class T> class MCDataTemplate  : public MCData {
-public:
-  MCDataTemplate(const std::string& strTargetFile, T TIsoValue, 
-                 const FLOATVECTOR3& vScale, 
-                 UINT64VECTOR3 vDataSize, tuvok::AbstrGeoConverter* conv,
-                 const FLOATVECTOR4& vColor) :
-    MCData(strTargetFile),
-    m_TIsoValue(TIsoValue),
-    m_iIndexoffset(0),
-    m_pMarchingCubes(new MarchingCubes<T>()),
-    m_vDataSize(vDataSize),
-    m_conv(conv),
-    m_vColor(vColor),
-    m_vScale(vScale)
-  {
-  }
-
-  virtual ~MCDataTemplate() {
-    tuvok::Mesh m = tuvok::Mesh(m_vertices, m_normals, tuvok::TexCoordVec(),
-                                tuvok::ColorVec(), m_indices, m_indices, 
-                                tuvok::IndexVec(),tuvok::IndexVec(), 
-                                false,false,"Marching Cubes mesh by ImageVis3D",
-                                tuvok::Mesh::MT_TRIANGLES);
-    m.SetDefaultColor(m_vColor);
-    m_conv->ConvertToNative(m, m_strTargetFile);
-  }
-
-  virtual bool PerformMC(void* pData, const UINTVECTOR3& vBrickSize, const UINT64VECTOR3& vBrickOffset) {
-   
-    T* ptData = (T*)pData;
-
-    // extract isosurface
-    m_pMarchingCubes->SetVolume(vBrickSize.x, vBrickSize.y, vBrickSize.z,
-                                ptData);
-    m_pMarchingCubes->Process(m_TIsoValue);
-
-    // brick scale
-    float fMaxSize = (FLOATVECTOR3(m_vDataSize) * m_vScale).maxVal();
-
-    FLOATVECTOR3 vecBrickOffset(vBrickOffset);
-    vecBrickOffset = vecBrickOffset * m_vScale;
+namespace {
+  /// Marching cubes which remembers, for every vertex it creates, the grid
+  /// edge the vertex lies on: the lower corner of the edge in xyz and its
+  /// axis (0=x, 1=y, 2=z) in w.  Vertices are created in the order they
+  /// end up in m_Isosurface, so m_vVertexEdges[i] belongs to vertex i.
+  template <class T> class EdgeTrackingMC : public MarchingCubes<T> {
+  public:
+    std::vector<INTVECTOR4> m_vVertexEdges;
+
+    virtual void Process(T TIsoValue) {
+      m_vVertexEdges.clear();
+      MarchingCubes<T>::Process(TIsoValue);
+    }
 
-    for (int i = 0;i<m_pMarchingCubes->m_Isosurface->iVertices;i++) {
-      m_vertices.push_back((m_pMarchingCubes->m_Isosurface->vfVertices[i]+vecBrickOffset-FLOATVECTOR3(m_vDataSize)/2.0f)/fMaxSize);
+  protected:
+    virtual int MakeVertex(int iEdgeIndex, int i, int j, int k,
+                           Isosurface* sliceIso) {
+      // lower corner offset and axis of the cell edges, see MC.inl
+      static const int edges[12][4] = {
+        {0,1,0, 0}, {1,0,0, 1}, {0,0,0, 0}, {0,0,0, 1},
+        {0,1,1, 0}, {1,0,1, 1}, {0,0,1, 0}, {0,0,1, 1},
+        {0,1,0, 2}, {1,1,0, 2}, {1,0,0, 2}, {0,0,0, 2}
+      };
+      const int* e = edges[iEdgeIndex];
+      m_vVertexEdges.push_back(INTVECTOR4(i+e[0], j+e[1], k+e[2], e[3]));
+      return MarchingCubes<T>::MakeVertex(iEdgeIndex, i, j, k, sliceIso);
     }
+  };
+
+  struct MCBrick {
+    BrickKey      key;
+    UINTVECTOR3   vIndex;     ///< position in the brick layout
+    UINTVECTOR3   vSize;      ///< voxels, including the overlap
+    UINTVECTOR3   vLead;      ///< overlap voxels before the first owned one
+    UINT64VECTOR3 vStart;     ///< global position of the first owned voxel
+    INTVECTOR3    vFirstCell; ///< cells this brick triangulates,
+    INTVECTOR3    vEndCell;   ///< see MarchingCubes::SetCellRange
+  };
+
+  /// Extracts the isosurface of one LoD brick by brick.  Bricks whose value
+  /// range does not contain the isovalue are skipped and the others are
+  /// triangulated in parallel, each one only the cells it owns, i.e. those
+  /// up to the first voxel of the next brick.  The pieces are handed to the
+  /// writer in brick order.  Vertices on a face between two bricks are
+  /// created by both; they are merged through a map from the grid edge the
+  /// vertex lies on to its index in the output.  Entries are dropped once
+  /// the extraction has moved past the layer of bricks they belong to, so
+  /// the map stays at about the size of two brick faces.
+  template <class T>
+  bool ExtractIsosurfaceTemplate(const UVFDataset& ds, size_t iLOD,
+                                 double fIsovalue, MeshWriter& writer) {
+    const T TIsoValue = T(fIsovalue);
+    const UINT64VECTOR3 vDomainSize = ds.GetDomainSize(iLOD);
+    const uint64_t iSliceSize = vDomainSize.x * vDomainSize.y;
+    const UINTVECTOR3 vOverlap = ds.GetBrickOverlapSize();
+
+    // vertices go into the unit cube, like all other meshes
+    const FLOATVECTOR3 vScale = FLOATVECTOR3(ds.GetScale());
+    const FLOATVECTOR3 vExtent = FLOATVECTOR3(vDomainSize) * vScale;
+    const float fMaxSize = vExtent.maxVal();
+
+    const size_t iPrefetch = 16;
+    uint32_t iVertexCount = 0;
+
+    for (size_t ts = 0; ts < size_t(ds.GetNumberOfTimesteps()); ++ts) {
+      const UINTVECTOR3 vLayout = ds.GetBrickLayout(iLOD, ts);
+
+      // global start of the bricks along each axis
+      std::vector<uint64_t> vStarts[3];
+      for (size_t d = 0; d < 3; ++d) {
+        vStarts[d].resize(vLayout[d]+1, 0);
+        for (uint32_t b = 0; b < vLayout[d]; ++b) {
+          UINTVECTOR3 vPos(0,0,0);
+          vPos[d] = b;
+          const BrickKey k(ts, iLOD, vPos.x + vPos.y*vLayout.x +
+                                     vPos.z*vLayout.x*vLayout.y);
+          vStarts[d][b+1] = vStarts[d][b] + ds.GetEffectiveBrickSize(k)[d];
+        }
+      }
 
-    for (int i = 0;i<m_pMarchingCubes->m_Isosurface->iVertices;i++) {
-      m_normals.push_back(m_pMarchingCubes->m_Isosurface->vfNormals[i]);
-    }    
+      std::vector<MCBrick> bricks;
+      for (uint32_t z = 0; z < vLayout.z; ++z) {
+        for (uint32_t y = 0; y < vLayout.y; ++y) {
+          for (uint32_t x = 0; x < vLayout.x; ++x) {
+            MCBrick brick;
+            brick.key = BrickKey(ts, iLOD, x + y*vLayout.x +
+                                           z*vLayout.x*vLayout.y);
+            if (!ds.ContainsData(brick.key, double(TIsoValue),
+                                 double(TIsoValue))) continue;
+
+            brick.vIndex = UINTVECTOR3(x,y,z);
+            brick.vSize = ds.GetBrickVoxelCounts(brick.key);
+            for (size_t d = 0; d < 3; ++d) {
+              const uint32_t b = brick.vIndex[d];
+              const bool bLast = b+1 == vLayout[d];
+              // TOC bricks are padded at the domain boundary, the old
+              // raster data blocks are not and store half the overlap
+              // on either side
+              brick.vLead[d] = ds.IsTOCBlock() ? vOverlap[d]
+                                               : (b > 0 ? vOverlap[d]/2 : 0);
+              brick.vStart[d] = vStarts[d][b];
+              brick.vFirstCell[d] = int(brick.vLead[d]);
+              brick.vEndCell[d] = std::min<int>(
+                int(brick.vSize[d]) - 1,
+                int(brick.vLead[d] + vStarts[d][b+1] - vStarts[d][b]) -
+                  (bLast ? 1 : 0)
+              );
+            }
+            bricks.push_back(brick);
+          }
+        }
+      }
+      if (bricks.empty()) continue;
 
-    for (int i = 0;i<m_pMarchingCubes->m_Isosurface->iTriangles;i++) {
-      m_indices.push_back(m_pMarchingCubes->m_Isosurface->viTriangles[i].x+m_iIndexoffset);
-      m_indices.push_back(m_pMarchingCubes->m_Isosurface->viTriangles[i].y+m_iIndexoffset);
-      m_indices.push_back(m_pMarchingCubes->m_Isosurface->viTriangles[i].z+m_iIndexoffset);
-    }
+      std::vector<BrickKey> keys;
+      for (size_t b = 0; b < std::min(iPrefetch, bricks.size()); ++b) {
+        keys.push_back(bricks[b].key);
+      }
+      ds.Prefetch(keys);
+
+      std::unordered_map<uint64_t, uint32_t> seams;
+      uint64_t iSeamLayer = 0;
+      // the workers only note what went wrong; it is reported after the
+      // loop, from this thread.
+      bool bOK = true;
+      int iUnreadBrick = -1;
+      bool bWriteFailed = false;
+      const int iBricks = int(bricks.size());
+      const bool bConcurrentRead = ds.ConcurrentGetBrick();
+      MESSAGE("Extracting isosurface: %d bricks of timestep %u", iBricks,
+              static_cast<unsigned>(ts));
+
+#pragma omp parallel for ordered schedule(dynamic,1)
+      for (int b = 0; b < iBricks; ++b) {
+        const MCBrick& brick = bricks[b];
+        std::vector<uint8_t> vData;
+        bool bRead = false;
+        auto read = [&]() {
+          if (size_t(b) % iPrefetch == 0 && size_t(b)+iPrefetch < bricks.size()) {
+            std::vector<BrickKey> next;
+            for (size_t n = size_t(b)+iPrefetch;
+                 n < std::min(size_t(b)+2*iPrefetch, bricks.size()); ++n) {
+              next.push_back(bricks[n].key);
+            }
+            ds.Prefetch(next);
+          }
+          bRead = ds.GetBrick(brick.key, vData) &&
+                  vData.size() >= brick.vSize.volume()*sizeof(T);
+        };
+        if (bConcurrentRead) {
+          read();
+        } else {
+#pragma omp critical (ExtractIsosurfaceRead)
+          read();
+        }
 
-    m_iIndexoffset += m_pMarchingCubes->m_Isosurface->iVertices;
+        EdgeTrackingMC<T> mc;
+        if (bRead) {
+          mc.SetVolume(int(brick.vSize.x), int(brick.vSize.y),
+                       int(brick.vSize.z), reinterpret_cast<T*>(&vData[0]));
+          mc.SetCellRange(brick.vFirstCell, brick.vEndCell);
+          mc.Process(TIsoValue);
+        }
 
+#pragma omp ordered
+        {
+          if (!bRead && bOK) {
+            iUnreadBrick = b;
+            bOK = false;
+          }
+          if (bOK) {
+            // seam vertices below this layer of bricks are not needed
+            // anymore
+            if (brick.vStart.z > iSeamLayer) {
+              iSeamLayer = brick.vStart.z;
+              for (auto s = seams.begin(); s != seams.end();) {
+                if ((s->first/3) / iSliceSize < iSeamLayer) {
+                  s = seams.erase(s);
+                } else {
+                  ++s;
+                }
+              }
+            }
+
+            const Isosurface* iso = mc.m_Isosurface;
+            const FLOATVECTOR3 vOffset =
+              FLOATVECTOR3(brick.vStart) - FLOATVECTOR3(brick.vLead);
+
+            VertVec vertices;
+            NormVec normals;
+            IndexVec remap(size_t(iso->iVertices));
+            vertices.reserve(size_t(iso->iVertices));
+            normals.reserve(size_t(iso->iVertices));
+            for (int v = 0; v < iso->iVertices; ++v) {
+              const INTVECTOR4& e = mc.m_vVertexEdges[v];
+              bool bSeam = false;
+              for (int d = 0; d < 3; ++d) {
+                if (d == e.w) continue;
+                if ((e[d] == brick.vFirstCell[d] && brick.vIndex[d] > 0) ||
+                    (e[d] == brick.vEndCell[d] &&
+                     brick.vIndex[d]+1 < vLayout[d])) {
+                  bSeam = true;
+                }
+              }
+
+              uint64_t iEdge = 0;
+              if (bSeam) {
+                const UINT64VECTOR3 vCorner =
+                  brick.vStart + UINT64VECTOR3(e.xyz()) -
+                  UINT64VECTOR3(brick.vLead);
+                iEdge = (vCorner.x + vCorner.y*vDomainSize.x +
+                         vCorner.z*iSliceSize)*3 + uint64_t(e.w);
+                auto s = seams.find(iEdge);
+                if (s != seams.end()) {
+                  remap[v] = s->second;
+                  continue;
+                }
+                seams[iEdge] = iVertexCount;
+              }
+              remap[v] = iVertexCount++;
+              vertices.push_back(((iso->vfVertices[v] + vOffset) * vScale -
+                                  vExtent/2.0f) / fMaxSize);
+              normals.push_back(iso->vfNormals[v]);
+            }
+
+            IndexVec triangles;
+            triangles.reserve(size_t(iso->iTriangles)*3);
+            for (int t = 0; t < iso->iTriangles; ++t) {
+              triangles.push_back(remap[iso->viTriangles[t].x]);
+              triangles.push_back(remap[iso->viTriangles[t].y]);
+              triangles.push_back(remap[iso->viTriangles[t].z]);
+            }
+
+            if (!writer.AddChunk(vertices, normals, triangles)) {
+              bWriteFailed = true;
+              bOK = false;
+            }
+          }
+        }
+      }
+      if (iUnreadBrick >= 0) {
+        T_ERROR("Could not read brick %u of timestep %u.",
+                static_cast<unsigned>(std::get<2>(bricks[iUnreadBrick].key)),
+                static_cast<unsigned>(ts));
+      }
+      if (bWriteFailed) T_ERROR("Writing the mesh failed.");
+      if (!bOK) return false;
+    }
     return true;
   }
-
-protected:
-  T                  m_TIsoValue;
-  uint32_t           m_iIndexoffset;
-  std::shared_ptr<MarchingCubes<T>> m_pMarchingCubes;
-  UINT64VECTOR3      m_vDataSize;
-  tuvok::AbstrGeoConverter* m_conv;
-  FLOATVECTOR4       m_vColor;
-  FLOATVECTOR3       m_vScale;
-  tuvok::VertVec     m_vertices;
-  tuvok::NormVec     m_normals;
-  tuvok::IndexVec    m_indices;
-};
+}
 
 bool IOManager::ExtractIsosurface(const tuvok::UVFDataset* pSourceData,
                                   uint64_t iLODlevel, double fIsovalue,
                                   const FLOATVECTOR4& vfColor,
                                   const string& strTargetFilename,
                                   const string& strTempDir) const {
+  // the mesh is streamed straight into the target, there is nothing to put
+  // into a temp file; the parameter stays for tuvok.io.extractIsosurface
+  (void)strTempDir;
+
   if (pSourceData->GetComponentCount() != 1) {
     T_ERROR("Isosurface extraction only supported for scalar volumes.");
     return false;
   }
 
-  string strTempFilename = strTempDir + SysTools::GetFilename(strTargetFilename)+".tmp_raw";
-  std::shared_ptr<MCData> pMCData;
-
   bool   bFloatingPoint  = pSourceData->GetIsFloat();
   bool   bSigned         = pSourceData->GetIsSigned();
   unsigned iComponentSize = pSourceData->GetBitWidth();
-  FLOATVECTOR3 vScale    = FLOATVECTOR3(pSourceData->GetScale());
 
   AbstrGeoConverter* conv = GetGeoConverterForExt(SysTools::ToLowerCase(SysTools::GetExt(strTargetFilename)),true, false);
   
@@ -1503,72 +1545,49 @@ bool IOManager::ExtractIsosurface(const tuvok::UVFDataset* pSourceData,
     return false;
   }
 
-  UINT64VECTOR3 vDomainSize = pSourceData->GetDomainSize(size_t(iLODlevel));
+  typedef bool (*ExtractFunc)(const UVFDataset&, size_t, double, MeshWriter&);
+  ExtractFunc extract = NULL;
 
   if (bFloatingPoint) {
     if (bSigned) {
       switch (iComponentSize) {
-        case 32:
-          pMCData.reset(new MCDataTemplate<float>(strTargetFilename,
-            float(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
-        case 64:
-          pMCData.reset(new MCDataTemplate<double>(strTargetFilename,
-            double(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
+        case 32: extract = &ExtractIsosurfaceTemplate<float>; break;
+        case 64: extract = &ExtractIsosurfaceTemplate<double>; break;
       }
     }
   } else {
     if (bSigned) {
       switch (iComponentSize) {
-        case  8:
-          pMCData.reset(new MCDataTemplate<char>(strTargetFilename,
-            char(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
-        case 16:
-          pMCData.reset(new MCDataTemplate<short>(strTargetFilename,
-            short(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
-        case 32:
-          pMCData.reset(new MCDataTemplate<int>(strTargetFilename,
-            int(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
-        case 64:
-          pMCData.reset(new MCDataTemplate<int64_t>(strTargetFilename,
-            int64_t(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
+        case  8: extract = &ExtractIsosurfaceTemplate<char>; break;
+        case 16: extract = &ExtractIsosurfaceTemplate<short>; break;
+        case 32: extract = &ExtractIsosurfaceTemplate<int>; break;
+        case 64: extract = &ExtractIsosurfaceTemplate<int64_t>; break;
       }
     } else {
       switch (iComponentSize) {
-        case  8:
-          pMCData.reset(new MCDataTemplate<unsigned char>(strTargetFilename,
-            (unsigned char)(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
-        case 16:
-          pMCData.reset(new MCDataTemplate<unsigned short>(strTargetFilename,
-            (unsigned short)(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
-        case 32:
-          pMCData.reset(new MCDataTemplate<uint32_t>(strTargetFilename,
-            uint32_t(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
-        case 64:
-          pMCData.reset(new MCDataTemplate<uint64_t>(strTargetFilename,
-            uint64_t(fIsovalue), vScale, vDomainSize, conv, vfColor
-          )); break;
+        case  8: extract = &ExtractIsosurfaceTemplate<unsigned char>; break;
+        case 16: extract = &ExtractIsosurfaceTemplate<unsigned short>; break;
+        case 32: extract = &ExtractIsosurfaceTemplate<uint32_t>; break;
+        case 64: extract = &ExtractIsosurfaceTemplate<uint64_t>; break;
       }
     }
   }
 
-  if (!pMCData) {
+  if (!extract) {
     T_ERROR("Unsupported data format.");
     return false;
   }
 
-  bool bResult = pSourceData->ApplyFunction(iLODlevel,&MCBrick,
-                                            (void*)pMCData.get(), 1);
+  std::shared_ptr<MeshWriter> writer = conv->CreateMeshWriter(
+    strTargetFilename, "Marching Cubes mesh by ImageVis3D", vfColor
+  );
+  if (!writer) {
+    T_ERROR("Unable to write target file %s", strTargetFilename.c_str());
+    return false;
+  }
 
-  if (SysTools::FileExists(strTempFilename)) remove (strTempFilename.c_str());
+  bool bResult = extract(*pSourceData, size_t(iLODlevel), fIsovalue, *writer);
+  bResult = writer->Close() && bResult;
 
   if (bResult)
     return true;
@@ -2075,25 +2094,6 @@ struct MergeableDatasets : public std::binary_function<Dataset, Dataset, bool> {
   }
 };
 
-namespace {
-  // interpolate a chunk of data into a new range.
-  template<typename IForwIter, typename OForwIter, typename U>
-  void interpolate(IForwIter ibeg, IForwIter iend,
-                   const std::pair<double,double>& src_range,
-                   OForwIter obeg)
-  {
-    const U max_out = std::numeric_limits<U>::max();
-    assert(src_range.second >= src_range.first);
-    const double diff = src_range.second - src_range.first;
-    const double ifactor = max_out / diff;
-    while(ibeg != iend) {
-      *obeg = static_cast<U>((*ibeg - src_range.first) * ifactor);
-      ++obeg;
-      ++ibeg;
-    }
-  }
-}
-
 const std::shared_ptr<const RasterDataBlock> GetFirstRDB(const UVF& uvf)
 {
   for(uint64_t i=0; i < uvf.GetDataBlockCount(); ++i) {
@@ -2328,150 +2328,197 @@ void IdentifyType(const std::vector<std::shared_ptr<UVFDataset>>& uvf,
   }
 }
 
-// Reads in data of the given type.  If data is not stored that way in
-// the file, it will expand it out to the given type.  Assumes it will
-// always be expanding data, never compressing it!
-template<typename T>
-void TypedRead(std::vector<T>& data,
-               const Dataset& ds,
-               const BrickKey& key)
-{
-  size_t width = static_cast<size_t>(ds.GetBitWidth());
-  bool is_signed = ds.GetIsSigned();
-  bool is_float = ds.GetIsFloat();
-
-  size_t dest_width = sizeof(T) * 8;
-  bool dest_signed = ctti<T>::is_signed;
-  bool dest_float = std::is_floating_point<T>::value;
-
-  // fp data implies signed data.
-  assert(is_float ? is_signed : true);
-  assert(dest_float ? dest_signed : true);
-
-  MESSAGE(" [Source Data] Signed: %d  Float: %d  Width: %u",
-          is_signed, is_float, static_cast<unsigned>(width));
-  MESSAGE(" [Destination] Signed: %d  Float: %d  Width: %u",
-          dest_signed, dest_float, static_cast<unsigned>(dest_width));
-
-  // If we're lucky, we can just read the data and be done with it.
-  if(dest_width == width && dest_signed == is_signed &&
-     dest_float == is_float) {
-    MESSAGE("Data is stored the way we need it!  Yay.");
-    ds.GetBrick(key, data);
-    return;
-  }
-
-  // Otherwise we'll need to read it into a temporary buffer and expand
-  // it into the argument vector.
-  std::pair<double, double> range = ds.GetRange();
-
-  if(is_float && width == 32) {
-    std::vector<float> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<float*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else if(is_float && width == 64) {
-    // Can this happen?  What would we expand double into?
-    std::vector<double> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<double*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else if( is_signed &&  8 == width) {
-    std::vector<int8_t> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<int8_t*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else if(!is_signed &&  8 == width) {
-    std::vector<uint8_t> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<uint8_t*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else if( is_signed && 16 == width) {
-    std::vector<int16_t> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<int16_t*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else if(!is_signed && 16 == width) {
-    std::vector<uint16_t> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<uint16_t*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else if( is_signed && 32 == width) {
-    std::vector<int32_t> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<int32_t*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else if(!is_signed && 32 == width) {
-    std::vector<uint32_t> tmpdata;
-    ds.GetBrick(key, tmpdata);
-    data.resize(tmpdata.size() / (width/8));
-    interpolate<uint32_t*, typename std::vector<T>::iterator, T>(
-      &tmpdata[0], (&tmpdata[0]) + tmpdata.size(), range, data.begin()
-    );
-  } else {
-    T_ERROR("Unhandled data type!  Width: %u, Signed: %d, Float: %d",
-            static_cast<unsigned>(width), is_signed, is_float);
-  }
-}
-
 namespace {
+  typedef std::vector<std::shared_ptr<UVFDataset>> UVFList;
+
+  /// The data for one brick of every input volume, and the result.
+  template<typename T> struct ExprBrick {
+    std::vector<std::vector<T>> in;
+    std::vector<T> out;
+  };
+
+  /// Reads the brick of every input, expanded to T if need be.  The
+  /// vectors of 'b' and 'scratch' are reused from brick to brick.
   template<typename T>
-  void ReadAndEvalBrick(
-    RasterDataBlock& rdb,
-    const std::vector<std::shared_ptr<UVFDataset>>& uvfs,
-    const std::vector<BrickTable::const_iterator>& iters,
-    tuvok::expression::Node* tree
-  ) {
-    std::vector<std::vector<T>> involumes(uvfs.size());
-    std::vector<T> output;
+  void ReadBrick(ExprBrick<T>& b, const UVFList& uvfs,
+                 const std::vector<BrickKey>& keys,
+                 ConversionScratch& scratch) {
+    b.in.resize(uvfs.size());
     for(size_t i=0; i < uvfs.size(); ++i) {
-      MESSAGE("Reading brick from volume %u/%u...", static_cast<unsigned>(i+1),
-              static_cast<unsigned>(uvfs.size()));
-      TypedRead<T>(involumes[i], *uvfs[i], iters[i]->first);
+      if(!ReadConverted(*uvfs[i], keys[i], b.in[i], scratch)) {
+        T_ERROR("Could not read brick of volume %u (width: %u, signed: %d, "
+                "float: %d)", static_cast<unsigned>(i),
+                uvfs[i]->GetBitWidth(), uvfs[i]->GetIsSigned(),
+                uvfs[i]->GetIsFloat());
+      }
+    }
+  }
+
+  /// Evaluates the program over the brick, splitting the voxels among
+  /// 'threads' threads.
+  template<typename T>
+  void EvalBrick(ExprBrick<T>& b, const tuvok::expression::Program& prog,
+                 uint32_t threads) {
+    if(threads <= 1) {
+      tuvok::expression::evaluate(prog, b.in, b.out);
+      return;
     }
-    MESSAGE("Evaluating expression ...");
-    tuvok::expression::evaluate(*tree, involumes, output);
+    const size_t n = b.in[0].size();
+    b.out.resize(n);
+    const size_t chunk = tuvok::expression::Program::Span * 16;
+    const int64_t chunks = int64_t((n + chunk - 1) / chunk);
+#pragma omp parallel for num_threads(threads)
+    for(int64_t c=0; c < chunks; ++c) {
+      const size_t offset = size_t(c) * chunk;
+      std::vector<const T*> ptrs(b.in.size());
+      for(size_t i=0; i < b.in.size(); ++i) {
+        assert(b.in[i].size() == n);
+        ptrs[i] = &b.in[i][offset];
+      }
+      prog.Run(&ptrs[0], &b.out[offset], std::min(chunk, n - offset));
+    }
+  }
 
-    MESSAGE("Writing ...");
-    NDBrickKey nk = uvfs[0]->IndexToVectorKey(iters[0]->first);
-    if(false == rdb.SetData(&output[0], nk.lod, nk.brick)) {
-      T_ERROR("Write failed!");
+  template<typename T>
+  bool WriteBrick(RasterDataBlock& rdb, const NDBrickKey& nk, T* data) {
+    return rdb.SetData(data, nk.lod, nk.brick);
+  }
+
+  /// Stores finished bricks on a single writer thread, in the order they
+  /// were queued.  The thread lives as long as the writer does.
+  template<typename T>
+  class BrickWriter {
+  public:
+    explicit BrickWriter(RasterDataBlock& rdb) :
+      m_RDB(rdb), m_Written(0), m_Done(false), m_OK(true), m_Joined(false),
+      m_Thread([this](bool const&, LambdaThread::Interface&) { Run(); })
+    {
+      m_Thread.StartThread();
     }
+    ~BrickWriter() { Finish(); }
+
+    /// Queues a brick; 'data' must stay untouched until WaitFor says so.
+    void Push(const NDBrickKey& nk, T* data) {
+      SCOPEDLOCK(m_Guard);
+      m_Pending.push_back(std::make_pair(nk, data));
+      m_Changed.WakeAll();
+    }
+    /// Blocks until the first 'count' queued bricks are written.
+    void WaitFor(size_t count) {
+      SCOPEDLOCK(m_Guard);
+      while(m_Written < count) { m_Changed.Wait(m_Guard); }
+    }
+    /// Writes what is left and stops the thread.
+    /// @returns false if any of the writes failed.
+    bool Finish() {
+      if(!m_Joined) {
+        {
+          SCOPEDLOCK(m_Guard);
+          m_Done = true;
+          m_Changed.WakeAll();
+        }
+        m_Thread.JoinThread();
+        m_Joined = true;
+      }
+      return m_OK;
+    }
+
+  private:
+    void Run() {
+      for(;;) {
+        std::pair<NDBrickKey, T*> job;
+        {
+          SCOPEDLOCK(m_Guard);
+          while(m_Pending.empty() && !m_Done) { m_Changed.Wait(m_Guard); }
+          if(m_Pending.empty()) { return; }
+          job = m_Pending.front();
+        }
+        const bool ok = WriteBrick(m_RDB, job.first, job.second);
+        SCOPEDLOCK(m_Guard);
+        m_Pending.pop_front();
+        ++m_Written;
+        m_OK = m_OK && ok;
+        m_Changed.WakeAll();
+      }
+    }
+
+    RasterDataBlock& m_RDB;
+    CriticalSection m_Guard;
+    WaitCondition m_Changed;
+    std::deque<std::pair<NDBrickKey, T*>> m_Pending;
+    size_t m_Written;
+    bool m_Done;
+    bool m_OK;
+    bool m_Joined;
+    LambdaThread m_Thread;
+  };
+
+  /// Runs the expression over every brick.  With more than one thread, the
+  /// calling thread reads each brick and evaluates it across the OpenMP
+  /// team while one writer thread stores the previous brick; the team is
+  /// always forked from the calling thread, so the runtime can reuse its
+  /// threads.  Two output buffers alternate, so brick i is only evaluated
+  /// once brick i-2 has been written.  All logging stays on the calling
+  /// thread.
+  template<typename T>
+  void EvaluateBricks(RasterDataBlock& rdb, const UVFList& uvfs,
+                      const std::vector<std::vector<BrickKey>>& keys,
+                      const tuvok::expression::Program& prog,
+                      uint32_t threads) {
+    const size_t nbricks = keys.size();
+    // only ever used by the calling thread
+    ConversionScratch scratch;
+    if(threads <= 1) {
+      ExprBrick<T> b;
+      for(size_t brick=0; brick < nbricks; ++brick) {
+        MESSAGE("Brick %u/%u...", static_cast<unsigned>(brick+1),
+                static_cast<unsigned>(nbricks));
+        ReadBrick(b, uvfs, keys[brick], scratch);
+        EvalBrick(b, prog, 1);
+        if(!WriteBrick(rdb, uvfs[0]->IndexToVectorKey(keys[brick][0]),
+                       &b.out[0])) {
+          T_ERROR("Write failed!");
+        }
+      }
+      return;
+    }
+
+    ExprBrick<T> slot[2];
+    BrickWriter<T> writer(rdb);
+    for(size_t brick=0; brick < nbricks; ++brick) {
+      ExprBrick<T>& cur = slot[brick % 2];
+      MESSAGE("Brick %u/%u...", static_cast<unsigned>(brick+1),
+              static_cast<unsigned>(nbricks));
+      // the writer never looks at 'cur.in'.
+      ReadBrick(cur, uvfs, keys[brick], scratch);
+      if(brick >= 2) { writer.WaitFor(brick-1); }
+      EvalBrick(cur, prog, threads);
+      writer.Push(uvfs[0]->IndexToVectorKey(keys[brick][0]), &cur.out[0]);
+    }
+    if(!writer.Finish()) { T_ERROR("Write failed!"); }
   }
 }
 
-struct cleanup_parser {
-  ~cleanup_parser() { parser_free(); }
-};
-
 void
 IOManager::EvaluateExpression(const std::string& expr,
                               const std::vector<std::string>& volumes,
                               const std::string& out_fn) const
                               throw(tuvok::Exception)
 {
-  parser_set_string(expr.c_str());
-  int parse_err = yyparse();
-  std::unique_ptr<cleanup_parser> p(new cleanup_parser());
+  const std::unique_ptr<tuvok::expression::Node> tree =
+    tuvok::expression::parse(expr);
   assert(!volumes.empty());
 
-  if(parse_err == 1) {
+  if(!tree) {
     throw tuvok::expression::SyntaxError("", 0, 2, __FILE__, __LINE__);
   }
+  // Compile once; every brick is then run through the same program.
+  const tuvok::expression::Program prog(*tree);
+  if(prog.Inputs() > volumes.size()) {
+    throw tuvok::expression::semantic::Error("expression references a "
+                                             "volume that was not given.",
+                                             __FILE__, __LINE__);
+  }
 
   // open all of those files and get UVF datasets for each of them.
   const bool verify=false;
@@ -2494,8 +2541,6 @@ IOManager::EvaluateExpression(const std::string& expr,
     }
   }
 
-  tuvok::expression::Node* tree = parser_tree_root();
-
   // volume iterators
   std::vector<BrickTable::const_iterator> viters;
 #ifdef DETECTED_OS_APPLE
@@ -2541,64 +2586,48 @@ IOManager::EvaluateExpression(const std::string& expr,
   bool is_float, is_signed;
   IdentifyType(uvf, bit_width, is_float, is_signed);
 
-  //     foreach brick:
-  //       load brick into 'involumes'
-  //       evaluate(tree, input-bricks-in-a-vector, output)
-  //       write output somewhere
-  /// @todo FIXME: we should query bit_width, is_float, is_signed to create
-  /// different 'involumes' based on the type we need...
-  size_t brick = 0;
+  // Collect the bricks up front; every input has the same layout.
+  std::vector<std::vector<BrickKey>> keys;
   while(viters[0] != uvf[0]->BricksEnd()) {
+    std::vector<BrickKey> bk(uvf.size());
     for(size_t i=0; i < uvf.size(); ++i) {
-      MESSAGE("Brick %u (file %03u/%03u)...", static_cast<unsigned>(brick),
-              static_cast<unsigned>(i+1), static_cast<unsigned>(uvf.size()));
-      // Read in the data we need.
-      if(is_float && bit_width == 32) {
-        ReadAndEvalBrick<float>(*rdb, uvf, viters, tree);
-      } else if(is_float && bit_width == 64) {
-        // Not implemented in UVF...
-        T_ERROR("double format data not supported!");
-        continue;
-      } else if( is_signed && bit_width ==  8) {
-        ReadAndEvalBrick< int8_t>(*rdb, uvf, viters, tree);
-      } else if(!is_signed && bit_width ==  8) {
-        ReadAndEvalBrick<uint8_t>(*rdb, uvf, viters, tree);
-      } else if( is_signed && bit_width == 16) {
-        ReadAndEvalBrick< int16_t>(*rdb, uvf, viters, tree);
-      } else if(!is_signed && bit_width == 16) {
-        ReadAndEvalBrick<uint16_t>(*rdb, uvf, viters, tree);
-      // These types aren't yet implemented in UVF/RasterDataBlock.
-      } else if( is_signed && bit_width == 32) {
-        T_ERROR("32bit signed int data not implemented!");
-        //ReadAndEvalBrick< int32_t>(*rdb, uvf, viters, tree);
-      } else if(!is_signed && bit_width == 32) {
-        T_ERROR("32bit unsigned data not implemented!");
-        //ReadAndEvalBrick<uint32_t>(*rdb, uvf, viters, tree);
-      } else if( is_signed && bit_width == 64) {
-        T_ERROR("64bit signed int data not implemented!");
-        //ReadAndEvalBrick< int64_t>(*rdb, uvf, viters, tree);
-      } else if(!is_signed && bit_width == 64) {
-        T_ERROR("64bit unsigned data not implemented!");
-        //ReadAndEvalBrick<uint64_t>(*rdb, uvf, viters, tree);
-      } else {
-        T_ERROR("Could not figure out destination data type!");
-      }
+      bk[i] = viters[i]->first;
+      ++viters[i];
     }
-    MESSAGE("Brick %u (evaluation)...", static_cast<unsigned>(brick));
+    keys.push_back(bk);
+  }
 
-    using namespace std::placeholders;
-    // advance each brick iterator by one.
-#ifndef __APPLE__
-    std::for_each(viters.begin(), viters.end(),
-                  std::bind(std::advance<BrickTable::const_iterator,int>,
-                            _1, 1));
-#else
-    // Clang's libc++ uses iterator_traits<_InputIter>::difference_type to
-    // deduce distance template parameter.
-    std::for_each(viters.begin(), viters.end(),
-                  std::bind(std::advance<BrickTable::const_iterator>,
-                            _1, 1));
-#endif
+  /// @todo FIXME: we should query bit_width, is_float, is_signed to create
+  /// different 'involumes' based on the type we need...
+  const uint32_t threads = m_iEvaluationThreads;
+  if(is_float && bit_width == 32) {
+    EvaluateBricks<float>(*rdb, uvf, keys, prog, threads);
+  } else if(is_float && bit_width == 64) {
+    // Not implemented in UVF...
+    T_ERROR("double format data not supported!");
+  } else if( is_signed && bit_width ==  8) {
+    EvaluateBricks< int8_t>(*rdb, uvf, keys, prog, threads);
+  } else if(!is_signed && bit_width ==  8) {
+    EvaluateBricks<uint8_t>(*rdb, uvf, keys, prog, threads);
+  } else if( is_signed && bit_width == 16) {
+    EvaluateBricks< int16_t>(*rdb, uvf, keys, prog, threads);
+  } else if(!is_signed && bit_width == 16) {
+    EvaluateBricks<uint16_t>(*rdb, uvf, keys, prog, threads);
+  // These types aren't yet implemented in UVF/RasterDataBlock.
+  } else if( is_signed && bit_width == 32) {
+    T_ERROR("32bit signed int data not implemented!");
+    //EvaluateBricks< int32_t>(*rdb, uvf, keys, prog, threads);
+  } else if(!is_signed && bit_width == 32) {
+    T_ERROR("32bit unsigned data not implemented!");
+    //EvaluateBricks<uint32_t>(*rdb, uvf, keys, prog, threads);
+  } else if( is_signed && bit_width == 64) {
+    T_ERROR("64bit signed int data not implemented!");
+    //EvaluateBricks< int64_t>(*rdb, uvf, keys, prog, threads);
+  } else if(!is_signed && bit_width == 64) {
+    T_ERROR("64bit unsigned data not implemented!");
+    //EvaluateBricks<uint64_t>(*rdb, uvf, keys, prog, threads);
+  } else {
+    T_ERROR("Could not figure out destination data type!");
   }
 
   CreateUVFFromRDB(out_fn, rdb);
@@ -39,6 +39,7 @@
 #define IOMANAGER_H
 
 #include "StdTuvokDefines.h"
+#include <algorithm>
 #include <functional>
 #include <list>
 #include <memory>
@@ -265,6 +266,16 @@ public:
     return m_bClampToEdge;
   }
 
+  /// Sets the number of threads EvaluateExpression uses.  With more than
+  /// one, reading, evaluating and writing bricks overlap; 1 processes one
+  /// brick after another.  Defaults to the number of OpenMP threads.
+  void SetEvaluationThreads(uint32_t iThreads) {
+    m_iEvaluationThreads = std::max<uint32_t>(1, iThreads);
+  }
+  uint32_t GetEvaluationThreads() const {
+    return m_iEvaluationThreads;
+  }
+
 private:
   std::vector<tuvok::AbstrGeoConverter*>        m_vpGeoConverters;
   std::vector<std::shared_ptr<AbstrConverter>>  m_vpConverters;
@@ -280,6 +291,7 @@ private:
   uint32_t m_iCompression;
   uint32_t m_iCompressionLevel;
   uint32_t m_iLayout;
+  uint32_t m_iEvaluationThreads;
   std::function<tuvok::Dataset* (const std::string&,
                                  tuvok::AbstrRenderer*)> m_LoadDS;
 
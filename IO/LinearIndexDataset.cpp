@@ -37,6 +37,84 @@ UINTVECTOR4 LinearIndexDataset::IndexTo4D(const BrickKey& key) const {
   assert(rv[2] < layout[2]);
   return rv;
 }
+
+std::vector<UINTVECTOR3>
+LinearIndexDataset::GetBrickLayouts(size_t timestep) const {
+  std::vector<UINTVECTOR3> layouts(this->GetLODLevelCount());
+  for(size_t lod=0; lod < layouts.size(); ++lod) {
+    layouts[lod] = this->GetBrickLayout(lod, timestep);
+  }
+  return layouts;
+}
+
+std::shared_ptr<const MinMaxTable>
+LinearIndexDataset::GetMinMaxTable(size_t timestep) const {
+  SCOPEDLOCK(m_MinMaxGuard);
+  if(m_vMinMaxTables.size() <= timestep) {
+    m_vMinMaxTables.resize(timestep+1);
+  }
+  if(!m_vMinMaxTables[timestep]) {
+    m_vMinMaxTables[timestep] = this->BuildMinMaxTable(timestep);
+  }
+  return m_vMinMaxTables[timestep];
+}
+
+std::shared_ptr<MinMaxTable>
+LinearIndexDataset::BuildMinMaxTable(size_t timestep) const {
+  std::shared_ptr<MinMaxTable> table(
+    new MinMaxTable(this->GetBrickLayouts(timestep))
+  );
+  size_t i = 0;
+  for(size_t lod=0; lod < this->GetLODLevelCount(); ++lod) {
+    const size_t bricks = this->GetBrickLayout(lod, timestep).volume();
+    for(size_t b=0; b < bricks; ++b) {
+      table->Set(i++, this->MaxMinForKey(BrickKey(timestep, lod, b)));
+    }
+  }
+  return table;
+}
+
+size_t LinearIndexDataset::MinMaxTableIndex(const BrickKey& key) const {
+  const size_t timestep = std::get<0>(key);
+  const size_t lod = std::get<1>(key);
+  size_t offset = 0;
+  for(size_t l=0; l < lod; ++l) {
+    offset += this->GetBrickLayout(l, timestep).volume();
+  }
+  return offset + std::get<2>(key);
+}
+
+void LinearIndexDataset::ComputeVisibleBricks(size_t timestep,
+                                              double fMin, double fMax,
+                                              std::vector<uint64_t>& visible)
+                                              const {
+  this->GetMinMaxTable(timestep)->ComputeVisible(fMin, fMax, visible);
+}
+
+void LinearIndexDataset::ComputeVisibleBricks(size_t timestep,
+                                              double fMin, double fMax,
+                                              double fMinGradient,
+                                              double fMaxGradient,
+                                              std::vector<uint64_t>& visible)
+                                              const {
+  this->GetMinMaxTable(timestep)->ComputeVisible(fMin, fMax, fMinGradient,
+                                                 fMaxGradient, visible);
+}
+
+void LinearIndexDataset::Clear() {
+  this->InvalidateMinMaxTables();
+  BrickedDataset::Clear();
+}
+
+void LinearIndexDataset::AddBrick(const BrickKey& bk, const BrickMD& md) {
+  this->InvalidateMinMaxTables();
+  BrickedDataset::AddBrick(bk, md);
+}
+
+void LinearIndexDataset::InvalidateMinMaxTables() {
+  SCOPEDLOCK(m_MinMaxGuard);
+  m_vMinMaxTables.clear();
+}
 }
 /*
    For more information, please see: http://software.sci.utah.edu
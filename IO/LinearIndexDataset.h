@@ -1,7 +1,11 @@
 #ifndef TUVOK_LINEAR_INDEX_DATASET_H
 #define TUVOK_LINEAR_INDEX_DATASET_H
 
+#include <memory>
+#include <vector>
+#include "Basics/Threads.h"
 #include "BrickedDataset.h"
+#include "MinMaxTable.h"
 
 namespace tuvok {
 
@@ -19,11 +23,50 @@ class LinearIndexDataset : public BrickedDataset {
     /// @returns the brick layout for a given LoD.  This is the number of
     /// bricks which exist (given per-dimension)
     virtual UINTVECTOR3 GetBrickLayout(size_t LoD, size_t timestep) const=0;
+    /// @returns the brick layout of every LoD, finest first.
+    std::vector<UINTVECTOR3> GetBrickLayouts(size_t timestep) const;
 
     /// @returns the brick key (1D brick index) derived from the 4D key.
     virtual BrickKey IndexFrom4D(const UINTVECTOR4& four,
                                  size_t timestep) const;
     virtual UINTVECTOR4 IndexTo4D(const BrickKey& key) const;
+
+    /// @returns the min/max values of every brick in the timestep, in the
+    /// 4D index order above.  The default builds the table on first use (see
+    /// BuildMinMaxTable) and keeps it until the bricks change; datasets which
+    /// keep their own table should just hand it out.
+    virtual std::shared_ptr<const MinMaxTable>
+      GetMinMaxTable(size_t timestep) const;
+    /// @returns the position of the given brick in its GetMinMaxTable.
+    size_t MinMaxTableIndex(const BrickKey& key) const;
+
+    /// Classifies all bricks of a timestep at once.  Bit i of 'visible' (see
+    /// MinMaxTable::IsVisible) is set if brick i of the timestep's
+    /// GetMinMaxTable holds values in the given range.
+    ///@{
+    void ComputeVisibleBricks(size_t timestep, double fMin, double fMax,
+                              std::vector<uint64_t>& visible) const;
+    void ComputeVisibleBricks(size_t timestep, double fMin, double fMax,
+                              double fMinGradient, double fMaxGradient,
+                              std::vector<uint64_t>& visible) const;
+    ///@}
+
+    virtual void Clear();
+
+  protected:
+    virtual void AddBrick(const BrickKey&, const BrickMD&);
+
+    /// Gathers a timestep's table for GetMinMaxTable.  The default asks
+    /// MaxMinForKey brick by brick; override it if the values can be had
+    /// in bulk.
+    virtual std::shared_ptr<MinMaxTable>
+      BuildMinMaxTable(size_t timestep) const;
+    /// Forgets the cached tables; call it when the min/max values change.
+    void InvalidateMinMaxTables();
+
+  private:
+    mutable CriticalSection m_MinMaxGuard;
+    mutable std::vector<std::shared_ptr<const MinMaxTable>> m_vMinMaxTables;
 };
 
 }
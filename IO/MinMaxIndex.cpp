@@ -0,0 +1,224 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "MinMaxIndex.h"
+#include "Basics/SysTools.h"
+#include "Controller/Controller.h"
+
+namespace tuvok {
+
+namespace {
+  const char index_magic[8] = { 'T','V','K','M','M','I','D','X' };
+  const uint32_t index_version = 1;
+
+  // The on-disk layout.  Everything is native endian and 8-byte aligned; an
+  // index written on a machine with the other byte order fails the version
+  // check and is simply rebuilt.
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t sourceSize;   ///< identity of the source file...
+    int64_t sourceTime;    ///< ... (size and modification time)
+    uint64_t brickSize[3];
+    uint64_t count;        ///< number of committed records
+    uint64_t checksum;     ///< FNV-1a of the 'count' committed records
+  };
+  struct Record {
+    uint64_t timestep;
+    uint64_t lod;
+    uint64_t brick;
+    double minScalar;
+    double maxScalar;
+  };
+  static_assert(sizeof(Header) == 72, "min/max index header is not packed");
+  static_assert(sizeof(Record) == 40, "min/max index record is not packed");
+
+  const uint64_t fnv_basis = 0xcbf29ce484222325ULL;
+  uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for(size_t i=0; i < len; ++i) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+}
+
+MinMaxIndex::MinMaxIndex(const std::string& source,
+                         const std::array<size_t,3>& bsize) :
+  m_strFilename(Filename(source, bsize)),
+  m_strSource(source),
+  m_iSourceSize(0),
+  m_iSourceTime(0),
+  m_iCount(0),
+  m_iChecksum(fnv_basis),
+  m_bValid(false)
+{
+  m_vBrickSize[0] = bsize[0];
+  m_vBrickSize[1] = bsize[1];
+  m_vBrickSize[2] = bsize[2];
+}
+
+std::string MinMaxIndex::Filename(const std::string& source,
+                                  const std::array<size_t,3>& bsize) {
+  std::ostringstream fname;
+  fname << SysTools::GetPath(source) << "." << SysTools::GetFilename(source)
+        << "." << bsize[0] << "x" << bsize[1] << "x" << bsize[2] << ".mmidx";
+  return fname.str();
+}
+
+// figures out the identity of the source file, as it is right now.
+bool MinMaxIndex::Identify() {
+  LARGE_STAT_BUFFER st;
+  if(!SysTools::GetFileStats(m_strSource, st)) {
+    WARNING("Cannot stat '%s'; not indexing its min/maxes.",
+            m_strSource.c_str());
+    return false;
+  }
+  m_iSourceSize = static_cast<uint64_t>(st.st_size);
+  m_iSourceTime = static_cast<int64_t>(st.st_mtime);
+  return true;
+}
+
+size_t MinMaxIndex::Load(Table& table) {
+  m_iCount = 0;
+  m_iChecksum = fnv_basis;
+  m_bValid = false;
+  if(!this->Identify()) { return 0; }
+
+  LARGE_STAT_BUFFER st;
+  if(!SysTools::GetFileStats(m_strFilename, st)) { return 0; }
+  std::ifstream is(m_strFilename.c_str(), std::ios::binary);
+  if(!is) { return 0; }
+
+  Header hdr;
+  is.read(reinterpret_cast<char*>(&hdr), sizeof(Header));
+  if(!is || memcmp(hdr.magic, index_magic, sizeof(index_magic)) != 0 ||
+     hdr.version != index_version || hdr.recordSize != sizeof(Record)) {
+    WARNING("'%s' is not a min/max index we understand; rebuilding it.",
+            m_strFilename.c_str());
+    return 0;
+  }
+  if(hdr.sourceSize != m_iSourceSize || hdr.sourceTime != m_iSourceTime ||
+     hdr.brickSize[0] != m_vBrickSize[0] ||
+     hdr.brickSize[1] != m_vBrickSize[1] ||
+     hdr.brickSize[2] != m_vBrickSize[2]) {
+    MESSAGE("Min/max index '%s' is out of date; rebuilding it.",
+            m_strFilename.c_str());
+    return 0;
+  }
+  const uint64_t fsize = static_cast<uint64_t>(st.st_size);
+  if((fsize - sizeof(Header)) / sizeof(Record) < hdr.count) {
+    WARNING("Min/max index '%s' is truncated; rebuilding it.",
+            m_strFilename.c_str());
+    return 0;
+  }
+
+  std::vector<Record> recs(static_cast<size_t>(hdr.count));
+  is.read(reinterpret_cast<char*>(recs.data()), recs.size()*sizeof(Record));
+  if(!is || fnv1a(fnv_basis, recs.data(), recs.size()*sizeof(Record)) !=
+            hdr.checksum) {
+    WARNING("Min/max index '%s' is corrupt; rebuilding it.",
+            m_strFilename.c_str());
+    return 0;
+  }
+
+  for(auto r = recs.cbegin(); r != recs.cend(); ++r) {
+    const BrickKey key(static_cast<size_t>(r->timestep),
+                       static_cast<size_t>(r->lod),
+                       static_cast<size_t>(r->brick));
+    table[key] = MinMaxBlock(r->minScalar, r->maxScalar, DBL_MAX, -FLT_MAX);
+  }
+  m_iCount = hdr.count;
+  m_iChecksum = hdr.checksum;
+  m_bValid = true;
+  return recs.size();
+}
+
+bool MinMaxIndex::Append(const Records& recs) {
+  if(recs.empty()) { return true; }
+  if(!m_bValid) {
+    // no usable index yet: start a new one.
+    if(!this->Identify()) { return false; }
+    std::ofstream create(m_strFilename.c_str(),
+                         std::ios::binary | std::ios::trunc);
+    if(!create) {
+      WARNING("Could not create min/max index '%s'.", m_strFilename.c_str());
+      return false;
+    }
+    m_iCount = 0;
+    m_iChecksum = fnv_basis;
+    m_bValid = true;
+  }
+
+  std::vector<Record> out(recs.size());
+  for(size_t i=0; i < recs.size(); ++i) {
+    out[i].timestep = std::get<0>(recs[i].first);
+    out[i].lod = std::get<1>(recs[i].first);
+    out[i].brick = std::get<2>(recs[i].first);
+    out[i].minScalar = recs[i].second.minScalar;
+    out[i].maxScalar = recs[i].second.maxScalar;
+  }
+  const size_t bytes = out.size() * sizeof(Record);
+
+  // records first, header last: if we die in between, the old header still
+  // describes a valid (shorter) index.
+  std::fstream f(m_strFilename.c_str(),
+                 std::ios::binary | std::ios::in | std::ios::out);
+  f.seekp(sizeof(Header) + m_iCount*sizeof(Record));
+  f.write(reinterpret_cast<const char*>(out.data()), bytes);
+  f.flush();
+
+  Header hdr;
+  memcpy(hdr.magic, index_magic, sizeof(index_magic));
+  hdr.version = index_version;
+  hdr.recordSize = sizeof(Record);
+  hdr.sourceSize = m_iSourceSize;
+  hdr.sourceTime = m_iSourceTime;
+  hdr.brickSize[0] = m_vBrickSize[0];
+  hdr.brickSize[1] = m_vBrickSize[1];
+  hdr.brickSize[2] = m_vBrickSize[2];
+  hdr.count = m_iCount + out.size();
+  hdr.checksum = fnv1a(m_iChecksum, out.data(), bytes);
+  f.seekp(0);
+  f.write(reinterpret_cast<const char*>(&hdr), sizeof(Header));
+  f.flush();
+  if(!f) {
+    WARNING("Could not write min/max index '%s'.", m_strFilename.c_str());
+    m_bValid = false;
+    return false;
+  }
+  m_iCount = hdr.count;
+  m_iChecksum = hdr.checksum;
+  return true;
+}
+
+}
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2008 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
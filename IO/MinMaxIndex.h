@@ -0,0 +1,93 @@
+#ifndef TUVOK_MINMAX_INDEX_H
+#define TUVOK_MINMAX_INDEX_H
+
+#include "StdTuvokDefines.h"
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Basics/MinMaxBlock.h"
+#include "Brick.h"
+
+namespace tuvok {
+
+/// Persistent per-brick min/max values for a rebricked data set.
+///
+/// The index lives next to the source file and is keyed on that file's size
+/// and modification time plus the target brick size; if any of those change
+/// the index is considered stale and rebuilt.  The file is a fixed header
+/// followed by fixed-size, 8-byte aligned records, so it can be mapped
+/// directly.  Records are appended in batches and the header's record count
+/// and checksum are rewritten after every batch: an interrupted precompute
+/// keeps everything up to the last completed batch and resumes from there.
+class MinMaxIndex {
+public:
+  typedef std::unordered_map<BrickKey, MinMaxBlock, BKeyHash> Table;
+  typedef std::vector<std::pair<BrickKey, MinMaxBlock>> Records;
+
+  /// @param source the file the (rebricked) data come from
+  /// @param bsize the target brick size, including ghost voxels
+  MinMaxIndex(const std::string& source, const std::array<size_t,3>& bsize);
+
+  /// @returns the name of the index file for this source and brick size.
+  static std::string Filename(const std::string& source,
+                              const std::array<size_t,3>& bsize);
+  const std::string& Filename() const { return m_strFilename; }
+
+  /// Reads every valid record into 'table'.  A missing, stale or corrupt
+  /// index is not an error: nothing is read and the next Append starts a
+  /// fresh file.
+  /// @returns the number of records read.
+  size_t Load(Table& table);
+
+  /// Appends the given records and commits them.
+  /// @returns false if the index could not be written.
+  bool Append(const Records& recs);
+
+  /// number of records committed to the file.
+  uint64_t size() const { return m_iCount; }
+
+private:
+  bool Identify();
+
+private:
+  std::string m_strFilename;
+  std::string m_strSource;
+  std::array<uint64_t,3> m_vBrickSize;
+  uint64_t m_iSourceSize;
+  int64_t m_iSourceTime;
+  uint64_t m_iCount;
+  uint64_t m_iChecksum;
+  bool m_bValid; ///< file exists and matches the source.
+};
+
+}
+#endif
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2008 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,155 @@
+#include "MinMaxTable.h"
+
+// SSE2 is part of every x86-64 target; elsewhere the bricks are classified
+// one at a time.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define TUVOK_MINMAX_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace tuvok {
+
+MinMaxTable::MinMaxTable(const std::vector<UINTVECTOR3>& layout) :
+  m_vLayout(layout)
+{
+  size_t n = 0;
+  for(auto l=layout.cbegin(); l != layout.cend(); ++l) {
+    n += l->volume();
+  }
+  m_vMinScalar.resize(n);
+  m_vMaxScalar.resize(n);
+  m_vMinGradient.resize(n);
+  m_vMaxGradient.resize(n);
+}
+
+void MinMaxTable::Set(size_t i, const MinMaxBlock& mm) {
+  m_vMinScalar[i] = mm.minScalar;
+  m_vMaxScalar[i] = mm.maxScalar;
+  m_vMinGradient[i] = mm.minGradient;
+  m_vMaxGradient[i] = mm.maxGradient;
+}
+
+MinMaxBlock MinMaxTable::Get(size_t i) const {
+  return MinMaxBlock(m_vMinScalar[i], m_vMaxScalar[i],
+                     m_vMinGradient[i], m_vMaxGradient[i]);
+}
+
+namespace {
+  // Classifies 'count' (at most 64) bricks starting at 'b'; brick b+i goes
+  // to bit i of the result.
+  template<bool bGradient>
+  uint64_t ClassifyScalar(size_t b, size_t count,
+                          const double* minS, const double* maxS,
+                          const double* minG, const double* maxG,
+                          double fMin, double fMax, double fMinG, double fMaxG) {
+    uint64_t bits = 0;
+    for(size_t i=0; i < count; ++i, ++b) {
+      bool v = fMax >= minS[b] && fMin <= maxS[b];
+      if(bGradient) {
+        v = v && fMaxG >= minG[b] && fMinG <= maxG[b];
+      }
+      bits |= uint64_t(v) << i;
+    }
+    return bits;
+  }
+
+#ifdef TUVOK_MINMAX_SSE2
+  // Same as above for a full word, two bricks per compare.
+  template<bool bGradient>
+  uint64_t ClassifyWord(size_t b, const double* minS, const double* maxS,
+                        const double* minG, const double* maxG,
+                        double fMin, double fMax, double fMinG, double fMaxG) {
+    const __m128d vMin = _mm_set1_pd(fMin);
+    const __m128d vMax = _mm_set1_pd(fMax);
+    const __m128d vMinG = _mm_set1_pd(fMinG);
+    const __m128d vMaxG = _mm_set1_pd(fMaxG);
+    uint64_t bits = 0;
+    for(size_t i=0; i < 64; i += 2, b += 2) {
+      __m128d v = _mm_and_pd(_mm_cmple_pd(_mm_loadu_pd(minS+b), vMax),
+                             _mm_cmpge_pd(_mm_loadu_pd(maxS+b), vMin));
+      if(bGradient) {
+        v = _mm_and_pd(v, _mm_cmple_pd(_mm_loadu_pd(minG+b), vMaxG));
+        v = _mm_and_pd(v, _mm_cmpge_pd(_mm_loadu_pd(maxG+b), vMinG));
+      }
+      bits |= uint64_t(_mm_movemask_pd(v)) << i;
+    }
+    return bits;
+  }
+#else
+  template<bool bGradient>
+  uint64_t ClassifyWord(size_t b, const double* minS, const double* maxS,
+                        const double* minG, const double* maxG,
+                        double fMin, double fMax, double fMinG, double fMaxG) {
+    return ClassifyScalar<bGradient>(b, 64, minS, maxS, minG, maxG,
+                                     fMin, fMax, fMinG, fMaxG);
+  }
+#endif
+
+  // Words of the result are independent, so they are spread over the
+  // OpenMP threads; small tables are not worth waking the pool for.
+  template<bool bGradient>
+  void Classify(size_t n, const double* minS, const double* maxS,
+                const double* minG, const double* maxG,
+                double fMin, double fMax, double fMinG, double fMaxG,
+                std::vector<uint64_t>& visible) {
+    visible.resize((n + 63) / 64);
+    const int64_t full = int64_t(n / 64);
+#pragma omp parallel for if(full > 1024)
+    for(int64_t w=0; w < full; ++w) {
+      visible[size_t(w)] = ClassifyWord<bGradient>(size_t(w) * 64,
+                                                   minS, maxS, minG, maxG,
+                                                   fMin, fMax, fMinG, fMaxG);
+    }
+    if(n % 64) {
+      visible.back() = ClassifyScalar<bGradient>(size_t(full) * 64, n % 64,
+                                                 minS, maxS, minG, maxG,
+                                                 fMin, fMax, fMinG, fMaxG);
+    }
+  }
+}
+
+void MinMaxTable::ComputeVisible(double fMin, double fMax,
+                                 std::vector<uint64_t>& visible) const {
+  if(m_vMinScalar.empty()) { visible.clear(); return; }
+  Classify<false>(size(), &m_vMinScalar[0], &m_vMaxScalar[0], NULL, NULL,
+                  fMin, fMax, 0.0, 0.0, visible);
+}
+
+void MinMaxTable::ComputeVisible(double fMin, double fMax,
+                                 double fMinGradient, double fMaxGradient,
+                                 std::vector<uint64_t>& visible) const {
+  if(m_vMinScalar.empty()) { visible.clear(); return; }
+  Classify<true>(size(), &m_vMinScalar[0], &m_vMaxScalar[0],
+                 &m_vMinGradient[0], &m_vMaxGradient[0],
+                 fMin, fMax, fMinGradient, fMaxGradient, visible);
+}
+
+}
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2008 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -0,0 +1,80 @@
+#ifndef TUVOK_MINMAX_TABLE_H
+#define TUVOK_MINMAX_TABLE_H
+
+#include "StdTuvokDefines.h"
+#include <vector>
+#include "Basics/MinMaxBlock.h"
+#include "Basics/Vectors.h"
+
+namespace tuvok {
+
+/// Min/max scalar and gradient values for every brick of one timestep.  The
+/// four values are kept in separate, contiguous arrays, so that all bricks
+/// can be classified in one sweep instead of one lookup per brick.
+/// Bricks are ordered like a LinearIndexDataset's 4D index: LOD (finest
+/// first), then z, y, x.
+class MinMaxTable {
+public:
+  /// @param layout the number of bricks per dimension of every LOD, finest
+  /// first; the table holds one entry per brick.
+  explicit MinMaxTable(const std::vector<UINTVECTOR3>& layout);
+
+  size_t size() const { return m_vMinScalar.size(); }
+  /// @returns the brick layout the table was created for.
+  const std::vector<UINTVECTOR3>& GetLayout() const { return m_vLayout; }
+
+  void Set(size_t i, const MinMaxBlock& mm);
+  MinMaxBlock Get(size_t i) const;
+
+  /// Computes which bricks hold values in [fMin, fMax].  Brick i is bit
+  /// i%64 of visible[i/64]; 'visible' is resized to fit.  Iso-surfaces use
+  /// fMin == fMax == isovalue.
+  void ComputeVisible(double fMin, double fMax,
+                      std::vector<uint64_t>& visible) const;
+  /// As above, but the gradient range must overlap as well.
+  void ComputeVisible(double fMin, double fMax,
+                      double fMinGradient, double fMaxGradient,
+                      std::vector<uint64_t>& visible) const;
+
+  /// @returns true if brick i is set in a result of ComputeVisible.
+  static bool IsVisible(const std::vector<uint64_t>& visible, size_t i) {
+    return ((visible[i / 64] >> (i % 64)) & 1) != 0;
+  }
+
+private:
+  std::vector<UINTVECTOR3> m_vLayout;
+  std::vector<double> m_vMinScalar;
+  std::vector<double> m_vMaxScalar;
+  std::vector<double> m_vMinGradient;
+  std::vector<double> m_vMaxGradient;
+};
+
+}
+#endif
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2008 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
@@ -421,6 +421,12 @@ bool NRRDConverter::ConvertToRAW(const std::string& strSourceFilename,
       if (kvpEncoding->strValueUpper == "GZ" || kvpEncoding->strValueUpper == "GZIP")  {
         MESSAGE("NRRD data is GZIP compressed RAW format.");
 
+        if (m_bAcceptCompressed) {
+          strIntermediateFile = strRAWFile;
+          bDeleteIntermediateFile = false;
+          m_eIntermediateEncoding = tuvok::CompressedRAWFile::ENC_GZIP;
+          return true;
+        }
         string strUncompressedFile = strTempDir+SysTools::GetFilename(strSourceFilename)+".uncompressed";
         bool bResult = ExtractGZIPDataset(strRAWFile, strUncompressedFile, iHeaderSkip);
         strIntermediateFile = strUncompressedFile;
@@ -431,6 +437,12 @@ bool NRRDConverter::ConvertToRAW(const std::string& strSourceFilename,
       if (kvpEncoding->strValueUpper == "BZ" || kvpEncoding->strValueUpper == "BZIP2")  {
         MESSAGE("NRRD data is BZIP2 compressed RAW format.");
 
+        if (m_bAcceptCompressed) {
+          strIntermediateFile = strRAWFile;
+          bDeleteIntermediateFile = false;
+          m_eIntermediateEncoding = tuvok::CompressedRAWFile::ENC_BZIP2;
+          return true;
+        }
         string strUncompressedFile = strTempDir+SysTools::GetFilename(strSourceFilename)+".uncompressed";
         bool bResult = ExtractBZIP2Dataset(strRAWFile, strUncompressedFile, iHeaderSkip);
         strIntermediateFile = strUncompressedFile;
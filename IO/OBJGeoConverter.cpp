@@ -392,3 +392,75 @@ bool OBJGeoConverter::ConvertToNative(const Mesh& m,
 
   return true;
 }
+
+namespace {
+  /// OBJ allows vertices and faces to be interleaved, so every chunk is
+  /// written as soon as it arrives.  The statistics, which the regular
+  /// export puts into the header, go to the end of the file.
+  class OBJMeshWriter : public MeshWriter {
+  public:
+    OBJMeshWriter(const std::string& strTargetFilename,
+                  const std::string& strName) :
+      m_outStream(strTargetFilename.c_str()),
+      m_iVertices(0),
+      m_iTriangles(0)
+    {
+      if (m_outStream.fail()) return;
+      for (size_t i = 0;i<strName.size()+4;i++) m_outStream << "#";
+      m_outStream << std::endl;
+      m_outStream << "# " << strName << " #" << std::endl;
+      for (size_t i = 0;i<strName.size()+4;i++) m_outStream << "#";
+      m_outStream << std::endl;
+    }
+
+    bool IsOpen() const { return !m_outStream.fail(); }
+
+    virtual bool AddChunk(const VertVec& vertices, const VertVec& normals,
+                          const IndexVec& triangles) {
+      for (size_t i = 0;i<vertices.size();i++) {
+        m_outStream << "v "
+                    << vertices[i].x << " "
+                    << vertices[i].y << " "
+                    << vertices[i].z << "\n";
+      }
+      for (size_t i = 0;i<normals.size();i++) {
+        m_outStream << "vn "
+                    << normals[i].x << " "
+                    << normals[i].y << " "
+                    << normals[i].z << "\n";
+      }
+      // vertices and normals are paired up, so they share the index
+      for (size_t i = 0;i+2<triangles.size();i+=3) {
+        m_outStream << "f "
+                    << triangles[i+0]+1 << "//" << triangles[i+0]+1 << " "
+                    << triangles[i+1]+1 << "//" << triangles[i+1]+1 << " "
+                    << triangles[i+2]+1 << "//" << triangles[i+2]+1 << "\n";
+      }
+      m_iVertices += vertices.size();
+      m_iTriangles += triangles.size()/3;
+      return !m_outStream.fail();
+    }
+
+    virtual bool Close() {
+      m_outStream << "# Vertices: " << m_iVertices << std::endl;
+      m_outStream << "# Primitives: " << m_iTriangles << std::endl;
+      m_outStream.close();
+      return !m_outStream.fail();
+    }
+
+  private:
+    std::ofstream m_outStream;
+    uint64_t      m_iVertices;
+    uint64_t      m_iTriangles;
+  };
+}
+
+std::shared_ptr<MeshWriter>
+OBJGeoConverter::CreateMeshWriter(const std::string& strTargetFilename,
+                                  const std::string& strName,
+                                  const FLOATVECTOR4&) {
+  std::shared_ptr<OBJMeshWriter> w(new OBJMeshWriter(strTargetFilename,
+                                                     strName));
+  if (!w->IsOpen()) return std::shared_ptr<MeshWriter>();
+  return w;
+}
@@ -49,6 +49,7 @@
 #include "IO/gzio.h"
 #include "UVF/Histogram1DDataBlock.h"
 #include "UVF/Histogram2DDataBlock.h"
+#include "UVF/HistogramEngine.h"
 #include "UVF/MaxMinDataBlock.h"
 #include "UVF/RasterDataBlock.h"
 #include "UVF/KeyValuePairDataBlock.h"
@@ -80,9 +81,26 @@ namespace {
   }
 }
 
+/// @returns the (unopened) intermediate file; compressed data is
+/// decompressed as it is read.
+/// @param iSize expected size of the uncompressed data
+static std::shared_ptr<LargeRAWFile> source_file(
+  const std::string& strFilename, uint64_t iHeaderSkip,
+  CompressedRAWFile::Encoding eEncoding, uint64_t iSize)
+{
+  if(eEncoding == CompressedRAWFile::ENC_RAW) {
+    return std::shared_ptr<LargeRAWFile>(
+      new LargeRAWFile(strFilename, iHeaderSkip)
+    );
+  }
+  return std::shared_ptr<LargeRAWFile>(
+    new CompressedRAWFile(strFilename, eEncoding, iHeaderSkip, iSize)
+  );
+}
+
 static std::string convert_endianness(const std::string& strFilename,
+                                      LargeRAWFile& WrongEndianData,
                                       const std::string& strTempDir,
-                                      uint64_t iHeaderSkip,
                                       UINT64VECTOR3 dims,
                                       unsigned iComponentSize,
                                       size_t in_core_size)
@@ -94,7 +112,6 @@ static std::string convert_endianness(const std::string& strFilename,
     return "";
   }
 
-  LargeRAWFile WrongEndianData(strFilename, iHeaderSkip);
   WrongEndianData.Open(false);
 
   if(!WrongEndianData.IsOpen()) {
@@ -162,6 +179,44 @@ static std::string convert_endianness(const std::string& strFilename,
   return tmp_file;
 }
 
+/// Decompresses 'source' front to back into the temp file 'strTarget'.
+/// @returns the extracted file, opened for reading, or NULL on failure
+static std::shared_ptr<LargeRAWFile> extract(CompressedRAWFile& source,
+                                             const std::string& strTarget,
+                                             uint64_t iSize)
+{
+  std::shared_ptr<LargeRAWFile> target(new TempFile(strTarget));
+  if(!target->Create()) {
+    T_ERROR("Unable to create file '%s'", strTarget.c_str());
+    return std::shared_ptr<LargeRAWFile>();
+  }
+  MESSAGE("Extracting %" PRIu64 " bytes of compressed data to '%s'",
+          iSize, strTarget.c_str());
+
+  std::vector<uint8_t> buffer(static_cast<size_t>(
+    std::min<uint64_t>(iSize, AbstrConverter::GetIncoreSize())
+  ));
+  source.SeekStart();
+  uint64_t iDone = 0;
+  while(iDone < iSize) {
+    const size_t n = source.ReadRAW(buffer.data(), std::min<uint64_t>(
+                                      buffer.size(), iSize - iDone));
+    if(n == 0 || target->WriteRAW(buffer.data(), n) != n) {
+      T_ERROR("Extracting '%s' failed after %" PRIu64 " of %" PRIu64
+              " bytes.", source.GetFilename().c_str(), iDone, iSize);
+      return std::shared_ptr<LargeRAWFile>();
+    }
+    iDone += n;
+  }
+  if(source.Failed()) {
+    T_ERROR("'%s' is corrupt.", source.GetFilename().c_str());
+    return std::shared_ptr<LargeRAWFile>();
+  }
+  target->Close();
+  target->Open(false);
+  return target;
+}
+
 static std::shared_ptr<KeyValuePairDataBlock> metadata(
   const string& strDesc, const string& strSource,
   bool bLittleEndian, bool bSigned, bool bIsFloat,
@@ -440,7 +495,8 @@ bool RAWConverter::ConvertRAWDataset(const string& strFilename,
                                      uint32_t iBrickCompressionLevel,
                                      uint32_t iBrickLayout,
                                      KVPairs* pKVPairs,
-                                     const bool bQuantizeTo8Bit)
+                                     const bool bQuantizeTo8Bit,
+                                     CompressedRAWFile::Encoding eEncoding)
 {
   if (!SysTools::FileExists(strFilename)) {
     T_ERROR("Data file %s not found; maybe there is an invalid reference in "
@@ -498,14 +554,20 @@ bool RAWConverter::ConvertRAWDataset(const string& strFilename,
 
   string tmpQuantizedFile = strTempDir+SysTools::GetFilename(strFilename)+".quantized";
 
-  std::shared_ptr<LargeRAWFile> sourceData;
+  std::shared_ptr<LargeRAWFile> sourceData = source_file(
+    strFilename, iHeaderSkip, eEncoding,
+    vVolumeSize.volume() * iComponentCount * timesteps * iComponentSize/8
+  );
+  if(eEncoding != CompressedRAWFile::ENC_RAW) {
+    MESSAGE("compressed source data; decompressing while reading.");
+  }
 
   if (bConvertEndianness) {
     // the new data source is the endian-converted file.
     size_t core_size = static_cast<size_t>(iTargetBrickSize*iTargetBrickSize*
                                            iTargetBrickSize * iComponentSize/8);
     string tmpEndianConvertedFile =
-      convert_endianness(strFilename, strTempDir, iHeaderSkip, vVolumeSize,
+      convert_endianness(strFilename, *sourceData, strTempDir, vVolumeSize,
                          iComponentSize, core_size);
     iHeaderSkip = 0;  // the new file is straight raw without any header
     MESSAGE("temporary source data; no header skip.");
@@ -514,9 +576,6 @@ bool RAWConverter::ConvertRAWDataset(const string& strFilename,
     );
   } else {
     MESSAGE("non-temp source data, with %llu-byte header skip", iHeaderSkip);
-    sourceData = std::shared_ptr<LargeRAWFile>(
-      new LargeRAWFile(strFilename, iHeaderSkip)
-    );
   }
   sourceData->Open(false);
   if(!sourceData->IsOpen()) {
@@ -533,6 +592,36 @@ bool RAWConverter::ConvertRAWDataset(const string& strFilename,
                         iComponentSize, iComponentCount, timesteps,
                         vVolumeSize.volume(), bQuantizeTo8Bit, &Histogram1D);
 
+  // The octree converter gathers the bricks slab by slab, seeking back to
+  // the slab's first slice for every brick, which would re-inflate
+  // compressed data from its last restart point each time.  Unless quantize
+  // already wrote a plain copy, keep a slab of the decompressed data in
+  // memory, so that it is decompressed front to back once.
+  size_t iCacheSize =
+    size_t(Controller::ConstInstance().SysInfo().GetMaxUsableCPUMem());
+  if(CompressedRAWFile* compressed =
+       dynamic_cast<CompressedRAWFile*>(sourceData.get())) {
+    const uint64_t iSlab =
+      std::min<uint64_t>(iTargetBrickSize, vVolumeSize.z) *
+      vVolumeSize.x * vVolumeSize.y * iComponentCount * iComponentSize/8;
+    if(iSlab <= iCacheSize/2) {
+      MESSAGE("Keeping %" PRIu64 " bytes of decompressed data in memory.",
+              iSlab);
+      compressed->SetWindow(iSlab);
+      iCacheSize -= size_t(iSlab);
+    } else {
+      WARNING("A slab of bricks (%" PRIu64 " bytes) does not fit into "
+              "memory; decompressing the data to a temp file instead.",
+              iSlab);
+      sourceData = extract(*compressed,
+                           strTempDir+SysTools::GetFilename(strFilename)+
+                             ".extracted",
+                           vVolumeSize.volume() * iComponentCount *
+                             timesteps * iComponentSize/8);
+      if(!sourceData) { return false; }
+    }
+  }
+
   // if it was signed, we un-signed it. If it was unsigned.. it was unsigned.
   bSigned = false;
   bIsFloat = false; // we always produce non-FP data.
@@ -620,8 +709,7 @@ bool RAWConverter::ConvertRAWDataset(const string& strFilename,
        ct, iComponentCount, vVolumeSize, DOUBLEVECTOR3(vVolumeAspect),
        UINT64VECTOR3(iTargetBrickSize,iTargetBrickSize,iTargetBrickSize),
        uint32_t(iTargetBrickOverlap), bUseMedian, bClampToEdge,
-       size_t(Controller::ConstInstance().SysInfo().GetMaxUsableCPUMem()),
-       MaxMinData, &Controller::Debug::Out(),
+       iCacheSize, MaxMinData, &Controller::Debug::Out(),
        COMPRESSION_TYPE(iBrickCompression), iBrickCompressionLevel,
        LAYOUT_TYPE(iBrickLayout)) != true) {
       T_ERROR("Brick generation failed, aborting.");
@@ -640,26 +728,37 @@ bool RAWConverter::ConvertRAWDataset(const string& strFilename,
     // do not compute histograms when we are dealing with color data
     /// \todo change this if we want to support non color multi component data
     if (iComponentCount != 4 && iComponentCount != 3) {
+      std::shared_ptr<Histogram2DDataBlock> Histogram2D =
+        blocks[ts].hist2d;
+      const double fMaxValue = MaxMinData->GetGlobalValue().maxScalar;
       // if no re-sampling was performed above, we need to compute the
-      // 1d histogram here
-      if (Histogram1D.GetHistogram().empty()) {
-        MESSAGE("Computing 1D Histogram...");
-        if (!Histogram1D.Compute(dataVolume.get(),0)) {
-          T_ERROR("Computation of 1D Histogram failed!");
+      // 1d histogram here.  For unsigned data we know its size up front
+      // (the largest value + 1), so both histograms come from one sweep.
+      if (Histogram1D.GetHistogram().empty() && !bSigned) {
+        MESSAGE("Computing 1D and 2D Histogram...");
+        if (!HistogramEngine(dataVolume.get(), 0).Compute(&Histogram1D,
+               Histogram2D.get(), size_t(fMaxValue)+1, fMaxValue)) {
+          T_ERROR("Computation of histograms failed!");
           uvfFile.Close();
           return false;
         }
-      }
+      } else {
+        if (Histogram1D.GetHistogram().empty()) {
+          MESSAGE("Computing 1D Histogram...");
+          if (!Histogram1D.Compute(dataVolume.get(),0)) {
+            T_ERROR("Computation of 1D Histogram failed!");
+            uvfFile.Close();
+            return false;
+          }
+        }
 
-      MESSAGE("Computing 2D Histogram...");
-      std::shared_ptr<Histogram2DDataBlock> Histogram2D =
-        blocks[ts].hist2d;
-      if (!Histogram2D->Compute(dataVolume.get(), 0,
-        Histogram1D.GetHistogram().size(),
-        MaxMinData->GetGlobalValue().maxScalar)) {
-          T_ERROR("Computation of 2D Histogram failed!");
-          uvfFile.Close();
-          return false;
+        MESSAGE("Computing 2D Histogram...");
+        if (!Histogram2D->Compute(dataVolume.get(), 0,
+          Histogram1D.GetHistogram().size(), fMaxValue)) {
+            T_ERROR("Computation of 2D Histogram failed!");
+            uvfFile.Close();
+            return false;
+        }
       }
       MESSAGE("Storing histogram data...");
       uvfFile.AddDataBlock(
@@ -1184,13 +1283,17 @@ bool RAWConverter::ConvertToUVF(const std::list<std::string>& files,
   std::list<string> strIntermediateFile;
   std::list<bool>   bDeleteIntermediateFile;
   std::list<uint64_t> header_skip;
+  std::list<CompressedRAWFile::Encoding> encoding;
 
   bool success = true;
+  // we stream compressed data, rather than extracting it to a temp file
+  m_bAcceptCompressed = true;
   for(std::list<std::string>::const_iterator fn = files.begin();
       fn != files.end(); ++fn) {
     std::string intermediate;
     bool bDelete;
     uint64_t iHeaderSkip;
+    m_eIntermediateEncoding = CompressedRAWFile::ENC_RAW;
     /// @todo assuming iComponentSize, etc. are the same for all files; should
     /// really be a list for each of them, like for intermediate, iHeaderskip,
     /// etc.
@@ -1209,7 +1312,9 @@ bool RAWConverter::ConvertToUVF(const std::list<std::string>& files,
     strIntermediateFile.push_front(intermediate);
     bDeleteIntermediateFile.push_front(bDelete);
     header_skip.push_front(iHeaderSkip);
+    encoding.push_front(m_eIntermediateEncoding);
   }
+  m_bAcceptCompressed = false;
   // then rewrite convertrawdataset to take the new list
 
   if (!success) {
@@ -1230,11 +1335,15 @@ bool RAWConverter::ConvertToUVF(const std::list<std::string>& files,
 
     std::list<bool>::const_iterator del = bDeleteIntermediateFile.begin();
     std::list<uint64_t>::const_iterator hdr = header_skip.begin();
+    std::list<CompressedRAWFile::Encoding>::const_iterator enc =
+      encoding.begin();
     const uint64_t payload_sz = vVolumeSize.volume() * iComponentSize/8 *
                               iComponentCount;
     for(std::list<std::string>::const_iterator fn = strIntermediateFile.begin();
-        fn != strIntermediateFile.end(); ++fn, ++del, ++hdr) {
-      LargeRAWFile input(*fn, *hdr);
+        fn != strIntermediateFile.end(); ++fn, ++del, ++hdr, ++enc) {
+      std::shared_ptr<LargeRAWFile> pInput = source_file(*fn, *hdr, *enc,
+                                                         payload_sz);
+      LargeRAWFile& input = *pInput;
       input.Open(false);
 
       std::vector<uint8_t> data(GetIncoreSize());
@@ -1258,6 +1367,7 @@ bool RAWConverter::ConvertToUVF(const std::list<std::string>& files,
     }
     *bDeleteIntermediateFile.begin() = true;
     *header_skip.begin() = 0;
+    *encoding.begin() = CompressedRAWFile::ENC_RAW;
     {
       ostringstream strlist;
       strlist << "Merged from ";
@@ -1286,7 +1396,8 @@ bool RAWConverter::ConvertToUVF(const std::list<std::string>& files,
                                        iBrickCompressionLevel,
                                        iBrickLayout,
                                        0,
-                                       bQuantizeTo8Bit);
+                                       bQuantizeTo8Bit,
+                                       *encoding.begin());
 
   if (*bDeleteIntermediateFile.begin()) {
     Remove(merged_fn, Controller::Debug::Out());
@@ -44,6 +44,7 @@
 #include "../StdTuvokDefines.h"
 #include <list>
 #include "AbstrConverter.h"
+#include "CompressedRAWFile.h"
 #include "Controller/Controller.h"
 #include "IOManager.h"  // for the size defines
 
@@ -74,6 +75,9 @@ public:
 
 class RAWConverter : public AbstrConverter {
 public:
+  RAWConverter() :
+    m_bAcceptCompressed(false),
+    m_eIntermediateEncoding(tuvok::CompressedRAWFile::ENC_RAW) {}
   virtual ~RAWConverter() {}
 
   static bool ConvertRAWDataset(const std::string& strFilename,
@@ -95,7 +99,9 @@ public:
                                 uint32_t iBrickCompressionLevel,
                                 uint32_t iBrickLayout,
                                 KVPairs* pKVPairs = NULL,
-                                const bool bQuantizeTo8Bit=false);
+                                const bool bQuantizeTo8Bit=false,
+                                tuvok::CompressedRAWFile::Encoding eEncoding =
+                                  tuvok::CompressedRAWFile::ENC_RAW);
 
   static bool ExtractGZIPDataset(const std::string& strFilename,
                                  const std::string& strUncompressedFile,
@@ -170,6 +176,14 @@ public:
   /// deleted.
   /// @return true if the remove succeeded.
   static bool Remove(const std::string &, AbstrDebugOut &);
+
+protected:
+  /// True while ConvertToUVF calls ConvertToRAW.  It reads the intermediate
+  /// file through a CompressedRAWFile, so ConvertToRAW may hand out gzip or
+  /// bzip2 payloads as they are instead of extracting them first; it then
+  /// says so in m_eIntermediateEncoding.  Other callers want a RAW file.
+  bool m_bAcceptCompressed;
+  tuvok::CompressedRAWFile::Encoding m_eIntermediateEncoding;
 };
 
 #endif // RAWCONVERTER_H
@@ -0,0 +1,187 @@
+#include "SliceConversion.h"
+#include "Basics/EndianConvert.h"
+
+// SSE2 is part of every x86-64 target; elsewhere the kernels go one
+// element at a time.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define TUVOK_SLICE_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace tuvok {
+
+namespace {
+  template<typename T>
+  void SwapScalar(T* p, size_t count) {
+    for(size_t i=0; i < count; ++i) { p[i] = EndianConvert::Swap<T>(p[i]); }
+  }
+
+  // T(v*s + b) through int32_t, so that 8 and 16 bit results wrap exactly
+  // like the SIMD path
+  template<typename T>
+  void ScaleBiasScalar(T* p, size_t count, float fScale, float fBias) {
+    for(size_t i=0; i < count; ++i) {
+      p[i] = static_cast<T>(static_cast<int32_t>(p[i] * fScale + fBias));
+    }
+  }
+
+#ifdef TUVOK_SLICE_SSE2
+  inline __m128i ScaleBias4(__m128i v, __m128 s, __m128 b) {
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(v), s), b));
+  }
+  // packs the low 16 bits of each 32 bit lane
+  inline __m128i Pack16(__m128i lo, __m128i hi) {
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+  }
+  // packs the low 8 bits of each 16 bit lane
+  inline __m128i Pack8(__m128i lo, __m128i hi) {
+    lo = _mm_srai_epi16(_mm_slli_epi16(lo, 8), 8);
+    hi = _mm_srai_epi16(_mm_slli_epi16(hi, 8), 8);
+    return _mm_packs_epi16(lo, hi);
+  }
+  // eight 16 bit lanes, widened with sign or zero extension
+  inline __m128i ScaleBias8x16(__m128i v, bool bSigned, __m128 s, __m128 b) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = bSigned ? _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)
+                               : _mm_unpacklo_epi16(v, zero);
+    const __m128i hi = bSigned ? _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)
+                               : _mm_unpackhi_epi16(v, zero);
+    return Pack16(ScaleBias4(lo, s, b), ScaleBias4(hi, s, b));
+  }
+#endif
+
+  template<typename T>
+  void ScaleBias16(T* p, size_t count, bool bSigned, float fScale,
+                   float fBias) {
+    size_t i = 0;
+#ifdef TUVOK_SLICE_SSE2
+    const __m128 s = _mm_set1_ps(fScale), b = _mm_set1_ps(fBias);
+    for(; i+8 <= count; i += 8) {
+      __m128i* v = reinterpret_cast<__m128i*>(p+i);
+      _mm_storeu_si128(v, ScaleBias8x16(_mm_loadu_si128(v), bSigned, s, b));
+    }
+#else
+    (void)bSigned;
+#endif
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  template<typename T>
+  void ScaleBias8(T* p, size_t count, bool bSigned, float fScale,
+                  float fBias) {
+    size_t i = 0;
+#ifdef TUVOK_SLICE_SSE2
+    const __m128 s = _mm_set1_ps(fScale), b = _mm_set1_ps(fBias);
+    const __m128i zero = _mm_setzero_si128();
+    for(; i+16 <= count; i += 16) {
+      __m128i* v = reinterpret_cast<__m128i*>(p+i);
+      const __m128i x = _mm_loadu_si128(v);
+      const __m128i lo = bSigned ? _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8)
+                                 : _mm_unpacklo_epi8(x, zero);
+      const __m128i hi = bSigned ? _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8)
+                                 : _mm_unpackhi_epi8(x, zero);
+      // widened to 16 bit, the lanes are signed either way
+      _mm_storeu_si128(v, Pack8(ScaleBias8x16(lo, true, s, b),
+                                ScaleBias8x16(hi, true, s, b)));
+    }
+#else
+    (void)bSigned;
+#endif
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+
+  void ScaleBias32(int32_t* p, size_t count, float fScale, float fBias) {
+    size_t i = 0;
+#ifdef TUVOK_SLICE_SSE2
+    const __m128 s = _mm_set1_ps(fScale), b = _mm_set1_ps(fBias);
+    for(; i+4 <= count; i += 4) {
+      __m128i* v = reinterpret_cast<__m128i*>(p+i);
+      _mm_storeu_si128(v, ScaleBias4(_mm_loadu_si128(v), s, b));
+    }
+#endif
+    ScaleBiasScalar(p+i, count-i, fScale, fBias);
+  }
+}
+
+void SwapEndianness(void* pData, size_t count, unsigned iBits) {
+  size_t i = 0;
+  switch(iBits) {
+    case 16: {
+      uint16_t* p = static_cast<uint16_t*>(pData);
+#ifdef TUVOK_SLICE_SSE2
+      for(; i+8 <= count; i += 8) {
+        __m128i* v = reinterpret_cast<__m128i*>(p+i);
+        const __m128i x = _mm_loadu_si128(v);
+        _mm_storeu_si128(v, _mm_or_si128(_mm_slli_epi16(x, 8),
+                                         _mm_srli_epi16(x, 8)));
+      }
+#endif
+      SwapScalar(p+i, count-i);
+    } break;
+    case 32: {
+      uint32_t* p = static_cast<uint32_t*>(pData);
+#ifdef TUVOK_SLICE_SSE2
+      for(; i+4 <= count; i += 4) {
+        __m128i* v = reinterpret_cast<__m128i*>(p+i);
+        __m128i x = _mm_loadu_si128(v);
+        // swap the bytes of each half, then the halves
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2,3,0,1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2,3,0,1));
+        _mm_storeu_si128(v, x);
+      }
+#endif
+      SwapScalar(p+i, count-i);
+    } break;
+    case 64: SwapScalar(static_cast<uint64_t*>(pData), count); break;
+    default: break;
+  }
+}
+
+void ScaleBias(void* pData, size_t count, unsigned iBits, bool bSigned,
+               float fScale, float fBias) {
+  switch(iBits) {
+    case 8:
+      if(bSigned) {
+        ScaleBias8(static_cast<int8_t*>(pData), count, true, fScale, fBias);
+      } else {
+        ScaleBias8(static_cast<uint8_t*>(pData), count, false, fScale, fBias);
+      }
+      break;
+    case 16:
+      if(bSigned) {
+        ScaleBias16(static_cast<int16_t*>(pData), count, true, fScale, fBias);
+      } else {
+        ScaleBias16(static_cast<uint16_t*>(pData), count, false, fScale,
+                    fBias);
+      }
+      break;
+    case 32:
+      if(bSigned) {
+        ScaleBias32(static_cast<int32_t*>(pData), count, fScale, fBias);
+      } else {
+        // there is no SSE2 conversion for unsigned 32 bit values
+        uint32_t* p = static_cast<uint32_t*>(pData);
+        for(size_t i=0; i < count; ++i) {
+          p[i] = static_cast<uint32_t>(p[i] * fScale + fBias);
+        }
+      }
+      break;
+    default: break;
+  }
+}
+
+void ExpandRGBToRGBA(unsigned char* pData, size_t count) {
+  // back to front, so nothing is overwritten before it was read
+  for(size_t i=count; i-- > 0;) {
+    pData[i*4+3] = 255;
+    pData[i*4+2] = pData[i*3+2];
+    pData[i*4+1] = pData[i*3+1];
+    pData[i*4+0] = pData[i*3+0];
+  }
+}
+
+}
@@ -0,0 +1,29 @@
+#ifndef TUVOK_SLICE_CONVERSION_H
+#define TUVOK_SLICE_CONVERSION_H
+
+#include "StdTuvokDefines.h"
+#include <cstddef>
+
+namespace tuvok {
+
+/// Kernels which bring the pixel data of an image stack's slice into the
+/// form the RAW converter expects.  All of them work in place.
+///@{
+
+/// Reverses the byte order of 'count' elements of 'iBits' bits; 8 bit data
+/// is left alone.
+void SwapEndianness(void* pData, size_t count, unsigned iBits);
+
+/// Replaces each of the 'count' integer elements v by T(v*fScale + fBias),
+/// rounded toward zero.  8 and 16 bit results wrap around like a cast
+/// through int32_t.
+void ScaleBias(void* pData, size_t count, unsigned iBits, bool bSigned,
+               float fScale, float fBias);
+
+/// Expands 'count' RGB byte triplets at the start of 'pData' to RGBA, with
+/// an opaque alpha.  'pData' must hold 4*count bytes.
+void ExpandRGBToRGBA(unsigned char* pData, size_t count);
+
+///@}
+}
+#endif
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cmath>
+#include "SwatchRasterizer.h"
+#include "TransferFunction2D.h"
+
+// SSE2 is part of every x86-64 target; elsewhere pixels are blended one
+// channel at a time.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define TUVOK_SWATCH_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace tuvok {
+
+namespace {
+  const size_t iGradientSize = 1024;
+
+  // colors go through 8 bits, as they did when they were QColors
+  float Quantize(float f) {
+    return float(int(std::max(0.0f, std::min(f, 1.0f))*255)) / 255.0f;
+  }
+  void Premultiply(const FLOATVECTOR4& c, float* p) {
+    const float a = Quantize(c[3]);
+    p[0] = Quantize(c[0]) * a;
+    p[1] = Quantize(c[1]) * a;
+    p[2] = Quantize(c[2]) * a;
+    p[3] = a;
+  }
+
+  bool StopLess(const GradientStop& a, const GradientStop& b) {
+    return a.first < b.first;
+  }
+
+  // source-over of the premultiplied color 's' onto the pixel 'd'
+  void Blend(const float* s, float* d) {
+#ifdef TUVOK_SWATCH_SSE2
+    const __m128 inv = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_set1_ps(s[3]));
+    _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(s),
+                                _mm_mul_ps(_mm_loadu_ps(d), inv)));
+#else
+    const float inv = 1.0f - s[3];
+    d[0] = s[0] + d[0]*inv;
+    d[1] = s[1] + d[1]*inv;
+    d[2] = s[2] + d[2]*inv;
+    d[3] = s[3] + d[3]*inv;
+#endif
+  }
+
+  uint32_t Clamp(double v, uint32_t iMax) {
+    if(!(v > 0)) { return 0; }
+    return v < iMax ? uint32_t(v) : iMax;
+  }
+}
+
+void SwatchRasterizer::Resize(const VECTOR2<size_t>& iSize,
+                              const VECTOR2<size_t>& vGradientSpace) {
+  m_iSize = iSize;
+  m_vGradientScale = FLOATVECTOR2(
+    iSize.x ? float(vGradientSpace.x) / float(iSize.x) : 1.0f,
+    iSize.y ? float(vGradientSpace.y) / float(iSize.y) : 1.0f
+  );
+  m_vPixels.assign(4*iSize.area(), 0.0f);
+}
+
+void SwatchRasterizer::SetBackground(const std::vector<FLOATVECTOR4>& vColors) {
+  m_vBackground.resize(4*vColors.size());
+  for(size_t i=0; i < vColors.size(); ++i) {
+    Premultiply(vColors[i], &m_vBackground[4*i]);
+  }
+}
+
+UINTVECTOR4 SwatchRasterizer::Bounds(const TFPolygon& swatch) const {
+  if(swatch.pPoints.size() < 3) { return UINTVECTOR4(0,0,0,0); }
+  FLOATVECTOR2 vMin = swatch.pPoints[0], vMax = swatch.pPoints[0];
+  for(size_t i=1; i < swatch.pPoints.size(); ++i) {
+    vMin.StoreMin(swatch.pPoints[i]);
+    vMax.StoreMax(swatch.pPoints[i]);
+  }
+  // a pixel is covered if its center is; one pixel of slack on either side
+  // keeps this safe against rounding
+  const uint32_t w = uint32_t(m_iSize.x), h = uint32_t(m_iSize.y);
+  return UINTVECTOR4(Clamp(std::floor(double(vMin.x)*w) - 1, w),
+                     Clamp(std::floor(double(vMin.y)*h) - 1, h),
+                     Clamp(std::ceil(double(vMax.x)*w) + 1, w),
+                     Clamp(std::ceil(double(vMax.y)*h) + 1, h));
+}
+
+UINTVECTOR4 SwatchRasterizer::Union(const UINTVECTOR4& a,
+                                    const UINTVECTOR4& b) {
+  if(IsEmpty(a)) { return b; }
+  if(IsEmpty(b)) { return a; }
+  return UINTVECTOR4(std::min(a.x, b.x), std::min(a.y, b.y),
+                     std::max(a.z, b.z), std::max(a.w, b.w));
+}
+
+UINTVECTOR4 SwatchRasterizer::Intersection(const UINTVECTOR4& a,
+                                           const UINTVECTOR4& b) {
+  return UINTVECTOR4(std::max(a.x, b.x), std::max(a.y, b.y),
+                     std::min(a.z, b.z), std::min(a.w, b.w));
+}
+
+void SwatchRasterizer::Clear(const UINTVECTOR4& rect) {
+  if(IsEmpty(rect)) { return; }
+  const size_t n = m_vBackground.size() / 4;
+  for(size_t y=rect.y; y < rect.w; ++y) {
+    float* d = &m_vPixels[4*(y*m_iSize.x + rect.x)];
+    for(size_t x=rect.x; x < rect.z; ++x, d += 4) {
+      if(n == 0) {
+        d[0] = d[1] = d[2] = d[3] = 0.0f;
+        continue;
+      }
+      // the 1D TF is stretched over the whole width
+      const size_t i = std::min(n-1, size_t((x+0.5) * n / m_iSize.x));
+      std::copy(&m_vBackground[4*i], &m_vBackground[4*i] + 4, d);
+    }
+  }
+}
+
+void SwatchRasterizer::BuildGradient(const TFPolygon& swatch) {
+  std::vector<GradientStop> stops(swatch.pGradientStops);
+  if(stops.empty()) {
+    stops.push_back(GradientStop(0.0f, FLOATVECTOR4(0,0,0,1)));
+    stops.push_back(GradientStop(1.0f, FLOATVECTOR4(1,1,1,1)));
+  }
+  std::stable_sort(stops.begin(), stops.end(), StopLess);
+
+  m_vGradient.resize(4*iGradientSize);
+  float first[4], last[4];
+  Premultiply(stops.front().second, first);
+  Premultiply(stops.back().second, last);
+  size_t s = 0;
+  for(size_t i=0; i < iGradientSize; ++i) {
+    const float t = float(i) / float(iGradientSize-1);
+    float* g = &m_vGradient[4*i];
+    while(s < stops.size() && stops[s].first <= t) { ++s; }
+    if(s == 0) {
+      std::copy(first, first+4, g);
+    } else if(s == stops.size()) {
+      std::copy(last, last+4, g);
+    } else {
+      float a[4], b[4];
+      Premultiply(stops[s-1].second, a);
+      Premultiply(stops[s].second, b);
+      const float f = (t - stops[s-1].first) /
+                      (stops[s].first - stops[s-1].first);
+      for(size_t c=0; c < 4; ++c) { g[c] = a[c] + (b[c]-a[c])*f; }
+    }
+  }
+}
+
+void SwatchRasterizer::Draw(const TFPolygon& swatch, const UINTVECTOR4& r) {
+  const UINTVECTOR4 rect = Intersection(r, Bounds(swatch));
+  if(IsEmpty(rect)) { return; }
+  BuildGradient(swatch);
+
+  const std::vector<FLOATVECTOR2>& p = swatch.pPoints;
+  const float w = float(m_iSize.x), h = float(m_iSize.y);
+
+  // gradient geometry, in gradient space
+  const FLOATVECTOR2 k = m_vGradientScale;
+  const FLOATVECTOR2 g0(swatch.pGradientCoords[0].x * w * k.x,
+                        swatch.pGradientCoords[0].y * h * k.y);
+  const FLOATVECTOR2 g1(swatch.pGradientCoords[1].x * w * k.x,
+                        swatch.pGradientCoords[1].y * h * k.y);
+  const FLOATVECTOR2 dir = g1 - g0;
+  const float fLength2 = dir.x*dir.x + dir.y*dir.y;
+  const float fRadius = std::sqrt(fLength2);
+  const float fMaxIndex = float(iGradientSize-1);
+
+  for(uint32_t y=rect.y; y < rect.w; ++y) {
+    const float yc = y + 0.5f;
+
+    // where the scanline crosses the polygon's edges, left to right
+    m_vCrossings.clear();
+    for(size_t i=0, j=p.size()-1; i < p.size(); j=i++) {
+      const float ay = p[j].y*h, by = p[i].y*h;
+      if((ay <= yc) == (by <= yc)) { continue; }
+      const float ax = p[j].x*w, bx = p[i].x*w;
+      m_vCrossings.push_back(ax + (yc-ay) * (bx-ax) / (by-ay));
+    }
+    std::sort(m_vCrossings.begin(), m_vCrossings.end());
+
+    const float gy = yc * k.y - g0.y;
+    float* row = &m_vPixels[4*size_t(y)*m_iSize.x];
+    for(size_t c=0; c+1 < m_vCrossings.size(); c += 2) {
+      // pixels whose centers lie in [left, right)
+      const uint32_t x0 = std::max(rect.x,
+        Clamp(std::ceil(double(m_vCrossings[c]) - 0.5), rect.z));
+      const uint32_t x1 = std::min(rect.z,
+        Clamp(std::ceil(double(m_vCrossings[c+1]) - 0.5), rect.z));
+      for(uint32_t x=x0; x < x1; ++x) {
+        const float gx = (x + 0.5f) * k.x - g0.x;
+        float t;
+        if(swatch.bRadial) {
+          t = fRadius > 0 ? std::sqrt(gx*gx + gy*gy) / fRadius : 1.0f;
+        } else {
+          t = fLength2 > 0 ? (gx*dir.x + gy*dir.y) / fLength2 : 0.0f;
+        }
+        t = std::max(0.0f, std::min(t, 1.0f));
+        Blend(&m_vGradient[4*size_t(t*fMaxIndex + 0.5f)], row + 4*x);
+      }
+    }
+  }
+}
+
+void SwatchRasterizer::ToBGRA8(const UINTVECTOR4& rect,
+                               unsigned char* pTarget) const {
+  if(IsEmpty(rect)) { return; }
+  for(size_t y=rect.y; y < rect.w; ++y) {
+    const size_t o = y*m_iSize.x + rect.x;
+    const float* s = &m_vPixels[4*o];
+    unsigned char* d = pTarget + 4*o;
+    for(size_t x=rect.x; x < rect.z; ++x, s += 4, d += 4) {
+      const float a = std::min(s[3], 1.0f);
+      const float f = a > 0 ? 255.0f / a : 0.0f;
+      d[0] = (unsigned char)(std::min(s[2]*f, 255.0f) + 0.5f);
+      d[1] = (unsigned char)(std::min(s[1]*f, 255.0f) + 0.5f);
+      d[2] = (unsigned char)(std::min(s[0]*f, 255.0f) + 0.5f);
+      d[3] = (unsigned char)(a*255.0f + 0.5f);
+    }
+  }
+}
+
+}
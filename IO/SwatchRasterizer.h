@@ -0,0 +1,71 @@
+#ifndef TUVOK_SWATCH_RASTERIZER_H
+#define TUVOK_SWATCH_RASTERIZER_H
+
+#include "StdTuvokDefines.h"
+#include <vector>
+#include "Basics/Vectors.h"
+
+class TFPolygon;
+
+namespace tuvok {
+
+/// Draws the swatches of a 2D transfer function on top of its 1D transfer
+/// function, without a window system.  Pixels are kept as premultiplied
+/// float RGBA and blended source-over, like an ARGB32 QPainter would.
+/// Swatch coordinates are normalized; a swatch point p lands on pixel
+/// coordinate p*size.  Polygons are filled with the even-odd rule, sampled
+/// at pixel centers.
+///
+/// All drawing is restricted to a rectangle (x0, y0, x1, y1), the ends being
+/// exclusive, so that a change to one swatch only redraws the pixels it
+/// touches.
+class SwatchRasterizer {
+public:
+  SwatchRasterizer() : m_iSize(0,0), m_vGradientScale(0,0) {}
+
+  /// @param vGradientSpace gradients are evaluated as if the canvas had this
+  ///        size, so that radial gradients keep their shape when the canvas
+  ///        is not square
+  void Resize(const VECTOR2<size_t>& iSize,
+              const VECTOR2<size_t>& vGradientSpace);
+  const VECTOR2<size_t>& GetSize() const { return m_iSize; }
+
+  /// Sets the 1D transfer function which is stretched across every row.
+  void SetBackground(const std::vector<FLOATVECTOR4>& vColors);
+
+  /// @returns the pixels 'swatch' may cover, clipped to the canvas.  The
+  ///          rectangle is empty (x0 >= x1) if it covers nothing.
+  UINTVECTOR4 Bounds(const TFPolygon& swatch) const;
+  UINTVECTOR4 GetRect() const {
+    return UINTVECTOR4(0, 0, uint32_t(m_iSize.x), uint32_t(m_iSize.y));
+  }
+
+  /// Resets the rectangle to the background.
+  void Clear(const UINTVECTOR4& rect);
+  /// Blends 'swatch' over the pixels in 'rect'.
+  void Draw(const TFPolygon& swatch, const UINTVECTOR4& rect);
+  /// Writes the rectangle as 8bit BGRA, not premultiplied, into the
+  /// corresponding pixels of the canvas-sized 'pTarget'.
+  void ToBGRA8(const UINTVECTOR4& rect, unsigned char* pTarget) const;
+
+  static bool IsEmpty(const UINTVECTOR4& r) { return r.x >= r.z || r.y >= r.w; }
+  static UINTVECTOR4 Union(const UINTVECTOR4& a, const UINTVECTOR4& b);
+  static UINTVECTOR4 Intersection(const UINTVECTOR4& a, const UINTVECTOR4& b);
+
+private:
+  void BuildGradient(const TFPolygon& swatch);
+
+  VECTOR2<size_t>    m_iSize;
+  FLOATVECTOR2       m_vGradientScale;
+  /// premultiplied colors of the 1D transfer function
+  std::vector<float> m_vBackground;
+  /// premultiplied RGBA, row by row
+  std::vector<float> m_vPixels;
+  /// premultiplied colors of the current swatch's gradient
+  std::vector<float> m_vGradient;
+  /// scratch space for the edge crossings of one scanline
+  std::vector<float> m_vCrossings;
+};
+
+}
+#endif
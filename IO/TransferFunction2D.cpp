@@ -46,8 +46,8 @@ TransferFunction2D::TransferFunction2D() :
   m_iSize(0,0),
   m_pColorData(NULL),
   m_pPixelData(NULL),
-  m_pRCanvas(NULL),
-  m_bUseCachedData(false)
+  m_bUseCachedData(false),
+  m_bRedrawAll(true)
 {
 }
 
@@ -56,8 +56,8 @@ TransferFunction2D::TransferFunction2D(const std::string& filename):
   m_iSize(0,0),
   m_pColorData(NULL),
   m_pPixelData(NULL),
-  m_pRCanvas(NULL),
-  m_bUseCachedData(false)
+  m_bUseCachedData(false),
+  m_bRedrawAll(true)
 {
   Load(filename);
 }
@@ -67,8 +67,8 @@ TransferFunction2D::TransferFunction2D(const VECTOR2<size_t>& iSize):
   m_iSize(iSize),
   m_pColorData(NULL),
   m_pPixelData(NULL),
-  m_pRCanvas(NULL),
-  m_bUseCachedData(false)
+  m_bUseCachedData(false),
+  m_bRedrawAll(true)
 {
   Resize(m_iSize);
 }
@@ -78,7 +78,9 @@ void TransferFunction2D::DeleteCanvasData()
 {
   delete m_pColorData;
   delete [] m_pPixelData;
-  delete m_pRCanvas;
+  m_pColorData = NULL;
+  m_pPixelData = NULL;
+  RedrawAll();
 }
 
 TransferFunction2D::~TransferFunction2D(void)
@@ -97,6 +99,8 @@ void TransferFunction2D::Resize(const VECTOR2<size_t>& iSize) {
 void TransferFunction2D::Resample(const VECTOR2<size_t>& iSize) {
   m_iSize = iSize;
   m_Trans1D.Resample(iSize.x);
+
+  DeleteCanvasData();
 }
 
 bool TransferFunction2D::Load(const std::string& filename, const VECTOR2<size_t>& vTargetSize) {
@@ -104,6 +108,7 @@ bool TransferFunction2D::Load(const std::string& filename, const VECTOR2<size_t>
 
   if (!file.is_open()) return false;
 
+  DeleteCanvasData();
   m_iSize = vTargetSize;
 
   // ignore the size in the file (read it but never use it again)
@@ -154,6 +159,8 @@ bool TransferFunction2D::Load(const std::string& filename) {
 
   if (!file.is_open()) return false;
 
+  DeleteCanvasData();
+
   // load size
   file >> m_iSize.x >> m_iSize.y;
 
@@ -286,77 +293,77 @@ void TransferFunction2D::GetFloatArray(float** pfData) {
   memcpy(*pfData, m_pColorData->GetDataPointer(), 4*sizeof(float)*m_iSize.area());
 }
 
-INTVECTOR2 TransferFunction2D::Normalized2Offscreen(FLOATVECTOR2 vfCoord, VECTOR2<size_t> iSize) const {
-  return INTVECTOR2(int(vfCoord.x*int(iSize.x)),
-                    int(vfCoord.y*int(iSize.y)));
+namespace {
+  bool SameSwatch(const TFPolygon& a, const TFPolygon& b) {
+    return a.bRadial == b.bRadial &&
+           a.pPoints == b.pPoints &&
+           a.pGradientCoords[0] == b.pGradientCoords[0] &&
+           a.pGradientCoords[1] == b.pGradientCoords[1] &&
+           a.pGradientStops == b.pGradientStops;
+  }
 }
 
 unsigned char* TransferFunction2D::RenderTransferFunction8Bit() {
-  VECTOR2<size_t> vRS = GetRenderSize();
   if (m_pColorData == NULL) m_pColorData = new ColorData2D(m_iSize);
   if (m_pPixelData == NULL) m_pPixelData = new unsigned char[4*m_iSize.area()];
 
-#ifndef TUVOK_NO_QT
-  if (m_pRCanvas == NULL)   m_pRCanvas   = new QImage(int(vRS.x), int(vRS.y),
-                                                      QImage::Format_ARGB32);
-
-  if (m_pPixelData != NULL && m_bUseCachedData) return m_pPixelData;
-
-  m_pRCanvas->fill(0);
-
-  // render 1D trans
-  QRect imageRect(0, 0, int(vRS.x), int(vRS.y));
-  m_Painter.begin(m_pRCanvas);
-  m_Painter.drawImage(imageRect,m_Trans1DImage);
-
-  // render swatches
-  QPen noBorderPen(Qt::NoPen);
-  m_Painter.setPen(noBorderPen);
-  for (size_t i = 0;i<m_pvSwatches->size();i++) {
-    TFPolygon& currentSwatch = (*m_pvSwatches)[i];
-
-    std::vector<QPoint> pointList(currentSwatch.pPoints.size());
-    for (size_t j = 0;j<currentSwatch.pPoints.size();j++) {
-      INTVECTOR2 vPixelPos = Normalized2Offscreen(currentSwatch.pPoints[j],vRS);
-      pointList[j] = QPoint(vPixelPos.x, vPixelPos.y);
-    }
+  if (m_bUseCachedData) return m_pPixelData;
 
-    INTVECTOR2 vPixelPos0 = Normalized2Offscreen(currentSwatch.pGradientCoords[0],vRS),
-               vPixelPos1 = Normalized2Offscreen(currentSwatch.pGradientCoords[1],vRS);
+  if (m_bRedrawAll || m_Rasterizer.GetSize() != m_iSize) {
+    m_bRedrawAll = true;
+    m_Rasterizer.Resize(m_iSize, GetRenderSize());
+    // like the 1D TF image, at most one entry per column
+    shared_ptr<vector<FLOATVECTOR4>> tfdata = m_Trans1D.GetColorData();
+    m_Rasterizer.SetBackground(vector<FLOATVECTOR4>(tfdata->begin(),
+      tfdata->begin() + min<size_t>(m_iSize.x, tfdata->size())));
+  }
 
-    QGradient* pGradientBrush;
-    if (currentSwatch.bRadial) {
-      double r = sqrt( pow(double(vPixelPos0.x-vPixelPos1.x),2.0) + pow(double(vPixelPos0.y-vPixelPos1.y),2.0));
-      pGradientBrush = new QRadialGradient(vPixelPos0.x, vPixelPos0.y, r);
-    } else {
-      pGradientBrush = new QLinearGradient(vPixelPos0.x, vPixelPos0.y, vPixelPos1.x, vPixelPos1.y);
+  const vector<TFPolygon>& swatches = *m_pvSwatches;
+  vector<UINTVECTOR4> vBounds(swatches.size());
+  for (size_t i = 0;i<swatches.size();i++)
+    vBounds[i] = m_Rasterizer.Bounds(swatches[i]);
+
+  // find what needs to be redrawn
+  vector<UINTVECTOR4> vDirty;
+  if (m_bRedrawAll) {
+    vDirty.push_back(m_Rasterizer.GetRect());
+  } else {
+    const size_t iCount = max(swatches.size(), m_vRenderedSwatches.size());
+    for (size_t i = 0;i<iCount;i++) {
+      UINTVECTOR4 rect(0,0,0,0);
+      if (i >= swatches.size())
+        rect = m_vRenderedBounds[i];
+      else if (i >= m_vRenderedSwatches.size())
+        rect = vBounds[i];
+      else if (!SameSwatch(swatches[i], m_vRenderedSwatches[i]))
+        rect = tuvok::SwatchRasterizer::Union(vBounds[i], m_vRenderedBounds[i]);
+      if (!tuvok::SwatchRasterizer::IsEmpty(rect)) vDirty.push_back(rect);
     }
-
-    for (size_t j = 0;j<currentSwatch.pGradientStops.size();j++) {
-      pGradientBrush->setColorAt(currentSwatch.pGradientStops[j].first,
-                   QColor(int(currentSwatch.pGradientStops[j].second[0]*255),
-                          int(currentSwatch.pGradientStops[j].second[1]*255),
-                          int(currentSwatch.pGradientStops[j].second[2]*255),
-                          int(currentSwatch.pGradientStops[j].second[3]*255)));
+    // past a handful of rectangles, the overlap costs more than it saves
+    if (vDirty.size() > 8) {
+      for (size_t i = 1;i<vDirty.size();i++)
+        vDirty[0] = tuvok::SwatchRasterizer::Union(vDirty[0], vDirty[i]);
+      vDirty.resize(1);
     }
+  }
 
-    m_Painter.setBrush(*pGradientBrush);
-    if(!pointList.empty()) {
-      m_Painter.drawPolygon(&pointList[0], int(currentSwatch.pPoints.size()));
+  // every dirty rectangle is redrawn from scratch: 1D TF, then all swatches
+  // which touch it, in order
+  for (size_t d = 0;d<vDirty.size();d++) {
+    m_Rasterizer.Clear(vDirty[d]);
+    for (size_t i = 0;i<swatches.size();i++) {
+      const UINTVECTOR4 rect =
+        tuvok::SwatchRasterizer::Intersection(vDirty[d], vBounds[i]);
+      if (!tuvok::SwatchRasterizer::IsEmpty(rect))
+        m_Rasterizer.Draw(swatches[i], rect);
     }
-    delete pGradientBrush;
+    m_Rasterizer.ToBGRA8(vDirty[d], m_pPixelData);
   }
-  m_Painter.end();
 
-  memcpy(m_pPixelData, m_pRCanvas->scaled(int(m_iSize.x), int(m_iSize.y)).bits(), 4*m_iSize.area());
+  m_vRenderedSwatches = swatches;
+  m_vRenderedBounds = vBounds;
+  m_bRedrawAll = false;
   m_bUseCachedData = true;
-#else
-  if (!m_pvSwatches->empty()) {
-	m_pvSwatches->clear();
-	WARNING("Cannot render transfer functions without Qt, returning empty transfer function.");
-	memset(m_pPixelData, 0, 4*m_iSize.area());	
-  }
-#endif
   return m_pPixelData;
 }
 
@@ -396,14 +403,11 @@ void TransferFunction2D::ComputeNonZeroLimits() {
   }
 }
 
-#ifdef TUVOK_NO_QT
-void TransferFunction2D::Update1DTrans(const TransferFunction1D*) {
-#else
 void TransferFunction2D::Update1DTrans(const TransferFunction1D* p1DTrans) {
-#endif
-#ifndef TUVOK_NO_QT
   m_Trans1D = TransferFunction1D(*p1DTrans);
+  RedrawAll();
 
+#ifndef TUVOK_NO_QT
   size_t iSize = min<size_t>(m_iSize.x,  m_Trans1D.GetSize());
 
   m_Trans1DImage = QImage(int(iSize), 1, QImage::Format_ARGB32);
@@ -416,8 +420,6 @@ void TransferFunction2D::Update1DTrans(const TransferFunction1D* p1DTrans) {
 
     m_Trans1DImage.setPixel(int(i),0,qRgba(int(r*255),int(g*255),int(b*255),int(a*255)));
   }
-#else
-  T_ERROR("Unsupported without Qt.");
 #endif
 }
 
@@ -49,16 +49,15 @@
 /// @todo FIXME remove this dependency:
 #ifdef TUVOK_NO_QT
 typedef void* QImage;
-typedef void* QPainter;
 #else
 # include <QtGui/QImage>
-# include <QtGui/QPainter>
 #endif
 
 #include "Basics/Vectors.h"
 #include "Basics/Grids.h"
 
 #include "TransferFunction1D.h"
+#include "SwatchRasterizer.h"
 
 typedef Grid2D<uint32_t> Histogram2D;
 typedef Grid2D<float> NormalizedHistogram2D;
@@ -156,17 +155,23 @@ protected:
   VECTOR2<size_t>    m_iSize;
   ColorData2D* RenderTransferFunction();
   unsigned char* RenderTransferFunction8Bit();
-  INTVECTOR2 Normalized2Offscreen(FLOATVECTOR2 vfCoord, VECTOR2<size_t> iSize) const;
 
 private:
   ColorData2D*      m_pColorData;
   unsigned char*    m_pPixelData;
-  QPainter          m_Painter;
-  QImage*           m_pRCanvas;
   UINT64VECTOR4     m_vValueBBox;
   bool              m_bUseCachedData;
 
+  /// Swatches are drawn natively, and after an edit only the area of the
+  /// swatches which differ from the last rendered ones is redrawn.
+  tuvok::SwatchRasterizer  m_Rasterizer;
+  std::vector<TFPolygon>   m_vRenderedSwatches;
+  std::vector<UINTVECTOR4> m_vRenderedBounds;
+  /// the canvas or the 1D TF changed; everything is redrawn
+  bool                     m_bRedrawAll;
+
   void DeleteCanvasData();
+  void RedrawAll() { m_bRedrawAll = true; m_bUseCachedData = false; }
 };
 
 #endif // TRANSFERFUNCTION2D
@@ -0,0 +1,263 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "TypeConversion.h"
+#include "Dataset.h"
+
+// SSE2 is part of every x86-64 target; elsewhere the kernels go one
+// element at a time.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define TUVOK_CONVERSION_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace tuvok {
+
+namespace {
+  // Position of a type in the kernel tables; -1 for types without kernels.
+  int TypeIndex(const ElementType& e) {
+    if(e.bFloat) {
+      return e.iBitWidth == 32 ? 6 : e.iBitWidth == 64 ? 7 : -1;
+    }
+    switch(e.iBitWidth) {
+      case  8: return e.bSigned ? 1 : 0;
+      case 16: return e.bSigned ? 3 : 2;
+      case 32: return e.bSigned ? 5 : 4;
+    }
+    return -1;
+  }
+
+#ifdef TUVOK_CONVERSION_SSE2
+  // Moves four elements of T to and from two pairs of doubles.  Stores round
+  // toward zero, like a cast; results outside the range of T are undefined
+  // for the scalar code anyway.
+  template<class T> struct Lanes;
+
+  inline void Int4ToDouble(__m128i v, __m128d& a, __m128d& b) {
+    a = _mm_cvtepi32_pd(v);
+    b = _mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v));
+  }
+  inline __m128i DoubleToInt4(__m128d a, __m128d b) {
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(a), _mm_cvttpd_epi32(b));
+  }
+  inline __m128i Load4Bytes(const void* p) {
+    int32_t i;
+    std::memcpy(&i, p, sizeof(i));
+    return _mm_cvtsi32_si128(i);
+  }
+  inline void Store4Bytes(void* p, __m128i v) {
+    const int32_t i = _mm_cvtsi128_si32(v);
+    std::memcpy(p, &i, sizeof(i));
+  }
+
+  template<> struct Lanes<uint8_t> {
+    static void Load(const uint8_t* p, __m128d& a, __m128d& b) {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i v = _mm_unpacklo_epi8(Load4Bytes(p), zero);
+      Int4ToDouble(_mm_unpacklo_epi16(v, zero), a, b);
+    }
+    static void Store(uint8_t* p, __m128d a, __m128d b) {
+      const __m128i v = _mm_packs_epi32(DoubleToInt4(a, b),
+                                        _mm_setzero_si128());
+      Store4Bytes(p, _mm_packus_epi16(v, v));
+    }
+  };
+  template<> struct Lanes<int8_t> {
+    static void Load(const int8_t* p, __m128d& a, __m128d& b) {
+      __m128i v = Load4Bytes(p);
+      v = _mm_unpacklo_epi8(v, v);
+      Int4ToDouble(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 24), a, b);
+    }
+    static void Store(int8_t* p, __m128d a, __m128d b) {
+      const __m128i v = _mm_packs_epi32(DoubleToInt4(a, b),
+                                        _mm_setzero_si128());
+      Store4Bytes(p, _mm_packs_epi16(v, v));
+    }
+  };
+  template<> struct Lanes<uint16_t> {
+    static void Load(const uint16_t* p, __m128d& a, __m128d& b) {
+      const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+      Int4ToDouble(_mm_unpacklo_epi16(v, _mm_setzero_si128()), a, b);
+    }
+    // there is no unsigned saturating pack from 32 bit; shift the range to
+    // that of int16 and back
+    static void Store(uint16_t* p, __m128d a, __m128d b) {
+      const __m128i v = _mm_sub_epi32(DoubleToInt4(a, b),
+                                      _mm_set1_epi32(0x8000));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(p),
+                       _mm_xor_si128(_mm_packs_epi32(v, v),
+                                     _mm_set1_epi16(-0x8000)));
+    }
+  };
+  template<> struct Lanes<int16_t> {
+    static void Load(const int16_t* p, __m128d& a, __m128d& b) {
+      const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+      Int4ToDouble(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), a, b);
+    }
+    static void Store(int16_t* p, __m128d a, __m128d b) {
+      const __m128i v = DoubleToInt4(a, b);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(v, v));
+    }
+  };
+  template<> struct Lanes<uint32_t> {
+    // flip the sign bit, convert as signed and add 2^31 back
+    static void Load(const uint32_t* p, __m128d& a, __m128d& b) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      const __m128i sign = _mm_set1_epi32(std::numeric_limits<int32_t>::min());
+      Int4ToDouble(_mm_xor_si128(v, sign), a, b);
+      const __m128d two31 = _mm_set1_pd(2147483648.0);
+      a = _mm_add_pd(a, two31);
+      b = _mm_add_pd(b, two31);
+    }
+    // values of 2^31 and above are converted as v-2^31 and get the top bit
+    // set afterwards
+    static void Store(uint32_t* p, __m128d a, __m128d b) {
+      const __m128d two31 = _mm_set1_pd(2147483648.0);
+      const __m128d ma = _mm_cmpge_pd(a, two31);
+      const __m128d mb = _mm_cmpge_pd(b, two31);
+      const __m128i v = DoubleToInt4(_mm_sub_pd(a, _mm_and_pd(ma, two31)),
+                                     _mm_sub_pd(b, _mm_and_pd(mb, two31)));
+      const __m128d one = _mm_set1_pd(1.0);
+      const __m128i high = _mm_slli_epi32(
+        DoubleToInt4(_mm_and_pd(ma, one), _mm_and_pd(mb, one)), 31);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_or_si128(v, high));
+    }
+  };
+  template<> struct Lanes<int32_t> {
+    static void Load(const int32_t* p, __m128d& a, __m128d& b) {
+      Int4ToDouble(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), a, b);
+    }
+    static void Store(int32_t* p, __m128d a, __m128d b) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), DoubleToInt4(a, b));
+    }
+  };
+  template<> struct Lanes<float> {
+    static void Load(const float* p, __m128d& a, __m128d& b) {
+      const __m128 v = _mm_loadu_ps(p);
+      a = _mm_cvtps_pd(v);
+      b = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+    }
+    static void Store(float* p, __m128d a, __m128d b) {
+      _mm_storeu_ps(p, _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b)));
+    }
+  };
+  template<> struct Lanes<double> {
+    static void Load(const double* p, __m128d& a, __m128d& b) {
+      a = _mm_loadu_pd(p);
+      b = _mm_loadu_pd(p+2);
+    }
+    static void Store(double* p, __m128d a, __m128d b) {
+      _mm_storeu_pd(p, a);
+      _mm_storeu_pd(p+2, b);
+    }
+  };
+#endif
+
+  // Back to front: element i of the target never overlaps an element of
+  // the source below i when D is at least as wide as S, so this works in
+  // place.  The arithmetic is done in double, in the same order as the
+  // vector code, so both give identical results.
+  template<class S, class D>
+  void Convert(const void* pSource, void* pTarget, size_t count,
+               double fLow, double fFactor) {
+    const S* src = static_cast<const S*>(pSource);
+    D* dst = static_cast<D*>(pTarget);
+#ifdef TUVOK_CONVERSION_SSE2
+    const size_t body = count - count % 4;
+#else
+    const size_t body = 0;
+#endif
+    for(size_t i=count; i > body; --i) {
+      dst[i-1] = static_cast<D>((double(src[i-1]) - fLow) * fFactor);
+    }
+#ifdef TUVOK_CONVERSION_SSE2
+    const __m128d lo = _mm_set1_pd(fLow);
+    const __m128d f = _mm_set1_pd(fFactor);
+    for(size_t i=body; i > 0; i -= 4) {
+      __m128d a, b;
+      Lanes<S>::Load(src + i-4, a, b);
+      Lanes<D>::Store(dst + i-4, _mm_mul_pd(_mm_sub_pd(a, lo), f),
+                      _mm_mul_pd(_mm_sub_pd(b, lo), f));
+    }
+#endif
+  }
+
+  typedef void (*Kernel)(const void*, void*, size_t, double, double);
+
+  // kernels converting to D, in the order of TypeIndex
+  template<class D> struct Kernels { static const Kernel k[8]; };
+  template<class D> const Kernel Kernels<D>::k[8] = {
+    &Convert<uint8_t, D>, &Convert<int8_t, D>,
+    &Convert<uint16_t, D>, &Convert<int16_t, D>,
+    &Convert<uint32_t, D>, &Convert<int32_t, D>,
+    &Convert<float, D>, &Convert<double, D>
+  };
+
+  template<class S, class T>
+  bool ReadAs(const Dataset& ds, const BrickKey& key, std::vector<S>& tmp,
+              std::vector<T>& data) {
+    if(!ds.GetBrick(key, tmp)) { return false; }
+    data.resize(tmp.size());
+    return tmp.empty() ||
+           ConvertRange(&tmp[0], ElementTypeOf<S>(), tmp.size(),
+                        ds.GetRange(), &data[0]);
+  }
+}
+
+template<class T> ElementType ElementTypeOf() {
+  return ElementType(unsigned(sizeof(T)*8),
+                     std::numeric_limits<T>::is_signed,
+                     std::is_floating_point<T>::value);
+}
+
+template<class T>
+bool ConvertRange(const void* pSource, ElementType eSource, size_t count,
+                  const std::pair<double, double>& range, T* pTarget) {
+  const int iSource = TypeIndex(eSource);
+  if(iSource < 0) { return false; }
+  assert(range.second >= range.first);
+  const double fFactor = double(std::numeric_limits<T>::max()) /
+                         (range.second - range.first);
+  Kernels<T>::k[iSource](pSource, pTarget, count, range.first, fFactor);
+  return true;
+}
+
+template<class T>
+bool ReadConverted(const Dataset& ds, const BrickKey& key,
+                   std::vector<T>& data, ConversionScratch& scratch) {
+  const ElementType eSource(ds.GetBitWidth(), ds.GetIsSigned(),
+                            ds.GetIsFloat());
+  if(eSource == ElementTypeOf<T>()) { return ds.GetBrick(key, data); }
+
+  switch(TypeIndex(eSource)) {
+    case 0: return ReadAs(ds, key, scratch.vUInt8, data);
+    case 1: return ReadAs(ds, key, scratch.vInt8, data);
+    case 2: return ReadAs(ds, key, scratch.vUInt16, data);
+    case 3: return ReadAs(ds, key, scratch.vInt16, data);
+    case 4: return ReadAs(ds, key, scratch.vUInt32, data);
+    case 5: return ReadAs(ds, key, scratch.vInt32, data);
+    case 6: return ReadAs(ds, key, scratch.vFloat, data);
+    case 7: return ReadAs(ds, key, scratch.vDouble, data);
+  }
+  return false;
+}
+
+#define TUVOK_CONVERSION_INSTANTIATE(T)                                   \
+  template ElementType ElementTypeOf<T>();                                \
+  template bool ConvertRange<T>(const void*, ElementType, size_t,         \
+                                const std::pair<double, double>&, T*);    \
+  template bool ReadConverted<T>(const Dataset&, const BrickKey&,         \
+                                 std::vector<T>&, ConversionScratch&);
+TUVOK_CONVERSION_INSTANTIATE(uint8_t)
+TUVOK_CONVERSION_INSTANTIATE(int8_t)
+TUVOK_CONVERSION_INSTANTIATE(uint16_t)
+TUVOK_CONVERSION_INSTANTIATE(int16_t)
+TUVOK_CONVERSION_INSTANTIATE(uint32_t)
+TUVOK_CONVERSION_INSTANTIATE(int32_t)
+TUVOK_CONVERSION_INSTANTIATE(float)
+TUVOK_CONVERSION_INSTANTIATE(double)
+#undef TUVOK_CONVERSION_INSTANTIATE
+}
@@ -0,0 +1,68 @@
+#ifndef TUVOK_TYPE_CONVERSION_H
+#define TUVOK_TYPE_CONVERSION_H
+
+#include "StdTuvokDefines.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "Brick.h"
+
+namespace tuvok {
+
+class Dataset;
+
+/// A scalar element type, described the way Dataset::GetBitWidth,
+/// GetIsSigned and GetIsFloat do.  Floating point data are signed.
+struct ElementType {
+  ElementType(unsigned _iBitWidth=8, bool _bSigned=false, bool _bFloat=false) :
+    iBitWidth(_iBitWidth), bSigned(_bSigned || _bFloat), bFloat(_bFloat) {}
+
+  bool operator==(const ElementType& e) const {
+    return iBitWidth == e.iBitWidth && bSigned == e.bSigned &&
+           bFloat == e.bFloat;
+  }
+  bool operator!=(const ElementType& e) const { return !(*this == e); }
+
+  unsigned iBitWidth;
+  bool bSigned;
+  bool bFloat;
+};
+
+/// @returns the ElementType of the C++ type T
+template<class T> ElementType ElementTypeOf();
+
+/// Converts 'count' elements of type 'eSource' at 'pSource' to T, mapping
+/// 'range' linearly onto [0, max(T)] and rounding toward zero.  Every
+/// combination of 8, 16 and 32 bit integers, float and double has a kernel
+/// of its own.  The elements are processed back to front, so 'pTarget' may
+/// be the same memory as 'pSource' as long as T is not narrower than
+/// 'eSource'.
+/// @returns false if there is no kernel for 'eSource'
+template<class T>
+bool ConvertRange(const void* pSource, ElementType eSource, size_t count,
+                  const std::pair<double, double>& range, T* pTarget);
+
+/// Buffers ReadConverted keeps bricks of the stored type in.  Reuse one
+/// across calls: once it has seen the largest brick, reads stop allocating.
+/// Not to be shared among threads.
+struct ConversionScratch {
+  std::vector<uint8_t> vUInt8;
+  std::vector<int8_t> vInt8;
+  std::vector<uint16_t> vUInt16;
+  std::vector<int16_t> vInt16;
+  std::vector<uint32_t> vUInt32;
+  std::vector<int32_t> vInt32;
+  std::vector<float> vFloat;
+  std::vector<double> vDouble;
+};
+
+/// Reads brick 'key' of 'ds' into 'data' as T.  Data stored in a different
+/// type are read into 'scratch' and expanded with ConvertRange over the
+/// range of the dataset.
+/// @returns false if the brick could not be read or its type converted
+template<class T>
+bool ReadConverted(const Dataset& ds, const BrickKey& key,
+                   std::vector<T>& data, ConversionScratch& scratch);
+
+}
+#endif
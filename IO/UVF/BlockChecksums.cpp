@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include "BlockChecksums.h"
+#include "Basics/Checksums/crc32c.h"
+
+using namespace std;
+
+namespace {
+  // bricks below this size share a segment, larger runs of data are split
+  const uint64_t MIN_SEGMENT = 1 << 18;
+  const uint64_t MAX_SEGMENT = 1 << 24;
+  const uint64_t ENTRY_SIZE  = sizeof(uint64_t) + sizeof(uint32_t);
+  const uint64_t TABLE_START = 2 * sizeof(uint32_t);
+
+  void Put(vector<unsigned char>& v, size_t pos, uint64_t value, size_t n) {
+    for (size_t i = 0; i < n; ++i) v[pos+i] = uint8_t(value >> (8*i));
+  }
+  uint64_t Get(const vector<unsigned char>& v, size_t pos, size_t n) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; ++i) value |= uint64_t(v[pos+i]) << (8*i);
+    return value;
+  }
+  uint32_t TableCRC(const vector<unsigned char>& vTable) {
+    return CRC32C::get(&vTable[4], vTable.size() - 4);
+  }
+}
+
+BlockChecksums::BlockChecksums() :
+  m_iBase(0)
+{}
+
+uint64_t BlockChecksums::TableSize(size_t iSegments) {
+  return TABLE_START + iSegments * ENTRY_SIZE;
+}
+
+size_t BlockChecksums::Capacity(uint64_t iTableSize) {
+  return iTableSize < TABLE_START ? 0
+                                  : size_t((iTableSize-TABLE_START)/ENTRY_SIZE);
+}
+
+size_t BlockChecksums::CapacityFor(size_t iSegments) {
+  return iSegments + iSegments/64 + 16;
+}
+
+vector<uint64_t> BlockChecksums::Layout(vector<uint64_t> vBoundaries,
+                                        uint64_t iBase, uint64_t iFileSize) {
+  vBoundaries.push_back(iFileSize);
+  sort(vBoundaries.begin(), vBoundaries.end());
+
+  vector<uint64_t> vEnd;
+  uint64_t prev = iBase;
+  for (auto b = vBoundaries.cbegin(); b != vBoundaries.cend(); ++b) {
+    if (*b <= prev) continue;
+    if (*b > iFileSize) break;
+    while (*b - prev > MAX_SEGMENT) {
+      prev += MAX_SEGMENT;
+      vEnd.push_back(prev);
+    }
+    if (*b - prev < MIN_SEGMENT && *b != iFileSize) continue;
+    vEnd.push_back(*b);
+    prev = *b;
+  }
+  return vEnd;
+}
+
+bool BlockChecksums::Parse(LargeRAWFile_ptr pFile,
+                           const vector<unsigned char>& vTable,
+                           uint64_t iBase, string* pstrProblem) {
+  m_pFile = pFile;
+  m_iBase = iBase;
+  m_vEnd.clear();
+  m_vCRC.clear();
+
+  const size_t iCapacity = Capacity(vTable.size());
+  if (vTable.size() != TableSize(iCapacity) ||
+      uint32_t(Get(vTable, 0, 4)) != TableCRC(vTable)) {
+    if (pstrProblem) *pstrProblem = "BlockChecksums::Parse: checksum table "
+                                    "is damaged.";
+    return false;
+  }
+
+  const uint64_t iCount = Get(vTable, 4, 4);
+  const uint64_t iFileSize = pFile->GetCurrentSize();
+  bool bValid = iCount <= iCapacity && (iCount > 0 || iFileSize == iBase);
+  for (size_t i = 0; bValid && i < size_t(iCount); ++i) {
+    const size_t pos = size_t(TABLE_START + i*ENTRY_SIZE);
+    const uint64_t iEnd = iBase + Get(vTable, pos, 8);
+    bValid = iEnd > Begin(i);
+    m_vEnd.push_back(iEnd);
+    m_vCRC.push_back(uint32_t(Get(vTable, pos+8, 4)));
+  }
+  if (!bValid || (!m_vEnd.empty() && m_vEnd.back() != iFileSize)) {
+    if (pstrProblem) {
+      stringstream s;
+      s << "BlockChecksums::Parse: checksum table does not fit the file "
+        << "size of " << iFileSize << " bytes.";
+      *pstrProblem = s.str();
+    }
+    m_vEnd.clear();
+    m_vCRC.clear();
+    return false;
+  }
+  ResetState(vector<uint8_t>(m_vEnd.size(), UNCHECKED));
+  return true;
+}
+
+vector<unsigned char> BlockChecksums::Serialize(size_t iCapacity) const {
+  assert(m_vEnd.size() <= iCapacity);
+  vector<unsigned char> vTable(size_t(TableSize(iCapacity)), 0);
+  Put(vTable, 4, m_vEnd.size(), 4);
+  for (size_t i = 0; i < m_vEnd.size(); ++i) {
+    const size_t pos = size_t(TABLE_START + i*ENTRY_SIZE);
+    Put(vTable, pos, m_vEnd[i] - m_iBase, 8);
+    Put(vTable, pos+8, m_vCRC[i], 4);
+  }
+  Put(vTable, 0, TableCRC(vTable), 4);
+  return vTable;
+}
+
+std::shared_ptr<BlockChecksums>
+BlockChecksums::Update(LargeRAWFile_ptr pFile, uint64_t iBase,
+                       const vector<uint64_t>& vBoundaries,
+                       const vector<Range>& vChanged,
+                       size_t iCapacity) const {
+  const uint64_t iFileSize = pFile->GetCurrentSize();
+  std::shared_ptr<BlockChecksums> result(new BlockChecksums());
+  vector<uint64_t>& vEnd = result->m_vEnd;
+  vEnd = Layout(vBoundaries, iBase, iFileSize);
+  if (vEnd.size() > iCapacity && iCapacity > 0) {
+    vEnd.resize(iCapacity);
+    vEnd.back() = iFileSize;
+  }
+
+  // keep what we know about segments which did not move or change
+  vector<uint32_t>& vCRC = result->m_vCRC;
+  vCRC.assign(vEnd.size(), 0);
+  vector<uint8_t> vState(vEnd.size(), GOOD);
+  vector<size_t> vCompute;
+  for (size_t i = 0; i < vEnd.size(); ++i) {
+    const uint64_t iBegin = i == 0 ? iBase : vEnd[i-1];
+    bool bKeep = false;
+    if (m_iBase == iBase) {
+      auto old = lower_bound(m_vEnd.cbegin(), m_vEnd.cend(), vEnd[i]);
+      if (old != m_vEnd.cend() && *old == vEnd[i] &&
+          Begin(size_t(old - m_vEnd.cbegin())) == iBegin) {
+        bKeep = true;
+        for (auto c = vChanged.cbegin(); bKeep && c != vChanged.cend(); ++c)
+          bKeep = c->second <= iBegin || c->first >= vEnd[i];
+        if (bKeep) {
+          const size_t j = size_t(old - m_vEnd.cbegin());
+          vCRC[i] = m_vCRC[j];
+          vState[i] = m_pState[j].load();
+        }
+      }
+    }
+    if (!bKeep) vCompute.push_back(i);
+  }
+
+  result->m_pFile = pFile;
+  result->m_iBase = iBase;
+  result->ResetState(vState);
+
+  const int64_t n = int64_t(vCompute.size());
+# pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0; i < n; ++i) {
+    vCRC[vCompute[size_t(i)]] = result->Compute(vCompute[size_t(i)]);
+  }
+  return result;
+}
+
+bool BlockChecksums::Verify(uint64_t iPos, uint64_t iLength,
+                            const uint8_t* pData) const {
+  bool bResult = true;
+  const uint64_t iEnd = iPos + iLength;
+  for (size_t i = size_t(upper_bound(m_vEnd.cbegin(), m_vEnd.cend(), iPos) -
+                         m_vEnd.cbegin());
+       i < m_vEnd.size() && Begin(i) < iEnd; ++i) {
+    uint8_t state = m_pState[i].load(std::memory_order_acquire);
+    if (state == UNCHECKED) {
+      uint32_t crc;
+      if (pData && Begin(i) >= iPos && m_vEnd[i] <= iEnd) {
+        crc = CRC32C::get(pData + (Begin(i) - iPos),
+                          size_t(m_vEnd[i] - Begin(i)));
+      } else {
+        crc = Compute(i);
+      }
+      state = crc == m_vCRC[i] ? GOOD : BAD;
+      m_pState[i].store(state, std::memory_order_release);
+    }
+    bResult = bResult && state == GOOD;
+  }
+  return bResult;
+}
+
+bool BlockChecksums::VerifyAll(const vector<Range>& vSkip,
+                               string* pstrProblem) const {
+  vector<size_t> vCheck;
+  for (size_t i = 0; i < m_vEnd.size(); ++i) {
+    bool bSkip = false;
+    for (auto s = vSkip.cbegin(); !bSkip && s != vSkip.cend(); ++s)
+      bSkip = s->first <= Begin(i) && m_vEnd[i] <= s->second;
+    if (!bSkip) vCheck.push_back(i);
+  }
+
+  const int64_t n = int64_t(vCheck.size());
+# pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0; i < n; ++i) {
+    const size_t seg = vCheck[size_t(i)];
+    Verify(Begin(seg), m_vEnd[seg] - Begin(seg));
+  }
+
+  for (size_t i = 0; i < vCheck.size(); ++i) {
+    const size_t seg = vCheck[i];
+    if (m_pState[seg].load() != GOOD) {
+      if (pstrProblem) {
+        stringstream s;
+        s << "BlockChecksums::VerifyAll: checksum mismatch in bytes "
+          << Begin(seg) << " to " << m_vEnd[seg] << ".";
+        *pstrProblem = s.str();
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t BlockChecksums::Compute(size_t i) const {
+  const uint64_t iChunk = 1 << 22;
+  vector<unsigned char> buf(size_t(min(iChunk, m_vEnd[i] - Begin(i))));
+  uint32_t crc = 0;
+  for (uint64_t pos = Begin(i); pos < m_vEnd[i]; pos += iChunk) {
+    const size_t iSize = size_t(min(iChunk, m_vEnd[i] - pos));
+    if (m_pFile->ReadRAWAt(&buf[0], iSize, pos) != iSize) {
+      // short file: make sure this cannot match
+      return ~m_vCRC[i];
+    }
+    crc = CRC32C::chunk(crc, &buf[0], iSize);
+  }
+  return crc;
+}
+
+void BlockChecksums::ResetState(const vector<uint8_t>& vState) {
+  m_pState.reset(new std::atomic<uint8_t>[vState.size()]);
+  for (size_t i = 0; i < vState.size(); ++i) m_pState[i].store(vState[i]);
+}
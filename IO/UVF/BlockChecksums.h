@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef UVF_BLOCKCHECKSUMS_H
+#define UVF_BLOCKCHECKSUMS_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "UVFBasic.h"
+
+/** CRC32C checksums over consecutive segments of a UVF file, used for
+ * the CS_BLOCKCRC32C semantic. The segment boundaries follow the data
+ * blocks (one segment per brick of a TOC block). A brick can then be
+ * checked the first time it is read, and a changed block only costs the
+ * segments it covers.
+ *
+ * The table takes the place of the single checksum in the global header
+ * and covers everything behind it, just as CS_CRC32 and CS_MD5 do:
+ *   uint32  CRC32C of the rest of the table
+ *   uint32  number of segments in use
+ *   per segment: uint64 end (relative to the end of the table), uint32 CRC32C
+ * All values are little endian; unused slots are zero. The space is fixed
+ * when the file is created; if later blocks need more segments, the last
+ * one covers them all. */
+class BlockChecksums {
+public:
+  /// [first, second) in the file
+  typedef std::pair<uint64_t, uint64_t> Range;
+
+  BlockChecksums();
+
+  /// size of a table with room for 'iSegments' segments
+  static uint64_t TableSize(size_t iSegments);
+  /// number of segments a table of 'iTableSize' bytes holds
+  static size_t Capacity(uint64_t iTableSize);
+  /// capacity to reserve for 'iSegments', leaving room for appended blocks
+  static size_t CapacityFor(size_t iSegments);
+
+  /// Segment ends for a file of 'iFileSize' bytes whose checksummed part
+  /// starts at 'iBase'. The segments break at the given (absolute)
+  /// boundaries, but tiny ones are merged and huge ones split.
+  static std::vector<uint64_t> Layout(std::vector<uint64_t> vBoundaries,
+                                      uint64_t iBase, uint64_t iFileSize);
+
+  /// Reads a table stored in the global header; fails if it is damaged or
+  /// does not match the size of the file. Nothing is checked yet.
+  bool Parse(LargeRAWFile_ptr pFile, const std::vector<unsigned char>& vTable,
+             uint64_t iBase, std::string* pstrProblem = NULL);
+  /// table for the global header, 'iCapacity' segments large
+  std::vector<unsigned char> Serialize(size_t iCapacity) const;
+
+  /// Lays out the segments anew after the file changed. Only segments
+  /// which did not exist before or overlap a range in 'vChanged' are read;
+  /// all others keep their checksum. Recomputation runs in parallel.
+  /// The result is a new table: this one stays as it is, since bricks may
+  /// still be checked against it while the update runs.
+  std::shared_ptr<BlockChecksums> Update(
+    LargeRAWFile_ptr pFile, uint64_t iBase,
+    const std::vector<uint64_t>& vBoundaries,
+    const std::vector<Range>& vChanged, size_t iCapacity) const;
+
+  /// Checks the segments overlapping [iPos, iPos+iLength) unless that was
+  /// done before. 'pData' may hold those bytes; segments which lie inside
+  /// are then checked without reading the file. Safe to call from several
+  /// threads.
+  bool Verify(uint64_t iPos, uint64_t iLength,
+              const uint8_t* pData = NULL) const;
+  /// Checks all segments not checked yet, in parallel. Segments within one
+  /// of the 'vSkip' ranges are left for Verify.
+  bool VerifyAll(const std::vector<Range>& vSkip = std::vector<Range>(),
+                 std::string* pstrProblem = NULL) const;
+
+  size_t GetSegmentCount() const {return m_vEnd.size();}
+
+private:
+  enum { UNCHECKED, GOOD, BAD };
+
+  LargeRAWFile_ptr m_pFile;
+  uint64_t m_iBase;
+  /// absolute end of each segment; each one starts where the last ended
+  std::vector<uint64_t> m_vEnd;
+  std::vector<uint32_t> m_vCRC;
+  std::unique_ptr<std::atomic<uint8_t>[]> m_pState;
+
+  uint64_t Begin(size_t i) const {return i == 0 ? m_iBase : m_vEnd[i-1];}
+  /// reads segment i from the file
+  uint32_t Compute(size_t i) const;
+  void ResetState(const std::vector<uint8_t>& vState);
+};
+
+#endif // UVF_BLOCKCHECKSUMS_H
@@ -98,6 +98,16 @@ uint64_t DataBlock::GetOffsetToNextBlock() const {
   return strBlockID.size() + 4 * sizeof(uint64_t);
 }
 
+vector<pair<uint64_t, uint64_t>> DataBlock::GetParts() const {
+  // by default everything behind the headers is one part
+  vector<pair<uint64_t, uint64_t>> vParts;
+  const uint64_t iSize = GetOffsetToNextBlock();
+  const uint64_t iDataSize = ComputeDataSize();
+  if (iDataSize > 0 && iDataSize < iSize)
+    vParts.push_back(make_pair(iSize - iDataSize, iSize));
+  return vParts;
+}
+
 bool DataBlock::Verify(uint64_t iSizeofData, std::string* pstrProblem) const {
   uint64_t iCorrectSize = ComputeDataSize();
   bool bResult = iCorrectSize == iSizeofData;
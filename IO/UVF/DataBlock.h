@@ -3,9 +3,14 @@
 #ifndef UVF_DATABLOCK_H
 #define UVF_DATABLOCK_H
 
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include "UVFTables.h"
 
+class BlockChecksums;
+
 class DataBlock {
 public:
   DataBlock();
@@ -39,6 +44,16 @@ protected:
                               bool bIsBigEndian, bool bIsLastBlock);
   virtual uint64_t GetOffsetToNextBlock() const;
 
+  /// Byte ranges, relative to the start of the block, which are read on
+  /// their own later on, e.g. the bricks of a TOC block. CS_BLOCKCRC32C
+  /// gives each of them a separate checksum.
+  virtual std::vector<std::pair<uint64_t, uint64_t>> GetParts() const;
+  /// Hands over the file's checksums; returns true if the block checks its
+  /// parts against them whenever it reads one.
+  virtual bool SetChecksums(std::shared_ptr<const BlockChecksums>) {
+    return false;
+  }
+
   virtual DataBlock* Clone() const;
 
   friend class UVF;
@@ -22,9 +22,16 @@
  DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
 #include <stdexcept>
+#include <vector>
 #include "ExtendedOctree.h"
+#include "../BlockChecksums.h"
 #include "Basics/nonstd.h"
+#include "Basics/PrefetchQueue.h"
 #include "Basics/Timer.h"
 #include "Controller/Controller.h"
 #include "Controller/StackTimer.h"
@@ -87,6 +94,7 @@ bool ExtendedOctree::Open(std::string filename, uint64_t iOffset,
 bool ExtendedOctree::Open(LargeRAWFile_ptr pLargeRAWFile, uint64_t iOffset,
                           uint64_t iUVFFileVersion) {
   if (!pLargeRAWFile->IsOpen()) return false;
+  ResetPrefetch();
   m_pLargeRAWFile = pLargeRAWFile;
   m_iOffset = iOffset;
 
@@ -171,6 +179,8 @@ bool ExtendedOctree::Open(LargeRAWFile_ptr pLargeRAWFile, uint64_t iOffset,
  should not be used unless another open call is performed
 */
 void ExtendedOctree::Close() {
+  ResetPrefetch();
+  std::atomic_store(&m_pChecksums, std::shared_ptr<const BlockChecksums>());
   if ( m_pLargeRAWFile != LargeRAWFile_ptr()) 
     m_pLargeRAWFile->Close();
 }
@@ -306,37 +316,268 @@ const TOCEntry& ExtendedOctree::GetBrickToCData(size_t index) const {
  GetBrickData (scalar):
  
  Reads a brick from file and decompresses it if necessary. No magic here it 
- simply seeks to the position in the file, which is the header offset + the 
- brick-offset from the header, and then reads the data. Finally, checks if
- decompression is required.
+ simply reads the data at the header offset + the brick-offset from the
+ header. Finally, checks if decompression is required. The read is
+ positional, i.e. it does not touch the file pointer, and compressed data are
+ staged in a per-thread buffer, so several threads may fetch bricks from the
+ same octree at once.
 */ 
 void ExtendedOctree::GetBrickData(uint8_t* pData, uint64_t index) const {
 
   tuvok::Controller::Instance().IncrementPerfCounter(PERF_EO_BRICKS, 1.0);
 
-  if(m_vTOC[size_t(index)].m_eCompression == CT_NONE) {
+  const TOCEntry& toc = m_vTOC[size_t(index)];
+  std::shared_ptr<const uint8_t> prefetched = TakePrefetched(index);
+  if(toc.m_eCompression == CT_NONE) {
     // not compressed, just read it directly into the buffer.
-    tuvok::StackTimer t(PERF_EO_DISK_READ);
-    m_pLargeRAWFile->SeekPos(m_iOffset+m_vTOC[size_t(index)].m_iOffset);
-    m_pLargeRAWFile->ReadRAW(pData, m_vTOC[size_t(index)].m_iLength);
+    tuvok::StackTimer t(PERF_EO_DISK_READ, int64_t(index));
+    if(prefetched) {
+      std::memcpy(pData, prefetched.get(), size_t(toc.m_iLength));
+    } else {
+      m_pLargeRAWFile->ReadRAWAt(pData, toc.m_iLength, m_iOffset+toc.m_iOffset);
+    }
+    CheckBrick(index, pData);
     return;
   }
 
-  // the data are compressed; read them into a temporary buffer and then expand
-  // that buffer into 'pData'.
-  const size_t uncompressedSize =
-    this->ComputeBrickSize(this->IndexToBrickCoords(index)).volume() *
-    this->GetComponentCount() *
-    this->GetComponentTypeSize();
+  // the data are compressed; read them into this thread's scratch buffer and
+  // then expand that buffer into 'pData'. The buffer is kept for the next
+  // brick, so once a thread has seen the largest brick it stops allocating.
+  const size_t uncompressedSize = UncompressedBrickSize(index);
+  static thread_local std::vector<uint8_t> scratch;
+  if (scratch.size() < uncompressedSize) scratch.resize(uncompressedSize);
+  std::shared_ptr<uint8_t> buf(scratch.data(), nonstd::null_deleter());
+  if(prefetched) {
+    std::memcpy(buf.get(), prefetched.get(), size_t(toc.m_iLength));
+    prefetched.reset();
+  } else {
+    TimedStatement(PERF_EO_DISK_READ,
+      m_pLargeRAWFile->ReadRAWAt(buf.get(), toc.m_iLength,
+                                 m_iOffset+toc.m_iOffset);
+    );
+  }
+  CheckBrick(index, buf.get());
+  tuvok::StackTimer decompress(PERF_EO_DECOMPRESSION, int64_t(index));
+  DecompressBrick(buf, pData, index, uncompressedSize);
+}
+
+/*
+ GetBrickDataBatch (scalar):
+
+ Fetches many bricks at once. The requests are first sorted by their offset
+ in the file so that the reads sweep through the file in one direction, then
+ all reads are issued concurrently and finally every compressed brick is
+ expanded independently on the OpenMP worker pool. Read and decompression
+ phases are timed as a whole on the calling thread. The workers only note
+ which bricks failed their checksum; those are reported afterwards, from the
+ calling thread. Bricks that could not be read completely are not expanded,
+ the call then returns false.
+*/
+bool ExtendedOctree::GetBrickDataBatch(const std::vector<uint64_t>& indices,
+                                       const std::vector<uint8_t*>& vpData) const {
+  assert(indices.size() == vpData.size());
+  const int64_t n = int64_t(indices.size());
+  if (n == 0) return true;
+
+  tuvok::Controller::Instance().IncrementPerfCounter(PERF_EO_BRICKS,
+                                                     double(n));
+
+  std::vector<size_t> order(indices.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return m_vTOC[size_t(indices[a])].m_iOffset <
+           m_vTOC[size_t(indices[b])].m_iOffset;
+  });
+
+  // compressed bricks go through a staging buffer; note that the
+  // decompressors expect it to be at least as large as the output.
+  std::vector<std::shared_ptr<uint8_t>> staging(indices.size());
+  std::vector<size_t> uncompressedSize(indices.size(), 0);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    if (m_vTOC[size_t(indices[i])].m_eCompression == CT_NONE) continue;
+    uncompressedSize[i] = UncompressedBrickSize(indices[i]);
+    staging[i] = std::shared_ptr<uint8_t>(new uint8_t[uncompressedSize[i]],
+                                          nonstd::DeleteArray<uint8_t>());
+  }
+
+  std::vector<char> damaged(indices.size(), 0);
+  std::vector<char> read(indices.size(), 1);
+  {
+    tuvok::StackTimer t(PERF_EO_DISK_READ);
+#   pragma omp parallel for schedule(dynamic)
+    for (int64_t i = 0; i < n; ++i) {
+      const size_t r = order[size_t(i)];
+      const TOCEntry& toc = m_vTOC[size_t(indices[r])];
+      uint8_t* dst = staging[r] ? staging[r].get() : vpData[r];
+      std::shared_ptr<const uint8_t> prefetched = TakePrefetched(indices[r]);
+      if (prefetched) {
+        std::memcpy(dst, prefetched.get(), size_t(toc.m_iLength));
+      } else if (m_pLargeRAWFile->ReadRAWAt(dst, toc.m_iLength,
+                                            m_iOffset+toc.m_iOffset) !=
+                 toc.m_iLength) {
+        read[r] = 0;
+        continue;
+      }
+      damaged[r] = !BrickMatches(indices[r], dst);
+    }
+  }
+  bool complete = true;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    if (damaged[i]) ReportDamagedBrick(indices[i]);
+    if (!read[i]) {
+      complete = false;
+      staging[i].reset();
+    }
+  }
+
+  // exceptions must not leave an OpenMP region; remember the first one and
+  // rethrow it once all workers are done.
+  std::exception_ptr failure;
+  {
+    tuvok::StackTimer t(PERF_EO_DECOMPRESSION);
+#   pragma omp parallel for schedule(dynamic)
+    for (int64_t i = 0; i < n; ++i) {
+      const size_t r = order[size_t(i)];
+      if (!staging[r]) continue;
+      try {
+        DecompressBrick(staging[r], vpData[r], indices[r],
+                        uncompressedSize[r]);
+      } catch (...) {
+#       pragma omp critical
+        if (!failure) failure = std::current_exception();
+      }
+      staging[r].reset();
+    }
+  }
+  if (failure) std::rethrow_exception(failure);
+  return complete;
+}
+
+/*
+ GetBrickDataBatch (vector):
+
+ Convenience function that calls the function above after computing the 1D
+ indices from the brick coordinates
+*/
+bool ExtendedOctree::GetBrickDataBatch(
+  const std::vector<UINT64VECTOR4>& vBrickCoords,
+  const std::vector<uint8_t*>& vpData
+) const {
+  std::vector<uint64_t> indices(vBrickCoords.size());
+  for (size_t i = 0; i < vBrickCoords.size(); ++i)
+    indices[i] = BrickCoordsToIndex(vBrickCoords[i]);
+  return GetBrickDataBatch(indices, vpData);
+}
+
+/*
+ SetChecksums:
+
+ Files with CS_BLOCKCRC32C checksums are not scanned when they are opened;
+ instead every brick is checked the first time it is read. The check runs on
+ the data we just read, so it costs no extra I/O for bricks which have a
+ checksum of their own. The table is replaced whenever the file is updated,
+ possibly while other threads read bricks, so it is swapped atomically.
+*/
+void ExtendedOctree::SetChecksums(
+  std::shared_ptr<const BlockChecksums> pChecksums
+) {
+  std::atomic_store(&m_pChecksums, pChecksums);
+}
+
+bool ExtendedOctree::BrickMatches(uint64_t index, const uint8_t* pData) const {
+  std::shared_ptr<const BlockChecksums> checksums =
+    std::atomic_load(&m_pChecksums);
+  if (!checksums) return true;
+  const TOCEntry& toc = m_vTOC[size_t(index)];
+  return checksums->Verify(m_iOffset+toc.m_iOffset, toc.m_iLength, pData);
+}
+
+void ExtendedOctree::CheckBrick(uint64_t index, const uint8_t* pData) const {
+  if (!BrickMatches(index, pData)) ReportDamagedBrick(index);
+}
+
+void ExtendedOctree::ReportDamagedBrick(uint64_t index) const {
+  T_ERROR("Brick %llu does not match its checksum, the file is damaged.",
+          static_cast<unsigned long long>(index));
+}
+
+/*
+ Prefetch:
+
+ Hands the file ranges of the requested bricks to the read-ahead queue, which
+ coalesces neighbouring bricks into larger reads. Bricks whose data are
+ already in flight are skipped by the queue. The queue is created on first
+ use; a lost race just means one superfluous queue is thrown away.
+*/
+void ExtendedOctree::Prefetch(
+  const std::vector<UINT64VECTOR4>& vBrickCoords
+) const {
+  if (vBrickCoords.empty() || !m_pLargeRAWFile || IsInRWMode()) return;
+
+  std::shared_ptr<tuvok::PrefetchQueue> queue = std::atomic_load(&m_pPrefetch);
+  if (!queue) {
+    std::shared_ptr<tuvok::PrefetchQueue> fresh(
+      new tuvok::PrefetchQueue(m_pLargeRAWFile)
+    );
+    if (std::atomic_compare_exchange_strong(&m_pPrefetch, &queue, fresh))
+      queue = fresh;
+  }
+
+  std::vector<tuvok::PrefetchQueue::Range> ranges(vBrickCoords.size());
+  for (size_t i = 0; i < vBrickCoords.size(); ++i) {
+    const TOCEntry& toc = m_vTOC[size_t(BrickCoordsToIndex(vBrickCoords[i]))];
+    ranges[i].offset = m_iOffset + toc.m_iOffset;
+    ranges[i].length = toc.m_iLength;
+  }
+  queue->Prefetch(ranges);
+}
 
-  std::shared_ptr<uint8_t> buf(new uint8_t[uncompressedSize],
-                               nonstd::DeleteArray<uint8_t>());
+/*
+ TakePrefetched:
+
+ Returns the raw brick data if a previous Prefetch call read them already.
+ Blocks while the brick is being read, but not while it is merely queued.
+*/
+std::shared_ptr<const uint8_t>
+ExtendedOctree::TakePrefetched(uint64_t index) const {
+  std::shared_ptr<tuvok::PrefetchQueue> queue = std::atomic_load(&m_pPrefetch);
+  if (!queue) return std::shared_ptr<const uint8_t>();
+
+  const TOCEntry& toc = m_vTOC[size_t(index)];
+  std::shared_ptr<const uint8_t> data = queue->Take(m_iOffset+toc.m_iOffset,
+                                                    toc.m_iLength);
+  if (data)
+    tuvok::Controller::Instance().IncrementPerfCounter(PERF_EO_PREFETCH_HITS,
+                                                       1.0);
+  return data;
+}
+
+void ExtendedOctree::ResetPrefetch() {
+  std::atomic_store(&m_pPrefetch, std::shared_ptr<tuvok::PrefetchQueue>());
+}
+
+/*
+ UncompressedBrickSize:
+
+ size in bytes of the given brick once it is expanded
+*/
+size_t ExtendedOctree::UncompressedBrickSize(uint64_t index) const {
+  return size_t(this->ComputeBrickSize(this->IndexToBrickCoords(index)).volume() *
+                this->GetComponentCount() *
+                this->GetComponentTypeSize());
+}
+
+/*
+ DecompressBrick:
+
+ expands the compressed brick 'index' held in 'buf' into 'pData'. Touches no
+ shared state besides the (read-only) ToC and LZMA properties, so it is safe
+ to run for different bricks in parallel.
+*/
+void ExtendedOctree::DecompressBrick(std::shared_ptr<uint8_t> buf,
+                                     uint8_t* pData, uint64_t index,
+                                     size_t uncompressedSize) const {
   std::shared_ptr<uint8_t> out(pData, nonstd::null_deleter());
-  TimedStatement(PERF_EO_DISK_READ,
-    m_pLargeRAWFile->SeekPos(m_iOffset+m_vTOC[size_t(index)].m_iOffset);
-    m_pLargeRAWFile->ReadRAW(buf.get(), m_vTOC[size_t(index)].m_iLength);
-  );
-  tuvok::StackTimer decompress(PERF_EO_DECOMPRESSION);
   switch (m_vTOC[size_t(index)].m_eCompression) {
   case CT_ZLIB:
     zDecompress(buf, out, uncompressedSize);
@@ -498,6 +739,7 @@ uint64_t ExtendedOctree::ComputeHeaderSize() const {
 */
 void ExtendedOctree::WriteHeader(LargeRAWFile_ptr pLargeRAWFile,
                                  uint64_t iOffset) {
+  ResetPrefetch();
   m_pLargeRAWFile = pLargeRAWFile;
   m_iOffset = iOffset;
 
@@ -586,6 +828,7 @@ size_t ExtendedOctree::GetComponentTypeSize() const {
 
 bool ExtendedOctree::ReOpenRW() {
   if (IsInRWMode()) return true;
+  ResetPrefetch();
 
   // close read-only file
   m_pLargeRAWFile->Close();
@@ -602,6 +845,7 @@ bool ExtendedOctree::ReOpenRW() {
 
 bool ExtendedOctree::ReOpenR() {
   if (!IsInRWMode()) return true;
+  ResetPrefetch();
 
   m_pLargeRAWFile->Close();
   return m_pLargeRAWFile->Open(false);
@@ -36,6 +36,8 @@
 // for the small fixed size vectors
 #include "Basics/Vectors.h"
 
+namespace tuvok { class PrefetchQueue; }
+
 /*! \brief This structure holds information about a specific level in the tree
  *
  *  This structure holds information about a specific level of the tree,
@@ -126,6 +128,7 @@ struct TOCEntry {
 // forward to the raw to brick converter, required for the
 // friend declaration down below
 class ExtendedOctreeConverter;
+class BlockChecksums;
 
 /*! \brief This class holds the actual octree data
  *
@@ -250,6 +253,12 @@ public:
   */
   const TOCEntry& GetBrickToCData(size_t index) const;
 
+  /**
+    Returns the number of entries in the ToC, i.e. the number of bricks in all LoDs
+    @return the number of entries in the ToC
+  */
+  size_t GetBrickToCSize() const {return m_vTOC.size();}
+
   /**
     Returns the aspect ration of a specific brick, this does not include the global aspect ratio
     @param vBrickCoords coordinates of a brick: x,y,z are the spacial coordinates, w is the LoD level
@@ -258,12 +267,40 @@ public:
   DOUBLEVECTOR3 GetBrickAspect(const UINT64VECTOR4& vBrickCoords) const;
 
   /**
-    use to get the raw (uncompressed) data of a specific brick
+    use to get the raw (uncompressed) data of a specific brick; may be called
+    from several threads at once on a tree that is not open for writing
     @param pData the raw (uncompressed) data of a specific brick, the user has to make sure pData is big enough to hold the data
     @param vBrickCoords coordinates of a brick: x,y,z are the spacial coordinates, w is the LoD level
   */
   void GetBrickData(uint8_t* pData, const UINT64VECTOR4& vBrickCoords) const;
 
+  /**
+    fetches several bricks at once; the reads are sorted by file offset and
+    issued concurrently, compressed bricks are expanded in parallel
+    @param vBrickCoords coordinates of the bricks to fetch
+    @param vpData one output buffer per brick, each must be big enough to hold the uncompressed brick
+    @return false if a brick could not be read completely; the contents of
+            its buffer are undefined then, all other bricks are valid
+  */
+  bool GetBrickDataBatch(const std::vector<UINT64VECTOR4>& vBrickCoords,
+                         const std::vector<uint8_t*>& vpData) const;
+
+  /**
+    announces bricks that will be requested soon; their (raw, possibly
+    compressed) data are read in the background and handed to later
+    GetBrickData/GetBrickDataBatch calls. Purely advisory, has no effect on
+    trees that are open for writing.
+    @param vBrickCoords coordinates of the bricks to read ahead
+  */
+  void Prefetch(const std::vector<UINT64VECTOR4>& vBrickCoords) const;
+
+  /**
+    checks each brick against the given file checksums the first time it is
+    read; a brick that does not match is reported but still returned
+    @param pChecksums checksums of the file the tree was opened from, or NULL
+  */
+  void SetChecksums(std::shared_ptr<const BlockChecksums> pChecksums);
+
 
   /**
     Returns the global aspect ratio of the volume
@@ -347,6 +384,14 @@ private:
   /// pointer to the data file
   LargeRAWFile_ptr m_pLargeRAWFile;
 
+  /// read-ahead for m_pLargeRAWFile, created by the first Prefetch call;
+  /// only accessed through std::atomic_load/store
+  mutable std::shared_ptr<tuvok::PrefetchQueue> m_pPrefetch;
+
+  /// checksums of the bricks in m_pLargeRAWFile, if it has any; only
+  /// accessed through std::atomic_load/store
+  std::shared_ptr<const BlockChecksums> m_pChecksums;
+
   /// the table of contents of the file, it holds the metadata for all bricks
   std::vector<TOCEntry> m_vTOC;
 
@@ -402,6 +447,61 @@ private:
   */
   void GetBrickData(uint8_t* pData, uint64_t index) const;
 
+  /**
+    batched version of GetBrickData, see the public overload
+    @param indices the indices of the bricks in the LoD table
+    @param vpData one output buffer per brick
+    @return false if a brick could not be read completely
+  */
+  bool GetBrickDataBatch(const std::vector<uint64_t>& indices,
+                         const std::vector<uint8_t*>& vpData) const;
+
+  /**
+    claims the prefetched raw data of a brick, if there are any
+    @param index the index of the brick in the LoD table
+    @return the raw data as stored in the file, or an empty pointer if the
+            brick was not read ahead
+  */
+  std::shared_ptr<const uint8_t> TakePrefetched(uint64_t index) const;
+
+  /// drops all read-ahead state, e.g. before the file is closed or reopened
+  void ResetPrefetch();
+
+  /**
+    reports a brick whose data in the file do not match the checksums
+    @param index the index of the brick in the LoD table
+    @param pData the brick as read from the file, i.e. still compressed
+  */
+  void CheckBrick(uint64_t index, const uint8_t* pData) const;
+
+  /**
+    compares a brick with the checksums without reporting anything, so it
+    may be called from worker threads
+    @param index the index of the brick in the LoD table
+    @param pData the brick as read from the file, i.e. still compressed
+    @return true if the brick matches or there are no checksums
+  */
+  bool BrickMatches(uint64_t index, const uint8_t* pData) const;
+
+  /// logs that a brick does not match its checksum
+  void ReportDamagedBrick(uint64_t index) const;
+
+  /**
+    @param index the index of the brick in the LoD table
+    @return the size in bytes of the brick once it is decompressed
+  */
+  size_t UncompressedBrickSize(uint64_t index) const;
+
+  /**
+    expands a compressed brick into its output buffer
+    @param buf the compressed data, at least as large as the uncompressed brick
+    @param pData the output buffer
+    @param index the index of the brick in the LoD table
+    @param uncompressedSize the size of the brick once decompressed
+  */
+  void DecompressBrick(std::shared_ptr<uint8_t> buf, uint8_t* pData,
+                       uint64_t index, size_t uncompressedSize) const;
+
   /** 
     returns true iff the large raw file holding this tree's
     data is is currently in RW mode
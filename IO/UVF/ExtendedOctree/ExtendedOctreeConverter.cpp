@@ -24,6 +24,7 @@
 
 // for find_if
 #include <algorithm>
+#include <exception>
 #include <memory>
 #include <map>
 #include <unordered_map>
@@ -40,6 +41,9 @@
 #include "LzmaCompression.h"
 #include "Lz4Compression.h"
 #include "BzlibCompression.h"
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 // simple/generic progress update message
 #define PROGRESS \
@@ -61,6 +65,11 @@ ExtendedOctreeConverter::ExtendedOctreeConverter(
     m_vBrickSize(vBrickSize),
     m_iOverlap(iOverlap),
     m_iMemLimit(iMemLimit),
+#ifdef _OPENMP
+    m_iWorkerCount(uint32_t(std::max(1, omp_get_max_threads()))),
+#else
+    m_iWorkerCount(1),
+#endif
     m_iCacheAccessCounter(0),
     m_pBrickStatVec(NULL),
     m_Progress(progress)
@@ -472,76 +481,74 @@ void ExtendedOctreeConverter::ComputeStatsAndCompressAll(ExtendedOctree& tree)
                             size_t(tree.m_iComponentCount);
   const size_t maxbricksize = static_cast<size_t>(tree.m_iBrickSize.volume() *
                                                   iVoxelSize);
-  std::shared_ptr<uint8_t> BrickData(new uint8_t[maxbricksize],
-                                     nonstd::DeleteArray<uint8_t>());
-  std::shared_ptr<uint8_t> compressed(new uint8_t[maxbricksize],
-                                      nonstd::DeleteArray<uint8_t>());
-
-  size_t iReportInterval = std::max<size_t>(1, tree.m_vTOC.size()/2000);
-
-  if(m_eCompression == CT_NONE) {
-    // compression is disabled.  That makes our job pretty easy: only compute
-    // the brick stats
-    for(size_t i=0; i < tree.m_vTOC.size(); ++i) {
-      tree.GetBrickData(BrickData.get(), i);
-      BrickStat(m_pBrickStatVec, i, BrickData.get(), BrickSize(tree, i),
-                tree.m_iComponentCount, tree.m_eComponentType);
-
-      if (i % iReportInterval == 0) {
-        m_fProgress = float(i) / tree.m_vTOC.size();
-        std::string msg = m_pProgressTimer->GetProgressMessage(m_fProgress);
-        m_Progress.Message(_func_, "Statistic computation ... %5.2f%% (%s)",
-                           m_fProgress*100.0f, msg.c_str());
+
+  // the cache is gone, so the whole budget is available for the bricks we
+  // work on concurrently; each needs room for its raw and compressed data.
+  const size_t iWave = BricksInFlight(2*maxbricksize, m_iMemLimit);
+  std::vector<std::shared_ptr<uint8_t>> vBrickData(iWave);
+  for (size_t k=0; k < iWave; ++k) {
+    vBrickData[k].reset(new uint8_t[maxbricksize],
+                        nonstd::DeleteArray<uint8_t>());
+  }
+  std::vector<std::shared_ptr<uint8_t>> vCompressed(iWave);
+  std::vector<uint64_t> vCompressedLength(iWave, 0);
+
+  // BrickStat grows the vector on demand, which is not an option once
+  // several threads write into it.
+  if (m_pBrickStatVec->size() < tree.m_vTOC.size()*tree.m_iComponentCount) {
+    m_pBrickStatVec->resize(size_t(tree.m_vTOC.size()*tree.m_iComponentCount));
+  }
+
+  const size_t iReportInterval = std::max<size_t>(1, tree.m_vTOC.size()/2000);
+  const bool bCompress = m_eCompression != CT_NONE;
+
+  // foreach wave of bricks:
+  //   load them up, compute their stats and compress them, in any order
+  //   then, in order, write the compressed payloads and update the brick
+  //   metadata based on what compression changed
+  // Every brick only moves towards the front of the file, so writing brick
+  // i never clobbers a brick we have not read yet.
+  for (size_t b=0; b < tree.m_vTOC.size(); b += iWave) {
+    const size_t n = std::min(iWave, tree.m_vTOC.size()-b);
+
+    // exceptions must not leave the OpenMP region; keep the first one and
+    // rethrow it once all workers are done.
+    std::exception_ptr failure;
+    const int64_t iWaveSize = int64_t(n);
+#   pragma omp parallel for schedule(dynamic) num_threads(m_iWorkerCount) if(iWaveSize > 1)
+    for (int64_t k=0; k < iWaveSize; ++k) {
+      const size_t i = b+size_t(k);
+      try {
+        const TOCEntry& record = tree.m_vTOC[i];
+        assert(record.m_eCompression == CT_NONE);
+        tree.m_pLargeRAWFile->ReadRAWAt(vBrickData[k].get(), record.m_iLength,
+                                        tree.m_iOffset + record.m_iOffset);
+        BrickStat(m_pBrickStatVec, i, vBrickData[k].get(), BrickSize(tree, i),
+                  tree.m_iComponentCount, tree.m_eComponentType);
+        if (bCompress) {
+          vCompressedLength[k] = CompressBrick(tree, vBrickData[k],
+                                               BrickSize(tree, i),
+                                               vCompressed[k]);
+        }
+      } catch (...) {
+#       pragma omp critical
+        if (!failure) failure = std::current_exception();
       }
     }
-  } else {
-    std::array<uint8_t, 5> lzmaProps;
-
-    // foreach brick:
-    //   load it up
-    //   compress it
-    //   write compressed payload
-    //   update brick metadata based on what compression changed
-    for(size_t i=0; i < tree.m_vTOC.size(); ++i) {
-      tree.GetBrickData(BrickData.get(), i);
-      BrickStat(m_pBrickStatVec, i, BrickData.get(), BrickSize(tree, i),
-                tree.m_iComponentCount, tree.m_eComponentType);
-
-      uint64_t newlen = 0;
-      switch (m_eCompression) {
-      case CT_ZLIB:
-        newlen = zCompress(BrickData, BrickSize(tree, i), compressed,
-                           tree.m_iCompressionLevel); // 0..9 (0 no comp)
-        break;
-      case CT_LZMA:
-        newlen = lzmaCompress(BrickData, BrickSize(tree, i), compressed,
-                              lzmaProps, tree.m_iCompressionLevel - 1); // 0..9
-        assert(lzmaProps == tree.m_lzmaProps);
-        break;
-      case CT_LZ4:
-        newlen = lz4Compress(BrickData, BrickSize(tree, i), compressed,
-                             tree.m_iCompressionLevel); // 1..17
-        break;
-      case CT_BZLIB:
-        newlen = bzCompress(BrickData, BrickSize(tree, i), compressed,
-                            tree.m_iCompressionLevel); // 1..9
-        break;
-      case CT_LZHAM:
-        throw std::runtime_error("lzham compression format is not supported anymore by Tuvok");
-        break;
-      default:
-        throw std::runtime_error("unknown compression format");
-      }
+    if (failure) std::rethrow_exception(failure);
+
+    for (size_t k=0; bCompress && k < n; ++k) {
+      const size_t i = b+k;
       std::shared_ptr<uint8_t> data;
 
-      if(newlen < BrickSize(tree, i)) {
-        tree.m_vTOC[i].m_iLength = newlen;
+      if(vCompressedLength[k] < BrickSize(tree, i)) {
+        tree.m_vTOC[i].m_iLength = vCompressedLength[k];
         tree.m_vTOC[i].m_eCompression = m_eCompression;
-        data = compressed;
+        data = vCompressed[k];
       } else {
         tree.m_vTOC[i].m_iLength = BrickSize(tree, i);
         tree.m_vTOC[i].m_eCompression = CT_NONE;
-        data = BrickData;
+        data = vBrickData[k];
       }
       if(i > 0) {
         tree.m_vTOC[i].m_iOffset = tree.m_vTOC[i-1].m_iOffset +
@@ -549,12 +556,20 @@ void ExtendedOctreeConverter::ComputeStatsAndCompressAll(ExtendedOctree& tree)
       }
       tree.m_pLargeRAWFile->SeekPos(tree.m_vTOC[i].m_iOffset);
       tree.m_pLargeRAWFile->WriteRAW(data.get(), tree.m_vTOC[i].m_iLength);
-      
-      if (i % iReportInterval == 0) {
-        m_fProgress = float(i) / tree.m_vTOC.size();
-        std::string msg = m_pProgressTimer->GetProgressMessage(m_fProgress);
+      vCompressed[k].reset();
+    }
+
+    // report if a multiple of the interval is part of this wave
+    if (b % iReportInterval == 0 ||
+        (b+n-1) / iReportInterval != b / iReportInterval) {
+      m_fProgress = float(b) / tree.m_vTOC.size();
+      std::string msg = m_pProgressTimer->GetProgressMessage(m_fProgress);
+      if (bCompress) {
         m_Progress.Message(_func_, "Statistics and compression .. %5.2f%% (%s)",
                            m_fProgress*100.0f, msg.c_str());
+      } else {
+        m_Progress.Message(_func_, "Statistic computation ... %5.2f%% (%s)",
+                           m_fProgress*100.0f, msg.c_str());
       }
     }
   }
@@ -563,6 +578,39 @@ void ExtendedOctreeConverter::ComputeStatsAndCompressAll(ExtendedOctree& tree)
   tree.m_iSize = tree.m_vTOC.back().m_iOffset + tree.m_vTOC.back().m_iLength;
 }
 
+/// Compresses a single brick using the current compression method.
+uint64_t
+ExtendedOctreeConverter::CompressBrick(const ExtendedOctree& tree,
+                                       std::shared_ptr<uint8_t> pData,
+                                       uint64_t iLength,
+                                       std::shared_ptr<uint8_t>& pCompressed) const
+{
+  // *Compress will always create a buffer sized like the input data
+  switch (m_eCompression) {
+  case CT_ZLIB:
+    return zCompress(pData, size_t(iLength), pCompressed,
+                     tree.m_iCompressionLevel); // 0..9 (0 no comp)
+  case CT_LZMA: {
+    // we only use the encoded props for safety checks
+    // they should be identical for all bricks of the tree
+    std::array<uint8_t, 5> props;
+    uint64_t iCompressed = lzmaCompress(pData, size_t(iLength), pCompressed,
+                                        props, tree.m_iCompressionLevel - 1); // 0..9
+    assert(props == tree.m_lzmaProps);
+    return iCompressed; }
+  case CT_LZ4:
+    return lz4Compress(pData, size_t(iLength), pCompressed,
+                       tree.m_iCompressionLevel); // 1..17
+  case CT_BZLIB:
+    return bzCompress(pData, size_t(iLength), pCompressed,
+                      tree.m_iCompressionLevel); // 1..9
+  case CT_LZHAM:
+    throw std::runtime_error("lzham compression format is not supported anymore by Tuvok");
+  default:
+    throw std::runtime_error("unknown compression format");
+  }
+}
+
 std::shared_ptr<uint8_t>
 ExtendedOctreeConverter::Fetch(ExtendedOctree& tree,
                                uint64_t iIndex,
@@ -588,35 +636,8 @@ ExtendedOctreeConverter::Fetch(ExtendedOctree& tree,
     // compress if desired
     if (m_eCompression != CT_NONE) {
       std::shared_ptr<uint8_t> pCompressed;
-      // *Compress will always create a buffer sized like the input data
-      uint64_t iCompressed = 0;
-      switch (m_eCompression) {
-      case CT_ZLIB:
-        iCompressed = zCompress(pData, record.m_iLength, pCompressed,
-                                tree.m_iCompressionLevel); // 0..9 (0 no comp)
-        break;
-      case CT_LZMA: {
-        // we only use the encoded props for safety checks
-        // they should be identical for all bricks of the tree
-        std::array<uint8_t, 5> props;
-        iCompressed = lzmaCompress(pData, record.m_iLength, pCompressed,
-                                   props, tree.m_iCompressionLevel - 1); // 0..9
-        assert(props == tree.m_lzmaProps);
-        break; }
-      case CT_LZ4:
-        iCompressed = lz4Compress(pData, record.m_iLength, pCompressed,
-                                  tree.m_iCompressionLevel); // 1..17
-        break;
-      case CT_BZLIB:
-        iCompressed = bzCompress(pData, record.m_iLength, pCompressed,
-                                 tree.m_iCompressionLevel); // 1..9
-        break;
-      case CT_LZHAM:
-        throw std::runtime_error("lzham compression format is not supported anymore by Tuvok");
-        break;
-      default:
-        throw std::runtime_error("unknown compression format");
-      }
+      uint64_t const iCompressed = CompressBrick(tree, pData, record.m_iLength,
+                                                 pCompressed);
       if (iCompressed < record.m_iLength) {
         if (!pBuffer) {
           pData.reset(new uint8_t[iCompressed], nonstd::DeleteArray<uint8_t>());
@@ -633,8 +654,16 @@ ExtendedOctreeConverter::Fetch(ExtendedOctree& tree,
 
 void ExtendedOctreeConverter::ComputeStatsCompressAndPermuteAll(ExtendedOctree& tree)
 {
-  FlushCache(tree); // be sure we've got everything on disk.
-  m_vBrickCache.clear(); // be double sure we don't use the cache anymore.
+  uint64_t const iUncompressedSize = tree.GetSize();
+  if (m_iWorkerCount > 1) {
+    // let the parallel pass do the expensive part (stats and compression) in
+    // place; the permutation below then just moves the compressed payloads.
+    // Fetch notices the bricks already have stats and only reads them.
+    ComputeStatsAndCompressAll(tree);
+  } else {
+    FlushCache(tree); // be sure we've got everything on disk.
+    m_vBrickCache.clear(); // be double sure we don't use the cache anymore.
+  }
 
   size_t const iVoxelSize = tree.GetComponentTypeSize() * size_t(tree.m_iComponentCount);
   size_t const iMaxBrickSize = static_cast<size_t>(tree.m_iBrickSize.volume() * iVoxelSize);
@@ -857,10 +886,10 @@ void ExtendedOctreeConverter::ComputeStatsCompressAndPermuteAll(ExtendedOctree&
   } // level loop
 
   uint64_t const temporarySpace = tempOffset - tree.m_iSize;
-  uint64_t const compressionGain = tree.m_iSize - writeOffset;
+  uint64_t const compressionGain = iUncompressedSize - writeOffset;
 
   m_Progress.Other(_func_, "Temporary disk space required during brick reordering: %.3f MB", (float)temporarySpace / (1024.f*1024.f));
-  m_Progress.Other(_func_, "Space savings due to data compression: %.2f%%", (100.f - ((float)compressionGain / tree.m_iSize) * 100.f));
+  m_Progress.Other(_func_, "Space savings due to data compression: %.2f%%", (100.f - ((float)compressionGain / iUncompressedSize) * 100.f));
 
   // do not forget to set new octree size
   tree.m_iSize = writeOffset;
@@ -892,6 +921,118 @@ void ExtendedOctreeConverter::GetBrick(uint8_t* pData, ExtendedOctree &tree,
   GetBrick(pData, tree, tree.BrickCoordsToIndex(vBrickCoords));
 }
 
+/*
+  StagingBudget:
+
+  When we run in parallel a quarter of the memory limit is kept for the
+  bricks of a downsampling wave, the rest is used for the brick cache.
+*/
+uint64_t ExtendedOctreeConverter::StagingBudget() const {
+  return m_iWorkerCount > 1 ? m_iMemLimit / 4 : 0;
+}
+
+/*
+  BricksInFlight:
+
+  A few bricks per worker keep everybody busy even if the bricks take
+  different amounts of time, but we never go above the given budget.
+*/
+size_t ExtendedOctreeConverter::BricksInFlight(uint64_t iBytesPerBrick,
+                                               uint64_t iBudget) const {
+  if (m_iWorkerCount <= 1) return 1;
+  const uint64_t iWanted = 4 * uint64_t(m_iWorkerCount);
+  const uint64_t iAffordable = iBudget / std::max<uint64_t>(1, iBytesPerBrick);
+  return size_t(std::max<uint64_t>(1, std::min(iWanted, iAffordable)));
+}
+
+/*
+  ChildBricks:
+
+  Lists the bricks of the next finer LoD that end up in the given brick along
+  with the position they are downsampled to. The order is the one the
+  downsampling always used: the brick itself, then its right, bottom and back
+  neighbors, then the diagonal ones.
+*/
+size_t ExtendedOctreeConverter::ChildBricks(
+  const ExtendedOctree &tree, const UINT64VECTOR4& vBrickCoords,
+  std::array<ChildBrick, 8>& children) const
+{
+  const UINT64VECTOR4 bricksInLowerLevel = tree.GetBrickCount(vBrickCoords.w-1);
+  const bool bHasBrickRight  = vBrickCoords.x*2+1 < bricksInLowerLevel.x;
+  const bool bHasBrickBottom = vBrickCoords.y*2+1 < bricksInLowerLevel.y;
+  const bool bHasBrickBack   = vBrickCoords.z*2+1 < bricksInLowerLevel.z;
+
+  const UINT64VECTOR3 splitPos(
+    uint64_t(ceil((tree.m_iBrickSize.x-2*m_iOverlap)/2.0)),
+    uint64_t(ceil((tree.m_iBrickSize.y-2*m_iOverlap)/2.0)),
+    uint64_t(ceil((tree.m_iBrickSize.z-2*m_iOverlap)/2.0))
+  );
+
+  const bool bHas[8] = {
+    true, bHasBrickRight, bHasBrickBottom, bHasBrickBack,
+    bHasBrickRight && bHasBrickBottom, bHasBrickRight && bHasBrickBack,
+    bHasBrickBottom && bHasBrickBack,
+    bHasBrickRight && bHasBrickBottom && bHasBrickBack
+  };
+  const UINT64VECTOR3 step[8] = {
+    UINT64VECTOR3(0,0,0), UINT64VECTOR3(1,0,0), UINT64VECTOR3(0,1,0),
+    UINT64VECTOR3(0,0,1), UINT64VECTOR3(1,1,0), UINT64VECTOR3(1,0,1),
+    UINT64VECTOR3(0,1,1), UINT64VECTOR3(1,1,1)
+  };
+
+  size_t n = 0;
+  for (size_t c = 0;c<8;c++) {
+    if (!bHas[c]) continue;
+    children[n].coords = UINT64VECTOR4(vBrickCoords.x*2+step[c].x,
+                                       vBrickCoords.y*2+step[c].y,
+                                       vBrickCoords.z*2+step[c].z,
+                                       vBrickCoords.w-1);
+    children[n].targetOffset = UINT64VECTOR3(splitPos.x*step[c].x,
+                                             splitPos.y*step[c].y,
+                                             splitPos.z*step[c].z);
+    ++n;
+  }
+  return n;
+}
+
+/*
+  AppendBrickToC:
+
+  New bricks are uncompressed and go right behind the last brick in the file
+*/
+void ExtendedOctreeConverter::AppendBrickToC(ExtendedOctree &tree,
+                                             const UINT64VECTOR4& vBrickCoords) {
+  const uint64_t iUncompressedBrickSize =
+    tree.ComputeBrickSize(vBrickCoords).volume() *
+    tree.GetComponentTypeSize() *
+    tree.GetComponentCount();
+
+  const TOCEntry t = {
+    (tree.m_vTOC.end()-1)->m_iLength + (tree.m_vTOC.end()-1)->m_iOffset,
+    iUncompressedBrickSize, CT_NONE, iUncompressedBrickSize,
+    UINTVECTOR2(0,0)
+  };
+  tree.m_vTOC.push_back(t);
+}
+
+/*
+  FetchChildBricks:
+
+  Reads all children of a brick through the cache
+*/
+void ExtendedOctreeConverter::FetchChildBricks(ExtendedOctree &tree,
+                                               const UINT64VECTOR4& vBrickCoords,
+                                               uint8_t* pChildData) {
+  const size_t iMaxBrickSize = size_t(tree.m_iBrickSize.volume() *
+                                      tree.GetComponentTypeSize() *
+                                      tree.GetComponentCount());
+  std::array<ChildBrick, 8> children;
+  const size_t iChildCount = ChildBricks(tree, vBrickCoords, children);
+  for (size_t c = 0;c<iChildCount;c++) {
+    GetBrick(pChildData + c*iMaxBrickSize, tree, children[c].coords);
+  }
+}
+
 /*
   SetupCache:
 
@@ -902,7 +1043,8 @@ void ExtendedOctreeConverter::SetupCache(ExtendedOctree &tree) {
   size_t CacheElementDataSize = size_t(tree.GetComponentTypeSize() * 
                                 tree.GetComponentCount() * 
                                 tree.m_iBrickSize.volume());
-  uint64_t iCacheElemCount = m_iMemLimit / (CacheElementDataSize + sizeof(CacheEntry));
+  uint64_t iCacheElemCount = (m_iMemLimit - StagingBudget()) /
+                             (CacheElementDataSize + sizeof(CacheEntry));
   iCacheElemCount = std::min(iCacheElemCount, tree.ComputeBrickCount());
   m_vBrickCache.resize(size_t(iCacheElemCount));
 
@@ -27,6 +27,8 @@
 #ifndef EXTENDEDOCTREECONVERTER_H
 #define EXTENDEDOCTREECONVERTER_H
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <functional>
 #include "ExtendedOctree.h"
@@ -148,6 +150,15 @@ public:
   */
   float GetProgress() const {return m_fProgress;}
 
+  /**
+    Sets the number of threads used for downsampling and compression.
+    Defaults to the number of OpenMP threads; 1 disables the parallel paths.
+    The output is the same regardless of this setting.
+  */
+  void SetWorkerCount(uint32_t iWorkerCount) {
+    m_iWorkerCount = std::max<uint32_t>(1, iWorkerCount);
+  }
+
 
   /**
    Exports a specific LoD Level into a continuous raw file
@@ -379,6 +390,9 @@ private:
   /// max amount of memory in bytes to be used by the cache
   uint64_t m_iMemLimit;
 
+  /// number of threads for downsampling and compression
+  uint32_t m_iWorkerCount;
+
   /// desired compression method for new bricks, may be ignored by the system
   /// e.g. when a compressed brick would be larger than the uncompressed
   COMPRESSION_TYPE m_eCompression;
@@ -414,6 +428,36 @@ private:
     ExtendedOctree& tree, uint64_t iIndex,
     std::shared_ptr<uint8_t> const pBuffer = nullptr);
 
+  /**
+    Compresses one brick with the current compression method, safe to call
+    from several threads at once
+
+    @param tree the octree the brick belongs to
+    @param pData the uncompressed brick
+    @param iLength size of the uncompressed brick in bytes
+    @param pCompressed receives the compressed data, may alias pData
+    @return the number of bytes in the compressed data
+  */
+  uint64_t CompressBrick(const ExtendedOctree& tree,
+                         std::shared_ptr<uint8_t> pData, uint64_t iLength,
+                         std::shared_ptr<uint8_t>& pCompressed) const;
+
+  /**
+    Memory (in bytes) set aside from m_iMemLimit for the bricks that are
+    processed in parallel during the hierarchy computation, the rest goes to
+    the brick cache. Zero if we run single threaded.
+  */
+  uint64_t StagingBudget() const;
+
+  /**
+    Number of bricks to process in one parallel wave
+
+    @param iBytesPerBrick memory needed for one brick in flight
+    @param iBudget memory available to all bricks in flight
+    @return at least one, at most a few bricks per worker
+  */
+  size_t BricksInFlight(uint64_t iBytesPerBrick, uint64_t iBudget) const;
+
   /**
     Copies the outer voxels into the border to implement clamp to border
 
@@ -596,27 +640,64 @@ private:
     @param sourceCoords brick coordinates of the source brick
     @param targetOffset coordinates were to place the down-sampled data in the target brick
   */
-  template<class T, bool bComputeMedian> void DownsampleBricktoBrick(ExtendedOctree &tree, T* pData,
+  template<class T, bool bComputeMedian> void DownsampleBricktoBrick(const ExtendedOctree &tree, T* pData,
                                                 const UINT64VECTOR3& targetSize,
-                                                T* pSourceData,
+                                                const T* pSourceData,
                                                 const UINT64VECTOR4& sourceCoords,
                                                 const UINT64VECTOR3& targetOffset);
 
+  /// a brick of the next finer LoD and where it goes in its parent brick
+  struct ChildBrick {
+    UINT64VECTOR4 coords;
+    UINT64VECTOR3 targetOffset;
+  };
+
+  /**
+    Lists the (up to eight) bricks of LoD w-1 that are downsampled into a brick
+
+    @param tree target extended octree
+    @param vBrickCoords brick coordinates of the target brick
+    @param children receives the child bricks
+    @return the number of valid entries in children
+  */
+  size_t ChildBricks(const ExtendedOctree &tree,
+                     const UINT64VECTOR4& vBrickCoords,
+                     std::array<ChildBrick, 8>& children) const;
+
+  /**
+    Appends the ToC entry of a new (uncompressed) brick to the end of the tree
+
+    @param tree target extended octree
+    @param vBrickCoords brick coordinates of the new brick
+  */
+  void AppendBrickToC(ExtendedOctree &tree, const UINT64VECTOR4& vBrickCoords);
+
+  /**
+    Reads the child bricks of a brick through the cache, child c is stored
+    at c times the maximum brick size
+
+    @param tree target extended octree
+    @param vBrickCoords brick coordinates of the target brick
+    @param pChildData room for eight bricks of maximum size
+  */
+  void FetchChildBricks(ExtendedOctree &tree,
+                        const UINT64VECTOR4& vBrickCoords,
+                        uint8_t* pChildData);
+
   /**
     This function down-samples up to eight bricks into a single brick.
-    to avoid new/delete calls this function takes two points to two
-    arrays of sufficient size to hold the largest bricks
+    The child bricks must already be loaded (see FetchChildBricks), the
+    function touches no shared state and may run concurrently for
+    different bricks.
 
     @param tree target extended octree
-    @param bClampToEdge use outer values to fill border (uses zeroes otherwise)
     @param vBrickCoords brick coordinates of the target brick of the downsampling
-    @param pData pointer to hold the temp data during the downsampling process
-    @param pSourceData pointer to hold the temp data during the downsampling process
+    @param pData pointer to hold the downsampled brick
+    @param pChildData the child bricks as loaded by FetchChildBricks
   */
-  template<class T, bool bComputeMedian> void DownsampleBrick(ExtendedOctree &tree,
-                                         bool bClampToEdge,
+  template<class T, bool bComputeMedian> void DownsampleBrick(const ExtendedOctree &tree,
                                          const UINT64VECTOR4& vBrickCoords,
-                                         T* pData, T* pSourceData);
+                                         T* pData, const T* pChildData);
 
   /**
     This function computes all the LoD levels on
@@ -1,5 +1,6 @@
 #include "Histogram1DDataBlock.h"
 
+#include "HistogramEngine.h"
 #include "RasterDataBlock.h"
 #include "../../Basics/MathTools.h"
 #include "../../Controller/Controller.h"
@@ -58,106 +59,7 @@ uint64_t Histogram1DDataBlock::GetHeaderFromFile(LargeRAWFile_ptr pStreamFile, u
 }
 
 bool Histogram1DDataBlock::Compute(const TOCBlock* source, uint64_t iLevel) {
-  // do not try to compute a histogram for floating point data,
-  // anything beyond 32 bit or more than 1 component data
-  if (source->GetComponentType() == ExtendedOctree::CT_FLOAT32 ||
-      source->GetComponentType() == ExtendedOctree::CT_FLOAT64 ||
-      source->GetComponentTypeSize() > 4 ||
-      source->GetComponentCount() != 1) return false;
-
-  // resize histogram 
-  size_t iValueRange = size_t(MathTools::Pow2(uint64_t(source->GetComponentTypeSize()*8)));
-  m_vHistData.resize(iValueRange);
-  if (m_vHistData.size() != iValueRange) return false;
-  std::fill(m_vHistData.begin(), m_vHistData.end(), 0);
-
-  // compute histogram
-  switch (source->GetComponentType()) {
-    case ExtendedOctree::CT_UINT8:
-      ComputeTemplate<uint8_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_UINT16:
-      ComputeTemplate<uint16_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_UINT32:
-      ComputeTemplate<uint32_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_UINT64:
-      ComputeTemplate<uint64_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_INT8:
-      ComputeTemplate<int8_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_INT16:
-      ComputeTemplate<int16_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_INT32:
-      ComputeTemplate<int32_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_INT64:
-      ComputeTemplate<int64_t>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_FLOAT32:
-      ComputeTemplate<float>(source, iLevel);
-      break;
-    case ExtendedOctree::CT_FLOAT64:
-      ComputeTemplate<double>(source, iLevel);
-      break;
-  }
-
-
-  // find maximum-index non zero entry and clip histogram data
-  size_t iSize = 0;
-  for (size_t i = 0;i<iValueRange;i++) if (m_vHistData[i] != 0) iSize = i+1;
-  m_vHistData.resize(iSize);
-
-  // set data block information
-  strBlockID = "1D Histogram for datablock " + source->strBlockID;
-
-  return true;
-}
-
-template <class T> 
-void Histogram1DDataBlock::ComputeTemplate(const TOCBlock* source,
-                                           uint64_t iLevel) {
-  // compute histogram by iterating over all bricks of the given level
-  UINT64VECTOR3 bricksInSourceLevel = source->GetBrickCount(iLevel);
-
-  size_t iCompcount = size_t(source->GetComponentCount());
-  T* pTempBrickData = new T[size_t(source->GetMaxBrickSize().volume())
-                            *iCompcount];
-
-  uint32_t iOverlap =source->GetOverlap();
-
-  ProgressTimer timer;
-  timer.Start();
-
-  for (uint64_t bz = 0;bz<bricksInSourceLevel.z;bz++) {
-    for (uint64_t by = 0;by<bricksInSourceLevel.y;by++) {
-      for (uint64_t bx = 0;bx<bricksInSourceLevel.x;bx++) {
-        UINT64VECTOR4 brickCoords(bx,by,bz,iLevel);
-        source->GetData((uint8_t*)pTempBrickData, brickCoords);
-        UINTVECTOR3 bricksize = UINTVECTOR3(source->GetBrickSize(brickCoords));
-
-        for (uint32_t z = iOverlap;z<bricksize.z-iOverlap;z++) {
-          for (uint32_t y = iOverlap;y<bricksize.y-iOverlap;y++) {
-            for (uint32_t x = iOverlap;x<bricksize.x-iOverlap;x++) {
-              // TODO: think about what todo with multi component data
-              //       right now we only pick the first component
-              size_t val = size_t(pTempBrickData[iCompcount*(x+y*bricksize.x+z*bricksize.x*bricksize.y)]);
-              m_vHistData[val]++;
-            }
-          }
-        }
-      }
-    }
-
-    float progress = float(bz)/float(bricksInSourceLevel.z);
-    MESSAGE("Computing 1D Histogram %5.2f%% (%s)", 
-            progress * 100.0f,
-            timer.GetProgressMessage(progress).c_str());
-  }
-  delete [] pTempBrickData;
+  return HistogramEngine(source, iLevel).Compute(this, NULL);
 }
 
 
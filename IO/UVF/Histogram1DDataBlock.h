@@ -38,7 +38,6 @@ protected:
 
   virtual DataBlock* Clone() const;
 
-  template <class T> void ComputeTemplate(const TOCBlock* source,
-                                          uint64_t iLevel);
+  friend class HistogramEngine;
 };
 #endif // UVF_HISTOGRAM1DDATABLOCK_H
@@ -1,5 +1,6 @@
 #include "Histogram2DDataBlock.h"
 #include "Basics/Vectors.h"
+#include "HistogramEngine.h"
 #include "RasterDataBlock.h"
 #include "TOCBlock.h"
 #include "../../Controller/Controller.h"
@@ -70,60 +71,8 @@ bool Histogram2DDataBlock::Compute(const TOCBlock* source,
                                    uint64_t iLevel,
                                    size_t iHistoBinCount,
                                    double fMaxNonZeroValue) {
-  // do not try to compute a histogram for floating point data,
-  // anything beyond 32 bit or more than 1 component data
-  if (source->GetComponentType() == ExtendedOctree::CT_FLOAT32 ||
-    source->GetComponentType() == ExtendedOctree::CT_FLOAT64 ||
-    source->GetComponentTypeSize() > 4 ||
-    source->GetComponentCount() != 1) return false;
-
-  // resize histogram 
-  m_vHistData.resize(iHistoBinCount);
-  for (size_t i = 0;i<iHistoBinCount;i++) {
-    m_vHistData[i].resize(256);
-    for (size_t j = 0;j<256;j++) {
-      m_vHistData[i][j] = 0;
-    }
-  }
-
-  // compute histogram
-  switch (source->GetComponentType()) {
-  case ExtendedOctree::CT_UINT8:
-    ComputeTemplate<uint8_t>(source, double(std::numeric_limits<uint8_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_UINT16:
-    ComputeTemplate<uint16_t>(source, double(std::numeric_limits<uint16_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_UINT32:
-    ComputeTemplate<uint32_t>(source, double(std::numeric_limits<uint32_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_UINT64:
-    ComputeTemplate<uint64_t>(source, double(std::numeric_limits<uint64_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_INT8:
-    ComputeTemplate<int8_t>(source, double(std::numeric_limits<int8_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_INT16:
-    ComputeTemplate<int16_t>(source, double(std::numeric_limits<int16_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_INT32:
-    ComputeTemplate<int32_t>(source, double(std::numeric_limits<int32_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_INT64:
-    ComputeTemplate<int64_t>(source, double(std::numeric_limits<int64_t>::max()), iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_FLOAT32:
-    ComputeTemplate<float>(source, 1.0, iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  case ExtendedOctree::CT_FLOAT64:
-    ComputeTemplate<double>(source, 1.0, iLevel, iHistoBinCount, fMaxNonZeroValue);
-    break;
-  }
-
-  // set data block information
-  strBlockID = "2D Histogram for datablock " + source->strBlockID;
-
-  return true;
+  return HistogramEngine(source, iLevel).Compute(NULL, this, iHistoBinCount,
+                                                 fMaxNonZeroValue);
 }
 
 
@@ -322,135 +271,6 @@ bool Histogram2DDataBlock::Compute(
   return true;
 }
 
-template <class T>
-FUNC_PURE
-DOUBLEVECTOR3 Histogram2DDataBlock::ComputeGradient(const T* pTempBrickData,
-                              double normalizationFactor, size_t iCompcount,
-                              const UINTVECTOR3& size,
-                              const UINTVECTOR3& coords)
-{
-  // TODO: think about what todo with multi component data
-  //       right now we only pick the first component
-  size_t iCenter = size_t(coords.x+size.x*coords.y+size.x*size.y*coords.z);
-  size_t iLeft   = iCenter-1;
-  size_t iRight  = iCenter+1;
-  size_t iTop    = iCenter-size_t(size.x);
-  size_t iBottom = iCenter+size_t(size.x);
-  size_t iFront  = iCenter-size_t(size.x)*size_t(size.y);
-  size_t iBack   = iCenter+size_t(size.x)*size_t(size.y);
-
-  DOUBLEVECTOR3 vGradient((double(pTempBrickData[iCompcount*iLeft]) -double(pTempBrickData[iCompcount*iRight])) /(normalizationFactor*2),
-                          (double(pTempBrickData[iCompcount*iTop])  -double(pTempBrickData[iCompcount*iBottom]))/(normalizationFactor*2),
-                          (double(pTempBrickData[iCompcount*iFront])-double(pTempBrickData[iCompcount*iBack]))  /(normalizationFactor*2));
-  return vGradient;
-}
-
-template <class T>
-void Histogram2DDataBlock::ComputeTemplate(const TOCBlock* source, double normalizationFactor,
-                      uint64_t iLevel, size_t iHistoBinCount,
-                      double fMaxNonZeroValue) {
-  // compute histogram by iterating over all bricks of the given level
-  UINT64VECTOR3 bricksInSourceLevel = source->GetBrickCount(iLevel);
-
-  size_t iCompcount = size_t(source->GetComponentCount());
-  T* pTempBrickData = new T[size_t(source->GetMaxBrickSize().volume()) *
-                            iCompcount];
-
-  uint32_t iOverlap =source->GetOverlap();
-  double fMaxGradMagnitude = 0;
-
-  ProgressTimer timer;
-  timer.Start();
-
-  // find the maximum gradient magnitude
-  for (uint64_t bz = 0;bz<bricksInSourceLevel.z;bz++) {
-    for (uint64_t by = 0;by<bricksInSourceLevel.y;by++) {
-      for (uint64_t bx = 0;bx<bricksInSourceLevel.x;bx++) {
-
-        UINT64VECTOR4 brickCoords(bx,by,bz,iLevel);
-        source->GetData((uint8_t*)pTempBrickData, brickCoords);
-        UINTVECTOR3 bricksize = UINTVECTOR3(source->GetBrickSize(brickCoords));
-
-#ifdef _MSC_VER
-# pragma omp parallel for shared(fMaxGradMagnitude)
-        for (int32_t z = iOverlap;uint32_t(z)<bricksize.z-iOverlap;z++) {
-#else
-# pragma omp parallel for collapse(3) shared(fMaxGradMagnitude)
-        for (uint32_t z = iOverlap;z<bricksize.z-iOverlap;z++) {
-#endif
-          for (uint32_t y = iOverlap;y<bricksize.y-iOverlap;y++) {
-            for (uint32_t x = iOverlap;x<bricksize.x-iOverlap;x++) {
-              DOUBLEVECTOR3 vGradient = ComputeGradient(
-                pTempBrickData, normalizationFactor, iCompcount, bricksize,
-                UINTVECTOR3(x,y,z)
-              );
-
-              #pragma omp flush(fMaxGradMagnitude)
-              if(vGradient.length() > fMaxGradMagnitude)
-              #pragma omp critical
-              { if(vGradient.length() > fMaxGradMagnitude) {
-                  fMaxGradMagnitude = vGradient.length();
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-    float progress = 0.5f*float(bz)/float(bricksInSourceLevel.z);
-    MESSAGE("Computing 2D Histogram %5.2f%% (%s)", 
-            progress * 100.0f,
-            timer.GetProgressMessage(progress).c_str());
-  }
-
-  // fill the histogram the maximum gradient magnitude
-  for (uint64_t bz = 0;bz<bricksInSourceLevel.z;bz++) {
-    for (uint64_t by = 0;by<bricksInSourceLevel.y;by++) {
-      for (uint64_t bx = 0;bx<bricksInSourceLevel.x;bx++) {
-
-        UINT64VECTOR4 brickCoords(bx,by,bz,iLevel);
-        source->GetData((uint8_t*)pTempBrickData, brickCoords);
-        UINTVECTOR3 bricksize = UINTVECTOR3(source->GetBrickSize(brickCoords));
-        #pragma omp parallel for firstprivate(fMaxGradMagnitude)
-#ifdef _MSC_VER
-        for (int32_t z = iOverlap;uint32_t(z)<bricksize.z-iOverlap;z++) {
-#else
-        for (uint32_t z = iOverlap;z<bricksize.z-iOverlap;z++) {
-#endif
-          for (uint32_t y = iOverlap;y<bricksize.y-iOverlap;y++) {
-            for (uint32_t x = iOverlap;x<bricksize.x-iOverlap;x++) {
-              const DOUBLEVECTOR3 vGradient = ComputeGradient(
-                pTempBrickData, normalizationFactor, iCompcount, bricksize,
-                UINTVECTOR3(x,y,z)
-              );
-
-              size_t iCenter = size_t(x+bricksize.x*y+bricksize.x*bricksize.y*z);
-              size_t iGradientMagnitudeIndex = std::min<size_t>(255,size_t(vGradient.length()/fMaxGradMagnitude*255.0f));
-              size_t iValue = (fMaxNonZeroValue <= double(iHistoBinCount-1)) 
-                                  ? size_t(pTempBrickData[iCenter]) 
-                                  : size_t(double(pTempBrickData[iCenter]) * double(iHistoBinCount-1)/fMaxNonZeroValue);
-              // make sure round errors don't cause index to go out of bounds
-              if (iGradientMagnitudeIndex > 255) iGradientMagnitudeIndex = 255;
-              if (iValue > iHistoBinCount-1) iValue = iHistoBinCount-1; 
-              #pragma omp atomic
-              m_vHistData[iValue][iGradientMagnitudeIndex]++;
-            }
-          }
-        }
-      }
-    }
-    float progress = 0.5f+0.5f*float(bz)/float(bricksInSourceLevel.z);
-    MESSAGE("Computing 2D Histogram %5.2f%% (%s)", 
-            progress * 100.0f,
-            timer.GetProgressMessage(progress).c_str());
-  }
-  m_fMaxGradMagnitude = float(fMaxGradMagnitude);
-
-  delete [] pTempBrickData;
-}
-
-
-
 void Histogram2DDataBlock::CopyHeaderToFile(LargeRAWFile_ptr pStreamFile, uint64_t iOffset, bool bIsBigEndian, bool bIsLastBlock) {
   DataBlock::CopyHeaderToFile(pStreamFile, iOffset, bIsBigEndian, bIsLastBlock);
 
@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+#include "HistogramEngine.h"
+#include "Histogram1DDataBlock.h"
+#include "Histogram2DDataBlock.h"
+#include "../../Controller/Controller.h"
+#include "../../Basics/ProgressTimer.h"
+
+using namespace std;
+
+namespace {
+  // each thread holds a complete fine 2D histogram, and merging them takes
+  // one more; they get up to 16 fine bins per output bin, as far as this
+  // budget allows.  Large value ranges and many threads get fewer (but at
+  // least two) fine bins, and so a coarser gradient axis.
+  const uint64_t FINE_BUDGET = uint64_t(32) << 20; // bytes, for all threads
+  const size_t MAX_FINE_FACTOR = 16;
+  // larger value ranges share one 1D histogram between all threads
+  const uint64_t MAX_PRIVATE_1D = uint64_t(1) << 16;
+
+  struct ThreadBins {
+    std::vector<uint64_t> hist1D;
+    /// value bin major, 'fine' gradient bins per value bin covering
+    /// [0, bound); bound is 0 as long as all gradients were 0
+    std::vector<uint64_t> hist2D;
+    double bound;
+    double minValue;
+    double maxValue;
+    double maxGradient;
+  };
+
+  // doubles the bound of the fine bins by merging neighbouring pairs; a
+  // gradient in bin i before is in bin i/2 afterwards, so this is exact.
+  void Coarsen(std::vector<uint64_t>& hist, size_t fine) {
+    for (size_t row = 0; row < hist.size(); row += fine) {
+      uint64_t* h = &hist[row];
+      for (size_t i = 0; i < fine/2; ++i) h[i] = h[2*i] + h[2*i+1];
+      std::fill(h + fine/2, h + fine, uint64_t(0));
+    }
+  }
+
+  int ThreadCount() {
+#ifdef _OPENMP
+    return std::max(1, omp_get_max_threads());
+#else
+    return 1;
+#endif
+  }
+
+  int ThreadIndex() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+  }
+}
+
+HistogramEngine::HistogramEngine(const TOCBlock* source, uint64_t iLevel) :
+  m_pSource(source),
+  m_iLevel(iLevel),
+  m_fMinValue(0),
+  m_fMaxValue(0),
+  m_fMaxGradient(0)
+{
+}
+
+bool HistogramEngine::IsSupported(const TOCBlock* source) {
+  // do not try to compute a histogram for floating point data,
+  // anything beyond 32 bit or more than 1 component data
+  return source->GetComponentType() != ExtendedOctree::CT_FLOAT32 &&
+         source->GetComponentType() != ExtendedOctree::CT_FLOAT64 &&
+         source->GetComponentTypeSize() <= 4 &&
+         source->GetComponentCount() == 1;
+}
+
+bool HistogramEngine::Compute(Histogram1DDataBlock* pHist1D,
+                              Histogram2DDataBlock* pHist2D,
+                              size_t iHistoBinCount,
+                              double fMaxNonZeroValue) {
+  if (!IsSupported(m_pSource)) return false;
+  if (pHist2D && iHistoBinCount == 0) return false;
+
+  const bool b1D = pHist1D != NULL;
+  const bool b2D = pHist2D != NULL;
+  switch (m_pSource->GetComponentType()) {
+    case ExtendedOctree::CT_UINT8:
+      ComputeTemplate<uint8_t>(double(std::numeric_limits<uint8_t>::max()),
+                               b1D, b2D, iHistoBinCount, fMaxNonZeroValue);
+      break;
+    case ExtendedOctree::CT_UINT16:
+      ComputeTemplate<uint16_t>(double(std::numeric_limits<uint16_t>::max()),
+                                b1D, b2D, iHistoBinCount, fMaxNonZeroValue);
+      break;
+    case ExtendedOctree::CT_UINT32:
+      ComputeTemplate<uint32_t>(double(std::numeric_limits<uint32_t>::max()),
+                                b1D, b2D, iHistoBinCount, fMaxNonZeroValue);
+      break;
+    case ExtendedOctree::CT_INT8:
+      ComputeTemplate<int8_t>(double(std::numeric_limits<int8_t>::max()),
+                              b1D, b2D, iHistoBinCount, fMaxNonZeroValue);
+      break;
+    case ExtendedOctree::CT_INT16:
+      ComputeTemplate<int16_t>(double(std::numeric_limits<int16_t>::max()),
+                               b1D, b2D, iHistoBinCount, fMaxNonZeroValue);
+      break;
+    case ExtendedOctree::CT_INT32:
+      ComputeTemplate<int32_t>(double(std::numeric_limits<int32_t>::max()),
+                               b1D, b2D, iHistoBinCount, fMaxNonZeroValue);
+      break;
+    default:
+      return false;
+  }
+
+  if (pHist1D) {
+    pHist1D->m_vHistData.swap(m_vHist1D);
+    pHist1D->strBlockID = "1D Histogram for datablock " +
+                          m_pSource->strBlockID;
+  }
+  if (pHist2D) {
+    pHist2D->m_vHistData.swap(m_vHist2D);
+    pHist2D->m_fMaxGradMagnitude = float(m_fMaxGradient);
+    pHist2D->strBlockID = "2D Histogram for datablock " +
+                          m_pSource->strBlockID;
+  }
+  return true;
+}
+
+template <class T>
+void HistogramEngine::ComputeTemplate(double normalizationFactor,
+                                      bool b1D, bool b2D,
+                                      size_t iHistoBinCount,
+                                      double fMaxNonZeroValue) {
+  const UINT64VECTOR3 bricksInSourceLevel = m_pSource->GetBrickCount(m_iLevel);
+  const uint32_t iOverlap = m_pSource->GetOverlap();
+  const uint64_t iValueRange = uint64_t(1) << (8*sizeof(T));
+  const bool bShared1D = iValueRange > MAX_PRIVATE_1D;
+  // signed values are shifted so that the type's minimum goes to bin 0
+  const int64_t iMinValue = int64_t(std::numeric_limits<T>::min());
+  const double fMaxBiased = fMaxNonZeroValue - double(iMinValue);
+  const bool bRawValues = fMaxBiased <= double(iHistoBinCount-1);
+
+  const int iThreads = ThreadCount();
+  size_t fine = 2;
+  if (b2D) {
+    while (fine < 256*MAX_FINE_FACTOR &&
+           uint64_t(iHistoBinCount) * fine * 2 * sizeof(uint64_t) <=
+             FINE_BUDGET / uint64_t(iThreads+1))
+      fine *= 2;
+  }
+
+  std::vector<ThreadBins> bins(iThreads);
+  for (auto b = bins.begin(); b != bins.end(); ++b) {
+    if (b1D && !bShared1D) b->hist1D.resize(size_t(iValueRange), 0);
+    if (b2D) b->hist2D.resize(iHistoBinCount * fine, 0);
+    b->bound = 0;
+    b->minValue = std::numeric_limits<double>::max();
+    b->maxValue = -std::numeric_limits<double>::max();
+    b->maxGradient = 0;
+  }
+  std::vector<uint64_t> shared1D;
+  if (b1D && bShared1D) shared1D.resize(size_t(iValueRange), 0);
+
+  std::vector<T> vBrick(size_t(m_pSource->GetMaxBrickSize().volume()));
+
+  ProgressTimer timer;
+  timer.Start();
+
+  for (uint64_t bz = 0;bz<bricksInSourceLevel.z;bz++) {
+    for (uint64_t by = 0;by<bricksInSourceLevel.y;by++) {
+      // have the next row of bricks read while we work on this one
+      {
+        uint64_t ny = by+1, nz = bz;
+        if (ny == bricksInSourceLevel.y) { ny = 0; ++nz; }
+        if (nz < bricksInSourceLevel.z) {
+          std::vector<UINT64VECTOR4> next;
+          for (uint64_t bx = 0;bx<bricksInSourceLevel.x;bx++)
+            next.push_back(UINT64VECTOR4(bx,ny,nz,m_iLevel));
+          m_pSource->Prefetch(next);
+        }
+      }
+
+      for (uint64_t bx = 0;bx<bricksInSourceLevel.x;bx++) {
+        const UINT64VECTOR4 brickCoords(bx,by,bz,m_iLevel);
+        m_pSource->GetData((uint8_t*)&vBrick[0], brickCoords);
+        const UINTVECTOR3 size = UINTVECTOR3(m_pSource->GetBrickSize(brickCoords));
+        const size_t sx = size_t(size.x);
+        const size_t sxy = size_t(size.x)*size_t(size.y);
+        const T* pData = &vBrick[0];
+
+#       pragma omp parallel num_threads(iThreads)
+        {
+          ThreadBins& b = bins[ThreadIndex()];
+#         pragma omp for schedule(static)
+          for (int64_t z = iOverlap; z < int64_t(size.z)-int64_t(iOverlap); z++) {
+            for (uint32_t y = iOverlap;y<size.y-iOverlap;y++) {
+              for (uint32_t x = iOverlap;x<size.x-iOverlap;x++) {
+                const size_t iCenter = x + y*sx + size_t(z)*sxy;
+                const T value = pData[iCenter];
+                const double fValue = double(value);
+                if (fValue < b.minValue) b.minValue = fValue;
+                if (fValue > b.maxValue) b.maxValue = fValue;
+
+                const size_t iBiased = size_t(int64_t(value) - iMinValue);
+                if (b1D) {
+                  if (bShared1D) {
+#                   pragma omp atomic
+                    shared1D[iBiased]++;
+                  } else {
+                    b.hist1D[iBiased]++;
+                  }
+                }
+                if (!b2D) continue;
+
+                // central differences; one-sided at the border of a brick
+                // without overlap
+                const size_t iLeft   = x > 0 ? iCenter-1 : iCenter;
+                const size_t iRight  = x+1 < size.x ? iCenter+1 : iCenter;
+                const size_t iTop    = y > 0 ? iCenter-sx : iCenter;
+                const size_t iBottom = y+1 < size.y ? iCenter+sx : iCenter;
+                const size_t iFront  = z > 0 ? iCenter-sxy : iCenter;
+                const size_t iBack   = size_t(z)+1 < size.z ? iCenter+sxy : iCenter;
+                const double gx = (double(pData[iLeft]) -double(pData[iRight])) /(normalizationFactor*2);
+                const double gy = (double(pData[iTop])  -double(pData[iBottom]))/(normalizationFactor*2);
+                const double gz = (double(pData[iFront])-double(pData[iBack]))  /(normalizationFactor*2);
+                const double g = std::sqrt(gx*gx + gy*gy + gz*gz);
+
+                if (g > b.maxGradient) b.maxGradient = g;
+                while (g >= b.bound && g > 0) {
+                  if (b.bound == 0) {
+                    // smallest power of two above g; everything counted so
+                    // far sits in bin 0, which stays bin 0.
+                    int e;
+                    std::frexp(g, &e);
+                    b.bound = std::ldexp(1.0, e);
+                  } else {
+                    Coarsen(b.hist2D, fine);
+                    b.bound *= 2;
+                  }
+                }
+                const size_t iFine = (g > 0) ? std::min(fine-1,
+                                        size_t(g / b.bound * double(fine)))
+                                             : 0;
+
+                size_t iValue = bRawValues
+                  ? iBiased
+                  : size_t(double(iBiased) * double(iHistoBinCount-1)/fMaxBiased);
+                // make sure round errors don't cause index to go out of bounds
+                if (iValue > iHistoBinCount-1) iValue = iHistoBinCount-1;
+                b.hist2D[iValue*fine + iFine]++;
+              }
+            }
+          }
+        }
+      }
+    }
+
+    float progress = float(bz)/float(bricksInSourceLevel.z);
+    MESSAGE("Computing histograms %5.2f%% (%s)",
+            progress * 100.0f,
+            timer.GetProgressMessage(progress).c_str());
+  }
+
+  // merge the threads' results
+  m_fMinValue = std::numeric_limits<double>::max();
+  m_fMaxValue = -std::numeric_limits<double>::max();
+  m_fMaxGradient = 0;
+  double fBound = 0;
+  for (auto b = bins.cbegin(); b != bins.cend(); ++b) {
+    m_fMinValue = std::min(m_fMinValue, b->minValue);
+    m_fMaxValue = std::max(m_fMaxValue, b->maxValue);
+    m_fMaxGradient = std::max(m_fMaxGradient, b->maxGradient);
+    fBound = std::max(fBound, b->bound);
+  }
+
+  if (b1D) {
+    if (bShared1D) {
+      m_vHist1D.swap(shared1D);
+    } else {
+      m_vHist1D.assign(size_t(iValueRange), 0);
+      for (auto b = bins.begin(); b != bins.end(); ++b) {
+        for (size_t i = 0; i < m_vHist1D.size(); ++i) m_vHist1D[i] += b->hist1D[i];
+        std::vector<uint64_t>().swap(b->hist1D);
+      }
+    }
+    // find maximum-index non zero entry and clip histogram data
+    size_t iSize = 0;
+    for (size_t i = 0;i<m_vHist1D.size();i++) if (m_vHist1D[i] != 0) iSize = i+1;
+    m_vHist1D.resize(iSize);
+  }
+
+  if (b2D) {
+    std::vector<uint64_t> total(iHistoBinCount * fine, 0);
+    for (auto b = bins.begin(); b != bins.end(); ++b) {
+      // a thread which only saw zero gradients has everything in bin 0
+      for (double bound = b->bound; bound > 0 && bound < fBound; bound *= 2)
+        Coarsen(b->hist2D, fine);
+      for (size_t i = 0; i < total.size(); ++i) total[i] += b->hist2D[i];
+      std::vector<uint64_t>().swap(b->hist2D);
+    }
+
+    // each fine bin goes where its centre belongs on the 256 bin axis up to
+    // the largest gradient.
+    const double w = fBound / double(fine);
+    m_vHist2D.assign(iHistoBinCount, std::vector<uint64_t>(256, 0));
+    for (size_t v = 0; v < iHistoBinCount; ++v) {
+      const uint64_t* row = &total[v*fine];
+      for (size_t f = 0; f < fine; ++f) {
+        if (row[f] == 0) continue;
+        const size_t iOut = (m_fMaxGradient > 0)
+          ? std::min<size_t>(255, size_t((double(f)+0.5) * w /
+                                         m_fMaxGradient * 255.0))
+          : 0;
+        m_vHist2D[v][iOut] += row[f];
+      }
+    }
+  }
+}
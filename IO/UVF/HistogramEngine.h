@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef UVF_HISTOGRAMENGINE_H
+#define UVF_HISTOGRAMENGINE_H
+
+#include <vector>
+#include "TOCBlock.h"
+
+class Histogram1DDataBlock;
+class Histogram2DDataBlock;
+
+/// Computes the histograms of one level of a TOCBlock in a single sweep:
+/// every brick is fetched once, and the 1D histogram, the value range and
+/// the gradient statistics are gathered together into per-thread bins which
+/// are merged at the end.
+///
+/// The gradient axis of the 2D histogram depends on the maximum gradient
+/// magnitude, which is only known after all bricks were seen.  Instead of a
+/// separate pass to find it, gradients are first put into fine bins relative
+/// to a power-of-two bound.  When a larger gradient comes along, the bound
+/// doubles and neighbouring fine bins are merged, which is exact.  At the
+/// end, each fine bin goes to the output bin of its centre, relative to the
+/// true maximum gradient.  A voxel whose gradient lies within one fine bin
+/// of an output bin boundary may therefore land in the neighbouring bin.
+///
+/// Signed values are biased by the type's minimum, so bin 0 holds the
+/// smallest representable value, as for unsigned data.
+class HistogramEngine
+{
+public:
+  HistogramEngine(const TOCBlock* source, uint64_t iLevel);
+
+  /// @param pHist1D receives the 1D histogram (trimmed after the last
+  ///        non-zero bin); may be NULL
+  /// @param pHist2D receives the 2D histogram; may be NULL
+  /// @param iHistoBinCount number of value bins of the 2D histogram
+  /// @param fMaxNonZeroValue largest value in the data; (biased) values are
+  ///        scaled into the bins if they do not fit directly
+  /// @return false if the data type is not supported (floating point, more
+  ///         than 32 bit, more than one component)
+  bool Compute(Histogram1DDataBlock* pHist1D, Histogram2DDataBlock* pHist2D,
+               size_t iHistoBinCount = 0, double fMaxNonZeroValue = 0);
+
+  /// value range and largest gradient magnitude seen by the last Compute
+  ///@{
+  double GetMinValue() const { return m_fMinValue; }
+  double GetMaxValue() const { return m_fMaxValue; }
+  double GetMaxGradient() const { return m_fMaxGradient; }
+  ///@}
+
+  static bool IsSupported(const TOCBlock* source);
+
+private:
+  template <class T>
+  void ComputeTemplate(double normalizationFactor, bool b1D, bool b2D,
+                       size_t iHistoBinCount, double fMaxNonZeroValue);
+
+  const TOCBlock* m_pSource;
+  uint64_t m_iLevel;
+
+  std::vector<uint64_t> m_vHist1D;
+  std::vector<std::vector<uint64_t>> m_vHist2D;
+  double m_fMinValue;
+  double m_fMaxValue;
+  double m_fMaxGradient;
+};
+#endif // UVF_HISTOGRAMENGINE_H
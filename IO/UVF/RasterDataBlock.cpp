@@ -1,6 +1,8 @@
 #include <cmath>
+#include <limits>
 #include <numeric>
 #include <sstream>
+#include <type_traits>
 
 #include "RasterDataBlock.h"
 #include "MaxMinDataBlock.h"
@@ -771,6 +773,266 @@ RasterDataBlock::GetLocalDataPointerOffset(const vector<uint64_t>& vLOD,
   return GetLocalDataPointerOffset(iLODIndex,iBrickIndex);
 }
 
+namespace {
+  /// Reduces one row of target elements.  pIn points to the first source
+  /// element of the row's footprint, row and slice strides are in elements.
+  typedef void (*RowKernel)(const void* pIn, uint64_t iSourceRow,
+                            uint64_t iSourceSlice,
+                            const UINT64VECTOR3& vReduction,
+                            uint64_t iTargetCount, void* pOut);
+
+  /// Accumulation for the average kernels.  Integers of up to 32 bits are
+  /// summed exactly in Acc; integer division truncates just like the double
+  /// division of CombineAverage does, so the results are identical.
+  /// Everything else is summed in double in the same order as
+  /// CombineAverage<T> (bScaleEach == false) or CombineAverage<T, n>
+  /// (bScaleEach == true), which divides every sample before summing.
+  template<class T, bool bScaleEach, class Acc = int64_t,
+           bool bExact = std::numeric_limits<T>::is_integer && sizeof(T) <= 4>
+  struct Average {
+    typedef Acc Accumulator;
+    static Acc Add(Acc a, T v, double) { return a + Acc(v); }
+    static T Finish(Acc a, uint64_t n) { return T(a / Acc(n)); }
+  };
+  template<class T, bool bScaleEach, class Acc>
+  struct Average<T, bScaleEach, Acc, false> {
+    typedef double Accumulator;
+    static double Add(double a, T v, double n) {
+      return bScaleEach ? a + double(v) / n : a + double(v);
+    }
+    static T Finish(double a, uint64_t n) {
+      return bScaleEach ? T(a) : T(a / double(n));
+    }
+  };
+
+  /// 8 samples of at most 16 bits fit comfortably into 32 bits
+  template<class T> struct SmallAcc {
+    typedef typename std::conditional<sizeof(T) <= 2, int32_t,
+                                      int64_t>::type type;
+  };
+
+  template<class T, size_t iVecLength, class Op>
+  void AverageRow(const void* pIn, uint64_t iSourceRow,
+                  uint64_t iSourceSlice, const UINT64VECTOR3& vReduction,
+                  uint64_t iTargetCount, void* pOut) {
+    const T* pDataIn = static_cast<const T*>(pIn);
+    T* pDataOut = static_cast<T*>(pOut);
+    const uint64_t n = vReduction.volume();
+
+    for (uint64_t x = 0;x<iTargetCount;x++) {
+      for (size_t v = 0;v<iVecLength;v++) {
+        typename Op::Accumulator acc = 0;
+        for (uint64_t dz = 0;dz<vReduction.z;dz++)
+          for (uint64_t dy = 0;dy<vReduction.y;dy++)
+            for (uint64_t dx = 0;dx<vReduction.x;dx++)
+              acc = Op::Add(acc, pDataIn[size_t((dz*iSourceSlice +
+                                                 dy*iSourceRow +
+                                                 x*vReduction.x + dx) *
+                                                iVecLength + v)],
+                            double(n));
+        pDataOut[size_t(x*iVecLength+v)] = Op::Finish(acc, n);
+      }
+    }
+  }
+
+  /// AverageRow for the common 2x2x2 reduction: the footprint is four
+  /// source rows and the loop over the row has no data dependent control
+  /// flow, so the compiler can vectorize it.
+  template<class T, size_t iVecLength, class Op>
+  void AverageRow2x2x2(const void* pIn, uint64_t iSourceRow,
+                       uint64_t iSourceSlice, const UINT64VECTOR3&,
+                       uint64_t iTargetCount, void* pOut) {
+    const T* a = static_cast<const T*>(pIn);
+    const T* b = a + size_t(iSourceRow*iVecLength);
+    const T* c = a + size_t(iSourceSlice*iVecLength);
+    const T* d = c + size_t(iSourceRow*iVecLength);
+    T* pDataOut = static_cast<T*>(pOut);
+    const size_t n = size_t(iTargetCount);
+
+    for (size_t x = 0;x<n;x++) {
+      for (size_t v = 0;v<iVecLength;v++) {
+        const size_t s0 = 2*x*iVecLength + v;
+        const size_t s1 = s0 + iVecLength;
+        typename Op::Accumulator acc = 0;
+        acc = Op::Add(acc, a[s0], 8.0); acc = Op::Add(acc, a[s1], 8.0);
+        acc = Op::Add(acc, b[s0], 8.0); acc = Op::Add(acc, b[s1], 8.0);
+        acc = Op::Add(acc, c[s0], 8.0); acc = Op::Add(acc, c[s1], 8.0);
+        acc = Op::Add(acc, d[s0], 8.0); acc = Op::Add(acc, d[s1], 8.0);
+        pDataOut[x*iVecLength+v] = Op::Finish(acc, 8);
+      }
+    }
+  }
+
+  template<class T, size_t iVecLength, bool bScaleEach>
+  RowKernel AverageKernel(const UINT64VECTOR3& vReduction) {
+    if (vReduction == UINT64VECTOR3(2,2,2))
+      return &AverageRow2x2x2<T, iVecLength,
+                  Average<T, bScaleEach, typename SmallAcc<T>::type> >;
+    return &AverageRow<T, iVecLength, Average<T, bScaleEach> >;
+  }
+
+  /// Finds the kernel which computes the given reduction, if any.  The
+  /// scalar CombineAverage sums before it divides, the vector one divides
+  /// every sample.
+  template<class T, size_t iVecLength>
+  RowKernel FindRowKernel(LODReduction eReduction,
+                          const UINT64VECTOR3& vReduction) {
+    if (eReduction != LR_AVERAGE) return NULL;
+    return AverageKernel<T, iVecLength, (iVecLength > 1)>(vReduction);
+  }
+
+  template<class T>
+  RowKernel FindRowKernel(LODReduction eReduction, uint64_t iVecLength,
+                          const UINT64VECTOR3& vReduction) {
+    switch (iVecLength) {
+      case 1: return FindRowKernel<T,1>(eReduction, vReduction);
+      case 2: return FindRowKernel<T,2>(eReduction, vReduction);
+      case 3: return FindRowKernel<T,3>(eReduction, vReduction);
+      case 4: return FindRowKernel<T,4>(eReduction, vReduction);
+      default: return NULL;
+    }
+  }
+}
+
+/**
+ * SubSample for domains of up to three (non-trivial) dimensions with a
+ * built-in reduction.  Instead of one combine function call per target
+ * element, it reads all source slices
+ * that contribute to a target slice in one go and reduces them row by row
+ * with a kernel specialized for the element type.
+ * \return false if the request needs the generic path
+ */
+bool RasterDataBlock::SubSampleSlices(LargeRAWFile_ptr pSourceFile,
+                                      LargeRAWFile_ptr pTargetFile,
+                                      const vector<uint64_t>& sourceSize,
+                                      const vector<uint64_t>& targetSize,
+                                      LODReduction eReduction,
+                                      AbstrDebugOut* pDebugOut,
+                                      uint64_t iLODLevel,
+                                      uint64_t iMaxLODLevel)
+{
+  if (sourceSize.empty() || sourceSize.size() != targetSize.size()) {
+    return false;
+  }
+  UINT64VECTOR3 vSourceSize(1,1,1);
+  UINT64VECTOR3 vTargetSize(1,1,1);
+  for (size_t i = 0;i<sourceSize.size();i++) {
+    if (i < 3) {
+      (&vSourceSize.x)[i] = sourceSize[i];
+      (&vTargetSize.x)[i] = targetSize[i];
+    } else if (sourceSize[i] != 1) {
+      return false;
+    }
+  }
+  if (vTargetSize.volume() == 0) return false;
+  const UINT64VECTOR3 vReduction = vSourceSize / vTargetSize;
+
+  // all components need to be of the same type
+  if (ulElementDimension != 1 || ulElementBitSize.empty() ||
+      ulElementBitSize[0].empty()) {
+    return false;
+  }
+  const uint64_t iBitSize = ulElementBitSize[0][0];
+  const uint64_t iMantissa = ulElementMantissa[0][0];
+  const bool bSigned = bSignedElement[0][0];
+  for (size_t i = 1;i<ulElementBitSize[0].size();i++) {
+    if (ulElementBitSize[0][i] != iBitSize ||
+        ulElementMantissa[0][i] != iMantissa ||
+        bSignedElement[0][i] != bSigned) {
+      return false;
+    }
+  }
+  // integers store bits or bits-1 (signed) as mantissa
+  const bool bFloat = iMantissa+1 < iBitSize;
+  const uint64_t iVecLength = ulElementDimensionSize[0];
+
+  RowKernel kernel = NULL;
+  switch (iBitSize) {
+    case 8:
+      kernel = bSigned ? FindRowKernel<int8_t>(eReduction, iVecLength,
+                                               vReduction)
+                       : FindRowKernel<uint8_t>(eReduction, iVecLength,
+                                                vReduction);
+      break;
+    case 16:
+      kernel = bSigned ? FindRowKernel<int16_t>(eReduction, iVecLength,
+                                                vReduction)
+                       : FindRowKernel<uint16_t>(eReduction, iVecLength,
+                                                 vReduction);
+      break;
+    case 32:
+      if (bFloat)
+        kernel = FindRowKernel<float>(eReduction, iVecLength, vReduction);
+      else
+        kernel = bSigned ? FindRowKernel<int32_t>(eReduction, iVecLength,
+                                                  vReduction)
+                         : FindRowKernel<uint32_t>(eReduction, iVecLength,
+                                                   vReduction);
+      break;
+    case 64:
+      if (bFloat)
+        kernel = FindRowKernel<double>(eReduction, iVecLength, vReduction);
+      else
+        kernel = bSigned ? FindRowKernel<int64_t>(eReduction, iVecLength,
+                                                  vReduction)
+                         : FindRowKernel<uint64_t>(eReduction, iVecLength,
+                                                   vReduction);
+      break;
+  }
+  if (!kernel) return false;
+
+  const uint64_t iElementSize = ComputeElementSize()/8;
+  const uint64_t iSourceSlice = vSourceSize.x*vSourceSize.y;
+  const uint64_t iTargetSlice = vTargetSize.x*vTargetSize.y;
+  const uint64_t iSourceBytes = iSourceSlice*vReduction.z*iElementSize;
+  const uint64_t iTargetBytes = iTargetSlice*iElementSize;
+
+  // When subsampling in place, target slice z ends before source slab z+1
+  // starts, and slab z is in memory before slice z is written.
+  vector<unsigned char> vSourceData(static_cast<size_t>(iSourceBytes));
+  vector<unsigned char> vTargetData(static_cast<size_t>(iTargetBytes));
+
+  for (uint64_t z = 0;z<vTargetSize.z;z++) {
+    if (pDebugOut) {
+      pDebugOut->Message(_func_, "Generating data for lod level %i of %i:"
+                         "%6.2f%% completed", int(iLODLevel+1),
+                         int(iMaxLODLevel),
+                         (100.0f*z)/float(vTargetSize.z));
+    }
+
+    const uint64_t iSourcePos = z*iSourceBytes;
+    if (z+1 < vTargetSize.z) {
+      pSourceFile->Hint(LargeRAWFile::WILLNEED, iSourcePos+iSourceBytes,
+                        iSourceBytes);
+    }
+    pSourceFile->SeekPos(iSourcePos);
+    if (pSourceFile->ReadRAW(&vSourceData[0], iSourceBytes) != iSourceBytes) {
+      if (pDebugOut) {
+        pDebugOut->Error(_func_, "short read from '%s'",
+                         pSourceFile->GetFilename().c_str());
+      }
+    }
+
+    const int64_t iRows = int64_t(vTargetSize.y);
+#pragma omp parallel for schedule(static)
+    for (int64_t y = 0;y<iRows;y++) {
+      kernel(&vSourceData[size_t(uint64_t(y)*vReduction.y*vSourceSize.x *
+                                 iElementSize)],
+             vSourceSize.x, iSourceSlice, vReduction, vTargetSize.x,
+             &vTargetData[size_t(uint64_t(y)*vTargetSize.x*iElementSize)]);
+    }
+
+    pTargetFile->SeekPos(z*iTargetBytes);
+    if (pTargetFile->WriteRAW(&vTargetData[0], iTargetBytes) != iTargetBytes) {
+      if (pDebugOut) {
+        pDebugOut->Error(_func_, "short write to '%s'",
+                         pTargetFile->GetFilename().c_str());
+      }
+    }
+  }
+  return true;
+}
+
 void RasterDataBlock::SubSample(LargeRAWFile_ptr pSourceFile,
                                 LargeRAWFile_ptr pTargetFile,
                                 std::vector<uint64_t> sourceSize,
@@ -781,8 +1043,13 @@ void RasterDataBlock::SubSample(LargeRAWFile_ptr pSourceFile,
                                   const void* pIn, void* pOut
                                 ),
                                 AbstrDebugOut* pDebugOut, uint64_t iLODLevel,
-                                uint64_t iMaxLODLevel)
+                                uint64_t iMaxLODLevel, LODReduction eReduction)
 {
+  if (SubSampleSlices(pSourceFile, pTargetFile, sourceSize, targetSize,
+                      eReduction, pDebugOut, iLODLevel, iMaxLODLevel)) {
+    return;
+  }
+
   pSourceFile->SeekStart();
   pTargetFile->SeekStart();
 
@@ -888,7 +1155,7 @@ void RasterDataBlock::SubSample(LargeRAWFile_ptr pSourceFile,
     for (size_t j = 1;j<sourceSize.size();j++) {
       if (vSourcePos[j-1]+vReduction[j-1] > sourceSize[j-1]) {
         vSourcePos[j-1] = 0;
-        vSourcePos[j] += vReduction[j-1];
+        vSourcePos[j] += vReduction[j];
       }
       iSourcePos += vPrefixProd[j-1] * vSourcePos[j-1];
     }
@@ -923,6 +1190,7 @@ void RasterDataBlock::AllocateTemp(const string& strTempFile, bool bBuildOffsetT
  * \param strTempFile - filename of a temp files during the conversion
  * \param combineFunc - the function used to compute the LOD, this is mostly an
  *                      average function
+ * \param eReduction - what combineFunc computes, see LODReduction
  * \return void
  * \see FlatDataToBrickedLOD
  */
@@ -933,7 +1201,7 @@ bool RasterDataBlock::FlatDataToBrickedLOD(
   void (*maxminFunc)(const void* pIn, size_t iStart, size_t iCount,
                      std::vector<DOUBLEVECTOR4>& fMinMax),
   std::shared_ptr<MaxMinDataBlock> pMaxMinDatBlock,
-  AbstrDebugOut* pDebugOut)
+  AbstrDebugOut* pDebugOut, LODReduction eReduction)
 {
   // size of input data
   uint64_t iInPointerSize = ComputeElementSize()/8;
@@ -951,7 +1219,8 @@ bool RasterDataBlock::FlatDataToBrickedLOD(
   // convert the flat file to our bricked LOD representation
   bool bResult = FlatDataToBrickedLOD(
     std::shared_ptr<LargeRAWFile>(&pSourceFile, nonstd::null_deleter()),
-    strTempFile, combineFunc, maxminFunc, pMaxMinDatBlock, pDebugOut
+    strTempFile, combineFunc, maxminFunc, pMaxMinDatBlock, pDebugOut,
+    eReduction
   );
 
   // delete tempfile
@@ -980,6 +1249,7 @@ vector<uint64_t> RasterDataBlock::GetLODDomainSize(const vector<uint64_t>& vLOD)
  * \param strTempFile - filename of a temp files during the conversion
  * \param combineFunc - the function used to compute the LOD, this is mostly an
  *                      average function
+ * \param eReduction - what combineFunc computes, see LODReduction
  * \return void
  * \see FlatDataToBrickedLOD
  */
@@ -991,7 +1261,7 @@ RasterDataBlock::FlatDataToBrickedLOD(
   void (*maxminFunc)(const void* pIn, size_t iStart, size_t iCount,
                      std::vector<DOUBLEVECTOR4>& fMinMax),
   std::shared_ptr<MaxMinDataBlock> pMaxMinDatBlock,
-  AbstrDebugOut* pDebugOut)
+  AbstrDebugOut* pDebugOut, LODReduction eReduction)
 {
 
   // parameter sanity checks
@@ -1040,7 +1310,7 @@ RasterDataBlock::FlatDataToBrickedLOD(
       if (i > 1) {
         SubSample(tempFile, tempFile, vLastReducedDomainSize,
                   vReducedDomainSize, combineFunc, pDebugOut, i,
-                  vLODCombis.size());
+                  vLODCombis.size(), eReduction);
       } else {
         tempFile = LargeRAWFile_ptr(new LargeRAWFile(SysTools::AppendFilename(strTempFile,"2")));
         if (!tempFile->Create(ComputeDataSize())) {
@@ -1048,7 +1318,7 @@ RasterDataBlock::FlatDataToBrickedLOD(
           return false;
         }
         SubSample(pSourceData, tempFile, ulDomainSize, vReducedDomainSize,
-                  combineFunc, pDebugOut, i, vLODCombis.size());
+                  combineFunc, pDebugOut, i, vLODCombis.size(), eReduction);
       }
       pBrickSource = tempFile;
       vLastReducedDomainSize = vReducedDomainSize;
@@ -1201,37 +1471,47 @@ RasterDataBlock::GetBrickByteSize(const std::vector<uint64_t>& vLOD,
 }
 
 LargeRAWFile_ptr
-RasterDataBlock::SeekToBrick(const std::vector<uint64_t>& vLOD,
-                             const std::vector<uint64_t>& vBrick) const
+RasterDataBlock::LocateBrick(const std::vector<uint64_t>& vLOD,
+                             const std::vector<uint64_t>& vBrick,
+                             uint64_t& iOffset) const
 {
   if (m_pTempFile == LargeRAWFile_ptr() && 
       m_pStreamFile == LargeRAWFile_ptr()) return LargeRAWFile_ptr();
   if (m_vLODOffsets.empty()) { return LargeRAWFile_ptr(); }
 
-  LargeRAWFile_ptr  pStreamFile;
-  uint64_t iOffset = GetLocalDataPointerOffset(vLOD, vBrick)/8;
+  iOffset = GetLocalDataPointerOffset(vLOD, vBrick)/8;
 
   if (m_pStreamFile) {
     // add global offset
     iOffset += m_iOffset;
     // add size of header
     iOffset += DataBlock::GetOffsetToNextBlock() + ComputeHeaderSize();
-    pStreamFile = m_pStreamFile;
-  } else {
-    pStreamFile = m_pTempFile;
+    return m_pStreamFile;
   }
-  pStreamFile->SeekPos(iOffset);
+  return m_pTempFile;
+}
+
+LargeRAWFile_ptr
+RasterDataBlock::SeekToBrick(const std::vector<uint64_t>& vLOD,
+                             const std::vector<uint64_t>& vBrick) const
+{
+  uint64_t iOffset = 0;
+  LargeRAWFile_ptr pStreamFile = LocateBrick(vLOD, vBrick, iOffset);
+  if (pStreamFile) pStreamFile->SeekPos(iOffset);
   return pStreamFile;
 }
 
+/// Reads positionally and leaves the file pointer alone, so any number of
+/// threads may fetch bricks at once.
 bool RasterDataBlock::GetData(uint8_t* vData, size_t bytes,
                               const std::vector<uint64_t>& vLOD,
                               const std::vector<uint64_t>& vBrick) const
 {
-  LargeRAWFile_ptr pStreamFile = SeekToBrick(vLOD, vBrick);
+  uint64_t iOffset = 0;
+  LargeRAWFile_ptr pStreamFile = LocateBrick(vLOD, vBrick, iOffset);
   if(!pStreamFile) { return false; }
 
-  pStreamFile->ReadRAW(vData, bytes);
+  pStreamFile->ReadRAWAt(vData, bytes, iOffset);
   return true;
 }
 
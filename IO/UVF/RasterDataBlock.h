@@ -76,6 +76,13 @@ void CombineAverage(const std::vector<uint64_t>& vSource, uint64_t iTarget,
     pDataOut[v+iTarget*iVecLength] = T(temp[v]);
 }
 
+/// What the combine function handed to SubSample computes.  For the built-in
+/// reductions SubSample may use a faster kernel with the same result.
+enum LODReduction {
+  LR_CUSTOM,  ///< anything else: combineFunc is called per target element
+  LR_AVERAGE  ///< CombineAverage<T> for scalars, CombineAverage<T,n> else
+};
+
 class Histogram1DDataBlock;
 class Histogram2DDataBlock;
 class MaxMinDataBlock;
@@ -131,6 +138,8 @@ public:
   void SetTypeToUInt32(UVFTables::ElementSemanticTable semantic);
   void SetTypeToUInt64(UVFTables::ElementSemanticTable semantic);
 
+  /// Reads one brick.  These do not move the file pointer, so several threads
+  /// may read from the same block at once (but not while it is written).
   bool GetData(std::vector<uint8_t>& vData,
                const std::vector<uint64_t>& vLOD,
                const std::vector<uint64_t>& vBrick) const;
@@ -214,7 +223,8 @@ public:
                        std::vector<DOUBLEVECTOR4>& fMinMax),
     std::shared_ptr<MaxMinDataBlock> pMaxMinDatBlock =
       std::shared_ptr<MaxMinDataBlock>(),
-    AbstrDebugOut* pDebugOut=NULL
+    AbstrDebugOut* pDebugOut=NULL,
+    LODReduction eReduction=LR_CUSTOM
   );
   bool FlatDataToBrickedLOD(
     LargeRAWFile_ptr pSourceData, const std::string& strTempFile,
@@ -224,7 +234,8 @@ public:
                        std::vector<DOUBLEVECTOR4>& fMinMax),
     std::shared_ptr<MaxMinDataBlock> pMaxMinDatBlock =
       std::shared_ptr<MaxMinDataBlock>(),
-    AbstrDebugOut* pDebugOut=NULL
+    AbstrDebugOut* pDebugOut=NULL,
+    LODReduction eReduction=LR_CUSTOM
   );
 
   void AllocateTemp(const std::string& strTempFile,
@@ -291,7 +302,16 @@ protected:
                                      uint64_t iTarget, const void* pIn,
                                      void* pOut),
                  AbstrDebugOut* pDebugOut=NULL, uint64_t iLODLevel=0,
-                 uint64_t iMaxLODLevel=0);
+                 uint64_t iMaxLODLevel=0, LODReduction eReduction=LR_CUSTOM);
+  /// slice-wise SubSample for up to 3D domains with a built-in reduction;
+  /// returns false if it cannot handle the request
+  bool SubSampleSlices(LargeRAWFile_ptr pSourceFile,
+                       LargeRAWFile_ptr pTargetFile,
+                       const std::vector<uint64_t>& sourceSize,
+                       const std::vector<uint64_t>& targetSize,
+                       LODReduction eReduction,
+                       AbstrDebugOut* pDebugOut, uint64_t iLODLevel,
+                       uint64_t iMaxLODLevel);
 
   uint64_t ComputeDataSizeAndOffsetTables();
   uint64_t GetLODSizeAndOffsetTables(std::vector<uint64_t>& vLODIndices,
@@ -351,6 +371,10 @@ protected:
                          const std::vector<uint64_t>& vPrefixProd,
                          const std::vector<uint64_t>& vBrickPrefixProduct) const;
 private:
+  /// @returns the file holding the brick, and its position in there
+  LargeRAWFile_ptr LocateBrick(const std::vector<uint64_t>& vLOD,
+                               const std::vector<uint64_t>& vBrick,
+                               uint64_t& iOffset) const;
   LargeRAWFile_ptr SeekToBrick(const std::vector<uint64_t>& vLOD,
                             const std::vector<uint64_t>& vBrick) const;
   bool GetData(unsigned char*, size_t bytes,
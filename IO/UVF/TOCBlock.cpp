@@ -103,6 +103,24 @@ uint64_t TOCBlock::ComputeDataSize() const {
   return m_ExtendedOctree.GetSize();
 }
 
+vector<pair<uint64_t, uint64_t>> TOCBlock::GetParts() const {
+  // one part per brick
+  const uint64_t iOctree = DataBlock::GetOffsetToNextBlock() +
+                           ComputeHeaderSize();
+  vector<pair<uint64_t, uint64_t>> vParts(m_ExtendedOctree.GetBrickToCSize());
+  for (size_t i = 0; i < vParts.size(); ++i) {
+    const TOCEntry& toc = m_ExtendedOctree.GetBrickToCData(i);
+    vParts[i] = make_pair(iOctree + toc.m_iOffset,
+                          iOctree + toc.m_iOffset + toc.m_iLength);
+  }
+  return vParts;
+}
+
+bool TOCBlock::SetChecksums(std::shared_ptr<const BlockChecksums> pChecksums) {
+  m_ExtendedOctree.SetChecksums(pChecksums);
+  return true;
+}
+
 bool TOCBlock::FlatDataToBrickedLOD(
   const std::string& strSourceFile, const std::string& strTempFile,
   ExtendedOctree::COMPONENT_TYPE eType, uint64_t iComponentCount,
@@ -234,6 +252,15 @@ void TOCBlock::GetData(uint8_t* pData, UINT64VECTOR4 coordinates) const {
   m_ExtendedOctree.GetBrickData(pData, coordinates);
 }
 
+bool TOCBlock::GetData(const std::vector<uint8_t*>& vpData,
+                       const std::vector<UINT64VECTOR4>& coordinates) const {
+  return m_ExtendedOctree.GetBrickDataBatch(coordinates, vpData);
+}
+
+void TOCBlock::Prefetch(const std::vector<UINT64VECTOR4>& coordinates) const {
+  m_ExtendedOctree.Prefetch(coordinates);
+}
+
 UINT64VECTOR3 TOCBlock::GetBrickCount(uint64_t iLoD) const {
   return m_ExtendedOctree.GetBrickCount(iLoD);
 }
@@ -79,7 +79,14 @@ public:
                      uint32_t iOverlap=0,
                      AbstrDebugOut* pDebugOut=NULL) const;
 
+  /// reads (and expands) one brick; safe to call from several threads
   void GetData(uint8_t* pData, UINT64VECTOR4 coordinates) const;
+  /// reads several bricks at once, in file order and concurrently;
+  /// @return false if one of them could not be read
+  bool GetData(const std::vector<uint8_t*>& vpData,
+               const std::vector<UINT64VECTOR4>& coordinates) const;
+  /// starts reading the given bricks in the background, see GetData
+  void Prefetch(const std::vector<UINT64VECTOR4>& coordinates) const;
 
   uint64_t GetLoDCount() const;
   UINT64VECTOR3 GetBrickCount(uint64_t iLoD) const;
@@ -124,6 +131,8 @@ protected:
   virtual uint64_t CopyToFile(LargeRAWFile_ptr pStreamFile, uint64_t iOffset,
                               bool bIsBigEndian, bool bIsLastBlock);
   virtual uint64_t GetOffsetToNextBlock() const;
+  virtual std::vector<std::pair<uint64_t, uint64_t>> GetParts() const;
+  virtual bool SetChecksums(std::shared_ptr<const BlockChecksums> pChecksums);
   virtual DataBlock* Clone() const;
 
   friend class UVF;
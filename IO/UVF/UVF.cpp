@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <sstream>
 #include "UVF.h"
+#include "BlockChecksums.h"
 #include "Basics/Checksums/crc32.h"
 #include "Basics/Checksums/MD5.h"
 #include "Basics/nonstd.h"
@@ -17,7 +19,8 @@ UVF::UVF(std::wstring wstrFilename) :
   m_bFileIsLoaded(false),
   m_bFileIsReadWrite(false),
   m_streamFile(new LargeRAWFile(wstrFilename)),
-  m_iAccumOffsets(0)
+  m_iAccumOffsets(0),
+  m_bBlocksChecked(false)
 {
 
 }
@@ -88,6 +91,10 @@ bool UVF::Open(bool bMustBeSameVersion, bool bVerify, bool bReadWrite, std::stri
       return false;
     }
     ParseDataBlocks();
+    if (bVerify && !VerifyDataBlocks(pstrProblem)) {
+      Close();
+      return false;
+    }
     return true;
   } else {
     Close(); // file is not a UVF file or checksum is invalid
@@ -100,13 +107,25 @@ void UVF::Close() {
     if (m_bFileIsReadWrite) {
       bool dirty = false;
       for (size_t i = 0;i<m_DataBlocks.size();i++) {
+        const uint64_t iOffset = m_DataBlocks[i]->m_iOffsetInFile +
+                                 m_GlobalHeader.GetDataPos();
         if (m_DataBlocks[i]->m_bHeaderIsDirty) {
           m_DataBlocks[i]->m_block->CopyHeaderToFile(
             m_streamFile,
-            m_DataBlocks[i]->m_iOffsetInFile+m_GlobalHeader.GetDataPos(),
+            iOffset,
             m_GlobalHeader.bIsBigEndian,
             i == m_DataBlocks.size()-1
           );
+          // everything up to the first part counts as header, e.g. a TOC
+          // block changes the octree header in place
+          uint64_t iHeaderEnd = m_streamFile->GetPos();
+          vector<pair<uint64_t, uint64_t>> vParts =
+            m_DataBlocks[i]->m_block->GetParts();
+          if (!vParts.empty()) {
+            iHeaderEnd = max(iHeaderEnd, iOffset +
+                             min_element(vParts.begin(), vParts.end())->first);
+          }
+          m_vChangedRanges.push_back(make_pair(iOffset, iHeaderEnd));
           dirty = true;
         } 
         if (m_DataBlocks[i]->m_bIsDirty) {
@@ -117,16 +136,18 @@ void UVF::Close() {
           // Note by Alex: This assert will always fail for the last block where GetBlockSize() is defined to be zero!
           //assert(m_DataBlocks[i]->m_block->GetOffsetToNextBlock() == m_DataBlocks[i]->GetBlockSize());
 
-          m_DataBlocks[i]->m_block->CopyToFile(
+          const uint64_t iSize = m_DataBlocks[i]->m_block->CopyToFile(
             m_streamFile,
-            m_DataBlocks[i]->m_iOffsetInFile+m_GlobalHeader.GetDataPos(),
+            iOffset,
             m_GlobalHeader.bIsBigEndian,
             i == m_DataBlocks.size()-1
           );
+          m_vChangedRanges.push_back(make_pair(iOffset, iOffset+iSize));
           dirty = true;
         }
       }
-      if(dirty) {
+      // blocks may also have been appended or dropped
+      if(dirty || !m_vChangedRanges.empty()) {
         UpdateChecksum();
       }
     }
@@ -135,6 +156,9 @@ void UVF::Close() {
   }
 
   m_DataBlocks.clear();
+  m_pChecksums.reset();
+  m_bBlocksChecked = false;
+  m_vChangedRanges.clear();
 }
 
 bool UVF::ParseGlobalHeader(bool bVerify, std::string* pstrProblem) {
@@ -152,10 +176,58 @@ bool UVF::ParseGlobalHeader(bool bVerify, std::string* pstrProblem) {
   }
   
   m_GlobalHeader.GetHeaderFromFile(m_streamFile);
-  
+
+  if (m_GlobalHeader.ulChecksumSemanticsEntry == CS_BLOCKCRC32C) {
+    // Only the table is checked here, the data follow in VerifyDataBlocks.
+    // Without verification a damaged table is simply rebuilt on the next
+    // update.
+    m_pChecksums.reset(new BlockChecksums());
+    string strProblem;
+    if (!m_pChecksums->Parse(m_streamFile, m_GlobalHeader.vcChecksum,
+                             ChecksumBase(m_GlobalHeader), &strProblem) &&
+        bVerify) {
+      if (pstrProblem!=NULL) (*pstrProblem) = strProblem;
+      return false;
+    }
+    return true;
+  }
+
   return !bVerify || VerifyChecksum(m_streamFile, m_GlobalHeader, pstrProblem);
 }
 
+bool UVF::VerifyDataBlocks(std::string* pstrProblem) {
+  if (!m_pChecksums) return true;
+  m_bBlocksChecked = true;
+
+  // blocks which check their parts as they read them are left alone, and so
+  // are segments which span several adjacent parts
+  vector<BlockChecksums::Range> vLazy;
+  for (size_t i = 0;i<m_DataBlocks.size();i++) {
+    DataBlock& block = *m_DataBlocks[i]->m_block;
+    if (!block.SetChecksums(m_pChecksums)) continue;
+    const uint64_t iOffset = m_DataBlocks[i]->m_iOffsetInFile +
+                             m_GlobalHeader.GetDataPos();
+    vector<pair<uint64_t, uint64_t>> vParts = block.GetParts();
+    for (size_t p = 0;p<vParts.size();p++)
+      vLazy.push_back(make_pair(iOffset+vParts[p].first,
+                                iOffset+vParts[p].second));
+  }
+  sort(vLazy.begin(), vLazy.end());
+  vector<BlockChecksums::Range> vMerged;
+  for (size_t i = 0;i<vLazy.size();i++) {
+    if (!vMerged.empty() && vLazy[i].first <= vMerged.back().second)
+      vMerged.back().second = max(vMerged.back().second, vLazy[i].second);
+    else
+      vMerged.push_back(vLazy[i]);
+  }
+
+  return m_pChecksums->VerifyAll(vMerged, pstrProblem);
+}
+
+uint64_t UVF::ChecksumBase(const GlobalHeader& globalHeader) {
+  return 33+globalHeader.vcChecksum.size();
+}
+
 
 vector<unsigned char> UVF::ComputeChecksum(LargeRAWFile_ptr streamFile, ChecksumSemanticTable eChecksumSemanticsEntry) {
   vector<unsigned char> checkSum;
@@ -233,6 +305,13 @@ bool UVF::VerifyChecksum(LargeRAWFile_ptr streamFile, GlobalHeader& globalHeader
   if (globalHeader.ulChecksumSemanticsEntry == CS_NONE)
     return true;
 
+  if (globalHeader.ulChecksumSemanticsEntry == CS_BLOCKCRC32C) {
+    BlockChecksums checksums;
+    return checksums.Parse(streamFile, globalHeader.vcChecksum,
+                           ChecksumBase(globalHeader), pstrProblem) &&
+           checksums.VerifyAll(vector<BlockChecksums::Range>(), pstrProblem);
+  }
+
   vector<unsigned char> vecActualCheckSum = ComputeChecksum(streamFile, globalHeader.ulChecksumSemanticsEntry);
 
   if (vecActualCheckSum.size() != globalHeader.vcChecksum.size()) {
@@ -294,9 +373,62 @@ void UVF::ParseDataBlocks() {
 
 void UVF::UpdateChecksum() {
   if (m_GlobalHeader.ulChecksumSemanticsEntry == CS_NONE) return;
+
+  if (m_GlobalHeader.ulChecksumSemanticsEntry == CS_BLOCKCRC32C) {
+    // only the segments we wrote to are read again
+    if (!m_pChecksums) m_pChecksums.reset(new BlockChecksums());
+    const size_t iCapacity =
+      BlockChecksums::Capacity(m_GlobalHeader.vcChecksum.size());
+    m_pChecksums = m_pChecksums->Update(m_streamFile,
+                                        ChecksumBase(m_GlobalHeader),
+                                        ComputeChecksumBoundaries(),
+                                        m_vChangedRanges, iCapacity);
+    m_vChangedRanges.clear();
+    // the blocks still hold the old table, which no longer fits the file
+    if (m_bBlocksChecked) {
+      for (size_t i = 0;i<m_DataBlocks.size();i++)
+        m_DataBlocks[i]->m_block->SetChecksums(m_pChecksums);
+    }
+    m_GlobalHeader.UpdateChecksum(m_pChecksums->Serialize(iCapacity),
+                                  m_streamFile);
+    return;
+  }
+
+  m_vChangedRanges.clear();
   m_GlobalHeader.UpdateChecksum(ComputeChecksum(m_streamFile, m_GlobalHeader.ulChecksumSemanticsEntry), m_streamFile);
 }
 
+vector<uint64_t> UVF::ComputeChecksumBoundaries() {
+  vector<uint64_t> vBoundaries;
+  for (size_t i = 0;i<m_DataBlocks.size();i++) {
+    const uint64_t iOffset = m_DataBlocks[i]->m_iOffsetInFile +
+                             m_GlobalHeader.GetDataPos();
+    vBoundaries.push_back(iOffset);
+    vector<pair<uint64_t, uint64_t>> vParts =
+      m_DataBlocks[i]->m_block->GetParts();
+    for (size_t p = 0;p<vParts.size();p++) {
+      vBoundaries.push_back(iOffset+vParts[p].first);
+      vBoundaries.push_back(iOffset+vParts[p].second);
+    }
+  }
+  return vBoundaries;
+}
+
+void UVF::ReserveChecksums() {
+  // The table sits in front of the data, so it needs its final size before
+  // anything is written. Growing it moves the data and the base of the
+  // checksums alike, thus the layout is the same with the empty table.
+  m_GlobalHeader.vcChecksum.assign(size_t(BlockChecksums::TableSize(0)), 0);
+  const size_t iSegments = BlockChecksums::Layout(
+    ComputeChecksumBoundaries(), ChecksumBase(m_GlobalHeader),
+    ComputeNewFileSize()
+  ).size();
+  m_GlobalHeader.vcChecksum.assign(size_t(BlockChecksums::TableSize(
+    BlockChecksums::CapacityFor(iSegments)
+  )), 0);
+  m_pChecksums.reset(new BlockChecksums());
+}
+
 bool UVF::SetGlobalHeader(const GlobalHeader& globalHeader) {
   if (m_bFileIsLoaded) return false;
 
@@ -374,6 +506,8 @@ bool UVF::Create() {
     pData[7] = 'A';
     m_streamFile->WriteRAW(pData, 8);
 
+    if (m_GlobalHeader.ulChecksumSemanticsEntry == CS_BLOCKCRC32C)
+      ReserveChecksums();
     m_GlobalHeader.CopyHeaderToFile(m_streamFile);
     
     uint64_t iOffset = m_GlobalHeader.GetDataPos();
@@ -383,6 +517,7 @@ bool UVF::Create() {
                                                 i == m_DataBlocks.size()-1);
         m_DataBlocks[i]->m_bIsDirty = false;
     }
+    m_vChangedRanges.push_back(make_pair(uint64_t(0), iOffset));
 
     return true;
   }else {
@@ -409,8 +544,10 @@ bool UVF::AppendBlockToFile(std::shared_ptr<DataBlock> dataBlock) {
   if (!m_bFileIsReadWrite)  return false;
   
   // add new block to the datablock vector
+  const uint64_t iFileSize = m_streamFile->GetCurrentSize();
   DataBlockListElem* dble = new DataBlockListElem(dataBlock, false,
-                                           m_streamFile->GetCurrentSize(),
+                                           iFileSize -
+                                             m_GlobalHeader.GetDataPos(),
                                            dataBlock->GetOffsetToNextBlock());
   m_DataBlocks.push_back(std::shared_ptr<DataBlockListElem>(dble));
 
@@ -418,8 +555,10 @@ bool UVF::AppendBlockToFile(std::shared_ptr<DataBlock> dataBlock) {
   m_DataBlocks[m_DataBlocks.size()-2]->m_bHeaderIsDirty = true; 
 
   // and the last block needs to written to file
-  dataBlock->CopyToFile(m_streamFile, m_streamFile->GetCurrentSize(),
-                        m_GlobalHeader.bIsBigEndian, true);
+  const uint64_t iSize = dataBlock->CopyToFile(m_streamFile, iFileSize,
+                                               m_GlobalHeader.bIsBigEndian,
+                                               true);
+  m_vChangedRanges.push_back(make_pair(iFileSize, iFileSize+iSize));
 
   return true;
 }
@@ -459,8 +598,14 @@ bool UVF::DropBlockFromFile(size_t iBlockIndex) {
   // truncate file
   m_streamFile->Truncate();
 
-  // remove data from datablock vector
+  // remove data from datablock vector, the blocks behind it moved
+  m_vChangedRanges.push_back(make_pair(
+    m_DataBlocks[iBlockIndex]->m_iOffsetInFile + m_GlobalHeader.GetDataPos(),
+    m_streamFile->GetCurrentSize()
+  ));
   m_DataBlocks.erase(m_DataBlocks.begin()+iBlockIndex);
+  for (size_t i = iBlockIndex;i<m_DataBlocks.size();i++)
+    m_DataBlocks[i]->m_iOffsetInFile -= iShiftSize;
 
   return true;
 }
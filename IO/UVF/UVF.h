@@ -3,11 +3,14 @@
 #define UVF_H
 
 #include <memory>
+#include <utility>
+#include <vector>
 #include "UVFBasic.h"
 
 #include "UVFTables.h"
 #include "GlobalHeader.h"
 class DataBlock;
+class BlockChecksums;
 
 class DataBlockListElem {
   public:
@@ -80,8 +83,17 @@ protected:
   GlobalHeader m_GlobalHeader;
   std::vector<std::shared_ptr<DataBlockListElem>> m_DataBlocks;
 
+  /// CS_BLOCKCRC32C only: checksums of the segments of the file
+  std::shared_ptr<BlockChecksums> m_pChecksums;
+  /// the data blocks were handed m_pChecksums to check their parts on read
+  bool m_bBlocksChecked;
+  /// byte ranges written since the checksum was last updated
+  std::vector<std::pair<uint64_t, uint64_t>> m_vChangedRanges;
+
   bool ParseGlobalHeader(bool bVerify, std::string* pstrProblem = NULL);
   void ParseDataBlocks();
+  /// CS_BLOCKCRC32C only: checks what the data blocks do not check on read
+  bool VerifyDataBlocks(std::string* pstrProblem = NULL);
   static bool VerifyChecksum(LargeRAWFile_ptr streamFile,
                              GlobalHeader& globalHeader,
                              std::string* pstrProblem = NULL);
@@ -91,9 +103,14 @@ protected:
   );
 
   static bool CheckMagic(LargeRAWFile_ptr streamFile);
+  /// where the part of the file covered by the checksum starts
+  static uint64_t ChecksumBase(const GlobalHeader& globalHeader);
 
   // file creation routines
   uint64_t ComputeNewFileSize();
+  /// places where the data blocks split into separately read parts
+  std::vector<uint64_t> ComputeChecksumBoundaries();
+  void ReserveChecksums();
   void UpdateChecksum();
 };
 #endif // UVF_H
@@ -10,12 +10,14 @@ using namespace std;
 #include "MaxMinDataBlock.h"
 #include "GeometryDataBlock.h"
 #include "TOCBlock.h"
+#include "BlockChecksums.h"
 
 string UVFTables::ChecksumSemanticToCharString(ChecksumSemanticTable uiTable) {
   switch (uiTable) {
     case (CS_NONE)  : return "none";
     case (CS_CRC32) : return "CRC32";
     case (CS_MD5)   : return "MD5";
+    case (CS_BLOCKCRC32C) : return "Block CRC32C";
     default         : return "Unknown";
   }
 }
@@ -31,6 +33,8 @@ uint64_t UVFTables::ChecksumElemLength(ChecksumSemanticTable uiTable) {
     case (CS_NONE)  : return 0;
     case (CS_CRC32) : return 32/8;
     case (CS_MD5)   : return 128/8;
+    // sized by UVF::Create, this is an empty table
+    case (CS_BLOCKCRC32C) : return BlockChecksums::TableSize(0);
     default          : throw "ChecksumElemLength: Unknown Checksum type";
   }
 }
@@ -13,6 +13,9 @@ namespace UVFTables {
     CS_NONE = 0,
     CS_CRC32,
     CS_MD5,
+    CS_BLOCKCRC32C, // per segment CRC32C, see BlockChecksums. Older
+                    // readers report a checksum mismatch for it, so the
+                    // converters keep writing CS_MD5 for now.
     CS_UNKNOWN
   };
 
@@ -29,6 +29,7 @@
 
 #include "binary-expression.h"
 #include "constant.h"
+#include "program.h"
 
 namespace tuvok { namespace expression {
 
@@ -63,7 +64,7 @@ void BinaryExpression::Print(std::ostream& os) const {
 }
 
 static bool fp_equal(double a, double b) {
-  return (fabs(a-b) < 0.001);
+  return (fabs(a-b) < fp_tolerance);
 }
 
 double BinaryExpression::Evaluate(size_t i) const {
@@ -83,4 +84,10 @@ double BinaryExpression::Evaluate(size_t i) const {
   return 0.0;
 }
 
+size_t BinaryExpression::Compile(Program& prog) const {
+  const size_t lhs = this->GetChild(0)->Compile(prog);
+  const size_t rhs = this->GetChild(1)->Compile(prog);
+  return prog.EmitBinary(this->oper, lhs, rhs);
+}
+
 }}
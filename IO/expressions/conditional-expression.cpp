@@ -26,6 +26,7 @@
    DEALINGS IN THE SOFTWARE.
 */
 #include "conditional-expression.h"
+#include "program.h"
 
 namespace tuvok { namespace expression {
 
@@ -52,4 +53,13 @@ double ConditionalExpression::Evaluate(size_t idx) const {
   return false_path->Evaluate(idx);
 }
 
+// Both paths are computed for every voxel and then blended; expressions have
+// no side effects, so that is equivalent to branching, and much faster.
+size_t ConditionalExpression::Compile(Program& prog) const {
+  const size_t boolean = this->GetChild(0)->Compile(prog);
+  const size_t true_path = this->GetChild(1)->Compile(prog);
+  const size_t false_path = this->GetChild(2)->Compile(prog);
+  return prog.EmitSelect(boolean, true_path, false_path);
+}
+
 }}
@@ -39,6 +39,7 @@ class ConditionalExpression: public Expression {
     virtual void Print(std::ostream&) const;
 
     virtual double Evaluate(size_t idx) const;
+    virtual size_t Compile(Program&) const;
   private:
 };
 
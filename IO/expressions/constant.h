@@ -43,6 +43,7 @@ class Constant: public Expression {
     virtual void Print(std::ostream&) const;
 
     double Evaluate(size_t) const { return this->value; }
+    size_t Compile(Program&) const;
 
   private:
     double value;
@@ -27,6 +27,7 @@ SOURCES += \
   binary-expression.cpp \
   conditional-expression.cpp \
   constant.cpp          \
+  program.cpp           \
   test.cpp              \
   treenode.cpp          \
   ../IO/VariantArray.cpp \
@@ -30,20 +30,29 @@
 #ifndef TUVOK_EXPRESSION_PARSER_H
 #define TUVOK_EXPRESSION_PARSER_H
 
+#include <memory>
+#include <string>
+
 namespace tuvok { namespace expression {
   class Node;
 }}
 struct YYLTYPE;
 union YYSTYPE;
 
-extern int yyparse(void);
-extern void yyerror(YYLTYPE*, const char*);
-extern int yylex_destroy();
-extern int yylex(YYSTYPE*, YYLTYPE*);
+// The scanner and parser are reentrant: all of their state lives in the
+// opaque 'scanner' handle, and the resulting tree is handed back via 'root'.
+extern int yyparse(void* scanner, tuvok::expression::Node** root);
+extern void yyerror(YYLTYPE*, void* scanner, tuvok::expression::Node** root,
+                    const char*);
+extern int yylex(YYSTYPE*, YYLTYPE*, void* scanner);
+
+namespace tuvok { namespace expression {
 
-tuvok::expression::Node* parser_tree_root();
-void parser_free();
-void parser_set_string(const char*);
-void parser_free_string();
+/// Parses the given expression.  Every call gets its own scanner, so this
+/// may be used from several threads at once.
+/// @returns the AST, or NULL if the expression could not be parsed.
+std::unique_ptr<Node> parse(const std::string& expr);
+
+}}
 
 #endif // TUVOK_EXPRESSION_PARSER_H
@@ -0,0 +1,168 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2010 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+#include "program.h"
+
+namespace tuvok { namespace expression {
+
+const size_t Program::Span;
+
+Program::Program() : registers(0), inputs(0), result(0) { }
+
+Program::Program(const Node& tree) : registers(0), inputs(0), result(0)
+{
+  this->SetResult(tree.Compile(*this));
+}
+
+size_t Program::NewRegister() { return this->registers++; }
+
+size_t Program::EmitVolume(size_t index)
+{
+  for(std::vector<Instruction>::const_iterator i = this->code.begin();
+      i != this->code.end(); ++i) {
+    if(i->code == OP_LOAD && i->a == index) { return i->dst; }
+  }
+  Instruction in;
+  in.code = OP_LOAD;
+  in.op = OP_PLUS;
+  in.dst = this->NewRegister();
+  in.a = index; in.b = in.c = 0;
+  in.value = 0.0;
+  this->code.push_back(in);
+  this->inputs = std::max(this->inputs, index+1);
+  return in.dst;
+}
+
+size_t Program::EmitConstant(double value)
+{
+  for(std::vector<Instruction>::const_iterator i = this->code.begin();
+      i != this->code.end(); ++i) {
+    if(i->code == OP_CONSTANT && i->value == value) { return i->dst; }
+  }
+  Instruction in;
+  in.code = OP_CONSTANT;
+  in.op = OP_PLUS;
+  in.dst = this->NewRegister();
+  in.a = in.b = in.c = 0;
+  in.value = value;
+  this->code.push_back(in);
+  return in.dst;
+}
+
+size_t Program::EmitBinary(enum OpType op, size_t lhs, size_t rhs)
+{
+  double l, r;
+  if(this->IsConstant(lhs, l) && this->IsConstant(rhs, r)) {
+    return this->EmitConstant(Fold(op, l, r));
+  }
+  Instruction in;
+  in.code = OP_BINARY;
+  in.op = op;
+  in.dst = this->NewRegister();
+  in.a = lhs; in.b = rhs; in.c = 0;
+  in.value = 0.0;
+  this->code.push_back(in);
+  return in.dst;
+}
+
+size_t Program::EmitSelect(size_t cond, size_t true_path, size_t false_path)
+{
+  double c;
+  if(this->IsConstant(cond, c)) {
+    return c != 0.0 ? true_path : false_path;
+  }
+  Instruction in;
+  in.code = OP_SELECT;
+  in.op = OP_PLUS;
+  in.dst = this->NewRegister();
+  in.a = cond; in.b = true_path; in.c = false_path;
+  in.value = 0.0;
+  this->code.push_back(in);
+  return in.dst;
+}
+
+void Program::SetResult(size_t reg)
+{
+  assert(reg < this->registers);
+  this->result = reg;
+}
+
+size_t Program::Inputs() const { return this->inputs; }
+size_t Program::Registers() const { return this->registers; }
+
+bool Program::IsConstant(size_t reg, double& value) const
+{
+  for(std::vector<Instruction>::const_iterator i = this->code.begin();
+      i != this->code.end(); ++i) {
+    if(i->dst == reg) {
+      value = i->value;
+      return i->code == OP_CONSTANT;
+    }
+  }
+  return false;
+}
+
+double Program::Fold(enum OpType op, double lhs, double rhs)
+{
+  double d;
+  Apply(op, &d, &lhs, &rhs, 1);
+  return d;
+}
+
+// One loop per operator, so that the compiler sees straight-line code it can
+// vectorize.  Comparisons yield 1.0/0.0, matching BinaryExpression::Evaluate.
+void Program::Apply(enum OpType op, double* d, const double* a,
+                    const double* b, size_t n)
+{
+  switch(op) {
+    case OP_PLUS:
+      for(size_t i=0; i < n; ++i) { d[i] = a[i] + b[i]; }
+      break;
+    case OP_MINUS:
+      for(size_t i=0; i < n; ++i) { d[i] = a[i] - b[i]; }
+      break;
+    case OP_DIVIDE:
+      for(size_t i=0; i < n; ++i) { d[i] = a[i] / b[i]; }
+      break;
+    case OP_MULTIPLY:
+      for(size_t i=0; i < n; ++i) { d[i] = a[i] * b[i]; }
+      break;
+    case OP_GREATER_THAN:
+      for(size_t i=0; i < n; ++i) { d[i] = a[i] > b[i] ? 1.0 : 0.0; }
+      break;
+    case OP_LESS_THAN:
+      for(size_t i=0; i < n; ++i) { d[i] = a[i] < b[i] ? 1.0 : 0.0; }
+      break;
+    case OP_EQUAL_TO:
+      for(size_t i=0; i < n; ++i) {
+        d[i] = fabs(a[i] - b[i]) < fp_tolerance ? 1.0 : 0.0;
+      }
+      break;
+  }
+}
+
+}}
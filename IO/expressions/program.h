@@ -0,0 +1,195 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2010 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+/// \brief Flat, register-based form of an expression AST.
+///
+/// The AST is convenient for parsing and analysis, but evaluating it means
+/// a tree walk of virtual calls, plus a type switch, for every voxel.  A
+/// Program is the same expression flattened into a list of instructions over
+/// 'registers', each of which holds a span of voxels as doubles.  Evaluation
+/// runs each instruction over a whole span at a time, so the inner loops are
+/// simple, branch-free and amenable to the compiler's vectorizer.
+#ifndef TUVOK_EXPRESSION_PROGRAM_H
+#define TUVOK_EXPRESSION_PROGRAM_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "treenode.h"
+
+namespace tuvok { namespace expression {
+
+class Program {
+  public:
+    /// Number of voxels each register holds.
+    static const size_t Span = 1024;
+
+    /// Compiles the given AST.
+    explicit Program(const Node& tree);
+    /// An empty program; build it up via the Emit* methods.
+    Program();
+
+    /// Instruction emitters.  Each returns the register which will hold the
+    /// result.  Used by Node::Compile; repeated volume loads and constants
+    /// share registers, and operations on constants are folded.
+    ///@{
+    size_t EmitVolume(size_t index);
+    size_t EmitConstant(double value);
+    size_t EmitBinary(enum OpType, size_t lhs, size_t rhs);
+    size_t EmitSelect(size_t cond, size_t true_path, size_t false_path);
+    ///@}
+    /// Marks the register holding the program's result.
+    void SetResult(size_t reg);
+
+    /// @returns the number of input volumes the program reads from, i.e.
+    /// one more than the largest 'v[i]' index used.
+    size_t Inputs() const;
+    size_t Registers() const;
+
+    /// Evaluates the program over 'n' voxels.  'inputs' must hold at least
+    /// Inputs() pointers, each to 'n' elements.  Reentrant: all scratch
+    /// state lives on the caller's stack, so one Program may be run
+    /// concurrently from several threads.
+    template<typename T>
+    void Run(const T* const* inputs, T* output, size_t n) const;
+
+  private:
+    enum OpCode { OP_LOAD, OP_CONSTANT, OP_BINARY, OP_SELECT };
+    struct Instruction {
+      enum OpCode code;
+      enum OpType op;
+      size_t dst;
+      size_t a, b, c; ///< operand registers; 'a' is the volume for OP_LOAD
+      double value;   ///< for OP_CONSTANT
+    };
+
+    size_t NewRegister();
+    bool IsConstant(size_t reg, double& value) const;
+    static double Fold(enum OpType, double lhs, double rhs);
+    static void Apply(enum OpType, double* d, const double* a,
+                      const double* b, size_t n);
+
+    std::vector<Instruction> code;
+    size_t registers;
+    size_t inputs;
+    size_t result;
+};
+
+template<typename T>
+void Program::Run(const T* const* in, T* output, size_t n) const
+{
+  assert(!this->code.empty());
+  std::vector<double> scratch(this->registers * Span);
+  double* reg = &scratch[0];
+
+  // constants are the same for every span; fill them once, up front.
+  for(std::vector<Instruction>::const_iterator i = this->code.begin();
+      i != this->code.end(); ++i) {
+    if(i->code == OP_CONSTANT) {
+      std::fill(reg + i->dst*Span, reg + (i->dst+1)*Span, i->value);
+    }
+  }
+
+  for(size_t offset=0; offset < n; offset += Span) {
+    const size_t len = std::min(Span, n - offset);
+    for(std::vector<Instruction>::const_iterator i = this->code.begin();
+        i != this->code.end(); ++i) {
+      double* d = reg + i->dst*Span;
+      switch(i->code) {
+        case OP_CONSTANT: break;
+        case OP_LOAD: {
+          const T* src = in[i->a] + offset;
+          for(size_t j=0; j < len; ++j) { d[j] = static_cast<double>(src[j]); }
+        } break;
+        case OP_BINARY:
+          Apply(i->op, d, reg + i->a*Span, reg + i->b*Span, len);
+          break;
+        case OP_SELECT: {
+          const double* c = reg + i->a*Span;
+          const double* t = reg + i->b*Span;
+          const double* f = reg + i->c*Span;
+          for(size_t j=0; j < len; ++j) { d[j] = c[j] != 0.0 ? t[j] : f[j]; }
+        } break;
+      }
+    }
+    // This cast isn't strictly valid.  True, we calculated the width of T
+    // before calling this, but we based that purely on the types: a
+    // combination of three uint16_t volumes will give a uint16_t volume, even
+    // though it might need a uint32_t volume to represent that data.  A
+    // division would mean we'd probably want to output a floating point
+    // volume, too.
+    // Anyway, we'll want this cast to shut the compiler up even after we fix
+    // type calculation (see IdentifyType).
+    const double* r = reg + this->result*Span;
+    T* out = output + offset;
+    for(size_t j=0; j < len; ++j) { out[j] = static_cast<T>(r[j]); }
+  }
+}
+
+/// Evaluates a compiled expression.
+/// @param prog: the compiled expression
+/// @param volumes: input volumes
+/// @param output: the output volume.
+template<typename T>
+void evaluate(const Program& prog,
+              const std::vector<std::vector<T>>& volumes,
+              std::vector<T>& output)
+{
+  // First make sure the volumes make sense.
+  assert(!volumes.empty());
+  assert(prog.Inputs() <= volumes.size());
+  const size_t rootsize = volumes[0].size();
+  std::vector<const T*> in(volumes.size());
+  for(size_t i=0; i < volumes.size(); ++i) {
+    // hack, this should throw something instead.
+    assert(volumes[i].size() == rootsize);
+    in[i] = volumes[i].empty() ? NULL : &volumes[i][0];
+  }
+
+  output.resize(rootsize);
+  if(rootsize > 0) {
+    prog.Run(&in[0], &output[0], rootsize);
+  }
+}
+
+/// Evaluates the expression.
+/// @param tree: the AST for the expression
+/// @param volumes: input volumes
+/// @param output: the output volume.
+template<typename T>
+void evaluate(const Node& tree,
+              const std::vector<std::vector<T>>& volumes,
+              std::vector<T>& output)
+{
+  evaluate(Program(tree), volumes, output);
+}
+
+}}
+
+#endif // TUVOK_EXPRESSION_PROGRAM_H
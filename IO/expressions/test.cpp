@@ -1,12 +1,13 @@
 // Small/hacky test program for expressions.
 #include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <string>
 #include "parser.h"
+#include "program.h"
 #include "treenode.h"
 
 using namespace tuvok::expression;
-extern Node* parser_tree_root();
-extern void parser_free();
 
 // Function pointer for traversals.  First argument is the node, second
 // argument is "user data"; a given traversal function should cast it
@@ -18,12 +19,10 @@ bool print_tree(const std::shared_ptr<Node> n, void*);
 void inorder(const std::shared_ptr<Node> node, TraversalFunc f, void*);
 
 int main() {
-  int x = yyparse();
-  if(x != 1) {
-    // NullDeleter: "parser" owns that memory; it'll free it with parser_free.
-    std::shared_ptr<Node> tree = std::shared_ptr<Node>(
-      parser_tree_root(), NullDeleter<Node>
-    );
+  const std::string expr((std::istreambuf_iterator<char>(std::cin)),
+                         std::istreambuf_iterator<char>());
+  std::shared_ptr<Node> tree(parse(expr).release());
+  if(tree) {
     inorder(tree, print_tree, NULL);
 
     std::vector<std::vector<int8_t>> inputs;
@@ -32,8 +31,6 @@ int main() {
     std::vector<int8_t> output;
     evaluate<int8_t>(*tree, inputs, output);
   }
-
-  parser_free();
   return 0;
 }
 
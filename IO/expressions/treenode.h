@@ -40,6 +40,8 @@
 
 namespace tuvok { namespace expression {
 
+class Program;
+
 class Node {
   public:
     virtual ~Node();
@@ -64,6 +66,10 @@ class Node {
 
     virtual double Evaluate(size_t idx) const=0;
 
+    /// Emits the instructions for this subtree into the program.
+    /// @returns the register which holds the subtree's value.
+    virtual size_t Compile(Program&) const=0;
+
   protected:
     const std::shared_ptr<Node> GetChild(size_t index) const;
 
@@ -73,47 +79,6 @@ class Node {
 
 namespace { template<typename T> void NullDeleter(T*) {} }
 
-/// Evaluates the expression.
-/// @param tree: the AST for the expression
-/// @param volumes: input volumes
-/// @param output: the output volume.
-template<typename T>
-void evaluate(Node& tree,
-              std::vector<std::vector<T>>& volumes,
-              std::vector<T>& output)
-{
-  // First make sure the volumes make sense.
-  assert(!volumes.empty());
-  const size_t rootsize = volumes[0].size();
-  for(size_t i=0; i < volumes.size(); ++i) {
-    // hack, this should throw something instead.
-    assert(volumes[i].size() == rootsize);
-  }
-
-  // create vec of VariantArrays to set for the tree's volumes.
-  std::vector<VariantArray> vols(volumes.size());
-  for(size_t i=0; i < volumes.size(); ++i) {
-    vols[i].set(std::shared_ptr<T>(&(volumes[i].at(0)), NullDeleter<T>),
-                volumes[i].size());
-  }
-  tree.SetVolumes(vols);
-
-  output.resize(rootsize);
-  typedef typename std::vector<T>::iterator oiter;
-  for(oiter o = output.begin(); o != output.end(); ++o) {
-    // iter through each, create expression, eval.
-    // This cast isn't strictly valid.  True, we calculated the width of T
-    // before calling this, but we based that purely on the types: a
-    // combination of three uint16_t volumes will give a uint16_t volume, even
-    // though it might need a uint32_t volume to represent that data.  A
-    // division would mean we'd probably want to output a floating point
-    // volume, too.
-    // Anyway, we'll want this cast to shut the compiler up even after we fix
-    // type calculation (see IdentifyType).
-    *o = static_cast<T>(tree.Evaluate(std::distance(output.begin(), o)));
-  }
-}
-
 enum OpType {
   OP_PLUS,
   OP_MINUS,
@@ -131,6 +96,9 @@ enum NodeType {
   EXPR_CONDITIONAL
 };
 
+/// Two values within this distance of each other compare equal.
+const double fp_tolerance = 0.001;
+
 Node* make_node(NodeType, ...);
 
 }}
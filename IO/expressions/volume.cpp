@@ -28,6 +28,7 @@
 #include <cassert>
 #include <cstdio>
 #include "volume.h"
+#include "program.h"
 #include "semantic.h"
 
 namespace tuvok { namespace expression {
@@ -74,4 +75,8 @@ double Volume::Evaluate(size_t idx) const {
   return 0.0;
 }
 
+size_t Volume::Compile(Program& prog) const {
+  return prog.EmitVolume(this->Index());
+}
+
 }}
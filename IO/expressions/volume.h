@@ -46,6 +46,7 @@ class Volume : public Expression {
     void SetVolumes(const std::vector<VariantArray>&);
 
     double Evaluate(size_t idx) const;
+    size_t Compile(Program&) const;
 
   private:
     // Yes, it makes more sense for this to be some kind of unsigned
@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/Threads.h"
+#include "DebugOut/TextfileOut.h"
+
+using namespace tuvok;
+
+namespace {
+  std::vector<std::string> lines(const char* filename) {
+    std::ifstream ifs(filename);
+    std::vector<std::string> rv;
+    std::string line;
+    while(std::getline(ifs, line)) { rv.push_back(line); }
+    return rv;
+  }
+  size_t count(const std::vector<std::string>& lines,
+               const std::string& needle) {
+    size_t n = 0;
+    for(auto l = lines.cbegin(); l != lines.cend(); ++l) {
+      if(l->find(needle) != std::string::npos) { ++n; }
+    }
+    return n;
+  }
+}
+
+class AsyncLogTests : public CxxTest::TestSuite {
+public:
+  void test_threads() {
+    const char* fn = ".asynclog.txt";
+    remove(fn);
+    {
+      TextfileOut log(fn);
+      log.SetShowMessages(true);
+      std::vector<std::shared_ptr<LambdaThread>> threads;
+      for(size_t t=0; t < 4; ++t) {
+        threads.push_back(std::make_shared<LambdaThread>(
+          [&log, t](bool const&, LambdaThread::Interface&) {
+            for(int i=0; i < 1000; ++i) {
+              log.Message("test_threads", "thread %u message %d",
+                          static_cast<unsigned>(t), i);
+            }
+          }
+        ));
+      }
+      for(size_t t=0; t < threads.size(); ++t) { threads[t]->StartThread(); }
+      for(size_t t=0; t < threads.size(); ++t) { threads[t]->JoinThread(); }
+      log.Flush();
+      const std::vector<std::string> written = lines(fn);
+      TS_ASSERT_EQUALS(count(written, "MESSAGE (test_threads) thread"),
+                       size_t(4000));
+      // one thread's messages stay in order
+      size_t pos999 = 0, pos0 = 0;
+      for(size_t l=0; l < written.size(); ++l) {
+        if(written[l].find("thread 2 message 999") != std::string::npos) {
+          pos999 = l;
+        }
+        if(written[l].find("thread 2 message 0") != std::string::npos) {
+          pos0 = l;
+        }
+      }
+      TS_ASSERT(pos0 < pos999);
+    }
+    remove(fn);
+  }
+
+  // Flush must wait for every message that was not dropped, also when the
+  // queue overflowed
+  void test_flush_after_overfill() {
+    const char* fn = ".asynclog.txt";
+    remove(fn);
+    {
+      TextfileOut log(fn);
+      log.SetShowMessages(true);
+      const size_t nThreads = 8, nMessages = 50000;
+      std::vector<std::shared_ptr<LambdaThread>> threads;
+      for(size_t t=0; t < nThreads; ++t) {
+        threads.push_back(std::make_shared<LambdaThread>(
+          [&log, t](bool const&, LambdaThread::Interface&) {
+            for(size_t i=0; i < nMessages; ++i) {
+              log.Message("test_overfill", "overfill %u/%u",
+                          static_cast<unsigned>(t), static_cast<unsigned>(i));
+            }
+          }
+        ));
+      }
+      for(size_t t=0; t < threads.size(); ++t) { threads[t]->StartThread(); }
+      for(size_t t=0; t < threads.size(); ++t) { threads[t]->JoinThread(); }
+      log.Flush();
+      const uint64_t dropped = log.GetDroppedCount();
+      if(dropped == 0) {
+        TS_WARN("the writer kept up, the queue never overflowed");
+      }
+      TS_ASSERT_EQUALS(count(lines(fn), "MESSAGE (test_overfill) overfill"),
+                       size_t(nThreads*nMessages - dropped));
+    }
+    remove(fn);
+  }
+
+  // long messages are not truncated
+  void test_long() {
+    const char* fn = ".asynclog.txt";
+    remove(fn);
+    {
+      TextfileOut log(fn);
+      log.SetShowWarnings(true);
+      const std::string big(20000, 'x');
+      log.Warning("test_long", "%s|", big.c_str());
+      log.Flush();
+      TS_ASSERT_EQUALS(count(lines(fn), big + "|"), size_t(1));
+    }
+    remove(fn);
+  }
+
+  void test_rate_limit() {
+    const char* fn = ".asynclog.txt";
+    remove(fn);
+    const uint32_t old = DebugRateLimit::GetMaxPerSecond();
+    DebugRateLimit::SetMaxPerSecond(10);
+    {
+      TextfileOut log(fn);
+      DebugRateLimit limit;
+      size_t allowed = 0;
+      for(size_t i=0; i < 100; ++i) {
+        if(limit.Allow(log, AbstrDebugOut::CHANNEL_MESSAGE, "here")) {
+          ++allowed;
+        }
+      }
+      // we might have crossed into the next second
+      TS_ASSERT(allowed >= 10 && allowed <= 20);
+    }
+    DebugRateLimit::SetMaxPerSecond(0);
+    {
+      TextfileOut log(fn);
+      DebugRateLimit limit;
+      for(size_t i=0; i < 100; ++i) {
+        TS_ASSERT(limit.Allow(log, AbstrDebugOut::CHANNEL_MESSAGE, "here"));
+      }
+    }
+    DebugRateLimit::SetMaxPerSecond(old);
+    remove(fn);
+  }
+};
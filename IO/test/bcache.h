@@ -1,7 +1,9 @@
 #include <array>
 #include <algorithm>
+#include <thread>
 #include <cxxtest/TestSuite.h>
 #include "BrickCache.h"
+#include "Basics/PerfStats.h"
 #include "Controller/Controller.h"
 #include "util-test.h"
 
@@ -90,6 +92,91 @@ void sizes() {
   TS_ASSERT_EQUALS(c.size(), 0U);
 }
 
+// remove() must evict the least recently *used* brick, not the oldest add.
+void lru_order() {
+  BrickCache c;
+  for(size_t i=0; i < 3; ++i) {
+    std::vector<uint16_t> data(4, uint16_t(i));
+    c.add(BrickKey(0,0,i), data);
+  }
+  TS_ASSERT_EQUALS(c.size(), sizeof(uint16_t)*4*3);
+  c.lookup(BrickKey(0,0,0), uint16_t(42)); // 1 is now the LRU brick.
+  c.remove();
+  TS_ASSERT(c.lookup(BrickKey(0,0,1), uint16_t(42)) == NULL);
+  TS_ASSERT(c.lookup(BrickKey(0,0,0), uint16_t(42)) != NULL);
+  TS_ASSERT(c.lookup(BrickKey(0,0,2), uint16_t(42)) != NULL);
+  TS_ASSERT_EQUALS(c.size(), sizeof(uint16_t)*4*2);
+  c.clear();
+  TS_ASSERT_EQUALS(c.size(), 0U);
+  TS_ASSERT(c.lookup(BrickKey(0,0,0), uint16_t(42)) == NULL);
+}
+
+// probing is neither a hit nor a miss, and leaves the LRU order alone.
+void contains_is_a_probe() {
+  BrickCache c;
+  for(size_t i=0; i < 2; ++i) {
+    std::vector<uint16_t> data(4, uint16_t(i));
+    c.add(BrickKey(0,0,i), data);
+  }
+  const double hits = PerfStats::Instance().Sum(PERF_DY_CACHE_HITS);
+  const double misses = PerfStats::Instance().Sum(PERF_DY_CACHE_MISSES);
+  TS_ASSERT(c.contains(BrickKey(0,0,0)));
+  TS_ASSERT(!c.contains(BrickKey(0,0,7)));
+  TS_ASSERT_EQUALS(PerfStats::Instance().Sum(PERF_DY_CACHE_HITS), hits);
+  TS_ASSERT_EQUALS(PerfStats::Instance().Sum(PERF_DY_CACHE_MISSES), misses);
+  c.remove(); // 0 is still the LRU brick
+  TS_ASSERT(!c.contains(BrickKey(0,0,0)));
+  TS_ASSERT(c.contains(BrickKey(0,0,1)));
+  // whereas a lookup counts
+  c.lookup(BrickKey(0,0,1), uint16_t(42));
+  TS_ASSERT_EQUALS(PerfStats::Instance().Sum(PERF_DY_CACHE_HITS), hits+1);
+}
+
+// a pinned brick must stay readable even after the cache dropped it.
+void pin_outlives_eviction() {
+  BrickCache c;
+  std::shared_ptr<const void> pinned;
+  {
+    std::vector<float> data(16, 42.0f);
+    pinned = c.pin(BrickKey(0,0,0), data);
+  }
+  TS_ASSERT(pinned);
+  TS_ASSERT_EQUALS(c.size(), sizeof(float)*16);
+  c.remove();
+  TS_ASSERT_EQUALS(c.size(), 0U);
+  TS_ASSERT(c.pin(BrickKey(0,0,0), float(42)) == NULL);
+  const float* f = static_cast<const float*>(pinned.get());
+  TS_ASSERT_EQUALS(f[0], 42.0f);
+  TS_ASSERT_EQUALS(f[15], 42.0f);
+}
+
+// several threads adding and looking up disjoint keys in the same cache.
+void concurrent() {
+  BrickCache c;
+  const size_t nthreads = 4;
+  const size_t per_thread = 256;
+  std::vector<std::thread> threads;
+  for(size_t t=0; t < nthreads; ++t) {
+    threads.push_back(std::thread([&c, t, per_thread]() {
+      for(size_t i=0; i < per_thread; ++i) {
+        const BrickKey k(0, t, i);
+        std::vector<uint32_t> data(8, uint32_t(t*per_thread + i));
+        c.add(k, data);
+        const uint32_t* rv = static_cast<const uint32_t*>(
+          c.lookup(k, uint32_t(42))
+        );
+        TS_ASSERT(rv != NULL);
+        TS_ASSERT_EQUALS(rv[7], uint32_t(t*per_thread + i));
+      }
+    }));
+  }
+  std::for_each(threads.begin(), threads.end(),
+                [](std::thread& th) { th.join(); });
+  TS_ASSERT_EQUALS(c.size(), sizeof(uint32_t)*8*nthreads*per_thread);
+  while(c.size() > 0) { c.remove(); }
+  TS_ASSERT(c.lookup(BrickKey(0,0,0), uint32_t(42)) == NULL);
+}
+
 namespace {
   template<typename T>
   void normal(std::vector<T>& data, const T& mean, const T& stddev) {
@@ -138,5 +225,9 @@ public:
   void test_sizes() { sizes(); }
   void test_lookup_bug() { lookup_bug(); }
   void test_lookup_bug16() { lookup_bug16(); }
+  void test_lru_order() { lru_order(); }
+  void test_concurrent() { concurrent(); }
+  void test_pin_outlives_eviction() { pin_outlives_eviction(); }
+  void test_contains_is_a_probe() { contains_is_a_probe(); }
 //  void test_add_many() { add_many(); }
 };
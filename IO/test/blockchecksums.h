@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/Checksums/crc32c.h"
+#include "Basics/LargeRAWFile.h"
+#include "Controller/Controller.h"
+#include "IO/UVF/BlockChecksums.h"
+#include "IO/UVF/KeyValuePairDataBlock.h"
+#include "IO/UVF/MaxMinDataBlock.h"
+#include "IO/UVF/TOCBlock.h"
+#include "IO/UVF/UVF.h"
+
+namespace {
+  const uint64_t base = 100;
+
+  LargeRAWFile_ptr pattern_file(const char* fn, size_t size) {
+    LargeRAWFile_ptr f(new LargeRAWFile(fn));
+    f->Create();
+    std::vector<unsigned char> data(size);
+    for(size_t i=0; i < size; ++i) { data[i] = (unsigned char)(i*7 + i/251); }
+    f->WriteRAW(&data[0], data.size());
+    return f;
+  }
+  void poke(LargeRAWFile_ptr f, uint64_t pos, unsigned char c) {
+    f->SeekPos(pos);
+    f->WriteRAW(&c, 1);
+  }
+
+  const char* uvf_name = ".blockchecksums.uvf";
+  std::wstring wide(const std::string& s) {
+    return std::wstring(s.begin(), s.end());
+  }
+
+  /// counts the errors reported while it is alive
+  class ErrorCount {
+  public:
+    ErrorCount() : m_pOut(new Counter()) {
+      tuvok::Controller::Instance().AddDebugOut(m_pOut);
+    }
+    ~ErrorCount() {
+      tuvok::Controller::Instance().RemoveDebugOut(m_pOut); // deletes it
+    }
+    size_t get() const { return m_pOut->errors; }
+
+  private:
+    struct Counter : public AbstrDebugOut {
+      Counter() : errors(0) {}
+      virtual void printf(enum DebugChannel channel, const char*,
+                          const char*) {
+        if(channel == CHANNEL_ERROR) { ++errors; }
+      }
+      virtual void printf(const char*) const {}
+      size_t errors;
+    };
+    Counter* m_pOut;
+  };
+
+  std::shared_ptr<KeyValuePairDataBlock> key_value(const std::string& key) {
+    std::shared_ptr<KeyValuePairDataBlock> kv(new KeyValuePairDataBlock());
+    kv->AddPair(key, "value of " + key);
+    return kv;
+  }
+
+  /// a file with two small blocks followed by a TOC block of 512k bricks,
+  /// i.e. one checksum segment per brick
+  void create_uvf() {
+    const UINT64VECTOR3 dims(120, 120, 120);
+    const char* src = ".blockchecksums.src";
+    const char* tmp = ".blockchecksums.toc";
+    {
+      LargeRAWFile f(src);
+      f.Create();
+      std::vector<uint16_t> data(size_t(dims.volume()));
+      for(size_t i=0; i < data.size(); ++i) {
+        data[i] = uint16_t((i*2654435761u) >> 9);
+      }
+      f.WriteRAW(reinterpret_cast<unsigned char*>(&data[0]),
+                 data.size()*sizeof(uint16_t));
+    }
+    std::shared_ptr<TOCBlock> toc(new TOCBlock(UVF::ms_ulReaderVersion));
+    std::shared_ptr<MaxMinDataBlock> mm(new MaxMinDataBlock(1));
+    TS_ASSERT(toc->FlatDataToBrickedLOD(src, tmp, ExtendedOctree::CT_UINT16,
+                                        1, dims, DOUBLEVECTOR3(1,1,1),
+                                        UINT64VECTOR3(64,64,64), 2, false,
+                                        false, 1 << 24, mm,
+                                        &tuvok::Controller::Debug::Out(),
+                                        CT_NONE));
+    GlobalHeader gh;
+    gh.bIsBigEndian = EndianConvert::IsBigEndian();
+    gh.ulChecksumSemanticsEntry = UVFTables::CS_BLOCKCRC32C;
+    UVF uvf(wide(uvf_name));
+    uvf.SetGlobalHeader(gh);
+    uvf.AddDataBlock(key_value("first"));
+    uvf.AddDataBlock(key_value("middle"));
+    uvf.AddDataBlock(toc);
+    TS_ASSERT(uvf.Create());
+    uvf.Close();
+    remove(src);
+    remove(tmp);
+  }
+
+  /// reads every brick of the file's TOC block; returns its index
+  size_t read_bricks(UVF& uvf) {
+    for(uint64_t b=0; b < uvf.GetDataBlockCount(); ++b) {
+      const TOCBlock* toc =
+        dynamic_cast<const TOCBlock*>(uvf.GetDataBlock(b).get());
+      if(!toc) { continue; }
+      for(uint64_t lod=0; lod < toc->GetLoDCount(); ++lod) {
+        const UINT64VECTOR3 count = toc->GetBrickCount(lod);
+        for(uint64_t z=0; z < count.z; ++z) {
+          for(uint64_t y=0; y < count.y; ++y) {
+            for(uint64_t x=0; x < count.x; ++x) {
+              const UINT64VECTOR4 c(x, y, z, lod);
+              std::vector<uint8_t> brick(size_t(
+                toc->GetBrickSize(c).volume() * toc->GetComponentTypeSize()
+              ));
+              toc->GetData(&brick[0], c);
+            }
+          }
+        }
+      }
+      return size_t(b);
+    }
+    TS_FAIL("no TOC block");
+    return 0;
+  }
+
+  bool checksum_fails() {
+    bool bChecksumFail = true;
+    TS_ASSERT(UVF::IsUVFFile(wide(uvf_name), bChecksumFail));
+    return bChecksumFail;
+  }
+}
+
+class BlockChecksumTests : public CxxTest::TestSuite {
+public:
+  void test_crc32c() {
+    const unsigned char check[] = "123456789";
+    TS_ASSERT_EQUALS(CRC32C::get(check, 9), 0xE3069283u);
+    std::vector<unsigned char> data(10007);
+    for(size_t i=0; i < data.size(); ++i) { data[i] = (unsigned char)(i*13); }
+    // unaligned and split up does not matter
+    const uint32_t whole = CRC32C::chunkSoftware(0, &data[1], data.size()-1);
+    TS_ASSERT_EQUALS(CRC32C::chunk(CRC32C::chunk(0, &data[1], 999),
+                                   &data[1000], data.size()-1000), whole);
+  }
+
+  void test_layout() {
+    std::vector<uint64_t> b;
+    // too close to the start, so it merges with the next one
+    b.push_back(base + 10);
+    b.push_back(base + (1 << 20));
+    b.push_back(base + (1 << 20));
+    std::vector<uint64_t> end =
+      BlockChecksums::Layout(b, base, base + (40 << 20));
+    TS_ASSERT_EQUALS(end.size(), size_t(4));
+    TS_ASSERT_EQUALS(end[0], base + (1 << 20));
+    TS_ASSERT_EQUALS(end[1], base + (17 << 20));
+    TS_ASSERT_EQUALS(end[3], base + (40 << 20));
+  }
+
+  void test_roundtrip() {
+    const char* fn = ".blockchecksums.raw";
+    const size_t size = 3 << 20;
+    LargeRAWFile_ptr f = pattern_file(fn, size);
+    std::vector<uint64_t> b;
+    for(uint64_t p = base; p < size; p += 300000) { b.push_back(p); }
+    std::vector<BlockChecksums::Range> all(1, std::make_pair(0, size));
+
+    std::shared_ptr<BlockChecksums> out =
+      BlockChecksums().Update(f, base, b, all, 64);
+    TS_ASSERT_EQUALS(out->GetSegmentCount(), size_t(11));
+    const std::vector<unsigned char> table = out->Serialize(64);
+    TS_ASSERT_EQUALS(table.size(), size_t(BlockChecksums::TableSize(64)));
+
+    BlockChecksums in;
+    TS_ASSERT(in.Parse(f, table, base));
+    TS_ASSERT_EQUALS(in.GetSegmentCount(), size_t(11));
+    TS_ASSERT(in.VerifyAll());
+
+    std::vector<unsigned char> damaged(table);
+    damaged[20] ^= 1;
+    std::string problem;
+    TS_ASSERT(!in.Parse(f, damaged, base, &problem));
+    TS_ASSERT(!problem.empty());
+    // covers a different file size
+    TS_ASSERT(!in.Parse(f, table, base+1));
+    f->Close();
+    remove(fn);
+  }
+
+  void test_lazy() {
+    const char* fn = ".blockchecksums.raw";
+    const size_t size = 2 << 20;
+    LargeRAWFile_ptr f = pattern_file(fn, size);
+    std::vector<uint64_t> b(1, 1 << 20);
+    std::vector<BlockChecksums::Range> all(1, std::make_pair(0, size));
+    const std::vector<unsigned char> table =
+      BlockChecksums().Update(f, base, b, all, 4)->Serialize(4);
+
+    poke(f, (1 << 20) + 5, 0xAA);
+    BlockChecksums in;
+    TS_ASSERT(in.Parse(f, table, base));
+    // the damage is in the skipped part
+    std::vector<BlockChecksums::Range> skip(1, std::make_pair(1 << 20, size));
+    TS_ASSERT(in.VerifyAll(skip));
+    TS_ASSERT(in.Verify(base, 1000));
+    std::vector<unsigned char> brick(size - (1 << 20));
+    f->ReadRAWAt(&brick[0], brick.size(), 1 << 20);
+    TS_ASSERT(!in.Verify(1 << 20, brick.size(), &brick[0]));
+    TS_ASSERT(!in.VerifyAll());
+    f->Close();
+    remove(fn);
+  }
+
+  // only changed segments are read again
+  void test_incremental() {
+    const char* fn = ".blockchecksums.raw";
+    const size_t size = 3 << 20;
+    LargeRAWFile_ptr f = pattern_file(fn, size);
+    std::vector<uint64_t> b;
+    b.push_back(1 << 20);
+    b.push_back(2 << 20);
+    std::vector<BlockChecksums::Range> all(1, std::make_pair(0, size));
+    std::shared_ptr<BlockChecksums> cs =
+      BlockChecksums().Update(f, base, b, all, 8);
+
+    // the write to the first segment is announced, the other one is not
+    poke(f, 500, 1);
+    poke(f, (2 << 20) + 5, 1);
+    std::vector<BlockChecksums::Range> changed(1, std::make_pair(500, 501));
+    cs = cs->Update(f, base, b, changed, 8);
+
+    BlockChecksums in;
+    TS_ASSERT(in.Parse(f, cs->Serialize(8), base));
+    TS_ASSERT(in.Verify(base, 1000));
+    TS_ASSERT(in.Verify(1 << 20, 1000));
+    TS_ASSERT(!in.Verify(2 << 20, 1000));
+
+    // an appended part gets a segment of its own
+    f->SeekEnd();
+    std::vector<unsigned char> more(1 << 19, 3);
+    f->WriteRAW(&more[0], more.size());
+    b.push_back(size);
+    changed.assign(1, std::make_pair(size, size + more.size()));
+    const std::shared_ptr<const BlockChecksums> before = cs;
+    cs = cs->Update(f, base, b, changed, 8);
+    TS_ASSERT_EQUALS(cs->GetSegmentCount(), size_t(4));
+    // the old table is left alone for those still checking against it
+    TS_ASSERT_EQUALS(before->GetSegmentCount(), size_t(3));
+    TS_ASSERT(before->Verify(base, 1000));
+    // but not if the table is full
+    cs = cs->Update(f, base, b, changed, 2);
+    TS_ASSERT_EQUALS(cs->GetSegmentCount(), size_t(2));
+    TS_ASSERT(in.Parse(f, cs->Serialize(2), base));
+    TS_ASSERT(in.Verify(base, 1000));
+    f->Close();
+    remove(fn);
+  }
+
+  // a file written with CS_BLOCKCRC32C verifies, and every brick reads
+  // without complaint
+  void test_uvf_create() {
+    create_uvf();
+    TS_ASSERT(!checksum_fails());
+    {
+      ErrorCount errors;
+      UVF uvf(wide(uvf_name));
+      std::string problem;
+      TSM_ASSERT(problem.c_str(), uvf.Open(true, true, false, &problem));
+      TS_ASSERT_EQUALS(read_bricks(uvf), size_t(2));
+      TS_ASSERT_EQUALS(errors.get(), size_t(0));
+    }
+    remove(uvf_name);
+  }
+
+  // a damaged brick is left for the read to find, which reports it
+  void test_uvf_damaged_brick() {
+    create_uvf();
+    // the bricks are stored as they are, so one can be found by its data
+    std::vector<uint8_t> brick;
+    {
+      UVF uvf(wide(uvf_name));
+      TS_ASSERT(uvf.Open(true, false, false));
+      const TOCBlock* toc =
+        dynamic_cast<const TOCBlock*>(uvf.GetDataBlock(2).get());
+      const UINT64VECTOR4 c(1, 0, 0, 0);
+      brick.resize(size_t(toc->GetBrickSize(c).volume() *
+                          toc->GetComponentTypeSize()));
+      toc->GetData(&brick[0], c);
+    }
+    LargeRAWFile_ptr f(new LargeRAWFile(uvf_name));
+    TS_ASSERT(f->Open(true));
+    std::vector<uint8_t> file(size_t(f->GetCurrentSize()));
+    f->ReadRAWAt(&file[0], file.size(), 0);
+    const std::vector<uint8_t>::const_iterator at =
+      std::search(file.cbegin(), file.cend(), brick.cbegin(), brick.cend());
+    TS_ASSERT(at != file.cend());
+    const uint64_t pos = uint64_t(at - file.cbegin()) + 17;
+    poke(f, pos, file[size_t(pos)] ^ 0x40);
+    f->Close();
+
+    TS_ASSERT(checksum_fails());
+    {
+      ErrorCount errors;
+      UVF uvf(wide(uvf_name));
+      TS_ASSERT(uvf.Open(true, true, false));
+      read_bricks(uvf);
+      TS_ASSERT_EQUALS(errors.get(), size_t(1));
+    }
+    remove(uvf_name);
+  }
+
+  // appending a block and dropping one in the middle, which moves the TOC
+  // block, keeps the checksums in line with the file
+  void test_uvf_append_drop() {
+    create_uvf();
+    {
+      UVF uvf(wide(uvf_name));
+      TS_ASSERT(uvf.Open(true, true, true));
+      TS_ASSERT(uvf.AppendBlockToFile(key_value("appended")));
+    }
+    TS_ASSERT(!checksum_fails());
+    {
+      UVF uvf(wide(uvf_name));
+      TS_ASSERT(uvf.Open(true, true, true));
+      TS_ASSERT_EQUALS(uvf.GetDataBlockCount(), uint64_t(4));
+      TS_ASSERT(uvf.DropBlockFromFile(1));
+    }
+    TS_ASSERT(!checksum_fails());
+    {
+      ErrorCount errors;
+      UVF uvf(wide(uvf_name));
+      std::string problem;
+      TSM_ASSERT(problem.c_str(), uvf.Open(true, true, false, &problem));
+      TS_ASSERT_EQUALS(uvf.GetDataBlockCount(), uint64_t(3));
+      TS_ASSERT_EQUALS(read_bricks(uvf), size_t(1));
+      const KeyValuePairDataBlock* kv =
+        dynamic_cast<const KeyValuePairDataBlock*>(uvf.GetDataBlock(2).get());
+      TS_ASSERT(kv && kv->GetKeyByIndex(0) == "appended");
+      TS_ASSERT_EQUALS(errors.get(), size_t(0));
+    }
+    remove(uvf_name);
+  }
+};
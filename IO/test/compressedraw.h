@@ -0,0 +1,246 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "3rdParty/bzip2/bzlib.h"
+#include "3rdParty/zlib/zlib.h"
+#include "CompressedRAWFile.h"
+#include "RAWConverter.h"
+
+using namespace tuvok;
+
+namespace {
+  // compressible, but not trivially so
+  std::vector<unsigned char> payload(size_t n, unsigned seed) {
+    std::vector<unsigned char> v(n);
+    std::mt19937 rng(seed);
+    for(size_t i=0; i < n; ++i) {
+      v[i] = (unsigned char)((i / 7) % 13 + (rng() % 4));
+    }
+    return v;
+  }
+
+  std::vector<unsigned char> gzip(const std::vector<unsigned char>& v) {
+    std::vector<unsigned char> out(compressBound(uLong(v.size())) + 64);
+    z_stream z = z_stream();
+    TS_ASSERT_EQUALS(deflateInit2(&z, 6, Z_DEFLATED, 16+MAX_WBITS, 8,
+                                  Z_DEFAULT_STRATEGY), Z_OK);
+    z.next_in = const_cast<Bytef*>(&v[0]);
+    z.avail_in = uInt(v.size());
+    z.next_out = &out[0];
+    z.avail_out = uInt(out.size());
+    TS_ASSERT_EQUALS(deflate(&z, Z_FINISH), Z_STREAM_END);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+  }
+
+  std::vector<unsigned char> bzip2(const unsigned char* p, size_t n) {
+    std::vector<unsigned char> out(n + n/100 + 600);
+    unsigned len = unsigned(out.size());
+    // 100k blocks, so even small data has several
+    TS_ASSERT_EQUALS(BZ2_bzBuffToBuffCompress(
+      reinterpret_cast<char*>(&out[0]), &len,
+      const_cast<char*>(reinterpret_cast<const char*>(p)), unsigned(n), 1, 0,
+      0), BZ_OK);
+    out.resize(len);
+    return out;
+  }
+
+  std::string write(const std::vector<unsigned char>& v,
+                    const std::string& header,
+                    const std::string& fn = ".compressedraw-test") {
+    FILE* f = fopen(fn.c_str(), "wb");
+    fwrite(header.data(), 1, header.size(), f);
+    fwrite(&v[0], 1, v.size(), f);
+    fclose(f);
+    return fn;
+  }
+
+  // reads the file sequentially and at random, comparing against 'ref'
+  void check(CompressedRAWFile& f, const std::vector<unsigned char>& ref) {
+    TS_ASSERT(f.Open(false));
+    std::vector<unsigned char> got(ref.size() + 100);
+    size_t n = 0, r;
+    while((r = f.ReadRAW(&got[n], 12345)) > 0) { n += r; }
+    TS_ASSERT_EQUALS(n, ref.size());
+    TS_ASSERT(std::equal(ref.begin(), ref.end(), got.begin()));
+    TS_ASSERT_EQUALS(f.GetCurrentSize(), uint64_t(ref.size()));
+
+    std::mt19937 rng(7);
+    for(size_t i=0; i < 200; ++i) {
+      const size_t pos = rng() % ref.size();
+      const size_t len = rng() % 70000;
+      const size_t expected = std::min(len, ref.size() - pos);
+      TS_ASSERT_EQUALS(f.ReadRAWAt(&got[0], len, pos), expected);
+      TS_ASSERT(std::equal(ref.begin()+pos, ref.begin()+pos+expected,
+                           got.begin()));
+    }
+    TS_ASSERT(!f.Failed());
+    f.Close();
+  }
+}
+
+class CompressedRAWTests : public CxxTest::TestSuite {
+public:
+  void test_gzip() {
+    const std::vector<unsigned char> ref = payload(3*1024*1024+17, 1);
+    const std::string fn = write(gzip(ref), "a header");
+    CompressedRAWFile f(fn, CompressedRAWFile::ENC_GZIP, 8, 0, 256*1024);
+    check(f, ref);
+    remove(fn.c_str());
+  }
+
+  void test_gzip_restart_points() {
+    const std::vector<unsigned char> ref = payload(2*1024*1024, 2);
+    const std::string fn = write(gzip(ref), "");
+    CompressedRAWFile f(fn, CompressedRAWFile::ENC_GZIP, 0, 0, 128*1024);
+    TS_ASSERT(f.Open(false));
+    TS_ASSERT_EQUALS(f.GetCurrentSize(), uint64_t(ref.size()));
+    TS_ASSERT(f.GetRestartPoints() > 4);
+    // reading backwards only works if the restart points are right
+    std::vector<unsigned char> got(4096);
+    for(size_t pos = ref.size() - 4096; pos > 100003; pos -= 100003) {
+      TS_ASSERT_EQUALS(f.ReadRAWAt(&got[0], 4096, pos), size_t(4096));
+      TS_ASSERT(std::equal(got.begin(), got.end(), ref.begin()+pos));
+    }
+    f.Close();
+    remove(fn.c_str());
+  }
+
+  // reads slabs row by row, going back to the start of the slab for every
+  // column of bricks, the way the converter does
+  void test_window() {
+    const std::vector<unsigned char> ref = payload(2*1024*1024+3, 8);
+    const std::string fn = write(gzip(ref), "");
+    CompressedRAWFile f(fn, CompressedRAWFile::ENC_GZIP, 0, 0, 128*1024);
+    f.SetWindow(300*1000);
+    check(f, ref);
+
+    TS_ASSERT(f.Open(false));
+    const size_t iRow = 3000, iRows = 100, iColumn = 1000;
+    std::vector<unsigned char> got(iColumn);
+    for(size_t s=0; s + iRows*iRow <= ref.size(); s += 90*iRow) {
+      for(size_t c=0; c < iRow; c += iColumn) {
+        for(size_t r=0; r < iRows; ++r) {
+          const size_t pos = s + r*iRow + c;
+          TS_ASSERT_EQUALS(f.ReadRAWAt(&got[0], iColumn, pos), iColumn);
+          TS_ASSERT(std::equal(got.begin(), got.end(), ref.begin()+pos));
+        }
+      }
+    }
+    TS_ASSERT(!f.Failed());
+    f.Close();
+    remove(fn.c_str());
+  }
+
+  void test_bzip2() {
+    const std::vector<unsigned char> ref = payload(1024*1024+5, 3);
+    // two concatenated streams, as parallel compressors write them
+    const size_t half = ref.size()/2;
+    std::vector<unsigned char> bz = bzip2(&ref[0], half);
+    const std::vector<unsigned char> bz2 = bzip2(&ref[half], ref.size()-half);
+    bz.insert(bz.end(), bz2.begin(), bz2.end());
+
+    const std::string fn = write(bz, "hdr");
+    CompressedRAWFile f(fn, CompressedRAWFile::ENC_BZIP2, 3);
+    check(f, ref);
+    TS_ASSERT(f.Open(false));
+    TS_ASSERT(f.GetRestartPoints() > 4);
+    f.Close();
+    remove(fn.c_str());
+  }
+
+  void test_truncated() {
+    const std::vector<unsigned char> ref = payload(1024*1024, 4);
+    const std::vector<unsigned char> gz = gzip(ref);
+    const std::string fn =
+      write(std::vector<unsigned char>(gz.begin(), gz.begin() + gz.size()/2),
+            "");
+    CompressedRAWFile f(fn, CompressedRAWFile::ENC_GZIP);
+    TS_ASSERT(f.Open(false));
+    std::vector<unsigned char> got(ref.size());
+    const size_t n = f.ReadRAW(&got[0], got.size());
+    TS_ASSERT(n < ref.size());
+    TS_ASSERT(f.Failed());
+    TS_ASSERT(std::equal(got.begin(), got.begin()+n, ref.begin()));
+    f.Close();
+    remove(fn.c_str());
+  }
+
+  // a damaged CRC32 or size in the trailer is reported, the data is intact
+  void test_gzip_trailer() {
+    const std::vector<unsigned char> ref = payload(1024*1024, 6);
+    const std::vector<unsigned char> gz = gzip(ref);
+    const size_t fields[] = { gz.size()-8, gz.size()-4 }; // CRC32, ISIZE
+    for(size_t i=0; i < 2; ++i) {
+      std::vector<unsigned char> bad(gz);
+      bad[fields[i]] ^= 0x20;
+      const std::string fn = write(bad, "");
+      CompressedRAWFile f(fn, CompressedRAWFile::ENC_GZIP);
+      TS_ASSERT(f.Open(false));
+      std::vector<unsigned char> got(ref.size());
+      TS_ASSERT_EQUALS(f.ReadRAW(&got[0], got.size()), ref.size());
+      TS_ASSERT(got == ref);
+      TS_ASSERT(f.Failed());
+      f.Close();
+      remove(fn.c_str());
+    }
+  }
+
+  // The converter reads brick by brick, seeking back for every brick.  With
+  // compressed input that must not mean inflating the data over and over:
+  // the conversion may take little more than converting the raw data and
+  // inflating it once.
+  void test_convert_timing() {
+    typedef std::chrono::steady_clock clock;
+    const UINT64VECTOR3 dims(160, 160, 160);
+    const std::vector<unsigned char> ref = payload(size_t(dims.volume()), 7);
+    const std::string raw = write(ref, "", ".compressedraw-test.raw");
+    const std::string gz = write(gzip(ref), "", ".compressedraw-test.gz");
+    const std::string uvf = ".compressedraw-test.uvf";
+
+    double tInflate;
+    {
+      const clock::time_point start = clock::now();
+      CompressedRAWFile f(gz, CompressedRAWFile::ENC_GZIP);
+      TS_ASSERT(f.Open(false));
+      std::vector<unsigned char> got(ref.size());
+      TS_ASSERT_EQUALS(f.ReadRAW(&got[0], got.size()), ref.size());
+      f.Close();
+      tInflate = std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    double t[2];
+    const std::string src[2] = { raw, gz };
+    const CompressedRAWFile::Encoding enc[2] = {
+      CompressedRAWFile::ENC_RAW, CompressedRAWFile::ENC_GZIP
+    };
+    for(size_t i=0; i < 2; ++i) {
+      const clock::time_point start = clock::now();
+      TS_ASSERT(RAWConverter::ConvertRAWDataset(
+        src[i], uvf, ".", 0, 8, 1, 1, false, false, false, dims,
+        FLOATVECTOR3(1,1,1), "timing", "compressedraw test", 32, 2, false,
+        false, 0, 1, 0, NULL, false, enc[i]
+      ));
+      t[i] = std::chrono::duration<double>(clock::now() - start).count();
+      remove(uvf.c_str());
+    }
+    TSM_ASSERT_LESS_THAN_EQUALS("gzip conversion too slow", t[1],
+                                2*t[0] + 4*tInflate + 0.5);
+    remove(raw.c_str());
+    remove(gz.c_str());
+  }
+
+  void test_not_compressed() {
+    const std::vector<unsigned char> ref = payload(1000, 5);
+    const std::string fn = write(ref, "");
+    CompressedRAWFile gz(fn, CompressedRAWFile::ENC_GZIP);
+    TS_ASSERT(!gz.Open(false));
+    CompressedRAWFile bz(fn, CompressedRAWFile::ENC_BZIP2);
+    TS_ASSERT(!bz.Open(false));
+    remove(fn.c_str());
+  }
+};
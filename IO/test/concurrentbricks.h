@@ -0,0 +1,95 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/Threads.h"
+#include "RAWConverter.h"
+#include "uvfDataset.h"
+#include "util-test.h"
+
+using namespace tuvok;
+
+namespace {
+  // 64^3 voxels in bricks of 16^3, so there are plenty of bricks over a few
+  // LoDs.  The data compress somewhat, but no two bricks are alike.
+  std::shared_ptr<UVFDataset> mk_volume(const char* uvf,
+                                        uint32_t iCompression) {
+    const char* raw = ".concurrentbricks.raw";
+    std::vector<uint16_t> v(64*64*64);
+    std::mt19937 rng(11);
+    for(size_t i=0; i < v.size(); ++i) {
+      v[i] = static_cast<uint16_t>((i/5) ^ (rng() & 0xf));
+    }
+    std::ofstream ofs(raw, std::ios::trunc | std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(&v[0]), v.size()*sizeof(uint16_t));
+    ofs.close();
+    TS_ASSERT(RAWConverter::ConvertRAWDataset(
+      raw, uvf, ".", 0, sizeof(uint16_t)*8, 1, 1, false, false, false,
+      UINT64VECTOR3(64,64,64), FLOATVECTOR3(1,1,1), "desc",
+      "concurrency test", 16, 2, false, false, iCompression, 1, 0
+    ));
+    remove(raw);
+    return std::shared_ptr<UVFDataset>(new UVFDataset(uvf, 16, false));
+  }
+
+  // reads every brick once up front, then has 'nThreads' threads fetch
+  // bricks in random order and compare them against those
+  void hammer(const UVFDataset& ds, size_t nThreads, size_t rounds) {
+    std::vector<BrickKey> keys;
+    for(BrickTable::const_iterator b = ds.BricksBegin(); b != ds.BricksEnd();
+        ++b) {
+      keys.push_back(b->first);
+    }
+    TS_ASSERT(keys.size() > 64);
+    std::vector<std::vector<uint16_t>> ref(keys.size());
+    for(size_t i=0; i < keys.size(); ++i) {
+      TS_ASSERT(ds.GetBrick(keys[i], ref[i]));
+    }
+
+    std::atomic<size_t> failed(0), wrong(0);
+    std::vector<std::shared_ptr<LambdaThread>> threads;
+    for(size_t t=0; t < nThreads; ++t) {
+      threads.push_back(std::make_shared<LambdaThread>(
+        [&, t](bool const&, LambdaThread::Interface&) {
+          std::mt19937 order(static_cast<unsigned>(t));
+          std::vector<uint16_t> data;
+          for(size_t r=0; r < rounds*keys.size(); ++r) {
+            const size_t k = order() % keys.size();
+            if(!ds.GetBrick(keys[k], data)) { ++failed; }
+            else if(data != ref[k]) { ++wrong; }
+          }
+        }
+      ));
+    }
+    for(size_t t=0; t < nThreads; ++t) { threads[t]->StartThread(); }
+    for(size_t t=0; t < nThreads; ++t) { threads[t]->JoinThread(); }
+    TS_ASSERT_EQUALS(failed.load(), size_t(0));
+    TS_ASSERT_EQUALS(wrong.load(), size_t(0));
+  }
+}
+
+class ConcurrentBrickTests : public CxxTest::TestSuite {
+public:
+  void test_uncompressed() {
+    std::shared_ptr<UVFDataset> ds = mk_volume(".concurrentbricks.uvf", 0);
+    hammer(*ds, 8, 20);
+    ds.reset();
+    remove(".concurrentbricks.uvf");
+  }
+  void test_zlib() {
+    std::shared_ptr<UVFDataset> ds = mk_volume(".concurrentbricks.uvf", 1);
+    hammer(*ds, 8, 20);
+    ds.reset();
+    remove(".concurrentbricks.uvf");
+  }
+  void test_lz4() {
+    std::shared_ptr<UVFDataset> ds = mk_volume(".concurrentbricks.uvf", 3);
+    hammer(*ds, 8, 20);
+    ds.reset();
+    remove(".concurrentbricks.uvf");
+  }
+};
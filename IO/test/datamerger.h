@@ -0,0 +1,172 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "DebugOut/ConsoleOut.h"
+#include "DebugOut/RecordingOut.h"
+#include "DataMerger.h"
+
+using namespace tuvok;
+
+namespace {
+  template<typename T> std::vector<T> noise(size_t n, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<T> v(n);
+    for(size_t i=0; i < n; ++i) {
+      if(std::numeric_limits<T>::is_integer) {
+        v[i] = static_cast<T>(rng());
+      } else {
+        v[i] = static_cast<T>((double(rng() % 2000001) - 1000000.0) / 7.0);
+      }
+    }
+    return v;
+  }
+
+  // what the kernels must give: the plain definition, one element at a time.
+  // The identity leaves values alone, even those a double cannot hold.
+  template<typename T> T ref_scale_bias(T v, double fScale, double fBias) {
+    if(fScale == 1.0 && fBias == 0.0) { return v; }
+    const double d = fScale*(double(v) + fBias);
+    if(d < double(std::numeric_limits<T>::lowest())) {
+      return std::numeric_limits<T>::lowest();
+    }
+    if(d >= double(std::numeric_limits<T>::max())) {
+      return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(d);
+  }
+  template<typename T> T ref_combine(T a, T b, bool bMax) {
+    if(bMax) { return std::max(a, b); }
+    if(!std::numeric_limits<T>::is_integer) { return a + b; }
+    const long double s = static_cast<long double>(a) + b;
+    if(s > static_cast<long double>(std::numeric_limits<T>::max())) {
+      return std::numeric_limits<T>::max();
+    }
+    if(s < static_cast<long double>(std::numeric_limits<T>::lowest())) {
+      return std::numeric_limits<T>::lowest();
+    }
+    return static_cast<T>(a + b);
+  }
+
+  template<typename T> void kernels() {
+    const double scale[] = { 1.0, 0.5, 2.3, -1.7 };
+    const double bias[] = { 0.0, -100.0, 3.7, 70000.0 };
+    // odd sizes, to cover the scalar tails too
+    const size_t n = 1003;
+    for(size_t s=0; s < 4; ++s) {
+      for(size_t b=0; b < 4; ++b) {
+        std::vector<T> data = noise<T>(n, unsigned(s*4+b));
+        std::vector<T> ref(data);
+        for(size_t i=0; i < n; ++i) {
+          ref[i] = ref_scale_bias(ref[i], scale[s], bias[b]);
+        }
+        MergeScaleBias(&data[0], n, scale[s], bias[b]);
+        TS_ASSERT(data == ref);
+      }
+    }
+    for(int bMax=0; bMax < 2; ++bMax) {
+      std::vector<T> a = noise<T>(n, 100);
+      const std::vector<T> b = noise<T>(n, 101);
+      std::vector<T> ref(a);
+      for(size_t i=0; i < n; ++i) {
+        ref[i] = ref_combine(ref[i], b[i], bMax != 0);
+      }
+      MergeCombine(&a[0], &b[0], n, bMax != 0);
+      TS_ASSERT(a == ref);
+    }
+  }
+
+  template<typename T>
+  std::string write(const std::vector<T>& v, const std::string& fn,
+                    size_t header=0) {
+    FILE* f = fopen(fn.c_str(), "wb");
+    const std::vector<char> h(header, 'h');
+    if(header) { fwrite(&h[0], 1, header, f); }
+    fwrite(&v[0], sizeof(T), v.size(), f);
+    fclose(f);
+    return fn;
+  }
+
+  template<typename T> std::vector<T> read(const std::string& fn, size_t n) {
+    std::vector<T> v(n+1);
+    FILE* f = fopen(fn.c_str(), "rb");
+    if(!f) { return std::vector<T>(); }
+    v.resize(fread(&v[0], sizeof(T), v.size(), f));
+    fclose(f);
+    return v;
+  }
+}
+
+class DataMergerTests : public CxxTest::TestSuite {
+public:
+  void test_kernels() {
+    kernels<char>();
+    kernels<unsigned char>();
+    kernels<short>();
+    kernels<unsigned short>();
+    kernels<int>();
+    kernels<unsigned int>();
+    kernels<int64_t>();
+    kernels<uint64_t>();
+    kernels<float>();
+    kernels<double>();
+  }
+
+  void test_merge() {
+    // large enough to take several chunks
+    const size_t n = 13*1024*1024 + 5;
+    std::vector<MergeDataset> files;
+    std::vector<std::vector<uint16_t>> data;
+    for(unsigned i=0; i < 3; ++i) {
+      data.push_back(noise<uint16_t>(n, i));
+      const std::string fn = ".datamerger-test-" + std::to_string(i);
+      files.push_back(MergeDataset(write(data[i], fn, i*3), i*3, true,
+                                   1.0 + i*0.25, -double(i)));
+    }
+    for(int bMax=0; bMax < 2; ++bMax) {
+      ConsoleOut console;
+      RecordingOut dbg(console);
+      DataMerger<uint16_t> d(files, ".datamerger-test", n, dbg, bMax != 0);
+      TS_ASSERT(d.IsOK());
+      const std::vector<uint16_t> got =
+        read<uint16_t>(".datamerger-test", n);
+      TS_ASSERT_EQUALS(got.size(), n);
+      if(got.size() != n) { continue; }
+      size_t wrong = 0;
+      for(size_t j=0; j < n; ++j) {
+        uint16_t v = ref_scale_bias(data[0][j], files[0].fScale,
+                                    files[0].fBias);
+        for(size_t i=1; i < files.size(); ++i) {
+          v = ref_combine(v, ref_scale_bias(data[i][j], files[i].fScale,
+                                            files[i].fBias), bMax != 0);
+        }
+        wrong += v != got[j];
+      }
+      TS_ASSERT_EQUALS(wrong, size_t(0));
+    }
+    remove(".datamerger-test");
+    for(size_t i=0; i < files.size(); ++i) {
+      remove(files[i].strFilename.c_str());
+    }
+  }
+
+  void test_short_input() {
+    const size_t n = 10000;
+    std::vector<MergeDataset> files;
+    files.push_back(MergeDataset(
+      write(noise<float>(n, 1), ".datamerger-test-0")));
+    files.push_back(MergeDataset(
+      write(noise<float>(n-1, 2), ".datamerger-test-1")));
+    ConsoleOut console;
+    RecordingOut dbg(console);
+    DataMerger<float> d(files, ".datamerger-test", n, dbg, false);
+    TS_ASSERT(!d.IsOK());
+    TS_ASSERT(read<float>(".datamerger-test", n).empty());
+    remove(files[0].strFilename.c_str());
+    remove(files[1].strFilename.c_str());
+  }
+};
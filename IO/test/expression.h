@@ -1,6 +1,31 @@
 #include <cxxtest/TestSuite.h>
 #include "RAWConverter.h"
 #include "util-test.h"
+#include "exception/IOException.h"
+#include "expressions/binary-expression.h"
+#include "expressions/conditional-expression.h"
+#include "expressions/constant.h"
+#include "expressions/parser.h"
+#include "expressions/program.h"
+#include "expressions/volume.h"
+
+using namespace tuvok::expression;
+
+static Node* mkvolume(double idx) {
+  Node* n = make_node(EXPR_VOLUME, NULL);
+  dynamic_cast<Volume*>(n)->SetIndex(idx);
+  return n;
+}
+static Node* mkconstant(double v) {
+  Node* n = make_node(EXPR_CONSTANT, NULL);
+  dynamic_cast<Constant*>(n)->SetValue(v);
+  return n;
+}
+static Node* mkbinary(OpType op, Node* lhs, Node* rhs) {
+  Node* n = make_node(EXPR_BINARY, lhs, rhs, NULL);
+  dynamic_cast<BinaryExpression*>(n)->SetOperator(op);
+  return n;
+}
 
 // creates a temporary UVF from the specified data.  returns its filename.
 static std::string mkuvf(uint64_t value) {
@@ -14,7 +39,7 @@ static std::string mkuvf(uint64_t value) {
   if(RAWConverter::ConvertRAWDataset(
       rawdata, uvf, ".", 0, sizeof(uint64_t)*8, 1, 1, false, false,
       false, UINT64VECTOR3(1,1,1), FLOATVECTOR3(1.0, 1.0, 1.0),
-      "description", "nosrc", 64, 4, true, false, 0) != true) {
+      "description", "nosrc", 64, 4, true, false, 0, 0, 0) != true) {
     TS_FAIL("converting data set failed.");
   }
   return uvf;
@@ -29,12 +54,94 @@ static std::vector<std::string> smalluvfs() {
 
 class TestExpressions : public CxxTest::TestSuite {
 public:
+  // The compiled program must agree with walking the tree, voxel by voxel.
+  void test_compiled_matches_tree() {
+    // v[0] > 20 ? (v[1] * 2) - v[2] : (v[2] = v[0]) + (3 / 4)
+    std::unique_ptr<Node> tree(make_node(EXPR_CONDITIONAL,
+      mkbinary(OP_GREATER_THAN, mkvolume(0), mkconstant(20)),
+      mkbinary(OP_MINUS, mkbinary(OP_MULTIPLY, mkvolume(1), mkconstant(2)),
+               mkvolume(2)),
+      mkbinary(OP_PLUS, mkbinary(OP_EQUAL_TO, mkvolume(2), mkvolume(0)),
+               mkbinary(OP_DIVIDE, mkconstant(3), mkconstant(4))),
+      NULL));
+
+    // not a multiple of Program::Span, to exercise the tail.
+    const size_t n = Program::Span*3 + 17;
+    std::vector<std::vector<int16_t>> in(3, std::vector<int16_t>(n));
+    for(size_t i=0; i < n; ++i) {
+      in[0][i] = static_cast<int16_t>(i % 41);
+      in[1][i] = static_cast<int16_t>(i % 13) - 6;
+      in[2][i] = static_cast<int16_t>(i % 29);
+    }
+    std::vector<int16_t> out;
+    evaluate(*tree, in, out);
+    TS_ASSERT_EQUALS(out.size(), n);
+
+    std::vector<tuvok::VariantArray> vols(in.size());
+    for(size_t i=0; i < in.size(); ++i) {
+      vols[i].set(std::shared_ptr<int16_t>(&in[i][0], NullDeleter<int16_t>),
+                  n);
+    }
+    tree->SetVolumes(vols);
+    for(size_t i=0; i < n; ++i) {
+      TS_ASSERT_EQUALS(out[i], static_cast<int16_t>(tree->Evaluate(i)));
+    }
+  }
+
+  // The parser is reentrant: threads parsing different expressions at the
+  // same time must each get back the tree of their own expression.
+  void test_concurrent_parse() {
+    struct Case { const char* expr; double (*expected)(double, double); };
+    const Case cases[] = {
+      { "v[0] + 1", [](double a, double) { return a + 1; } },
+      { "v[0] * v[1]", [](double a, double b) { return a * b; } },
+      { "(v[1] - 3) / 2", [](double, double b) { return (b - 3) / 2; } },
+      { "v[0] > 20 ? v[1] : v[0]",
+        [](double a, double b) { return a > 20 ? b : a; } },
+      { "(v[0] + v[1]) * (v[0] - 2.5)",
+        [](double a, double b) { return (a + b) * (a - 2.5); } },
+    };
+    const int ncases = static_cast<int>(sizeof(cases) / sizeof(cases[0]));
+
+    const size_t n = 64;
+    std::vector<double> v0(n), v1(n);
+    for(size_t i=0; i < n; ++i) {
+      v0[i] = static_cast<double>(i % 41);
+      v1[i] = static_cast<double>(i % 13) - 6.0;
+    }
+    std::vector<tuvok::VariantArray> vols(2);
+    vols[0].set(std::shared_ptr<double>(&v0[0], NullDeleter<double>), n);
+    vols[1].set(std::shared_ptr<double>(&v1[0], NullDeleter<double>), n);
+
+    // every case is parsed many times, interleaved with the others.
+    const int rounds = 50;
+    std::vector<char> ok(size_t(ncases * rounds), 0);
+#pragma omp parallel for schedule(dynamic)
+    for(int r=0; r < ncases * rounds; ++r) {
+      const Case& c = cases[r % ncases];
+      std::unique_ptr<Node> tree = parse(c.expr);
+      if(!tree) { continue; }
+      tree->SetVolumes(vols);
+      bool same = true;
+      for(size_t i=0; i < n; ++i) {
+        same = same && tree->Evaluate(i) == c.expected(v0[i], v1[i]);
+      }
+      ok[r] = same;
+    }
+    for(int r=0; r < ncases * rounds; ++r) {
+      TSM_ASSERT(cases[r % ncases].expr, ok[r]);
+    }
+  }
+
+  // EvaluateExpression reads raster data blocks only, but the converter
+  // writes ToC blocks; it must refuse those instead of writing garbage.
   void test_addition_1() {
     EnableDebugMessages edm;
     std::vector<std::string> uvf = smalluvfs();
-    clean fclean = cleanup(uvf[0]).add(uvf[1]);
+    clean fclean = cleanup(uvf[0]).add(uvf[1]).add(".temp");
 
     const IOManager& iom = *Controller::Instance().IOMan();
-    iom.EvaluateExpression("v[0] + 1", uvf, ".temp");
+    TS_ASSERT_THROWS(iom.EvaluateExpression("v[0] + 1", uvf, ".temp"),
+                     const tuvok::io::IOException&);
   }
 };
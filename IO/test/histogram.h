@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Controller/Controller.h"
+#include "UVF/Histogram1DDataBlock.h"
+#include "UVF/Histogram2DDataBlock.h"
+#include "UVF/MaxMinDataBlock.h"
+#include "UVF/TOCBlock.h"
+#include "UVF/UVF.h"
+#include "util-test.h"
+
+namespace {
+  const UINT64VECTOR3 dims(37, 29, 23);
+
+  template<typename T> ExtendedOctree::COMPONENT_TYPE component_type();
+  template<> ExtendedOctree::COMPONENT_TYPE component_type<int8_t>() {
+    return ExtendedOctree::CT_INT8;
+  }
+  template<> ExtendedOctree::COMPONENT_TYPE component_type<int16_t>() {
+    return ExtendedOctree::CT_INT16;
+  }
+  template<> ExtendedOctree::COMPONENT_TYPE component_type<uint16_t>() {
+    return ExtendedOctree::CT_UINT16;
+  }
+
+  // a smooth ramp, for a wide spread of gradients, plus some noise
+  template<typename T> std::vector<T> make_volume(double lo, double hi) {
+    std::vector<T> v(size_t(dims.volume()));
+    for(size_t z=0; z < dims.z; ++z) {
+      for(size_t y=0; y < dims.y; ++y) {
+        for(size_t x=0; x < dims.x; ++x) {
+          const double ramp = double(x*x + 3*y + z*z) /
+                              double(dims.x*dims.x + 3*dims.y + dims.z*dims.z);
+          const size_t i = (z*dims.y + y)*dims.x + x;
+          const double noise = double((i*2654435761u >> 11) % 17) / 16.0;
+          v[i] = T(lo + (hi-lo) * (0.9*ramp + 0.1*noise));
+        }
+      }
+    }
+    return v;
+  }
+
+  // Checks 'data' against the histograms the engine computes for it through
+  // a TOCBlock, with 'bins' value bins in the 2D histogram.
+  template<typename T> void check_histograms(const std::vector<T>& data,
+                                             size_t bins) {
+    std::ofstream f;
+    const std::string src = mk_tmpfile(f, std::ios::out | std::ios::binary);
+    f.write(reinterpret_cast<const char*>(&data[0]), data.size()*sizeof(T));
+    f.close();
+    const std::string tmp = mk_tmpfile(f, std::ios::out | std::ios::binary);
+    f.close();
+    // declared before the block, so the files outlive it
+    clean files = cleanup(src).add(tmp);
+
+    TOCBlock toc(UVF::ms_ulReaderVersion);
+    std::shared_ptr<MaxMinDataBlock> mm(new MaxMinDataBlock(1));
+    TS_ASSERT(toc.FlatDataToBrickedLOD(src, tmp, component_type<T>(), 1, dims,
+                                       DOUBLEVECTOR3(1,1,1),
+                                       UINT64VECTOR3(16,16,16), 2, false, true,
+                                       1 << 24, mm,
+                                       &tuvok::Controller::Debug::Out(),
+                                       CT_NONE));
+    const double fMax = double(*std::max_element(data.begin(), data.end()));
+
+    Histogram1DDataBlock h1;
+    TS_ASSERT(h1.Compute(&toc, 0));
+    Histogram2DDataBlock h2;
+    TS_ASSERT(h2.Compute(&toc, 0, bins, fMax));
+
+    // brute force: every voxel on its own, neighbours clamped to the volume
+    const int64_t bias = -int64_t(std::numeric_limits<T>::min());
+    const double norm = double(std::numeric_limits<T>::max());
+    const double fMaxBiased = fMax + double(bias);
+    std::vector<uint64_t> ref1(size_t(bias + fMax) + 1, 0);
+    std::vector<double> grad(data.size());
+    double maxGrad = 0;
+    for(size_t z=0; z < dims.z; ++z) {
+      for(size_t y=0; y < dims.y; ++y) {
+        for(size_t x=0; x < dims.x; ++x) {
+          const size_t i = (z*dims.y + y)*dims.x + x;
+          ref1[size_t(int64_t(data[i]) + bias)]++;
+          const size_t sx = 1, sy = size_t(dims.x), sz = size_t(dims.x*dims.y);
+          const double gx = (double(data[x > 0 ? i-sx : i]) -
+                             double(data[x+1 < dims.x ? i+sx : i])) / (2*norm);
+          const double gy = (double(data[y > 0 ? i-sy : i]) -
+                             double(data[y+1 < dims.y ? i+sy : i])) / (2*norm);
+          const double gz = (double(data[z > 0 ? i-sz : i]) -
+                             double(data[z+1 < dims.z ? i+sz : i])) / (2*norm);
+          grad[i] = std::sqrt(gx*gx + gy*gy + gz*gz);
+          maxGrad = std::max(maxGrad, grad[i]);
+        }
+      }
+    }
+    TS_ASSERT(h1.GetHistogram() == ref1);
+    TS_ASSERT_DELTA(h2.GetMaxGradMagnitude(), maxGrad, maxGrad*1e-6);
+
+    std::vector<std::vector<uint64_t>> ref2(bins,
+                                            std::vector<uint64_t>(256, 0));
+    for(size_t i=0; i < data.size(); ++i) {
+      const double v = double(int64_t(data[i]) + bias);
+      size_t iValue = fMaxBiased <= double(bins-1)
+        ? size_t(v) : size_t(v * double(bins-1) / fMaxBiased);
+      iValue = std::min(iValue, bins-1);
+      const size_t iGrad = std::min<size_t>(255,
+                                            size_t(grad[i]/maxGrad*255.0));
+      ref2[iValue][iGrad]++;
+    }
+    // the gradient axis is binned through finer bins, so a voxel may end up
+    // one bin next to its exact one, but no further.
+    const std::vector<std::vector<uint64_t>>& hist2 = h2.GetHistogram();
+    TS_ASSERT_EQUALS(hist2.size(), bins);
+    for(size_t v=0; v < bins && v < hist2.size(); ++v) {
+      uint64_t sum = 0, lo = 0, hi = ref2[v][0];
+      for(size_t g=0; g < 256; ++g) {
+        sum += hist2[v][g];
+        hi += (g+1 < 256) ? ref2[v][g+1] : 0;
+        TS_ASSERT_LESS_THAN_EQUALS(lo, sum);
+        TS_ASSERT_LESS_THAN_EQUALS(sum, hi);
+        lo += ref2[v][g];
+      }
+      TS_ASSERT_EQUALS(sum, lo);
+    }
+  }
+}
+
+class HistogramTests : public CxxTest::TestSuite {
+public:
+  void test_int8() {
+    check_histograms(make_volume<int8_t>(-120, 100), 256);
+  }
+  // more values than bins: the value axis is scaled
+  void test_int16() {
+    check_histograms(make_volume<int16_t>(-30000, 20000), 1024);
+  }
+  void test_uint16() {
+    check_histograms(make_volume<uint16_t>(0, 40000), 4096);
+  }
+  void test_uint16_raw_values() {
+    check_histograms(make_volume<uint16_t>(0, 900), 901);
+  }
+};
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Controller/Controller.h"
+#include "IOManager.h"
+#include "RAWConverter.h"
+#include "uvfDataset.h"
+
+using namespace tuvok;
+
+namespace {
+  const UINT64VECTOR3 dims(50, 45, 40);
+  // the data are odd and the isovalue is even (integer types truncate it),
+  // so no vertex ends up on a grid point
+  const double isovalue = 30;
+
+  /// distance from a point near the center: the isosurface is a sphere
+  /// which crosses many brick boundaries, but not the domain boundary.
+  void mk_sphere(const char* raw) {
+    std::vector<uint8_t> v(size_t(dims.volume()));
+    for(size_t z=0; z < dims.z; ++z) {
+      for(size_t y=0; y < dims.y; ++y) {
+        for(size_t x=0; x < dims.x; ++x) {
+          const double dx = x-24.3, dy = y-21.7, dz = z-19.4;
+          const double r = std::sqrt(dx*dx + dy*dy + dz*dz);
+          v[(z*dims.y + y)*dims.x + x] = uint8_t(2*std::min(127, int(r)) + 1);
+        }
+      }
+    }
+    std::ofstream ofs(raw, std::ios::trunc | std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(&v[0]), v.size());
+  }
+
+  struct mesh {
+    std::vector<DOUBLEVECTOR3> vertices; ///< in voxel coordinates
+    std::vector<std::array<uint32_t,3>> triangles;
+  };
+
+  /// extracts the isosurface of a dataset with the given brick size and
+  /// reads the OBJ back in.
+  mesh extract(const char* raw, uint64_t iBrickSize) {
+    std::ostringstream name;
+    name << ".isosurface." << iBrickSize;
+    const std::string uvf = name.str() + ".uvf";
+    const std::string obj = name.str() + ".obj";
+    TS_ASSERT(RAWConverter::ConvertRAWDataset(
+      raw, uvf, ".", 0, 8, 1, 1, false, false, false, dims,
+      FLOATVECTOR3(1,1,1), "sphere", "isosurface test", iBrickSize, 2,
+      false, false, 0, 1, 0
+    ));
+    {
+      UVFDataset ds(uvf, iBrickSize, false);
+      const IOManager& iom = Controller::Const().IOMan();
+      TS_ASSERT(iom.ExtractIsosurface(&ds, 0, isovalue,
+                                      FLOATVECTOR4(1,1,1,1), obj, "."));
+    }
+
+    // vertices are centered and scaled into the unit cube
+    const double fMaxSize = double(dims.maxVal());
+    const DOUBLEVECTOR3 vCenter = DOUBLEVECTOR3(dims) / 2.0;
+    mesh m;
+    std::ifstream in(obj.c_str());
+    std::string line;
+    while(std::getline(in, line)) {
+      std::istringstream ls(line);
+      std::string tag;
+      ls >> tag;
+      if(tag == "v") {
+        DOUBLEVECTOR3 v;
+        ls >> v.x >> v.y >> v.z;
+        m.vertices.push_back(v * fMaxSize + vCenter);
+      } else if(tag == "f") {
+        std::array<uint32_t,3> t;
+        for(size_t i=0; i < 3; ++i) {
+          std::string idx;
+          ls >> idx;
+          t[i] = uint32_t(atoi(idx.c_str())) - 1; // "v//vn", 1-based
+        }
+        m.triangles.push_back(t);
+      }
+    }
+    in.close();
+    remove(obj.c_str());
+    remove(uvf.c_str());
+    return m;
+  }
+
+  /// the grid edge a vertex lies on: its lower corner and axis.  Exactly
+  /// one coordinate is off the grid.
+  typedef std::array<int64_t,4> edge;
+  edge grid_edge(const DOUBLEVECTOR3& v) {
+    edge e = {{ 0, 0, 0, -1 }};
+    for(size_t d=0; d < 3; ++d) {
+      const double r = std::floor(v[d] + 0.5);
+      if(std::fabs(v[d] - r) < 1e-3) {
+        e[d] = int64_t(r);
+      } else {
+        TS_ASSERT_EQUALS(e[3], -1);
+        e[d] = int64_t(std::floor(v[d]));
+        e[3] = int64_t(d);
+      }
+    }
+    TS_ASSERT_DIFFERS(e[3], -1);
+    return e;
+  }
+
+  /// the triangles of a mesh as sorted triples of grid edges
+  std::vector<std::array<edge,3>> edge_triangles(const mesh& m) {
+    std::vector<std::array<edge,3>> tris;
+    for(size_t t=0; t < m.triangles.size(); ++t) {
+      std::array<edge,3> tri;
+      for(size_t i=0; i < 3; ++i) {
+        tri[i] = grid_edge(m.vertices[m.triangles[t][i]]);
+      }
+      std::sort(tri.begin(), tri.end());
+      tris.push_back(tri);
+    }
+    std::sort(tris.begin(), tris.end());
+    return tris;
+  }
+
+  size_t open_edges(const mesh& m) {
+    std::map<std::pair<uint32_t,uint32_t>, int> edges;
+    for(size_t t=0; t < m.triangles.size(); ++t) {
+      for(size_t e=0; e < 3; ++e) {
+        const uint32_t a = m.triangles[t][e], b = m.triangles[t][(e+1)%3];
+        ++edges[std::make_pair(std::min(a,b), std::max(a,b))];
+      }
+    }
+    size_t open = 0;
+    for(auto e = edges.cbegin(); e != edges.cend(); ++e) {
+      if(e->second != 2) { ++open; }
+    }
+    return open;
+  }
+}
+
+class IsosurfaceTests : public CxxTest::TestSuite {
+public:
+  // seam vertices must be welded, or the sphere would have holes along
+  // every brick boundary it crosses
+  void test_multibrick_watertight() {
+    const char* raw = ".isosurface.raw";
+    mk_sphere(raw);
+    const mesh m = extract(raw, 16);
+    remove(raw);
+    TS_ASSERT(m.triangles.size() > 1000);
+    TS_ASSERT_EQUALS(open_edges(m), size_t(0));
+
+    // and no vertex may be emitted twice
+    std::map<edge, size_t> seen;
+    for(size_t v=0; v < m.vertices.size(); ++v) {
+      TS_ASSERT_EQUALS(++seen[grid_edge(m.vertices[v])], size_t(1));
+    }
+  }
+
+  // splitting the volume into bricks must not change the surface
+  void test_multibrick_equals_single_brick() {
+    const char* raw = ".isosurface.raw";
+    mk_sphere(raw);
+    const mesh multi = extract(raw, 16);
+    const mesh single = extract(raw, 64);
+    remove(raw);
+    TS_ASSERT_EQUALS(multi.vertices.size(), single.vertices.size());
+    TS_ASSERT_EQUALS(multi.triangles.size(), single.triangles.size());
+    TS_ASSERT(edge_triangles(multi) == edge_triangles(single));
+
+    // the same edge must get the same position
+    std::map<edge, DOUBLEVECTOR3> pos;
+    for(size_t v=0; v < single.vertices.size(); ++v) {
+      pos[grid_edge(single.vertices[v])] = single.vertices[v];
+    }
+    for(size_t v=0; v < multi.vertices.size(); ++v) {
+      const DOUBLEVECTOR3& p = multi.vertices[v];
+      const DOUBLEVECTOR3& q = pos[grid_edge(p)];
+      TS_ASSERT_DELTA(p.x, q.x, 1e-3);
+      TS_ASSERT_DELTA(p.y, q.y, 1e-3);
+      TS_ASSERT_DELTA(p.z, q.z, 1e-3);
+    }
+  }
+};
@@ -1,7 +1,9 @@
 #include <cstdint>
 #include <cstdlib>
 #include <algorithm>
+#include <chrono>
 #include <functional>
+#include <thread>
 #include <vector>
 
 #include <cxxtest/TestSuite.h>
@@ -10,6 +12,8 @@
 #include "LargeFileC.h"
 #include "LargeFileFD.h"
 #include "LargeFileMMap.h"
+#include "LargeRAWFile.h"
+#include "PrefetchQueue.h"
 
 #include "util-test.h"
 
@@ -504,9 +508,122 @@ namespace {
   }
 }
 
+// positional reads from several threads must see the right data (honoring
+// the header offset) and must leave the file pointer alone.
+namespace {
+  void lf_raw_positional() {
+    std::ofstream ofs;
+    const std::string tmpf = mk_tmpfile(ofs, std::ios::out | std::ios::binary);
+    clean f = cleanup(tmpf);
+    const size_t N = 4096;
+    const uint64_t header = sizeof(uint64_t);
+    for(uint64_t i=0; i < N+1; ++i) {
+      ofs.write(reinterpret_cast<const char*>(&i), sizeof(uint64_t));
+    }
+    ofs.close();
+
+    LargeRAWFile raw(tmpf, header);
+    TS_ASSERT(raw.Open(false));
+    raw.SeekPos(sizeof(uint64_t)*7);
+
+    const size_t nthreads = 4;
+    std::vector<size_t> errors(nthreads, 0);
+    std::vector<std::thread> threads;
+    for(size_t t=0; t < nthreads; ++t) {
+      threads.push_back(std::thread([&, t]() {
+        for(size_t i=t; i < N; i += nthreads) {
+          uint64_t v = 0;
+          size_t rd = raw.ReadRAWAt(reinterpret_cast<unsigned char*>(&v),
+                                    sizeof(uint64_t), sizeof(uint64_t)*i);
+          if(rd != sizeof(uint64_t) || v != i+1) { ++errors[t]; }
+        }
+      }));
+    }
+    for(auto th = threads.begin(); th != threads.end(); ++th) { th->join(); }
+    for(size_t t=0; t < nthreads; ++t) {
+      TS_ASSERT_EQUALS(errors[t], static_cast<size_t>(0));
+    }
+    TS_ASSERT_EQUALS(raw.GetPos(), sizeof(uint64_t)*7);
+
+    // reading past the end returns a short count.
+    uint64_t v[2];
+    TS_ASSERT_EQUALS(raw.ReadRAWAt(reinterpret_cast<unsigned char*>(v),
+                                   sizeof(v), sizeof(uint64_t)*(N-1)),
+                     sizeof(uint64_t));
+    raw.Close();
+  }
+}
+
+// whatever the read-ahead queue hands out must be the right bytes; what it
+// does not have, it must not pretend to have.
+namespace {
+  void lf_prefetch_queue() {
+    std::ofstream ofs;
+    const std::string tmpf = mk_tmpfile(ofs, std::ios::out | std::ios::binary);
+    clean f = cleanup(tmpf);
+    const size_t N = 4096;
+    const uint64_t header = sizeof(uint64_t);
+    for(uint64_t i=0; i < N+1; ++i) {
+      ofs.write(reinterpret_cast<const char*>(&i), sizeof(uint64_t));
+    }
+    ofs.close();
+
+    LargeRAWFile_ptr raw(new LargeRAWFile(tmpf, header));
+    TS_ASSERT(raw->Open(false));
+    const uint64_t budget = 1024*sizeof(uint64_t);
+    PrefetchQueue q(raw, budget, 2, 64);
+
+    // 'bricks' of 16 values: runs of neighbours, some with small gaps, and a
+    // few far away; more than fit into the staging area.
+    std::vector<PrefetchQueue::Range> ranges;
+    for(uint64_t b=0; b < N/16; b += (b % 5 == 4) ? 2 : 1) {
+      PrefetchQueue::Range r = { b*16*sizeof(uint64_t), 16*sizeof(uint64_t) };
+      ranges.push_back(r);
+    }
+    q.Prefetch(ranges);
+    TS_ASSERT_LESS_THAN_EQUALS(q.GetReservedBytes(), budget);
+    q.Prefetch(ranges); // duplicates are ignored
+    TS_ASSERT_LESS_THAN_EQUALS(q.GetReservedBytes(), budget);
+
+    // never announced, or asked for with the wrong length
+    TS_ASSERT(!q.Take(3, 16*sizeof(uint64_t)));
+    TS_ASSERT(!q.Take(ranges[1].offset, 8));
+
+    // Take cancels whatever is still queued, so let the workers finish.
+    for(size_t wait=0; wait < 500 &&
+        q.GetStagedBytes() != q.GetReservedBytes(); ++wait) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const uint64_t staged = q.GetStagedBytes();
+    TS_ASSERT_EQUALS(staged, q.GetReservedBytes());
+    TS_ASSERT_LESS_THAN(0ULL, staged);
+
+    uint64_t taken = 0;
+    for(auto r = ranges.cbegin(); r != ranges.cend(); ++r) {
+      std::shared_ptr<const uint8_t> data = q.Take(r->offset, r->length);
+      if(!data) { continue; }
+      const uint64_t* v = reinterpret_cast<const uint64_t*>(data.get());
+      for(uint64_t i=0; i < 16; ++i) {
+        TS_ASSERT_EQUALS(v[i], r->offset/sizeof(uint64_t) + i + 1);
+      }
+      taken += r->length;
+      TS_ASSERT(!q.Take(r->offset, r->length)); // only once
+    }
+    TS_ASSERT_EQUALS(taken, staged);
+    TS_ASSERT_EQUALS(q.GetReservedBytes(), 0ULL);
+
+    q.Prefetch(ranges);
+    q.Clear();
+    TS_ASSERT_EQUALS(q.GetReservedBytes(), 0ULL);
+    TS_ASSERT(!q.Take(ranges[0].offset, ranges[0].length));
+  }
+}
+
 class LargeFileTests : public CxxTest::TestSuite {
 public:
   void test_truncate() { lf_truncate(); }
+  void test_raw_positional() { lf_raw_positional(); }
+  void test_prefetch_queue() { lf_prefetch_queue(); }
 
   void test_mmap_open() { lf_generic_open<LargeFileMMap>(); }
   void test_mmap_read() { lf_generic_read<LargeFileMMap>(); }
@@ -0,0 +1,162 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/MC.h"
+
+namespace {
+  // distance from a point off the grid center, so the isosurface is a sphere
+  template<typename T>
+  std::vector<T> sphere(int x, int y, int z) {
+    std::vector<T> v(size_t(x)*y*z);
+    for(int k=0; k < z; ++k) {
+      for(int j=0; j < y; ++j) {
+        for(int i=0; i < x; ++i) {
+          const double dx = i-x/2.1, dy = j-y/1.9, dz = k-z/2.05;
+          v[i + size_t(j)*x + size_t(k)*x*y] =
+            T(std::sqrt(dx*dx + dy*dy + dz*dz));
+        }
+      }
+    }
+    return v;
+  }
+  template<typename T>
+  std::vector<T> noise(int x, int y, int z, unsigned seed) {
+    std::vector<T> v(size_t(x)*y*z);
+    std::mt19937 rng(seed);
+    for(size_t i=0; i < v.size(); ++i) { v[i] = T(rng() % 100); }
+    return v;
+  }
+
+  // number of edges which are not shared by exactly two triangles
+  size_t open_edges(const Isosurface& iso) {
+    std::map<std::pair<int,int>, int> edges;
+    for(int t=0; t < iso.iTriangles; ++t) {
+      const int v[3] = { iso.viTriangles[t].x, iso.viTriangles[t].y,
+                         iso.viTriangles[t].z };
+      for(int e=0; e < 3; ++e) {
+        const int a = v[e], b = v[(e+1)%3];
+        ++edges[std::make_pair(std::min(a,b), std::max(a,b))];
+      }
+    }
+    size_t open = 0;
+    for(auto e = edges.cbegin(); e != edges.cend(); ++e) {
+      if(e->second != 2) { ++open; }
+    }
+    return open;
+  }
+
+  bool same_surface(const Isosurface& a, const Isosurface& b) {
+    if(a.iVertices != b.iVertices || a.iTriangles != b.iTriangles) {
+      return false;
+    }
+    for(int i=0; i < a.iVertices; ++i) {
+      if(a.vfVertices[i] != b.vfVertices[i] ||
+         a.vfNormals[i] != b.vfNormals[i]) { return false; }
+    }
+    for(int i=0; i < a.iTriangles; ++i) {
+      if(a.viTriangles[i] != b.viTriangles[i]) { return false; }
+    }
+    return true;
+  }
+}
+
+// a sphere inside the volume gives a closed surface
+void mc_closed() {
+  std::vector<float> v = sphere<float>(33, 29, 31);
+  MarchingCubes<float> mc;
+  mc.SetVolume(33, 29, 31, &v[0]);
+  mc.Process(10.5f);
+  TS_ASSERT(mc.m_Isosurface->iTriangles > 0);
+  TS_ASSERT_EQUALS(open_edges(*mc.m_Isosurface), size_t(0));
+  for(int i=0; i < mc.m_Isosurface->iTriangles; ++i) {
+    const INTVECTOR3 t = mc.m_Isosurface->viTriangles[i];
+    TS_ASSERT(t.x >= 0 && t.x < mc.m_Isosurface->iVertices);
+    TS_ASSERT(t.y >= 0 && t.y < mc.m_Isosurface->iVertices);
+    TS_ASSERT(t.z >= 0 && t.z < mc.m_Isosurface->iVertices);
+  }
+}
+
+// scratch data is kept between calls; that must not leak into the result
+void mc_reuse() {
+  std::vector<uint8_t> big = noise<uint8_t>(40, 37, 20, 7);
+  std::vector<uint8_t> small = noise<uint8_t>(9, 11, 5, 3);
+
+  MarchingCubes<uint8_t> reused;
+  reused.SetVolume(40, 37, 20, &big[0]);
+  reused.Process(50);
+  reused.SetVolume(9, 11, 5, &small[0]);
+  reused.Process(50);
+
+  MarchingCubes<uint8_t> fresh;
+  fresh.SetVolume(9, 11, 5, &small[0]);
+  fresh.Process(50);
+  TS_ASSERT(same_surface(*reused.m_Isosurface, *fresh.m_Isosurface));
+
+  reused.SetVolume(40, 37, 20, &big[0]);
+  reused.Process(50);
+  fresh.SetVolume(40, 37, 20, &big[0]);
+  fresh.Process(50);
+  TS_ASSERT(same_surface(*reused.m_Isosurface, *fresh.m_Isosurface));
+}
+
+// splitting the cells into ranges yields the same triangles in total
+void mc_cell_range() {
+  std::vector<short> v = noise<short>(17, 23, 13, 11);
+  MarchingCubes<short> mc;
+  mc.SetVolume(17, 23, 13, &v[0]);
+  mc.Process(30);
+  const int iTriangles = mc.m_Isosurface->iTriangles;
+
+  int iSum = 0;
+  const int zsplit[] = {0, 5, 6, 12};
+  const int ysplit[] = {0, 10, 22};
+  for(size_t z=0; z+1 < 4; ++z) {
+    for(size_t y=0; y+1 < 3; ++y) {
+      mc.SetVolume(17, 23, 13, &v[0]);
+      mc.SetCellRange(INTVECTOR3(0, ysplit[y], zsplit[z]),
+                      INTVECTOR3(16, ysplit[y+1], zsplit[z+1]));
+      mc.Process(30);
+      iSum += mc.m_Isosurface->iTriangles;
+    }
+  }
+  TS_ASSERT_EQUALS(iSum, iTriangles);
+}
+
+// this is really a benchmark, not a test per se...
+void mc_benchmark() {
+  const int n = 192;
+  std::vector<uint16_t> smooth = sphere<uint16_t>(n, n, n);
+  std::vector<uint16_t> rough = noise<uint16_t>(n, n, n, 42);
+  const struct { const char* name; std::vector<uint16_t>* data;
+                 uint16_t iso; } cases[] = {
+    { "sphere", &smooth, uint16_t(n/3) },
+    { "noise", &rough, uint16_t(50) },
+  };
+  MarchingCubes<uint16_t> mc;
+  for(size_t c=0; c < sizeof(cases)/sizeof(cases[0]); ++c) {
+    for(int rep=0; rep < 3; ++rep) {
+      const auto start = std::chrono::steady_clock::now();
+      mc.SetVolume(n, n, n, &(*cases[c].data)[0]);
+      mc.Process(cases[c].iso);
+      const double secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+      fprintf(stderr, "\n%s %d^3, run %d: %d triangles, %g s, %g Mvoxel/s",
+              cases[c].name, n, rep, mc.m_Isosurface->iTriangles, secs,
+              double(n)*n*n / secs / 1e6);
+    }
+  }
+  fprintf(stderr, "\n");
+}
+
+class MCTests : public CxxTest::TestSuite {
+public:
+  void test_closed() { mc_closed(); }
+  void test_reuse() { mc_reuse(); }
+  void test_cell_range() { mc_cell_range(); }
+//  void test_benchmark() { mc_benchmark(); }
+};
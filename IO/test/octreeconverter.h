@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/LargeRAWFile.h"
+#include "Controller/Controller.h"
+#include "UVF/UVF.h"
+#include "UVF/ExtendedOctree/ExtendedOctreeConverter.h"
+
+namespace {
+  const UINT64VECTOR3 volume(75, 61, 47);
+
+  // noisy data hardly compress; smooth data make sure zlib is used.
+  void write_source(const char* fn, bool noisy=true) {
+    LargeRAWFile f(fn);
+    f.Create();
+    std::vector<uint16_t> data(size_t(volume.volume()));
+    for(size_t i=0; i < data.size(); ++i) {
+      data[i] = noisy ? uint16_t((i*2654435761u) >> 7) : uint16_t(i / 1000);
+    }
+    f.WriteRAW(reinterpret_cast<unsigned char*>(&data[0]),
+               data.size()*sizeof(uint16_t));
+    f.Close();
+  }
+
+  // converts 'src' using 'workers' threads; returns the name of the output.
+  std::string convert(const char* src, uint32_t workers,
+                      COMPRESSION_TYPE compression) {
+    std::ostringstream out;
+    out << ".octreeconverter." << workers << ".raw";
+    // a small memory limit, so that the cache has to write bricks back
+    ExtendedOctreeConverter conv(UINT64VECTOR3(16,16,16), 2, 1 << 20,
+                                 tuvok::Controller::Debug::Out());
+    conv.SetWorkerCount(workers);
+    BrickStatVec stats;
+    TS_ASSERT(conv.Convert(src, 0, ExtendedOctree::CT_UINT16, 1, volume,
+                           DOUBLEVECTOR3(1,1,1), out.str(), 0, &stats,
+                           compression, 1, false, false, LT_MORTON));
+    return out.str();
+  }
+}
+
+class OctreeConverterTests : public CxxTest::TestSuite {
+public:
+  // the parallel hierarchy build and compression must not change a byte
+  void test_worker_count_invariant() {
+    const char* src = ".octreeconverter.src.raw";
+    write_source(src);
+    const COMPRESSION_TYPE ct[] = { CT_NONE, CT_ZLIB };
+    for(size_t c=0; c < sizeof(ct)/sizeof(ct[0]); ++c) {
+      const std::string serial = convert(src, 1, ct[c]);
+      const uint32_t workers[] = { 3, 8 };
+      for(size_t w=0; w < sizeof(workers)/sizeof(workers[0]); ++w) {
+        const std::string parallel = convert(src, workers[w], ct[c]);
+        std::string msg;
+        TSM_ASSERT(msg.c_str(), LargeRAWFile::Compare(serial, parallel, &msg));
+        remove(parallel.c_str());
+      }
+      remove(serial.c_str());
+    }
+    remove(src);
+  }
+
+  // a batch read must give exactly what single reads give; a brick that is
+  // cut off by a short file makes it fail, but must not spoil the others.
+  void test_batch_matches_single() {
+    const char* src = ".octreeconverter.src.raw";
+    write_source(src, false);
+    const COMPRESSION_TYPE ct[] = { CT_NONE, CT_ZLIB };
+    for(size_t c=0; c < sizeof(ct)/sizeof(ct[0]); ++c) {
+      const std::string fn = convert(src, 1, ct[c]);
+      {
+        ExtendedOctree tree;
+        TS_ASSERT(tree.Open(fn, 0, UVF::ms_ulReaderVersion));
+        std::vector<UINT64VECTOR4> coords;
+        for(uint64_t lod=0; lod < tree.GetLODCount(); ++lod) {
+          const UINT64VECTOR3 bc = tree.GetBrickCount(lod);
+          for(uint64_t z=0; z < bc.z; ++z)
+            for(uint64_t y=0; y < bc.y; ++y)
+              for(uint64_t x=0; x < bc.x; ++x)
+                coords.push_back(UINT64VECTOR4(x,y,z,lod));
+        }
+        std::vector<std::vector<uint8_t>> single(coords.size());
+        std::vector<std::vector<uint8_t>> batch(coords.size());
+        std::vector<uint8_t*> pData(coords.size());
+        size_t compressed = 0, last = 0;
+        for(size_t i=0; i < coords.size(); ++i) {
+          const size_t bytes = size_t(tree.ComputeBrickSize(coords[i]).volume())
+                               * sizeof(uint16_t);
+          single[i].resize(bytes);
+          batch[i].resize(bytes);
+          pData[i] = &batch[i][0];
+          tree.GetBrickData(&single[i][0], coords[i]);
+          const TOCEntry& toc = tree.GetBrickToCData(coords[i]);
+          if(toc.m_eCompression != CT_NONE) { ++compressed; }
+          if(toc.m_iOffset > tree.GetBrickToCData(coords[last]).m_iOffset) {
+            last = i;
+          }
+        }
+        TS_ASSERT_EQUALS(compressed != 0, ct[c] != CT_NONE);
+        TS_ASSERT(tree.GetBrickDataBatch(coords, pData));
+        for(size_t i=0; i < coords.size(); ++i) {
+          TS_ASSERT(batch[i] == single[i]);
+        }
+
+        // cut the file in the middle of the brick stored last.
+        const TOCEntry toc = tree.GetBrickToCData(coords[last]);
+        tree.Close();
+        {
+          LargeRAWFile f(fn);
+          TS_ASSERT(f.Open(true));
+          TS_ASSERT(f.Truncate(toc.m_iOffset + toc.m_iLength/2));
+          f.Close();
+        }
+        TS_ASSERT(tree.Open(fn, 0, UVF::ms_ulReaderVersion));
+        for(size_t i=0; i < coords.size(); ++i) {
+          std::fill(batch[i].begin(), batch[i].end(), 0);
+        }
+        TS_ASSERT(!tree.GetBrickDataBatch(coords, pData));
+        for(size_t i=0; i < coords.size(); ++i) {
+          if(i != last) { TS_ASSERT(batch[i] == single[i]); }
+        }
+      }
+      remove(fn.c_str());
+    }
+    remove(src);
+  }
+};
@@ -0,0 +1,70 @@
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/PerfStats.h"
+#include "Basics/Threads.h"
+
+using namespace tuvok;
+
+class PerfStatsTests : public CxxTest::TestSuite {
+public:
+  // Other tests record into the same process wide counters, so everything
+  // here looks at differences between snapshots only.
+  void test_threads() {
+    const PerfSnapshot before = PerfStats::Instance().Snapshot();
+    const size_t nThreads = 8, nRecords = 10000;
+    std::vector<std::shared_ptr<LambdaThread>> threads;
+    for(size_t t=0; t < nThreads; ++t) {
+      threads.push_back(std::make_shared<LambdaThread>(
+        [](bool const&, LambdaThread::Interface&) {
+          for(size_t i=0; i < nRecords; ++i) {
+            PerfStats::Instance().Record(PERF_SOMETHING, 0.5);
+          }
+        }
+      ));
+    }
+    for(size_t t=0; t < nThreads; ++t) { threads[t]->StartThread(); }
+    for(size_t t=0; t < nThreads; ++t) { threads[t]->JoinThread(); }
+    const PerfSnapshot d = PerfStats::Instance().Snapshot().Since(before);
+    const PerfStat& s = d.stats[PERF_SOMETHING];
+    TS_ASSERT_EQUALS(s.count, uint64_t(nThreads*nRecords));
+    TS_ASSERT_DELTA(s.sum, 0.5*nThreads*nRecords, 1e-6);
+  }
+
+  void test_quantiles() {
+    const PerfSnapshot before = PerfStats::Instance().Snapshot();
+    // 1..1000 ms, plus one far outlier
+    for(size_t i=1; i <= 1000; ++i) {
+      PerfStats::Instance().Record(PERF_MM_PRECOMPUTE, double(i));
+    }
+    PerfStats::Instance().Record(PERF_MM_PRECOMPUTE, 1e6);
+    const PerfSnapshot d = PerfStats::Instance().Snapshot().Since(before);
+    const PerfStat& s = d.stats[PERF_MM_PRECOMPUTE];
+    TS_ASSERT_EQUALS(s.count, uint64_t(1001));
+    TS_ASSERT(std::fabs(s.Quantile(0.5) - 500.0) <= 500.0/16);
+    TS_ASSERT(std::fabs(s.Quantile(0.99) - 991.0) <= 991.0/16);
+    TS_ASSERT(std::fabs(s.Quantile(1.0) - 1e6) <= 1e6/16);
+    TS_ASSERT(std::fabs(s.max - 1e6) <= 1e6/16);
+    // tiny values must not get lost either
+    TS_ASSERT_EQUALS(s.Quantile(0.0) <= 1.0 + 1.0/16, true);
+  }
+
+  void test_nondestructive() {
+    PerfStats::Instance().Record(PERF_EO_PREFETCH_HITS, 3.0);
+    const double a = PerfStats::Instance().Sum(PERF_EO_PREFETCH_HITS);
+    const double b = PerfStats::Instance().Sum(PERF_EO_PREFETCH_HITS);
+    TS_ASSERT_EQUALS(a, b);
+    TS_ASSERT(a >= 3.0);
+  }
+
+  void test_hierarchy() {
+    TS_ASSERT_EQUALS(std::string(PerfCounterName(PERF_EO_DISK_READ)),
+                     std::string("PERF_EO_DISK_READ"));
+    TS_ASSERT_EQUALS(PerfCounterParent(PERF_DY_LOAD_BRICK), PERF_DY_GET_BRICK);
+    TS_ASSERT_EQUALS(PerfCounterParent(PERF_DY_GET_BRICK),
+                     PERF_POOL_GET_BRICK);
+    TS_ASSERT_EQUALS(PerfCounterParent(PERF_RENDER), PERF_END);
+  }
+};
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/PerfTrace.h"
+#include "Basics/Threads.h"
+
+using namespace tuvok;
+
+namespace {
+  std::string slurp(const char* filename) {
+    std::ifstream ifs(filename);
+    std::ostringstream contents;
+    contents << ifs.rdbuf();
+    return contents.str();
+  }
+  size_t count(const std::string& haystack, const std::string& needle) {
+    size_t n = 0;
+    for(size_t p = haystack.find(needle); p != std::string::npos;
+        p = haystack.find(needle, p+1)) {
+      ++n;
+    }
+    return n;
+  }
+}
+
+class PerfTraceTests : public CxxTest::TestSuite {
+public:
+  void test_disabled() {
+    PerfTrace::Disable();
+    TS_ASSERT(!PerfTrace::Enabled());
+  }
+
+  void test_threads() {
+    const char* fn = ".perftrace.json";
+    PerfTrace::Enable(1024);
+    std::vector<std::shared_ptr<LambdaThread>> threads;
+    for(size_t t=0; t < 4; ++t) {
+      threads.push_back(std::make_shared<LambdaThread>(
+        [](bool const&, LambdaThread::Interface&) {
+          for(int64_t i=0; i < 10; ++i) {
+            PerfTrace::Begin(PERF_DY_GET_BRICK, i);
+            PerfTrace::Begin(PERF_EO_DECOMPRESSION);
+            PerfTrace::End(PERF_EO_DECOMPRESSION);
+            PerfTrace::End(PERF_DY_GET_BRICK);
+          }
+        }
+      ));
+    }
+    for(size_t t=0; t < threads.size(); ++t) { threads[t]->StartThread(); }
+    for(size_t t=0; t < threads.size(); ++t) { threads[t]->JoinThread(); }
+    TS_ASSERT(PerfTrace::WriteChromeTrace(fn));
+    TS_ASSERT(!PerfTrace::Enabled());
+
+    const std::string json = slurp(fn);
+    remove(fn);
+    TS_ASSERT_EQUALS(json.compare(0, 15, "{\"traceEvents\":"), 0);
+    TS_ASSERT_EQUALS(count(json, "\"ph\":\"B\""), size_t(80));
+    TS_ASSERT_EQUALS(count(json, "\"ph\":\"E\""), size_t(80));
+    TS_ASSERT_EQUALS(count(json, "\"name\":\"PERF_DY_GET_BRICK\""),
+                     size_t(80));
+    TS_ASSERT_EQUALS(count(json, "\"args\":{\"arg\":9}"), size_t(4));
+  }
+
+  // a full ring keeps the newest events
+  void test_wraparound() {
+    const char* fn = ".perftrace.json";
+    PerfTrace::Enable(256);
+    LambdaThread thread([](bool const&, LambdaThread::Interface&) {
+      for(int64_t i=0; i < 1000; ++i) {
+        PerfTrace::Begin(PERF_SOMETHING, i);
+        PerfTrace::End(PERF_SOMETHING);
+      }
+    });
+    thread.StartThread();
+    thread.JoinThread();
+    TS_ASSERT(PerfTrace::WriteChromeTrace(fn));
+    const std::string json = slurp(fn);
+    remove(fn);
+    // the thread may have inherited a larger buffer from an earlier test
+    TS_ASSERT(count(json, "\"name\":\"PERF_SOMETHING\"") < size_t(2000));
+    TS_ASSERT_EQUALS(count(json, "\"args\":{\"arg\":999}"), size_t(1));
+    TS_ASSERT_EQUALS(count(json, "\"args\":{\"arg\":0}"), size_t(0));
+  }
+};
@@ -1,10 +1,12 @@
 #include <array>
 #include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <cxxtest/TestSuite.h>
 #include "Basics/SysTools.h"
 #include "Controller/Controller.h"
 #include "DynamicBrickingDS.h"
+#include "MinMaxIndex.h"
 #include "RAWConverter.h"
 #include "uvfDataset.h"
 #include "util-test.h"
@@ -26,12 +28,13 @@ static void mk8x8(const char* filename) {
             sizeof(uint16_t) * 8*8);
   ofs.close();
 }
-static void mk_uvf(const char* filename, const char* uvf) {
+static void mk_uvf(const char* filename, const char* uvf,
+                   uint64_t bricksize=16) {
   RAWConverter::ConvertRAWDataset(filename, uvf, ".", 0, sizeof(uint16_t)*8, 1,
                                   1, false, false, false,
                                   UINT64VECTOR3(8,8,1), FLOATVECTOR3(1,1,1),
-                                  "desc", "iotest", 16, 2, true, false, 0,0,
-                                  0, NULL, false);
+                                  "desc", "iotest", bricksize, 2, true, false,
+                                  0,0, 0, NULL, false);
 }
 
 // creates an 8x8x1 uvf test data set and returns it.
@@ -273,6 +276,68 @@ void tdata_half_split() {
   verify_half_split(dynamic);
 }
 
+// a view of the half-split brick must see the same data as GetBrick, but
+// with the pitch of the source brick.
+void tview_half_split() {
+  std::shared_ptr<UVFDataset> ds = mk8x8testdata();
+  DynamicBrickingDS dynamic(ds, {{6,16,16}}, cacheBytes);
+  for(size_t b=0; b < 2; ++b) {
+    const BrickKey bk(0,0,b);
+    std::vector<uint8_t> copied;
+    TS_ASSERT(dynamic.GetBrick(bk, copied));
+    BrickView<uint8_t> view;
+    TS_ASSERT(dynamic.GetBrickView(bk, view));
+    TS_ASSERT_EQUALS(view.extents[0], 6U);
+    TS_ASSERT_EQUALS(view.pitch[0], 12U);
+    TS_ASSERT(!view.contiguous());
+    std::vector<uint8_t> viewed;
+    view.copy(viewed);
+    TS_ASSERT_EQUALS(viewed.size(), copied.size());
+    TS_ASSERT(std::equal(viewed.begin(), viewed.end(), copied.begin()));
+  }
+}
+
+// rebricking upward: the source has 2x2 bricks of 4x4 voxels (sans ghost),
+// the target brick is stitched together from all four of them.
+void tdata_stitched() {
+  mk8x8("abc");
+  mk_uvf("abc", "small-bricks.uvf", 8);
+  std::shared_ptr<UVFDataset> ds(new UVFDataset("small-bricks.uvf", 8,
+                                                false));
+  TS_ASSERT_EQUALS(ds->GetBrickLayout(0,0)[0], 2U);
+  TS_ASSERT_EQUALS(ds->GetBrickLayout(0,0)[1], 2U);
+  DynamicBrickingDS dynamic(ds, {{12,12,12}}, cacheBytes,
+                            DynamicBrickingDS::MM_SOURCE);
+  TS_ASSERT_EQUALS(dynamic.GetBrickLayout(0,0)[0], 1U);
+  TS_ASSERT_EQUALS(dynamic.GetBrickLayout(0,0)[1], 1U);
+
+  const BrickKey bk(0,0,0);
+  const UINTVECTOR3 bs = dynamic.GetBrickMetadata(bk).n_voxels;
+  TS_ASSERT_EQUALS(bs[0], 12U);
+  TS_ASSERT_EQUALS(bs[1], 12U);
+  TS_ASSERT_EQUALS(bs[2],  5U);
+
+  std::vector<uint8_t> d;
+  TS_ASSERT(dynamic.GetBrick(bk, d));
+  TS_ASSERT_EQUALS(d.size(), bs.volume());
+  const size_t slice_sz = bs[0] * bs[1];
+  const size_t offset = ghost()/2;
+  for(size_t y=offset; y < bs[1]-offset; ++y) {
+    for(size_t x=offset; x < bs[0]-offset; ++x) {
+      const size_t idx = slice_sz*2 + y*bs[0] + x;
+      TS_ASSERT_EQUALS(d[idx], data[y-offset][x-offset]);
+    }
+  }
+
+  // there is no single source brick to look at.
+  BrickView<uint8_t> view;
+  TS_ASSERT(!dynamic.GetBrickView(bk, view));
+  // source min/maxes are merged over all the source bricks.
+  const MinMaxBlock mm = dynamic.MaxMinForKey(bk);
+  TS_ASSERT_DELTA(mm.minScalar, 0.0, 0.001);
+  TS_ASSERT_DELTA(mm.maxScalar, 63.0, 0.001);
+}
+
 // tests GetBrickVoxelCount API.
 void tvoxel_count() {
   std::shared_ptr<UVFDataset> ds = mk8x8testdata();
@@ -415,6 +480,77 @@ void tminmax_dynamic() {
   TS_ASSERT_DELTA(mm.maxScalar, 63.0, 0.001);
 }
 
+// precomputed min/maxes land in an index next to the data.  Reopening must
+// reuse it, a damaged index must be rebuilt, and either way the values must
+// match what MM_DYNAMIC computes.
+static void check_minmax(const DynamicBrickingDS& a,
+                         const DynamicBrickingDS& b) {
+  for(auto k = a.BricksBegin(); k != a.BricksEnd(); ++k) {
+    const MinMaxBlock ma = a.MaxMinForKey(k->first);
+    const MinMaxBlock mb = b.MaxMinForKey(k->first);
+    TS_ASSERT_DELTA(ma.minScalar, mb.minScalar, 0.001);
+    TS_ASSERT_DELTA(ma.maxScalar, mb.maxScalar, 0.001);
+  }
+}
+void tminmax_index() {
+  std::shared_ptr<UVFDataset> ds = mk8x8testdata();
+  const std::array<size_t,3> bsize = {{16,8,16}};
+  const std::string idx = MinMaxIndex::Filename(ds->Filename(), bsize);
+  std::remove(idx.c_str());
+
+  DynamicBrickingDS dynamic(ds, bsize, cacheBytes,
+                            DynamicBrickingDS::MM_DYNAMIC);
+  {
+    DynamicBrickingDS pre(ds, bsize, cacheBytes,
+                          DynamicBrickingDS::MM_PRECOMPUTE);
+    TS_ASSERT(SysTools::FileExists(idx));
+    check_minmax(pre, dynamic);
+  }
+  {
+    DynamicBrickingDS reopened(ds, bsize, cacheBytes,
+                               DynamicBrickingDS::MM_PRECOMPUTE);
+    check_minmax(reopened, dynamic);
+  }
+  {
+    std::fstream f(idx.c_str(), std::ios::in | std::ios::out |
+                                std::ios::binary);
+    f.seekp(-1, std::ios::end);
+    f.put('\x7f');
+  }
+  DynamicBrickingDS rebuilt(ds, bsize, cacheBytes,
+                            DynamicBrickingDS::MM_PRECOMPUTE);
+  check_minmax(rebuilt, dynamic);
+  std::remove(idx.c_str());
+}
+
+// the batched classification must agree with asking brick by brick.
+static void check_visible(const LinearIndexDataset& ds, double lo, double hi) {
+  std::vector<uint64_t> visible;
+  ds.ComputeVisibleBricks(0, lo, hi, visible);
+  for(auto b = ds.BricksBegin(); b != ds.BricksEnd(); ++b) {
+    if(std::get<0>(b->first) != 0) { continue; }
+    const size_t idx = ds.MinMaxTableIndex(b->first);
+    TS_ASSERT_EQUALS(MinMaxTable::IsVisible(visible, idx),
+                     ds.ContainsData(b->first, lo, hi));
+  }
+}
+void tvisible_bricks() {
+  std::shared_ptr<UVFDataset> ds = mk8x8testdata();
+  // ContainsData forwards to the source bricks, so the table must, too.
+  DynamicBrickingDS dynamic(ds, {{16,8,16}}, cacheBytes,
+                            DynamicBrickingDS::MM_SOURCE);
+  const double ranges[][2] = {{0,0}, {10,20}, {47.5,48}, {60,100}, {-5,-1}};
+  for(size_t r=0; r < sizeof(ranges)/sizeof(ranges[0]); ++r) {
+    check_visible(*ds, ranges[r][0], ranges[r][1]);
+    check_visible(dynamic, ranges[r][0], ranges[r][1]);
+  }
+
+  // the table is built once, not on every query.
+  std::shared_ptr<const MinMaxTable> table = dynamic.GetMinMaxTable(0);
+  TS_ASSERT(table->GetLayout() == dynamic.GetBrickLayouts(0));
+  TS_ASSERT_EQUALS(table.get(), dynamic.GetMinMaxTable(0).get());
+}
+
 void tcache_disable() {
   std::shared_ptr<UVFDataset> ds = mk8x8testdata();
   DynamicBrickingDS dynamic(ds, {{6,16,16}}, cacheBytes);
@@ -513,6 +649,8 @@ public:
   void test_domain_size() { tdomain_size(); }
   void test_data_simple() { tdata_simple(); }
   void test_data_half_split() { tdata_half_split(); }
+  void test_view_half_split() { tview_half_split(); }
+  void test_data_stitched() { tdata_stitched(); }
   void test_voxel_count() { tvoxel_count(); }
   void test_metadata() { tmetadata(); }
   void test_real() { trealdata(); }
@@ -521,6 +659,8 @@ public:
   void test_brick_sizes() { tbsizes(); }
   void test_precompute() { tprecompute(); }
   void test_minmax_dynamic() { tminmax_dynamic(); }
+  void test_minmax_index() { tminmax_index(); }
+  void test_visible_bricks() { tvisible_bricks(); }
   void test_cache_disable() { tcache_disable(); }
   void test_engine_four() { tengine_four(); }
   void test_rmi_bench() { rmi_bench(); }
@@ -0,0 +1,164 @@
+#include <memory>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Renderer/GPUMemMan/ResidencyTable.h"
+
+using namespace tuvok;
+
+namespace {
+  // stands in for a GL texture
+  struct FakeTexture { int id; };
+
+  const UINTVECTOR3 size(64,64,64);
+  ResidencyKey key(size_t brick, uint32_t flags=0, int shareGroup=0) {
+    static const int dataset = 0;
+    return ResidencyKey(&dataset, BrickKey(0, 0, brick), flags, shareGroup);
+  }
+}
+
+class ResidencyTests : public CxxTest::TestSuite {
+public:
+  void test_lookup() {
+    ResidencyTable<FakeTexture> table;
+    FakeTexture a = {1};
+    table.Insert(key(1), size, &a, 100, 100, 0, 0);
+    TS_ASSERT_EQUALS(table.Find(key(1)), &a);
+    TS_ASSERT(table.Find(key(2)) == NULL);
+    TS_ASSERT(table.Find(key(1, 2)) == NULL);
+    TS_ASSERT(table.Find(key(1, 0, 1)) == NULL);
+
+    TS_ASSERT_EQUALS(table.Acquire(key(1), 0, 1), &a);
+    TS_ASSERT_EQUALS(table.Users(&a), 2u);
+    TS_ASSERT(table.Release(&a));
+    TS_ASSERT(table.Victim(0) == NULL);
+    TS_ASSERT(table.Release(&a));
+    TS_ASSERT_EQUALS(table.Victim(0), &a);
+    TS_ASSERT(!table.Release(&a));
+
+    table.Remove(&a);
+    TS_ASSERT(table.empty());
+    TS_ASSERT(table.Victim() == NULL);
+  }
+
+  // oldest frame first; within a frame, the last one used
+  void test_frame_counter() {
+    ResidencyTable<FakeTexture> table;
+    FakeTexture t[3] = {{0}, {1}, {2}};
+    table.Insert(key(0), size, &t[0], 100, 100, 5, 1);
+    table.Insert(key(1), size, &t[1], 100, 100, 9, 1);
+    table.Insert(key(2), size, &t[2], 100, 100, 0, 2);
+    for(size_t i=0; i < 3; ++i) { table.Release(&t[i]); }
+    TS_ASSERT_EQUALS(table.Victim(0), &t[1]);
+    table.Evict(&t[1]);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[0]);
+    table.Evict(&t[0]);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[2]);
+  }
+
+  void test_lru() {
+    ResidencyTable<FakeTexture> table;
+    table.SetPolicy(std::unique_ptr<EvictionPolicy>(new LRUEviction()));
+    FakeTexture t[3] = {{0}, {1}, {2}};
+    for(size_t i=0; i < 3; ++i) {
+      table.Insert(key(i), size, &t[i], 100, 100, 0, 0);
+    }
+    table.Release(&t[2]);
+    table.Release(&t[0]);
+    table.Release(&t[1]);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[2]);
+    // using it again moves it to the back
+    table.Acquire(key(2), 0, 0);
+    table.Release(&t[2]);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[0]);
+  }
+
+  void test_policy_switch() {
+    ResidencyTable<FakeTexture> table;
+    FakeTexture t[2] = {{0}, {1}};
+    table.Insert(key(0), size, &t[0], 100, 100, 0, 5);
+    table.Insert(key(1), size, &t[1], 100, 100, 0, 1);
+    table.Release(&t[0]);
+    table.Release(&t[1]);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[1]);
+    table.SetPolicy(std::unique_ptr<EvictionPolicy>(new LRUEviction()));
+    TS_ASSERT_EQUALS(table.Victim(0), &t[0]);
+  }
+
+  // bricks which are expensive per byte stay longer
+  void test_cost_aware() {
+    ResidencyTable<FakeTexture> table;
+    table.SetPolicy(std::unique_ptr<EvictionPolicy>(new CostAwareEviction()));
+    FakeTexture t[3] = {{0}, {1}, {2}};
+    table.Insert(key(0), size, &t[0], 100, 400, 0, 0);
+    table.Insert(key(1), size, &t[1], 100, 100, 0, 0);
+    table.Release(&t[0]);
+    table.Release(&t[1]);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[1]);
+    table.Evict(&t[1]);
+    // aging: t[2] costs as much per byte as t[0], but was released after
+    // the eviction inflated the priorities, so t[0] goes first
+    table.Insert(key(2), size, &t[2], 100, 400, 0, 0);
+    table.Release(&t[2]);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[0]);
+  }
+
+  void test_reuse() {
+    ResidencyTable<FakeTexture> table;
+    FakeTexture t[2] = {{0}, {1}};
+    table.Insert(key(0), size, &t[0], 100, 100, 0, 0);
+    table.Insert(key(1), UINTVECTOR3(32,64,64), &t[1], 50, 50, 0, 0);
+    TS_ASSERT(table.Reuse(SizeClass(size, 0, 0), key(5), 0, 1) == NULL);
+    table.Release(&t[0]);
+    table.Release(&t[1]);
+
+    TS_ASSERT(table.Reuse(SizeClass(size, 2, 0), key(5, 2), 0, 1) == NULL);
+    TS_ASSERT(table.Reuse(SizeClass(size, 0, 1), key(5, 0, 1), 0, 1) ==
+              NULL);
+    TS_ASSERT(table.Reuse(SizeClass(UINTVECTOR3(64,64,32), 0, 0), key(5),
+                          0, 1) == NULL);
+    TS_ASSERT_EQUALS(table.Reuse(SizeClass(size, 0, 0), key(5), 0, 1),
+                     &t[0]);
+    TS_ASSERT(table.Find(key(0)) == NULL);
+    TS_ASSERT_EQUALS(table.Find(key(5)), &t[0]);
+    TS_ASSERT_EQUALS(table.Users(&t[0]), 1u);
+    TS_ASSERT_EQUALS(table.Victim(0), &t[1]);
+  }
+
+  void test_least_used() {
+    ResidencyTable<FakeTexture> table;
+    FakeTexture t[3] = {{0}, {1}, {2}};
+    for(size_t i=0; i < 3; ++i) {
+      table.Insert(key(i), size, &t[i], 100, 100, 0, 0);
+    }
+    table.Insert(key(9, 0, 1), size, new FakeTexture(), 100, 100, 0, 0);
+    table.Acquire(key(0), 0, 0);
+    table.Acquire(key(2), 0, 0);
+    TS_ASSERT(table.Victim(0) == NULL);
+    TS_ASSERT_EQUALS(table.LeastUsed(0), &t[1]);
+    table.Release(&t[2]);
+    table.Release(&t[2]);
+    TS_ASSERT_EQUALS(table.LeastUsed(0), &t[2]);
+    TS_ASSERT(table.LeastUsed(7) == NULL);
+
+    std::vector<FakeTexture*> values = table.Values();
+    TS_ASSERT_EQUALS(values.size(), size_t(4));
+    delete table.Find(key(9, 0, 1));
+  }
+
+  void test_many() {
+    ResidencyTable<FakeTexture> table;
+    std::vector<FakeTexture> t(10000);
+    for(size_t i=0; i < t.size(); ++i) {
+      t[i].id = int(i);
+      table.Insert(key(i), size, &t[i], 100, 100, i, 1);
+    }
+    for(size_t i=0; i < t.size(); ++i) { table.Release(&t[i]); }
+    // same frame: the highest intra frame counter goes first
+    for(size_t i=t.size(); i > 0; --i) {
+      FakeTexture* v = table.Victim();
+      TS_ASSERT_EQUALS(v, &t[i-1]);
+      table.Evict(v);
+    }
+    TS_ASSERT(table.empty());
+  }
+};
@@ -0,0 +1,71 @@
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "Basics/EndianConvert.h"
+#include "SliceConversion.h"
+
+namespace {
+  // the kernels must give what a plain loop with casts gives, including
+  // values which wrap around
+  template<typename T>
+  void scale_bias(float fScale, float fBias) {
+    std::mt19937 rng(42);
+    std::vector<T> data(1003);
+    for(size_t i=0; i < data.size(); ++i) { data[i] = static_cast<T>(rng()); }
+    std::vector<T> ref(data);
+    for(size_t i=0; i < ref.size(); ++i) {
+      ref[i] = static_cast<T>(static_cast<int32_t>(ref[i]*fScale + fBias));
+    }
+    tuvok::ScaleBias(&data[0], data.size(), sizeof(T)*8,
+                     std::numeric_limits<T>::is_signed, fScale, fBias);
+    TS_ASSERT(data == ref);
+  }
+
+  template<typename T>
+  void swap() {
+    std::vector<T> data(1001);
+    for(size_t i=0; i < data.size(); ++i) {
+      data[i] = static_cast<T>(i * 2654435761u);
+    }
+    std::vector<T> ref(data);
+    for(size_t i=0; i < ref.size(); ++i) {
+      ref[i] = EndianConvert::Swap<T>(ref[i]);
+    }
+    tuvok::SwapEndianness(&data[0], data.size(), sizeof(T)*8);
+    TS_ASSERT(data == ref);
+  }
+}
+
+class SliceConversionTests : public CxxTest::TestSuite {
+public:
+  void test_scale_bias() {
+    const float scale[] = { 1.0f, 0.5f, 2.3f, -1.7f };
+    const float bias[] = { 0.0f, -1024.0f, 3.7f, 70000.0f };
+    for(size_t s=0; s < 4; ++s) {
+      for(size_t b=0; b < 4; ++b) {
+        scale_bias<int8_t>(scale[s], bias[b]);
+        scale_bias<uint8_t>(scale[s], bias[b]);
+        scale_bias<int16_t>(scale[s], bias[b]);
+        scale_bias<uint16_t>(scale[s], bias[b]);
+        scale_bias<int32_t>(scale[s], bias[b] / 1000.0f);
+      }
+    }
+  }
+  void test_swap() {
+    swap<uint16_t>();
+    swap<uint32_t>();
+  }
+  void test_expand_rgb() {
+    std::vector<unsigned char> data(4*333);
+    for(size_t i=0; i < 3*333; ++i) { data[i] = static_cast<unsigned char>(i); }
+    tuvok::ExpandRGBToRGBA(&data[0], 333);
+    for(size_t i=0; i < 333; ++i) {
+      for(size_t c=0; c < 3; ++c) {
+        TS_ASSERT_EQUALS(data[i*4+c], static_cast<unsigned char>(i*3+c));
+      }
+      TS_ASSERT_EQUALS(data[i*4+3], 255);
+    }
+  }
+};
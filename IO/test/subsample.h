@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cxxtest/TestSuite.h>
+
+#include "LargeRAWFile.h"
+#include "UVF/RasterDataBlock.h"
+
+#include "util-test.h"
+
+namespace {
+  // exposes SubSample.  LR_CUSTOM forces the generic path.
+  struct SubSampleRDB : public RasterDataBlock {
+    using RasterDataBlock::SubSample;
+  };
+
+  typedef void (*combine_t)(const std::vector<uint64_t>&, uint64_t,
+                            const void*, void*);
+
+  template<class T, size_t n>
+  std::vector<T> subsample(const std::vector<T>& data,
+                           const std::vector<uint64_t>& src,
+                           const std::vector<uint64_t>& tgt,
+                           combine_t combine, LODReduction reduction,
+                           bool in_place) {
+    SubSampleRDB rdb;
+    rdb.SetTypeToVector(sizeof(T)*8,
+                        std::numeric_limits<T>::is_integer
+                          ? sizeof(T)*8 : (sizeof(T) == 4 ? 23 : 52),
+                        std::numeric_limits<T>::is_signed,
+                        std::vector<UVFTables::ElementSemanticTable>(
+                          n, UVFTables::ES_UNDEFINED));
+
+    std::ofstream ofs;
+    const std::string fn = mk_tmpfile(ofs, std::ios::out | std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(&data[0]), data.size()*sizeof(T));
+    ofs.close();
+    LargeRAWFile_ptr source(new LargeRAWFile(fn));
+    source->Open(true);
+
+    LargeRAWFile_ptr target = source;
+    std::string tfn;
+    if(!in_place) {
+      std::ofstream tofs;
+      tfn = mk_tmpfile(tofs, std::ios::out | std::ios::binary);
+      tofs.close();
+      target = LargeRAWFile_ptr(new LargeRAWFile(tfn));
+      target->Create();
+    }
+
+    rdb.SubSample(source, target, src, tgt, combine, NULL, 0, 0, reduction);
+
+    uint64_t elems = n;
+    for(size_t i=0; i < tgt.size(); ++i) { elems *= tgt[i]; }
+    std::vector<T> result(static_cast<size_t>(elems));
+    target->SeekStart();
+    target->ReadRAW(reinterpret_cast<unsigned char*>(&result[0]),
+                    result.size()*sizeof(T));
+    source->Close();
+    target->Close();
+    remove(fn.c_str());
+    if(!in_place) { remove(tfn.c_str()); }
+    return result;
+  }
+
+  // reference: evaluates the combine function directly on each footprint
+  template<class T, size_t n>
+  std::vector<T> reference(const std::vector<T>& data,
+                           const std::vector<uint64_t>& src,
+                           const std::vector<uint64_t>& tgt,
+                           combine_t combine) {
+    const uint64_t rx = src[0]/tgt[0], ry = src[1]/tgt[1],
+                   rz = src[2]/tgt[2];
+    std::vector<T> result(static_cast<size_t>(tgt[0]*tgt[1]*tgt[2]*n));
+    std::vector<uint64_t> offsets;
+    for(uint64_t z=0; z < tgt[2]; ++z) {
+      for(uint64_t y=0; y < tgt[1]; ++y) {
+        for(uint64_t x=0; x < tgt[0]; ++x) {
+          offsets.clear();
+          for(uint64_t dz=0; dz < rz; ++dz)
+            for(uint64_t dy=0; dy < ry; ++dy)
+              for(uint64_t dx=0; dx < rx; ++dx)
+                offsets.push_back(x*rx+dx + (y*ry+dy)*src[0] +
+                                  (z*rz+dz)*src[0]*src[1]);
+          combine(offsets, x+y*tgt[0]+z*tgt[0]*tgt[1], &data[0], &result[0]);
+        }
+      }
+    }
+    return result;
+  }
+
+  template<class T, size_t n>
+  void ss_compare(uint64_t sx, uint64_t sy, uint64_t sz,
+                  uint64_t tx, uint64_t ty, uint64_t tz) {
+    std::vector<uint64_t> src, tgt;
+    src.push_back(sx); src.push_back(sy); src.push_back(sz);
+    tgt.push_back(tx); tgt.push_back(ty); tgt.push_back(tz);
+
+    std::vector<T> data(static_cast<size_t>(sx*sy*sz*n));
+    std::mt19937 rng(42);
+    for(size_t i=0; i < data.size(); ++i) {
+      data[i] = static_cast<T>(rng() % 200) - static_cast<T>(
+                  std::numeric_limits<T>::is_signed ? 100 : 0);
+    }
+
+    const combine_t average = n == 1 ? combine_t(&CombineAverage<T>)
+                                     : combine_t(&CombineAverage<T,n>);
+
+    const std::vector<T> ref = reference<T,n>(data, src, tgt, average);
+    TS_ASSERT((subsample<T,n>(data, src, tgt, average, LR_AVERAGE, false)
+               == ref));
+    TS_ASSERT((subsample<T,n>(data, src, tgt, average, LR_AVERAGE, true)
+               == ref));
+    TS_ASSERT((subsample<T,n>(data, src, tgt, average, LR_CUSTOM, false)
+               == ref));
+    TS_ASSERT((subsample<T,n>(data, src, tgt, average, LR_CUSTOM, true)
+               == ref));
+  }
+}
+
+class TestSubSample : public CxxTest::TestSuite {
+public:
+  void test_average_2x2x2() {
+    ss_compare<uint8_t,1>(8,6,4, 4,3,2);
+    ss_compare<int16_t,1>(9,7,5, 4,3,2);
+    ss_compare<uint32_t,1>(8,6,4, 4,3,2);
+    ss_compare<float,1>(8,6,4, 4,3,2);
+    ss_compare<double,1>(8,6,4, 4,3,2);
+  }
+  void test_average_vector() {
+    ss_compare<uint8_t,4>(8,6,4, 4,3,2);
+    ss_compare<float,3>(9,7,5, 4,3,2);
+    ss_compare<int8_t,2>(8,8,8, 4,4,4);
+  }
+  void test_average_nxmxk() {
+    ss_compare<uint16_t,1>(9,6,4, 3,3,2);
+    ss_compare<float,1>(9,9,9, 3,3,3);
+    ss_compare<int32_t,1>(12,5,7, 4,1,7);
+  }
+};
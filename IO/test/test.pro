@@ -52,7 +52,7 @@ contains(QMAKE_PRL_CONFIG, shared) {
 }
 
 #TEST_HEADERS=quantize.h largefile.h rebricking.h cbi.h bcache.h
-TEST_HEADERS=quantize.h largefile.h rebricking.h bcache.h
+TEST_HEADERS=quantize.h largefile.h rebricking.h bcache.h subsample.h mc.h tf2d.h sliceconversion.h compressedraw.h datamerger.h concurrentbricks.h typeconversion.h perfstats.h perftrace.h asynclog.h residency.h blockchecksums.h octreeconverter.h histogram.h isosurface.h expression.h
 
 TG_PARAMS=--have-eh --abort-on-fail --no-static-init --error-printer
 alltests.target = alltests.cpp
@@ -0,0 +1,136 @@
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "TransferFunction2D.h"
+
+namespace {
+  TFPolygon quad(float x0, float y0, float x1, float y1,
+                 const FLOATVECTOR4& c0, const FLOATVECTOR4& c1) {
+    TFPolygon p;
+    p.pPoints.push_back(FLOATVECTOR2(x0, y0));
+    p.pPoints.push_back(FLOATVECTOR2(x1, y0));
+    p.pPoints.push_back(FLOATVECTOR2(x1, y1));
+    p.pPoints.push_back(FLOATVECTOR2(x0, y1));
+    p.pGradientCoords[0] = FLOATVECTOR2(x0, y0);
+    p.pGradientCoords[1] = FLOATVECTOR2(x1, y1);
+    p.pGradientStops.push_back(GradientStop(0.0f, c0));
+    p.pGradientStops.push_back(GradientStop(1.0f, c1));
+    return p;
+  }
+
+  // RGBA of every pixel
+  std::vector<unsigned char> render(TransferFunction2D& tf) {
+    std::vector<unsigned char> v(tf.GetSize().area()*4);
+    unsigned char* p = &v[0];
+    tf.GetByteArray(&p);
+    return v;
+  }
+  const unsigned char* pixel(const std::vector<unsigned char>& v,
+                             const TransferFunction2D& tf,
+                             size_t x, size_t y) {
+    return &v[4*(y*tf.GetSize().x + x)];
+  }
+
+  TransferFunction1D ramp(size_t n) {
+    TransferFunction1D tf(n);
+    for(size_t i=0; i < n; ++i) {
+      tf.SetColor(i, FLOATVECTOR4(float(i)/(n-1), 0.5f, 0.0f, 0.25f));
+    }
+    return tf;
+  }
+}
+
+class TF2DTests : public CxxTest::TestSuite {
+public:
+  // swatches must render without any window system
+  void test_swatch() {
+    TransferFunction2D tf(VECTOR2<size_t>(64, 32));
+    TransferFunction1D tf1d = ramp(64);
+    tf.Update1DTrans(&tf1d);
+    const FLOATVECTOR4 red(1,0,0,1);
+    tf.SwatchPushBack(quad(0.25f, 0.25f, 0.75f, 0.75f, red, red));
+    std::vector<unsigned char> v = render(tf);
+
+    const unsigned char* inside = pixel(v, tf, 32, 16);
+    TS_ASSERT_EQUALS(inside[0], 255);
+    TS_ASSERT_EQUALS(inside[1], 0);
+    TS_ASSERT_EQUALS(inside[2], 0);
+    TS_ASSERT_EQUALS(inside[3], 255);
+    // outside, the 1D TF shows through
+    for(size_t x=0; x < 64; x += 9) {
+      const unsigned char* bg = pixel(v, tf, x, 2);
+      TS_ASSERT_EQUALS(bg[0], int(float(x)/63*255));
+      TS_ASSERT_EQUALS(bg[1], 127);
+      TS_ASSERT_EQUALS(bg[2], 0);
+      TS_ASSERT_EQUALS(bg[3], 63);
+    }
+
+    tf.ComputeNonZeroLimits();
+    TS_ASSERT_EQUALS(tf.GetNonZeroLimits(), UINT64VECTOR4(0, 63, 0, 31));
+  }
+
+  void test_gradient() {
+    TransferFunction2D tf(VECTOR2<size_t>(100, 10));
+    TFPolygon p = quad(0, 0, 1, 1, FLOATVECTOR4(0,0,0,1),
+                       FLOATVECTOR4(1,1,1,1));
+    p.pGradientCoords[1] = FLOATVECTOR2(1, 0);
+    tf.SwatchPushBack(p);
+    std::vector<unsigned char> v = render(tf);
+    for(size_t x=1; x < 100; ++x) {
+      TS_ASSERT_LESS_THAN(pixel(v, tf, x-1, 5)[0], pixel(v, tf, x, 5)[0]);
+      TS_ASSERT_EQUALS(pixel(v, tf, x, 5)[0], pixel(v, tf, x, 0)[0]);
+    }
+
+    // radial: brightest far from the center
+    p.bRadial = true;
+    p.pGradientCoords[0] = FLOATVECTOR2(0.5f, 0.5f);
+    tf.SwatchUpdate(0, p);
+    tf.InvalidateCache();
+    v = render(tf);
+    TS_ASSERT_LESS_THAN(pixel(v, tf, 50, 5)[0], pixel(v, tf, 70, 5)[0]);
+    TS_ASSERT_EQUALS(pixel(v, tf, 40, 5)[0], pixel(v, tf, 59, 4)[0]);
+  }
+
+  // redrawing only what changed gives the same result as drawing it all
+  void test_incremental() {
+    const VECTOR2<size_t> size(96, 48);
+    TransferFunction1D tf1d = ramp(96);
+    TransferFunction2D tf(size);
+    tf.Update1DTrans(&tf1d);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(-0.1f, 1.1f);
+    for(size_t i=0; i < 5; ++i) {
+      tf.SwatchPushBack(quad(u(rng), u(rng), u(rng), u(rng),
+                             FLOATVECTOR4(u(rng), u(rng), u(rng), u(rng)),
+                             FLOATVECTOR4(u(rng), u(rng), u(rng), u(rng))));
+    }
+    render(tf);
+
+    for(size_t edit=0; edit < 40; ++edit) {
+      const size_t n = tf.SwatchArrayGetSize();
+      const size_t i = n ? rng() % n : 0;
+      switch(rng() % 4) {
+        case 0: if(n > 1) { tf.SwatchErase(i); } break;
+        case 1:
+          tf.SwatchInsert(i, quad(u(rng), u(rng), u(rng), u(rng),
+                                  FLOATVECTOR4(1,0,1,u(rng)),
+                                  FLOATVECTOR4(0,1,0,u(rng))));
+          break;
+        case 2:
+          if(n) { tf.SwatchInsertPoint(i, 1, FLOATVECTOR2(u(rng), u(rng))); }
+          break;
+        case 3: if(n) { tf.SwatchSetRadial(i, !tf.SwatchIsRadial(i)); } break;
+      }
+      tf.InvalidateCache();
+      const std::vector<unsigned char> incremental = render(tf);
+
+      TransferFunction2D fresh(size);
+      fresh.Update1DTrans(&tf1d);
+      for(size_t s=0; s < tf.SwatchArrayGetSize(); ++s) {
+        fresh.SwatchPushBack((*tf.SwatchGet())[s]);
+      }
+      TS_ASSERT(incremental == render(fresh));
+    }
+  }
+};
@@ -0,0 +1,76 @@
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include "TypeConversion.h"
+
+using namespace tuvok;
+
+namespace {
+  // values spread over the whole range of S, extremes included
+  template<class S> std::vector<S> mk_input(size_t n, double lo, double hi) {
+    std::vector<S> v(n);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> dist(lo, hi);
+    for(size_t i=0; i < n; ++i) { v[i] = static_cast<S>(dist(rng)); }
+    if(n > 1) { v[0] = static_cast<S>(lo); v[n-1] = static_cast<S>(hi); }
+    return v;
+  }
+
+  template<class S, class D> void check(double lo, double hi) {
+    const std::pair<double, double> range(lo, hi);
+    const double factor = double(std::numeric_limits<D>::max()) / (hi-lo);
+    // odd sizes, so that the scalar tail is exercised too
+    for(size_t n=0; n < 23; n += 7) {
+      const std::vector<S> in = mk_input<S>(n, lo, hi);
+      std::vector<D> out(n);
+      TS_ASSERT(ConvertRange(in.empty() ? NULL : &in[0], ElementTypeOf<S>(),
+                             n, range, out.empty() ? NULL : &out[0]));
+      for(size_t i=0; i < n; ++i) {
+        TS_ASSERT_EQUALS(out[i],
+                         static_cast<D>((double(in[i]) - lo) * factor));
+      }
+      if(sizeof(D) < sizeof(S)) { continue; }
+
+      // and the same again, converting in place
+      std::vector<D> inplace(n);
+      if(n > 0) { std::memcpy(&inplace[0], &in[0], n*sizeof(S)); }
+      TS_ASSERT(ConvertRange(inplace.empty() ? NULL : &inplace[0],
+                             ElementTypeOf<S>(), n, range,
+                             inplace.empty() ? NULL : &inplace[0]));
+      TS_ASSERT(inplace == out);
+    }
+  }
+
+  template<class D> void check_all() {
+    check<uint8_t, D>(0, 255);
+    check<int8_t, D>(-128, 127);
+    check<uint16_t, D>(0, 65535);
+    check<int16_t, D>(-32768, 32767);
+    check<uint32_t, D>(0, 4294967295.0);
+    check<int32_t, D>(-2147483648.0, 2147483647.0);
+    check<float, D>(-5.5, 1000.25);
+    check<double, D>(-1e3, 1e4);
+  }
+}
+
+class TypeConversionTests : public CxxTest::TestSuite {
+public:
+  void test_to_uint8() { check_all<uint8_t>(); }
+  void test_to_int8() { check_all<int8_t>(); }
+  void test_to_uint16() { check_all<uint16_t>(); }
+  void test_to_int16() { check_all<int16_t>(); }
+  void test_to_uint32() { check_all<uint32_t>(); }
+  void test_to_int32() { check_all<int32_t>(); }
+  void test_to_float() { check_all<float>(); }
+  void test_to_double() { check_all<double>(); }
+  void test_unsupported() {
+    std::vector<uint64_t> in(4, 1);
+    std::vector<uint16_t> out(4);
+    TS_ASSERT(!ConvertRange(&in[0], ElementType(64, false, false), 4,
+                            std::make_pair(0.0, 1.0), &out[0]));
+  }
+};
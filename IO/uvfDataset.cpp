@@ -27,6 +27,7 @@
 */
 
 #include <cstring>
+#include <map>
 #include <sstream>
 
 #include "uvfDataset.h"
@@ -238,6 +239,39 @@ void UVFDataset::ComputeMetaData(size_t timestep) {
   } else {
     this->ComputeMetadataRDB(timestep);
   }
+  this->ComputeMinMaxTable(timestep);
+}
+
+// Both the ToC and the raster data block serialize the acceleration data in
+// our 4D brick order, so the table is a straight copy of the relevant
+// component.  Without acceleration data every brick must be considered.
+void UVFDataset::ComputeMinMaxTable(size_t timestep) {
+  Timestep* ts = m_timesteps[timestep];
+  ts->m_pMinMaxTable.reset(new MinMaxTable(GetBrickLayouts(timestep)));
+  const size_t n_bricks = ts->m_pMinMaxTable->size();
+
+  MinMaxBlock everything;
+  everything.minScalar = everything.minGradient =
+    -std::numeric_limits<double>::max();
+  everything.maxScalar = everything.maxGradient =
+    std::numeric_limits<double>::max();
+
+  // for four-component data we use the fourth component (presumably the
+  // alpha channel); for all other data we use the first component
+  /// \todo we may have to change this if we add support for other kinds of
+  /// multicomponent data.
+  const size_t component = (GetComponentCount() == 4) ? 3 : 0;
+  for(size_t i=0; i < n_bricks; ++i) {
+    if(ts->m_pMaxMinData == NULL) {
+      ts->m_pMinMaxTable->Set(i, everything);
+      continue;
+    }
+    try {
+      ts->m_pMinMaxTable->Set(i, ts->m_pMaxMinData->GetValue(i, component));
+    } catch(const std::length_error&) {
+      ts->m_pMinMaxTable->Set(i, everything);
+    }
+  }
 }
 void UVFDataset::ComputeMetadataTOC(size_t timestep) {
   TOCTimestep* ts = static_cast<TOCTimestep*>(m_timesteps[timestep]);
@@ -313,9 +347,6 @@ void UVFDataset::ComputeMetadataRDB(size_t timestep) {
   ));
 
   ts->m_vvaBrickSize.resize(iLODLevel);
-  if (ts->m_pMaxMinData) {
-    ts->m_vvaMaxMin.resize(iLODLevel);
-  }
 
   for (size_t j = 0;j<iLODLevel;j++) {
     std::vector<uint64_t> vLOD;  vLOD.push_back(j);
@@ -326,9 +357,6 @@ void UVFDataset::ComputeMetadataRDB(size_t timestep) {
     ts->m_vaBrickCount.push_back(UINT64VECTOR3(vBrickCount[0], vBrickCount[1], vBrickCount[2]));
 
     ts->m_vvaBrickSize[j].resize(size_t(ts->m_vaBrickCount[j].x));
-    if (ts->m_pMaxMinData) {
-      ts->m_vvaMaxMin[j].resize(size_t(ts->m_vaBrickCount[j].x));
-    }
 
     FLOATVECTOR3 vBrickCorner;
 
@@ -338,16 +366,9 @@ void UVFDataset::ComputeMetadataRDB(size_t timestep) {
     BrickMD bmd;
     for (uint64_t x=0; x < ts->m_vaBrickCount[j].x; x++) {
       ts->m_vvaBrickSize[j][size_t(x)].resize(size_t(ts->m_vaBrickCount[j].y));
-      if (ts->m_pMaxMinData) {
-        ts->m_vvaMaxMin[j][size_t(x)].resize(size_t(ts->m_vaBrickCount[j].y));
-      }
 
       vBrickCorner.y = 0;
       for (uint64_t y=0; y < ts->m_vaBrickCount[j].y; y++) {
-        if (ts->m_pMaxMinData) {
-          ts->m_vvaMaxMin[j][size_t(x)][size_t(y)].resize(size_t(ts->m_vaBrickCount[j].z));
-        }
-
         vBrickCorner.z = 0;
         for (uint64_t z=0; z < ts->m_vaBrickCount[j].z; z++) {
           std::vector<uint64_t> vBrick;
@@ -379,38 +400,6 @@ void UVFDataset::ComputeMetadataRDB(size_t timestep) {
       vBrickCorner.x += bmd.extents.x;
     }
   }
-
-  size_t iSerializedIndex = 0;
-  if (ts->m_pMaxMinData) {
-    for (size_t lod=0; lod < iLODLevel; lod++) {
-      for (uint64_t z=0; z < ts->m_vaBrickCount[lod].z; z++) {
-        for (uint64_t y=0; y < ts->m_vaBrickCount[lod].y; y++) {
-          for (uint64_t x=0; x < ts->m_vaBrickCount[lod].x; x++) {
-            // for four-component data we use the fourth component
-            // (presumably the alpha channel); for all other data we use
-            // the first component
-            /// \todo we may have to change this if we add support for other
-            /// kinds of multicomponent data.
-            try {
-              ts->m_vvaMaxMin[lod][size_t(x)][size_t(y)][size_t(z)] =
-                ts->m_pMaxMinData->GetValue(iSerializedIndex++,
-                   (pVolumeDataBlock->ulElementDimensionSize[0] == 4) ? 3 : 0
-                );
-            } catch(const std::length_error&) {
-              MinMaxBlock elem;
-              const std::pair<double,double> mm = std::make_pair(
-                -std::numeric_limits<double>::max(),
-                 std::numeric_limits<double>::max()
-              );
-              elem.minScalar = elem.minGradient = mm.first;
-              elem.maxScalar = elem.maxGradient = mm.second;
-              ts->m_vvaMaxMin[lod][size_t(x)][size_t(y)][size_t(z)] = elem;
-            }
-          }
-        }
-      }
-    }
-  }
 }
 
 // One dimensional brick shrinking for internal bricks that have some overlap
@@ -1137,65 +1126,31 @@ void UVFDataset::ComputeRange() {
     // LOD level 0 (highest res) and compute the max & min
     std::pair<double,double> limits;
 
-    if (m_bToCBlock) {
-      for(size_t tsi=0; tsi < m_timesteps.size(); ++tsi) {
-        for (size_t i=0; i < GetBrickCount(0, tsi); i++) {
-          const TOCTimestep* ts = static_cast<TOCTimestep*>(m_timesteps[tsi]);
-          const MinMaxBlock& maxMinElement = ts->m_pMaxMinData->GetValue(i, ts->GetDB()->GetComponentCount() == 4 ? 3 : 0);
-
-          if (i>0) {
-            limits.first  = min(limits.first, maxMinElement.minScalar);
-            limits.second = max(limits.second, maxMinElement.maxScalar);
-          } else {
-            limits = make_pair(maxMinElement.minScalar, maxMinElement.maxScalar);
-          }
-        }
-      }
-      m_CachedRange = limits;
+    // LOD 0 comes first in the table.
+    for(size_t tsi=0; tsi < m_timesteps.size(); ++tsi) {
+      const MinMaxTable& table = *m_timesteps[tsi]->m_pMinMaxTable;
+      for (size_t i=0; i < GetBrickCount(0, tsi); i++) {
+        const MinMaxBlock maxMinElement = table.Get(i);
 
-    } else {
-      for(size_t tsi=0; tsi < m_timesteps.size(); ++tsi) {
-        const RDTimestep* ts = static_cast<RDTimestep*>(m_timesteps[tsi]);
-
-        for (size_t i=0; i < GetBrickCount(0, tsi); i++) {
-          BrickKey k(tsi,0,i);
-          const NDBrickKey& key = IndexToVectorKey(k);
-
-          const MinMaxBlock& maxMinElement =
-            ts->m_vvaMaxMin[0]
-                          [static_cast<size_t>(key.brick[0])]
-                          [static_cast<size_t>(key.brick[1])]
-                          [static_cast<size_t>(key.brick[2])];
-
-          if (i>0) {
-            limits.first  = min(limits.first, maxMinElement.minScalar);
-            limits.second = max(limits.second, maxMinElement.maxScalar);
-          } else {
-            limits = make_pair(maxMinElement.minScalar, maxMinElement.maxScalar);
-          }
+        if (i>0) {
+          limits.first  = min(limits.first, maxMinElement.minScalar);
+          limits.second = max(limits.second, maxMinElement.maxScalar);
+        } else {
+          limits = make_pair(maxMinElement.minScalar, maxMinElement.maxScalar);
         }
-        m_CachedRange = limits;
       }
     }
+    m_CachedRange = limits;
   }
 }
 
 MinMaxBlock UVFDataset::MaxMinForKey(const BrickKey& k) const {
-  MinMaxBlock maxMinElement;
-  if (m_bToCBlock) {
-    const TOCTimestep* ts = dynamic_cast<const TOCTimestep*>(m_timesteps[std::get<0>(k)]);
-    size_t iLinIndex = size_t(ts->GetDB()->GetLinearBrickIndex(KeyToTOCVector(k)));
-    return  ts->m_pMaxMinData->GetValue(iLinIndex, ts->GetDB()->GetComponentCount() == 4 ? 3 : 0 );
-  } else {
-    const NDBrickKey& key = IndexToVectorKey(k);
-    size_t iLOD = std::get<1>(k);
+  return m_timesteps[std::get<0>(k)]->m_pMinMaxTable->Get(MinMaxTableIndex(k));
+}
 
-    const RDTimestep* ts = dynamic_cast<const RDTimestep*>(m_timesteps[key.timestep]);
-    return ts->m_vvaMaxMin[iLOD]
-                          [static_cast<size_t>(key.brick[0])]
-                          [static_cast<size_t>(key.brick[1])]
-                          [static_cast<size_t>(key.brick[2])];
-  }
+std::shared_ptr<const MinMaxTable>
+UVFDataset::GetMinMaxTable(size_t timestep) const {
+  return m_timesteps[timestep]->m_pMinMaxTable;
 }
 
 bool UVFDataset::ContainsData(const BrickKey &k, double isoval) const
@@ -1682,6 +1637,22 @@ std::list<std::string> UVFDataset::Extensions() const
   return retval;
 }
 
+/// size of a ToC brick in bytes, once it is read
+static size_t TOCBrickBytes(const TOCBlock* db, const UINT64VECTOR4& coords) {
+  return size_t(db->GetComponentTypeSize() * db->GetComponentCount() *
+                db->GetBrickSize(coords).volume());
+}
+
+/// ToC bricks may be stored as 2D atlases; turns them back into volumes.
+static void ExpandAtlas(const TOCBlock* db, const UINT64VECTOR4& coords,
+                        size_t targetSize, uint8_t* pData) {
+  if(db->GetAtlasSize(coords).area() != 0) {
+    VolumeTools::DeAtalasify(targetSize, db->GetAtlasSize(coords),
+                             db->GetMaxBrickSize(), db->GetBrickSize(coords),
+                             pData, pData);
+  }
+}
+
 template <class T> bool
 UVFDataset::GetBrickTemplate(const BrickKey& k, std::vector<T>& vData) const
 {
@@ -1690,20 +1661,11 @@ UVFDataset::GetBrickTemplate(const BrickKey& k, std::vector<T>& vData) const
     const TOCTimestep* ts = static_cast<TOCTimestep*>(
       m_timesteps[std::get<0>(k)]
     );
-    const size_t targetSize = size_t(
-      ts->GetDB()->GetComponentTypeSize() *
-      ts->GetDB()->GetComponentCount() *
-      ts->GetDB()->GetBrickSize(coords).volume()
-    ) / sizeof(T);
+    const size_t targetSize = TOCBrickBytes(ts->GetDB(), coords) / sizeof(T);
     vData.resize(targetSize);
     uint8_t* pData = (uint8_t*)&vData[0];
     ts->GetDB()->GetData(pData,coords);
-    if(ts->GetDB()->GetAtlasSize(coords).area() != 0) {
-      VolumeTools::DeAtalasify(targetSize, ts->GetDB()->GetAtlasSize(coords),
-                               ts->GetDB()->GetMaxBrickSize(),
-                               ts->GetDB()->GetBrickSize(coords), pData,
-                               pData);
-    }
+    ExpandAtlas(ts->GetDB(), coords, targetSize, pData);
     return true;
   } else {
     const NDBrickKey& key = this->IndexToVectorKey(k);
@@ -1744,6 +1706,94 @@ bool UVFDataset::GetBrick(const BrickKey& k, std::vector<double>& vData) const {
   return GetBrickTemplate<double>(k,vData);
 }
 
+/// ToC-based files hand each timestep's bricks to the octree in one batch,
+/// which sorts the reads by file offset and expands the bricks in parallel.
+template <class T> bool
+UVFDataset::GetBricksTemplate(const std::vector<BrickKey>& keys,
+                              std::vector<std::vector<T>>& vData) const
+{
+  if(!m_bToCBlock) { return Dataset::GetBricks(keys, vData); }
+
+  vData.resize(keys.size());
+  std::map<size_t, std::vector<size_t>> batches;
+  for(size_t i=0; i < keys.size(); ++i) {
+    batches[std::get<0>(keys[i])].push_back(i);
+  }
+  bool ok = true;
+  for(auto b = batches.cbegin(); b != batches.cend(); ++b) {
+    const TOCBlock* db = static_cast<TOCTimestep*>(m_timesteps[b->first])->GetDB();
+    std::vector<UINT64VECTOR4> coords(b->second.size());
+    std::vector<uint8_t*> pData(b->second.size());
+    for(size_t j=0; j < b->second.size(); ++j) {
+      std::vector<T>& brick = vData[b->second[j]];
+      coords[j] = KeyToTOCVector(keys[b->second[j]]);
+      brick.resize(TOCBrickBytes(db, coords[j]) / sizeof(T));
+      pData[j] = (uint8_t*)&brick[0];
+    }
+    if(!db->GetData(pData, coords)) { ok = false; continue; }
+    for(size_t j=0; j < b->second.size(); ++j) {
+      ExpandAtlas(db, coords[j], vData[b->second[j]].size(), pData[j]);
+    }
+  }
+  return ok;
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<uint8_t>>& vData) const {
+  return GetBricksTemplate<uint8_t>(keys, vData);
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<int8_t>>& vData) const {
+  return GetBricksTemplate<int8_t>(keys, vData);
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<uint16_t>>& vData) const {
+  return GetBricksTemplate<uint16_t>(keys, vData);
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<int16_t>>& vData) const {
+  return GetBricksTemplate<int16_t>(keys, vData);
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<uint32_t>>& vData) const {
+  return GetBricksTemplate<uint32_t>(keys, vData);
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<int32_t>>& vData) const {
+  return GetBricksTemplate<int32_t>(keys, vData);
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<float>>& vData) const {
+  return GetBricksTemplate<float>(keys, vData);
+}
+
+bool UVFDataset::GetBricks(const std::vector<BrickKey>& keys,
+                           std::vector<std::vector<double>>& vData) const {
+  return GetBricksTemplate<double>(keys, vData);
+}
+
+/// Only ToC-based files can read ahead; keys are grouped by timestep, since
+/// every timestep is an octree of its own.
+void UVFDataset::Prefetch(const std::vector<BrickKey>& keys) const {
+  if(!m_bToCBlock || keys.empty()) { return; }
+
+  std::map<size_t, std::vector<UINT64VECTOR4>> coords;
+  for(auto k = keys.cbegin(); k != keys.cend(); ++k) {
+    if(std::get<0>(*k) >= m_timesteps.size()) { continue; }
+    coords[std::get<0>(*k)].push_back(KeyToTOCVector(*k));
+  }
+  for(auto c = coords.cbegin(); c != coords.cend(); ++c) {
+    const TOCTimestep* ts = static_cast<TOCTimestep*>(m_timesteps[c->first]);
+    ts->GetDB()->Prefetch(c->second);
+  }
+}
+
 std::pair<FLOATVECTOR3, FLOATVECTOR3> UVFDataset::GetTextCoords(BrickTable::const_iterator brick, bool bUseOnlyPowerOfTwo) const {
   if (m_bToCBlock) {
     const UINT64VECTOR4 coords = KeyToTOCVector(brick->first);
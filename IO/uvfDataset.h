@@ -29,6 +29,7 @@
 #ifndef TUVOK_UVF_DATASET_H
 #define TUVOK_UVF_DATASET_H
 
+#include <memory>
 #include <vector>
 #include "Basics/MinMaxBlock.h"
 #include "Controller/Controller.h"
@@ -71,6 +72,8 @@ namespace tuvok {
     const Histogram1DDataBlock*  m_pHist1DDataBlock;
     const Histogram2DDataBlock*  m_pHist2DDataBlock;
     const MaxMinDataBlock*       m_pMaxMinData;      ///< acceleration info
+    /// m_pMaxMinData, flattened for fast lookups; always set.
+    std::shared_ptr<MinMaxTable> m_pMinMaxTable;
     size_t                       block_number;
   };
 
@@ -89,8 +92,6 @@ namespace tuvok {
     /// the size of each individual brick.  Slowest moving dimension is LOD;
     /// then x,y,z.
     std::vector<std::vector<std::vector<std::vector<UINT64VECTOR3>>>>  m_vvaBrickSize;
-    /// same layout as m_vvaBrickSize, but gives acceleration min/max info.
-    std::vector<std::vector<std::vector<MinMaxComponent>>> m_vvaMaxMin;
   };
 
   class TOCTimestep : public Timestep   {
@@ -110,6 +111,9 @@ public:
   virtual UINTVECTOR3 GetBrickVoxelCounts(const BrickKey&) const;
   virtual UINT64VECTOR3 GetEffectiveBrickSize(const BrickKey &) const;
 
+  /// These may be called from any number of threads at once: bricks are read
+  /// positionally and decompressed into per-thread buffers.  Do not modify
+  /// the dataset meanwhile, though.
   virtual bool GetBrick(const BrickKey&, std::vector<uint8_t>&) const;
   virtual bool GetBrick(const BrickKey&, std::vector<int8_t>&) const;
   virtual bool GetBrick(const BrickKey&, std::vector<uint16_t>&) const;
@@ -118,6 +122,24 @@ public:
   virtual bool GetBrick(const BrickKey&, std::vector<int32_t>&) const;
   virtual bool GetBrick(const BrickKey&, std::vector<float>&) const;
   virtual bool GetBrick(const BrickKey&, std::vector<double>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<uint8_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<int8_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<uint16_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<int16_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<uint32_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<int32_t>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<float>>&) const;
+  virtual bool GetBricks(const std::vector<BrickKey>&,
+                         std::vector<std::vector<double>>&) const;
+  virtual void Prefetch(const std::vector<BrickKey>&) const;
+  virtual bool ConcurrentGetBrick() const { return true; }
 
   /// Acceleration queries.
   virtual bool ContainsData(const BrickKey &k, double isoval) const;
@@ -126,6 +148,8 @@ public:
                             double fMinGradient,double fMaxGradient) const;
   /// @returns the min/max scalar and gradient values for the given brick
   tuvok::MinMaxBlock MaxMinForKey(const BrickKey& k) const;
+  virtual std::shared_ptr<const MinMaxTable>
+    GetMinMaxTable(size_t timestep) const;
 
   // LOD Data
   /// @todo fixme -- this should take a brick key and just ignore the spatial
@@ -210,6 +234,7 @@ private:
   void ComputeMetaData(size_t ts);
   void ComputeMetadataTOC(size_t ts);
   void ComputeMetadataRDB(size_t ts);
+  void ComputeMinMaxTable(size_t ts);
   void GetHistograms(size_t ts);
 
   void FixOverlap(uint64_t& v, uint64_t brickIndex, uint64_t maxindex, uint64_t overlap) const;
@@ -220,6 +245,9 @@ private:
 
   template <class T> bool GetBrickTemplate(const BrickKey& k,
                                            std::vector<T>& vData) const;
+  template <class T> bool GetBricksTemplate(
+    const std::vector<BrickKey>& keys,
+    std::vector<std::vector<T>>& vData) const;
 
 private:
   bool                                  m_bToCBlock;
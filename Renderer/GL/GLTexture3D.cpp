@@ -97,6 +97,16 @@ void GLTexture3D::SetData(const UINTVECTOR3& offset, const UINTVECTOR3& size,
   if (bRestoreBinding && GLuint(prevTex) != m_iGLID) GL(glBindTexture(GL_TEXTURE_3D, prevTex));
 }
 
+void GLTexture3D::SetData(const UINTVECTOR3& offset, const UINTVECTOR3& size,
+                          const UINTVECTOR2& pitch, const void *pixels,
+                          bool bRestoreBinding) {
+  GL(glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch.x));
+  GL(glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, pitch.y));
+  SetData(offset, size, pixels, bRestoreBinding);
+  GL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+  GL(glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0));
+}
+
 void GLTexture3D::SetData(const void *pixels, bool bRestoreBinding) {
   GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
   GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
@@ -73,6 +73,11 @@ class GLTexture3D : public GLTexture {
     virtual void SetData(const void *pixels, bool bRestoreBinding=true);
     void SetData(const UINTVECTOR3& offset, const UINTVECTOR3& size,
                  const void *pixels, bool bRestoreBinding=true);
+    /// as above, but the source is a sub-block of a larger volume: 'pitch'
+    /// gives its row length (in texels) and slice height (in rows).
+    void SetData(const UINTVECTOR3& offset, const UINTVECTOR3& size,
+                 const UINTVECTOR2& pitch, const void *pixels,
+                 bool bRestoreBinding=true);
 
     virtual std::shared_ptr<void> GetData();
 
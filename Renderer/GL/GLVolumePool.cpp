@@ -14,6 +14,8 @@
 #include "Basics/MathTools.h"
 #include "Basics/TuvokException.h"
 #include "Basics/Threads.h"
+#include "IO/BrickView.h"
+#include "IO/DynamicBrickingDS.h"
 #include "IO/LinearIndexDataset.h"
 #include "IO/UVF/ExtendedOctree/VolumeTools.h"
 #include "Controller/StackTimer.h"
@@ -145,8 +147,7 @@ GLVolumePool::GLVolumePool(const UINTVECTOR3& poolSize,
     , m_TimesMetaTextureUpload(100)
     , m_TimesRecomputeVisibility(100)
 #endif
-    , m_iMinMaxScalarTimestep(0)
-    , m_iMinMaxGradientTimestep(0)
+    , m_iMinMaxTimestep(0)
     , m_BrickIOTime(0.0)
     , m_BrickIOBytes(0)
     , m_iMaxUsedBrickVoxelCount(0)
@@ -217,22 +218,16 @@ GLVolumePool::GLVolumePool(const UINTVECTOR3& poolSize,
   // the lower levels, this is used to serialize a brick index
   uint32_t iOffset = 0;
   m_vLoDOffsetTable.resize(m_iLoDCount);
+  m_vBrickLayout.resize(m_iLoDCount);
   for (uint32_t i = 0;i<m_vLoDOffsetTable.size();++i) {
     m_vLoDOffsetTable[i] = iOffset;
-    iOffset += GetBrickLayout(m_volumeSize, m_maxInnerBrickSize, i).volume();
+    m_vBrickLayout[i] = GetBrickLayout(m_volumeSize, m_maxInnerBrickSize, i);
+    iOffset += m_vBrickLayout[i].volume();
   }
 
   CreateGLResources();
 
-  // duplicate minmax scalar data from dataset for efficient access
-  m_vMinMaxScalar.resize(m_iTotalBrickCount);
-  for (uint32_t i = 0; i < m_vMinMaxScalar.size(); i++) {
-    UINTVECTOR4 const vBrickID = GetVectorBrickID(i);
-    BrickKey const key = m_pDataset->IndexFrom4D(vBrickID, m_iMinMaxScalarTimestep);
-    MinMaxBlock imme = m_pDataset->MaxMinForKey(key);
-    m_vMinMaxScalar[i].min = imme.minScalar;
-    m_vMinMaxScalar[i].max = imme.maxScalar;
-  }
+  LoadMinMaxTable();
 
   switch (m_eDebugMode) {
   default:
@@ -258,6 +253,24 @@ GLVolumePool::GLVolumePool(const UINTVECTOR3& poolSize,
   }
 }
 
+void GLVolumePool::LoadMinMaxTable() {
+  // both the dataset's table and our brick IDs order bricks by LoD (finest
+  // first), then z, y, x, so the table is ours if the layouts agree
+  m_pMinMaxTable = m_pDataset->GetMinMaxTable(m_iMinMaxTimestep);
+  if (m_pMinMaxTable->GetLayout() == m_vBrickLayout)
+    return;
+
+  WARNING("Brick layout of the dataset differs from the pool's, "
+          "gathering min/max information brick by brick.");
+  std::shared_ptr<MinMaxTable> table(new MinMaxTable(m_vBrickLayout));
+  for (uint32_t i = 0; i < m_iTotalBrickCount; i++) {
+    UINTVECTOR4 const vBrickID = GetVectorBrickID(i);
+    BrickKey const key = m_pDataset->IndexFrom4D(vBrickID, m_iMinMaxTimestep);
+    table->Set(i, m_pDataset->MaxMinForKey(key));
+  }
+  m_pMinMaxTable = table;
+}
+
 void GLVolumePool::PH_Reset(const VisibilityState& visibility, size_t iTimestep) {
   // remember largest single brick parameters
   uint32_t const iLastBrickIndex = *(m_vLoDOffsetTable.end()-1);
@@ -670,10 +683,11 @@ std::string GLVolumePool::GetShaderFragment(uint32_t iMetaTextureUnit,
 }
 
 
-void GLVolumePool::UploadBrick(uint32_t iBrickID, const UINTVECTOR3& vVoxelSize, void* pData, 
-                               size_t iInsertPos, uint64_t iTimeOfCreation)
+void GLVolumePool::UploadBrick(uint32_t iBrickID, const UINTVECTOR3& vVoxelSize, const void* pData, 
+                               size_t iInsertPos, uint64_t iTimeOfCreation,
+                               const UINTVECTOR2& vPitch)
 {
-  StackTimer ubrick(PERF_POOL_UPLOAD_BRICK);
+  StackTimer ubrick(PERF_POOL_UPLOAD_BRICK, int64_t(iBrickID));
   PoolSlotData& slot = m_vPoolSlotData[iInsertPos];
 
   if (slot.ContainsVisibleBrick()) {
@@ -713,11 +727,41 @@ void GLVolumePool::UploadBrick(uint32_t iBrickID, const UINTVECTOR3& vVoxelSize,
   UploadMetadataTexel(slot.m_iBrickID);
 
   // upload brick to 3D texture
-  m_pPoolDataTexture->SetData(slot.PositionInPool() * m_maxTotalBrickSize, vVoxelSize, pData);
+  if (vPitch.x == 0 && vPitch.y == 0)
+    m_pPoolDataTexture->SetData(slot.PositionInPool() * m_maxTotalBrickSize, vVoxelSize, pData);
+  else
+    m_pPoolDataTexture->SetData(slot.PositionInPool() * m_maxTotalBrickSize, vVoxelSize, vPitch, pData);
 }
 
 namespace {
 
+  // Fetches the data of a brick that is about to be uploaded.  Rebricked
+  // datasets can hand out a view straight into their brick cache, in which
+  // case we upload from there (with the source brick's pitch) instead of
+  // copying the brick into vUploadMem first.
+  // @returns the data to upload and sets vPitch ((0,0) for packed data) and
+  //          iElements, the number of elements the brick occupies.
+  template<typename T>
+  const T* FetchBrick(const LinearIndexDataset* pDataset, const BrickKey& key,
+                      std::vector<T>& vUploadMem, BrickView<T>& view,
+                      UINTVECTOR2& vPitch, size_t& iElements,
+                      bool bAllowView = true) {
+    tuvok::StackTimer poolGetBrick(PERF_POOL_GET_BRICK,
+                                   int64_t(std::get<2>(key)));
+    const DynamicBrickingDS* pDynDS =
+      dynamic_cast<const DynamicBrickingDS*>(pDataset);
+    if (bAllowView && pDynDS && pDynDS->GetBrickView(key, view)) {
+      vPitch = view.contiguous() ? UINTVECTOR2(0, 0) :
+               UINTVECTOR2(unsigned(view.pitch[0]), unsigned(view.pitch[1]));
+      iElements = view.voxels() * view.components;
+      return view.base;
+    }
+    pDataset->GetBrick(key, vUploadMem);
+    vPitch = UINTVECTOR2(0, 0);
+    iElements = vUploadMem.size();
+    return &vUploadMem[0];
+  }
+
   template<typename T>
   void UploadFirstBrickT(
     const BrickKey& bkey,
@@ -727,7 +771,8 @@ namespace {
     const UINTVECTOR3 vVoxelCount = pDataset->GetBrickVoxelCounts(bkey);
     std::vector<T> vUploadMem(vVoxelCount.volume());
     {
-      tuvok::StackTimer poolGetBrick(PERF_POOL_GET_BRICK);
+      tuvok::StackTimer poolGetBrick(PERF_POOL_GET_BRICK,
+                                     int64_t(std::get<2>(bkey)));
       pDataset->GetBrick(bkey, vUploadMem);
     }
     pool.UploadFirstBrick(vVoxelCount, &vUploadMem[0]);
@@ -765,18 +810,25 @@ void GLVolumePool::UploadFirstBrick(const UINTVECTOR3& m_vVoxelSize, void* pData
   UploadBrick(iLastBrickIndex, m_vVoxelSize, pData, m_vPoolSlotData.size()-1, std::numeric_limits<uint64_t>::max());
 }
 
-bool GLVolumePool::UploadBrick(const BrickElemInfo& metaData, void* pData) {
+bool GLVolumePool::UploadBrick(const BrickElemInfo& metaData, const void* pData) {
   // in this frame we already replaced all bricks (except the single low-res brick)
   // in the pool so now we should render them first
   if (m_iInsertPos >= m_vPoolSlotData.size()-1)
     return false;
 
   int32_t iBrickID = GetIntegerBrickID(metaData.m_vBrickID);
-  UploadBrick(iBrickID, metaData.m_vVoxelSize, pData, m_iInsertPos, m_iTimeOfCreation++);
+  UploadBrick(iBrickID, metaData.m_vVoxelSize, pData, m_iInsertPos, m_iTimeOfCreation++,
+              metaData.m_vPitch);
   m_iInsertPos++;
   return true;
 }
 
+size_t GLVolumePool::GetFreeSlotCount() const {
+  // the last slot is reserved for the single low-res brick
+  size_t const iSlots = m_vPoolSlotData.size()-1;
+  return m_iInsertPos < iSlots ? iSlots - m_iInsertPos : 0;
+}
+
 bool GLVolumePool::IsBrickResident(const UINTVECTOR4& vBrickID) const {
 
   int32_t iBrickID = GetIntegerBrickID(vBrickID);
@@ -959,46 +1011,21 @@ void GLVolumePool::PrepareForPaging() {
 }
 
 namespace {
-  template<AbstrRenderer::ERenderMode eRenderMode>
-  bool ContainsData(VisibilityState const& visibility, uint32_t iBrickID,
-                    std::vector<GLVolumePool::MinMax> const& vMinMaxScalar,
-                    std::vector<GLVolumePool::MinMax> const& vMinMaxGradient)
+  // vVisibleBricks holds the classification of all bricks for the current
+  // visibility state, see GLVolumePool::RecomputeVisibility
+  bool ContainsData(std::vector<uint64_t> const& vVisibleBricks, uint32_t iBrickID)
   {
-    assert(eRenderMode == visibility.GetRenderMode());
-    static_assert(eRenderMode == AbstrRenderer::RM_1DTRANS ||
-                  eRenderMode == AbstrRenderer::RM_2DTRANS ||
-                  eRenderMode == AbstrRenderer::RM_ISOSURFACE, "render mode not supported");
-    switch (eRenderMode) {
-    case AbstrRenderer::RM_1DTRANS:
-      return (visibility.Get1DTransfer().fMax >= vMinMaxScalar[iBrickID].min &&
-              visibility.Get1DTransfer().fMin <= vMinMaxScalar[iBrickID].max);
-      break;
-    case AbstrRenderer::RM_2DTRANS:
-      return (visibility.Get2DTransfer().fMax >= vMinMaxScalar[iBrickID].min &&
-              visibility.Get2DTransfer().fMin <= vMinMaxScalar[iBrickID].max)
-              &&
-             (visibility.Get2DTransfer().fMaxGradient >= vMinMaxGradient[iBrickID].min &&
-              visibility.Get2DTransfer().fMinGradient <= vMinMaxGradient[iBrickID].max);
-      break;
-    case AbstrRenderer::RM_ISOSURFACE:
-      return (visibility.GetIsoSurface().fIsoValue >= vMinMaxScalar[iBrickID].min &&
-              visibility.GetIsoSurface().fIsoValue <= vMinMaxScalar[iBrickID].max);
-      break;
-    }
-    return true;
+    return MinMaxTable::IsVisible(vVisibleBricks, iBrickID);
   }
 
-  template<AbstrRenderer::ERenderMode eRenderMode>
   void RecomputeVisibilityForBrickPool(
-    VisibilityState const& visibility, GLVolumePool const& pool,
+    GLVolumePool const& pool,
     std::vector<uint32_t>& vBrickMetadata, std::vector<PoolSlotData>& vBrickPool,
-    std::vector<GLVolumePool::MinMax> const& vMinMaxScalar,
-    std::vector<GLVolumePool::MinMax> const& vMinMaxGradient)
+    std::vector<uint64_t> const& vVisibleBricks)
   {
-    assert(eRenderMode == visibility.GetRenderMode());
     for (auto slot = vBrickPool.begin(); slot < vBrickPool.end(); slot++) {
       if (slot->WasEverUsed()) {
-        bool const bContainsData = ContainsData<eRenderMode>(visibility, slot->m_iBrickID, vMinMaxScalar, vMinMaxGradient);
+        bool const bContainsData = ContainsData(vVisibleBricks, slot->m_iBrickID);
         bool const bContainedData = slot->ContainsVisibleBrick();
 
         if (bContainsData) {
@@ -1017,12 +1044,11 @@ namespace {
     } // for all slots in brick pool
   }
 
-  template<bool bInterruptable, AbstrRenderer::ERenderMode eRenderMode>
+  template<bool bInterruptable>
   UINTVECTOR4 RecomputeVisibilityForOctree(
-    VisibilityState const& visibility, GLVolumePool const& pool,
+    GLVolumePool const& pool,
     std::vector<uint32_t>& vBrickMetadata,
-    std::vector<GLVolumePool::MinMax> const& vMinMaxScalar,
-    std::vector<GLVolumePool::MinMax> const& vMinMaxGradient,
+    std::vector<uint64_t> const& vVisibleBricks,
     tuvok::ThreadClass::PredicateFunction pContinue = tuvok::ThreadClass::PredicateFunction())
   {
     UINTVECTOR4 vEmptyBrickCount(0, 0, 0, 0);
@@ -1049,7 +1075,7 @@ namespace {
           uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
           if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
           {
-            bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+            bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
             if (!bContainsData) {
               vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // finest level bricks are all child empty by definition
               vEmptyBrickCount.w++; // increment leaf empty brick count
@@ -1080,7 +1106,7 @@ namespace {
             uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
             if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
             {
-              bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+              bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
               if (!bContainsData) {
                 vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
 
@@ -1123,7 +1149,7 @@ namespace {
             uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
             if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
             {
-              bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+              bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
               if (!bContainsData) {
                 vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
 
@@ -1160,7 +1186,7 @@ namespace {
             uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
             if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
             {
-              bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+              bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
               if (!bContainsData) {
                 vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
 
@@ -1197,7 +1223,7 @@ namespace {
             uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
             if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
             {
-              bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+              bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
               if (!bContainsData) {
                 vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
 
@@ -1234,7 +1260,7 @@ namespace {
           uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
           if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
           {
-            bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+            bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
             if (!bContainsData) {
               vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
             
@@ -1268,7 +1294,7 @@ namespace {
           uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
           if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
           {
-            bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+            bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
             if (!bContainsData) {
               vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
 
@@ -1302,7 +1328,7 @@ namespace {
           uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
           if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
           {
-            bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+            bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
             if (!bContainsData) {
               vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
 
@@ -1336,7 +1362,7 @@ namespace {
         uint32_t const brickIndex = pool.GetIntegerBrickID(vBrickID);
         if (vBrickMetadata[brickIndex] < BI_FLAG_COUNT) // only check bricks that are not cached in the pool
         {
-          bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+          bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
           if (!bContainsData) {
             vBrickMetadata[brickIndex] = BI_CHILD_EMPTY; // flag parent brick to be child empty for now so that we can save a couple of tests below
 
@@ -1369,25 +1395,38 @@ namespace {
     uint32_t iPagedBricks = 0;
     std::vector<T> vUploadMem(maxUsedBrickVoxelCount);
     Timer t;
-    for (auto missingBrick = vBrickIDs.cbegin(); missingBrick < vBrickIDs.cend(); missingBrick++) {
-      UINTVECTOR4 const& vBrickID = *missingBrick;
-      BrickKey const key = pDataset->IndexFrom4D(vBrickID, iTimestep);
+
+    // let the dataset read ahead while we upload; only the bricks which fit
+    // into the free pool slots are requested, the upload stops there anyway
+    std::vector<BrickKey> vKeys;
+    vKeys.reserve(vBrickIDs.size());
+    for (auto missingBrick = vBrickIDs.cbegin(); missingBrick < vBrickIDs.cend(); missingBrick++)
+      vKeys.push_back(pDataset->IndexFrom4D(*missingBrick, iTimestep));
+    size_t const iFitting = std::min(vKeys.size(), pool.GetFreeSlotCount());
+    pDataset->Prefetch(std::vector<BrickKey>(vKeys.begin(),
+                                             vKeys.begin() + iFitting));
+
+    for (size_t i = 0; i < vBrickIDs.size(); ++i) {
+      UINTVECTOR4 const& vBrickID = vBrickIDs[i];
+      BrickKey const& key = vKeys[i];
       UINTVECTOR3 const vVoxelSize = pDataset->GetBrickVoxelCounts(key);
 
       // upload brick core
-      {
-        tuvok::StackTimer poolGetBrick(PERF_POOL_GET_BRICK);
-        pDataset->GetBrick(key, vUploadMem);
-      }
+      // (brick debugging needs the data in vUploadMem, so no views then)
+      BrickView<T> view;
+      UINTVECTOR2 vPitch;
+      size_t iElements;
+      const T* pData = FetchBrick(pDataset, key, vUploadMem, view, vPitch,
+                                  iElements, !brickDebug);
       if (brickDebug) {
         writeBrick(key, vUploadMem);
       }
-      if (!pool.UploadBrick(BrickElemInfo(vBrickID, vVoxelSize), &vUploadMem[0]))
+      if (!pool.UploadBrick(BrickElemInfo(vBrickID, vVoxelSize, vPitch), pData))
         break;
       else
         iPagedBricks++;
 
-      tuvok::Controller::Instance().IncrementPerfCounter(PERF_POOL_UPLOADED_MEM, double(vUploadMem.size() * sizeof(T)));
+      tuvok::Controller::Instance().IncrementPerfCounter(PERF_POOL_UPLOADED_MEM, double(iElements * sizeof(T)));
     }
     return iPagedBricks;
   }
@@ -1451,16 +1490,14 @@ namespace {
     //return 0;
   }
 
-  template<AbstrRenderer::ERenderMode eRenderMode, typename T, bool brickDebug>
+  template<typename T, bool brickDebug>
   uint32_t PotentiallyUploadBricksToBrickPoolT(
-    const VisibilityState& visibility,
     const LinearIndexDataset* pDataset,
     size_t iTimestep,
     GLVolumePool& pool,
     std::vector<uint32_t>& vBrickMetadata,
     const std::vector<UINTVECTOR4>& vBrickIDs,
-    const std::vector<GLVolumePool::MinMax>& vMinMaxScalar,
-    const std::vector<GLVolumePool::MinMax>& vMinMaxGradient,
+    const std::vector<uint64_t>& vVisibleBricks,
     const size_t maxUsedBrickVoxelCount // we pass it in here to avoid the pDataset->GetMaxUsedBrickSize() loop over all bricks
   ) {
     uint32_t iPagedBricks = 0;
@@ -1479,23 +1516,24 @@ namespace {
       // the brick could be flagged as empty by now if the async updater tested the brick after we ran the last render pass
       if (vBrickMetadata[brickIndex] == BI_MISSING) {
         // we might not have tested the brick for visibility yet since the updater's still running and we do not have a BI_UNKNOWN flag for now
-        bool const bContainsData = ContainsData<eRenderMode>(visibility, brickIndex, vMinMaxScalar, vMinMaxGradient);
+        bool const bContainsData = ContainsData(vVisibleBricks, brickIndex);
         if (bContainsData) {
 
           // upload brick core
-          {
-            tuvok::StackTimer poolGetBrick(PERF_POOL_GET_BRICK);
-            pDataset->GetBrick(key, vUploadMem);
-          }
+          BrickView<T> view;
+          UINTVECTOR2 vPitch;
+          size_t iElements;
+          const T* pData = FetchBrick(pDataset, key, vUploadMem, view, vPitch,
+                                      iElements, !brickDebug);
           if(brickDebug) {
             writeBrick(key, vUploadMem);
           }
-          if (!pool.UploadBrick(BrickElemInfo(vBrickID, vVoxelSize), &vUploadMem[0]))
+          if (!pool.UploadBrick(BrickElemInfo(vBrickID, vVoxelSize, vPitch), pData))
             return iPagedBricks;
           else
             iPagedBricks++;
 
-          tuvok::Controller::Instance().IncrementPerfCounter(PERF_POOL_UPLOADED_MEM, double(vUploadMem.size() * sizeof(T)));
+          tuvok::Controller::Instance().IncrementPerfCounter(PERF_POOL_UPLOADED_MEM, double(iElements * sizeof(T)));
 
         } else {
           vBrickMetadata[brickIndex] = BI_EMPTY;
@@ -1511,16 +1549,13 @@ namespace {
     return iPagedBricks;
   }
 
-  template<AbstrRenderer::ERenderMode eRenderMode>
   uint32_t PotentiallyUploadBricksToBrickPool(
-    const VisibilityState& visibility,
     const LinearIndexDataset* pDataset,
     size_t iTimestep,
     GLVolumePool& pool,
     std::vector<uint32_t>& vBrickMetadata,
     const std::vector<UINTVECTOR4>& vBrickIDs,
-    const std::vector<GLVolumePool::MinMax>& vMinMaxScalar,
-    const std::vector<GLVolumePool::MinMax>& vMinMaxGradient,
+    const std::vector<uint64_t>& vVisibleBricks,
     const size_t maxUsedBrickVoxelCount, // we pass it in here to avoid the pDataset->GetMaxUsedBrickSize() loop over all bricks
     bool brickDebug
     ) {
@@ -1529,22 +1564,22 @@ namespace {
         // brick debugging enabled
         if (!pDataset->GetIsSigned()) {
           switch (iBitWidth) {
-          case 8  : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, uint8_t,  true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 16 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, uint16_t, true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 32 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, uint32_t, true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
+          case 8  : return PotentiallyUploadBricksToBrickPoolT<uint8_t,  true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 16 : return PotentiallyUploadBricksToBrickPoolT<uint16_t, true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 32 : return PotentiallyUploadBricksToBrickPoolT<uint32_t, true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
           default : throw Exception("Invalid bit width for an unsigned dataset", _func_, __LINE__);
           }
         } else if (pDataset->GetIsFloat()) {
           switch (iBitWidth) {
-          case 32 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, float,    true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 64 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, double,   true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
+          case 32 : return PotentiallyUploadBricksToBrickPoolT<float,    true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 64 : return PotentiallyUploadBricksToBrickPoolT<double,   true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
           default : throw Exception("Invalid bit width for a float dataset", _func_, __LINE__);
           }
         } else {
           switch (iBitWidth) {
-          case 8  : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, int8_t,   true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 16 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, int16_t,  true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 32 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, int32_t,  true>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
+          case 8  : return PotentiallyUploadBricksToBrickPoolT<int8_t,   true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 16 : return PotentiallyUploadBricksToBrickPoolT<int16_t,  true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 32 : return PotentiallyUploadBricksToBrickPoolT<int32_t,  true>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
           default : throw Exception("Invalid bit width for a signed dataset", _func_, __LINE__);
           }
         }
@@ -1552,22 +1587,22 @@ namespace {
         // brick debugging disabled
         if (!pDataset->GetIsSigned()) {
           switch (iBitWidth) {
-          case 8  : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, uint8_t,  false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 16 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, uint16_t, false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 32 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, uint32_t, false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
+          case 8  : return PotentiallyUploadBricksToBrickPoolT<uint8_t,  false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 16 : return PotentiallyUploadBricksToBrickPoolT<uint16_t, false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 32 : return PotentiallyUploadBricksToBrickPoolT<uint32_t, false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
           default : throw Exception("Invalid bit width for an unsigned dataset", _func_, __LINE__);
           }
         } else if (pDataset->GetIsFloat()) {
           switch (iBitWidth) {
-          case 32 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, float,    false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 64 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, double,   false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
+          case 32 : return PotentiallyUploadBricksToBrickPoolT<float,    false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 64 : return PotentiallyUploadBricksToBrickPoolT<double,   false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
           default : throw Exception("Invalid bit width for a float dataset", _func_, __LINE__);
           }
         } else {
           switch (iBitWidth) {
-          case 8  : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, int8_t,   false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 16 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, int16_t,  false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
-          case 32 : return PotentiallyUploadBricksToBrickPoolT<eRenderMode, int32_t,  false>(visibility, pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vMinMaxScalar, vMinMaxGradient, maxUsedBrickVoxelCount);
+          case 8  : return PotentiallyUploadBricksToBrickPoolT<int8_t,   false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 16 : return PotentiallyUploadBricksToBrickPoolT<int16_t,  false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
+          case 32 : return PotentiallyUploadBricksToBrickPoolT<int32_t,  false>(pDataset, iTimestep, pool, vBrickMetadata, vBrickIDs, vVisibleBricks, maxUsedBrickVoxelCount);
           default : throw Exception("Invalid bit width for a signed dataset", _func_, __LINE__);
           }
         }
@@ -1594,32 +1629,34 @@ UINTVECTOR4 GLVolumePool::RecomputeVisibility(VisibilityState const& visibility,
   if (m_pUpdater)
     m_pUpdater->Pause();
   
-  // fill minmax scalar acceleration data structure if timestep changed
-  if (m_iMinMaxScalarTimestep != iTimestep) {
-    m_iMinMaxScalarTimestep = iTimestep;
-    for (uint32_t iBrickID = 0; iBrickID < m_vMinMaxScalar.size(); iBrickID++) {
-      UINTVECTOR4 const vBrickID = GetVectorBrickID(iBrickID);
-      BrickKey const key = m_pDataset->IndexFrom4D(vBrickID, m_iMinMaxScalarTimestep);
-      MinMaxBlock imme = m_pDataset->MaxMinForKey(key);
-      m_vMinMaxScalar[iBrickID].min = imme.minScalar;
-      m_vMinMaxScalar[iBrickID].max = imme.maxScalar;
-    }
+  // fetch minmax acceleration data structure if timestep changed
+  if (m_iMinMaxTimestep != iTimestep) {
+    m_iMinMaxTimestep = iTimestep;
+    LoadMinMaxTable();
   }
 
-  // fill minmax gradient acceleration data structure if needed and timestep changed
-  if (visibility.GetRenderMode() == AbstrRenderer::RM_2DTRANS) {
-    if (m_iMinMaxGradientTimestep != iTimestep || m_vMinMaxGradient.empty()) {
-      if (m_vMinMaxGradient.empty())
-        m_vMinMaxGradient.resize(m_iTotalBrickCount);
-      m_iMinMaxGradientTimestep = iTimestep;
-      for (uint32_t iBrickID = 0; iBrickID < m_vMinMaxScalar.size(); iBrickID++) {
-        UINTVECTOR4 const vBrickID = GetVectorBrickID(iBrickID);
-        BrickKey const key = m_pDataset->IndexFrom4D(vBrickID, m_iMinMaxGradientTimestep);
-        MinMaxBlock imme = m_pDataset->MaxMinForKey(key);
-        m_vMinMaxGradient[iBrickID].min = imme.minGradient;
-        m_vMinMaxGradient[iBrickID].max = imme.maxGradient;
-      }
-    }
+  // classify all bricks at once, the passes below just look up the result
+  switch (visibility.GetRenderMode()) {
+  case AbstrRenderer::RM_1DTRANS:
+    m_pMinMaxTable->ComputeVisible(visibility.Get1DTransfer().fMin,
+                                   visibility.Get1DTransfer().fMax,
+                                   m_vVisibleBricks);
+    break;
+  case AbstrRenderer::RM_2DTRANS:
+    m_pMinMaxTable->ComputeVisible(visibility.Get2DTransfer().fMin,
+                                   visibility.Get2DTransfer().fMax,
+                                   visibility.Get2DTransfer().fMinGradient,
+                                   visibility.Get2DTransfer().fMaxGradient,
+                                   m_vVisibleBricks);
+    break;
+  case AbstrRenderer::RM_ISOSURFACE:
+    m_pMinMaxTable->ComputeVisible(visibility.GetIsoSurface().fIsoValue,
+                                   visibility.GetIsoSurface().fIsoValue,
+                                   m_vVisibleBricks);
+    break;
+  default:
+    T_ERROR("Unhandled rendering mode.");
+    return vEmptyBrickCount;
   }
 
   // reset meta data for all bricks (BI_MISSING means that we haven't test the data for visibility until the async updater finishes)
@@ -1639,40 +1676,14 @@ UINTVECTOR4 GLVolumePool::RecomputeVisibility(VisibilityState const& visibility,
   double const t = m_Timer.Elapsed();
 #endif
   // recompute visibility for cached bricks immediately
-  switch (visibility.GetRenderMode()) {
-  case AbstrRenderer::RM_1DTRANS:
-    RecomputeVisibilityForBrickPool<AbstrRenderer::RM_1DTRANS>(visibility, *this, m_vBrickMetadata, m_vPoolSlotData, m_vMinMaxScalar, m_vMinMaxGradient);
-    break;
-  case AbstrRenderer::RM_2DTRANS:
-    RecomputeVisibilityForBrickPool<AbstrRenderer::RM_2DTRANS>(visibility, *this, m_vBrickMetadata, m_vPoolSlotData, m_vMinMaxScalar, m_vMinMaxGradient);
-    break;
-  case AbstrRenderer::RM_ISOSURFACE:
-    RecomputeVisibilityForBrickPool<AbstrRenderer::RM_ISOSURFACE>(visibility, *this, m_vBrickMetadata, m_vPoolSlotData, m_vMinMaxScalar, m_vMinMaxGradient);
-    break;
-  default:
-    T_ERROR("Unhandled rendering mode.");
-    return vEmptyBrickCount;
-  }
+  RecomputeVisibilityForBrickPool(*this, m_vBrickMetadata, m_vPoolSlotData, m_vVisibleBricks);
 #ifdef GLVOLUMEPOOL_PROFILE
   m_TimesRecomputeVisibilityForBrickPool.Push(m_Timer.Elapsed() - t);
 #endif
 
   if (!m_pUpdater || bForceSynchronousUpdate) {
     // recompute visibility for the entire hierarchy immediately
-    switch (visibility.GetRenderMode()) {
-    case AbstrRenderer::RM_1DTRANS:
-      vEmptyBrickCount = RecomputeVisibilityForOctree<false, AbstrRenderer::RM_1DTRANS>(visibility, *this, m_vBrickMetadata, m_vMinMaxScalar, m_vMinMaxGradient);
-      break;
-    case AbstrRenderer::RM_2DTRANS:
-      vEmptyBrickCount = RecomputeVisibilityForOctree<false, AbstrRenderer::RM_2DTRANS>(visibility, *this, m_vBrickMetadata, m_vMinMaxScalar, m_vMinMaxGradient);
-      break;
-    case AbstrRenderer::RM_ISOSURFACE:
-      vEmptyBrickCount = RecomputeVisibilityForOctree<false, AbstrRenderer::RM_ISOSURFACE>(visibility, *this, m_vBrickMetadata, m_vMinMaxScalar, m_vMinMaxGradient);
-      break;
-    default:
-      T_ERROR("Unhandled rendering mode.");
-      return vEmptyBrickCount;
-    }
+    vEmptyBrickCount = RecomputeVisibilityForOctree<false>(*this, m_vBrickMetadata, m_vVisibleBricks);
     m_bVisibilityUpdated = true; // will be true after we uploaded the metadata texture in the next line
     if (vEmptyBrickCount.x != m_iTotalBrickCount) {
       WARNING("%u of %u bricks were processed during synchronous visibility recomputation!");
@@ -1730,40 +1741,16 @@ uint32_t GLVolumePool::UploadBricks(const std::vector<UINTVECTOR4>& vBrickIDs,
     PrepareForPaging();
 
     if (!m_bVisibilityUpdated) {
-      VisibilityState const& visibility = m_pUpdater->GetVisibility();
-      switch (visibility.GetRenderMode()) {
-      case AbstrRenderer::RM_1DTRANS:
-        iPagedBricks =
-          PotentiallyUploadBricksToBrickPool<AbstrRenderer::RM_1DTRANS>(
-            visibility, m_pDataset, m_iMinMaxScalarTimestep, *this,
-            m_vBrickMetadata, vBrickIDs, m_vMinMaxScalar, m_vMinMaxGradient,
-            m_iMaxUsedBrickVoxelCount, brickDebug
-          );
-        break;
-      case AbstrRenderer::RM_2DTRANS:
-        iPagedBricks =
-          PotentiallyUploadBricksToBrickPool<AbstrRenderer::RM_2DTRANS>(
-            visibility, m_pDataset, m_iMinMaxScalarTimestep, *this,
-            m_vBrickMetadata, vBrickIDs, m_vMinMaxScalar, m_vMinMaxGradient,
-            m_iMaxUsedBrickVoxelCount, brickDebug
-          );
-        break;
-      case AbstrRenderer::RM_ISOSURFACE:
-        iPagedBricks =
-          PotentiallyUploadBricksToBrickPool<AbstrRenderer::RM_ISOSURFACE>(
-            visibility, m_pDataset, m_iMinMaxScalarTimestep, *this,
-            m_vBrickMetadata, vBrickIDs, m_vMinMaxScalar, m_vMinMaxGradient,
-            m_iMaxUsedBrickVoxelCount, brickDebug
-          );
-        break;
-      default:
-        T_ERROR("Unhandled rendering mode.");
-        return iPagedBricks;
-      }
+      // the async updater might not have reached the requested bricks yet
+      iPagedBricks = PotentiallyUploadBricksToBrickPool(
+        m_pDataset, m_iMinMaxTimestep, *this,
+        m_vBrickMetadata, vBrickIDs, m_vVisibleBricks,
+        m_iMaxUsedBrickVoxelCount, brickDebug
+      );
     } else {
       // visibility is updated guaranteeing that requested bricks do contain data
       iPagedBricks = UploadBricksToBrickPool(
-        *this, vBrickIDs, m_pDataset, m_iMinMaxScalarTimestep,
+        *this, vBrickIDs, m_pDataset, m_iMinMaxTimestep,
         m_iMaxUsedBrickVoxelCount, brickDebug);
     }
   }
@@ -1887,20 +1874,8 @@ void AsyncVisibilityUpdater::ThreadMain(void*)
     m_Timer.Start();
 #endif
 
-    switch (m_Visibility.GetRenderMode()) {
-    case AbstrRenderer::RM_1DTRANS:
-      RecomputeVisibilityForOctree<true, AbstrRenderer::RM_1DTRANS>(m_Visibility, m_Pool, m_Pool.m_vBrickMetadata, m_Pool.m_vMinMaxScalar, m_Pool.m_vMinMaxGradient, pContinue);
-      break;
-    case AbstrRenderer::RM_2DTRANS:
-      RecomputeVisibilityForOctree<true, AbstrRenderer::RM_2DTRANS>(m_Visibility, m_Pool, m_Pool.m_vBrickMetadata, m_Pool.m_vMinMaxScalar, m_Pool.m_vMinMaxGradient, pContinue);
-      break;
-    case AbstrRenderer::RM_ISOSURFACE:
-      RecomputeVisibilityForOctree<true, AbstrRenderer::RM_ISOSURFACE>(m_Visibility, m_Pool, m_Pool.m_vBrickMetadata, m_Pool.m_vMinMaxScalar, m_Pool.m_vMinMaxGradient, pContinue);
-      break;
-    default:
-      assert(false); //T_ERROR("Unhandled rendering mode.");
-      break;
-    }
+    // m_Pool.m_vVisibleBricks was computed for m_Visibility before the restart
+    RecomputeVisibilityForOctree<true>(m_Pool, m_Pool.m_vBrickMetadata, m_Pool.m_vVisibleBricks, pContinue);
 
 #ifdef GLVOLUMEPOOL_PROFILE
     m_Stats.fTimeTotal = m_Timer.Elapsed();
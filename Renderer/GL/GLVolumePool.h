@@ -5,8 +5,10 @@
 
 #include "StdTuvokDefines.h"
 #include <list>
+#include <memory>
 
 #include "Basics/Timer.h"
+#include "IO/MinMaxTable.h"
 #include "GLInclude.h"
 #include "GLTexture2D.h"
 #include "GLTexture3D.h"
@@ -60,13 +62,17 @@ namespace tuvok {
   };
 
   struct BrickElemInfo {
-    BrickElemInfo(const UINTVECTOR4& vBrickID, const UINTVECTOR3& vVoxelSize) :
+    BrickElemInfo(const UINTVECTOR4& vBrickID, const UINTVECTOR3& vVoxelSize,
+                  const UINTVECTOR2& vPitch = UINTVECTOR2(0, 0)) :
       m_vBrickID(vBrickID),
-      m_vVoxelSize(vVoxelSize)
+      m_vVoxelSize(vVoxelSize),
+      m_vPitch(vPitch)
     {}
 
     UINTVECTOR4    m_vBrickID;
     UINTVECTOR3    m_vVoxelSize;
+    // row length/slice height of strided brick data, (0,0) if tightly packed
+    UINTVECTOR2    m_vPitch;
   };
 
   class GLVolumePool : public GLObject {
@@ -98,7 +104,9 @@ namespace tuvok {
       void UploadFirstBrick(const BrickKey& bkey);
 
       // returns false if we need to render first before we can continue to upload further bricks
-      bool UploadBrick(const BrickElemInfo& metaData, void* pData); // TODO: we could use the 1D-index here too
+      bool UploadBrick(const BrickElemInfo& metaData, const void* pData); // TODO: we could use the 1D-index here too
+      // number of bricks UploadBrick will still accept before we need to render
+      size_t GetFreeSlotCount() const;
       void UploadFirstBrick(const UINTVECTOR3& m_vVoxelSize, void* pData);
       void UploadMetadataTexture();
       void UploadMetadataTexel(uint32_t iBrickID);
@@ -134,11 +142,6 @@ namespace tuvok {
       UINTVECTOR3 const& GetVolumeSize() const;
       UINTVECTOR3 const& GetMaxInnerBrickSize() const;
 
-      struct MinMax {
-        double min;
-        double max;
-      };
-
       uint64_t GetMaxUsedBrickBytes() const { return m_iMaxUsedBrickBytes; }
 
     protected:
@@ -179,11 +182,11 @@ namespace tuvok {
       std::vector<uint32_t>     m_vBrickMetadata;  // ref by iBrickID, size of total brick count + some unused 2d texture padding
       std::vector<PoolSlotData> m_vPoolSlotData;   // size of available pool slots
       std::vector<uint32_t>     m_vLoDOffsetTable; // size of LoDs, stores index sums, level 0 is finest
+      std::vector<UINTVECTOR3>  m_vBrickLayout; // bricks per dimension of every LoD, level 0 is finest
 
-      size_t m_iMinMaxScalarTimestep;        // current timestep of scalar acceleration structure below
-      size_t m_iMinMaxGradientTimestep;      // current timestep of gradient acceleration structure below
-      std::vector<MinMax> m_vMinMaxScalar;   // accelerates access to minmax scalar information, gets constructed in c'tor
-      std::vector<MinMax> m_vMinMaxGradient; // accelerates access to minmax gradient information, gets constructed on first access to safe some mem
+      size_t m_iMinMaxTimestep;                          // current timestep of the acceleration structure below
+      std::shared_ptr<const MinMaxTable> m_pMinMaxTable; // minmax scalar and gradient information ref by iBrickID
+      std::vector<uint64_t> m_vVisibleBricks;            // one bit per iBrickID, classification for the current visibility state
       double m_BrickIOTime;
       uint64_t m_BrickIOBytes;
 
@@ -193,11 +196,13 @@ namespace tuvok {
 
       void CreateGLResources();
       void FreeGLResources();
+      void LoadMinMaxTable();
 
       void PrepareForPaging();
 
-      void UploadBrick(uint32_t iBrickID, const UINTVECTOR3& vVoxelSize, void* pData, 
-                       size_t iInsertPos, uint64_t iTimeOfCreation);
+      void UploadBrick(uint32_t iBrickID, const UINTVECTOR3& vVoxelSize, const void* pData, 
+                       size_t iInsertPos, uint64_t iTimeOfCreation,
+                       const UINTVECTOR2& vPitch = UINTVECTOR2(0, 0));
 
       DebugMode const m_eDebugMode;
   };
@@ -150,8 +150,8 @@ GPUMemMan::~GPUMemMan() {
     delete i->pTransferFunction2D;
   }
 
-  for (GLVolumeListIter i = m_vpTex3DList.begin();
-       i < m_vpTex3DList.end(); ++i) {
+  const std::vector<GLVolumeListElem*> tex3D = m_Tex3D.Values();
+  for (auto i = tex3D.cbegin(); i != tex3D.cend(); ++i) {
     dbg.Warning(_func_, "Detected unfreed 3D texture.");
 
     m_iAllocatedGPUMemory -= (*i)->GetGPUSize();
@@ -634,21 +634,28 @@ void GPUMemMan::Free2DTrans(TransferFunction2D* pTransferFunction2D,
 
 // ******************** Volumes
 
+/// The upload options which make textures of the same brick differ.
+static uint32_t
+format_flags(bool bUseOnlyPowerOfTwo, bool bDownSampleTo8Bits,
+             bool bDisableBorder, bool bEmulate3DWith2DStacks)
+{
+  return (bUseOnlyPowerOfTwo     ? 1u : 0u) |
+         (bDownSampleTo8Bits     ? 2u : 0u) |
+         (bDisableBorder         ? 4u : 0u) |
+         (bEmulate3DWith2DStacks ? 8u : 0u);
+}
+
 bool GPUMemMan::IsResident(const Dataset* pDataset,
                            const BrickKey& key,
                            bool bUseOnlyPowerOfTwo, bool bDownSampleTo8Bits,
                            bool bDisableBorder,
                            bool bEmulate3DWith2DStacks,
                            int iShareGroupID) const {
-  for(GLVolumeListConstIter i = m_vpTex3DList.begin();
-      i < m_vpTex3DList.end(); ++i) {
-    if((*i)->Equals(pDataset, key, bUseOnlyPowerOfTwo,
-                    bDownSampleTo8Bits, bDisableBorder,
-                    bEmulate3DWith2DStacks, iShareGroupID)) {
-      return true;
-    }
-  }
-  return false;
+  const ResidencyKey rkey(pDataset, key,
+                          format_flags(bUseOnlyPowerOfTwo, bDownSampleTo8Bits,
+                                       bDisableBorder, bEmulate3DWith2DStacks),
+                          iShareGroupID);
+  return m_Tex3D.Find(rkey) != NULL;
 }
 
 /// Calculates the amount of memory the given brick will take up.
@@ -664,98 +671,32 @@ required_cpu_memory(const Dataset& ds, const BrickKey& key)
   return mem;
 }
 
-/// Searches the texture list for a texture which matches the given criterion.
-/// @return matching texture, or lst.end() if no texture matches.
-static GLVolumeListIter
-find_closest_texture(GLVolumeList &lst, const UINTVECTOR3& vSize,
-                     bool use_pot, bool downsample, bool disable_border,
-                     bool bEmulate3DWith2DStacks,
-                     int iShareGroupID)
-{
-  uint64_t iTargetFrameCounter = UINT64_INVALID;
-  uint64_t iTargetIntraFrameCounter = UINT64_INVALID;
-
-  GLVolumeListIter iBestMatch = lst.end();
-  for (GLVolumeListIter i=lst.begin(); i < lst.end(); ++i) {
-    if ((*i)->BestMatch(vSize, use_pot, downsample, disable_border,
-                        bEmulate3DWith2DStacks,
-                        iTargetIntraFrameCounter, iTargetFrameCounter,
-                        iShareGroupID)) {
-      iBestMatch = i;
-    }
-  }
-  if(iBestMatch != lst.end()) {
-    MESSAGE("  Found suitable target brick from frame %llu with intraframe "
-            "counter %llu.", iTargetFrameCounter,
-            iTargetIntraFrameCounter);
-  }
-  return iBestMatch;
-}
-
-
-// We use our own function instead of a functor because we're searching through
-// a list of 3D textures, which are noncopyable.  A copy operation on our 3d
-// texes would be expensive.
-template <typename ForwIter> static ForwIter
-find_brick_with_usercount(ForwIter first, const ForwIter last,
-                          int iShareGroupID, uint32_t user_count)
-{
-  while(first != last && !((*first)->iUserCount == user_count && iShareGroupID == (*first)->GetShareGroupID())) {
-    ++first;
-  }
-  return first;
-}
-
 // Gets rid of *all* unused bricks.  Returns the number of bricks it deleted.
 size_t GPUMemMan::DeleteUnusedBricks(int iShareGroupID) {
   size_t removed = 0;
-  // This is a bit harsh.  erase() in the middle of a deque invalidates *all*
-  // iterators.  So we repeatedly search for unused bricks, until our search
-  // comes up empty.
-  // That said, erase() at the beginning or end of a deque only invalidates the
-  // pointed-to element.  You might consider an optimization where we delete
-  // all unused bricks from the beginning and end of the structure, before
-  // moving on to the exhaustive+expensive search.
-  bool found;
-  do {
-    found = false;
-    const GLVolumeListIter& iter = find_brick_with_usercount(
-                                      m_vpTex3DList.begin(),
-                                      m_vpTex3DList.end(), 0, iShareGroupID
-                                    );
-    if(iter != m_vpTex3DList.end()) {
-      ++removed;
-      found = true;
-      Delete3DTexture(iter);
-    }
-  } while(!m_vpTex3DList.empty() && found);
+  while(GLVolumeListElem* tex = m_Tex3D.Victim(iShareGroupID)) {
+    Delete3DTexture(tex);
+    ++removed;
+  }
 
   MESSAGE("Got rid of %u unused bricks.", static_cast<unsigned int>(removed));
   return removed;
 }
 
-// We don't have enough CPU memory to load something.  Get rid of a brick.
-void GPUMemMan::DeleteArbitraryBrick(int iShareGroupID) {
-  assert(!m_vpTex3DList.empty());
-
-  // Identify the least used brick.  The 128 is an arbitrary choice.  We want
-  // it to be high enough to hit every conceivable number of users for a brick.
-  // We don't want to use 2^32 though, because then the application would feel
-  // like it hung if we had some other bug.
-  for(uint32_t in_use_by=0; in_use_by < 128; ++in_use_by) {
-    const GLVolumeListIter& iter = find_brick_with_usercount(
-                                      m_vpTex3DList.begin(),
-                                      m_vpTex3DList.end(), iShareGroupID, in_use_by
-                                    );
-    if(iter != m_vpTex3DList.end()) {
-      MESSAGE("  Deleting texture %d",
-              std::distance(iter, m_vpTex3DList.begin()));
-      Delete3DTexture(iter);
-      return;
-    }
+// We don't have enough CPU memory to load something.  Get rid of a brick:
+// the one the eviction policy likes least or, if all are in use, the one
+// with the fewest users.
+bool GPUMemMan::DeleteArbitraryBrick(int iShareGroupID) {
+  GLVolumeListElem* tex = m_Tex3D.LeastUsed(iShareGroupID);
+  if(tex == NULL) {
+    WARNING("No bricks in this share group: "
+            "cannot make space for a new brick.");
+    return false;
   }
-  WARNING("All bricks are (heavily) in use: "
-          "cannot make space for a new brick.");
+  MESSAGE("  Deleting texture with %u users",
+          static_cast<unsigned>(m_Tex3D.Users(tex)));
+  Delete3DTexture(tex);
+  return true;
 }
 
 void GPUMemMan::DeleteVolumePool(GLVolumePool** pool) {
@@ -864,7 +805,7 @@ GLVolume* GPUMemMan::GetVolume(Dataset* pDataset, const BrickKey& key,
     } catch(OutOfMemory&) { // Texture allocation failed.
       // If texture allocation failed and we had no bricks loaded, then the
       // system must be extremely memory limited.  Make a note and then bail.
-      if(m_vpTex3DList.empty()) {
+      if(m_Tex3D.empty()) {
         T_ERROR("This system does not have enough memory to render a brick.");
         return NULL;
       }
@@ -875,12 +816,18 @@ GLVolume* GPUMemMan::GetVolume(Dataset* pDataset, const BrickKey& key,
                 "deleting bricks that ARE in use!");
         // Delete up to 4 bricks.  We want to delete multiple bricks here
         // because we'll temporarily need copies of the bricks in memory.
-        for(size_t i=0; i < 4 && !m_vpTex3DList.empty(); ++i) {
-          DeleteArbitraryBrick(iShareGroupID);
+        for(size_t i=0; i < 4; ++i) {
+          if(!DeleteArbitraryBrick(iShareGroupID)) {
+            if(i == 0) {
+              T_ERROR("Not enough memory to render a brick.");
+              return NULL;
+            }
+            break;
+          }
         }
       }
     }
-  } while(!m_vpTex3DList.empty());
+  } while(!m_Tex3D.empty());
   // Can't happen, but to quiet compilers:
   return NULL;
 }
@@ -894,15 +841,16 @@ GLVolume* GPUMemMan::AllocOrGetVolume(Dataset* pDataset,
                                       uint64_t iIntraFrameCounter,
                                       uint64_t iFrameCounter,
                                       int iShareGroupID) {
-  for (GLVolumeListIter i = m_vpTex3DList.begin();
-       i < m_vpTex3DList.end(); i++) {
-    if ((*i)->Equals(pDataset, key, bUseOnlyPowerOfTwo,
-                     bDownSampleTo8Bits, bDisableBorder,
-                     bEmulate3DWith2DStacks, iShareGroupID)) {
-      GL_CHECK();
-      MESSAGE("Reusing 3D texture");
-      return (*i)->Access(iIntraFrameCounter, iFrameCounter);
-    }
+  const ResidencyKey rkey(pDataset, key,
+                          format_flags(bUseOnlyPowerOfTwo, bDownSampleTo8Bits,
+                                       bDisableBorder, bEmulate3DWith2DStacks),
+                          iShareGroupID);
+  GLVolumeListElem* pResident = m_Tex3D.Acquire(rkey, iIntraFrameCounter,
+                                                iFrameCounter);
+  if (pResident) {
+    GL_CHECK();
+    MESSAGE("Reusing 3D texture");
+    return pResident->volume;
   }
 
   uint64_t iNeededCPUMemory = required_cpu_memory(*pDataset, key);
@@ -920,24 +868,19 @@ GLVolume* GPUMemMan::AllocOrGetVolume(Dataset* pDataset,
             "paging ...", sz[0], sz[1], sz[2],
             iBitWidth, iCompCount);
 
-    // search for best brick to replace with this brick
-    UINTVECTOR3 vSize = pDataset->GetBrickVoxelCounts(key);
-    GLVolumeListIter iBestMatch = find_closest_texture(m_vpTex3DList, vSize,
-                                                       bUseOnlyPowerOfTwo,
-                                                       bDownSampleTo8Bits,
-                                                       bDisableBorder,
-                                                       bEmulate3DWith2DStacks,
-                                                       iShareGroupID);
-    if (iBestMatch != m_vpTex3DList.end()) {
-      // found a suitable brick that can be replaced
-      (*iBestMatch)->Replace(pDataset, key, bUseOnlyPowerOfTwo,
-                             bDownSampleTo8Bits, bDisableBorder,
-                             bEmulate3DWith2DStacks,
-                             iIntraFrameCounter, iFrameCounter,
-                             m_vUploadHub,
-                             iShareGroupID);
-      (*iBestMatch)->iUserCount++;
-      return (*iBestMatch)->volume;
+    // take over the texture of an unused brick of the same size
+    GLVolumeListElem* pBestMatch = m_Tex3D.Reuse(
+      SizeClass(sz, rkey.flags, iShareGroupID), rkey,
+      iIntraFrameCounter, iFrameCounter
+    );
+    if (pBestMatch) {
+      MESSAGE("  Found suitable target brick.");
+      pBestMatch->Replace(pDataset, key, bUseOnlyPowerOfTwo,
+                          bDownSampleTo8Bits, bDisableBorder,
+                          bEmulate3DWith2DStacks,
+                          m_vUploadHub,
+                          iShareGroupID);
+      return pBestMatch->volume;
     } else {
       // We know the brick doesn't fit in memory, and we know there's no
       // existing texture which matches enough that we could overwrite it with
@@ -947,7 +890,7 @@ GLVolume* GPUMemMan::AllocOrGetVolume(Dataset* pDataset,
 
       while (m_iAllocatedCPUMemory + iNeededCPUMemory >
              m_SystemInfo.GetMaxUsableCPUMem()) {
-        if (m_vpTex3DList.empty()) {
+        if (m_Tex3D.empty() || !DeleteArbitraryBrick(iShareGroupID)) {
           // we do not have enough memory to page in even a single block...
           T_ERROR("Not enough memory to page a single brick into memory, "
                   "aborting (MaxMem=%llukb, NeededMem=%llukb).",
@@ -955,8 +898,6 @@ GLVolume* GPUMemMan::AllocOrGetVolume(Dataset* pDataset,
                   iNeededCPUMemory/1024);
           return NULL;
         }
-
-        DeleteArbitraryBrick(iShareGroupID);
       }
     }
   }
@@ -974,8 +915,6 @@ GLVolume* GPUMemMan::AllocOrGetVolume(Dataset* pDataset,
                                                      bDownSampleTo8Bits,
                                                      bDisableBorder,
                                                      bEmulate3DWith2DStacks,
-                                                     iIntraFrameCounter,
-                                                     iFrameCounter,
                                                      m_MasterController,
                                                      m_vUploadHub,
                                                      iShareGroupID);
@@ -986,54 +925,62 @@ GLVolume* GPUMemMan::AllocOrGetVolume(Dataset* pDataset,
     return NULL;
   }
   MESSAGE("texture(s) created.");
-  pNew3DTex->iUserCount = 1;
 
   m_iAllocatedGPUMemory += pNew3DTex->GetGPUSize();
   m_iAllocatedCPUMemory += pNew3DTex->GetCPUSize();
 
-  m_vpTex3DList.push_back(pNew3DTex);
-  return (*(m_vpTex3DList.end()-1))->volume;
+  // reloading costs reading and converting the source brick
+  m_Tex3D.Insert(rkey, sz, pNew3DTex, pNew3DTex->GetGPUSize(),
+                 iNeededCPUMemory, iIntraFrameCounter, iFrameCounter);
+  m_Tex3DByVolume[pNew3DTex->volume] = pNew3DTex;
+  return pNew3DTex->volume;
 }
 
 void GPUMemMan::Release3DTexture(GLVolume* pGLVolume) {
-  for (size_t i = 0;i<m_vpTex3DList.size();i++) {
-    if (m_vpTex3DList[i]->volume == pGLVolume) {
-      if (m_vpTex3DList[i]->iUserCount > 0) {
-        m_vpTex3DList[i]->iUserCount--;
-        MESSAGE("Decreased 3D texture use count to %u",
-                m_vpTex3DList[i]->iUserCount);
-      } else {
-        WARNING("Attempting to release a 3D volume that is not in use.");
-      }
-    }
+  auto tex = m_Tex3DByVolume.find(pGLVolume);
+  if (tex == m_Tex3DByVolume.end()) { return; }
+  if (m_Tex3D.Release(tex->second)) {
+    MESSAGE("Decreased 3D texture use count to %u",
+            m_Tex3D.Users(tex->second));
+  } else {
+    WARNING("Attempting to release a 3D volume that is not in use.");
   }
 }
 
+void GPUMemMan::SetEvictionPolicy(unsigned int iPolicy) {
+  switch(iPolicy) {
+    case 0:
+      m_Tex3D.SetPolicy(std::unique_ptr<EvictionPolicy>(
+                          new FrameCounterEviction()));
+      break;
+    case 1:
+      m_Tex3D.SetPolicy(std::unique_ptr<EvictionPolicy>(new LRUEviction()));
+      break;
+    case 2:
+      m_Tex3D.SetPolicy(std::unique_ptr<EvictionPolicy>(
+                          new CostAwareEviction()));
+      break;
+    default:
+      WARNING("Unknown eviction policy %u", iPolicy);
+      break;
+  }
+}
 
-void GPUMemMan::Delete3DTexture(const GLVolumeListIter& tex) {
-  m_iAllocatedGPUMemory -= (*tex)->GetGPUSize();
-  m_iAllocatedCPUMemory -= (*tex)->GetCPUSize();
+void GPUMemMan::Delete3DTexture(GLVolumeListElem* tex) {
+  m_iAllocatedGPUMemory -= tex->GetGPUSize();
+  m_iAllocatedCPUMemory -= tex->GetCPUSize();
 
-  if((*tex)->iUserCount != 0) {
+  const uint32_t iUsers = m_Tex3D.Users(tex);
+  if(iUsers != 0) {
     WARNING("Freeing used GL volume!");
   }
   MESSAGE("Deleting GL texture with use count %u",
-          static_cast<unsigned>((*tex)->iUserCount));
-  delete *tex;
-  m_vpTex3DList.erase(tex);
-}
-
-void GPUMemMan::Delete3DTexture(size_t iIndex) {
-  this->Delete3DTexture(m_vpTex3DList.begin() + iIndex);
+          static_cast<unsigned>(iUsers));
+  m_Tex3D.Evict(tex);
+  m_Tex3DByVolume.erase(tex->volume);
+  delete tex;
 }
 
-// Functor to identify a texture that belongs to a particular dataset.
-struct DatasetTexture: std::binary_function<Dataset, GLVolumeListElem, bool> {
-  bool operator()(const GLVolumeListElem* tex, std::pair<const Dataset*, int> dsinfo) const {
-    return tex->pDataset == dsinfo.first && tex->GetShareGroupID() == dsinfo.second;
-  }
-};
-
 void GPUMemMan::FreeAssociatedTextures(Dataset* pDataset, int iShareGroupID) {
   // Don't use singleton; see destructor comments.
   AbstrDebugOut& dbg = *(m_MasterController->DebugOut());
@@ -1044,14 +991,12 @@ void GPUMemMan::FreeAssociatedTextures(Dataset* pDataset, int iShareGroupID) {
     dbg.Message(_func_, "Deleting textures associated with '%s' dataset.",
                 fbd.Filename().c_str());
   } catch(const std::bad_cast&) {}
-  while(1) { // exit condition is checked for and `break'd in the loop.
-    const GLVolumeListIter& iter =
-      std::find_if(m_vpTex3DList.begin(), m_vpTex3DList.end(),
-                   std::bind(DatasetTexture(), _1, make_pair(pDataset,iShareGroupID)) );
-    if(iter == m_vpTex3DList.end()) {
-      break;
+  const std::vector<GLVolumeListElem*> tex3D = m_Tex3D.Values();
+  for(auto tex = tex3D.cbegin(); tex != tex3D.cend(); ++tex) {
+    if((*tex)->pDataset == pDataset &&
+       (*tex)->GetShareGroupID() == iShareGroupID) {
+      Delete3DTexture(*tex);
     }
-    Delete3DTexture(iter);
   }
 }
 
@@ -1081,39 +1026,14 @@ GLFBOTex* GPUMemMan::GetFBO(GLenum minfilter, GLenum magfilter,
 
   // if we are running out of mem, kick out bricks to create room for the FBO
   while (m_iAllocatedCPUMemory + m_iCPUMemEstimate >
-         m_SystemInfo.GetMaxUsableCPUMem() && !m_vpTex3DList.empty()) {
+         m_SystemInfo.GetMaxUsableCPUMem() && !m_Tex3D.empty()) {
     MESSAGE("Not enough memory for FBO %i x %i x %i, "
             "paging out bricks ...", int(width), int(height), iNumBuffers);
 
-    // search for best brick to replace with this brick
-    uint64_t iMinTargetFrameCounter;
-    uint64_t iMaxTargetIntraFrameCounter;
-    (*m_vpTex3DList.begin())->GetCounters(iMaxTargetIntraFrameCounter,
-                                          iMinTargetFrameCounter);
-    size_t iIndex = 0;
-    size_t iBestIndex = 0;
-
-    for (GLVolumeListIter i = m_vpTex3DList.begin()+1;
-         i < m_vpTex3DList.end(); ++i) {
-      uint64_t iTargetFrameCounter = UINT64_INVALID;
-      uint64_t iTargetIntraFrameCounter = UINT64_INVALID;
-      (*i)->GetCounters(iTargetIntraFrameCounter, iTargetFrameCounter);
-      iIndex++;
-
-      if (iTargetFrameCounter < iMinTargetFrameCounter) {
-        iMinTargetFrameCounter = iTargetFrameCounter;
-        iMaxTargetIntraFrameCounter = iTargetIntraFrameCounter;
-        iBestIndex = iIndex;
-      } else {
-        if (iTargetFrameCounter == iMinTargetFrameCounter &&
-            iTargetIntraFrameCounter > iMaxTargetIntraFrameCounter) {
-          iMaxTargetIntraFrameCounter = iTargetIntraFrameCounter;
-          iBestIndex = iIndex;
-        }
-      }
-    }
-    MESSAGE("   Deleting texture %u", static_cast<unsigned>(iBestIndex));
-    Delete3DTexture(iBestIndex);
+    GLVolumeListElem* tex = m_Tex3D.Victim();
+    if (tex == NULL) { tex = m_Tex3D.LeastUsed(iShareGroupID); }
+    if (tex == NULL) { break; }
+    Delete3DTexture(tex);
   }
 
 
@@ -1237,5 +1157,11 @@ void GPUMemMan::RegisterLuaCommands() {
                                    nm + "changed1DTrans", "", false);
   id = m_pMemReg->registerFunction(this,&GPUMemMan::Changed2DTrans,
                                    nm + "changed2DTrans", "", false);
+  id = m_pMemReg->registerFunction(this,&GPUMemMan::SetEvictionPolicy,
+                                   nm + "evictionPolicy",
+                                   "which unused bricks go first when memory "
+                                   "runs out.  0: oldest frame (default), "
+                                   "1: least recently used, 2: cost aware",
+                                   false);
 }
 
@@ -31,11 +31,13 @@
 #define TUVOK_GPUMEMMAN_H
 
 #include <deque>
+#include <unordered_map>
 #include <utility>
 #include "../../StdTuvokDefines.h"
 #include "3rdParty/GLEW/GL/glew.h"
 #include "Basics/Vectors.h"
 #include "GPUMemManDataStructs.h"
+#include "ResidencyTable.h"
 
 class SystemInfo;
 class TransferFunction1D;
@@ -115,6 +117,11 @@ class GPUMemMan {
 
     void Release3DTexture(GLVolume* pGLVolume);
 
+    /// Chooses which unused 3D textures are dropped first.
+    /// 0: oldest frame first (default), 1: least recently used,
+    /// 2: cost aware (GreedyDual-Size)
+    void SetEvictionPolicy(unsigned int iPolicy);
+
     GLFBOTex* GetFBO(GLenum minfilter, GLenum magfilter, GLenum wrapmode,
                      GLsizei width, GLsizei height, GLenum intformat,
                      GLenum format, GLenum type,
@@ -152,7 +159,8 @@ class GPUMemMan {
     SimpleTextureList           m_vpSimpleTextures;
     Trans1DList                 m_vpTrans1DList;
     Trans2DList                 m_vpTrans2DList;
-    GLVolumeList                m_vpTex3DList;
+    ResidencyTable<GLVolumeListElem> m_Tex3D;
+    std::unordered_map<const GLVolume*, GLVolumeListElem*> m_Tex3DByVolume;
     FBOList                     m_vpFBOList;
     GLSLList                    m_vpGLSLList;
     MasterController*           m_MasterController;
@@ -178,9 +186,8 @@ class GPUMemMan {
                                uint64_t iFrameCounter,
                                int iShareGroupID);
     size_t DeleteUnusedBricks(int iShareGroupID);
-    void DeleteArbitraryBrick(int iShareGroupID);
-    void Delete3DTexture(size_t iIndex);
-    void Delete3DTexture(const GLVolumeListIter &tex);
+    bool DeleteArbitraryBrick(int iShareGroupID);
+    void Delete3DTexture(GLVolumeListElem* tex);
     void RegisterLuaCommands();
 };
 }
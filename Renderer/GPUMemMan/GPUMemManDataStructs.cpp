@@ -56,15 +56,10 @@ GLVolumeListElem::GLVolumeListElem(Dataset* _pDataset, const BrickKey& key,
                                    bool bIsDownsampledTo8Bits,
                                    bool bDisableBorder,
                                    bool bEmulate3DWith2DStacks,
-                                   uint64_t iIntraFrameCounter,
-                                   uint64_t iFrameCounter,
                                    MasterController* pMasterController,
                                    std::vector<unsigned char>& vUploadHub,
                                    int iShareGroupID) :
   pDataset(_pDataset),
-  iUserCount(1),
-  m_iIntraFrameCounter(iIntraFrameCounter),
-  m_iFrameCounter(iFrameCounter),
   m_pMasterController(pMasterController),
   m_Key(key),
   m_bIsPaddedToPowerOfTwo(bIsPaddedToPowerOfTwo),
@@ -86,72 +81,6 @@ GLVolumeListElem::~GLVolumeListElem() {
   FreeTexture();
 }
 
-bool GLVolumeListElem::Equals(const Dataset* _pDataset, const BrickKey& key,
-                              bool bIsPaddedToPowerOfTwo,
-                              bool bIsDownsampledTo8Bits, bool bDisableBorder,
-                              bool bEmulate3DWith2DStacks,
-                              int iShareGroupID) const
-{
-  if (_pDataset != pDataset ||
-      m_Key != key ||
-      m_bIsPaddedToPowerOfTwo != bIsPaddedToPowerOfTwo ||
-      m_bIsDownsampledTo8Bits != bIsDownsampledTo8Bits ||
-      m_bDisableBorder != bDisableBorder ||
-      m_bEmulate3DWith2DStacks != bEmulate3DWith2DStacks ||
-      m_iShareGroupID != iShareGroupID) {
-    return false;
-  }
-
-  return true;
-}
-
-GLVolume* GLVolumeListElem::Access(uint64_t& iIntraFrameCounter, uint64_t& iFrameCounter) {
-  m_iIntraFrameCounter = iIntraFrameCounter;
-  m_iFrameCounter = iFrameCounter;
-  iUserCount++;
-
-  return volume;
-}
-
-bool GLVolumeListElem::BestMatch(const UINTVECTOR3& vDimension,
-                                 bool bIsPaddedToPowerOfTwo,
-                                 bool bIsDownsampledTo8Bits,
-                                 bool bDisableBorder,
-                                 bool bEmulate3DWith2DStacks,
-                                 uint64_t& iIntraFrameCounter,
-                                 uint64_t& iFrameCounter,
-                                 int iShareGroupID) const
-{
-  if (!Match(vDimension) || iUserCount > 0
-      || m_bIsPaddedToPowerOfTwo != bIsPaddedToPowerOfTwo
-      || m_bIsDownsampledTo8Bits != bIsDownsampledTo8Bits
-      || m_bDisableBorder != bDisableBorder
-      || m_bEmulate3DWith2DStacks != bEmulate3DWith2DStacks
-      || m_iShareGroupID != iShareGroupID) {
-    return false;
-  }
-
-  // framewise older data as before found -> use this object
-  if (iFrameCounter > m_iFrameCounter) {
-      iFrameCounter = m_iFrameCounter;
-      iIntraFrameCounter = m_iIntraFrameCounter;
-
-      return true;
-  }
-
-  // framewise older data as before found -> use this object
-  if (iFrameCounter == m_iFrameCounter &&
-      iIntraFrameCounter < m_iIntraFrameCounter) {
-
-      iFrameCounter = m_iFrameCounter;
-      iIntraFrameCounter = m_iIntraFrameCounter;
-
-      return true;
-  }
-
-  return false;
-}
-
 namespace nonstd {
   // an accumulate which follows the standard accumulate, except instead of:
   //    result = result + *i
@@ -210,28 +139,12 @@ size_t GLVolumeListElem::GetCPUSize() const
 
 
 
-bool GLVolumeListElem::Match(const UINTVECTOR3& vDimension) const {
-  if(!volume) { return false; }
-
-  const UINTVECTOR3 vSize = pDataset->GetBrickVoxelCounts(m_Key);
-
-  for (size_t i=0; i < 3; i++) {
-    if (vSize[i] != vDimension[i]) {
-      return false;
-    }
-  }
-
-  return true;
-}
-
 bool GLVolumeListElem::Replace(Dataset* _pDataset,
                                const BrickKey& key,
                                bool bIsPaddedToPowerOfTwo,
                                bool bIsDownsampledTo8Bits,
                                bool bDisableBorder,
                                bool bEmulate3DWith2DStacks,
-                               uint64_t iIntraFrameCounter,
-                               uint64_t iFrameCounter,
                                std::vector<unsigned char>& vUploadHub,
                                int iShareGroupID) {
   if(!volume) { return false; }
@@ -253,9 +166,6 @@ bool GLVolumeListElem::Replace(Dataset* _pDataset,
   (void)iShareGroupID;
 #endif
 
-  m_iIntraFrameCounter = iIntraFrameCounter;
-  m_iFrameCounter = iFrameCounter;
-
   if (!LoadData(vUploadHub)) {
     T_ERROR("LoadData call failed, system may be out of memory");
     return false;
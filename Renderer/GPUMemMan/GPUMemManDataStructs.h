@@ -146,35 +146,21 @@ namespace tuvok {
   /// object.  However, for one, this is untested.  Secondly, this object may
   /// hold the chunk of data for the 3D texture, so copying it in the general
   /// case would be a bad idea -- the copy might be large.
+  /// Who uses the texture and when it may go is tracked by GPUMemMan's
+  /// ResidencyTable, not here.
   class GLVolumeListElem : boost::noncopyable {
   public:
     GLVolumeListElem(Dataset* _pDataset, const BrickKey&,
                      bool bIsPaddedToPowerOfTwo, bool bDisableBorder,
                      bool bIsDownsampledTo8Bits, bool bEmulate3DWith2DStacks,
-                     uint64_t iIntraFrameCounter,
-                     uint64_t iFrameCounter, MasterController* pMasterController,
+                     MasterController* pMasterController,
                      std::vector<unsigned char>& vUploadHub, int iShareGroupID);
     ~GLVolumeListElem();
 
-    bool Equals(const Dataset* _pDataset, const BrickKey&,
-                bool bIsPaddedToPowerOfTwo, bool bIsDownsampledTo8Bits,
-                bool bDisableBorder, bool bEmulate3DWith2DStacks,
-                int iShareGroupID) const;
     bool Replace(Dataset* _pDataset, const BrickKey&,
                  bool bIsPaddedToPowerOfTwo, bool bIsDownsampledTo8Bits,
                  bool bDisableBorder, bool bEmulate3DWith2DStacks,
-                 uint64_t iIntraFrameCounter, uint64_t iFrameCounter,
                  std::vector<unsigned char>& vUploadHub, int iShareGroupID);
-    bool BestMatch(const UINTVECTOR3& vDimension,
-                   bool bIsPaddedToPowerOfTwo, bool bIsDownsampledTo8Bits,
-                   bool bDisableBorder, bool bEmulate3DWith2DStacks,
-                   uint64_t& iIntraFrameCounter,
-                   uint64_t& iFrameCounter, int iShareGroupID) const;
-    void GetCounters(uint64_t& iIntraFrameCounter,
-                     uint64_t& iFrameCounter) const {
-      iIntraFrameCounter = m_iIntraFrameCounter;
-      iFrameCounter = m_iFrameCounter;
-    }
 
     /// Calculates the sizes for all GLVolume's we've currently got loaded.
     ///@{
@@ -182,8 +168,6 @@ namespace tuvok {
     size_t GetCPUSize() const;
     ///@}
 
-    GLVolume* Access(uint64_t& iIntraFrameCounter, uint64_t& iFrameCounter);
-
     bool LoadData(std::vector<unsigned char>& vUploadHub);
     void FreeData();
     std::pair<std::shared_ptr<unsigned char>, UINTVECTOR3> PadData(
@@ -199,18 +183,10 @@ namespace tuvok {
     std::vector<unsigned char>    vData;
     GLVolume*                     volume;
     Dataset*                      pDataset;
-    uint32_t                      iUserCount;
-
-    uint64_t GetIntraFrameCounter() const {return m_iIntraFrameCounter;}
-    uint64_t GetFrameCounter() const {return m_iFrameCounter;}
 
     int GetShareGroupID() const {return m_iShareGroupID;}
   
   private:
-    bool Match(const UINTVECTOR3& vDimension) const;
-
-    uint64_t m_iIntraFrameCounter;
-    uint64_t m_iFrameCounter;
     MasterController* m_pMasterController;
 
     BrickKey m_Key;
@@ -222,10 +198,6 @@ namespace tuvok {
     int m_iShareGroupID;
   };
 
-  typedef std::deque<GLVolumeListElem*> GLVolumeList;
-  typedef GLVolumeList::iterator GLVolumeListIter;
-  typedef GLVolumeList::const_iterator GLVolumeListConstIter;
-
   // framebuffer objects
   class FBOListElem {
   public:
@@ -0,0 +1,27 @@
+#include <algorithm>
+#include "ResidencyTable.h"
+
+namespace tuvok
+{
+  ResidencyRank LRUEviction::Rank(const ResidencyStats& s) {
+    ResidencyRank r = { double(s.iLastUse), 0.0 };
+    return r;
+  }
+
+  ResidencyRank FrameCounterEviction::Rank(const ResidencyStats& s) {
+    ResidencyRank r = { double(s.iFrame), -double(s.iIntraFrame) };
+    return r;
+  }
+
+  ResidencyRank CostAwareEviction::Rank(const ResidencyStats& s) {
+    const double perByte = double(s.iCost) /
+                           double(std::max<uint64_t>(s.iBytes, 1));
+    ResidencyRank r = { m_fInflation + perByte, double(s.iLastUse) };
+    return r;
+  }
+
+  void CostAwareEviction::Evicted(const ResidencyRank& r) {
+    // everything ranked from now on has to beat what was just evicted
+    m_fInflation = std::max(m_fInflation, r.primary);
+  }
+}
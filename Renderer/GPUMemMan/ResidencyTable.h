@@ -0,0 +1,378 @@
+#pragma once
+
+#ifndef TUVOK_RESIDENCYTABLE_H
+#define TUVOK_RESIDENCYTABLE_H
+
+#include "StdTuvokDefines.h"
+#include <cassert>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "Basics/Vectors.h"
+#include "IO/Brick.h"
+
+namespace tuvok
+{
+  /// Identifies a resident brick: which brick, in which format (the
+  /// GPUMemMan upload options as bit flags) and for which share group.
+  struct ResidencyKey {
+    ResidencyKey(const void* ds, const BrickKey& key, uint32_t fmt, int sg) :
+      dataset(ds), brick(key), flags(fmt), shareGroup(sg) {}
+    bool operator==(const ResidencyKey& k) const {
+      return dataset == k.dataset && brick == k.brick && flags == k.flags &&
+             shareGroup == k.shareGroup;
+    }
+
+    const void* dataset;
+    BrickKey brick;
+    uint32_t flags;
+    int shareGroup;
+  };
+
+  struct ResidencyKeyHash {
+    size_t operator()(const ResidencyKey& k) const {
+      size_t h = BKeyHash()(k.brick);
+      h ^= std::hash<const void*>()(k.dataset) + 0x9e3779b9 + (h<<6) + (h>>2);
+      h ^= std::hash<uint64_t>()((uint64_t(k.flags) << 32) ^
+                                 uint32_t(k.shareGroup)) +
+           0x9e3779b9 + (h<<6) + (h>>2);
+      return h;
+    }
+  };
+
+  /// Bricks of the same size class can take over each other's texture.
+  struct SizeClass {
+    SizeClass(const UINTVECTOR3& vSize, uint32_t fmt, int sg) :
+      size(vSize), flags(fmt), shareGroup(sg) {}
+    bool operator<(const SizeClass& c) const {
+      if(shareGroup != c.shareGroup) { return shareGroup < c.shareGroup; }
+      if(flags != c.flags) { return flags < c.flags; }
+      for(size_t i=0; i < 3; ++i) {
+        if(size[i] != c.size[i]) { return size[i] < c.size[i]; }
+      }
+      return false;
+    }
+
+    UINTVECTOR3 size;
+    uint32_t flags;
+    int shareGroup;
+  };
+
+  /// What an eviction policy gets to know about an unused brick.
+  struct ResidencyStats {
+    uint64_t iIntraFrame; ///< intra frame counter of its last use
+    uint64_t iFrame;      ///< frame counter of its last use
+    uint64_t iLastUse;    ///< table wide, increases with every use
+    uint64_t iBytes;      ///< memory it occupies
+    uint64_t iCost;       ///< what it costs to load it again
+  };
+
+  /// Position in the eviction order; lower ranks are evicted first.
+  struct ResidencyRank {
+    double primary;
+    double secondary;
+  };
+
+  /// Decides which unused brick to evict.  A brick is ranked once, when its
+  /// last user releases it.
+  class EvictionPolicy {
+  public:
+    virtual ~EvictionPolicy() {}
+    virtual ResidencyRank Rank(const ResidencyStats& s) = 0;
+    /// Tells the policy that a brick of the given rank was evicted.
+    virtual void Evicted(const ResidencyRank&) {}
+  };
+
+  /// Evicts the brick which was used least recently.
+  class LRUEviction : public EvictionPolicy {
+  public:
+    virtual ResidencyRank Rank(const ResidencyStats& s);
+  };
+
+  /// Evicts bricks from the oldest frame first; within a frame, the brick
+  /// used last goes first, since the renderer walks the bricks in the same
+  /// order every frame.  This is what GPUMemMan has always done.
+  class FrameCounterEviction : public EvictionPolicy {
+  public:
+    virtual ResidencyRank Rank(const ResidencyStats& s);
+  };
+
+  /// GreedyDual-Size: bricks which are expensive to load per byte they
+  /// occupy stay longer, but everything ages.
+  class CostAwareEviction : public EvictionPolicy {
+  public:
+    CostAwareEviction() : m_fInflation(0.0) {}
+    virtual ResidencyRank Rank(const ResidencyStats& s);
+    virtual void Evicted(const ResidencyRank& r);
+
+  private:
+    double m_fInflation;
+  };
+
+  /// Bookkeeping for resident bricks, independent of how they are stored.
+  ///
+  /// Values are looked up by key in constant time.  Unused values are kept
+  /// sorted by the eviction policy, once per share group and once per size
+  /// class, so both the next victim and the best texture to reuse for a
+  /// brick of a given size are found without scanning.  The table never
+  /// creates or deletes values; it only tracks them.
+  template<class T>
+  class ResidencyTable {
+  public:
+    ResidencyTable() : m_pPolicy(new FrameCounterEviction()), m_iUses(0) {}
+
+    /// Re-ranks all unused values.
+    void SetPolicy(std::unique_ptr<EvictionPolicy> policy);
+
+    /// @returns the value stored under 'key', or NULL
+    T* Find(const ResidencyKey& key) const;
+    /// Like Find, but also counts one more user of the value.
+    T* Acquire(const ResidencyKey& key, uint64_t iIntraFrame,
+               uint64_t iFrame);
+    /// Adds a value with a single user.
+    void Insert(const ResidencyKey& key, const UINTVECTOR3& vSize, T* value,
+                uint64_t iBytes, uint64_t iCost, uint64_t iIntraFrame,
+                uint64_t iFrame);
+    /// Counts one user less.
+    /// @returns false if the value is unknown or not in use
+    bool Release(const T* value);
+    /// Takes the unused value of the given size class which the policy would
+    /// evict first, and files it under 'key' with a single user.  The caller
+    /// then fills it with the new brick.
+    /// @returns NULL if there is no such value
+    T* Reuse(const SizeClass& cls, const ResidencyKey& key,
+             uint64_t iIntraFrame, uint64_t iFrame);
+    /// @returns the unused value the policy would evict first, or NULL
+    ///@{
+    T* Victim(int shareGroup) const;
+    T* Victim() const;
+    ///@}
+    /// The victim or, if everything is in use, the value with the fewest
+    /// users.
+    T* LeastUsed(int shareGroup) const;
+    /// Forgets about the value; deleting it is up to the caller.
+    void Remove(const T* value);
+    /// Same as Remove, but lets the policy know that the value was evicted.
+    void Evict(const T* value);
+
+    uint32_t Users(const T* value) const;
+    std::vector<T*> Values() const;
+    size_t size() const { return m_Entries.size(); }
+    bool empty() const { return m_Entries.empty(); }
+
+  private:
+    struct Entry {
+      Entry(const ResidencyKey& k, const SizeClass& c) : key(k), cls(c) {}
+      ResidencyKey key;
+      SizeClass cls;
+      T* value;
+      uint32_t iUsers;
+      ResidencyStats stats;
+      ResidencyRank rank;
+    };
+    struct RankLess {
+      bool operator()(const Entry* a, const Entry* b) const {
+        if(a->rank.primary != b->rank.primary) {
+          return a->rank.primary < b->rank.primary;
+        }
+        if(a->rank.secondary != b->rank.secondary) {
+          return a->rank.secondary < b->rank.secondary;
+        }
+        return a->stats.iLastUse < b->stats.iLastUse;
+      }
+    };
+    typedef std::set<Entry*, RankLess> IdleSet;
+
+    Entry* Lookup(const T* value) const;
+    void MakeIdle(Entry* e);
+    void MakeBusy(Entry* e);
+    void Use(Entry* e, uint64_t iIntraFrame, uint64_t iFrame);
+
+    std::unordered_map<ResidencyKey, Entry*, ResidencyKeyHash> m_Index;
+    std::unordered_map<const T*, std::unique_ptr<Entry>> m_Entries;
+    std::map<int, IdleSet> m_Idle;           ///< by share group
+    std::map<SizeClass, IdleSet> m_FreeLists;
+    std::unique_ptr<EvictionPolicy> m_pPolicy;
+    uint64_t m_iUses;
+  };
+
+  template<class T>
+  void ResidencyTable<T>::SetPolicy(std::unique_ptr<EvictionPolicy> policy) {
+    std::vector<Entry*> idle;
+    for(auto g = m_Idle.begin(); g != m_Idle.end(); ++g) {
+      idle.insert(idle.end(), g->second.begin(), g->second.end());
+    }
+    for(auto e = idle.begin(); e != idle.end(); ++e) { MakeBusy(*e); }
+    m_pPolicy = std::move(policy);
+    for(auto e = idle.begin(); e != idle.end(); ++e) { MakeIdle(*e); }
+  }
+
+  template<class T>
+  T* ResidencyTable<T>::Find(const ResidencyKey& key) const {
+    auto i = m_Index.find(key);
+    return i == m_Index.end() ? NULL : i->second->value;
+  }
+
+  template<class T>
+  T* ResidencyTable<T>::Acquire(const ResidencyKey& key,
+                                uint64_t iIntraFrame, uint64_t iFrame) {
+    auto i = m_Index.find(key);
+    if(i == m_Index.end()) { return NULL; }
+    Entry* e = i->second;
+    if(e->iUsers == 0) { MakeBusy(e); }
+    ++e->iUsers;
+    Use(e, iIntraFrame, iFrame);
+    return e->value;
+  }
+
+  template<class T>
+  void ResidencyTable<T>::Insert(const ResidencyKey& key,
+                                 const UINTVECTOR3& vSize, T* value,
+                                 uint64_t iBytes, uint64_t iCost,
+                                 uint64_t iIntraFrame, uint64_t iFrame) {
+    assert(m_Index.find(key) == m_Index.end());
+    assert(m_Entries.find(value) == m_Entries.end());
+    std::unique_ptr<Entry> e(new Entry(key, SizeClass(vSize, key.flags,
+                                                      key.shareGroup)));
+    e->value = value;
+    e->iUsers = 1;
+    e->stats.iBytes = iBytes;
+    e->stats.iCost = iCost;
+    Use(e.get(), iIntraFrame, iFrame);
+    m_Index[key] = e.get();
+    m_Entries[value] = std::move(e);
+  }
+
+  template<class T>
+  bool ResidencyTable<T>::Release(const T* value) {
+    Entry* e = Lookup(value);
+    if(!e || e->iUsers == 0) { return false; }
+    if(--e->iUsers == 0) {
+      e->stats.iLastUse = m_iUses++;
+      MakeIdle(e);
+    }
+    return true;
+  }
+
+  template<class T>
+  T* ResidencyTable<T>::Reuse(const SizeClass& cls, const ResidencyKey& key,
+                              uint64_t iIntraFrame, uint64_t iFrame) {
+    auto fl = m_FreeLists.find(cls);
+    if(fl == m_FreeLists.end() || fl->second.empty()) { return NULL; }
+    Entry* e = *fl->second.begin();
+    assert(key.flags == cls.flags && key.shareGroup == cls.shareGroup);
+    assert(m_Index.find(key) == m_Index.end());
+    m_pPolicy->Evicted(e->rank);
+    MakeBusy(e);
+    m_Index.erase(e->key);
+    e->key = key;
+    m_Index[key] = e;
+    e->iUsers = 1;
+    Use(e, iIntraFrame, iFrame);
+    return e->value;
+  }
+
+  template<class T>
+  T* ResidencyTable<T>::Victim(int shareGroup) const {
+    auto g = m_Idle.find(shareGroup);
+    if(g == m_Idle.end() || g->second.empty()) { return NULL; }
+    return (*g->second.begin())->value;
+  }
+
+  template<class T>
+  T* ResidencyTable<T>::Victim() const {
+    const Entry* best = NULL;
+    for(auto g = m_Idle.cbegin(); g != m_Idle.cend(); ++g) {
+      if(!g->second.empty() &&
+         (!best || RankLess()(*g->second.begin(), best))) {
+        best = *g->second.begin();
+      }
+    }
+    return best ? best->value : NULL;
+  }
+
+  template<class T>
+  T* ResidencyTable<T>::LeastUsed(int shareGroup) const {
+    T* victim = Victim(shareGroup);
+    if(victim) { return victim; }
+    // everything is in use; rare enough to just look at all of them
+    const Entry* best = NULL;
+    for(auto e = m_Entries.cbegin(); e != m_Entries.cend(); ++e) {
+      const Entry* c = e->second.get();
+      if(c->key.shareGroup == shareGroup &&
+         (!best || c->iUsers < best->iUsers)) {
+        best = c;
+      }
+    }
+    return best ? best->value : NULL;
+  }
+
+  template<class T>
+  void ResidencyTable<T>::Remove(const T* value) {
+    auto i = m_Entries.find(value);
+    if(i == m_Entries.end()) { return; }
+    Entry* e = i->second.get();
+    if(e->iUsers == 0) { MakeBusy(e); }
+    m_Index.erase(e->key);
+    m_Entries.erase(i);
+  }
+
+  template<class T>
+  void ResidencyTable<T>::Evict(const T* value) {
+    const Entry* e = Lookup(value);
+    if(e && e->iUsers == 0) { m_pPolicy->Evicted(e->rank); }
+    Remove(value);
+  }
+
+  template<class T>
+  uint32_t ResidencyTable<T>::Users(const T* value) const {
+    const Entry* e = Lookup(value);
+    return e ? e->iUsers : 0;
+  }
+
+  template<class T>
+  std::vector<T*> ResidencyTable<T>::Values() const {
+    std::vector<T*> values;
+    values.reserve(m_Entries.size());
+    for(auto e = m_Entries.cbegin(); e != m_Entries.cend(); ++e) {
+      values.push_back(e->second->value);
+    }
+    return values;
+  }
+
+  template<class T>
+  typename ResidencyTable<T>::Entry*
+  ResidencyTable<T>::Lookup(const T* value) const {
+    auto i = m_Entries.find(value);
+    return i == m_Entries.end() ? NULL : i->second.get();
+  }
+
+  template<class T>
+  void ResidencyTable<T>::MakeIdle(Entry* e) {
+    e->rank = m_pPolicy->Rank(e->stats);
+    m_Idle[e->key.shareGroup].insert(e);
+    m_FreeLists[e->cls].insert(e);
+  }
+
+  template<class T>
+  void ResidencyTable<T>::MakeBusy(Entry* e) {
+    auto g = m_Idle.find(e->key.shareGroup);
+    g->second.erase(e);
+    if(g->second.empty()) { m_Idle.erase(g); }
+    auto fl = m_FreeLists.find(e->cls);
+    fl->second.erase(e);
+    if(fl->second.empty()) { m_FreeLists.erase(fl); }
+  }
+
+  template<class T>
+  void ResidencyTable<T>::Use(Entry* e, uint64_t iIntraFrame,
+                              uint64_t iFrame) {
+    e->stats.iIntraFrame = iIntraFrame;
+    e->stats.iFrame = iFrame;
+    e->stats.iLastUse = m_iUses++;
+  }
+}
+
+#endif // TUVOK_RESIDENCYTABLE_H
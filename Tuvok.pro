@@ -97,6 +97,7 @@ HEADERS += \
            Basics/ArcBall.h \
            Basics/AvgMinMaxTracker.h \
            Basics/Checksums/crc32.h \
+           Basics/Checksums/crc32c.h \
            Basics/Checksums/MD5.h \
            Basics/Clipper.h \
            Basics/EndianFile.h \
@@ -112,6 +113,9 @@ HEADERS += \
            Basics/nonstd.h \
            Basics/PerfCounter.h \
            Basics/Plane.h \
+           Basics/PrefetchQueue.h \
+           Basics/PerfStats.h \
+           Basics/PerfTrace.h \
            Basics/ProgressTimer.h \
            Basics/SysTools.h \
            Basics/Threads.h \
@@ -123,6 +127,7 @@ HEADERS += \
            DebugOut/AbstrDebugOut.h \
            DebugOut/ConsoleOut.h \
            DebugOut/MultiplexOut.h \
+           DebugOut/RecordingOut.h \
            DebugOut/TextfileOut.h \
            IO/3rdParty/bzip2/bzlib_private.h \
            IO/3rdParty/jpeglib/cderror.h \
@@ -166,6 +171,7 @@ HEADERS += \
            IO/BMinMax.h \
            IO/BOVConverter.h \
            IO/BrickCache.h \
+           IO/BrickView.h \
            IO/BrickedDataset.h \
            IO/const-brick-iterator.h \
            IO/Dataset.h \
@@ -186,6 +192,8 @@ HEADERS += \
            IO/KeyValueFileParser.h \
            IO/KitwareConverter.h \
            IO/LinearIndexDataset.h \
+           IO/MinMaxTable.h \
+           IO/MinMaxIndex.h \
            IO/LinesGeoConverter.h \
            IO/MedAlyVisFiberTractGeoConverter.h \
            IO/MedAlyVisGeoConverter.h \
@@ -203,11 +211,17 @@ HEADERS += \
            IO/TiffVolumeConverter.h \
            IO/TransferFunction1D.h \
            IO/TransferFunction2D.h \
+           IO/DataMerger.h \
+           IO/TypeConversion.h \
+           IO/CompressedRAWFile.h \
+           IO/SliceConversion.h \
+           IO/SwatchRasterizer.h \
            IO/TTIFFWriter/TTIFFWriter.h \
            IO/TuvokIOError.h \
            IO/TuvokJPEG.h \
            IO/Tuvok_QtPlugins.h \
            IO/TuvokSizes.h \
+           IO/UVF/BlockChecksums.h \
            IO/UVF/DataBlock.h \
            IO/uvfDataset.h \
            IO/UVF/ExtendedOctree/BzlibCompression.h \
@@ -222,6 +236,7 @@ HEADERS += \
            IO/UVF/GlobalHeader.h \
            IO/UVF/Histogram1DDataBlock.h \
            IO/UVF/Histogram2DDataBlock.h \
+           IO/UVF/HistogramEngine.h \
            IO/UVF/KeyValuePairDataBlock.h \
            IO/UVF/MaxMinDataBlock.h \
            IO/uvfMesh.h \
@@ -289,6 +304,7 @@ HEADERS += \
            Renderer/GL/RenderMeshGL.h \
            Renderer/GPUMemMan/GPUMemManDataStructs.h \
            Renderer/GPUMemMan/GPUMemMan.h \
+           Renderer/GPUMemMan/ResidencyTable.h \
            Renderer/GPUObject.h \
            Renderer/RenderMesh.h \
            Renderer/RenderRegion.h \
@@ -343,6 +359,7 @@ SOURCES += \
            3rdParty/LUA/lzio.cpp \
            Basics/Appendix.cpp \
            Basics/ArcBall.cpp \
+           Basics/Checksums/crc32c.cpp \
            Basics/Checksums/MD5.cpp \
            Basics/Clipper.cpp \
            Basics/EndianFile.cpp \
@@ -355,6 +372,9 @@ SOURCES += \
            Basics/MC.cpp \
            Basics/Mesh.cpp \
            Basics/Plane.cpp \
+           Basics/PrefetchQueue.cpp \
+           Basics/PerfStats.cpp \
+           Basics/PerfTrace.cpp \
            Basics/ProgressTimer.cpp \
            Basics/SystemInfo.cpp \
            Basics/SysTools.cpp \
@@ -364,6 +384,7 @@ SOURCES += \
            DebugOut/AbstrDebugOut.cpp \
            DebugOut/ConsoleOut.cpp \
            DebugOut/MultiplexOut.cpp \
+           DebugOut/RecordingOut.cpp \
            DebugOut/TextfileOut.cpp \
            IO/3rdParty/bzip2/blocksort.c \
            IO/3rdParty/bzip2/bzlib.c \
@@ -503,6 +524,8 @@ SOURCES += \
            IO/KeyValueFileParser.cpp \
            IO/KitwareConverter.cpp \
            IO/LinearIndexDataset.cpp \
+           IO/MinMaxTable.cpp \
+           IO/MinMaxIndex.cpp \
            IO/LinesGeoConverter.cpp \
            IO/MedAlyVisFiberTractGeoConverter.cpp \
            IO/MedAlyVisGeoConverter.cpp \
@@ -519,8 +542,14 @@ SOURCES += \
            IO/TiffVolumeConverter.cpp \
            IO/TransferFunction1D.cpp \
            IO/TransferFunction2D.cpp \
+           IO/DataMerger.cpp \
+           IO/TypeConversion.cpp \
+           IO/CompressedRAWFile.cpp \
+           IO/SliceConversion.cpp \
+           IO/SwatchRasterizer.cpp \
            IO/TTIFFWriter/TTIFFWriter.cpp \
            IO/TuvokJPEG.cpp \
+           IO/UVF/BlockChecksums.cpp \
            IO/UVF/DataBlock.cpp \
            IO/uvfDataset.cpp \
            IO/UVF/ExtendedOctree/BzlibCompression.cpp \
@@ -534,6 +563,7 @@ SOURCES += \
            IO/UVF/GlobalHeader.cpp \
            IO/UVF/Histogram1DDataBlock.cpp \
            IO/UVF/Histogram2DDataBlock.cpp \
+           IO/UVF/HistogramEngine.cpp \
            IO/UVF/KeyValuePairDataBlock.cpp \
            IO/UVF/MaxMinDataBlock.cpp \
            IO/uvfMesh.cpp \
@@ -589,6 +619,7 @@ SOURCES += \
            Renderer/GL/RenderMeshGL.cpp \
            Renderer/GPUMemMan/GPUMemMan.cpp \
            Renderer/GPUMemMan/GPUMemManDataStructs.cpp \
+           Renderer/GPUMemMan/ResidencyTable.cpp \
            Renderer/RenderMesh.cpp \
            Renderer/RenderRegion.cpp \
            Renderer/SBVRGeogen2D.cpp \
@@ -26,6 +26,7 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     Basics/Appendix.h
                     Basics/ArcBall.h
                     Basics/Checksums/crc32.h
+                    Basics/Checksums/crc32c.h
                     Basics/Checksums/MD5.h
                     Basics/EndianConvert.h
                     Basics/EndianFile.h
@@ -42,6 +43,9 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     Basics/Mesh.h
                     Basics/PerfCounter.h
                     Basics/Plane.h
+                    Basics/PrefetchQueue.h
+                    Basics/PerfStats.h
+                    Basics/PerfTrace.h
                     Basics/ProgressTimer.h
                     Basics/StdDefines.h
                     Basics/SysTools.h
@@ -59,6 +63,7 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     DebugOut/AbstrDebugOut.h
                     DebugOut/ConsoleOut.h
                     DebugOut/MultiplexOut.h
+                    DebugOut/RecordingOut.h
                     DebugOut/TextfileOut.h
                     IO/3rdParty/bzip2/bzlib_private.h
                     IO/3rdParty/jpeglib/cderror.h
@@ -104,6 +109,7 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     IO/Brick.h
                     IO/BrickedDataset.h
                     IO/BrickCache.h
+                    IO/BrickView.h
                     IO/Dataset.h
                     IO/DICOM/DICOMParser.h
                     IO/DirectoryParser.h
@@ -120,6 +126,8 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     IO/IOManager.h
                     IO/KeyValueFileParser.h
                     IO/LinearIndexDataset.h
+                    IO/MinMaxTable.h
+                    IO/MinMaxIndex.h
                     IO/VGIHeaderParser.h
                     IO/NRRDConverter.h
                     IO/Quantize.h
@@ -142,6 +150,11 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     IO/MedAlyVisFiberTractGeoConverter.h
                     IO/TransferFunction1D.h
                     IO/TransferFunction2D.h
+                    IO/DataMerger.h
+                    IO/TypeConversion.h
+                    IO/CompressedRAWFile.h
+                    IO/SliceConversion.h
+                    IO/SwatchRasterizer.h
                     IO/TuvokIOError.h
                     IO/TuvokJPEG.h
                     IO/TuvokSizes.h
@@ -150,10 +163,12 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     IO/uvfMesh.h
                     IO/VTKConverter.h
                     IO/exception/IOException.h
+                    IO/UVF/BlockChecksums.h
                     IO/UVF/DataBlock.h
                     IO/UVF/GlobalHeader.h
                     IO/UVF/Histogram1DDataBlock.h
                     IO/UVF/Histogram2DDataBlock.h
+                    IO/UVF/HistogramEngine.h
                     IO/UVF/KeyValuePairDataBlock.h
                     IO/UVF/MaxMinDataBlock.h
                     IO/UVF/RasterDataBlock.h
@@ -227,6 +242,7 @@ set( TUVOK_HEADERS  StdTuvokDefines.h
                     Renderer/GL/RenderMeshGL.h
                     Renderer/GPUMemMan/GPUMemManDataStructs.h
                     Renderer/GPUMemMan/GPUMemMan.h
+                    Renderer/GPUMemMan/ResidencyTable.h
                     Renderer/GPUObject.h
                     Renderer/RenderMesh.h
                     Renderer/RenderRegion.h
@@ -274,6 +290,7 @@ set(TUVOK_SRCS 3rdParty/LUA/lapi.cpp
                3rdParty/LUA/lzio.cpp
                Basics/Appendix.cpp
                Basics/ArcBall.cpp
+               Basics/Checksums/crc32c.cpp
                Basics/Checksums/MD5.cpp
                Basics/EndianFile.cpp
                Basics/GeometryGenerator.cpp
@@ -285,6 +302,9 @@ set(TUVOK_SRCS 3rdParty/LUA/lapi.cpp
                Basics/MathTools.cpp
                Basics/MC.cpp
                Basics/Plane.cpp
+               Basics/PrefetchQueue.cpp
+               Basics/PerfStats.cpp
+               Basics/PerfTrace.cpp
                Basics/ProgressTimer.cpp
                Basics/SystemInfo.cpp
                Basics/Timer.cpp
@@ -297,6 +317,7 @@ set(TUVOK_SRCS 3rdParty/LUA/lapi.cpp
                DebugOut/AbstrDebugOut.cpp
                DebugOut/ConsoleOut.cpp
                DebugOut/MultiplexOut.cpp
+               DebugOut/RecordingOut.cpp
                DebugOut/TextfileOut.cpp
                IO/3rdParty/bzip2/blocksort.c
                IO/3rdParty/bzip2/bzlib.c
@@ -433,6 +454,8 @@ set(TUVOK_SRCS 3rdParty/LUA/lapi.cpp
                IO/IOManager.cpp
                IO/KeyValueFileParser.cpp
                IO/LinearIndexDataset.cpp
+               IO/MinMaxTable.cpp
+               IO/MinMaxIndex.cpp
                IO/VGIHeaderParser.cpp
                IO/NRRDConverter.cpp
                IO/QVISConverter.cpp
@@ -454,14 +477,21 @@ set(TUVOK_SRCS 3rdParty/LUA/lapi.cpp
                IO/MedAlyVisFiberTractGeoConverter.cpp
                IO/TransferFunction1D.cpp
                IO/TransferFunction2D.cpp
+               IO/DataMerger.cpp
+               IO/TypeConversion.cpp
+               IO/CompressedRAWFile.cpp
+               IO/SliceConversion.cpp
+               IO/SwatchRasterizer.cpp
                IO/TuvokJPEG.cpp
                IO/uvfDataset.cpp
                IO/uvfMesh.cpp
                IO/VTKConverter.cpp
+               IO/UVF/BlockChecksums.cpp
                IO/UVF/DataBlock.cpp
                IO/UVF/GlobalHeader.cpp
                IO/UVF/Histogram1DDataBlock.cpp
                IO/UVF/Histogram2DDataBlock.cpp
+               IO/UVF/HistogramEngine.cpp
                IO/UVF/KeyValuePairDataBlock.cpp
                IO/UVF/MaxMinDataBlock.cpp
                IO/UVF/RasterDataBlock.cpp
@@ -522,6 +552,7 @@ set(TUVOK_SRCS 3rdParty/LUA/lapi.cpp
                Renderer/GL/RenderMeshGL.cpp
                Renderer/GPUMemMan/GPUMemMan.cpp
                Renderer/GPUMemMan/GPUMemManDataStructs.cpp
+               Renderer/GPUMemMan/ResidencyTable.cpp
                Renderer/RenderMesh.cpp
                Renderer/RenderRegion.cpp
                Renderer/SBVRGeogen2D.cpp